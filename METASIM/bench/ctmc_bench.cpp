@@ -0,0 +1,183 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  Scalability benchmark of the CTMC component, and stress test of
+  the event loop: a random chain of N states (N = 10, 100, ...,
+  10^E), with four transitions per state and T tokens, simulated
+  for about J jumps with each backend of the event queue.
+
+  The chain is drawn from a fixed seed, and it is the same for all
+  the backends: the number of jumps of a case must not depend on
+  the backend. The results are printed one per line, as CSV (the
+  default) or as JSON objects, with the time to build the alias
+  tables, the cost of a jump and the peak resident set size:
+
+  ctmc_bench [--max-states E] [--tokens T] [--jumps J]
+             [--format csv|json] [--filter QUEUE]
+
+  E is 5 by default (up to 6), T is 1000, J is 10^6.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <metasim.hpp>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace MetaSim;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        int maxStates;
+        long tokens;
+        long jumps;
+        bool json;
+        string filter;
+
+        Options() : maxStates(5), tokens(1000), jumps(1000000), json(false),
+                    filter() {}
+    };
+
+    Options opt;
+
+    /// a fast generator for the benchmark itself (xorshift64)
+    struct Fast {
+        uint64_t s;
+        Fast() : s(88172645463325252ULL) {}
+        uint64_t next() { 
+            s ^= s << 13; s ^= s >> 7; s ^= s << 17; 
+            return s; 
+        }
+        double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    };
+
+    const char *queueName(EventQueue::Type t)
+    {
+        switch (t) {
+        case EventQueue::SET_QUEUE: return "set";
+        case EventQueue::HEAP_QUEUE: return "heap";
+        case EventQueue::CALENDAR_QUEUE: return "calendar";
+        case EventQueue::LAZY_HEAP_QUEUE: return "lazy_heap";
+        case EventQueue::WHEEL_QUEUE: return "wheel";
+        case EventQueue::RADIX_QUEUE: return "radix";
+        case EventQueue::ADAPTIVE_QUEUE: return "adaptive";
+        }
+        return "?";
+    }
+
+    long peakRSS()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        struct rusage u;
+        getrusage(RUSAGE_SELF, &u);
+        return u.ru_maxrss;
+#endif
+    }
+
+    const int LINKS = 4;
+    /// mean holding time, in ticks
+    const double HOLD = 1000;
+
+    void run(long states, EventQueue::Type q)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        SIMUL.setEventQueue(q);
+        RandomVar::init(1);
+
+        CTMC chain("bench");
+        Fast f;
+        for (long s = 0; s < states; ++s) chain.addState();
+        for (long s = 0; s < states; ++s)
+            for (int l = 0; l < LINKS; ++l)
+                chain.addTransition(s, f.next() % states, 
+                                    (0.5 + f.uniform()) / (LINKS * HOLD));
+        for (long t = 0; t < opt.tokens; ++t) chain.addToken(f.next() % states);
+
+        Clock::time_point t0 = Clock::now();
+        chain.compile();
+        double build = chrono::duration<double>(Clock::now() - t0).count();
+
+        Tick horizon = Tick(int64_t(HOLD * opt.jumps / opt.tokens));
+        t0 = Clock::now();
+        SIMUL.initSingleRun();
+        SIMUL.run_to(horizon);
+        double secs = chrono::duration<double>(Clock::now() - t0).count();
+        uint64_t jumps = chain.getJumps();
+        SIMUL.endSingleRun();
+
+        double ns = secs * 1e9 / jumps;
+        if (opt.json)
+            cout << "{\"queue\":\"" << queueName(q) << "\",\"states\":" << states
+                 << ",\"tokens\":" << opt.tokens << ",\"jumps\":" << jumps
+                 << ",\"build_s\":" << build << ",\"ns_per_jump\":" << ns
+                 << ",\"peak_rss_kb\":" << peakRSS() << "}" << endl;
+        else
+            cout << queueName(q) << "," << states << "," << opt.tokens << ","
+                 << jumps << "," << build << "," << ns << "," << peakRSS() << endl;
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--max-states E] [--tokens T] [--jumps J]"
+             << " [--format csv|json] [--filter QUEUE]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--max-states") opt.maxStates = atoi(argv[++i]);
+        else if (a == "--tokens") opt.tokens = atol(argv[++i]);
+        else if (a == "--jumps") opt.jumps = atol(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else usage(argv[0]);
+    }
+    opt.maxStates = min(max(opt.maxStates, 1), 6);
+    opt.tokens = max(opt.tokens, 1L);
+    opt.jumps = max(opt.jumps, 1L);
+
+    if (!opt.json)
+        cout << "queue,states,tokens,jumps,build_s,ns_per_jump,peak_rss_kb" << endl;
+
+    const EventQueue::Type queues[] = {
+        EventQueue::SET_QUEUE, EventQueue::HEAP_QUEUE, 
+        EventQueue::CALENDAR_QUEUE, EventQueue::LAZY_HEAP_QUEUE,
+        EventQueue::WHEEL_QUEUE, EventQueue::RADIX_QUEUE
+    };
+    long states = 1;
+    for (int e = 1; e <= opt.maxStates; ++e) {
+        states *= 10;
+        for (size_t q = 0; q < sizeof(queues) / sizeof(queues[0]); ++q) {
+            string name = queueName(queues[q]);
+            if (opt.filter.empty() || name.find(opt.filter) != string::npos)
+                run(states, queues[q]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,380 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  A network stress benchmark, built on the Ethernet example
+  (examples/eth): S segments, each one an EthernetLink shared by
+  N/S nodes, joined by store-and-forward bridges.
+
+  Every node sends frames of 100 to 1500 ticks to D peers of its
+  segment and to the bridge, at intervals sized for the offered
+  load U of each link, and the interfaces contend for the link
+  with exponential backoff. Every frame is a new Message, and its
+  reception is a disposable event (created with new, or taken
+  from the EventPool); a frame received by a bridge is forwarded,
+  after a latency L, to the bridge of another segment, which
+  sends it to one of its nodes.
+
+  The segments can be simulated in P partitions (segment s in
+  partition s % P, see PartitionedSim), with the bridge latency
+  as lookahead; the optimistic mode is not available, since the
+  entities of the example do not save their state.
+
+  The run prints one line, as CSV (the default) or as a JSON
+  object: the events and the frames delivered, the events per
+  second and the heap allocations per second (all the calls to
+  operator new, counted by this program), and the peak resident
+  set size.
+
+  eth_bench [--nodes N] [--segments S] [--peers D] [--load U]
+            [--latency L] [--horizon T] [--events new|pool]
+            [--partitions P] [--threads K] [--format csv|json]
+
+  By default N = 2000, S = 40, D = 4, U = 0.6, L = 50, T = 10^6,
+  P = 0 (a single simulation), K = 0 (one per hardware thread).
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <metasim.hpp>
+
+#include "link.hpp"
+#include "message.hpp"
+#include "netinterface.hpp"
+#include "node.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace MetaSim;
+
+namespace {
+    atomic<uint64_t> allocations(0);
+}
+
+void *operator new(size_t n)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (p == NULL) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        long nodes;
+        long segments;
+        int peers;
+        double load;
+        long latency;
+        long horizon;
+        bool pool;
+        int partitions;
+        int threads;
+        bool json;
+
+        Options() : nodes(2000), segments(40), peers(4), load(0.6), 
+                    latency(50), horizon(1000000), pool(false), 
+                    partitions(0), threads(0), json(false) {}
+    };
+
+    Options opt;
+
+    const unsigned AVG_LEN = 800;
+    /// time to process a received frame
+    const int PROCESSING = 5;
+
+    class Bridge;
+
+    /**
+       An interface that consumes the frames it receives, with
+       a disposable event for each one; the frames of a bridge
+       are forwarded.
+    */
+    class SinkInterface : public EthernetInterface {
+        Bridge *_bridge;
+    public:
+        uint64_t frames;
+
+        SinkInterface(const char *name, Node &n, EthernetLink &l, Bridge *b) :
+            EthernetInterface(name, n, l), _bridge(b), frames(0) {}
+
+        void onMessageReceived(Message *m);
+        void consume(Message *m);
+    };
+
+    class DeliverEvent : public Event {
+        SinkInterface *_iface;
+        Message *_msg;
+    public:
+        DeliverEvent(SinkInterface *i, Message *m) : Event(), _iface(i), _msg(m) {}
+        void doit() { _iface->consume(_msg); }
+    };
+
+    template <class E, class... Args>
+    void postDisposable(Tick t, Args&&... args)
+    {
+        E *e = opt.pool ? EventPool::create<E>(std::forward<Args>(args)...) :
+            new E(std::forward<Args>(args)...);
+        e->post(t, true);
+    }
+
+    /// A node that only forwards the frames of other segments
+    class Bridge : public Node {
+        int _segment;
+        vector<Node *> _local;
+    public:
+        Bridge(const string &name, int s) : Node(name), _segment(s), _local() {}
+
+        void addLocal(Node &n) { _local.push_back(&n); }
+
+        /// sends a frame of length len to a node of this segment
+        void inject(int len);
+
+        void forward(Message *m);
+
+        void newRun() {}
+        void endRun() {}
+    };
+
+    class InjectEvent : public Event {
+        Bridge *_bridge;
+        int _len;
+    public:
+        InjectEvent(Bridge *b, int len) : Event(), _bridge(b), _len(len) {}
+        void doit() { _bridge->inject(_len); }
+    };
+
+    /// the bridge of each segment
+    vector<Bridge *> bridges;
+
+    void SinkInterface::onMessageReceived(Message *m)
+    {
+        postDisposable<DeliverEvent>(SIMUL.getTime() + PROCESSING, this, m);
+    }
+
+    void SinkInterface::consume(Message *m)
+    {
+        frames++;
+        if (_bridge != NULL) _bridge->forward(m);
+        delete m;
+    }
+
+    void Bridge::inject(int len)
+    {
+        UniformVar d(0, _local.size());
+        Message *m = new Message(len, this, _local[size_t(d.get()) % _local.size()]);
+        getNetInterface()->send(m);
+    }
+
+    void Bridge::forward(Message *m)
+    {
+        UniformVar r(1, bridges.size());
+        int dest = (_segment + int(r.get())) % bridges.size();
+        Tick t = SIMUL.getTime() + opt.latency;
+        if (opt.partitions > 0) {
+            Bridge *b = bridges[dest];
+            int len = m->getLength();
+            PartitionedSim::send(dest % opt.partitions, t, [b, len]() { b->inject(len); });
+        }
+        else postDisposable<InjectEvent>(t, bridges[dest], m->getLength());
+    }
+
+    string label(const char *p, long i)
+    {
+        stringstream ss;
+        ss << p << i;
+        return ss.str();
+    }
+
+    /// The segments of a simulation (or of a partition)
+    struct Model {
+        vector<unique_ptr<EthernetLink> > links;
+        vector<unique_ptr<Node> > nodes;
+        vector<unique_ptr<SinkInterface> > ifaces;
+        SimMetrics metrics;
+
+        Model() : links(), nodes(), ifaces(), metrics(1 << 20) {}
+
+        void addSegment(int s)
+        {
+            long first = opt.nodes * s / opt.segments;
+            long count = opt.nodes * (s + 1) / opt.segments - first;
+            links.push_back(unique_ptr<EthernetLink>(
+                new EthernetLink(label("link", s).c_str())));
+            EthernetLink &l = *links.back();
+
+            Bridge *b = NULL;
+            if (opt.segments > 1) {
+                b = new Bridge(label("bridge", s), s);
+                nodes.push_back(unique_ptr<Node>(b));
+                ifaces.push_back(unique_ptr<SinkInterface>(new SinkInterface(
+                    label("bif", s).c_str(), *b, l, b)));
+                bridges[s] = b;
+            }
+
+            size_t base = nodes.size();
+            double mean = double(count) * AVG_LEN / opt.load;
+            for (long i = 0; i < count; ++i) {
+                Node *n = new Node(label("node", first + i));
+                nodes.push_back(unique_ptr<Node>(n));
+                ifaces.push_back(unique_ptr<SinkInterface>(new SinkInterface(
+                    label("if", first + i).c_str(), *n, l, NULL)));
+                n->setInterval(unique_ptr<RandomVar>(new UniformVar(1, 2 * mean)));
+                if (b != NULL) b->addLocal(*n);
+            }
+            for (long i = 0; i < count; ++i) {
+                Node *n = nodes[base + i].get();
+                for (int p = 0; p < opt.peers && count > 1; ++p) {
+                    UniformVar d(1, count);
+                    n->addDestNode(*nodes[base + (i + long(d.get())) % count]);
+                }
+                if (b != NULL) n->addDestNode(*b);
+            }
+        }
+
+        uint64_t frames() const
+        {
+            uint64_t f = 0;
+            for (size_t i = 0; i < ifaces.size(); ++i) f += ifaces[i]->frames;
+            return f;
+        }
+    };
+
+    long peakRSS()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        struct rusage u;
+        getrusage(RUSAGE_SELF, &u);
+        return u.ru_maxrss;
+#endif
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--nodes N] [--segments S] [--peers D]"
+             << " [--load U] [--latency L] [--horizon T] [--events new|pool]"
+             << " [--partitions P] [--threads K] [--format csv|json]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--nodes") opt.nodes = atol(argv[++i]);
+        else if (a == "--segments") opt.segments = atol(argv[++i]);
+        else if (a == "--peers") opt.peers = atoi(argv[++i]);
+        else if (a == "--load") opt.load = atof(argv[++i]);
+        else if (a == "--latency") opt.latency = atol(argv[++i]);
+        else if (a == "--horizon") opt.horizon = atol(argv[++i]);
+        else if (a == "--events") opt.pool = string(argv[++i]) == "pool";
+        else if (a == "--partitions") opt.partitions = atoi(argv[++i]);
+        else if (a == "--threads") opt.threads = atoi(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else usage(argv[0]);
+    }
+    opt.nodes = max(opt.nodes, 2L);
+    opt.segments = min(max(opt.segments, 1L), opt.nodes / 2);
+    opt.peers = max(opt.peers, 1);
+    if (!(opt.load > 0)) opt.load = 0.6;
+    opt.latency = max(opt.latency, 1L);
+    opt.partitions = min(max(opt.partitions, 0), int(opt.segments));
+    bridges.assign(opt.segments, NULL);
+    RandomVar::init(1);
+
+    uint64_t events = 0, frames = 0, allocs;
+    double wall;
+    if (opt.partitions == 0) {
+        Model m;
+        for (int s = 0; s < opt.segments; ++s) m.addSegment(s);
+        SIMUL.setMetrics(&m.metrics);
+
+        uint64_t a0 = allocations.load();
+        Clock::time_point t0 = Clock::now();
+        SIMUL.initSingleRun();
+        SIMUL.run_to(opt.horizon);
+        wall = chrono::duration<double>(Clock::now() - t0).count();
+        allocs = allocations.load() - a0;
+        events = m.metrics.getEvents();
+        frames = m.frames();
+        SIMUL.endSingleRun();
+        SIMUL.setMetrics(NULL);
+    }
+    else {
+        PartitionedSim ps(opt.partitions, opt.latency);
+        vector<Model *> models;
+        ps.build([&](int p) {
+                shared_ptr<Model> m = make_shared<Model>();
+                for (int s = p; s < opt.segments; s += opt.partitions)
+                    m->addSegment(s);
+                SIMUL.setMetrics(&m->metrics);
+                models.push_back(m.get());
+                return shared_ptr<void>(m);
+            });
+
+        uint64_t a0 = allocations.load();
+        Clock::time_point t0 = Clock::now();
+        ps.run(opt.horizon, opt.threads);
+        wall = chrono::duration<double>(Clock::now() - t0).count();
+        allocs = allocations.load() - a0;
+        for (size_t p = 0; p < models.size(); ++p) {
+            events += models[p]->metrics.getEvents();
+            frames += models[p]->frames();
+        }
+    }
+
+    const char *ev = opt.pool ? "pool" : "new";
+    if (opt.json)
+        cout << "{\"nodes\":" << opt.nodes << ",\"segments\":" << opt.segments
+             << ",\"load\":" << opt.load << ",\"events\":\"" << ev 
+             << "\",\"partitions\":" << opt.partitions
+             << ",\"processed\":" << events << ",\"frames\":" << frames
+             << ",\"wall_s\":" << wall << ",\"events_per_s\":" << events / wall
+             << ",\"allocs_per_s\":" << allocs / wall 
+             << ",\"peak_rss_kb\":" << peakRSS() << "}" << endl;
+    else
+        cout << "nodes,segments,load,events,partitions,processed,frames,wall_s,"
+            "events_per_s,allocs_per_s,peak_rss_kb" << endl
+             << opt.nodes << "," << opt.segments << "," << opt.load << "," 
+             << ev << "," << opt.partitions << "," << events << "," << frames 
+             << "," << wall << "," << events / wall << "," << allocs / wall
+             << "," << peakRSS() << endl;
+    return 0;
+}
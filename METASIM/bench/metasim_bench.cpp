@@ -0,0 +1,361 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  Microbenchmarks of the core operations of MetaSim: the event
+  queue (with every backend, several queue sizes and several
+  distributions of the posting times), Tick arithmetic, the
+  random variables and the lookup of entities by name.
+
+  Each benchmark is repeated, doubling the number of operations,
+  until it runs for at least --min-time seconds. The results are
+  printed one per line, as CSV (the default) or as JSON objects,
+  with the cost of one operation in nanoseconds:
+
+  metasim_bench [--max-size E] [--min-time S] [--format csv|json]
+                [--filter NAME] [--huge-pages off|thp|explicit]
+
+  The queue benchmarks use queues of 10, 100, ..., 10^E events
+  (E = 6 by default, up to 7). Their events come from the
+  EventPool, so with --huge-pages they are on huge pages, as
+  the arrays of the queues (see HugePages).
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <metasim.hpp>
+
+using namespace std;
+using namespace MetaSim;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        int maxSize;
+        double minTime;
+        bool json;
+        string filter;
+
+        Options() : maxSize(6), minTime(0.2), json(false), filter() {}
+    };
+
+    Options opt;
+
+    /// prints the header (for CSV) and one line for each result
+    void report(const string &name, const string &variant, 
+                const string &dist, long size, uint64_t ops, double secs)
+    {
+        double ns = secs * 1e9 / ops;
+        if (opt.json) 
+            cout << "{\"benchmark\":\"" << name << "\",\"variant\":\"" 
+                 << variant << "\",\"distribution\":\"" << dist 
+                 << "\",\"size\":" << size << ",\"ops\":" << ops 
+                 << ",\"ns_per_op\":" << ns << "}" << endl;
+        else
+            cout << name << "," << variant << "," << dist << "," << size 
+                 << "," << ops << "," << ns << endl;
+    }
+
+    bool selected(const string &name)
+    {
+        return opt.filter.empty() || name.find(opt.filter) != string::npos;
+    }
+
+    /**
+       Runs f(n) with n = 1, 2, 4, ... operations, until it takes
+       at least opt.minTime; returns the number of operations of
+       the last call and its duration in secs.
+    */
+    template <class F>
+    uint64_t measure(F f, double &secs)
+    {
+        for (uint64_t n = 1; ; n *= 2) {
+            Clock::time_point t0 = Clock::now();
+            f(n);
+            secs = chrono::duration<double>(Clock::now() - t0).count();
+            if (secs >= opt.minTime) return n;
+        }
+    }
+
+    /// a fast generator for the benchmark itself (xorshift64)
+    struct Fast {
+        uint64_t s;
+        Fast() : s(88172645463325252ULL) {}
+        uint64_t next() { 
+            s ^= s << 13; s ^= s >> 7; s ^= s << 17; 
+            return s; 
+        }
+    };
+
+    /**
+       A table of posting delays with a given distribution, read
+       in sequence so that generating the delays costs nothing.
+    */
+    class Delays {
+        vector<int64_t> _d;
+        size_t _i;
+    public:
+        static const size_t SIZE = 1 << 16;
+
+        explicit Delays(const string &dist) : _d(SIZE), _i(0) {
+            Fast f;
+            for (size_t i = 0; i < SIZE; ++i) {
+                double u = (f.next() >> 11) * (1.0 / 9007199254740992.0);
+                int64_t d;
+                if (dist == "uniform") d = 1 + int64_t(u * 2000);
+                else if (dist == "bimodal") {
+                    // 90% of the events in the near future, the
+                    // others far away
+                    if (f.next() % 10) d = 1 + int64_t(u * 10);
+                    else d = 1000 + int64_t(u * 9000);
+                }
+                else d = 1 + int64_t(-10 * log(1 - u));  // near-future heavy
+                _d[i] = d;
+            }
+        }
+
+        int64_t next() { return _d[_i++ & (SIZE - 1)]; }
+    };
+
+    /**
+       The classic hold model: a set of events, each one posting
+       itself again when it is processed.
+    */
+    class Holder : public Entity {
+        Delays &_delays;
+    public:
+        vector<unique_ptr<GEvent<Holder> > > events;
+
+        Holder(Delays &d, size_t n) : Entity("holder"), _delays(d), events() {
+            for (size_t i = 0; i < n; ++i) {
+                events.push_back(unique_ptr<GEvent<Holder> >(
+                    newGEvent(this, &Holder::hold)));
+                events.back()->post(_delays.next());
+            }
+        }
+
+        void hold(Event *e) { e->post(SIMUL.getTime() + _delays.next()); }
+
+        void newRun() {}
+        void endRun() {}
+    };
+
+    const char *queueName(EventQueue::Type t)
+    {
+        switch (t) {
+        case EventQueue::HEAP_QUEUE: return "heap";
+        case EventQueue::CALENDAR_QUEUE: return "calendar";
+        case EventQueue::LAZY_HEAP_QUEUE: return "lazy_heap";
+        case EventQueue::WHEEL_QUEUE: return "wheel";
+        case EventQueue::RADIX_QUEUE: return "radix";
+        default: return "set";
+        }
+    }
+
+    void benchQueue(EventQueue::Type t, const string &dist, long size)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        SIMUL.setEventQueue(t);
+
+        Delays delays(dist);
+        Holder h(delays, size);
+        double secs;
+        uint64_t ops;
+
+        if (selected("sim_step")) {
+            ops = measure([&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) SIMUL.sim_step();
+                }, secs);
+            report("sim_step", queueName(t), dist, size, ops, secs);
+        }
+
+        if (selected("post_drop")) {
+            // moves a random queued event to a new time
+            Fast f;
+            ops = measure([&](uint64_t n) {
+                    Tick now = SIMUL.getTime();
+                    for (uint64_t i = 0; i < n; ++i) {
+                        Event *e = h.events[f.next() % h.events.size()].get();
+                        e->drop();
+                        e->post(now + delays.next());
+                    }
+                }, secs);
+            report("post_drop", queueName(t), dist, size, ops, secs);
+        }
+
+        SIMUL.clearEventQueue();
+    }
+
+    void benchTick()
+    {
+        if (!selected("tick")) return;
+
+        vector<Tick> v(1024);
+        for (size_t i = 0; i < v.size(); ++i) v[i] = Tick(int64_t(i * 7 + 1));
+
+        double secs;
+        volatile int64_t sink = 0;
+        uint64_t ops = measure([&](uint64_t n) {
+                Tick acc = 0;
+                for (uint64_t i = 0; i < n; ++i) {
+                    const Tick &a = v[i & 1023];
+                    const Tick &b = v[(i + 1) & 1023];
+                    acc += a * 3 - b;
+                    if (acc > b) acc -= b;
+                }
+                sink = (long int)acc;
+            }, secs);
+        (void)sink;
+        report("tick_arith", "", "", 0, ops, secs);
+    }
+
+    template <class V>
+    void benchVar(const string &dist, const string &gen, V &var)
+    {
+        double secs;
+        volatile double sink = 0;
+        uint64_t ops = measure([&](uint64_t n) {
+                double s = 0;
+                for (uint64_t i = 0; i < n; ++i) s += var.get();
+                sink = s;
+            }, secs);
+        (void)sink;
+        report("randomvar_get", gen, dist, 0, ops, secs);
+    }
+
+    void benchRandom()
+    {
+        if (!selected("randomvar")) return;
+
+        RandomGen lcg(1);
+        Xoshiro256Gen xo(1);
+        Pcg32Gen pcg(1);
+        RandomGen *gens[] = { &lcg, &xo, &pcg };
+        const char *names[] = { "lcg", "xoshiro256", "pcg32" };
+
+        for (int g = 0; g < 3; ++g) {
+            UniformVar u(0, 1, gens[g]);
+            benchVar("uniform", names[g], u);
+        }
+        ExponentialVar e(10, &lcg);
+        benchVar("exponential", "lcg", e);
+        NormalVar nv(10, 2, &lcg);
+        benchVar("normal", "lcg", nv);
+        ParetoVar p(10, 2.5, &lcg);
+        benchVar("pareto", "lcg", p);
+        PoissonVar ps(10, &lcg);
+        benchVar("poisson", "lcg", ps);
+    }
+
+    class Named : public Entity {
+    public:
+        Named(const string &n) : Entity(n) {}
+        void newRun() {}
+        void endRun() {}
+    };
+
+    void benchFind(long size)
+    {
+        if (!selected("entity_find")) return;
+
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        vector<unique_ptr<Named> > ents;
+        vector<string> names;
+        for (long i = 0; i < size; ++i) {
+            stringstream ss;
+            ss << "entity_" << i;
+            names.push_back(ss.str());
+            ents.push_back(unique_ptr<Named>(new Named(names.back())));
+        }
+
+        Fast f;
+        double secs;
+        volatile Entity *sink = 0;
+        uint64_t ops = measure([&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i)
+                    sink = Entity::_find(names[f.next() % names.size()]);
+            }, secs);
+        (void)sink;
+        report("entity_find", "hit", "", size, ops, secs);
+
+        string miss = "no_such_entity";
+        ops = measure([&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) sink = Entity::_find(miss);
+            }, secs);
+        report("entity_find", "miss", "", size, ops, secs);
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--max-size E] [--min-time S]"
+             << " [--format csv|json] [--filter NAME]"
+             << " [--huge-pages off|thp|explicit]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--max-size") opt.maxSize = atoi(argv[++i]);
+        else if (a == "--min-time") opt.minTime = atof(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else if (a == "--huge-pages") {
+            string m = argv[++i];
+            if (m == "thp") HugePages::setMode(HugePages::TRANSPARENT);
+            else if (m == "explicit") HugePages::setMode(HugePages::EXPLICIT);
+            else if (m != "off") usage(argv[0]);
+        }
+        else usage(argv[0]);
+    }
+    if (opt.maxSize < 1) opt.maxSize = 1;
+    if (opt.maxSize > 7) opt.maxSize = 7;
+
+    if (!opt.json) 
+        cout << "benchmark,variant,distribution,size,ops,ns_per_op" << endl;
+
+    const EventQueue::Type types[] = { 
+        EventQueue::SET_QUEUE, EventQueue::HEAP_QUEUE, 
+        EventQueue::CALENDAR_QUEUE, EventQueue::LAZY_HEAP_QUEUE,
+        EventQueue::WHEEL_QUEUE, EventQueue::RADIX_QUEUE
+    };
+    const char *dists[] = { "uniform", "bimodal", "near" };
+
+    if (selected("sim_step") || selected("post_drop")) {
+        for (int t = 0; t < 6; ++t)
+            for (int d = 0; d < 3; ++d)
+                for (long s = 10, e = 1; e <= opt.maxSize; s *= 10, ++e)
+                    benchQueue(types[t], dists[d], s);
+    }
+
+    benchTick();
+    benchRandom();
+    for (long s = 10, e = 1; e <= 5 && e <= opt.maxSize; s *= 10, ++e)
+        benchFind(s);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  A correctness and performance benchmark on the queue example
+  (examples/queue): an M/M/1 queue and two M/G/1 queues (with
+  deterministic and with uniform service times) at loads from 0.5
+  to 0.9, with a mean service time of 1000 ticks.
+
+  The mean waiting time measured in R runs of C customers each is
+  compared with the closed-form result (Pollaczek-Khinchine,
+  W = lambda E[S^2] / 2(1 - rho)): a case passes if the error is
+  within twice the 95% confidence interval, so a change in the
+  random generators or in the event queue that breaks the
+  statistics fails the benchmark (with exit status 1), while the
+  events per second tell whether it made the simulation faster.
+  The seed is fixed, so the same release always gives the same
+  measures.
+
+  The results are printed one per line, as CSV (the default) or
+  as JSON objects:
+
+  queue_bench [--customers C] [--runs R] [--format csv|json]
+              [--filter NAME]
+
+  C is 100000 by default, R is 10.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <metasim.hpp>
+
+#include "queue.hpp"
+
+using namespace std;
+using namespace MetaSim;
+
+namespace {
+
+    typedef chrono::steady_clock Clock;
+
+    struct Options {
+        long customers;
+        int runs;
+        bool json;
+        string filter;
+
+        Options() : customers(100000), runs(10), json(false), filter() {}
+    };
+
+    Options opt;
+
+    /// mean service time, in ticks
+    const double SERVICE = 1000;
+
+    /**
+       A service time distribution with mean SERVICE, and its
+       second moment.
+    */
+    struct Service {
+        const char *name;
+        double moment2;
+        RandomVar *(*make)();
+    };
+
+    RandomVar *exponential() { return new ExponentialVar(SERVICE); }
+    RandomVar *deterministic() { return new DeltaVar(SERVICE); }
+    RandomVar *uniform() { return new UniformVar(0, 2 * SERVICE); }
+
+    const Service services[] = {
+        { "mm1", 2 * SERVICE * SERVICE, exponential },
+        { "md1", SERVICE * SERVICE, deterministic },
+        { "mu1", 4 * SERVICE * SERVICE / 3, uniform }
+    };
+
+    bool selected(const string &name)
+    {
+        return opt.filter.empty() || name.find(opt.filter) != string::npos;
+    }
+
+    /// runs a case and prints its result; returns false if it fails
+    bool run(const Service &s, double rho)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        RandomVar::init(1);
+
+        double interarrival = SERVICE / rho;
+        unique_ptr<RandomVar> st(s.make());
+        ExponentialVar at(interarrival);
+
+        Sink sink("sink");
+        Queue que(&sink, st.get(), "queue");
+        Source source(&que, &at, "source");
+        AvgWaitStat wait(que, "wait");
+
+        // the first tenth of each run is the transient
+        Tick length = Tick(int64_t(interarrival * opt.customers));
+        BaseStat::setTransitory(length / 10);
+
+        SimMetrics m(1 << 20);
+        SIMUL.setMetrics(&m);
+        // without the "Run #" lines of run()
+        streambuf *out = cout.rdbuf(NULL);
+        Clock::time_point t0 = Clock::now();
+        SIMUL.run(length, opt.runs);
+        double wall = chrono::duration<double>(Clock::now() - t0).count();
+        cout.rdbuf(out);
+        uint64_t events = m.getEvents();
+        SIMUL.setMetrics(NULL);
+
+        double lambda = 1 / interarrival;
+        double expected = lambda * s.moment2 / (2 * (1 - rho));
+        double measured = wait.getMean();
+        double ci = wait.getConfInterval(BaseStat::C95);
+        bool pass = fabs(measured - expected) <= 2 * ci;
+
+        if (opt.json)
+            cout << "{\"case\":\"" << s.name << "\",\"rho\":" << rho 
+                 << ",\"expected\":" << expected << ",\"measured\":" << measured
+                 << ",\"ci95\":" << ci << ",\"pass\":" << (pass ? "true" : "false")
+                 << ",\"events\":" << events << ",\"wall_s\":" << wall
+                 << ",\"events_per_s\":" << events / wall << "}" << endl;
+        else
+            cout << s.name << "," << rho << "," << expected << "," << measured
+                 << "," << ci << "," << (pass ? "pass" : "FAIL") << "," 
+                 << events << "," << wall << "," << events / wall << endl;
+        return pass;
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--customers C] [--runs R]"
+             << " [--format csv|json] [--filter NAME]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--customers") opt.customers = atol(argv[++i]);
+        else if (a == "--runs") opt.runs = atoi(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else usage(argv[0]);
+    }
+    opt.customers = max(opt.customers, 1000L);
+    // the confidence interval needs a few runs
+    opt.runs = max(opt.runs, 3);
+
+    if (!opt.json)
+        cout << "case,rho,expected_wait,measured_wait,ci95,result,events,"
+            "wall_s,events_per_s" << endl;
+
+    const double loads[] = { 0.5, 0.7, 0.8, 0.9 };
+    bool ok = true;
+    for (size_t s = 0; s < sizeof(services) / sizeof(services[0]); ++s) {
+        if (!selected(services[s].name)) continue;
+        for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); ++l)
+            ok = run(services[s], loads[l]) && ok;
+    }
+    return ok ? 0 : 1;
+}
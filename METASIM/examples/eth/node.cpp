@@ -10,7 +10,7 @@ using namespace MetaSim;
 /*-----------------------------------------------------*/
 
 Node::Node(string const & name) 
-        : Entity(name), _net_interf(0), _interval(0),
+        : Entity(name), _net_interf(0), _interval(),
           _nodes(), 
 	  _recv_evt(this, &Node::onReceive), 
 	  _send_evt(this, &Node::onSend)
@@ -55,9 +55,9 @@ void Node::onMessageReceived(Message *m)
     DBGTAG(_NODE_DBG, getName() + "::onMessageReceived()");
 }
 
-void Node::setInterval(auto_ptr<RandomVar> i)
+void Node::setInterval(unique_ptr<RandomVar> i)
 {
-    _interval = i;
+    _interval = std::move(i);
 }
 
 void Node::addDestNode(Node &n)
@@ -33,6 +33,8 @@ int main()
         AvgQueueSizeStat avgSizeStat(que, "avg_queue_size");
         avgSizeStat.attach(&source);
 
+        AvgWaitStat avgWaitStat(que, "avg_wait");
+
         BaseStat::setTransitory(2000);
   
         SIMUL.dbg.setStream("log.txt");
@@ -44,4 +46,8 @@ int main()
              << avgSizeStat.getMean() << endl;
         cout << "with a 95% confidence interval of " 
              << avgSizeStat.getConfInterval(BaseStat::C95) << endl;
+        cout << "The average waiting time is " 
+             << avgWaitStat.getMean() << endl;
+        cout << "with a 95% confidence interval of " 
+             << avgWaitStat.getConfInterval(BaseStat::C95) << endl;
 }//end main
@@ -99,17 +99,29 @@ class Queue: public Node {
         /** 
          *  The internal queue representation. See a description of the stl
          *  for more details on the deque (double ended queue) data
-         *  structure.  This is a queue of integers: in this simple example,
-         *  every packet has lenght 1. However, it is quite easy to define
-         *  a sligtly different model in which the service time depends on
-         *  the packet length...*/
-        std::deque<int> _q;
+         *  structure.  This is a queue of arrival times: in this simple
+         *  example, every packet has lenght 1. However, it is quite easy
+         *  to define a sligtly different model in which the service time
+         *  depends on the packet length...*/
+        std::deque<Tick> _q;
 
         /**
          * The service time random variable. It is possible to define a
          * general distribution! */
         RandomVar *_st;
 
+        /// The service time of the packet at the head of the queue
+        Tick _service;
+
+        /// The waiting time of the last packet served
+        Tick _lastWait;
+
+        void startService()
+        {
+                _service = Tick(_st->get());
+                _servEvent.post(SIMUL.getTime() + _service);
+        }
+
 public:
         /**
          *  This class models an event of packed served. When a packet is
@@ -145,30 +157,36 @@ public:
                 _dest(d),
                 _q(),
                 _st(st),
+                _service(0),
+                _lastWait(0),
                 _servEvent(*this) 
         {
         }
   
         virtual void put()
         {
-                _q.push_back(1);
-                if (_q.size() == 1)
-                        _servEvent.post(SIMUL.getTime() + Tick(_st->get()));
+                _q.push_back(SIMUL.getTime());
+                if (_q.size() == 1) startService();
         }
 
         void serve()
         {
+                // the service started _service ticks ago
+                _lastWait = SIMUL.getTime() - _service - _q.front();
                 _q.pop_front();
-                if (_q.size() != 0) 
-                        _servEvent.post(SIMUL.getTime() + Tick(_st->get()));
+                if (_q.size() != 0) startService();
                 _dest->put();
         }
 
         inline int getSize() { return (int) _q.size(); }
 
+        /// The time the last packet served has spent waiting in the queue
+        inline Tick getLastWait() { return _lastWait; }
+
         virtual void newRun() 
         {
                 _q.clear();
+                _lastWait = 0;
         } 
 
         virtual void endRun() {}
@@ -214,3 +232,26 @@ public:
                                                                          this);
         }
 };
+
+/**
+ * The average time spent by a packet in the queue, before its
+ * service starts (the waiting time): it probes the service event
+ * of the queue. */
+class AvgWaitStat : public StatMean {
+        Queue &_queue;
+        Particle<Queue::ServiceEvent,AvgWaitStat> *sp; 
+public:
+        AvgWaitStat(Queue &q, const char *n) :
+                StatMean(n),
+                _queue(q), 
+                sp(0)
+        {
+                sp = new Particle<Queue::ServiceEvent,AvgWaitStat>(&q._servEvent, 
+                                                                   this);
+        }
+
+        void probe(Queue::ServiceEvent &e)
+        {
+                record(double(_queue.getLastWait()));
+        }
+};
@@ -0,0 +1,78 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <arena.hpp>
+
+namespace MetaSim {
+
+    ModelArena::ModelArena(size_t chunk) :
+        _chunks(0), _cur(0), _end(0), _chunkSize(chunk), _bytes(0), _dtors()
+    {
+    }
+
+    ModelArena::~ModelArena()
+    {
+        release();
+    }
+
+    void ModelArena::newChunk(size_t n)
+    {
+        size_t size = sizeof(Chunk) + alignof(std::max_align_t) + n;
+        if (size < _chunkSize) size = _chunkSize;
+
+        Chunk *c = static_cast<Chunk *>(HugePages::map(size, ArenaMem::counters()));
+        bool mapped = c != 0;
+        if (mapped) size = HugePages::round(size);
+        else c = static_cast<Chunk *>(::operator new(size));
+        MemStats::allocated(ArenaMem::counters(), size);
+        c->next = _chunks;
+        c->size = size;
+        c->mapped = mapped;
+        _chunks = c;
+        _cur = reinterpret_cast<char *>(c + 1);
+        _end = reinterpret_cast<char *>(c) + size;
+    }
+
+    void *ModelArena::allocate(size_t n, size_t align)
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(_cur) % align) % align;
+        if (_cur == 0 || pad + n > size_t(_end - _cur)) {
+            newChunk(n + align);
+            pad = (align - reinterpret_cast<size_t>(_cur) % align) % align;
+        }
+        void *p = _cur + pad;
+        _cur += pad + n;
+        _bytes += n;
+        return p;
+    }
+
+    void ModelArena::release()
+    {
+        // in reverse order: an object may refer to the ones
+        // created before it
+        for (size_t i = _dtors.size(); i > 0; --i)
+            _dtors[i - 1].fn(_dtors[i - 1].p);
+        _dtors.clear();
+
+        while (_chunks != 0) {
+            Chunk *c = _chunks;
+            _chunks = c->next;
+            MemStats::freed(ArenaMem::counters(), c->size);
+            if (c->mapped) HugePages::unmap(c, c->size, ArenaMem::counters());
+            else ::operator delete(c);
+        }
+        _cur = _end = 0;
+        _bytes = 0;
+    }
+
+} // namespace MetaSim
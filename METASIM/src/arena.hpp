@@ -0,0 +1,116 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <memstats.hpp>
+
+namespace MetaSim {
+
+    DECL_MEM_CATEGORY(ArenaMem, "model arena");
+
+    /**
+       \ingroup metasim_util
+
+       A bump allocator for the objects of a model: they are
+       allocated one after the other in large chunks, and they are
+       all released together by release(), which runs the
+       destructors (in reverse order of creation, skipping the
+       trivially destructible objects) and frees the chunks.
+
+       The arena of a context (see SimContext::arena()) is
+       released when the context is destroyed, after the event
+       queue, the entity registry and the list of the stats have
+       been emptied at once, so that the destructors of the
+       entities, events and stats do not have to remove
+       themselves one by one.
+
+       <pre>
+       ModelArena &a = SimContext::current()->arena();
+       PeriodicTask *t = a.create<PeriodicTask>(10, 10, 0, "t1");
+       </pre>
+
+       Objects created in an arena must not be deleted.
+
+       When huge pages are enabled (see HugePages), the chunks are
+       mapped on them, 2 MB at least.
+    */
+    class ModelArena {
+        struct Chunk {
+            Chunk *next;
+            size_t size;
+            /// from HugePages::map()
+            bool mapped;
+        };
+
+        struct Dtor {
+            void (*fn)(void *);
+            void *p;
+        };
+
+        Chunk *_chunks;
+        char *_cur;
+        char *_end;
+        size_t _chunkSize;
+        size_t _bytes;
+        std::vector<Dtor> _dtors;
+
+        template <class T>
+        static void destroy(void *p) { static_cast<T *>(p)->~T(); }
+
+        void newChunk(size_t n);
+
+        ModelArena(const ModelArena &);
+        ModelArena &operator=(const ModelArena &);
+
+    public:
+        /// An arena that allocates chunks of (at least) chunk bytes
+        explicit ModelArena(size_t chunk = 64 * 1024);
+
+        ~ModelArena();
+
+        /// n bytes aligned at align (a power of 2)
+        void *allocate(size_t n, size_t align = alignof(std::max_align_t));
+
+        /// Creates an object of type T in the arena
+        template <class T, class... Args>
+        T *create(Args&&... args) {
+            void *p = allocate(sizeof(T), alignof(T));
+            T *o = ::new (p) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                Dtor d = { &destroy<T>, o };
+                _dtors.push_back(d);
+            }
+            return o;
+        }
+
+        /// Destroys all the objects, and frees the memory
+        void release();
+
+        /// Bytes allocated to the objects
+        size_t getBytes() const { return _bytes; }
+
+        /// Objects whose destructor will be run by release()
+        size_t getObjects() const { return _dtors.size(); }
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,99 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <asyncwriter.hpp>
+#include <memstats.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    AsyncWriter::AsyncWriter(ostream &os, size_t size) :
+        _os(os), _size(size > 0 ? size : 1), _cur(0), _pending(false), 
+        _stop(false), _m(), _cv(), _thread()
+    {
+        for (int i = 0; i < 2; ++i) {
+            _buf[i].reset(new char[_size]);
+            _len[i] = 0;
+        }
+        MemStats::allocated(TraceMem::counters(), 2 * _size);
+    }
+
+    AsyncWriter::~AsyncWriter()
+    {
+        try {
+            flush();
+        } catch (...) {
+        }
+        if (_thread.joinable()) {
+            {
+                lock_guard<mutex> l(_m);
+                _stop = true;
+            }
+            _cv.notify_all();
+            _thread.join();
+        }
+        MemStats::freed(TraceMem::counters(), 2 * _size);
+    }
+
+    void AsyncWriter::loop()
+    {
+        unique_lock<mutex> l(_m);
+        while (true) {
+            _cv.wait(l, [this]() { return _pending || _stop; });
+            if (_pending) {
+                int full = 1 - _cur;
+                l.unlock();
+                _os.write(_buf[full].get(), _len[full]);
+                l.lock();
+                _len[full] = 0;
+                _pending = false;
+                _cv.notify_all();
+            }
+            else break;
+        }
+    }
+
+    void AsyncWriter::wait(unique_lock<mutex> &l)
+    {
+        _cv.wait(l, [this]() { return !_pending; });
+    }
+
+    void AsyncWriter::swap()
+    {
+        if (!_thread.joinable()) _thread = thread(&AsyncWriter::loop, this);
+        {
+            unique_lock<mutex> l(_m);
+            wait(l);
+            _cur = 1 - _cur;
+            _pending = true;
+        }
+        _cv.notify_all();
+    }
+
+    void AsyncWriter::flush()
+    {
+        {
+            // the writer thread is idle after this
+            unique_lock<mutex> l(_m);
+            wait(l);
+        }
+        if (_len[_cur] > 0) {
+            _os.write(_buf[_cur].get(), _len[_cur]);
+            _len[_cur] = 0;
+        }
+        _os.flush();
+        if (!_os) throw Exc("Error writing the stream");
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,105 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ASYNCWRITER_HPP__
+#define __ASYNCWRITER_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#include <baseexc.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       Writes a binary stream through two buffers and a background
+       thread. The data are copied in the current buffer; when it
+       is full, it is handed to the writer thread, which writes it
+       with a single call on the stream, while the other buffer is
+       filled. Hence the caller (the simulation thread) does not
+       allocate memory and waits for the disk only if it produces
+       data faster than the disk can write them.
+
+       The stream must not be used by anybody else until flush()
+       has returned. The thread is started when the first buffer
+       is full, so short traces never start it.
+    */
+    class AsyncWriter {
+        std::ostream &_os;
+        size_t _size;
+        std::unique_ptr<char[]> _buf[2];
+        size_t _len[2];
+        /// the buffer being filled
+        int _cur;
+        /// true while the other buffer is being written
+        bool _pending;
+        bool _stop;
+        std::mutex _m;
+        std::condition_variable _cv;
+        std::thread _thread;
+
+        AsyncWriter(const AsyncWriter &);
+        AsyncWriter &operator=(const AsyncWriter &);
+
+        void loop();
+
+        /// hands the current buffer to the writer thread
+        void swap();
+
+        /// waits for the writer thread to be idle
+        void wait(std::unique_lock<std::mutex> &l);
+
+    public:
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "AsyncWriter", "asyncwriter.cpp") {}
+        };
+
+        /// Writes on os, through two buffers of size bytes
+        AsyncWriter(std::ostream &os, size_t size = 1 << 20);
+
+        /// Flushes the buffers and stops the thread
+        ~AsyncWriter();
+
+        /// Appends n bytes
+        void write(const void *p, size_t n) {
+            if (n > _size - _len[_cur]) {
+                if (n > _size) {
+                    flush();
+                    _os.write(static_cast<const char *>(p), n);
+                    return;
+                }
+                swap();
+            }
+            memcpy(&_buf[_cur][_len[_cur]], p, n);
+            _len[_cur] += n;
+        }
+
+        /**
+           Writes all the data on the stream, and flushes it.
+           Throws an exception if the stream is in error.
+        */
+        void flush();
+    };
+
+} // namespace MetaSim
+
+#endif
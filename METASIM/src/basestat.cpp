@@ -20,6 +20,7 @@
 #include <baseexc.hpp>
 #include <basestat.hpp>
 #include <basetype.hpp>
+#include <event.hpp>
 #include <simul.hpp>
 #include <functional>
 
@@ -28,14 +29,8 @@ using namespace std;
 namespace MetaSim {
 
     double BaseStat::_TDistr[MAX_DISTR];
-    size_t BaseStat::_totalNumOfExp = 0;
-    size_t BaseStat::_expNum = 0;
-    bool BaseStat::_endOfSim = 0;
-    bool BaseStat::_initFlag = false;
-    Tick BaseStat::_transitory = 0;  
     bool TableOutput::_created = false;
     string TableOutput::_fname;
-    BaseStat::List BaseStat::_statList;
 
     // A bunch of customary exception messages
     const char* const EFFECTIVE_ATTACH = 
@@ -50,93 +45,163 @@ namespace MetaSim {
     const char* const NEED_3 =
         "Need at least 3 run to evaluate statistic";
 
-    static const char* const TOO_MUCH_RUNS =
-        "Too many runs! \n";
-
-    static double t1_table[30][2] = {
-        {6.314, 12.706},
-        {2.920, 4.303},
-        {2.353, 3.182},
-        {2.132, 2.776},
-        {2.015, 2.571},
-        {1.943, 2.447},
-        {1.895, 2.365},
-        {1.860, 2.306},
-        {1.833, 2.262},
-        {1.812, 2.228},
-        {1.796, 2.201},
-        {1.782, 2.179},
-        {1.771, 2.160},
-        {1.768, 2.145},
-        {1.753, 2.131},
-        {1.746, 2.120},
-        {1.740, 2.110},
-        {1.734, 2.101},
-        {1.729, 2.093},
-        {1.725, 2.086},
-        {1.721, 2.080},
-        {1.717, 2.074},
-        {1.714, 2.069},
-        {1.711, 2.064},
-        {1.708, 2.060},
-        {1.706, 2.056},
-        {1.703, 2.052},
-        {1.701, 2.048},
-        {1.699, 2.045},
-        {1.697, 2.042}
-    };
+    static const size_t MSER_BATCH = 5;
+    static const size_t NONE = size_t(-1);
+
+    static const char* const NEED_4 =
+        "Need at least 4 runs to use a control variate";
+
+    static const char* const NO_CONTROL =
+        "No control variate";
+
+    static const char* const NO_BATCHES =
+        "Need at least 3 batches to evaluate statistic";
+
+    static const char* const MERGE_MISMATCH =
+        "The replications have a different set of statistics";
+
+    namespace {
+        // Quantile of the standard normal distribution (P. J.
+        // Acklam's rational approximation, relative error below
+        // 1.2e-9)
+        double normalQuantile(double p)
+        {
+            static const double a[] = {
+                -3.969683028665376e+01, 2.209460984245205e+02,
+                -2.759285104469687e+02, 1.383577518672690e+02,
+                -3.066479806614716e+01, 2.506628277459239e+00
+            };
+            static const double b[] = {
+                -5.447609879822406e+01, 1.615858368580409e+02,
+                -1.556989798598866e+02, 6.680131188771972e+01,
+                -1.328068155288572e+01
+            };
+            static const double c[] = {
+                -7.784894002430293e-03, -3.223964580411365e-01,
+                -2.400758277161838e+00, -2.549732539343734e+00,
+                4.374664141464968e+00, 2.938163982698783e+00
+            };
+            static const double d[] = {
+                7.784695709041462e-03, 3.224671290700398e-01,
+                2.445134137142996e+00, 3.754408661907416e+00
+            };
+            const double low = 0.02425;
+
+            if (p < low || p > 1 - low) {
+                double q = sqrt(-2 * log(p < low ? p : 1 - p));
+                double x = (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q
+                             + c[4])*q + c[5]) /
+                    ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1);
+                return p < low ? x : -x;
+            }
+            double q = p - 0.5;
+            double r = q * q;
+            return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r
+                    + a[5])*q /
+                (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1);
+        }
+
+        // The x such that P(|T| > x) = p, for a Student's t with n
+        // degrees of freedom (G. W. Hill, Algorithm 396, CACM 1970)
+        double studentQuantile(double p, double n)
+        {
+            if (n == 1) return 1 / tan(p * M_PI_2);
+            if (n == 2) return sqrt(2 / (p * (2 - p)) - 2);
+
+            double a = 1 / (n - 0.5);
+            double b = 48 / (a * a);
+            double c = ((20700 * a / b - 98) * a - 16) * a + 96.36;
+            double d = ((94.5 / (b + c) - 3) / b + 1) * sqrt(a * M_PI_2) * n;
+            double y = pow(d * p, 2 / n);
+
+            if (y > 0.05 + a) {
+                double x = normalQuantile(0.5 * p);
+                y = x * x;
+                if (n < 5) c += 0.3 * (n - 4.5) * (x + 0.6);
+                c = (((0.05 * d * x - 5) * x - 7) * x - 2) * x + b + c;
+                y = (((((0.4 * y + 6.3) * y + 36) * y + 94.5) / c 
+                      - y - 3) / b + 1) * x;
+                y = a * y * y;
+                y = (y > 0.002) ? exp(y) - 1 : 0.5 * y * y + y;
+            }
+            else
+                y = ((1 / (((n + 6) / (n * y) - 0.089 * d - 0.822) 
+                           * (n + 2) * 3) + 0.5 / (n + 4)) * y - 1)
+                    * (n + 1) / (n + 2) + 1 / y;
+            return sqrt(n * y);
+        }
+    }
 
     BaseStat::BaseStat(std::string n) :
-        _name(n)
+        _ctx(SimContext::current()),
+        _name(n),
+        _batching(false), _batches(), _batchSize(1), 
+        _batchSum(0), _batchCount(0),
+        _control(0), _controlMean(0),
+        _mser(false), _batchSeq(0), _warmup(0), _warmupAt(NONE), 
+        _precise(false), _precisionAt(NONE)
     {
-        _statList.push_back(this);
+        _ctx->statList.push_back(this);
     }
 
     BaseStat::~BaseStat()
     {
-        _statList.remove(this);
+        _ctx->statList.remove(this);
     }
 
     void BaseStat::init(size_t n)  
     {
-        _totalNumOfExp = n;
-        _endOfSim = false;
-        _initFlag = true;
-        for_each(_statList.begin(), _statList.end(),
+        SimContext *ctx = SimContext::current();
+        ctx->totalNumOfExp = n;
+        ctx->endOfSim = false;
+        ctx->statInit = true;
+        for_each(ctx->statList.begin(), ctx->statList.end(),
                  mem_fun(&BaseStat::init));
     }
   
     void BaseStat::init()
     {
         _exper.clear();
-        _expNum = 0;
+        _ctx->expNum = 0;
     }  
 
     void BaseStat::setTransitory(Tick t)
     {
-        _transitory = t;
+        SimContext::current()->transitory = t;
     }
 
     bool BaseStat::chkTransitory()
     {
-        if (SIMUL.getTime() >= _transitory) return false;
+        if (SIMUL.getTime() >= getTransitory()) return false;
         else return true;
     }
 
+    namespace {
+        // turns on the stats of the events at the end of the
+        // transitory, before any other event of that time
+        class StatActivationEvt : public Event {
+        public:
+            StatActivationEvt() : Event(_IMMEDIATE_PRIORITY) {}
+            virtual void doit() { activateStats(SimContext::current(), true); }
+        };
+    }
+
+    void BaseStat::attachProbes()
+    {
+        SimContext *ctx = SimContext::current();
+        bool warm = ctx->transitory > 0 && !ctx->statEvents.empty();
+        Event::activateStats(ctx, !warm);
+        if (!warm) return;
+
+        if (ctx->statActivation == 0) ctx->statActivation = new StatActivationEvt();
+        ctx->statActivation->drop();
+        ctx->statActivation->post(ctx->transitory);
+    }
+
     double BaseStat::t_student(int alfa, int dol)
     {
-        if (dol<1 || dol>30)
-            return -1;
-        switch (alfa) {
-        case 90:
-            return t1_table[dol-1][0];
-            break;
-        case 95:
-            return t1_table[dol-1][1];
-            break;
-        default:
-            return -1;
-        }
+        if (dol < 1 || alfa <= 0 || alfa >= 100) return -1;
+        return studentQuantile(1 - alfa / 100.0, dol);
     }
 
     //
@@ -144,15 +209,17 @@ namespace MetaSim {
     //
     void BaseStat::endRun()
     {
-        for_each(_statList.begin(), _statList.end(),
+        SimContext *ctx = SimContext::current();
+        for_each(ctx->statList.begin(), ctx->statList.end(),
+                 mem_fun(&BaseStat::endValue));
+        for_each(ctx->statList.begin(), ctx->statList.end(),
                  mem_fun(&BaseStat::collect));
-        if (++_expNum >= MAX_RUN)
-            throw Exc(TOO_MUCH_RUNS);
+        ++ctx->expNum;
     }
 
     void BaseStat::endSim()
     {
-        _endOfSim = true;
+        SimContext::current()->endOfSim = true;
     }
 
     //
@@ -160,8 +227,77 @@ namespace MetaSim {
     //
     void BaseStat::newRun()
     {
-        for_each(_statList.begin(), _statList.end(),
+        SimContext *ctx = SimContext::current();
+        for_each(ctx->statList.begin(), ctx->statList.end(),
                  mem_fun(&BaseStat::initValue));
+        for_each(ctx->statList.begin(), ctx->statList.end(),
+                 mem_fun(&BaseStat::initBatches));
+    }
+
+    void BaseStat::initBatches()
+    {
+        _batches.clear();
+        _batchSize = _mser ? MSER_BATCH : 1;
+        _batchSum = 0;
+        _batchCount = 0;
+        _batchSeq = 0;
+        _warmupAt = _precisionAt = NONE;
+    }
+
+    void BaseStat::setBatchMeans(bool b)
+    {
+        _batching = b;
+        if (!b) _mser = false;
+        initBatches();
+    }
+
+    void BaseStat::setWarmupDetection(bool b)
+    {
+        _mser = b;
+        setBatchMeans(b || _batching);
+    }
+
+    void BaseStat::getLastRun(vector<double> &v)
+    {
+        SimContext *ctx = SimContext::current();
+        for (List::iterator i = ctx->statList.begin(); 
+             i != ctx->statList.end(); ++i) {
+            if ((*i)->_exper.empty()) v.push_back((*i)->_val);
+            else v.push_back((*i)->_exper.back());
+        }
+    }
+
+    void BaseStat::mergeRuns(const vector<vector<double> > &runs)
+    {
+        SimContext *ctx = SimContext::current();
+
+        for (size_t k = 0; k < runs.size(); ++k)
+            if (runs[k].size() != ctx->statList.size())
+                throw Exc(MERGE_MISMATCH);
+
+        size_t j = 0;
+        for (List::iterator i = ctx->statList.begin(); 
+             i != ctx->statList.end(); ++i, ++j) {
+            (*i)->_exper.clear();
+            for (size_t k = 0; k < runs.size(); ++k)
+                (*i)->_exper.push_back(runs[k][j]);
+        }
+
+        ctx->totalNumOfExp = runs.size();
+        ctx->expNum = runs.size();
+        ctx->statInit = true;
+        ctx->endOfSim = true;
+    }
+
+    void BaseStat::mergeFrom(SimContext *c)
+    {
+        SimContext *ctx = SimContext::current();
+        if (c->statList.size() != ctx->statList.size())
+            throw Exc(MERGE_MISMATCH);
+        List::iterator i = ctx->statList.begin();
+        for (List::iterator j = c->statList.begin(); 
+             j != c->statList.end(); ++i, ++j) 
+            (*i)->merge(**j);
     }
 
     //
@@ -169,11 +305,11 @@ namespace MetaSim {
     //
     double BaseStat::getMean()
     {
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
+        if (!_ctx->endOfSim) throw Exc(GET);
+        if (!_ctx->statInit) throw Exc(NO_INIT);
 
         double sum = accumulate(_exper.begin(), _exper.end(), 0.0);
-        sum /= _expNum;
+        sum /= _ctx->expNum;
   
         return sum;
     }
@@ -201,33 +337,289 @@ namespace MetaSim {
     //
     // Returns the variance for the experimental samples
     //
+    void BaseStat::getRunValues(vector<double> &v)
+    {
+        size_t n = _ctx->expNum;
+        if (_ctx->simulation().isAntitheticPairs()) {
+            v.resize(n / 2);
+            for (size_t i = 0; i < v.size(); ++i)
+                v[i] = (_exper[2 * i] + _exper[2 * i + 1]) / 2;
+        }
+        else v.assign(_exper.begin(), _exper.begin() + n);
+    }
+
     double BaseStat::getVariance()
     {
-        double sum = 0;
-        double mu;		// the mean
-  
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
-        if (_expNum < 3) throw Exc(NEED_3);
+        if (!_ctx->endOfSim) throw Exc(GET);
+        if (!_ctx->statInit) throw Exc(NO_INIT);
 
-        mu = getMean();
+        vector<double> v;
+        getRunValues(v);
+        size_t n = v.size();
+        if (n < 3) throw Exc(NEED_3);
 
-        sum = accumulate(_exper.begin(), _exper.end(), 0.0, V(mu));
-        return sqrt(sum/((_expNum - 1) * _expNum));
+        double mu = accumulate(v.begin(), v.end(), 0.0) / n;
+        double sum = accumulate(v.begin(), v.end(), 0.0, V(mu));
+        return sqrt(sum/((n - 1) * n));
     }
 
     double BaseStat::getConfInterval(CONFIDENCE_INTERVAL c)
     {
-        double mu;		// the mean
-        double s;		// the variance
-  
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
-        if (_expNum < 3) throw Exc(NEED_3);
+        double s = getVariance();
+        size_t n = _ctx->simulation().isAntitheticPairs() ? 
+            _ctx->expNum / 2 : _ctx->expNum;
+        return t_student(c, (unsigned int) n - 1) * s;
+    }
+
+    void BaseStat::setControlVariate(BaseStat *c, double mu)
+    {
+        _control = c;
+        _controlMean = mu;
+    }
+
+    void BaseStat::controlled(double &mean, double &err, size_t &n)
+    {
+        if (_control == 0) throw Exc(NO_CONTROL);
+        if (!_ctx->endOfSim) throw Exc(GET);
+        if (!_ctx->statInit) throw Exc(NO_INIT);
+
+        vector<double> y, x;
+        getRunValues(y);
+        _control->getRunValues(x);
+        n = y.size();
+        if (n < 4) throw Exc(NEED_4);
+
+        double my = accumulate(y.begin(), y.end(), 0.0) / n;
+        double mx = accumulate(x.begin(), x.end(), 0.0) / n;
+        double sxy = 0, sxx = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sxy += (y[i] - my) * (x[i] - mx);
+            sxx += (x[i] - mx) * (x[i] - mx);
+        }
+        double b = sxx > 0 ? sxy / sxx : 0;
+        mean = my - b * (mx - _controlMean);
+
+        // the residuals of the regression, with n - 2 degrees
+        // of freedom
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double e = (y[i] - my) - b * (x[i] - mx);
+            sum += e * e;
+        }
+        err = sqrt(sum / ((n - 2) * n));
+    }
+
+    double BaseStat::getControlledMean()
+    {
+        double mean, err;
+        size_t n;
+        controlled(mean, err, n);
+        return mean;
+    }
+
+    double BaseStat::getControlledConfInterval(CONFIDENCE_INTERVAL c)
+    {
+        double mean, err;
+        size_t n;
+        controlled(mean, err, n);
+        return t_student(c, (unsigned int) n - 2) * err;
+    }
+
+    namespace {
+        void mergePairs(vector<double> &b)
+        {
+            size_t n = b.size() / 2;
+            for (size_t i = 0; i < n; ++i)
+                b[i] = (b[2 * i] + b[2 * i + 1]) / 2;
+            b.resize(n);
+        }
+
+        const size_t MIN_BATCHES = 20;
+        const double MAX_CORRELATION = 0.1;
+
+        double lag1Correlation(const vector<double> &b, double mu)
+        {
+            double num = 0, den = 0;
+            for (size_t i = 0; i < b.size(); ++i) {
+                den += (b[i] - mu) * (b[i] - mu);
+                if (i + 1 < b.size()) num += (b[i] - mu) * (b[i + 1] - mu);
+            }
+            return den > 0 ? num / den : 0;
+        }
+
+        double meanOf(const vector<double> &b)
+        {
+            return accumulate(b.begin(), b.end(), 0.0) / b.size();
+        }
+
+        // merges the batches until they are uncorrelated, and
+        // returns how many times their size has been doubled
+        int selectBatches(vector<double> &b)
+        {
+            int k = 0;
+            while (b.size() >= 2 * MIN_BATCHES && 
+                   lag1Correlation(b, meanOf(b)) > MAX_CORRELATION) {
+                mergePairs(b);
+                ++k;
+            }
+            return k;
+        }
+    }
+
+    void BaseStat::mergeBatches(vector<double> &b)
+    {
+        mergePairs(b);
+    }
+
+    void BaseStat::detectWarmup()
+    {
+        if (_warmupAt == _batchSeq) return;
+        _warmupAt = _batchSeq;
+        _warmup = 0;
+        if (!_mser) return;
+
+        // MSER(d) = sum_{i >= d} (b_i - mu_d)^2 / (k - d)^2, for
+        // d up to k/2, from the sums of the last batches
+        size_t k = _batches.size();
+        double sum = 0, sqr = 0, best = -1;
+        for (size_t d = k; d-- > 0; ) {
+            sum += _batches[d];
+            sqr += _batches[d] * _batches[d];
+            if (d > k / 2) continue;
+            double n = k - d;
+            double mser = (sqr - sum * sum / n) / (n * n);
+            if (best < 0 || mser <= best) {
+                best = mser;
+                _warmup = d;
+            }
+        }
+    }
+
+    void BaseStat::steadyBatches(vector<double> &b)
+    {
+        detectWarmup();
+        b.assign(_batches.begin() + _warmup, _batches.end());
+    }
+
+    bool BaseStat::isWarmupOver()
+    {
+        detectWarmup();
+        return _mser && _batches.size() >= MIN_BATCHES && 
+            _warmup < _batches.size() / 2;
+    }
+
+    size_t BaseStat::getWarmupLength()
+    {
+        detectWarmup();
+        return _warmup * _batchSize;
+    }
+
+    bool BaseStat::hasPrecision(double precision, CONFIDENCE_INTERVAL c)
+    {
+        if (_precisionAt == _batchSeq) return _precise;
+        _precise = false;
+        if (isWarmupOver()) {
+            double h = getBatchConfInterval(c);
+            _precise = h <= precision * fabs(getBatchMean());
+        }
+        _precisionAt = _batchSeq;
+        return _precise;
+    }
+
+    size_t BaseStat::getBatchNum()
+    {
+        vector<double> b;
+        steadyBatches(b);
+        selectBatches(b);
+        return b.size();
+    }
+
+    size_t BaseStat::getBatchSize()
+    {
+        vector<double> b;
+        steadyBatches(b);
+        return _batchSize << selectBatches(b);
+    }
+
+    double BaseStat::getBatchMean()
+    {
+        vector<double> b;
+        steadyBatches(b);
+        if (b.empty()) throw Exc(NO_BATCHES);
+        return meanOf(b);
+    }
+
+    double BaseStat::getBatchConfInterval(CONFIDENCE_INTERVAL c)
+    {
+        vector<double> b;
+        steadyBatches(b);
+        selectBatches(b);
+        if (b.size() < 3) throw Exc(NO_BATCHES);
 
-        mu = getMean();
-        s = getVariance();
-        return t_student(c, (unsigned int) _expNum - 1) * s;
+        double mu = meanOf(b);
+        double sum = accumulate(b.begin(), b.end(), 0.0, V(mu));
+        double s = sqrt(sum / ((b.size() - 1) * b.size()));
+        return t_student(c, b.size() - 1) * s;
+    }
+
+    void BaseStat::saveState(Checkpoint &c)
+    {
+        c.put(_val);
+        c.put(_exper);
+        c.put(_batches);
+        c.put(_batchSize);
+        c.put(_batchSum);
+        c.put(_batchCount);
+    }
+
+    void BaseStat::loadState(Checkpoint &c)
+    {
+        c.get(_val);
+        c.get(_exper);
+        c.get(_batches);
+        c.get(_batchSize);
+        c.get(_batchSum);
+        c.get(_batchCount);
+        _warmupAt = _precisionAt = NONE;
+    }
+
+    bool BaseStat::repeatBase(Checkpoint &c, double &val)
+    {
+        Experiments exper;
+        vector<double> batches;
+        size_t size, count;
+        double sum;
+        c.get(val);
+        c.get(exper);
+        c.get(batches);
+        c.get(size);
+        c.get(sum);
+        c.get(count);
+        return !_batching;
+    }
+
+    bool StatMean::repeat(Checkpoint &c, double m)
+    {
+        double v, n;
+        if (!repeatBase(c, v)) return false;
+        c.get(n);
+        double sum = _val * _count;
+        double count = _count + m * (_count - n);
+        if (count > 0) _val = (sum + m * (sum - v * n)) / count;
+        _count = count;
+        return true;
+    }
+
+    bool StatPercent::repeat(Checkpoint &c, double m)
+    {
+        double v, num, den;
+        if (!repeatBase(c, v)) return false;
+        c.get(num);
+        c.get(den);
+        _num += m * (_num - num);
+        _den += m * (_den - den);
+        _val = _num / _den;
+        return true;
     }
 
     void BaseStat::printAll()
@@ -244,6 +636,291 @@ namespace MetaSim {
              << endl;
     }
   
+    void StatSummary::saveState(Checkpoint &c)
+    {
+        BaseStat::saveState(c);
+        c.put(_count);
+        c.put(_min);
+        c.put(_max);
+        c.put(_m2);
+    }
+
+    void StatSummary::loadState(Checkpoint &c)
+    {
+        BaseStat::loadState(c);
+        c.get(_count);
+        c.get(_min);
+        c.get(_max);
+        c.get(_m2);
+    }
+
+    void StatSummary::merge(const BaseStat &s)
+    {
+        const StatSummary *o = dynamic_cast<const StatSummary *>(&s);
+        if (o == NULL) throw Exc(MERGE_MISMATCH, "StatSummary");
+        if (o->_count == 0) return;
+        if (_count == 0) {
+            _count = o->_count;
+            _val = o->_val;
+            _min = o->_min;
+            _max = o->_max;
+            _m2 = o->_m2;
+            return;
+        }
+        double n = _count + o->_count;
+        double d = o->_val - _val;
+        _val += d * o->_count / n;
+        _m2 += o->_m2 + d * d * _count * o->_count / n;
+        _min = min(_min, o->_min);
+        _max = max(_max, o->_max);
+        _count = n;
+    }
+
+    StatHistogram::StatHistogram(string name, double q, int bits) :
+        StatSummary(name), _bits(bits), _q(q), _buckets(), _low(0), _zeros(0)
+    {
+        if (bits < 1 || bits > 16) 
+            throw Exc("The precision must be between 1 and 16 bits", 
+                      "StatHistogram");
+        if (q < 0 || q > 1) 
+            throw Exc("The quantile must be between 0 and 1", 
+                      "StatHistogram");
+    }
+
+    // a = m 2^e, with 0.5 <= m < 1: returns the bucket of a
+    // inside its power of two
+    int StatHistogram::bucket(double a, int &e) const
+    {
+        double m = frexp(a, &e);
+        return int(ldexp(2 * m - 1, _bits));
+    }
+
+    void StatHistogram::record(double a)
+    {
+        if (chkTransitory()) return;
+        StatSummary::record(a);
+
+        if (!(a > 0)) {
+            _zeros += 1;
+            return;
+        }
+        int e;
+        int b = bucket(a, e);
+        size_t size = size_t(1) << _bits;
+        if (_buckets.empty()) _low = e;
+        else if (e < _low) {
+            _buckets.insert(_buckets.begin(), (_low - e) * size, 0.0);
+            _low = e;
+        }
+        size_t i = (e - _low) * size + b;
+        if (i >= _buckets.size()) _buckets.resize((e - _low + 1) * size, 0.0);
+        _buckets[i] += 1;
+    }
+
+    void StatHistogram::initValue()
+    {
+        StatSummary::initValue();
+        _buckets.clear();
+        _low = 0;
+        _zeros = 0;
+    }
+
+    double StatHistogram::getQuantile(double q) const
+    {
+        if (_count == 0) return 0;
+        double rank = max(1.0, ceil(q * _count));
+        if (rank >= _count) return _max;
+        if (rank <= _zeros) return max(_min, min(_max, 0.0));
+
+        double seen = _zeros;
+        size_t size = size_t(1) << _bits;
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            seen += _buckets[i];
+            if (seen >= rank) {
+                // the middle of the bucket
+                int e = _low + int(i / size);
+                double lo = ldexp(1 + double(i % size) / size, e - 1);
+                double mid = lo + ldexp(0.5 / size, e - 1);
+                return max(_min, min(_max, mid));
+            }
+        }
+        return _max;
+    }
+
+    bool StatSummary::repeat(Checkpoint &c, double m)
+    {
+        double mean, count, mn, mx, m2;
+        if (!repeatBase(c, mean)) return false;
+        c.get(count);
+        c.get(mn);
+        c.get(mx);
+        c.get(m2);
+
+        // the moments of the values of the period (Chan et al.,
+        // backwards), then of m copies of them
+        double nb = _count - count;
+        if (nb <= 0) return true;
+        double mb = (_count * _val - count * mean) / nb;
+        double d = mb - mean;
+        double m2b = _m2 - m2 - d * d * count * nb / _count;
+
+        double n = _count + m * nb;
+        d = mb - _val;
+        _val += d * m * nb / n;
+        _m2 += m * m2b + d * d * _count * m * nb / n;
+        _count = n;
+        return true;
+    }
+
+    void StatHistogram::merge(const BaseStat &s)
+    {
+        const StatHistogram *o = dynamic_cast<const StatHistogram *>(&s);
+        if (o == NULL || o->_bits != _bits) 
+            throw Exc(MERGE_MISMATCH, "StatHistogram");
+        StatSummary::merge(s);
+        _zeros += o->_zeros;
+
+        if (!o->_buckets.empty()) {
+            size_t size = size_t(1) << _bits;
+            if (_buckets.empty()) _low = o->_low;
+            else if (o->_low < _low) {
+                _buckets.insert(_buckets.begin(), (_low - o->_low) * size, 0.0);
+                _low = o->_low;
+            }
+            size_t off = (o->_low - _low) * size;
+            if (_buckets.size() < off + o->_buckets.size())
+                _buckets.resize(off + o->_buckets.size(), 0.0);
+            for (size_t i = 0; i < o->_buckets.size(); ++i)
+                _buckets[off + i] += o->_buckets[i];
+        }
+        endValue();
+    }
+
+    void StatHistogram::saveState(Checkpoint &c)
+    {
+        StatSummary::saveState(c);
+        c.put(_buckets);
+        c.put(_low);
+        c.put(_zeros);
+    }
+
+    void StatHistogram::loadState(Checkpoint &c)
+    {
+        StatSummary::loadState(c);
+        c.get(_buckets);
+        c.get(_low);
+        c.get(_zeros);
+    }
+
+    bool StatHistogram::repeat(Checkpoint &c, double m)
+    {
+        if (!StatSummary::repeat(c, m)) return false;
+        vector<double> buckets;
+        int low;
+        double zeros;
+        c.get(buckets);
+        c.get(low);
+        c.get(zeros);
+
+        // the buckets only grow, so those of the image are a part
+        // of the current ones
+        size_t size = size_t(1) << _bits;
+        size_t off = buckets.empty() ? 0 : (low - _low) * size;
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            double old = 0;
+            if (i >= off && i - off < buckets.size()) old = buckets[i - off];
+            _buckets[i] += m * (_buckets[i] - old);
+        }
+        _zeros += m * (_zeros - zeros);
+        return true;
+    }
+
+    StatQuantile::StatQuantile(string name, double q) :
+        BaseStat(name), _p(q), _count(0)
+    {
+        if (q <= 0 || q >= 1) 
+            throw Exc("The quantile must be between 0 and 1", "StatQuantile");
+        initValue();
+    }
+
+    void StatQuantile::initValue()
+    {
+        _val = 0;
+        _count = 0;
+        for (int i = 0; i < 5; ++i) _h[i] = _n[i] = i;
+        _d[0] = 0;
+        _d[1] = 2 * _p;
+        _d[2] = 4 * _p;
+        _d[3] = 2 + 2 * _p;
+        _d[4] = 4;
+    }
+
+    void StatQuantile::record(double a)
+    {
+        if (chkTransitory()) return;
+
+        // the first five values are the initial markers
+        if (_count < 5) {
+            _h[int(_count)] = a;
+            ++_count;
+            sort(_h, _h + int(_count));
+            int k = int(ceil(_p * _count)) - 1;
+            _val = _h[max(k, 0)];
+            return;
+        }
+        ++_count;
+
+        int k;
+        if (a < _h[0]) { _h[0] = a; k = 0; }
+        else if (a >= _h[4]) { _h[4] = a; k = 3; }
+        else for (k = 0; a >= _h[k + 1]; ++k) ;
+
+        for (int i = k + 1; i < 5; ++i) _n[i] += 1;
+        const double dd[5] = { 0, _p / 2, _p, (1 + _p) / 2, 1 };
+        for (int i = 0; i < 5; ++i) _d[i] += dd[i];
+
+        // move the middle markers towards their desired position,
+        // with the piecewise-parabolic (or else linear) formula
+        for (int i = 1; i < 4; ++i) {
+            double d = _d[i] - _n[i];
+            if ((d >= 1 && _n[i + 1] - _n[i] > 1) || 
+                (d <= -1 && _n[i - 1] - _n[i] < -1)) {
+                int s = d > 0 ? 1 : -1;
+                double h = _h[i] + s / (_n[i + 1] - _n[i - 1]) *
+                    ((_n[i] - _n[i - 1] + s) * (_h[i + 1] - _h[i]) / 
+                     (_n[i + 1] - _n[i]) +
+                     (_n[i + 1] - _n[i] - s) * (_h[i] - _h[i - 1]) / 
+                     (_n[i] - _n[i - 1]));
+                if (_h[i - 1] < h && h < _h[i + 1]) _h[i] = h;
+                else _h[i] += s * (_h[i + s] - _h[i]) / (_n[i + s] - _n[i]);
+                _n[i] += s;
+            }
+        }
+        _val = _h[2];
+    }
+
+    void StatQuantile::saveState(Checkpoint &c)
+    {
+        BaseStat::saveState(c);
+        c.put(_count);
+        for (int i = 0; i < 5; ++i) {
+            c.put(_h[i]);
+            c.put(_n[i]);
+            c.put(_d[i]);
+        }
+    }
+
+    void StatQuantile::loadState(Checkpoint &c)
+    {
+        BaseStat::loadState(c);
+        c.get(_count);
+        for (int i = 0; i < 5; ++i) {
+            c.get(_h[i]);
+            c.get(_n[i]);
+            c.get(_d[i]);
+        }
+    }
+
     /* Output class 
        This class produce formatted output to be read by gnuplot.
        Just call GnuPlotOutput::init() before simulation, and 
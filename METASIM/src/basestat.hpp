@@ -22,6 +22,8 @@
 #include <algorithm>
 
 #include <basetype.hpp>
+#include <checkpoint.hpp>
+#include <simcontext.hpp>
 
 namespace MetaSim {
 
@@ -91,10 +93,10 @@ namespace MetaSim {
     private:
         static const int MAX_DISTR = 10000;
         static double _TDistr[MAX_DISTR];
-        static size_t _totalNumOfExp;
-        static size_t _expNum;
-        static bool _endOfSim;
-        static List _statList;
+
+        /// the context (which keeps the list of the stat objects
+        /// and the number of experiments) of this object
+        SimContext *_ctx;
 
     protected:
 
@@ -125,18 +127,93 @@ namespace MetaSim {
         /** called at the end of the run, puts the current 
             value in the array of experiments. */
         inline void collect() {
-            if (_exper.size() <= _expNum) _exper.push_back(_val);
-            else _exper[_expNum] = _val;
+            if (_exper.size() <= _ctx->expNum) _exper.push_back(_val);
+            else _exper[_ctx->expNum] = _val;
         }
 
         // System-Wide data & functions needed to be visible 
         // also to other kind of stats!
-        /// lenght of the transitory.
-        static Tick _transitory;
+        /// lenght of the transitory (of the current context).
+        static inline Tick getTransitory() {
+            return SimContext::current()->transitory;
+        }
 
-        /// used to see if the base stat class has been
-        /// initialized. (???) 
-        static bool _initFlag;
+        /**
+           Observations grouped in batches (see setBatchMeans()).
+           _batches holds the means of the completed batches of
+           _batchSize observations; when MAX_BATCHES are
+           completed, adjacent batches are merged and the size
+           is doubled, so the memory does not grow with the
+           length of the run.
+        */
+        static const size_t MAX_BATCHES = 128;
+        bool _batching;
+        std::vector<double> _batches;
+        size_t _batchSize;
+        double _batchSum;
+        size_t _batchCount;
+
+        /// the control variate (see setControlVariate()) and its mean
+        BaseStat *_control;
+        double _controlMean;
+
+        /// the values of the runs, or of the antithetic pairs
+        void getRunValues(std::vector<double> &v);
+
+        /// the controlled mean, its standard error and the
+        /// number of runs (or pairs)
+        void controlled(double &mean, double &err, size_t &n);
+
+        /// MSER-5 warm-up detection (see setWarmupDetection())
+        bool _mser;
+        /// batches completed in this run
+        size_t _batchSeq;
+        /// the truncation point, in batches, after _warmupAt batches
+        size_t _warmup;
+        size_t _warmupAt;
+        /// the result of hasPrecision() after _precisionAt batches
+        bool _precise;
+        size_t _precisionAt;
+
+        /// computes the truncation point, if a batch has been completed
+        void detectWarmup();
+
+        /// the completed batches past the warm-up
+        void steadyBatches(std::vector<double> &b);
+
+        /// merges the batches in pairs (dropping an odd last one)
+        static void mergeBatches(std::vector<double> &b);
+
+        /// resets the batches at the beginning of a run
+        void initBatches();
+
+        /**
+           Level 1 classes that compute a mean of the recorded
+           values (like StatMean and StatPercent) call this
+           function with each value past the transitory, to
+           collect the batches.
+        */
+        inline void observe(double x) {
+            if (!_batching) return;
+            _batchSum += x;
+            if (++_batchCount == _batchSize) {
+                _batches.push_back(_batchSum / _batchSize);
+                _batchSum = 0;
+                _batchCount = 0;
+                ++_batchSeq;
+                if (_batches.size() == MAX_BATCHES) {
+                    mergeBatches(_batches);
+                    _batchSize *= 2;
+                }
+            }
+        }
+
+        /**
+           Reads the part of c written by BaseStat::saveState(),
+           storing the old value in val, for repeat(). Returns
+           false if the batch means are enabled.
+        */
+        bool repeatBase(Checkpoint &c, double &val);
 
         /// t-student function
         static double get_t_perc(double alpha);
@@ -144,7 +221,11 @@ namespace MetaSim {
         /// computes the t-student with parameter n.
         static void calc_t(int n);
 
-        /// returns the t-student with parameter alfa and dol.
+        /**
+           returns the t-student with parameter alfa (the
+           confidence, in percent) and dol (degrees of freedom),
+           or -1 if they are out of range.
+        */
         static double t_student(int alfa, int dol);
 
     public:
@@ -153,14 +234,34 @@ namespace MetaSim {
         virtual ~BaseStat();
   
         typedef List::const_iterator iterator;
-        static inline iterator begin() { return _statList.begin(); }
-        static inline iterator end() { return _statList.end(); }
+        static inline iterator begin() { 
+            return SimContext::current()->statList.begin(); 
+        }
+        static inline iterator end() { 
+            return SimContext::current()->statList.end(); 
+        }
 
         /** 
             Level 1 function: it is called by the probe() (level 2) 
         */
         virtual void record(double) = 0;
         virtual void initValue() = 0;
+
+        /**
+           Called at the end of each run, just before the value
+           is collected. Level 1 classes whose value is too
+           expensive to be updated at every record() (for
+           example, a quantile of a histogram) compute it here.
+        */
+        virtual void endValue() {}
+
+        /**
+           Called before the current value is read in the middle
+           of a run (see StatSnapshots). The classes whose value
+           is computed from counters kept by the model update it
+           here.
+        */
+        virtual void refresh() {}
   
         /** 
             level 2 function: called by the event action() method. 
@@ -192,7 +293,7 @@ namespace MetaSim {
         /**
            Returns the name of this stat.
         */
-        inline std::string getName() { return _name; }
+        inline const std::string &getName() const { return _name; }
 
         /**
            Returns the current value of the stat object.
@@ -203,11 +304,20 @@ namespace MetaSim {
            Returns the data collected in the last run
         */
         inline double getLastValue() {
-            if (_expNum > 0) 
-                return _exper[_expNum-1]; 
+            if (_ctx->expNum > 0) 
+                return _exper[_ctx->expNum-1]; 
             else return 0;
         }
 
+        /**
+           Replaces the data collected in the last run with v, for
+           a value computed outside of the run (see
+           Splitting::setStat())
+        */
+        inline void setLastValue(double v) {
+            if (_ctx->expNum > 0) _exper[_ctx->expNum-1] = v;
+        }
+
         /// Returns the mean value
         double getMean();
 
@@ -220,19 +330,133 @@ namespace MetaSim {
             C95 = 95
         };
 
-        /** Returns the 90% or 95% confidence interval 
-            because of the underlying implementation 
-            of the t_student() function, which has
-            been pre-calculated only for 90% and 95%
-            values
+        /** Returns the half-width of the 90% or 95% confidence
+            interval of the mean, for any number of runs (at
+            least 3). With antithetic pairs (see
+            Simulation::setAntitheticPairs()) it is computed on
+            the means of the pairs (at least 3).
 	
             @param c  can be C90 or C95 */
         double getConfInterval(CONFIDENCE_INTERVAL c = C95);
+
+        /**
+           The values of the runs completed so far, one per run,
+           without copying them: valid until the next run.
+        */
+        const std::vector<double> &getRunData() const { return _exper; }
+
+        /**
+           Uses c as a control variate for the mean of this stat:
+           c must be a stat of the same runs, correlated to this
+           one, whose expected value mu is known (for example,
+           the utilization of a processor, which is the sum of
+           the utilizations of the tasks). See
+           getControlledMean().
+        */
+        void setControlVariate(BaseStat *c, double mu);
+
+        /**
+           Returns the mean of the runs corrected by the control
+           variate: mean - b (cmean - mu), where cmean is the mean
+           of the control variate and b is the regression
+           coefficient estimated from the runs. Throws an
+           exception if there is no control variate, or if there
+           are less than 4 runs (or antithetic pairs).
+        */
+        double getControlledMean();
+
+        /// Half-width of the confidence interval of getControlledMean()
+        double getControlledConfInterval(CONFIDENCE_INTERVAL c = C95);
+
+        /**
+           Enables (or disables) the batch means estimation: the
+           values recorded in a run, past the transitory, are
+           grouped in batches, so that the mean and its
+           confidence interval for the steady state can be
+           obtained from a single long run, without repeating the
+           transitory in every replica. It is supported by the
+           stats that compute a mean of the recorded values
+           (StatMean, StatPercent and their subclasses). The size
+           of the batches is chosen automatically, see
+           getBatchConfInterval(). It must be called before the
+           run.
+        */
+        void setBatchMeans(bool b = true);
+
+        bool isBatchMeans() const { return _batching; }
+
+        /**
+           Returns the number of batches used by getBatchMean()
+           and getBatchConfInterval(): the completed batches of
+           the current (or last) run are merged until the lag-1
+           autocorrelation of their means is below 0.1, or until
+           they are less than 20.
+        */
+        size_t getBatchNum();
+
+        /// Returns the number of values in each of those batches
+        size_t getBatchSize();
+
+        /// Returns the mean of the completed batches
+        double getBatchMean();
+
+        /**
+           Returns the half-width of the confidence interval of
+           the steady-state mean, computed from the means of the
+           batches as if they were independent. It can be called
+           during the run, or after it. Throws an exception if
+           there are less than 3 batches.
+        */
+        double getBatchConfInterval(CONFIDENCE_INTERVAL c = C95);
+
+        /**
+           Enables (or disables) the detection of the warm-up with
+           MSER-5, instead of a fixed transitory: the batch means
+           are enabled, starting from batches of 5 values, and the
+           batches recorded at the beginning of the run are
+           discarded up to the truncation point that minimizes
+           the standard error of the mean of the remaining ones
+           (searched in the first half of the run). The batch
+           estimates (getBatchMean(), getBatchConfInterval(), ...)
+           only use the batches past the warm-up, while getValue()
+           still accounts for all the values recorded past the
+           transitory, which should be 0. It must be called
+           before the run.
+        */
+        void setWarmupDetection(bool b = true);
+
+        bool isWarmupDetection() const { return _mser; }
+
+        /**
+           Returns true if the warm-up is over: at least 20
+           batches have been completed, and the truncation point
+           is before the second half of the run (otherwise the run
+           is still too short to tell).
+        */
+        bool isWarmupOver();
+
+        /// Returns the number of values discarded as warm-up
+        size_t getWarmupLength();
+
+        /**
+           Returns true if the warm-up is over, and the half-width
+           of the confidence interval of the steady-state mean
+           (see getBatchConfInterval()) is at most precision
+           times the absolute value of the mean. It is evaluated
+           again only when a batch is completed, so it can be used
+           as a stop predicate, to end the run as soon as enough
+           values have been collected past the warm-up:
+           <pre>
+           s.setWarmupDetection();
+           SIMUL.addStopPredicate([&s]() { return s.hasPrecision(0.01); });
+           </pre>
+        */
+        bool hasPrecision(double precision, CONFIDENCE_INTERVAL c = C95);
 	
         /*--------------------------------------------*/
 
         // debug!!
-        inline size_t getExpNum() { return _expNum; }
+        inline size_t getExpNum() { return _ctx->expNum; }
         static void printAll();	
         void print();
 
@@ -261,6 +485,80 @@ namespace MetaSim {
     
         /// check if we are currently inside the transitory
         static bool chkTransitory();
+
+        /**
+           Called at the beginning of a run (see
+           Simulation::initSingleRun()): with a transitory, the
+           stats and the stat particles of the events are turned
+           off, and a single event turns them on at the end of the
+           transitory, so the warm-up runs without their probes
+           (and the events without other probes skip them with
+           one test). The stats still check chkTransitory(), for
+           the values they do not get from the events.
+        */
+        static void attachProbes();
+
+        /**
+           Appends to v the value collected in the last run by
+           every stat object of the current context, in the order
+           of the stat list.
+        */
+        static void getLastRun(std::vector<double> &v);
+
+        /**
+           Replaces the experiments of the stat objects of the
+           current context with the values in runs (one vector per
+           run, as returned by getLastRun()), and marks the end of
+           the simulation. Used to merge replications executed in
+           other contexts by a model with the same stat objects.
+        */
+        static void mergeRuns(const std::vector<std::vector<double> > &runs);
+
+        /**
+           Combines the accumulated state of s, a stat object of
+           the same class (in general, of another context), with
+           the state of this one, as if the values recorded by s
+           had been recorded by this object. It is used by the
+           parallel run() to merge the replicas: the per-run
+           values (see mergeRuns()) are merged separately, so the
+           classes that only have a per-run value (StatMax,
+           StatMean, ...) do not need to override it. The merge is
+           associative, so replicas can be combined in any
+           grouping, but the order of replicas is preserved.
+           Throws an exception if s is of another class.
+        */
+        virtual void merge(const BaseStat &s) {}
+
+        /**
+           Merges (see merge()) the stats of context c into the
+           stats of the current context: the two contexts must have
+           the same stat objects, in the same order.
+        */
+        static void mergeFrom(SimContext *c);
+
+        /**
+           Writes the state of the stat in a checkpoint (see
+           Simulation::checkpoint()): the current value and the
+           experiments. Level 1 classes with more accumulators
+           override it, together with loadState().
+        */
+        virtual void saveState(Checkpoint &c);
+
+        /// Reads back the state written by saveState()
+        virtual void loadState(Checkpoint &c);
+
+        /**
+           Used by the fast-forward (see
+           Simulation::setFastForward()): c contains the state of
+           the stat, as written by saveState(), one period
+           before, and the values recorded since then are
+           accounted m more times, as if the period had been
+           simulated m more times. Returns false if the values
+           cannot be extrapolated (by default, and always with
+           batch means): then the simulation is not
+           fast-forwarded.
+        */
+        virtual bool repeat(Checkpoint &c, double m) { return false; }
     };
 
     /* ---------------------------------------------------------
@@ -312,6 +610,10 @@ namespace MetaSim {
                 _val = std::max(_val, a);
             }
         virtual void initValue() { _val = _ini; }
+        virtual bool repeat(Checkpoint &c, double m) {
+            double v;
+            return repeatBase(c, v);
+        }
     };
 
     /// Computes the min value
@@ -330,6 +632,10 @@ namespace MetaSim {
                 _val = std::min(_val, a);
             }
         virtual void initValue() { _val = _ini; }
+        virtual bool repeat(Checkpoint &c, double m) {
+            double v;
+            return repeatBase(c, v);
+        }
     };
 
     /// Computes a mean value X_m = (Sigma{X_i}i=1,N)/N
@@ -349,8 +655,19 @@ namespace MetaSim {
                 if (chkTransitory()) return;
                 _val = _val * _count + a;
                 _val /= ++_count;
+                observe(a);
             };
         virtual void initValue() { _val = _ini; _count = 0; };
+
+        virtual void saveState(Checkpoint &c) {
+            BaseStat::saveState(c);
+            c.put(_count);
+        }
+        virtual void loadState(Checkpoint &c) {
+            BaseStat::loadState(c);
+            c.get(_count);
+        }
+        virtual bool repeat(Checkpoint &c, double m);
     };
 
     /// Computes the quadratic mean value 
@@ -367,6 +684,15 @@ namespace MetaSim {
             }
 
         virtual void initValue() { _val = _ini; _count = 0; };
+
+        virtual void saveState(Checkpoint &c) {
+            BaseStat::saveState(c);
+            c.put(_count);
+        }
+        virtual void loadState(Checkpoint &c) {
+            BaseStat::loadState(c);
+            c.get(_count);
+        }
     };
 
 
@@ -392,6 +718,12 @@ namespace MetaSim {
             }
   
         virtual void initValue() { _val = _ini; }
+        virtual bool repeat(Checkpoint &c, double m) {
+            double v;
+            if (!repeatBase(c, v)) return false;
+            _val += m * (_val - v);
+            return true;
+        }
     };
 
 
@@ -419,6 +751,7 @@ namespace MetaSim {
                 _den += 1;
                 if (value > 0.0) _num += 1;
                 _val = _num / _den;
+                observe(value > 0.0 ? 1 : 0);
             }
         virtual void initValue() 
             { 
@@ -426,6 +759,18 @@ namespace MetaSim {
                 _num = _ini;
                 _den = std::max(1.0,_ini);
             }
+
+        virtual void saveState(Checkpoint &c) {
+            BaseStat::saveState(c);
+            c.put(_num);
+            c.put(_den);
+        }
+        virtual void loadState(Checkpoint &c) {
+            BaseStat::loadState(c);
+            c.get(_num);
+            c.get(_den);
+        }
+        virtual bool repeat(Checkpoint &c, double m);
         int getNumSamples() 
             {
                 return _den;
@@ -433,6 +778,127 @@ namespace MetaSim {
     };
 
 
+    /**
+       Computes the exact number, minimum, maximum, mean and
+       variance of the recorded values, with the numerically stable
+       recurrence of Welford. The value is the mean.
+    */
+    class StatSummary : public BaseStat {
+    protected:
+        double _count;
+        double _min, _max;
+        double _m2;
+    public:
+        StatSummary(std::string name = "") : 
+            BaseStat(name), _count(0), _min(0), _max(0), _m2(0)
+            {
+            }
+
+        virtual void record(double a)
+            {
+                if (chkTransitory()) return;
+                if (_count == 0) _min = _max = a;
+                else {
+                    _min = std::min(_min, a);
+                    _max = std::max(_max, a);
+                }
+                double d = a - _val;
+                _val += d / ++_count;
+                _m2 += d * (a - _val);
+                observe(a);
+            }
+        virtual void initValue() { _val = _count = _min = _max = _m2 = 0; }
+
+        /// Combines the moments with those of s (Chan et al.)
+        virtual void merge(const BaseStat &s);
+
+        /// Number of values recorded in the current run
+        double getCount() const { return _count; }
+        double getMin() const { return _min; }
+        double getMax() const { return _max; }
+        /// Sample variance of the values of the current run
+        double getSampleVariance() const { 
+            return _count > 1 ? _m2 / (_count - 1) : 0; 
+        }
+
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+        virtual bool repeat(Checkpoint &c, double m);
+    };
+
+    /**
+       A histogram of the recorded values, with logarithmic
+       buckets (as in HdrHistogram): each power of two is divided
+       into 2^bits buckets, so the quantiles are computed with a
+       relative error of at most 2^-bits, using an amount of
+       memory that depends only on the range of the values. Values
+       not larger than 0 are counted in a bucket of their own.
+
+       The exact minimum, maximum and mean are computed as in
+       StatSummary. The value collected at the end of each run is
+       the quantile q given to the constructor (by default, the
+       99th percentile); any other quantile of the current run is
+       returned by getQuantile().
+    */
+    class StatHistogram : public StatSummary {
+        int _bits;
+        double _q;
+        /// the buckets, starting from power of two 2^_low
+        std::vector<double> _buckets;
+        int _low;
+        double _zeros;
+
+        int bucket(double a, int &e) const;
+    public:
+        StatHistogram(std::string name = "", double q = 0.99, int bits = 7);
+
+        virtual void record(double a);
+        virtual void initValue();
+        virtual void endValue() { _val = getQuantile(_q); }
+
+        /// Sums the buckets of s, which must have the same precision
+        virtual void merge(const BaseStat &s);
+
+        /**
+           Returns the value below which there is at least a
+           fraction q (0 <= q <= 1) of the values recorded in the
+           current run, or 0 if there are none.
+        */
+        double getQuantile(double q) const;
+
+        /// The number of buckets currently allocated
+        size_t getBucketNum() const { return _buckets.size(); }
+
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+        virtual bool repeat(Checkpoint &c, double m);
+    };
+
+    /**
+       Estimates the quantile q of the recorded values with the P^2
+       algorithm (R. Jain and I. Chlamtac, CACM 1985), which keeps
+       only five markers: the memory and the cost of record() do
+       not depend on the number of values. The value is the
+       current estimate.
+    */
+    class StatQuantile : public BaseStat {
+        double _p;
+        double _count;
+        double _h[5];  ///< heights of the markers
+        double _n[5];  ///< positions of the markers
+        double _d[5];  ///< desired positions
+    public:
+        StatQuantile(std::string name = "", double q = 0.99);
+
+        virtual void record(double a);
+        virtual void initValue();
+
+        double getCount() const { return _count; }
+
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+    };
+
     /// Produces output in gnuplot format
     /**
        Output for gnuplot. This class open a file for each statistical object   
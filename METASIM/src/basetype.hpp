@@ -47,11 +47,4 @@
 // #endif
 // #endif
 
-namespace MetaSim {
-  /* MAX_RUN is the maximum number of runs allowable in this simulator
-   * it is an arbitrary value, feel free to increase it.
-   */
-  static const size_t MAX_RUN = 100000;
-}
-
 #endif
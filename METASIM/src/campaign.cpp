@@ -0,0 +1,636 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <basestat.hpp>
+#include <campaign.hpp>
+#include <randomvar.hpp>
+#include <resultstore.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+#include <topology.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    double Campaign::Point::operator[](const string &name) const
+    {
+        for (size_t i = 0; i < _c->_names.size(); ++i)
+            if (_c->_names[i] == name) return _v[i];
+        throw Exc("Unknown parameter " + name);
+    }
+
+    Campaign::Campaign() : _names(), _values(), _columns(), _table(), _out(0),
+                           _store(0), _files(), _cacheDir("."), _listenFd(-1),
+                           _caching(false), _pinning(false), _splitRuns(false),
+                           _progress(), _model(), _cached(0), _budget(),
+                           _stopped(0), _keys()
+    {
+    }
+
+    void Campaign::addParameter(const string &name, const vector<double> &values)
+    {
+        if (values.empty()) throw Exc("Parameter " + name + " has no values");
+        _names.push_back(name);
+        _values.push_back(values);
+    }
+
+    void Campaign::addParameter(const string &name, double from, double to, double step)
+    {
+        if (step <= 0) throw Exc("The step must be positive");
+        vector<double> v;
+        // a small tolerance, so that to is included
+        for (int i = 0; from + i * step <= to + step * 1e-9; ++i)
+            v.push_back(from + i * step);
+        addParameter(name, v);
+    }
+
+    size_t Campaign::size() const
+    {
+        size_t n = 1;
+        for (size_t i = 0; i < _values.size(); ++i) n *= _values[i].size();
+        return n;
+    }
+
+    Campaign::Point Campaign::getPoint(size_t k) const
+    {
+        Point p;
+        p._c = this;
+        p._index = k;
+        p._v.resize(_values.size());
+        for (size_t i = _values.size(); i-- > 0; ) {
+            p._v[i] = _values[i][k % _values[i].size()];
+            k /= _values[i].size();
+        }
+        return p;
+    }
+
+    namespace {
+        /// the results of point p, from the stats of the current context
+        void readRow(const Campaign::Point &p, int runs, Campaign::Row &r,
+                     vector<string> &columns)
+        {
+            r.params = p.getValues();
+            for (BaseStat::iterator i = BaseStat::begin(); i != BaseStat::end(); ++i) {
+                columns.push_back((*i)->getName());
+                r.values.push_back((*i)->getMean());
+                r.conf.push_back(runs >= 3 ? (*i)->getConfInterval() : 0);
+            }
+        }
+
+        /// the wall-clock cost of the tasks of a campaign, for its progress
+        class CostModel {
+            size_t _split, _threads, _total, _done;
+            double _sum;
+            /// the cost and the number of the completed runs of
+            /// the points not completed yet
+            unordered_map<size_t, pair<double, size_t> > _started;
+            chrono::steady_clock::time_point _start;
+
+        public:
+            CostModel(size_t split, size_t threads, size_t total) :
+                _split(split), _threads(threads), _total(total), _done(0),
+                _sum(0), _started(), _start(chrono::steady_clock::now()) {}
+
+            void add(size_t point, double secs)
+            {
+                ++_done;
+                _sum += secs;
+                if (_split == 1) return;
+                pair<double, size_t> &c = _started[point];
+                c.first += secs;
+                if (++c.second == _split) _started.erase(point);
+            }
+
+            Campaign::Progress get() const
+            {
+                Campaign::Progress p;
+                p.done = _done;
+                p.total = _total;
+                p.elapsed = chrono::duration<double>(chrono::steady_clock::now() -
+                                                     _start).count();
+                double left = 0;
+                size_t known = 0;
+                for (auto i = _started.begin(); i != _started.end(); ++i) {
+                    size_t n = _split - i->second.second;
+                    left += n * i->second.first / i->second.second;
+                    known += n;
+                }
+                if (_done > 0) left += (_total - _done - known) * _sum / _done;
+                p.eta = left / _threads;
+                return p;
+            }
+        };
+
+        /**
+           Checks the budget of a point (see Campaign::setBudget())
+           after each event, as a stop predicate of its simulation:
+           the clock is read every CLOCK events.
+        */
+        class Watchdog {
+            Campaign::Budget _b;
+            uint64_t _events;
+            /// ticks simulated by the runs already ended
+            double _simulated;
+            bool _tripped;
+            chrono::steady_clock::time_point _start;
+
+            static const uint64_t CLOCK = 1024;
+
+            bool trip() { _tripped = true; return true; }
+
+        public:
+            /// with a share (1 / n) of the events and of the time of b
+            Watchdog(const Campaign::Budget &b, int n) :
+                _b(b), _events(0), _simulated(0), _tripped(false),
+                _start(chrono::steady_clock::now())
+            {
+                if (_b.events > 0) _b.events = max<uint64_t>(1, _b.events / n);
+                _b.seconds /= n;
+            }
+
+            bool active() const 
+            { 
+                return _b.events > 0 || _b.seconds > 0 || _b.minRate > 0; 
+            }
+
+            /// true if the point must be stopped
+            bool check()
+            {
+                ++_events;
+                if (_b.events > 0 && _events >= _b.events) return trip();
+                if (_events % CLOCK != 0) return false;
+                double secs = chrono::duration<double>(chrono::steady_clock::now() - 
+                                                       _start).count();
+                if (_b.seconds > 0 && secs >= _b.seconds) return trip();
+                if (_b.minRate > 0 && secs >= _b.grace && secs > 0 &&
+                    (_simulated + double(SIMUL.getTime())) / secs < _b.minRate)
+                    return trip();
+                return false;
+            }
+
+            /// called at the end of each run, before endSingleRun()
+            void endRun() { _simulated += double(SIMUL.getTime()); }
+
+            bool tripped() const { return _tripped; }
+        };
+    }
+
+    void Campaign::runPoint(const ModelBuilder &build, const RandomGen &base,
+                            const Point &p, Tick length, int runs,
+                            Row &r, vector<string> &columns) const
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        unique_ptr<RandomGen> gen(base.clone());
+        gen->setStream(p.getIndex());
+        RandomGen *old = RandomVar::changeGenerator(gen.get());
+
+        try {
+            // destroyed before the context
+            shared_ptr<void> model = build(p);
+            Simulation &s = ctx.simulation();
+            Watchdog dog(_budget, 1);
+            if (dog.active()) s.addStopPredicate([&dog]() { return dog.check(); });
+
+            s.initRuns(runs);
+            int done = 0;
+            while (done < runs && !dog.tripped()) {
+                s.initSingleRun();
+                s.runCycle(length);
+                dog.endRun();
+                s.endSingleRun();
+                ++done;
+            }
+            s.endSim();
+
+            r.stopped = dog.tripped();
+            readRow(p, done, r, columns);
+        } catch (...) {
+            RandomVar::changeGenerator(old);
+            throw;
+        }
+        RandomVar::changeGenerator(old);
+    }
+
+    bool Campaign::runSplit(const ModelBuilder &build, const RandomGen &base,
+                            const Point &p, Tick length, int rep, SplitPoint &s,
+                            mutex &m, Row &r, vector<string> &columns) const
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        unique_ptr<RandomGen> gen(base.clone());
+        gen->setStream(p.getIndex(), rep);
+        RandomGen *old = RandomVar::changeGenerator(gen.get());
+
+        bool last = false;
+        try {
+            shared_ptr<void> model = build(p);
+            Simulation &sim = ctx.simulation();
+            Watchdog dog(_budget, int(s.runs.size()));
+            if (dog.active()) sim.addStopPredicate([&dog]() { return dog.check(); });
+
+            sim.initRuns(1);
+            sim.initSingleRun();
+            sim.runCycle(length);
+            sim.endSingleRun();
+            sim.endSim();
+
+            vector<double> v;
+            BaseStat::getLastRun(v);
+            vector<vector<double> > all;
+            {
+                lock_guard<mutex> l(m);
+                s.runs[rep].swap(v);
+                s.stopped = s.stopped || dog.tripped();
+                last = --s.left == 0;
+                if (last) all.swap(s.runs);
+            }
+            // the stats of this run take the values of all of them
+            if (last) {
+                BaseStat::mergeRuns(all);
+                r.stopped = s.stopped;
+                readRow(p, int(all.size()), r, columns);
+            }
+        } catch (...) {
+            RandomVar::changeGenerator(old);
+            throw;
+        }
+        RandomVar::changeGenerator(old);
+        return last;
+    }
+
+    void Campaign::simulate(const ModelBuilder &build, Tick length, int runs,
+                            int threads, const vector<size_t> &points, bool &first)
+    {
+        size_t n = points.size();
+        // the tasks: the points, or the runs of every point
+        size_t split = _splitRuns ? runs : 1;
+        size_t tasks = n * split;
+        if (threads <= 0) threads = Topology::get().getDefaultThreads();
+        if (size_t(threads) > tasks) threads = tasks;
+
+        const RandomGen &base = *RandomVar::getGenerator();
+
+        SplitPoint empty;
+        empty.runs.resize(runs);
+        empty.left = runs;
+        empty.stopped = false;
+        vector<SplitPoint> splits(_splitRuns ? n : 0, empty);
+        CostModel cost(split, threads, tasks);
+
+        atomic<size_t> next(0);
+        exception_ptr error;
+        mutex m;
+
+        // the tasks are taken in order, so the runs of a point are
+        // spread on the threads that are free
+        auto worker = [&](int id) {
+            Topology::Pin pin(id, _pinning);
+            for (size_t i = next++; i < tasks; i = next++) {
+                size_t j = i / split, k = points[j];
+                try {
+                    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+                    Row r;
+                    vector<string> columns;
+                    bool done = true;
+                    if (_splitRuns)
+                        done = runSplit(build, base, getPoint(k), length, 
+                                        int(i % split), splits[j], m, r, columns);
+                    else
+                        runPoint(build, base, getPoint(k), length, runs, r, columns);
+                    double secs = chrono::duration<double>(chrono::steady_clock::now() - 
+                                                           t0).count();
+
+                    bool ok = true;
+                    {
+                        lock_guard<mutex> l(m);
+                        if (done) ok = addRow(k, r, columns, first);
+                        cost.add(j, secs);
+                        if (_progress) _progress(cost.get());
+                    }
+                    if (!ok) throw Exc("The points have different stats");
+                } catch (...) {
+                    lock_guard<mutex> l(m);
+                    if (!error) error = current_exception();
+                }
+            }
+        };
+
+        vector<thread> pool;
+        for (int i = 1; i < threads; ++i) pool.push_back(thread(worker, i));
+        worker(0);
+        for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+
+        if (error) rethrow_exception(error);
+    }
+
+    void Campaign::run(const ModelBuilder &build, Tick length, int runs, int threads)
+    {
+        if (runs < 1) runs = 1;
+        if (runs == 2) runs = 3;
+
+        bool first = true;
+        vector<bool> done;
+        beginTable(length, runs, done, first);
+
+        vector<size_t> points;
+        for (size_t k = 0; k < done.size(); ++k) if (!done[k]) points.push_back(k);
+        simulate(build, length, runs, threads, points, first);
+    }
+
+    size_t Campaign::runAdaptive(const ModelBuilder &build, Tick length,
+                                 const string &column, size_t budget,
+                                 double tol, int runs, int threads)
+    {
+        if (runs < 1) runs = 1;
+        if (runs == 2) runs = 3;
+        if (threads <= 0) threads = Topology::get().getDefaultThreads();
+
+        bool first = true;
+        vector<bool> done;
+        beginTable(length, runs, done, first);
+
+        // point k has index idx[d] along parameter d, with
+        // k = sum(idx[d] * stride[d]) (the last parameter varies first)
+        size_t nd = _values.size();
+        vector<size_t> len(nd), stride(nd), step(nd);
+        size_t n = 1;
+        for (size_t d = nd; d-- > 0; ) {
+            len[d] = _values[d].size();
+            stride[d] = n;
+            n *= len[d];
+        }
+
+        // the coarse grid: the steps are powers of two, halved
+        // while the grid takes at most a fourth of the budget
+        for (size_t d = 0; d < nd; ++d) {
+            step[d] = 1;
+            while (2 * step[d] < len[d]) step[d] *= 2;
+        }
+        auto coarse = [&](size_t d, size_t i) {
+            return i % step[d] == 0 || i + 1 == len[d];
+        };
+        auto coarseSize = [&]() {
+            size_t c = 1;
+            for (size_t d = 0; d < nd; ++d) 
+                c *= (len[d] - 1) / step[d] + 1 + ((len[d] - 1) % step[d] != 0);
+            return c;
+        };
+        for (bool halved = true; halved; ) {
+            halved = false;
+            for (size_t d = 0; d < nd; ++d) {
+                if (step[d] == 1) continue;
+                step[d] /= 2;
+                if (coarseSize() * 4 > budget) step[d] *= 2;
+                else halved = true;
+            }
+        }
+
+        vector<size_t> points;
+        for (size_t k = 0; k < n; ++k) {
+            bool in = true;
+            for (size_t d = 0; d < nd && in; ++d) 
+                in = coarse(d, k / stride[d] % len[d]);
+            if (in && !done[k]) points.push_back(k);
+        }
+        if (points.size() > budget) points.resize(budget);
+        simulate(build, length, runs, threads, points, first);
+        size_t used = points.size();
+        for (size_t i = 0; i < points.size(); ++i) done[points[i]] = true;
+
+        size_t col = find(_columns.begin(), _columns.end(), column) - _columns.begin();
+        if (col == _columns.size()) throw Exc("Unknown stat " + column);
+
+        vector<pair<double, size_t> > cand;
+        while (used < budget) {
+            // the middle of each interval between two neighbours
+            cand.clear();
+            for (size_t a = 0; a < n; ++a) {
+                if (!done[a]) continue;
+                const Row &ra = _table[a];
+                for (size_t d = 0; d < nd; ++d) {
+                    size_t i = a / stride[d] % len[d], j = i + 1;
+                    while (j < len[d] && !done[a + (j - i) * stride[d]]) ++j;
+                    if (j == len[d] || j == i + 1) continue;
+
+                    const Row &rb = _table[a + (j - i) * stride[d]];
+                    double score = fabs(ra.values[col] - rb.values[col]) +
+                        max(ra.conf[col], rb.conf[col]);
+                    if (score > tol) 
+                        cand.push_back(make_pair(score, a + (j - i) / 2 * stride[d]));
+                }
+            }
+            if (cand.empty()) break;
+
+            // the highest scores first, each point once
+            sort(cand.begin(), cand.end(), 
+                 [](const pair<double, size_t> &x, const pair<double, size_t> &y) {
+                     return x.first > y.first || (x.first == y.first && x.second < y.second);
+                 });
+            points.clear();
+            size_t batch = min(size_t(threads), budget - used);
+            for (size_t i = 0; i < cand.size() && points.size() < batch; ++i)
+                if (find(points.begin(), points.end(), cand[i].second) == points.end())
+                    points.push_back(cand[i].second);
+
+            simulate(build, length, runs, threads, points, first);
+            used += points.size();
+            for (size_t i = 0; i < points.size(); ++i) done[points[i]] = true;
+        }
+        return used;
+    }
+
+    bool Campaign::addRow(size_t k, const Row &r, const vector<string> &columns,
+                          bool &first)
+    {
+        if (first) {
+            _columns = columns;
+            if (_out) printHeader(*_out);
+            first = false;
+        }
+        if (columns != _columns) return false;
+        _table[k] = r;
+        if (r.stopped) _stopped++;
+        if (_out) printRow(*_out, r);
+        if (_store) storeRow(k, r);
+        return true;
+    }
+
+    namespace {
+        // FNV-1a: the same on every run, unlike std::hash
+        void mix(uint64_t &h, const void *p, size_t n)
+        {
+            const unsigned char *c = static_cast<const unsigned char *>(p);
+            for (size_t i = 0; i < n; ++i) {
+                h ^= c[i];
+                h *= 1099511628211ULL;
+            }
+        }
+
+        void mix(uint64_t &h, const string &s)
+        {
+            uint64_t n = s.size();
+            mix(h, &n, sizeof(n));
+            mix(h, s.data(), s.size());
+        }
+    }
+
+    uint64_t Campaign::getKey(const Point &p, Tick length, int runs) const
+    {
+        uint64_t h = 14695981039346656037ULL;
+        mix(h, _model);
+        for (size_t i = 0; i < _files.size(); ++i) {
+            ifstream f(_files[i].c_str(), ios::binary);
+            if (!f.is_open()) throw Exc("Cannot open " + _files[i]);
+            mix(h, string(istreambuf_iterator<char>(f), istreambuf_iterator<char>()));
+        }
+        for (size_t i = 0; i < _names.size(); ++i) {
+            mix(h, _names[i]);
+            double v = p[i];
+            mix(h, &v, sizeof(v));
+        }
+        int64_t l = int64_t(length);
+        mix(h, &l, sizeof(l));
+        mix(h, &runs, sizeof(runs));
+        // the runs split in tasks use other substreams
+        if (_splitRuns && runs > 1) mix(h, "split");
+
+        // the generator, by its first numbers on the stream of the point
+        unique_ptr<RandomGen> g(RandomVar::getGenerator()->clone());
+        int32_t type = g->getType();
+        mix(h, &type, sizeof(type));
+        g->setStream(p.getIndex());
+        for (int i = 0; i < 4; ++i) {
+            RandNum x = g->sample();
+            mix(h, &x, sizeof(x));
+        }
+        return h;
+    }
+
+    void Campaign::beginTable(Tick length, int runs, vector<bool> &done, bool &first)
+    {
+        size_t n = size();
+        _table.assign(n, Row());
+        _columns.clear();
+        done.assign(n, false);
+        _cached = 0;
+        _stopped = 0;
+        _keys.clear();
+        if (!_caching) return;
+        if (!_store) throw Exc("The cache needs a result store");
+
+        unordered_map<uint64_t, size_t> rows;
+        vector<vector<double> > stored;
+        _store->readRows(stored);
+        const vector<string> &cols = _store->getColumns();
+        size_t np = _names.size();
+        if (!stored.empty()) {
+            if (cols.size() < np + 2 || cols[np] != "key.hi" || cols[np + 1] != "key.lo")
+                throw Exc("The result store has no keys");
+            for (size_t i = 0; i < stored.size(); ++i) {
+                uint64_t key = (uint64_t(stored[i][np]) << 32) | uint64_t(stored[i][np + 1]);
+                rows[key] = i;
+            }
+        }
+
+        _keys.resize(n);
+        for (size_t k = 0; k < n; ++k) {
+            Point p = getPoint(k);
+            _keys[k] = getKey(p, length, runs);
+            unordered_map<uint64_t, size_t>::iterator it = rows.find(_keys[k]);
+            if (it == rows.end()) continue;
+
+            const vector<double> &s = stored[it->second];
+            if (first) {
+                _columns.clear();
+                for (size_t i = np + 2; i < cols.size(); i += 2) 
+                    _columns.push_back(cols[i]);
+                if (_out) printHeader(*_out);
+                first = false;
+            }
+            Row &r = _table[k];
+            r.params = p.getValues();
+            for (size_t i = np + 2; i + 1 < s.size(); i += 2) {
+                r.values.push_back(s[i]);
+                r.conf.push_back(s[i + 1]);
+            }
+            if (_out) printRow(*_out, r);
+            done[k] = true;
+            _cached++;
+        }
+    }
+
+    void Campaign::printHeader(ostream &os) const
+    {
+        for (size_t i = 0; i < _names.size(); ++i) os << _names[i] << ",";
+        for (size_t i = 0; i < _columns.size(); ++i) 
+            os << _columns[i] << (i + 1 < _columns.size() ? "," : "");
+        os << endl;
+    }
+
+    void Campaign::printRow(ostream &os, const Row &r) const
+    {
+        for (size_t i = 0; i < r.params.size(); ++i) os << r.params[i] << ",";
+        for (size_t i = 0; i < r.values.size(); ++i) 
+            os << r.values[i] << (i + 1 < r.values.size() ? "," : "");
+        os << endl;
+    }
+
+    void Campaign::storeRow(size_t k, const Row &r)
+    {
+        // simulated again the next time
+        if (_caching && r.stopped) return;
+
+        // checks the columns of an existing file
+        vector<string> columns(_names);
+        if (_caching) {
+            columns.push_back("key.hi");
+            columns.push_back("key.lo");
+        }
+        for (size_t i = 0; i < _columns.size(); ++i) {
+            columns.push_back(_columns[i]);
+            columns.push_back(_columns[i] + ".ci");
+        }
+        _store->setColumns(columns);
+
+        vector<double> row(r.params);
+        if (_caching) {
+            row.push_back(double(_keys[k] >> 32));
+            row.push_back(double(_keys[k] & 0xffffffffULL));
+        }
+        for (size_t i = 0; i < r.values.size(); ++i) {
+            row.push_back(r.values[i]);
+            row.push_back(r.conf[i]);
+        }
+        _store->append(row);
+    }
+
+    void Campaign::print(ostream &os) const
+    {
+        printHeader(os);
+        for (size_t k = 0; k < _table.size(); ++k) 
+            if (!_table[k].params.empty()) printRow(os, _table[k]);
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,462 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CAMPAIGN_HPP__
+#define __CAMPAIGN_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class RandomGen;
+    class ResultStore;
+
+    /**
+       \ingroup metasim_ee
+
+       A simulation campaign: the same model simulated on every
+       point of a grid of parameters (the cartesian product of the
+       values of each parameter).
+
+       Each point is simulated in its own context (see SimContext)
+       by a pool of threads: the builder creates the model for the
+       point in the current context, and returns the object that
+       owns it. For short points, the builder can instead create
+       the model in the arena of the context (see
+       SimContext::arena()) and return an empty pointer: the
+       model is then released at once with the context. Point k uses stream k of a copy of the standard
+       generator (see RandomGen::setStream()), so the results do
+       not depend on the number of threads; for large campaigns,
+       choose a generator with many streams (XOSHIRO256 or PCG32).
+
+       The result of a point is the mean, over the runs, of every
+       stat object created by the builder, in creation order. The
+       results are collected in a table, in the order of the
+       points, and they can be streamed to an output (as comma
+       separated values, in the order in which the points
+       terminate) while the campaign runs.
+
+       <pre>
+       Campaign c;
+       c.addParameter("U", 0.5, 0.95, 0.05);
+       c.addParameter("N", {4, 8, 16});
+       c.setOutput(&cout);
+       c.run([](const Campaign::Point &p) {
+           auto m = std::make_shared<Model>(p["U"], int(p["N"]));
+           return std::shared_ptr<void>(m);
+       }, 100000);
+       </pre>
+
+       A campaign can also be spread over the nodes of a cluster
+       (POSIX only), through a simple work queue on TCP: the
+       coordinator holds the grid and the table, and hands out
+       the points to the workers, one node each, which simulate
+       them on their own pool of threads and send back the rows.
+       The runs of a point are simulated on the same node, so its
+       stats are merged there and only the rows travel. The files
+       the model needs (e.g. model images, see ModelImage, or
+       PDF files) are shipped once to each node, when it
+       connects.
+
+       <pre>
+       // on the coordinator
+       c.addFile("model.img");
+       c.listen(5555);
+       c.serve(100000, 10);
+
+       // on each node (e.g. started by the batch system)
+       Campaign w;
+       w.work("head-node", 5555, builder);
+       </pre>
+
+       A worker does not need the grid: it receives the names of
+       the parameters and the values of each point. The points
+       of a node that disconnects are handed out again. Point k
+       uses stream k of the standard generator of the worker,
+       as in run(), so the nodes must use the same generator
+       (the same program) and the same byte order.
+    */
+    class Campaign {
+    public:
+        /// A point of the grid: the value of each parameter
+        class Point {
+            const Campaign *_c;
+            size_t _index;
+            std::vector<double> _v;
+            friend class Campaign;
+        public:
+            /// Value of the parameter with the given name
+            double operator[](const std::string &name) const;
+            /// Value of the i-th parameter
+            double operator[](size_t i) const { return _v[i]; }
+            /// Index of the point in the grid
+            size_t getIndex() const { return _index; }
+            const std::vector<double> &getValues() const { return _v; }
+        };
+
+        typedef std::function<std::shared_ptr<void> (const Point &)> ModelBuilder;
+
+        /// The results of a point
+        struct Row {
+            /// the parameters of the point (empty if the point has
+            /// not been simulated, see runAdaptive())
+            std::vector<double> params;
+            /// the mean of every stat
+            std::vector<double> values;
+            /// the confidence interval of every stat (0 with less
+            /// than 3 runs)
+            std::vector<double> conf;
+            /// true if the point exceeded its budget (see
+            /// setBudget()): the values are those of the runs
+            /// completed until then, the last one stopped early
+            bool stopped;
+
+            Row() : params(), values(), conf(), stopped(false) {}
+        };
+
+        /**
+           The limits of the simulation of a point (see
+           setBudget()); 0 means no limit.
+        */
+        struct Budget {
+            /// events processed (batches, with batch stepping)
+            uint64_t events;
+            /// wall-clock seconds
+            double seconds;
+            /// simulated ticks per wall-clock second, at least,
+            /// once the point has run for grace seconds
+            double minRate;
+            double grace;
+
+            Budget() : events(0), seconds(0), minRate(0), grace(1) {}
+        };
+
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "Campaign", "campaign.cpp") {}
+        };
+
+        Campaign();
+
+        ~Campaign();
+
+        /// Adds a parameter, with the list of its values
+        void addParameter(const std::string &name, const std::vector<double> &values);
+
+        /// Adds a parameter with values from, from + step, ... up to to
+        void addParameter(const std::string &name, double from, double to, double step);
+
+        /// Number of points of the grid
+        size_t size() const;
+
+        /// The i-th point of the grid (the last parameter varies first)
+        Point getPoint(size_t i) const;
+
+        /**
+           Writes each row on out (NULL to disable) as soon as its
+           point has been simulated, preceded by a header.
+        */
+        void setOutput(std::ostream *out) { _out = out; }
+
+        /**
+           Appends each row to store (NULL to disable) as soon as
+           its point has been simulated: the columns are the
+           parameters, then the mean ("<stat>") and the confidence
+           interval ("<stat>.ci") of each stat.
+        */
+        void setStore(ResultStore *store) { _store = store; }
+
+        /**
+           Caches the results of the points in the store (see
+           setStore()): run() and serve() skip the points whose
+           row is already there, and take it from the store.
+
+           A row is found by a key, the hash of the model, of the
+           point and of the configuration of its runs: model (a
+           name or a version of the model, chosen by the user),
+           the content of the files added with addFile(), the
+           names and the values of the parameters, the length
+           and the number of runs, the type of the standard
+           generator and its stream for the point. The key is
+           stored in two more columns after the parameters
+           ("key.hi" and "key.lo", 32 bits each), so a store
+           written without the cache cannot be used.
+
+           Since every point uses its own stream of the
+           generator, a cached row is the row that the point
+           would have again: a different model must have a
+           different name.
+        */
+        void cacheResults(const std::string &model) 
+            { _caching = true; _model = model; }
+
+        /**
+           Pins the threads of run() and work() to the processors,
+           spread over the NUMA nodes, as Simulation::setPinning().
+        */
+        void setPinning(bool b) { _pinning = b; }
+
+        /**
+           Simulates the runs of each point as separate tasks (in
+           run() and runAdaptive()), instead of all of them on the
+           thread that takes the point: when a few points cost much
+           more than the others (e.g. the overloaded
+           configurations), the threads left idle at the end of the
+           campaign share their runs. Each run builds its own
+           model, and run r of point k uses substream r of stream k
+           of the generator, so the results do not depend on the
+           number of threads, but they differ from those of the
+           campaign without splitting (except with one run per
+           point).
+        */
+        void setSplitRuns(bool b) { _splitRuns = b; }
+
+        /**
+           Limits the simulation of each point, so that a point
+           that diverges (e.g. a preemption storm that makes the
+           time crawl) does not hold a thread for ever. The
+           limits are checked by a stop predicate of the
+           simulation of the point (see
+           Simulation::addStopPredicate()), which reads the clock
+           only every 1024 events. A point that exceeds one of
+           them is stopped as with Simulation::stop(): its stats
+           are finalized with the values collected so far, its
+           runs left are not simulated, and its row is flagged
+           (see Row::stopped and getStoppedPoints()). With
+           setSplitRuns(), each run has its share of the events
+           and of the time.
+
+           The flagged rows are printed and stored as the others,
+           except with the cache (see cacheResults()): then they
+           are not stored, and they are simulated again the next
+           time. In a distributed campaign, the budget is the one
+           of the workers.
+        */
+        void setBudget(const Budget &b) { _budget = b; }
+        const Budget &getBudget() const { return _budget; }
+
+        /// Number of points stopped by the budget in the last run
+        size_t getStoppedPoints() const { return _stopped; }
+
+        /// The progress of a campaign (see setProgress())
+        struct Progress {
+            /// the tasks (points, or runs with setSplitRuns()) completed
+            size_t done;
+            size_t total;
+            /// seconds since the start, and estimated to the end
+            double elapsed, eta;
+        };
+
+        /**
+           Calls f after each task of run() and runAdaptive() (from
+           the threads of the pool, one at a time). The time to the
+           end is estimated from the wall-clock cost of the tasks
+           completed so far: the runs left of a point expected to
+           cost as its completed runs, the other tasks as the mean
+           of all the completed ones, spread on the threads.
+        */
+        void setProgress(const std::function<void (const Progress &)> &f) 
+            { _progress = f; }
+
+        /// Number of points taken from the cache by the last run
+        size_t getCachedPoints() const { return _cached; }
+
+        /// The key of point p in the cache (see cacheResults())
+        uint64_t getKey(const Point &p, Tick length, int runs) const;
+
+        /**
+           Simulates all the points. The first exception raised
+           by a point is re-thrown after all threads have
+           terminated.
+
+           @param build The model builder
+           @param length Length of each simulation run
+           @param runs Number of runs of each point
+           @param threads Number of threads (0 means one for each
+           processor that the process may use, see Topology)
+        */
+        void run(const ModelBuilder &build, Tick length, int runs = 1, int threads = 0);
+
+        /**
+           Simulates only some points of the grid, where the
+           results change: the grid is the finest one, and it is
+           first sampled coarsely (the first and the last value of
+           each parameter, and a few evenly spaced ones, using at
+           most a fourth of the budget). Then, between two
+           simulated points that are neighbours along a parameter,
+           the variation of the stat called column (the difference
+           of its means, plus the larger of their confidence
+           intervals) is the score of the point in the middle: the
+           points with the highest score are simulated, a batch at
+           a time (one point for each thread), until budget points
+           have been simulated or no score exceeds tol. A boundary
+           (e.g. a miss ratio going from 0 to 1) is then followed
+           at the resolution of the grid, while the flat regions
+           are left coarse.
+
+           A point has the same results as with run() (it uses
+           the same stream), and the rows of the points that are
+           not simulated have no params. The points taken from
+           the cache (see cacheResults()) are not counted in the
+           budget.
+
+           @returns the number of points simulated
+
+           @throws Exc if there is no stat called column
+        */
+        size_t runAdaptive(const ModelBuilder &build, Tick length,
+                           const std::string &column, size_t budget,
+                           double tol = 0, int runs = 1, int threads = 0);
+
+        /// @name Distributed campaigns
+        //@{
+        /**
+           Ships file (by its base name) to every worker, before
+           its first point.
+        */
+        void addFile(const std::string &file) { _files.push_back(file); }
+
+        /**
+           The directory where a worker writes the files shipped
+           by the coordinator (by default, the current one). A
+           file already there with the same content is not
+           written again.
+        */
+        void setCacheDir(const std::string &dir) { _cacheDir = dir; }
+
+        /**
+           Opens the coordinator on port (0 chooses a free one),
+           and returns the port.
+
+           @throws Exc if the port cannot be opened
+        */
+        int listen(int port = 0);
+
+        /**
+           Simulates all the points on the workers connected to
+           the port opened by listen(), as run(), and closes the
+           port. It returns when all the points have their row:
+           the points of a worker that disconnects are handed out
+           again, and new workers can connect at any time.
+
+           @throws Exc if a point raised an exception on a worker,
+           after all the points have been simulated
+        */
+        void serve(Tick length, int runs = 1);
+
+        /**
+           Connects to the coordinator on host:port, and simulates
+           the points that it hands out, on threads threads (0
+           means one for each processor, see Topology), until they are
+           over. Returns the number of points simulated by this
+           node.
+
+           @throws Exc if the coordinator cannot be reached
+        */
+        size_t work(const std::string &host, int port, 
+                    const ModelBuilder &build, int threads = 0);
+        //@}
+
+        /// Names of the parameters
+        const std::vector<std::string> &getParameters() const { return _names; }
+
+        /// Names of the stats (the columns of the values)
+        const std::vector<std::string> &getColumns() const { return _columns; }
+
+        /// The results, one row for each point
+        const std::vector<Row> &getTable() const { return _table; }
+
+        /// Prints the whole table (the simulated points) as comma separated values
+        void print(std::ostream &os) const;
+
+    private:
+        std::vector<std::string> _names;
+        std::vector<std::vector<double> > _values;
+        std::vector<std::string> _columns;
+        std::vector<Row> _table;
+        std::ostream *_out;
+        ResultStore *_store;
+        std::vector<std::string> _files;
+        std::string _cacheDir;
+        int _listenFd;
+        bool _caching;
+        bool _pinning;
+        bool _splitRuns;
+        std::function<void (const Progress &)> _progress;
+        std::string _model;
+        size_t _cached;
+        Budget _budget;
+        size_t _stopped;
+        /// the key of every point, with the cache
+        std::vector<uint64_t> _keys;
+
+        void storeRow(size_t k, const Row &r);
+
+        /**
+           starts a run of n points: fills the rows found in the
+           cache, and marks them in done
+        */
+        void beginTable(Tick length, int runs, std::vector<bool> &done, 
+                        bool &first);
+        /**
+           adds the row of point k to the table and to the
+           outputs (the columns of the first row are the header);
+           false if the columns differ from the first ones
+        */
+        bool addRow(size_t k, const Row &r, const std::vector<std::string> &columns,
+                    bool &first);
+        void printHeader(std::ostream &os) const;
+        void printRow(std::ostream &os, const Row &r) const;
+
+        /// simulates the given points (with runs already adjusted)
+        void simulate(const ModelBuilder &build, Tick length, int runs,
+                      int threads, const std::vector<size_t> &points, 
+                      bool &first);
+
+        /// simulates point p in a new context
+        void runPoint(const ModelBuilder &build, const RandomGen &base,
+                      const Point &p, Tick length, int runs, 
+                      Row &r, std::vector<std::string> &columns) const;
+
+        /// the runs of a point split in tasks (see setSplitRuns())
+        struct SplitPoint {
+            /// the values of the stats in each completed run
+            std::vector<std::vector<double> > runs;
+            int left;
+            /// true if a run exceeded its budget
+            bool stopped;
+        };
+
+        /**
+           simulates run rep of point p in a new context, and
+           stores its values in s (with m locked); the last run of
+           the point fills r, and returns true
+        */
+        bool runSplit(const ModelBuilder &build, const RandomGen &base,
+                      const Point &p, Tick length, int rep, SplitPoint &s,
+                      std::mutex &m, Row &r, std::vector<std::string> &columns) const;
+    };
+
+} // namespace MetaSim
+
+#endif
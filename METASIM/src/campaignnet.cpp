@@ -0,0 +1,465 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <campaign.hpp>
+#include <randomvar.hpp>
+#include <topology.hpp>
+
+// The work queue of a distributed campaign. Every message is a
+// header (type, length of the payload, as uint32_t) and a payload
+// of plain values in the byte order of the machine:
+//
+// coordinator -> worker
+//   HELLO   length, runs, names of the parameters, files (name, content)
+//   POINT   index, values of the parameters
+//   DONE    no more points
+// worker -> coordinator
+//   REQUEST a thread is free
+//   RESULT  index, columns, values, confidence intervals
+//   FAILED  index, message of the exception
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        enum Msg { HELLO = 1, POINT, DONE, REQUEST, RESULT, FAILED };
+
+        class Buffer {
+        public:
+            string data;
+            size_t pos;
+
+            Buffer() : data(), pos(0) {}
+
+            template <class T> void put(const T &x) {
+                data.append(reinterpret_cast<const char *>(&x), sizeof(T));
+            }
+            void putString(const string &s) {
+                put<uint64_t>(s.size());
+                data += s;
+            }
+            template <class T> T get() {
+                if (pos + sizeof(T) > data.size())
+                    throw Campaign::Exc("Truncated message");
+                T x;
+                memcpy(&x, data.data() + pos, sizeof(T));
+                pos += sizeof(T);
+                return x;
+            }
+            string getString() {
+                uint64_t n = get<uint64_t>();
+                if (pos + n > data.size()) throw Campaign::Exc("Truncated message");
+                string s(data, pos, n);
+                pos += n;
+                return s;
+            }
+        };
+
+#ifndef _WIN32
+        void sendAll(int fd, const char *p, size_t n)
+        {
+            while (n > 0) {
+                ssize_t k = ::send(fd, p, n, MSG_NOSIGNAL);
+                if (k <= 0) throw Campaign::Exc("Connection lost");
+                p += k;
+                n -= k;
+            }
+        }
+
+        bool recvAll(int fd, char *p, size_t n)
+        {
+            while (n > 0) {
+                ssize_t k = ::recv(fd, p, n, 0);
+                if (k <= 0) return false;
+                p += k;
+                n -= k;
+            }
+            return true;
+        }
+
+        void sendMsg(int fd, uint32_t type, const Buffer &b = Buffer())
+        {
+            uint32_t h[2] = {type, uint32_t(b.data.size())};
+            string m(reinterpret_cast<const char *>(h), sizeof(h));
+            m += b.data;
+            sendAll(fd, m.data(), m.size());
+        }
+
+        /// false if the connection was closed
+        bool recvMsg(int fd, uint32_t &type, Buffer &b)
+        {
+            uint32_t h[2];
+            if (!recvAll(fd, reinterpret_cast<char *>(h), sizeof(h))) return false;
+            type = h[0];
+            b.data.resize(h[1]);
+            b.pos = 0;
+            return h[1] == 0 || recvAll(fd, &b.data[0], h[1]);
+        }
+
+        string baseName(const string &f)
+        {
+            size_t i = f.find_last_of('/');
+            return i == string::npos ? f : f.substr(i + 1);
+        }
+
+        string readFile(const string &name)
+        {
+            ifstream f(name.c_str(), ios::binary);
+            if (!f.is_open()) throw Campaign::Exc("Cannot open " + name);
+            return string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+        }
+
+        /// writes content in name, unless it is already there
+        void cacheFile(const string &name, const string &content)
+        {
+            {
+                ifstream f(name.c_str(), ios::binary);
+                if (f.is_open() &&
+                    string(istreambuf_iterator<char>(f), istreambuf_iterator<char>()) == content)
+                    return;
+            }
+            ofstream f(name.c_str(), ios::binary | ios::trunc);
+            f.write(content.data(), content.size());
+            if (!f) throw Campaign::Exc("Cannot write " + name);
+        }
+
+        /// a worker node, seen from the coordinator
+        struct Node {
+            int fd;
+            /// the points handed out and not returned yet
+            vector<size_t> points;
+            /// the requests that wait for a point
+            int waiting;
+        };
+#endif
+    }
+
+    Campaign::~Campaign()
+    {
+#ifndef _WIN32
+        if (_listenFd >= 0) close(_listenFd);
+#endif
+    }
+
+#ifndef _WIN32
+    int Campaign::listen(int port)
+    {
+        if (_listenFd >= 0) close(_listenFd);
+        _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listenFd < 0) throw Exc("Cannot open a socket");
+
+        int one = 1;
+        setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in a;
+        memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_ANY);
+        a.sin_port = htons(port);
+        socklen_t len = sizeof(a);
+        if (::bind(_listenFd, (struct sockaddr *) &a, sizeof(a)) != 0 ||
+            ::listen(_listenFd, 64) != 0 ||
+            getsockname(_listenFd, (struct sockaddr *) &a, &len) != 0) {
+            close(_listenFd);
+            _listenFd = -1;
+            throw Exc("Cannot listen on the port");
+        }
+        return ntohs(a.sin_port);
+    }
+
+    void Campaign::serve(Tick length, int runs)
+    {
+        if (_listenFd < 0) throw Exc("serve() without listen()");
+        size_t n = size();
+        if (runs < 1) runs = 1;
+        if (runs == 2) runs = 3;
+
+        // sent to every node when it connects
+        Buffer hello;
+        hello.put<int64_t>(int64_t(length));
+        hello.put<int32_t>(runs);
+        hello.put<uint32_t>(_names.size());
+        for (size_t i = 0; i < _names.size(); ++i) hello.putString(_names[i]);
+        hello.put<uint32_t>(_files.size());
+        for (size_t i = 0; i < _files.size(); ++i) {
+            hello.putString(baseName(_files[i]));
+            hello.putString(readFile(_files[i]));
+        }
+
+        bool first = true;
+        vector<bool> cached;
+        beginTable(length, runs, cached, first);
+        string error;
+
+        deque<size_t> todo;
+        for (size_t k = 0; k < n; ++k) 
+            if (!cached[k]) todo.push_back(k);
+        size_t done = _cached;
+        vector<Node> nodes;
+        vector<struct pollfd> fds;
+
+        // hands out the waiting requests
+        auto dispatch = [&](Node &w) {
+            while (w.waiting > 0 && (!todo.empty() || done == n)) {
+                Buffer b;
+                if (done == n) sendMsg(w.fd, DONE);
+                else {
+                    size_t k = todo.front();
+                    todo.pop_front();
+                    b.put<uint64_t>(k);
+                    Point p = getPoint(k);
+                    for (size_t i = 0; i < p._v.size(); ++i) b.put<double>(p._v[i]);
+                    sendMsg(w.fd, POINT, b);
+                    w.points.push_back(k);
+                }
+                w.waiting--;
+            }
+        };
+
+        while (done < n) {
+            fds.clear();
+            struct pollfd l = {_listenFd, POLLIN, 0};
+            fds.push_back(l);
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                struct pollfd f = {nodes[i].fd, POLLIN, 0};
+                fds.push_back(f);
+            }
+            if (poll(&fds[0], fds.size(), -1) < 0) continue;
+
+            for (size_t i = nodes.size(); i-- > 0; ) {
+                if (fds[i + 1].revents == 0) continue;
+                Node &w = nodes[i];
+                uint32_t type;
+                Buffer b;
+                bool alive = false;
+                try {
+                    alive = recvMsg(w.fd, type, b);
+                    if (alive && type == REQUEST) {
+                        w.waiting++;
+                        dispatch(w);
+                    }
+                    else if (alive && (type == RESULT || type == FAILED)) {
+                        size_t k = b.get<uint64_t>();
+                        vector<size_t>::iterator it = find(w.points.begin(), w.points.end(), k);
+                        if (it == w.points.end()) throw Exc("Unexpected point");
+                        w.points.erase(it);
+                        if (type == FAILED) {
+                            if (error.empty()) error = b.getString();
+                        }
+                        else {
+                            Row r;
+                            vector<string> columns(b.get<uint32_t>());
+                            for (size_t j = 0; j < columns.size(); ++j)
+                                columns[j] = b.getString();
+                            r.params = getPoint(k).getValues();
+                            for (size_t j = 0; j < columns.size(); ++j)
+                                r.values.push_back(b.get<double>());
+                            for (size_t j = 0; j < columns.size(); ++j)
+                                r.conf.push_back(b.get<double>());
+                            r.stopped = b.get<uint8_t>() != 0;
+                            if (!addRow(k, r, columns, first) && error.empty())
+                                error = "The points have different stats";
+                        }
+                        done++;
+                    }
+                    else alive = false;
+                } catch (Exc &) {
+                    alive = false;
+                }
+                if (!alive) {
+                    // its points go back to the queue
+                    for (size_t j = 0; j < w.points.size(); ++j) todo.push_front(w.points[j]);
+                    close(w.fd);
+                    nodes.erase(nodes.begin() + i);
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(_listenFd, 0, 0);
+                if (fd >= 0) {
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    try {
+                        sendMsg(fd, HELLO, hello);
+                        Node w = {fd, vector<size_t>(), 0};
+                        nodes.push_back(w);
+                    } catch (Exc &) {
+                        close(fd);
+                    }
+                }
+            }
+
+            // the points given back, or the end
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                try {
+                    dispatch(nodes[i]);
+                } catch (Exc &) {
+                    // noticed at the next poll
+                }
+            }
+        }
+
+        for (size_t i = 0; i < nodes.size(); ++i) close(nodes[i].fd);
+        close(_listenFd);
+        _listenFd = -1;
+
+        if (!error.empty()) throw Exc(error);
+    }
+
+    size_t Campaign::work(const string &host, int port, const ModelBuilder &build,
+                          int threads)
+    {
+        if (threads <= 0) threads = Topology::get().getDefaultThreads();
+
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        ostringstream ps;
+        ps << port;
+        if (getaddrinfo(host.c_str(), ps.str().c_str(), &hints, &res) != 0)
+            throw Exc("Unknown host " + host);
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int ok = fd >= 0 ? connect(fd, res->ai_addr, res->ai_addrlen) : -1;
+        freeaddrinfo(res);
+        if (ok != 0) {
+            if (fd >= 0) close(fd);
+            throw Exc("Cannot connect to " + host);
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        uint32_t type;
+        Buffer hello;
+        if (!recvMsg(fd, type, hello) || type != HELLO) {
+            close(fd);
+            throw Exc("No campaign on " + host);
+        }
+        Tick length = hello.get<int64_t>();
+        int runs = hello.get<int32_t>();
+        _names.assign(hello.get<uint32_t>(), string());
+        for (size_t i = 0; i < _names.size(); ++i) _names[i] = hello.getString();
+        uint32_t files = hello.get<uint32_t>();
+        for (uint32_t i = 0; i < files; ++i) {
+            string name = hello.getString();
+            cacheFile(_cacheDir + "/" + name, hello.getString());
+        }
+
+        const RandomGen &base = *RandomVar::getGenerator();
+        // a request and its answer go together, under request;
+        // the messages are sent under out, so that the results
+        // are sent while another thread waits for a point
+        mutex request, out;
+        size_t count = 0;
+        bool over = false;
+
+        auto worker = [&](int id) {
+            Topology::Pin pin(id, _pinning);
+            for (;;) {
+                Point p;
+                {
+                    lock_guard<mutex> l(request);
+                    if (over) return;
+                    Buffer b;
+                    try {
+                        {
+                            lock_guard<mutex> o(out);
+                            sendMsg(fd, REQUEST);
+                        }
+                        if (!recvMsg(fd, type, b) || type != POINT) {
+                            over = true;
+                            return;
+                        }
+                    } catch (Exc &) {
+                        over = true;
+                        return;
+                    }
+                    p._c = this;
+                    p._index = b.get<uint64_t>();
+                    p._v.resize(_names.size());
+                    for (size_t i = 0; i < p._v.size(); ++i) p._v[i] = b.get<double>();
+                }
+
+                Buffer r;
+                r.put<uint64_t>(p.getIndex());
+                uint32_t t = RESULT;
+                try {
+                    Row row;
+                    vector<string> columns;
+                    runPoint(build, base, p, length, runs, row, columns);
+                    r.put<uint32_t>(columns.size());
+                    for (size_t i = 0; i < columns.size(); ++i) r.putString(columns[i]);
+                    for (size_t i = 0; i < row.values.size(); ++i) r.put<double>(row.values[i]);
+                    for (size_t i = 0; i < row.conf.size(); ++i) r.put<double>(row.conf[i]);
+                    r.put<uint8_t>(row.stopped);
+                } catch (std::exception &e) {
+                    t = FAILED;
+                    r.putString(e.what());
+                } catch (...) {
+                    t = FAILED;
+                    r.putString("Unknown exception");
+                }
+
+                lock_guard<mutex> o(out);
+                try {
+                    sendMsg(fd, t, r);
+                    count++;
+                } catch (Exc &) {
+                    return;
+                }
+            }
+        };
+
+        vector<thread> pool;
+        for (int i = 1; i < threads; ++i) pool.push_back(thread(worker, i));
+        worker(0);
+        for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+        close(fd);
+        return count;
+    }
+#else
+    int Campaign::listen(int)
+    {
+        throw Exc("Distributed campaigns are not supported");
+    }
+
+    void Campaign::serve(Tick, int)
+    {
+        throw Exc("Distributed campaigns are not supported");
+    }
+
+    size_t Campaign::work(const string &, int, const ModelBuilder &, int)
+    {
+        throw Exc("Distributed campaigns are not supported");
+    }
+#endif
+
+} // namespace MetaSim
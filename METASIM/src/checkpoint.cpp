@@ -0,0 +1,175 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+
+#include <basestat.hpp>
+#include <checkpoint.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+#include <simcontext.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    Checkpoint::Checkpoint() :
+        _ctx(0), _time(0), _counter(0), _events(), _gen(), _data(), _pos(0)
+    {
+    }
+
+    Checkpoint::~Checkpoint()
+    {
+    }
+
+    void Checkpoint::write(const void *p, size_t n)
+    {
+        const char *c = static_cast<const char *>(p);
+        _data.insert(_data.end(), c, c + n);
+    }
+
+    void Checkpoint::read(void *p, size_t n)
+    {
+        if (_pos + n > _data.size())
+            throw Exc("Reading past the end of the image");
+        memcpy(p, &_data[_pos], n);
+        _pos += n;
+    }
+
+    void Checkpoint::take(SimContext *ctx, Tick now)
+    {
+        _ctx = 0;
+        _events.clear();
+        _data.clear();
+
+        // only the standard generator goes in the image: a
+        // variable drawing from another one, or holding values
+        // drawn in advance, would not be restored
+        RandomGen *g = RandomVar::getGenerator();
+        for (set<RandomVar *>::iterator i = ctx->randomVars.begin();
+             i != ctx->randomVars.end(); ++i) {
+            RandomVar *r = *i;
+            if (r->_gen != g)
+                throw Exc("Cannot checkpoint a random variable with "
+                          "its own generator");
+            if (r->_feed != 0 || r->_bufPos < r->_buf.size())
+                throw Exc("Cannot checkpoint a random variable with "
+                          "prefetched values");
+        }
+
+        vector<Event *> v;
+        Event::getQueued(ctx, v);
+        for (size_t i = 0; i < v.size(); ++i) {
+            Event *e = v[i];
+            if (e->_disposable)
+                throw Exc("Cannot checkpoint a disposable event");
+            QueuedEvent q;
+            q.e = e;
+            q.time = e->_time;
+            q.lastTime = e->_lastTime;
+            q.priority = e->_priority;
+            q.stdPriority = e->_std_priority;
+            q.order = e->_order;
+            _events.push_back(q);
+        }
+        _counter = ctx->eventCounter;
+
+        const EntityRegistry::EntityVector &ents = ctx->entities.byID();
+        put(ctx->entities.size());
+        for (size_t i = 0; i < ents.size(); ++i) {
+            if (ents[i] == NULL) continue;
+            put(ents[i]->getID());
+            ents[i]->saveState(*this);
+        }
+
+        put(ctx->statList.size());
+        for (BaseStat::List::iterator i = ctx->statList.begin();
+             i != ctx->statList.end(); ++i)
+            (*i)->saveState(*this);
+        put(ctx->totalNumOfExp);
+        put(ctx->expNum);
+        put(ctx->endOfSim);
+        put(ctx->statInit);
+        put(ctx->transitory);
+
+        _gen.reset(RandomVar::getGenerator()->clone());
+
+        _time = now;
+        _ctx = ctx;
+    }
+
+    Tick Checkpoint::apply(SimContext *ctx)
+    {
+        if (_ctx == 0) throw Exc("Restoring an empty checkpoint");
+        if (_ctx != ctx)
+            throw Exc("Restoring a checkpoint in another context");
+
+        RandomGen *g = RandomVar::getGenerator();
+        if (g->getType() != _gen->getType())
+            throw Exc("The random generator has changed type");
+
+        // empty the queue: the events posted after the checkpoint
+        // are dropped (or disposed of)
+        Event::clearQueue(ctx);
+
+        for (size_t i = 0; i < _events.size(); ++i) {
+            const QueuedEvent &q = _events[i];
+            Event *e = q.e;
+            e->_time = q.time;
+            e->_lastTime = q.lastTime;
+            e->_priority = q.priority;
+            e->_std_priority = q.stdPriority;
+            e->_order = q.order;
+            e->_disposable = false;
+            e->refreshKey();
+            e->_lanePos = Event::NO_HANDLE;
+            ctx->eventQueue->insert(e);
+            e->_queueGen = ctx->queueGeneration;
+        }
+        ctx->eventCounter = _counter;
+
+        _pos = 0;
+        size_t n;
+        get(n);
+        for (size_t i = 0; i < n; ++i) {
+            int id;
+            get(id);
+            Entity *e = ctx->entities.get(id);
+            if (e == NULL)
+                throw Exc("An entity of the checkpoint has been destroyed");
+            e->loadState(*this);
+        }
+
+        get(n);
+        if (n != ctx->statList.size())
+            throw Exc("The stat objects have changed");
+        for (BaseStat::List::iterator i = ctx->statList.begin();
+             i != ctx->statList.end(); ++i)
+            (*i)->loadState(*this);
+        get(ctx->totalNumOfExp);
+        get(ctx->expNum);
+        get(ctx->endOfSim);
+        get(ctx->statInit);
+        get(ctx->transitory);
+
+        // the stats are off while their activation is queued
+        Event::activateStats(ctx, ctx->statActivation == 0 ||
+                             !ctx->statActivation->isInQueue());
+
+        g->assign(*_gen);
+
+        return _time;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,154 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CHECKPOINT_HPP__
+#define __CHECKPOINT_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class Event;
+    class RandomGen;
+    class SimContext;
+
+    /**
+       \ingroup metasim_ee
+
+       An in-memory image of the state of a simulation, taken by
+       Simulation::checkpoint() and brought back by
+       Simulation::restore(). It is meant to simulate a long
+       warm-up once, and then to branch several continuations from
+       the same point:
+
+       <pre>
+       SIMUL.initSingleRun();
+       SIMUL.run_to(warmup);
+       Checkpoint c;
+       SIMUL.checkpoint(c);
+       for (int i = 0; i < n; ++i) {
+           SIMUL.restore(c);
+           // change something in the model
+           SIMUL.run_to(horizon);
+       }
+       </pre>
+
+       The image contains the simulation time, the events in the
+       queue (with their time, priority and fifo order), the state
+       of the standard random generator, the state of every
+       statistical object (see BaseStat::saveState()) and the
+       state of every entity (see Entity::saveState()). Events
+       and entities are referred by address, so an image can only
+       be restored in the context where it has been taken, on the
+       same objects. Disposable events cannot be checkpointed.
+
+       An image is never partial: take() throws Exc if an entity
+       does not save its state, or if a random variable of the
+       context draws from a generator other than the standard
+       one, or holds prefetched values (see
+       RandomVar::setPrefetch()).
+
+       Entities and stats write their state with put() and
+       write(), and read it back, in the same order, with get()
+       and read().
+    */
+    class Checkpoint {
+        friend class Simulation;
+
+        struct QueuedEvent {
+            Event *e;
+            Tick time;
+            Tick lastTime;
+            int priority;
+            int stdPriority;
+            unsigned long order;
+        };
+
+        SimContext *_ctx;
+        Tick _time;
+        long _counter;
+        std::vector<QueuedEvent> _events;
+        std::unique_ptr<RandomGen> _gen;
+
+        std::vector<char> _data;
+        size_t _pos;
+
+        Checkpoint(const Checkpoint &);
+        Checkpoint &operator=(const Checkpoint &);
+
+        /// Fills the image from context ctx at time now
+        void take(SimContext *ctx, Tick now);
+
+        /// Restores the image and returns its time
+        Tick apply(SimContext *ctx);
+
+    public:
+        /**
+           \ingroup metasim_exc
+
+           Raised when an image cannot be taken or restored.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "Checkpoint", "checkpoint.cpp") {}
+        };
+
+        Checkpoint();
+        ~Checkpoint();
+
+        /// True if the object contains an image
+        bool isValid() const { return _ctx != 0; }
+
+        /// The simulation time of the image
+        Tick getTime() const { return _time; }
+
+        /// Size (in bytes) of the state of entities and stats
+        size_t size() const { return _data.size(); }
+
+        /// Appends n bytes to the image
+        void write(const void *p, size_t n);
+
+        /// Reads the next n bytes of the image
+        void read(void *p, size_t n);
+
+        template <class T>
+        void put(const T &x) { write(&x, sizeof(T)); }
+
+        template <class T>
+        void get(T &x) { read(&x, sizeof(T)); }
+
+        template <class T>
+        void put(const std::vector<T> &v) {
+            put(v.size());
+            if (!v.empty()) write(&v[0], v.size() * sizeof(T));
+        }
+
+        template <class T>
+        void get(std::vector<T> &v) {
+            size_t n;
+            get(n);
+            v.resize(n);
+            if (n > 0) read(&v[0], n * sizeof(T));
+        }
+    };
+
+} // namespace MetaSim
+
+#endif
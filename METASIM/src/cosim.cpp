@@ -0,0 +1,282 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cosim.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    namespace {
+        const char MAGIC[8] = {'M', 'S', 'C', 'O', 'S', 'I', 'M', '1'};
+        const size_t LINE = 64;
+        const size_t CLOCKS = LINE;
+        const size_t RINGS = 3 * LINE;
+        const size_t SLOTS = RINGS + 2 * sizeof(CoSimChannel::Ring);
+
+        bool powerOf2(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+    }
+
+    size_t CoSimChannel::bytes(size_t capacity)
+    {
+        return SLOTS + 2 * capacity * sizeof(CoSimSample);
+    }
+
+    CoSimChannel::CoSimChannel(const std::string &name, size_t capacity,
+                               bool create) :
+        _map(0), _len(bytes(capacity)), _capacity(capacity)
+    {
+        if (!powerOf2(capacity))
+            throw CoSimExc("the capacity must be a power of 2");
+#ifndef _WIN32
+        int fd = open(name.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR,
+                      0600);
+        if (fd < 0) throw CoSimExc("cannot open " + name);
+        struct stat st;
+        if ((create && ftruncate(fd, _len) != 0) ||
+            fstat(fd, &st) != 0 || size_t(st.st_size) < _len) {
+            close(fd);
+            throw CoSimExc(name + " is not a channel of this capacity");
+        }
+        void *m = mmap(0, _len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) throw CoSimExc("cannot map " + name);
+        _map = m;
+
+        if (create) init();
+        else if (memcmp(_map, MAGIC, sizeof(MAGIC)) != 0 ||
+                 static_cast<uint64_t *>(_map)[1] != capacity) {
+            munmap(_map, _len);
+            throw CoSimExc(name + " is not a channel of this capacity");
+        }
+#else
+        throw CoSimExc("shared memory channels are not supported");
+#endif
+    }
+
+    CoSimChannel::CoSimChannel(size_t capacity) :
+        _map(0), _len(bytes(capacity)), _capacity(capacity)
+    {
+        if (!powerOf2(capacity))
+            throw CoSimExc("the capacity must be a power of 2");
+#ifndef _WIN32
+        void *m = mmap(0, _len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) throw CoSimExc("cannot map an anonymous channel");
+        _map = m;
+#else
+        _map = ::operator new(_len);
+#endif
+        init();
+    }
+
+    CoSimChannel::~CoSimChannel()
+    {
+#ifndef _WIN32
+        munmap(_map, _len);
+#else
+        ::operator delete(_map);
+#endif
+    }
+
+    void CoSimChannel::init()
+    {
+        char *base = static_cast<char *>(_map);
+        memcpy(base, MAGIC, sizeof(MAGIC));
+        uint64_t cap = _capacity;
+        memcpy(base + sizeof(MAGIC), &cap, sizeof(cap));
+        for (int s = 0; s < 2; ++s) {
+            new (&clock(Side(s))) std::atomic<int64_t>(0);
+            Ring &r = ring(Side(s));
+            new (&r.head) std::atomic<uint64_t>(0);
+            new (&r.tail) std::atomic<uint64_t>(0);
+        }
+    }
+
+    std::atomic<int64_t> &CoSimChannel::clock(Side s)
+    {
+        return *reinterpret_cast<std::atomic<int64_t> *>(
+            static_cast<char *>(_map) + CLOCKS + s * LINE);
+    }
+
+    CoSimChannel::Ring &CoSimChannel::ring(Side s)
+    {
+        return reinterpret_cast<Ring *>(static_cast<char *>(_map) + RINGS)[s];
+    }
+
+    CoSimSample *CoSimChannel::slots(Side s)
+    {
+        return reinterpret_cast<CoSimSample *>(static_cast<char *>(_map) + SLOTS)
+            + s * _capacity;
+    }
+
+    CoSimPort::CoSimPort(CoSimChannel &ch, CoSimChannel::Side side) :
+        _ch(&ch), _side(side), _out(&ch.ring(side)),
+        _in(&ch.ring(CoSimChannel::Side(1 - side))),
+        _outSlots(ch.slots(side)), _inSlots(ch.slots(CoSimChannel::Side(1 - side))),
+        _mask(ch.getCapacity() - 1), _timeout(0)
+    {
+        _tail = _out->tail.load(std::memory_order_relaxed);
+        _peerHead = _out->head.load(std::memory_order_acquire);
+        _head = _in->head.load(std::memory_order_relaxed);
+    }
+
+    bool CoSimPort::send(const CoSimSample &s)
+    {
+        if (_tail - _peerHead > _mask) {
+            _peerHead = _out->head.load(std::memory_order_acquire);
+            if (_tail - _peerHead > _mask) return false;
+        }
+        _outSlots[_tail & _mask] = s;
+        ++_tail;
+        return true;
+    }
+
+    void CoSimPort::flush()
+    {
+        _out->tail.store(_tail, std::memory_order_release);
+    }
+
+    size_t CoSimPort::receive(std::vector<CoSimSample> &in)
+    {
+        uint64_t tail = _in->tail.load(std::memory_order_acquire);
+        size_t n = size_t(tail - _head);
+        for (; _head != tail; ++_head) in.push_back(_inSlots[_head & _mask]);
+        if (n > 0) _in->head.store(_head, std::memory_order_release);
+        return n;
+    }
+
+    void CoSimPort::publish(int64_t t)
+    {
+        flush();
+        _ch->clock(_side).store(t, std::memory_order_release);
+    }
+
+    int64_t CoSimPort::peerTime() const
+    {
+        return _ch->clock(CoSimChannel::Side(1 - _side)).load(std::memory_order_acquire);
+    }
+
+    namespace {
+        // spins for a while, then yields the processor
+        class Backoff {
+            unsigned _n;
+            double _timeout;
+            std::chrono::steady_clock::time_point _start;
+        public:
+            explicit Backoff(double timeout) : _n(0), _timeout(timeout) {}
+            void operator()(const char *what) {
+                if (++_n < 64) return;
+                if (_n == 64) _start = std::chrono::steady_clock::now();
+                else if (_timeout > 0 && (_n & 1023) == 0 &&
+                         std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - _start).count() > _timeout)
+                    throw CoSimExc(std::string("timeout while waiting for ") + what);
+                std::this_thread::yield();
+            }
+        };
+    }
+
+    void CoSimPort::put(const CoSimSample &s, std::vector<CoSimSample> &in)
+    {
+        if (send(s)) return;
+        flush();
+        Backoff wait(_timeout);
+        while (!send(s)) {
+            receive(in);
+            wait("room in the channel");
+        }
+    }
+
+    void CoSimPort::wait(int64_t t, std::vector<CoSimSample> &in)
+    {
+        Backoff wait(_timeout);
+        while (peerTime() < t) {
+            receive(in);
+            wait("the co-simulator");
+        }
+        // the samples published before the clock
+        receive(in);
+    }
+
+    CoSimBridge::CoSimBridge(CoSimChannel &ch, Tick step, size_t signals,
+                             const std::string &name) :
+        Entity(name), _port(ch, CoSimChannel::SIMULATION), _step(step),
+        _inputs(signals, 0.0), _in(), _out(), _steps(0), _sent(0), _received(0)
+    {
+        if (step <= 0) throw CoSimExc("the step must be positive");
+    }
+
+    void CoSimBridge::send(uint32_t signal, double value)
+    {
+        CoSimSample s = {int64_t(SIMUL.getTime()), signal, 0, value};
+        _out.push_back(s);
+    }
+
+    void CoSimBridge::exchange(Tick t)
+    {
+        for (size_t i = 0; i < _in.size(); ++i)
+            if (_in[i].signal < _inputs.size())
+                _inputs[_in[i].signal] = _in[i].value;
+        _received += _in.size();
+        _in.clear();
+        onStep(t);
+    }
+
+    Tick CoSimBridge::run(Tick horizon)
+    {
+        Tick t = SIMUL.getTime();
+        while (t < horizon) {
+            Tick next = t + _step;
+            if (next > horizon) next = horizon;
+
+            _port.wait(int64_t(next), _in);
+            exchange(t);
+            // the events at next belong to the next step
+            SIMUL.run_to(next - 1);
+
+            for (size_t i = 0; i < _out.size(); ++i) _port.put(_out[i], _in);
+            _sent += _out.size();
+            _out.clear();
+            _port.publish(int64_t(next));
+
+            t = next;
+            ++_steps;
+        }
+        return t;
+    }
+
+    void CoSimBridge::newRun()
+    {
+        for (size_t i = 0; i < _inputs.size(); ++i) _inputs[i] = 0;
+        _in.clear();
+        _out.clear();
+        _steps = _sent = _received = 0;
+    }
+
+    void CoSimBridge::endRun()
+    {
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,283 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __COSIM_HPP__
+#define __COSIM_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+#include <entity.hpp>
+
+namespace MetaSim {
+
+    DECL_EXC(CoSimExc, "CoSim");
+
+    /**
+       \ingroup metasim_util
+
+       A sample exchanged with a co-simulator: the value of a
+       signal at a time (in ticks).
+    */
+    struct CoSimSample {
+        int64_t time;
+        uint32_t signal;
+        uint32_t reserved;
+        double value;
+    };
+
+    /**
+       \ingroup metasim_util
+
+       A block of shared memory that connects the simulation to a
+       co-simulator (e.g. the simulator of a plant), in another
+       process or thread: two lock-free rings of samples, one for
+       each direction, and the clocks of the two sides.
+
+       Each ring has a single producer and a single consumer: the
+       producer owns the tail, the consumer the head, and each
+       index is published with a release store, once per batch.
+       The clock of a side is the time up to which the other side
+       may run; it is published after the samples that come
+       before it.
+
+       The layout (for a co-simulator that does not link this
+       library) is, in 64-byte lines, in the byte order of the
+       machine: the header (magic "MSCOSIM1", capacity); the
+       clock of the simulation, then that of the peer (int64);
+       head and tail of the ring from the simulation, then those
+       of the ring to the simulation (uint64, free-running
+       indexes, a line each); the slots of the two rings
+       (capacity CoSimSample each).
+    */
+    class CoSimChannel {
+    public:
+        /// The two sides of the channel
+        enum Side { SIMULATION = 0, PEER = 1 };
+
+        /**
+           A channel in the file name (e.g. /dev/shm/plant), with
+           rings of capacity samples (a power of 2). If create is
+           true, the file is created (or truncated) and
+           initialized; otherwise, it must have been created by
+           the other side.
+
+           @throws CoSimExc if the file cannot be mapped
+        */
+        CoSimChannel(const std::string &name, size_t capacity, bool create);
+
+        /**
+           An anonymous channel, shared by the threads of this
+           process (and by its children, after fork()).
+        */
+        explicit CoSimChannel(size_t capacity);
+
+        ~CoSimChannel();
+
+        size_t getCapacity() const { return _capacity; }
+
+        /// @name Used by CoSimPort
+        //@{
+        struct Ring {
+            std::atomic<uint64_t> head;
+            char pad1[64 - sizeof(std::atomic<uint64_t>)];
+            std::atomic<uint64_t> tail;
+            char pad2[64 - sizeof(std::atomic<uint64_t>)];
+        };
+
+        std::atomic<int64_t> &clock(Side s);
+        /// the ring written by side s
+        Ring &ring(Side s);
+        CoSimSample *slots(Side s);
+        //@}
+
+    private:
+        void *_map;
+        size_t _len;
+        size_t _capacity;
+
+        void init();
+        static size_t bytes(size_t capacity);
+
+        CoSimChannel(const CoSimChannel &);
+        CoSimChannel &operator=(const CoSimChannel &);
+    };
+
+    /**
+       \ingroup metasim_util
+
+       One side of a CoSimChannel: sends samples on its ring,
+       receives them from the other one, and synchronizes with
+       the other side through the clocks. It does not allocate,
+       except to grow the vector passed to receive().
+
+       A co-simulator in C++ uses the PEER port as follows (the
+       simulation side is in CoSimBridge):
+
+       <pre>
+       CoSimPort p(ch, CoSimChannel::PEER);
+       std::vector<CoSimSample> in;
+       for (int64_t t = 0; t < horizon; t += step) {
+           p.wait(t, in);              // outputs of the simulation up to t
+           // ... advance the plant to t + step, p.send() its samples
+           p.publish(t + step);        // the simulation may run to t + step
+           in.clear();
+       }
+       </pre>
+    */
+    class CoSimPort {
+        CoSimChannel *_ch;
+        CoSimChannel::Side _side;
+        CoSimChannel::Ring *_out, *_in;
+        CoSimSample *_outSlots, *_inSlots;
+        uint64_t _mask;
+        /// local copies of the tail written, and of the head read
+        uint64_t _tail, _head;
+        /// last head of the consumer of _out that we have seen
+        uint64_t _peerHead;
+        double _timeout;
+
+    public:
+        CoSimPort(CoSimChannel &ch, CoSimChannel::Side side);
+
+        CoSimChannel::Side getSide() const { return _side; }
+
+        /**
+           Writes s in the ring, without publishing it (see
+           flush()). Returns false if the ring is full.
+        */
+        bool send(const CoSimSample &s);
+
+        /// Publishes the samples written by send()
+        void flush();
+
+        /**
+           As send(), but if the ring is full flushes it, and
+           waits for the other side to make room, receiving its
+           samples in the mean time (in in).
+        */
+        void put(const CoSimSample &s, std::vector<CoSimSample> &in);
+
+        /**
+           Appends to in the samples published by the other side,
+           and returns their number.
+        */
+        size_t receive(std::vector<CoSimSample> &in);
+
+        /// Flushes, and publishes the clock of this side
+        void publish(int64_t t);
+
+        /// The clock published by the other side
+        int64_t peerTime() const;
+
+        /**
+           Waits until the clock of the other side reaches t,
+           receiving its samples in in.
+
+           @throws CoSimExc if it takes longer than the timeout
+        */
+        void wait(int64_t t, std::vector<CoSimSample> &in);
+
+        /// Timeout of wait() and put(), in seconds (0 == none)
+        void setTimeout(double seconds) { _timeout = seconds; }
+    };
+
+    /**
+       \ingroup metasim_util
+
+       Couples the simulation with a co-simulator, through a
+       CoSimChannel, synchronizing only at the boundaries of the
+       steps of a fixed size. Between two boundaries, the
+       simulation runs freely: the samples sent by the model
+       (send()) are buffered, and sent as a batch at the end of
+       the step; the samples of the co-simulator are received at
+       the beginning of the step, and their values (get()) hold
+       for the whole step.
+
+       The bridge drives the simulation: run() waits for the
+       co-simulator to allow the next step (its clock), runs the
+       events of the step with run_to(), and then publishes the
+       outputs and its own clock. A step [t, t + step) contains
+       the events before its end: those at t + step see the
+       inputs of the next step.
+
+       <pre>
+       CoSimChannel ch("/dev/shm/plant", 1024, true);
+       CoSimBridge bridge(ch, 10, 4);   // steps of 10 ticks, 4 input signals
+       // ... the model reads bridge.get(k) and calls bridge.send(k, v)
+       SIMUL.initSingleRun();
+       bridge.run(100000);
+       SIMUL.endSingleRun();
+       </pre>
+
+       Nothing is allocated in a step, once the buffer of the
+       outputs has grown to the largest batch.
+    */
+    class CoSimBridge : public Entity {
+        CoSimPort _port;
+        Tick _step;
+        std::vector<double> _inputs;
+        std::vector<CoSimSample> _in, _out;
+        unsigned long _steps;
+        unsigned long _sent, _received;
+
+        void exchange(Tick t);
+
+    public:
+        /**
+           A bridge on the SIMULATION side of ch, with steps of
+           step ticks and signals input signals (their samples
+           with a larger number are dropped).
+        */
+        CoSimBridge(CoSimChannel &ch, Tick step, size_t signals,
+                    const std::string &name = "");
+
+        Tick getStep() const { return _step; }
+
+        /// Timeout of the synchronization, in seconds (0 == none)
+        void setTimeout(double seconds) { _port.setTimeout(seconds); }
+
+        /// Sends the value of signal at the current time
+        void send(uint32_t signal, double value);
+
+        /// The last value of input signal (0 until one arrives)
+        double get(uint32_t signal) const { return _inputs[signal]; }
+
+        /**
+           Called at the beginning of each step (at time t), after
+           the inputs have been received.
+        */
+        virtual void onStep(Tick t) {}
+
+        /**
+           Runs the events of the simulation, already
+           initialized, before horizon, step by step; returns
+           the time reached (horizon).
+        */
+        Tick run(Tick horizon);
+
+        unsigned long getSteps() const { return _steps; }
+        unsigned long getSent() const { return _sent; }
+        unsigned long getReceived() const { return _received; }
+
+        virtual void newRun();
+        virtual void endRun();
+    };
+
+} // namespace MetaSim
+
+#endif
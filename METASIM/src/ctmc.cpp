@@ -0,0 +1,219 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cmath>
+
+#include <ctmc.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    void JumpEvent::doit()
+    {
+        _chain->jump(_token);
+    }
+
+    CTMC::CTMC(const string &name, RandomGen *g) :
+        Entity(name), _gen(g), _names(), _pending(), _compiled(false),
+        _first(), _to(), _prob(), _alias(), _exit(), _tokens(),
+        _occupancy(), _jumps(0), _observer()
+    {
+    }
+
+    CTMC::~CTMC()
+    {
+        for (size_t i = 0; i < _tokens.size(); ++i) _tokens[i].evt->drop();
+    }
+
+    CTMC::StateId CTMC::addState(const string &name)
+    {
+        if (_compiled) throw CTMCExc("The chain is already compiled");
+        _names.push_back(name);
+        return StateId(_names.size() - 1);
+    }
+
+    void CTMC::addTransition(StateId from, StateId to, double r)
+    {
+        if (_compiled) throw CTMCExc("The chain is already compiled");
+        if (from >= _names.size() || to >= _names.size())
+            throw CTMCExc("Unknown state");
+        if (!(r > 0)) throw CTMCExc("The rate of a transition must be positive");
+        Pending p = { from, to, r };
+        _pending.push_back(p);
+    }
+
+    size_t CTMC::addToken(StateId s)
+    {
+        if (s >= _names.size()) throw CTMCExc("Unknown state");
+        Token t;
+        t.initial = t.state = t.prev = t.next = s;
+        t.since = t.sojourn = 0;
+        t.evt.reset(new JumpEvent(this, _tokens.size()));
+        _tokens.push_back(std::move(t));
+        return _tokens.size() - 1;
+    }
+
+    size_t CTMC::getTransitionCount() const
+    {
+        return _compiled ? _to.size() : _pending.size();
+    }
+
+    double CTMC::getExitRate(StateId s) const
+    {
+        if (s >= _names.size()) throw CTMCExc("Unknown state");
+        if (_compiled) return _exit[s];
+        double r = 0;
+        for (size_t i = 0; i < _pending.size(); ++i)
+            if (_pending[i].from == s) r += _pending[i].rate;
+        return r;
+    }
+
+    void CTMC::compile()
+    {
+        if (_compiled) return;
+        size_t n = _names.size();
+
+        // the transitions by state (counting sort), the duplicates merged
+        vector<uint32_t> count(n + 1, 0);
+        for (size_t i = 0; i < _pending.size(); ++i) count[_pending[i].from + 1]++;
+        for (size_t s = 0; s < n; ++s) count[s + 1] += count[s];
+        vector<Pending> sorted(_pending.size());
+        vector<uint32_t> pos(count.begin(), count.end() - 1);
+        for (size_t i = 0; i < _pending.size(); ++i)
+            sorted[pos[_pending[i].from]++] = _pending[i];
+
+        _first.assign(1, 0);
+        _to.clear();
+        vector<double> rates;
+        _exit.assign(n, 0);
+        for (size_t s = 0; s < n; ++s) {
+            uint32_t begin = _to.size();
+            for (uint32_t i = count[s]; i < count[s + 1]; ++i) {
+                const Pending &p = sorted[i];
+                uint32_t k = begin;
+                while (k < _to.size() && _to[k] != p.to) ++k;
+                if (k == _to.size()) {
+                    _to.push_back(p.to);
+                    rates.push_back(0);
+                }
+                rates[k] += p.rate;
+                _exit[s] += p.rate;
+            }
+            _first.push_back(_to.size());
+        }
+
+        _prob.assign(_to.size(), 1);
+        _alias.assign(_to.size(), 0);
+        for (size_t s = 0; s < n; ++s) buildAlias(_first[s], _first[s + 1], rates);
+
+        _occupancy.assign(n, 0);
+        _pending.clear();
+        _compiled = true;
+    }
+
+    void CTMC::buildAlias(uint32_t begin, uint32_t end, const vector<double> &r)
+    {
+        uint32_t n = end - begin;
+        if (n == 0) return;
+
+        double total = 0;
+        for (uint32_t k = begin; k < end; ++k) total += r[k];
+
+        // Vose: the slots under the mean are filled by the ones over it
+        vector<double> p(n);
+        vector<uint32_t> small, large;
+        for (uint32_t k = 0; k < n; ++k) {
+            p[k] = r[begin + k] * n / total;
+            _alias[begin + k] = k;
+            if (p[k] < 1) small.push_back(k);
+            else large.push_back(k);
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t l = small.back(), g = large.back();
+            small.pop_back();
+            _prob[begin + l] = p[l];
+            _alias[begin + l] = g;
+            p[g] = (p[g] + p[l]) - 1;
+            if (p[g] < 1) {
+                large.pop_back();
+                small.push_back(g);
+            }
+        }
+        // the rest is 1 but for rounding errors
+        for (size_t i = 0; i < large.size(); ++i) _prob[begin + large[i]] = 1;
+        for (size_t i = 0; i < small.size(); ++i) _prob[begin + small[i]] = 1;
+    }
+
+    void CTMC::schedule(Token &t)
+    {
+        uint32_t begin = _first[t.state], n = _first[t.state + 1] - begin;
+        if (n == 0) return;
+
+        // one number for the slot and its coin, one for the time
+        double u = uniform() * n;
+        uint32_t k = min(uint32_t(u), n - 1);
+        if (u - k >= _prob[begin + k]) k = _alias[begin + k];
+        t.next = _to[begin + k];
+
+        double h = -log(1 - uniform()) / _exit[t.state];
+        t.evt->post(SIMUL.getTime() + Tick(int64_t(h)));
+    }
+
+    void CTMC::jump(size_t token)
+    {
+        Token &t = _tokens[token];
+        Tick now = SIMUL.getTime();
+        StateId from = t.state;
+
+        _occupancy[from] += int64_t(now - t.since);
+        _jumps++;
+        t.sojourn = now - t.since;
+        t.since = now;
+        t.prev = from;
+        t.state = t.next;
+        if (_observer) _observer(token, from, t.state);
+        schedule(t);
+    }
+
+    void CTMC::updateOccupancy()
+    {
+        Tick now = SIMUL.getTime();
+        for (size_t i = 0; i < _tokens.size(); ++i) {
+            _occupancy[_tokens[i].state] += int64_t(now - _tokens[i].since);
+            _tokens[i].since = now;
+        }
+    }
+
+    void CTMC::newRun()
+    {
+        compile();
+        fill(_occupancy.begin(), _occupancy.end(), 0);
+        _jumps = 0;
+        for (size_t i = 0; i < _tokens.size(); ++i) {
+            Token &t = _tokens[i];
+            t.evt->drop();
+            t.state = t.prev = t.next = t.initial;
+            t.since = t.sojourn = 0;
+            schedule(t);
+        }
+    }
+
+    void CTMC::endRun()
+    {
+        updateOccupancy();
+    }
+
+} // namespace MetaSim
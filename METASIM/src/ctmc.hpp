@@ -0,0 +1,222 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CTMC_HPP__
+#define __CTMC_HPP__
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    DECL_EXC(CTMCExc, "CTMC");
+
+    class CTMC;
+
+    /**
+       \ingroup metasim_ee
+
+       The event of a token of a CTMC: it is posted at the time of
+       the next jump of the token, and it moves the token to the
+       next state. Stats and traces can be attached to it as to any
+       event: when they are called, the token has jumped, and
+       CTMC::getFrom(), CTMC::getTo() and CTMC::getSojourn() tell
+       the jump.
+    */
+    class JumpEvent : public Event {
+        CTMC *_chain;
+        size_t _token;
+
+    public:
+        JumpEvent(CTMC *c, size_t token) : Event(), _chain(c), _token(token) {}
+
+        virtual void doit();
+
+        size_t getToken() const { return _token; }
+        CTMC *getChain() const { return _chain; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A continuous-time Markov chain, with one or more tokens
+       moving among its states (e.g. the components of an
+       availability model that share the same chain).
+
+       The states and the transitions are added before the first
+       run; the rates are in jumps per tick. At the first run the
+       chain is compiled: the transitions of each state are packed
+       in one array, with their aggregate (exit) rate and an alias
+       table (Walker, Vose), so that a jump draws the holding time
+       from the aggregate rate and the next state in constant time,
+       whatever the number of transitions, with two uniform
+       numbers. Each token has a single JumpEvent in the queue. A
+       state without transitions is absorbing: a token that
+       reaches it stays there.
+
+       @code
+       CTMC m("availability");
+       CTMC::StateId up = m.addState("up"), down = m.addState("down");
+       m.addTransition(up, down, 1e-4);
+       m.addTransition(down, up, 1e-2);
+       m.addToken(up);
+       SIMUL.run(10000000);
+       double a = double(m.getOccupancy(up)) / 10000000;
+       @endcode
+
+       The time spent in each state by all the tokens is
+       accumulated in the current run (see getOccupancy()).
+    */
+    class CTMC : public Entity {
+    public:
+        typedef uint32_t StateId;
+
+        /// Called at every jump, after the token has moved
+        typedef std::function<void(size_t token, StateId from, StateId to)> Observer;
+
+        /**
+           The chain draws its numbers from g (by default, from the
+           generator of RandomVar at the time of each draw).
+        */
+        CTMC(const std::string &name = "", RandomGen *g = NULL);
+
+        ~CTMC();
+
+        /// Adds a state and returns its identifier (0, 1, ...)
+        StateId addState(const std::string &name = "");
+
+        /**
+           Adds a transition from a state to another, with rate
+           (per tick) r. Two transitions between the same states
+           add their rates.
+
+           @throws CTMCExc if a state does not exist, r is not
+           positive, or the chain has been compiled
+        */
+        void addTransition(StateId from, StateId to, double r);
+
+        /**
+           Adds a token that starts from state s at every run, and
+           returns its index.
+        */
+        size_t addToken(StateId s);
+
+        /// Sets the observer of the jumps (an empty one removes it)
+        void setObserver(const Observer &o) { _observer = o; }
+
+        /**
+           Builds the alias tables: called by the first run, it
+           can be called before to catch the errors early. No
+           transition can be added afterwards.
+        */
+        void compile();
+
+        size_t getStateCount() const { return _names.size(); }
+        size_t getTransitionCount() const;
+        size_t getTokenCount() const { return _tokens.size(); }
+        const std::string &getStateName(StateId s) const { return _names.at(s); }
+
+        /// The aggregate rate of the transitions out of s
+        double getExitRate(StateId s) const;
+
+        /// The current state of a token
+        StateId getState(size_t token) const { return _tokens.at(token).state; }
+
+        /// The event of a token (to attach stats and traces)
+        JumpEvent &getEvent(size_t token) { return *_tokens.at(token).evt; }
+
+        /**
+           The time spent in state s by the tokens in this run, up
+           to their last jump; see updateOccupancy().
+        */
+        Tick getOccupancy(StateId s) const { return Tick(_occupancy.at(s)); }
+
+        /// Adds to the occupancy the time of the tokens since their last jump
+        void updateOccupancy();
+
+        /// The number of jumps in this run
+        uint64_t getJumps() const { return _jumps; }
+
+        /// @name The last jump of a token (e.g. for the probes of JumpEvent)
+        //@{
+        StateId getFrom(size_t token) const { return _tokens.at(token).prev; }
+        StateId getTo(size_t token) const { return _tokens.at(token).state; }
+        /// the time spent in the state it left
+        Tick getSojourn(size_t token) const { return _tokens.at(token).sojourn; }
+        //@}
+
+        void newRun();
+        void endRun();
+
+    private:
+        friend class JumpEvent;
+
+        struct Token {
+            StateId initial;
+            StateId state;
+            StateId prev;
+            StateId next;
+            Tick since;
+            Tick sojourn;
+            std::unique_ptr<JumpEvent> evt;
+        };
+
+        struct Pending {
+            StateId from, to;
+            double rate;
+        };
+
+        RandomGen *_gen;
+        std::vector<std::string> _names;
+        std::vector<Pending> _pending;
+        bool _compiled;
+
+        /// transitions of s: from _first[s] to _first[s + 1]
+        std::vector<uint32_t> _first;
+        std::vector<StateId> _to;
+        /// the alias table: the slot k keeps its transition with
+        /// probability _prob[k], otherwise it takes _alias[k]
+        std::vector<double> _prob;
+        std::vector<uint32_t> _alias;
+        std::vector<double> _exit;
+
+        std::vector<Token> _tokens;
+        std::vector<int64_t> _occupancy;
+        uint64_t _jumps;
+        Observer _observer;
+
+        double uniform() {
+            RandomGen *g = _gen ? _gen : RandomVar::getGenerator();
+            return g->uniform(0, 1);
+        }
+
+        void buildAlias(uint32_t begin, uint32_t end, const std::vector<double> &r);
+
+        /// draws the next jump of a token from its state
+        void schedule(Token &t);
+
+        void jump(size_t token);
+    };
+
+} // namespace MetaSim
+
+#endif
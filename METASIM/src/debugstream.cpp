@@ -75,23 +75,25 @@ namespace MetaSim {
     void DebugStream::enter(std::string s) 
     {
         _dbgStack.push_back(_isDebug);
-        std::vector<std::string>::iterator i = 
-            find(_dbgLevels.begin(), _dbgLevels.end(), s);
-        if (i == _dbgLevels.end()
-            || (SIMUL.getTime() < _t1) 
-            || (SIMUL.getTime() > _t2)) 
-            _isDebug = false;
-        else
-            _isDebug = true;
+        // the window first: it is cheaper than looking for the level
+        Tick now = SIMUL.getTime();
+        if (now < _t1 || now > _t2 || _dbgLevels.empty()) _isDebug = false;
+        else _isDebug = find(_dbgLevels.begin(), _dbgLevels.end(), s) != 
+                 _dbgLevels.end();
         _isIndenting = true;
     }
 
-    void DebugStream::enter(std::string s, std::string header) 
+    void DebugStream::enter(std::string s, std::string h) 
     {
         enter(s);
+        header(h);
+    }
+
+    void DebugStream::header(const std::string &h)
+    {
         if (filter()) {
             indent();
-            (*_os) << header << endl;
+            (*_os) << h << endl;
             resetIndent();
             _indentLevel++;
         }
@@ -118,13 +120,6 @@ namespace MetaSim {
         _t2 = t2;
     }
 
-    bool DebugStream::filter() const
-    { 
-        if (_isDebug || _isDebugAll)
-            return true;
-        else return false;
-    }
-
     void DebugStream::resetIndent() 
     { 
         _isIndenting = true; 
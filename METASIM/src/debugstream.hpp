@@ -95,8 +95,19 @@ namespace MetaSim {
          */
         void setTransitory(Tick t1, Tick t2);
 
+        /**
+         * Prints the header of the current level and indents the
+         * following lines (if the level is enabled).
+         */
+        void header(const std::string &h);
+
+        /**
+         * True if the output is enabled. It is cheap, so that the
+         * DBGPRINT macros test it before formatting their arguments.
+         */
+        bool filter() const { return _isDebug || _isDebugAll; }
+
         // These helper function are only called by operator << and endl
-        bool filter() const;
         void resetIndent();
         void indent();
         std::ostream &getStream();
@@ -0,0 +1,224 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ENGINE_HPP__
+#define __ENGINE_HPP__
+
+#include <baseexc.hpp>
+#include <event.hpp>
+#include <eventqueue.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    DECL_EXC(EngineExc, "BasicEngine");
+
+    /**
+       \ingroup metasim_ee
+
+       @name Policies of the event loop (see BasicEngine)
+    */
+    //@{
+
+    /// Reaches the queue of the context through its virtual interface
+    struct DynamicQueue {
+        static bool accepts(EventQueue::Type) { return true; }
+        static Event *front(EventQueue *q) { return q->front(); }
+        static void erase(EventQueue *q, Event *e) { q->erase(e); }
+    };
+
+    /**
+       Calls the backend Q of type T directly, so that its
+       operations can be inlined: the queue of the context must be
+       of that type.
+    */
+    template <class Q, EventQueue::Type T>
+    struct StaticQueue {
+        static bool accepts(EventQueue::Type t) { return t == T; }
+        static Event *front(EventQueue *q) { return static_cast<Q *>(q)->Q::front(); }
+        static void erase(EventQueue *q, Event *e) { static_cast<Q *>(q)->Q::erase(e); }
+    };
+
+    typedef StaticQueue<SetEventQueue, EventQueue::SET_QUEUE> SetQueue;
+    typedef StaticQueue<HeapEventQueue, EventQueue::HEAP_QUEUE> HeapQueue;
+    typedef StaticQueue<CalendarEventQueue, EventQueue::CALENDAR_QUEUE> CalendarQueue;
+    typedef StaticQueue<LazyHeapEventQueue, EventQueue::LAZY_HEAP_QUEUE> LazyHeapQueue;
+    typedef StaticQueue<WheelEventQueue, EventQueue::WHEEL_QUEUE> WheelQueue;
+    typedef StaticQueue<RadixEventQueue, EventQueue::RADIX_QUEUE> RadixQueue;
+
+    /// Calls the stats, particles, traces and probe groups of the
+    /// events, and the profiler of the context
+    struct WithProbes { static const bool enabled = true; };
+
+    /// Only calls the handlers of the events: the probes and the
+    /// profiler are ignored
+    struct NoProbes { static const bool enabled = false; };
+
+    /// Prints the events on the debug stream (when compiled with
+    /// __DEBUG__, see DBGPRINT)
+    struct WithDebug { static const bool enabled = true; };
+
+    struct NoDebug { static const bool enabled = false; };
+
+    //@}
+
+    /**
+       \ingroup metasim_ee
+
+       The core of the event loop, specialized at compile time: the
+       backend of the queue (QueuePolicy), the probes of the events
+       (ProbePolicy) and the debug output (DebugPolicy) are template
+       parameters instead of run-time tests and virtual calls.
+
+       Simulation::sim_step() and the main loop of every run go
+       through BasicEngine<>, the instantiation that keeps all the
+       features. A model that does not need them can run its hot
+       loop on a leaner one, in which step() inlines completely
+       except for the handler of the event:
+
+       @code
+       typedef BasicEngine<RadixQueue, NoProbes, NoDebug> FastEngine;
+
+       SIMUL.setEventQueue(EventQueue::RADIX_QUEUE);
+       SIMUL.initRuns();
+       SIMUL.initSingleRun();
+       FastEngine(SIMUL).run_to(1000000);
+       SIMUL.endSingleRun();
+       @endcode
+
+       The engine works on the state of the Simulation (time, queue,
+       stop()), so the two can be used alternately in the same run.
+       run_to() is the bare loop: it does not take snapshots, pace,
+       publish metrics, drain the inbox or evaluate the stop
+       predicates.
+    */
+    template <class QueuePolicy = DynamicQueue,
+              class ProbePolicy = WithProbes,
+              class DebugPolicy = WithDebug>
+    class BasicEngine {
+        Simulation &_sim;
+        SimContext *_ctx;
+
+    public:
+        /**
+           @throws EngineExc if the queue of the simulation is not
+           the one of QueuePolicy
+        */
+        explicit BasicEngine(Simulation &s) : _sim(s), _ctx(s.getContext())
+        {
+            if (!QueuePolicy::accepts(_ctx->eventQueue->getType()))
+                throw EngineExc("The event queue is not the one of the engine");
+        }
+
+        /// The next event (NULL if the queue is empty)
+        Event *first() const {
+            return Event::first(QueuePolicy::front(_ctx->eventQueue),
+                                _ctx->lane.front());
+        }
+
+        /**
+           Processes the first event: returns false if the queue is
+           empty, otherwise it stores its time in t.
+        */
+        bool step(Tick &t)
+        {
+            Event *e = first();
+            if (e == NULL) return false;
+            extract(e);
+            t = e->_time;
+            _sim.globTime = t;
+            debug(e, "Executing event action at time [");
+            fire(e);
+            if (e->_disposable) e->dispose();
+            return true;
+        }
+
+        /**
+           Processes all the events with the time and the priority
+           of the first one (see Simulation::setBatchStepping()).
+        */
+        bool batchStep(Tick &t)
+        {
+            Event *e = first();
+            if (e == NULL) return false;
+            t = e->_time;
+            int prio = e->_priority;
+            _sim.globTime = t;
+            do {
+                extract(e);
+                debug(e, "Executing a batch of events at time [");
+                fire(e);
+                if (e->_disposable) e->dispose();
+                // an event posted by the handler with a higher
+                // priority, at the same time, ends the batch
+                e = first();
+            } while (e != NULL && e->_time == t && e->_priority == prio);
+            return true;
+        }
+
+        /**
+           Processes the events up to time stop (included), or
+           until stop() is called, and moves the time to stop.
+           Returns the current time.
+        */
+        Tick run_to(const Tick &stop)
+        {
+            SimContext::Scope scope(_ctx);
+            Event *e;
+            while (!_sim.stopped && (e = first()) != NULL && e->_time <= stop)
+                step(_sim.globTime);
+            if (_sim.globTime < stop && !_sim.stopped) _sim.globTime = stop;
+            return _sim.globTime;
+        }
+
+    private:
+        void extract(Event *e)
+        {
+            if (e->_lanePos != Event::NO_HANDLE) {
+                _ctx->lane.erase(e->_lanePos);
+                e->_lanePos = Event::NO_HANDLE;
+            }
+            else QueuePolicy::erase(_ctx->eventQueue, e);
+            if (ProbePolicy::enabled && _ctx->profiler)
+                _ctx->profiler->dropped(e);
+            e->_queueGen = 0;
+        }
+
+        void fire(Event *e)
+        {
+            if (!ProbePolicy::enabled) {
+                e->_lastTime = e->_time;
+                e->restorePriority();
+                e->doit();
+            }
+            else if (_ctx->profiler)
+                _ctx->profiler->run(e, _ctx->eventQueue->size());
+            else e->action();
+        }
+
+        void debug(Event *e, const char *msg)
+        {
+            if (!DebugPolicy::enabled) return;
+            DBGENTER(_SIMUL_DBG_LEV);
+            DBGPRINT_3(msg, e->_time, "]: ");
+#ifdef __DEBUG__
+            e->print();
+#endif
+            (void) e; (void) msg;
+        }
+    };
+
+} // namespace MetaSim
+
+#endif
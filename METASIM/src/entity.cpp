@@ -14,6 +14,7 @@
 #include <typeinfo>
 #include <sstream>
 
+#include <checkpoint.hpp>
 #include <entity.hpp>
 #include <simul.hpp>
 
@@ -22,32 +23,30 @@ namespace MetaSim {
 
     using namespace std;
 
-    map<int, Entity*> Entity::_globMap;
-    map<string, Entity *> Entity::_index;
-    int Entity::_IDcount = 0;
-
-    void Entity::_init()
+    void Entity::_init(const char *type)
     {
+        EntityRegistry &reg = _ctx->entities;
+        bool index = true;
+
         if (_name == "") {
             std::stringstream ss;
-            ss << _IDcount + 1;
-            _name = string(typeid(*this).name()) + ss.str();
+            ss << reg.nextID();
+            _name = string(type) + ss.str();
+            index = reg.isIndexAnonymous();
         }
 
-	if (_index.find(_name) != _index.end())
+	if (index && reg.find(_name) != NULL)
   	    throw Exc("Creating an entity with the same name " + _name);
 
-        _IDcount++;
-        _ID = _IDcount;
-        _globMap[_ID] = this;
+        _ID = reg.add(this);
 
         DBGENTER(_ENTITY_DBG_LEV);
 
         DBGPRINT_2("Entity ID: ", _ID);
-        DBGPRINT_2("Entity type: ",  typeid(*this).name());
+        DBGPRINT_2("Entity type: ",  type);
         DBGPRINT_2("Entity name:", _name);
 
-	_index[_name] = this;
+	if (index) reg.addName(this);
     }
 
     // Entity::Entity(const char *n) : _name(n) 
@@ -55,59 +54,94 @@ namespace MetaSim {
     //                 _init();
     //         }
 
-    Entity::Entity(const string &n) : _name(n) 
+    Entity::Entity(const string &n) :
+        _ctx(SimContext::current()), _name(n), _resetBlock(-1)
+    {
+        _init(typeid(*this).name());
+    }
+
+    Entity::Entity(const string &n, Deferred) :
+        _ctx(SimContext::current()), _ID(0), _name(n), _resetBlock(-1)
+    {
+    }
+
+    void Entity::registerEntity()
     {
-        _init();
+        if (_ID != 0) throw Exc("Entity " + _name + " is already registered");
+        // the type that the constructor would see
+        _init(typeid(Entity).name());
     }
 
     Entity::~Entity()
     {
-        _globMap.erase(_ID);
-        _index.erase(_name);
+        _ctx->entities.remove(this);
     }
 
-    void Entity::callNewRun()
+    void Entity::setResetState(void *p, size_t n)
     {
-  
-        typedef map<int, Entity*>::iterator EI;
+        if (p == NULL || n == 0) {
+            _ctx->entities.removeState(this);
+            _resetBlock = NO_STATE;
+        }
+        else _ctx->entities.setState(this, p, n);
+    }
 
-        EI p = _globMap.begin();
+    void Entity::saveState(Checkpoint &c)
+    {
+        if (_resetBlock == -1)
+            throw Checkpoint::Exc("Entity " + _name +
+                                  " does not save its state");
+        size_t n;
+        void *p = _ctx->entities.getState(this, n);
+        if (p != NULL) c.write(p, n);
+    }
 
-        while (p != _globMap.end()) {
+    void Entity::loadState(Checkpoint &c)
+    {
+        if (_resetBlock == -1)
+            throw Checkpoint::Exc("Entity " + _name +
+                                  " does not load its state");
+        size_t n;
+        void *p = _ctx->entities.getState(this, n);
+        if (p != NULL) c.read(p, n);
+    }
+
+    void Entity::setIndexAnonymous(bool f)
+    {
+        SimContext::current()->entities.setIndexAnonymous(f);
+    }
+
+    void Entity::reserve(size_t n, bool named)
+    {
+        SimContext::current()->entities.reserve(n, named);
+    }
+
+    void Entity::callNewRun()
+    {
+        EntityRegistry &reg = SimContext::current()->entities;
+        const EntityRegistry::EntityVector &v = reg.byID();
+
+        reg.restoreStates();
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (v[i] == NULL || v[i]->_resetBlock != -1) continue;
             DBGENTER(_ENTITY_DBG_LEV);
-            DBGPRINT_2("Calling the newRun() of ",
-                       p->second->getID());
-            
+            DBGPRINT_2("Calling the newRun() of ", v[i]->getID());
 
-            p->second->newRun();
-            p++;
+            v[i]->newRun();
         }
-                
-                
     }
 
     void Entity::callEndRun()
     {
-        typedef map<int, Entity*>::iterator EI;
+        const EntityRegistry::EntityVector &v = SimContext::current()->entities.byID();
 
-        EI p = _globMap.begin();
-        while (p != _globMap.end()) {
-            p->second->endRun();
-            p++;
-        }
-                
-                
+        for (size_t i = 0; i < v.size(); ++i)
+            if (v[i] != NULL) v[i]->endRun();
     }
 
-    Entity *Entity::_find(string n)
+    Entity *Entity::_find(const string &n)
     {
-        Entity *res = 0;
- 
-        typedef map<string, Entity *>::iterator NI;
-
-        NI i = _index.find(n);
-        if (i != _index.end()) res = (*i).second;
-        return res;
+        return SimContext::current()->entities.find(n);
     }
 
 } // end namespace MetaSim
@@ -29,11 +29,14 @@
 #ifndef __ENTITY_HPP___
 #define __ENTITY_HPP___
 
-#include <map>
+#include <cstddef>
 #include <string>
 
 #include <baseexc.hpp>
+#include <checkpoint.hpp>
 #include <basetype.hpp>
+#include <simcontext.hpp>
+#include <stateimage.hpp>
 
 namespace MetaSim {
 
@@ -60,20 +63,14 @@ namespace MetaSim {
 	Entity(const Entity &);
 	Entity &operator=(const Entity &);
 
-	/** 
-	    It contains pairs <ID, pointer to entity>. It's
-	    used mainly to keep track of all the entities
-	    present in the system. */
-	static std::map<int , Entity *> _globMap;
-  
 	/**
-	   It contains pairs <string, pointer to entity>. It
-	   is used to refer entities by name. The string must
-	   be unique!! */
-	static std::map<std::string, Entity *> _index;
+	   The context of the entity. The context keeps the
+	   registry of all the entities (by ID and by name); the
+	   entity belongs to the context that is current when it
+	   is created.
 
-	/// counter for assigning unique IDs to entities
-	static int _IDcount;
+	   @see SimContext */
+	SimContext *_ctx;
 
 	/// unique ID for the entity
 	int _ID;
@@ -81,6 +78,11 @@ namespace MetaSim {
 	/// unique name for the entity
 	std::string _name;
 
+	/// -1 if newRun() resets the entity, otherwise the reset
+	/// block in the registry (NO_STATE if it has no state)
+	int _resetBlock;
+	static const int NO_STATE = -2;
+
 	/**
 	   \ingroup metasim_exc
        
@@ -95,8 +97,36 @@ namespace MetaSim {
 	/**
 	   Initialize the entity. It is called by the
 	   different constructors, Entity(char *) and
-	   Entity(string) */
-	void _init();
+	   Entity(string), and by registerEntity(); type is the
+	   type in the generated name. */
+	void _init(const char *type);
+
+	friend class EntityRegistry;
+
+    protected:
+	/**
+	   Registers a bulk reset of the entity state. The n bytes
+	   at p must hold all the state that newRun() is supposed to
+	   reset, as plain data (no pointers to owned memory, no
+	   virtual tables). They are copied at the beginning of the
+	   first run; at the beginning of every other run they are
+	   restored with a memcpy, and newRun() is not called
+	   anymore. With p == NULL (or n == 0) the entity has no
+	   state to reset and newRun() is just skipped.
+
+	   The block must not contain the parameters of the
+	   entity that can be changed between two runs (the cost
+	   of an instruction, for example): they would be brought
+	   back to their value at the first run. Nor can newRun()
+	   do anything else than resetting the block (posting
+	   events, for example).
+
+	   This avoids one virtual call per entity at every run
+	   for large models made of many small entities. Usually,
+	   n is the size of a struct that groups the state of the
+	   entity, and setResetState() is called by the
+	   constructor. */
+	void setResetState(void *p, size_t n);
 
     public:
 	/** 
@@ -106,6 +136,27 @@ namespace MetaSim {
 	    by default the entity name is set equal to the
 	    typeid() + the entity ID. */
 	Entity(const std::string &n);
+
+	/// Tag of the constructor that does not register the entity
+	struct Deferred {};
+
+	/**
+	   Builds an entity that is not registered yet (its ID is
+	   0), so that the entities of a bulk builder can be
+	   constructed by several threads (see LightTaskSet in
+	   RTLIB). They must then be registered by a single thread,
+	   in order, with registerEntity(): they get the IDs and the
+	   generated names they would get if they were constructed
+	   one after the other. Nothing else can be done with an
+	   entity before it is registered, except destroying it. */
+	Entity(const std::string &n, Deferred);
+
+	/**
+	   Registers an entity built with Entity(n, Deferred).
+
+	   @throws Exc if it is already registered, or if its name
+	   is already used */
+	void registerEntity();
   
 	/// Destructor
 	virtual ~Entity();
@@ -121,16 +172,29 @@ namespace MetaSim {
 	    with that ID. */
 	static inline Entity* getPointer(int id)
 	    {
-		std::map<int, Entity*>::const_iterator p = _globMap.find(id);
-		if (p == _globMap.end()) return NULL;
-		else return p->second;
+		return SimContext::current()->entities.get(id);
 	    };
 
 	/** 
 	    Returns the pointer to the entity with the
 	    spoecified name or NULL if such entity does not
 	    exists.  */
-	static Entity * _find(std::string n);  
+	static Entity * _find(const std::string &n);  
+
+	/**
+	   Selects whether entities created with an empty name
+	   (which get a generated name) are indexed by name in the
+	   current context. The default is true; large models
+	   made of anonymous objects can save some time and
+	   memory by setting it to false, but then _find() does
+	   not find those entities. */
+	static void setIndexAnonymous(bool f);
+
+	/**
+	   Makes room in the current context for n more
+	   entities, before creating a large model: named tells
+	   whether they are going to be indexed by name. */
+	static void reserve(size_t n, bool named = true);
 
 	/** 
 	    Calls newRun() on every entity in the system.  It is
@@ -152,7 +216,7 @@ namespace MetaSim {
 	inline int getID() const { return _ID; }
 
 	///Get the Entity name
-	inline std::string getName() const { return _name; }
+	inline const std::string &getName() const { return _name; }
 
 	/** 
 	    Resets the entity status at the beginning of every
@@ -171,6 +235,32 @@ namespace MetaSim {
 	    etc.)  Warning: in endRun() is not permitted to
 	    create/destroy new entity objects. */
 	virtual void endRun() = 0;
+
+	/**
+	   Writes the state of the entity in a checkpoint (see
+	   Simulation::checkpoint()). By default, it writes the
+	   block of state registered with setResetState(), and it
+	   throws Checkpoint::Exc if the entity has not registered
+	   one (not even an empty one): entities that keep other
+	   state must override this function and loadState(). */
+	virtual void saveState(Checkpoint &c);
+
+	/// Reads back the state written by saveState()
+	virtual void loadState(Checkpoint &c);
+
+	/**
+	   Writes in s the part of the state of the entity that
+	   determines its future behaviour, with the times relative
+	   to the instant of the image (see StateImage::putTime()),
+	   for the fast-forward of Simulation::setFastForward().
+	   Returns false if the entity cannot describe its state
+	   (the default), or if its behaviour is not deterministic:
+	   then the simulation is never fast-forwarded. Counters
+	   that do not change the behaviour (the number of jobs,
+	   the energy consumed, ...) must not be written, otherwise
+	   the image never repeats.
+	*/
+	virtual bool getSignature(StateImage &s) { return false; }
     };
 }
 
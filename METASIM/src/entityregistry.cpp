@@ -0,0 +1,216 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <functional>
+
+#include <entity.hpp>
+#include <entityregistry.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    static char tomb_marker;
+    Entity *const EntityRegistry::TOMB =
+        reinterpret_cast<Entity *>(&tomb_marker);
+
+    static const size_t INITIAL_NAMES = 16;
+
+    EntityRegistry::EntityRegistry() :
+        _byID(), _count(0), _lastID(0),
+        _names(INITIAL_NAMES), _used(0), _named(0), _indexAnonymous(true),
+        _blocks(), _snapshot(), _deadBlocks(0)
+    {
+    }
+
+    int EntityRegistry::add(Entity *e)
+    {
+        _byID.resize(_lastID, NULL);
+        _byID.push_back(e);
+        _count++;
+        return ++_lastID;
+    }
+
+    void EntityRegistry::reserve(size_t n, bool names)
+    {
+        _byID.reserve(_lastID + n);
+        if (!names) return;
+
+        // at most half full, as in addName()
+        size_t size = _names.size();
+        while (2 * (_used + n) > size) size *= 2;
+        if (size != _names.size()) rehash(size);
+    }
+
+    void EntityRegistry::clear()
+    {
+        _byID.clear();
+        _count = 0;
+        SlotTable(INITIAL_NAMES).swap(_names);
+        _used = _named = 0;
+        _blocks.clear();
+        _snapshot.clear();
+        _deadBlocks = 0;
+    }
+
+    void EntityRegistry::remove(Entity *e)
+    {
+        int id = e->getID();
+        if (get(id) != e) return;
+
+        removeState(e);
+
+        _byID[id - 1] = NULL;
+        _count--;
+        // keep the vector as short as the highest live ID
+        while (!_byID.empty() && _byID.back() == NULL) _byID.pop_back();
+
+        size_t h = hash<string>()(e->_name);
+        size_t i = lookup(e->_name, h);
+        if (_names[i].e == e) {
+            _names[i].e = TOMB;
+            _named--;
+        }
+    }
+
+    size_t EntityRegistry::lookup(const string &n, size_t h) const
+    {
+        size_t mask = _names.size() - 1;
+        size_t i = h & mask;
+        size_t tomb = _names.size();
+
+        while (_names[i].e != NULL) {
+            if (_names[i].e == TOMB) {
+                if (tomb == _names.size()) tomb = i;
+            }
+            else if (_names[i].hash == h && _names[i].e->_name == n)
+                return i;
+            i = (i + 1) & mask;
+        }
+        return tomb != _names.size() ? tomb : i;
+    }
+
+    void EntityRegistry::rehash(size_t size)
+    {
+        SlotTable old(size);
+        old.swap(_names);
+        _used = 0;
+        for (size_t j = 0; j < old.size(); ++j) {
+            if (old[j].e == NULL || old[j].e == TOMB) continue;
+            size_t i = old[j].hash & (size - 1);
+            while (_names[i].e != NULL) i = (i + 1) & (size - 1);
+            _names[i] = old[j];
+            _used++;
+        }
+    }
+
+    bool EntityRegistry::addName(Entity *e)
+    {
+        size_t h = hash<string>()(e->_name);
+        size_t i = lookup(e->_name, h);
+
+        if (_names[i].e != NULL && _names[i].e != TOMB) return false;
+
+        if (_names[i].e == NULL) {
+            // keep the table at most half full, counting the
+            // tombstones: grow only if the live names need it
+            if (2 * (_used + 1) > _names.size()) {
+                size_t size = _names.size();
+                if (4 * (_named + 1) > size) size *= 2;
+                rehash(size);
+                i = lookup(e->_name, h);
+            }
+            if (_names[i].e == NULL) _used++;
+        }
+        _names[i].hash = h;
+        _names[i].e = e;
+        _named++;
+        return true;
+    }
+
+    void EntityRegistry::setState(Entity *e, void *p, size_t n)
+    {
+        removeState(e);
+
+        ResetBlock b;
+        b.e = e;
+        b.p = static_cast<char *>(p);
+        b.n = n;
+        b.off = 0;
+        b.saved = false;
+        e->_resetBlock = _blocks.size();
+        _blocks.push_back(b);
+    }
+
+    void *EntityRegistry::getState(const Entity *e, size_t &n) const
+    {
+        n = 0;
+        if (e->_resetBlock < 0) return NULL;
+        n = _blocks[e->_resetBlock].n;
+        return _blocks[e->_resetBlock].p;
+    }
+
+    void EntityRegistry::removeState(Entity *e)
+    {
+        if (e->_resetBlock >= 0) {
+            _blocks[e->_resetBlock].p = NULL;
+            _deadBlocks++;
+        }
+        e->_resetBlock = -1;
+    }
+
+    void EntityRegistry::compactStates()
+    {
+        std::vector<char, TrackedAllocator<char, EntityMem> > snap;
+        size_t k = 0;
+        for (size_t i = 0; i < _blocks.size(); ++i) {
+            ResetBlock b = _blocks[i];
+            if (b.p == NULL) continue;
+            if (b.saved) {
+                size_t off = snap.size();
+                snap.insert(snap.end(), _snapshot.begin() + b.off,
+                            _snapshot.begin() + b.off + b.n);
+                b.off = off;
+            }
+            b.e->_resetBlock = k;
+            _blocks[k++] = b;
+        }
+        _blocks.resize(k);
+        _snapshot.swap(snap);
+        _deadBlocks = 0;
+    }
+
+    void EntityRegistry::restoreStates()
+    {
+        if (2 * _deadBlocks > _blocks.size()) compactStates();
+        for (size_t i = 0; i < _blocks.size(); ++i) {
+            ResetBlock &b = _blocks[i];
+            if (b.p == NULL) continue;
+            if (b.saved) memcpy(b.p, &_snapshot[b.off], b.n);
+            else {
+                b.off = _snapshot.size();
+                _snapshot.insert(_snapshot.end(), b.p, b.p + b.n);
+                b.saved = true;
+            }
+        }
+    }
+
+    Entity *EntityRegistry::find(const string &n) const
+    {
+        size_t i = lookup(n, hash<string>()(n));
+        Entity *e = _names[i].e;
+        return (e == TOMB) ? NULL : e;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,171 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ENTITYREGISTRY_HPP__
+#define __ENTITYREGISTRY_HPP__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <memstats.hpp>
+
+namespace MetaSim {
+
+    class Entity;
+
+    /**
+       \ingroup metasim_ee
+
+       The registry of the entities of a context (see SimContext).
+       The entities are kept in a vector indexed by their ID, and
+       their names in an open-addressing hash table (linear
+       probing), so that looking up an entity costs the same
+       whatever the size of the model.
+
+       Entities with a generated name (created with an empty
+       name) are not put in the name table if
+       setIndexAnonymous(false) has been called.
+    */
+    class EntityRegistry {
+        struct Slot {
+            size_t hash;
+            Entity *e;  ///< NULL if empty, TOMB if removed
+        };
+
+        typedef std::vector<Slot, TrackedAllocator<Slot, EntityMem> > SlotTable;
+
+        static Entity *const TOMB;
+
+    public:
+        typedef std::vector<Entity *, TrackedAllocator<Entity *, EntityMem> > 
+        EntityVector;
+
+    private:
+        /// entities by ID
+        EntityVector _byID;
+        /// number of non-NULL entries of _byID
+        size_t _count;
+        int _lastID;
+
+        /// name table, its size is a power of 2
+        SlotTable _names;
+        /// used (non-empty) slots, including tombstones
+        size_t _used;
+        /// slots holding an entity
+        size_t _named;
+
+        bool _indexAnonymous;
+
+        /// a block of state registered with Entity::setResetState()
+        struct ResetBlock {
+            Entity *e;     ///< the owner
+            char *p;       ///< NULL if removed
+            size_t n;
+            size_t off;    ///< offset of the copy in _snapshot
+            bool saved;
+        };
+        std::vector<ResetBlock, TrackedAllocator<ResetBlock, EntityMem> > _blocks;
+        /// initial copies of all the blocks, one after the other
+        std::vector<char, TrackedAllocator<char, EntityMem> > _snapshot;
+        /// removed blocks still in _blocks
+        size_t _deadBlocks;
+
+        /// Drops the removed blocks and their copies
+        void compactStates();
+
+        size_t lookup(const std::string &n, size_t h) const;
+        void rehash(size_t size);
+
+        EntityRegistry(const EntityRegistry &);
+        EntityRegistry &operator=(const EntityRegistry &);
+
+    public:
+        EntityRegistry();
+
+        /// Registers e and returns its (new, unique) ID
+        int add(Entity *e);
+
+        /**
+           Makes room for n more entities (named ones, if names is
+           true), so that adding them does not reallocate the
+           vector or rehash the name table.
+        */
+        void reserve(size_t n, bool names);
+
+        /**
+           Forgets all the entities at once: their destructors
+           will not find themselves in the registry any more.
+           Used when the context is destroyed.
+        */
+        void clear();
+
+        /// Removes e, both by ID and by name
+        void remove(Entity *e);
+
+        /**
+           Indexes e by its name: returns false (and does not
+           index it) if another entity has the same name.
+        */
+        bool addName(Entity *e);
+
+        /// The entity with the given ID, or NULL
+        Entity *get(int id) const {
+            if (id <= 0 || size_t(id) > _byID.size()) return NULL;
+            return _byID[id - 1];
+        }
+
+        /// The entity with the given name, or NULL
+        Entity *find(const std::string &n) const;
+
+        /// The ID that will be assigned to the next entity
+        int nextID() const { return _lastID + 1; }
+
+        /// Number of entities in the registry
+        size_t size() const { return _count; }
+
+        /**
+           The entities, in ID order. Removed entities leave a
+           NULL entry.
+        */
+        const EntityVector &byID() const { return _byID; }
+
+        /// Sets the reset block of e (see Entity::setResetState())
+        void setState(Entity *e, void *p, size_t n);
+
+        /// The reset block of e (and its size in n), or NULL
+        void *getState(const Entity *e, size_t &n) const;
+
+        /// Removes the reset block of e, if any
+        void removeState(Entity *e);
+
+        /**
+           Restores all the reset blocks from their initial copy.
+           Blocks that have not been copied yet (i.e., at their
+           first run) are copied instead. When more than half of
+           the blocks belong to removed entities, they are dropped
+           first, so that models that create and destroy entities
+           across runs do not grow.
+        */
+        void restoreStates();
+
+        /// Number of reset blocks, including the removed ones
+        size_t stateBlocks() const { return _blocks.size(); }
+
+        void setIndexAnonymous(bool f) { _indexAnonymous = f; }
+        bool isIndexAnonymous() const { return _indexAnonymous; }
+    };
+
+} // namespace MetaSim
+
+#endif
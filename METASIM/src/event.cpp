@@ -17,64 +17,93 @@
 
 #include <entity.hpp>
 #include <event.hpp>
+#include <profiler.hpp>
 #include <simul.hpp>
 
 namespace MetaSim {
-    /** ------------------------------------------------------------
-     * Initialize static members of class Event
-     * ------------------------------------------------------------
-     */
-    Event::EventQueue Event::_eventQueue;
-
-    long Event::counter = 0;
-
     /**
      * Constructor for Event. 
      */
     Event::Event(int p) :
+        _ctx(SimContext::current()),
+        _qhandle(NO_HANDLE),
+        _stale(0),
+        _lanePos(NO_HANDLE),
+        _poolId(NO_POOL),
         _order(0),
-        _isInQueue(false),
-        _stats(), 
+        _queueGen(0),
+        _hasProbes(false),
+        _stats(),
         _particles(),
+        _statParticles(),
+        _statsOn(true),
+        _statIndex(NO_STATS),
         _traces(),
+        _group(0),
         _time(MAXTICK),
         _lastTime(MAXTICK),
         _priority(p),
         _std_priority(p),
-        _disposable(false)
+        _disposable(false),
+        _kind(0)
                 
     {
+        refreshKey();
+    }
+
+    Event::Event(const Event &e) :
+        MemTracked<EventMem>(),
+        _ctx(SimContext::current()),
+        _qhandle(NO_HANDLE),
+        _stale(0),
+        _lanePos(NO_HANDLE),
+        _poolId(NO_POOL),
+        _order(0),
+        _queueGen(0),
+        _hasProbes(false),
+        _stats(e._stats),
+        _particles(),
+        _statParticles(),
+        _statsOn(true),
+        _statIndex(NO_STATS),
+        _traces(e._traces),
+        _group(e._group),
+        _time(MAXTICK),
+        _lastTime(MAXTICK),
+        _priority(e._std_priority),
+        _std_priority(e._std_priority),
+        _disposable(false),
+        _kind(e._kind)
+    {
+        if (!_stats.empty()) registerStats();
+        refreshProbes();
+        refreshKey();
     }
 
     Event::~Event()
     {
-        std::deque<ParticleInterface *>::iterator itp;
+        if (isInQueue()) drop();
+        if (_stale > 0) _ctx->eventQueue->forget(this);
+
+        small_vector<ParticleInterface *>::iterator itp;
         for (itp=_particles.begin(); itp!=_particles.end(); itp++) 
             delete (*itp);
-    }
+        for (itp=_statParticles.begin(); itp!=_statParticles.end(); itp++) 
+            delete (*itp);
 
-    bool Event::Cmp::operator() (Event* e1, Event* e2) const {
-        Tick firstTime, secondTime;
-	
-        firstTime  = e1->getTime();
-        secondTime = e2->getTime();
-	
-        if (firstTime < secondTime) return true;
-        else if (firstTime == secondTime) {
-            if (e1->getPriority() < e2->getPriority()) return true;
-            else if (e1->getPriority() == e2->getPriority()) {
-                if (e1->_order < (unsigned long)e2->_order) 
-                    return true;
-                else return false;
-            }
-            else return false;
+        // the list may have been emptied at once (see
+        // SimContext::releaseArena())
+        std::vector<Event *> &v = _ctx->statEvents;
+        if (_statIndex < v.size() && v[_statIndex] == this) {
+            v[_statIndex] = v.back();
+            v[_statIndex]->_statIndex = _statIndex;
+            v.pop_back();
         }
-        else return false;
     }
 
-    void Event::post(Tick myTime, bool disp) throw (Exc, BaseExc)
+    void Event::post(Tick myTime, bool disp)
     {
-        if (_isInQueue) {
+        if (isInQueue()) {
 	    std::stringstream str;
 	    str << "Time: " << SIMUL.getTime() 
 		<< " -- Event" 
@@ -93,21 +122,20 @@ namespace MetaSim {
 
         setTime(myTime);
 
-        _order = counter++;
+        _order = _ctx->eventCounter++;
+        refreshKey();
 
-        std::pair<EventQueue::iterator,bool> p;
-        p =_eventQueue.insert(this);
-    
-        if (!p.second) {
-	    std::stringstream str;
-	    str << "Time: " << SIMUL.getTime() 
-		<< " -- Posting event" 
-		<< typeid(*this).name() << " Already in queue!, at time = " << myTime;
-            throw Exc(str.str());
+        if (myTime == SIMUL.getTime() && _priority == _IMMEDIATE_PRIORITY)
+            _lanePos = _ctx->lane.push(this);
+        else {
+            _lanePos = NO_HANDLE;
+            _ctx->eventQueue->insert(this);
         }
+        if (_ctx->profiler) _ctx->profiler->posted(this);
 
-        _isInQueue = true;
+        _queueGen = _ctx->queueGeneration;
         _disposable = disp;
+        if (disp) _ctx->disposablePosted = true;
 
         DBGENTER(_EVENT_DBG_LEV);
         print();
@@ -120,10 +148,76 @@ namespace MetaSim {
         DBGENTER(_EVENT_DBG_LEV);
         print();
         
-        _eventQueue.erase(this);
-        _isInQueue = false;
+        if (isInQueue()) {
+            if (_lanePos != NO_HANDLE) {
+                _ctx->lane.erase(_lanePos);
+                _lanePos = NO_HANDLE;
+            }
+            else _ctx->eventQueue->erase(this);
+            if (_ctx->profiler) _ctx->profiler->dropped(this);
+        }
+        _queueGen = 0;
     };
 
+    void Event::operator delete(void *p, size_t n)
+    {
+        if (HugePages::owns(p)) return;
+        MemTracked<EventMem>::operator delete(p, n);
+    }
+
+    void Event::dispose()
+    {
+        if (_poolId == NO_POOL) {
+            delete this;
+            return;
+        }
+
+        if (isInQueue()) drop();
+        if (_stale > 0) _ctx->eventQueue->forget(this);
+
+        if (_ctx->eventPools.size() <= _poolId) 
+            _ctx->eventPools.resize(_poolId + 1);
+        _ctx->eventPools[_poolId].push_back(this);
+    }
+
+    void Event::clearQueue(SimContext *ctx)
+    {
+        // the disposable events must be visited; if none has been
+        // posted since the last time, the storage is simply dropped
+        std::vector<Event *> v;
+        if (ctx->disposablePosted) {
+            ctx->eventQueue->collect(v);
+            ctx->lane.getEvents(v);
+        }
+        ctx->eventQueue->clear();
+        ctx->lane.clear();
+        ctx->disposablePosted = false;
+        if (++ctx->queueGeneration == 0) ++ctx->queueGeneration;
+
+        for (size_t i = 0; i < v.size(); ++i)
+            if (v[i]->_disposable) {
+                v[i]->_queueGen = 0;
+                v[i]->dispose();
+            }
+    }
+
+    void Event::getQueued(SimContext *ctx, std::vector<Event *> &v)
+    {
+        ctx->eventQueue->getEvents(v);
+        ctx->lane.getEvents(v);
+    }
+
+    void Event::setQueueType(EventQueue::Type t)
+    {
+        EventQueue *&q = SimContext::current()->eventQueue;
+        if (q->getType() == t) return;
+
+        EventQueue *n = EventQueue::create(t);
+        EventQueue::move(*q, *n);
+        delete q;
+        q = n;
+    }
+
 
     void Event::process(bool disp)
     {
@@ -143,9 +237,9 @@ namespace MetaSim {
 
     // Function to set the event time 
     // (only if the event is not in any queue).
-    void Event::setTime(Tick actTime) throw(Exc)
+    void Event::setTime(Tick actTime)
     {
-        if (_isInQueue)
+        if (isInQueue())
             throw Exc("Cannot set the time if the event is already queued\n");
         else _time = actTime;
     }
@@ -153,9 +247,9 @@ namespace MetaSim {
     // see comment below on exceptions to be thrown by this function
     void Event::action()
     {
-        std::deque<BaseStat *>::iterator its;
-        std::deque<Trace *>::iterator itt;
-        std::deque<ParticleInterface *>::iterator itp;
+        small_vector<BaseStat *>::iterator its;
+        small_vector<Trace *>::iterator itt;
+        small_vector<ParticleInterface *>::iterator itp;
 
         DBGENTER(_EVENT_DBG_LEV);
 
@@ -174,8 +268,14 @@ namespace MetaSim {
         // It may repost the event
         doit();
 
-        for(its = _stats.begin(); its != _stats.end(); its++)
-            (*its)->probe(this);
+        if (!_hasProbes) return;
+
+        if (_statsOn) {
+            for(its = _stats.begin(); its != _stats.end(); its++)
+                (*its)->probe(this);
+            for (itp = _statParticles.begin(); itp != _statParticles.end(); itp++)
+                (*itp)->probe();
+        }
 
         // the new way of doing statistics. The old way
         // remains valid, but it is deprecated.
@@ -187,8 +287,9 @@ namespace MetaSim {
         }
  
         for(itt = _traces.begin(); itt != _traces.end(); itt++)
-            (*itt)->record(this);
- 
+            if ((*itt)->accepts(this)) (*itt)->record(this);
+
+        if (_group != 0) _group->probe(this);
     }
 
     // DEBUG!!! Prints events data on the dbg stream.
@@ -199,12 +300,54 @@ namespace MetaSim {
                    "] event=", typeid(*this).name());
     }
 
+    void Event::addStat(BaseStat *actStat)
+    {
+        _stats.push_back(actStat);
+        registerStats();
+        refreshProbes();
+    }
+
     void Event::addParticle(ParticleInterface *s)
     {
         DBGENTER(_EVENT_DBG_LEV);
         DBGPRINT_2("Event name ", typeid(*this).name());
-        _particles.push_back(s);
+        if (s->isStat()) {
+            _statParticles.push_back(s);
+            registerStats();
+        }
+        else _particles.push_back(s);
+        refreshProbes();
         DBGPRINT_2("size is now: ", _particles.size());
     }
 
+    void Event::setProbeGroup(ProbeGroup *g)
+    {
+        _group = g;
+        refreshProbes();
+    }
+
+    void Event::registerStats()
+    {
+        if (_statIndex != NO_STATS) return;
+        _statIndex = _ctx->statEvents.size();
+        _ctx->statEvents.push_back(this);
+        _statsOn = _ctx->statsActive;
+    }
+
+    void Event::refreshProbes()
+    {
+        _hasProbes = _group != 0 || !_particles.empty() || !_traces.empty() ||
+            (_statsOn && (!_stats.empty() || !_statParticles.empty()));
+    }
+
+    void Event::activateStats(SimContext *ctx, bool on)
+    {
+        ctx->statsActive = on;
+        for (size_t i = 0; i < ctx->statEvents.size(); ++i) {
+            Event *e = ctx->statEvents[i];
+            e->_statsOn = on;
+            e->refreshProbes();
+        }
+    }
+
 } // namespace MetaSim 
@@ -14,15 +14,18 @@
 #ifndef __EVENT_HPP__
 #define __EVENT_HPP__
 
-#include <deque>
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <typeinfo>
 
 #include <simul.hpp>
 #include <basestat.hpp>
+#include <eventqueue.hpp>
 #include <particle.hpp>
-#include <plist.hpp>
+#include <probegroup.hpp>
+#include <simcontext.hpp>
+#include <smallvec.hpp>
 #include <trace.hpp>
 
 namespace MetaSim {
@@ -68,12 +71,15 @@ namespace MetaSim {
         are used to trace the evolution of the system for
         analysing it later. See Trace class for more details.
 
+        Events allocated with new are charged to the "events"
+        category of MemStats.
+
         \sa GEvent<X>
         
         \ingroup metasim_ee
 
     */
-    class Event {
+    class Event : public MemTracked<EventMem> {
 
     public:
         /** 
@@ -95,50 +101,114 @@ namespace MetaSim {
            object. It is used to order the event in the event
            queue. Events are ordered by triggering time, and
            in case of tie, by priority. In case of another
-           tie, event objects are ordered by pointer
-           value. This is because the implementation of the
-           priority queue does not allows ties. If you try to
-           insert an event object twice, you get an exception!
+           tie, event objects are ordered by insertion order
+           (FIFO). The three fields are packed in the _key
+           member, so the comparison is a single integer
+           compare.
         */
         class Cmp {
         public:
-            bool operator() (Event* e1, Event* e2) const;
+            bool operator() (const Event* e1, const Event* e2) const
+                { return e1->_key < e2->_key; }
         };
-                
-        typedef priority_list<Event*, Cmp> EventQueue;
-  
+
+        /// Packed (time, priority, order) key, refreshed by
+        /// post() and setPriority().
+        EventKey _key;
+
+        /// Recomputes the packed key from time, priority and order
+        inline void refreshKey() {
+            _key = makeEventKey(_time, _priority, _order);
+        }
+
+        friend class SetEventQueue;
+        friend class HeapEventQueue;
+        friend class CalendarEventQueue;
+        friend class LazyHeapEventQueue;
+        friend class WheelEventQueue;
+        friend class RadixEventQueue;
+        friend class AdaptiveEventQueue;
+
         /**
-           Event queue. This is the global event queue, used
-           by the simulation engine.
+           The context of the event: it is the current context at
+           the time the event is created, and the event is always
+           posted in the queue of this context.
         */ 
-        static EventQueue _eventQueue;
+        SimContext *_ctx;
 
-        /**
-           counter for fifo insertion
-        */
-        static long counter;
+        /// Backend-specific handle of the event: the position in
+        /// the indexed heap (or in a bucket of the radix heap),
+        /// or the generation of the event in the lazy heap.
+        size_t _qhandle;
+
+        /// Number of tombstones of this event in the lazy heap
+        unsigned int _stale;
+
+        /// Position in the immediate lane of _ctx (see
+        /// ImmediateLane), NO_HANDLE if it is in the backend
+        size_t _lanePos;
+
+        static const size_t NO_HANDLE = size_t(-1);
+
+        friend class EventPool;
+        friend class Checkpoint;
+        template <class, class, class> friend class BasicEngine;
+        friend class StateImage;
+
+        /// Free list of the pool where the event is given back
+        /// by dispose(), or NO_POOL if it is simply deleted
+        size_t _poolId;
+
+        static const size_t NO_POOL = size_t(-1);
 
         /**
            number of fifo insertion
         */
         unsigned long _order; 
   
-        /// Tells if the element is in the event queue;
-        bool _isInQueue;
+        /// The generation of the queue of _ctx in which the event
+        /// has been posted (see SimContext::queueGeneration), 0 if
+        /// it is not in the queue
+        unsigned long _queueGen;
+
+        /// True if at least one stat, particle or trace has been
+        /// attached, so action() skips the probes with one test
+        bool _hasProbes;
   
         /// A queue of all the statistical object. All these
         /// objects will be "invoked" after the event handler
         /// (doit()) has been processed.  @todo will be
         /// removed, eventually
-        std::deque<BaseStat *> _stats;
+        small_vector<BaseStat *> _stats;
 
         /// NEW
-        std::deque<ParticleInterface *> _particles;
+        small_vector<ParticleInterface *> _particles;
+
+        /// The particles that feed a stat (see addParticle())
+        small_vector<ParticleInterface *> _statParticles;
+
+        /// True if the stats and the stat particles are called:
+        /// they are attached only past the transitory (see
+        /// BaseStat::attachProbes())
+        bool _statsOn;
+
+        /// Position in SimContext::statEvents, NO_STATS if none
+        size_t _statIndex;
+        static const size_t NO_STATS = size_t(-1);
+
+        /// Adds the event to SimContext::statEvents
+        void registerStats();
+
+        /// Sets _hasProbes from the probe lists
+        void refreshProbes();
 
         /// A queue of object which manage the tracing
         /// process. All these objects will be "invoked" after
         /// the event handler (doit()) has been processed.
-        std::deque<Trace *> _traces;
+        small_vector<Trace *> _traces;
+
+        /// The probes shared with other events (NULL if none)
+        ProbeGroup *_group;
 
         /// Triggering time of the event.
         Tick _time;
@@ -169,14 +239,28 @@ namespace MetaSim {
         /// false.
         bool _disposable;
 
+        /**
+           Numeric tag identifying the class of the event, 0 (the
+           default) if not specified. Libraries built on MetaSim
+           set it in the constructors of their event classes, so
+           that probes and traces can recognise an event with a
+           switch instead of a chain of dynamic_casts. RTSim uses
+           the values from 100 to 199 for the task events.
+        */
+        int _kind;
+
         /// Checks that the event is not queued, and set the
         /// _time field;
-        void setTime(Tick actTime) throw(Exc);
+        void setTime(Tick actTime);
 
         /** 
             Copy constructor. This is defined to allow dynamic
             event creation using another event as a
-            prototype. Statistics and traces are copied.
+            prototype. Statistics and traces are copied, and
+            the clone shares the ProbeGroup of e; the particles
+            belong to e, and are not copied. With the probes in
+            the group, and at most two stats and two traces, a
+            clone allocates nothing.
         */
         Event(const Event &e);
 
@@ -197,6 +281,16 @@ namespace MetaSim {
         /// Destructor.
         virtual ~Event();
 
+        /// Allocated as the other tracked objects (see MemTracked)
+        static void *operator new(size_t n) 
+            { return MemTracked<EventMem>::operator new(n); }
+        static void *operator new(size_t, void *p) { return p; }
+
+        /// The pooled events on huge pages are freed with their
+        /// context (see EventSlab): deleting one only destroys it
+        static void operator delete(void *p, size_t n);
+        static void operator delete(void *, void *) {}
+
         /** 
             Inserts the event into the event queue. If the
             event is already in the event queue, an exception
@@ -221,10 +315,13 @@ namespace MetaSim {
             @param disp set it to true if the event object
             must be disposed.
         */
-        void post(Tick myTime, bool disp = false) throw(Exc, BaseExc);
+        void post(Tick myTime, bool disp = false);
 
         /**
-           Processes the event immediately. 
+           Processes the event immediately: it is posted at the
+           current time with the immediate priority, in the
+           immediate lane of the queue (see ImmediateLane), so it
+           is extracted before the next event of the backend.
         */
         void process(bool disp=false);
 
@@ -242,10 +339,33 @@ namespace MetaSim {
             object. The event is not extracted from the queue
         */
         static inline Event *getFirst() {
-            if (_eventQueue.empty()) 
-                return NULL;
-            else
-                return _eventQueue.front();
+            SimContext *ctx = SimContext::current();
+            return first(ctx->eventQueue->front(), ctx->lane.front());
+        }
+
+        /// The first of q (of the backend) and l (of the lane)
+        static inline Event *first(Event *q, Event *l) {
+            if (l == NULL || (q != NULL && q->_key < l->_key)) return q;
+            return l;
+        }
+
+        /**
+           Copies in v all the events queued in ctx, those of the
+           backend and those of the immediate lane, in no
+           particular order.
+        */
+        static void getQueued(SimContext *ctx, std::vector<Event *> &v);
+
+        /**
+           Changes the backend of the event queue. The events
+           currently in the queue are moved to the new backend.
+           Normally called through Simulation::setEventQueue().
+        */
+        static void setQueueType(EventQueue::Type t);
+
+        /// Returns the type of the current queue backend
+        static EventQueue::Type getQueueType() {
+            return SimContext::current()->eventQueue->getType();
         }
 
         /** 
@@ -256,12 +376,22 @@ namespace MetaSim {
         */
         inline int getPriority() const {return _priority;};
 
+        /// Returns the kind tag of the event (see _kind)
+        inline int getKind() const { return _kind; }
+
+        /**
+           The ID of the entity the event belongs to, or -1 (the
+           default). Used by the filters of Trace::setIDs().
+        */
+        virtual int getOwnerID() const { return -1; }
+
         /** 
             Set the event priority.  It is a identifier for
             the event priority. The lower the number, the
-            higher the priority.
+            higher the priority. Priorities must be in the
+            range [-32768, 32767].
         */
-        inline void setPriority(int p) { _priority = p;};
+        inline void setPriority(int p) { _priority = p; refreshKey(); };
 
         /** 
             Restore the standard priority (the one defined in
@@ -308,8 +438,46 @@ namespace MetaSim {
             @see post */
         inline bool isDisposable() {return _disposable;};  
 
+        /**
+           Destroys a disposable event after it has been
+           processed: if the event has been created by an
+           EventPool, it is given back to the pool of its context
+           for being recycled, otherwise it is deleted.
+        */
+        void dispose();
+
 
-        inline bool isInQueue() { return _isInQueue; }
+        inline bool isInQueue() {
+            return _queueGen != 0 && _queueGen == _ctx->queueGeneration;
+        }
+
+        /**
+           Empties the event queue of ctx at once: the queue drops
+           its storage, the events still queued are marked as not
+           queued by changing the generation of the queue (so that
+           their drop() does nothing), and only the disposable ones
+           are visited, to be disposed of. Used at the end of each
+           run (see Simulation::clearEventQueue()).
+        */
+        static void clearQueue(SimContext *ctx);
+
+        /**
+           True if a probe is called when the event is processed
+           now: a particle, a trace, or a stat past the transitory
+           (the stats are off during the transitory, see
+           activateStats()). It is meant for the decisions taken
+           for the current instant, such as processing an event at
+           once instead of posting it. A decision that holds
+           beyond the current instant (not posting an event, or
+           skipping future events) must use hasAttachedProbes()
+           instead, as the stats may turn on in the meantime.
+        */
+        inline bool hasProbes() const { return _hasProbes; }
+
+        /// As hasProbes(), but counting also the stats that are off
+        inline bool hasAttachedProbes() const {
+            return _hasProbes || !_stats.empty() || !_statParticles.empty();
+        }
 
         /** 
             Add a new stat probe to this event. All the
@@ -320,21 +488,40 @@ namespace MetaSim {
             @todo deprecated, will be removed, and substituted
             by a different kind of mechanisms.
         */
-        inline void addStat(BaseStat *actStat) { 
-            _stats.push_back(actStat);
-        }
+        void addStat(BaseStat *actStat);
 
         /** 
             Add a new particle to this event.  This is the new
-            way to add statistics and traces to this object.
+            way to add statistics and traces to this object. The
+            particles that feed a stat are called, like the
+            stats, only past the transitory.
         */
         void addParticle(ParticleInterface *s);
 
+        /**
+           Turns on (or off) the stats and the stat particles of
+           all the events of ctx (see BaseStat::attachProbes()).
+        */
+        static void activateStats(SimContext *ctx, bool on);
+
         /** 
             Add a new trace probe to this event. It is useful
             for defining different kinds of tracing all at the
             same time.  */
-        inline void addTrace(Trace *t) { _traces.push_back(t); }  
+        inline void addTrace(Trace *t) {
+            _traces.push_back(t);
+            _hasProbes = true;
+        }
+
+        /**
+           Shares the probes of g (NULL to stop sharing). They are
+           called after those of the event, and the clones of the
+           event share them too.
+        */
+        void setProbeGroup(ProbeGroup *g);
+
+        /// The shared probes of the event (NULL if none)
+        ProbeGroup *getProbeGroup() const { return _group; }
 
         /** 
             This method is called when the event is triggered.
@@ -365,10 +552,12 @@ namespace MetaSim {
             for debugging
         */
         static void printQueue() {
-            EventQueue::iterator it;
-    
-            for (it = _eventQueue.begin(); 
-                 it != _eventQueue.end(); 
+            std::vector<Event *> v;
+            getQueued(SimContext::current(), v);
+            std::sort(v.begin(), v.end(), Cmp());
+
+            for (std::vector<Event *>::iterator it = v.begin();
+                 it != v.end(); 
                  it++) 
                 (*it)->print();
         }
@@ -0,0 +1,78 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <atomic>
+
+#include <eventpool.hpp>
+#include <memstats.hpp>
+
+namespace MetaSim {
+
+    size_t EventPool::newTypeId()
+    {
+        static std::atomic<size_t> count(0);
+        return count++;
+    }
+
+    Event *EventPool::take(size_t id)
+    {
+        std::vector<std::vector<Event *> > &p = 
+            SimContext::current()->eventPools;
+
+        if (id >= p.size() || p[id].empty()) return NULL;
+
+        Event *e = p[id].back();
+        p[id].pop_back();
+        return e;
+    }
+
+    void *EventPool::allocate(size_t n, size_t align)
+    {
+        if (HugePages::getMode() == HugePages::OFF) return NULL;
+        SimContext *ctx = SimContext::current();
+        if (ctx->eventSlab == NULL) ctx->eventSlab = new EventSlab();
+        return ctx->eventSlab->allocate(n, align);
+    }
+
+    EventSlab::EventSlab() : _chunks(), _cur(0), _end(0)
+    {
+    }
+
+    EventSlab::~EventSlab()
+    {
+        for (size_t i = 0; i < _chunks.size(); ++i) {
+            MemStats::freed(EventMem::counters(), HugePages::SIZE);
+            HugePages::unmap(_chunks[i], HugePages::SIZE, EventMem::counters());
+        }
+    }
+
+    void *EventSlab::allocate(size_t n, size_t align)
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(_cur) % align) % align;
+        if (_cur == 0 || pad + n > size_t(_end - _cur)) {
+            if (n + align > HugePages::SIZE) return NULL;
+            char *c = static_cast<char *>(
+                HugePages::map(HugePages::SIZE, EventMem::counters()));
+            if (c == NULL) return NULL;
+            MemStats::allocated(EventMem::counters(), HugePages::SIZE);
+            _chunks.push_back(c);
+            _cur = c;
+            _end = c + HugePages::SIZE;
+            pad = 0;
+        }
+        void *p = _cur + pad;
+        _cur += pad + n;
+        return p;
+    }
+
+} // namespace MetaSim
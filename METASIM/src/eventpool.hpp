@@ -0,0 +1,159 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __EVENTPOOL_HPP__
+#define __EVENTPOOL_HPP__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <event.hpp>
+#include <gevent.hpp>
+#include <simcontext.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       The memory of the pooled events of a context, on huge pages
+       (see EventPool and HugePages): a bump allocator on chunks
+       of HugePages::SIZE bytes, unmapped with the context. The
+       events carved from it are not freed one by one: they go
+       back to the free lists of the pool, and deleting one only
+       runs its destructor.
+    */
+    class EventSlab {
+        std::vector<char *> _chunks;
+        char *_cur;
+        char *_end;
+
+        EventSlab(const EventSlab &);
+        EventSlab &operator=(const EventSlab &);
+
+    public:
+        EventSlab();
+        ~EventSlab();
+
+        /// n bytes aligned at align, or NULL if no chunk can be mapped
+        void *allocate(size_t n, size_t align);
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Recycles disposable events. Models that create an event
+       with new for every message, and post it with post(t, true),
+       spend a lot of time in memory allocation. An event created
+       by EventPool::create() instead, once processed, is not
+       deleted but put in a free list of the current context (one
+       list for each event type), and its memory is reused by the
+       next call to create() for the same type.
+
+       <pre>
+       MyEvent *e = EventPool::create<MyEvent>(msg);
+       e->post(SIMUL.getTime() + 10, true);
+       </pre>
+
+       A recycled event is destroyed and constructed again in the
+       same memory, so it does not keep any probe or trace of its
+       previous life. The events in the free lists are deleted
+       together with their context.
+
+       An event can also be cloned from a prototype, with
+       EventPool::create<MyEvent>(proto): with the probes of the
+       prototype in a ProbeGroup, the clones share them and
+       allocate nothing once the free list is warm.
+
+       When huge pages are enabled (see HugePages), the new events
+       are carved from chunks of huge pages of the context (see
+       EventSlab), so that the events processed one after the
+       other share few entries of the TLB.
+
+       @see newGEvent
+    */
+    class EventPool {
+        static size_t newTypeId();
+
+        template <class E>
+        static size_t typeId() {
+            static const size_t id = newTypeId();
+            return id;
+        }
+
+        /// Extracts an event from free list id, or NULL
+        static Event *take(size_t id);
+
+        /// Memory for a new event on huge pages, or NULL
+        static void *allocate(size_t n, size_t align);
+    public:
+        /**
+           Returns a new event of type E, built with the given
+           arguments, reusing the memory of an event of the same
+           type if possible.
+        */
+        template <class E, class... Args>
+        static E *create(Args&&... args) {
+            size_t id = typeId<E>();
+            Event *raw = take(id);
+            E *e;
+
+            if (raw == NULL) {
+                void *mem = allocate(sizeof(E), alignof(E));
+                if (mem == NULL) e = new E(std::forward<Args>(args)...);
+                else e = ::new (mem) E(std::forward<Args>(args)...);
+            }
+            else {
+                E *old = static_cast<E *>(raw);
+                old->~E();
+                try {
+                    e = new (static_cast<void *>(old))
+                        E(std::forward<Args>(args)...);
+                } catch (...) {
+                    E::operator delete(static_cast<void *>(old), sizeof(E));
+                    throw;
+                }
+            }
+            e->_poolId = id;
+            return e;
+        }
+
+        /// Returns the number of free events of type E in the
+        /// current context
+        template <class E>
+        static size_t getFree() {
+            std::vector<std::vector<Event *> > &p =
+                SimContext::current()->eventPools;
+            size_t id = typeId<E>();
+            return id < p.size() ? p[id].size() : 0;
+        }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Returns a pooled GEvent (see EventPool) that calls
+       obj->fun(), to be posted with post(t, true).
+    */
+    template <class X>
+    inline GEvent<X> *newGEvent(X *obj, void (X::*fun)(Event *),
+                                int p = Event::_DEFAULT_PRIORITY)
+    {
+        return EventPool::create<GEvent<X> >(obj, fun, p);
+    }
+
+} // namespace MetaSim
+
+#endif
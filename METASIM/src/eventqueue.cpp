@@ -0,0 +1,733 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+
+#include <event.hpp>
+#include <eventqueue.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    EventQueue *EventQueue::create(Type t)
+    {
+        switch (t) {
+        case HEAP_QUEUE:
+            return new HeapEventQueue();
+        case CALENDAR_QUEUE:
+            return new CalendarEventQueue();
+        case LAZY_HEAP_QUEUE:
+            return new LazyHeapEventQueue();
+        case WHEEL_QUEUE:
+            return new WheelEventQueue(WheelEventQueue::_defWidth,
+                                       WheelEventQueue::_defSlots);
+        case RADIX_QUEUE:
+            return new RadixEventQueue();
+        case ADAPTIVE_QUEUE:
+            return new AdaptiveEventQueue();
+        default:
+            return new SetEventQueue();
+        }
+    }
+
+    void EventQueue::move(EventQueue &from, EventQueue &to)
+    {
+        vector<Event *> v;
+        from.getEvents(v);
+        from.clear();
+        for (size_t i = 0; i < v.size(); ++i) to.insert(v[i]);
+    }
+
+    /*-----------------------------------------------------*/
+
+    bool SetEventQueue::Cmp::operator() (Event *e1, Event *e2) const
+    {
+        return Event::Cmp()(e1, e2);
+    }
+
+    void SetEventQueue::insert(Event *e)
+    {
+        std::pair<priority_list<Event *, Cmp>::iterator, bool> p;
+        p = _queue.insert(e);
+        if (!p.second)
+            throw BaseExc("Event already in queue", "SetEventQueue",
+                          "eventqueue.cpp");
+    }
+
+    void SetEventQueue::erase(Event *e)
+    {
+        _queue.erase(e);
+    }
+
+    Event *SetEventQueue::front()
+    {
+        if (_queue.empty()) return NULL;
+        else return _queue.front();
+    }
+
+    void SetEventQueue::getEvents(vector<Event *> &v) const
+    {
+        v.assign(_queue.begin(), _queue.end());
+    }
+
+    /*-----------------------------------------------------*/
+
+    // arity of the heap
+    static const size_t D = 4;
+
+    void HeapEventQueue::place(size_t i, Event *e)
+    {
+        _heap[i] = e;
+        e->_qhandle = i;
+    }
+
+    void HeapEventQueue::siftUp(size_t i)
+    {
+        Event *e = _heap[i];
+        Event::Cmp before;
+
+        while (i > 0) {
+            size_t parent = (i - 1) / D;
+            if (!before(e, _heap[parent])) break;
+            place(i, _heap[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+
+    void HeapEventQueue::siftDown(size_t i)
+    {
+        Event *e = _heap[i];
+        size_t n = _heap.size();
+        Event::Cmp before;
+
+        for (;;) {
+            size_t child = i * D + 1;
+            if (child >= n) break;
+
+            size_t last = min(child + D, n);
+            size_t best = child;
+            for (size_t c = child + 1; c < last; ++c)
+                if (before(_heap[c], _heap[best])) best = c;
+
+            if (!before(_heap[best], e)) break;
+            place(i, _heap[best]);
+            i = best;
+        }
+        place(i, e);
+    }
+
+    void HeapEventQueue::insert(Event *e)
+    {
+        _heap.push_back(e);
+        siftUp(_heap.size() - 1);
+    }
+
+    void HeapEventQueue::erase(Event *e)
+    {
+        size_t i = e->_qhandle;
+        if (i >= _heap.size() || _heap[i] != e) return;
+
+        Event *last = _heap.back();
+        _heap.pop_back();
+        e->_qhandle = Event::NO_HANDLE;
+        if (last == e) return;
+
+        place(i, last);
+        if (i > 0 && Event::Cmp()(last, _heap[(i - 1) / D])) siftUp(i);
+        else siftDown(i);
+    }
+
+    void HeapEventQueue::clear()
+    {
+        // the handles left in the events are harmless: erase()
+        // checks them
+        _heap.clear();
+    }
+
+    void HeapEventQueue::getEvents(vector<Event *> &v) const
+    {
+        v.assign(_heap.begin(), _heap.end());
+        sort(v.begin(), v.end(), Event::Cmp());
+    }
+
+    /*-----------------------------------------------------*/
+
+    CalendarEventQueue::CalendarEventQueue() :
+        _buckets(MIN_BUCKETS), _width(1), _curSlot(0), _size(0), _first(NULL)
+    {
+    }
+
+    int64_t CalendarEventQueue::slotOf(Event *e) const
+    {
+        return int64_t(e->getTime()) / _width;
+    }
+
+    void CalendarEventQueue::insert(Event *e)
+    {
+        int64_t s = slotOf(e);
+        Bucket &b = bucketOf(s);
+
+        b.insert(upper_bound(b.begin(), b.end(), e, Event::Cmp()), e);
+        ++_size;
+
+        // an event before the current position of the scan moves
+        // the calendar back
+        if (s < _curSlot) _curSlot = s;
+        if (_first != NULL && Event::Cmp()(e, _first)) _first = e;
+
+        if (_size > 2 * _buckets.size()) resize(2 * _buckets.size());
+    }
+
+    void CalendarEventQueue::erase(Event *e)
+    {
+        Bucket &b = bucketOf(slotOf(e));
+        Bucket::iterator i = lower_bound(b.begin(), b.end(), e, Event::Cmp());
+        if (i == b.end() || *i != e) return;
+
+        b.erase(i);
+        --_size;
+        if (_first == e) _first = NULL;
+
+        if (_buckets.size() > MIN_BUCKETS && _size < _buckets.size() / 2)
+            resize(_buckets.size() / 2);
+    }
+
+    Event *CalendarEventQueue::front()
+    {
+        if (_size == 0) return NULL;
+        if (_first == NULL) _first = search();
+        return _first;
+    }
+
+    Event *CalendarEventQueue::search()
+    {
+        size_t n = _buckets.size();
+
+        // scan one year, starting from the current slot
+        for (size_t k = 0; k < n; ++k, ++_curSlot) {
+            Bucket &b = bucketOf(_curSlot);
+            if (!b.empty() && slotOf(b.front()) <= _curSlot)
+                return b.front();
+        }
+
+        // nothing in the current year: direct search of the minimum
+        Event *best = NULL;
+        for (size_t k = 0; k < n; ++k)
+            if (!_buckets[k].empty() &&
+                (best == NULL || Event::Cmp()(_buckets[k].front(), best)))
+                best = _buckets[k].front();
+
+        _curSlot = slotOf(best);
+        return best;
+    }
+
+    void CalendarEventQueue::resize(size_t nbuckets)
+    {
+        vector<Event *> all;
+        getEvents(all);
+
+        // new width: about three times the average separation of the
+        // first events in the queue (as suggested by Brown)
+        size_t nsample = min(all.size(), size_t(25));
+        int64_t w = _width;
+        if (nsample > 1) {
+            int64_t span = int64_t(all[nsample - 1]->getTime()) -
+                int64_t(all[0]->getTime());
+            w = max(int64_t(1), 3 * span / int64_t(nsample - 1));
+        }
+
+        _buckets.assign(nbuckets, Bucket());
+        _width = w;
+        _size = 0;
+        _first = NULL;
+        _curSlot = all.empty() ? 0 : int64_t(all[0]->getTime()) / _width;
+
+        for (size_t i = 0; i < all.size(); ++i) {
+            // events are already sorted: just append them
+            bucketOf(slotOf(all[i])).push_back(all[i]);
+            ++_size;
+        }
+    }
+
+    void CalendarEventQueue::clear()
+    {
+        _buckets.assign(MIN_BUCKETS, Bucket());
+        _width = 1;
+        _curSlot = 0;
+        _size = 0;
+        _first = NULL;
+    }
+
+    void CalendarEventQueue::collect(vector<Event *> &v) const
+    {
+        v.clear();
+        v.reserve(_size);
+        for (size_t k = 0; k < _buckets.size(); ++k)
+            v.insert(v.end(), _buckets[k].begin(), _buckets[k].end());
+    }
+
+    void CalendarEventQueue::getEvents(vector<Event *> &v) const
+    {
+        collect(v);
+        sort(v.begin(), v.end(), Event::Cmp());
+    }
+
+    /*-----------------------------------------------------*/
+
+    LazyHeapEventQueue::LazyHeapEventQueue() :
+        _heap(), _live(0), _threshold(0.5)
+    {
+    }
+
+    bool LazyHeapEventQueue::isStale(const Entry &en) const
+    {
+        return en.gen != en.evt->_qhandle;
+    }
+
+    void LazyHeapEventQueue::insert(Event *e)
+    {
+        Entry en;
+        en.key = e->_key;
+        en.evt = e;
+        en.gen = e->_qhandle;
+        _heap.push_back(en);
+        push_heap(_heap.begin(), _heap.end(), EntryCmp());
+        ++_live;
+    }
+
+    void LazyHeapEventQueue::erase(Event *e)
+    {
+        --_live;
+
+        // the first event is really removed, the others become 
+        // tombstones
+        if (_heap.front().evt == e && !isStale(_heap.front())) {
+            pop_heap(_heap.begin(), _heap.end(), EntryCmp());
+            _heap.pop_back();
+            e->_qhandle++;
+            popStale();
+            return;
+        }
+
+        e->_qhandle++;
+        e->_stale++;
+
+        if (_live == 0) clear();
+        else if (double(_heap.size() - _live) > _threshold * _heap.size())
+            compact();
+    }
+
+    void LazyHeapEventQueue::popStale()
+    {
+        while (!_heap.empty() && isStale(_heap.front())) {
+            _heap.front().evt->_stale--;
+            pop_heap(_heap.begin(), _heap.end(), EntryCmp());
+            _heap.pop_back();
+        }
+    }
+
+    Event *LazyHeapEventQueue::front()
+    {
+        popStale();
+        if (_heap.empty()) return NULL;
+        else return _heap.front().evt;
+    }
+
+    void LazyHeapEventQueue::compact()
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < _heap.size(); ++i) {
+            if (isStale(_heap[i])) _heap[i].evt->_stale--;
+            else _heap[j++] = _heap[i];
+        }
+        _heap.resize(j);
+        make_heap(_heap.begin(), _heap.end(), EntryCmp());
+    }
+
+    void LazyHeapEventQueue::forget(Event *e)
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < _heap.size(); ++i) {
+            if (_heap[i].evt != e) _heap[j++] = _heap[i];
+            else if (!isStale(_heap[i])) --_live;
+        }
+        _heap.resize(j);
+        e->_stale = 0;
+        make_heap(_heap.begin(), _heap.end(), EntryCmp());
+    }
+
+    void LazyHeapEventQueue::clear()
+    {
+        for (size_t i = 0; i < _heap.size(); ++i) {
+            _heap[i].evt->_stale = 0;
+            if (!isStale(_heap[i])) _heap[i].evt->_qhandle++;
+        }
+        _heap.clear();
+        _live = 0;
+    }
+
+    void LazyHeapEventQueue::collect(vector<Event *> &v) const
+    {
+        v.clear();
+        for (size_t i = 0; i < _heap.size(); ++i)
+            if (!isStale(_heap[i])) v.push_back(_heap[i].evt);
+    }
+
+    void LazyHeapEventQueue::getEvents(vector<Event *> &v) const
+    {
+        collect(v);
+        sort(v.begin(), v.end(), Event::Cmp());
+    }
+
+    /*-----------------------------------------------------*/
+
+    int64_t WheelEventQueue::_defWidth = 1;
+    size_t WheelEventQueue::_defSlots = 4096;
+
+    void WheelEventQueue::setDefaultGeometry(int64_t width, size_t nslots)
+    {
+        _defWidth = max(int64_t(1), width);
+        _defSlots = max(size_t(1), nslots);
+    }
+
+    WheelEventQueue::WheelEventQueue(int64_t width, size_t nslots) :
+        _slots(), _width(max(int64_t(1), width)), _cur(0), _wsize(0), 
+        _over(), _first(NULL)
+    {
+        size_t n = 1;
+        while (n < nslots) n <<= 1;
+        _slots.resize(n);
+    }
+
+    int64_t WheelEventQueue::slotOf(Event *e) const
+    {
+        // floor division, also for negative times
+        int64_t t = int64_t(e->getTime());
+        return t >= 0 ? t / _width : -((-t + _width - 1) / _width);
+    }
+
+    void WheelEventQueue::insert(Event *e)
+    {
+        int64_t s = slotOf(e);
+
+        // an empty wheel starts its horizon at the new event
+        if (_wsize == 0 && _over.empty()) _cur = s;
+
+        if (inHorizon(s)) {
+            Slot &sl = slotAt(s);
+            sl.insert(upper_bound(sl.begin(), sl.end(), e, Event::Cmp()), e);
+            e->_qhandle = Event::NO_HANDLE;
+            ++_wsize;
+        }
+        else _over.insert(e);
+
+        if (_first != NULL && Event::Cmp()(e, _first)) _first = e;
+    }
+
+    void WheelEventQueue::erase(Event *e)
+    {
+        if (_first == e) _first = NULL;
+
+        // the heap keeps the position of its events in _qhandle
+        if (e->_qhandle != Event::NO_HANDLE) {
+            _over.erase(e);
+            return;
+        }
+
+        int64_t s = slotOf(e);
+        if (!inHorizon(s)) return;
+        Slot &sl = slotAt(s);
+        Slot::iterator i = lower_bound(sl.begin(), sl.end(), e, Event::Cmp());
+        if (i == sl.end() || *i != e) return;
+        sl.erase(i);
+        --_wsize;
+    }
+
+    void WheelEventQueue::pull()
+    {
+        // the heap is ordered by time: stop at the first event
+        // outside the horizon (possibly before it)
+        Event *e;
+        while ((e = _over.front()) != NULL && inHorizon(slotOf(e))) {
+            _over.erase(e);
+            slotAt(slotOf(e)).push_back(e);
+            ++_wsize;
+        }
+    }
+
+    Event *WheelEventQueue::search()
+    {
+        if (_wsize == 0) {
+            Event *o = _over.front();
+            if (o == NULL) return NULL;
+            // jump over the empty part of the wheel
+            if (slotOf(o) > _cur) _cur = slotOf(o);
+        }
+        else {
+            while (slotAt(_cur).empty()) ++_cur;
+        }
+        pull();
+
+        Event *w = _wsize > 0 ? slotAt(_cur).front() : NULL;
+        Event *o = _over.front();
+        if (w == NULL) return o;
+        if (o != NULL && Event::Cmp()(o, w)) return o;
+        return w;
+    }
+
+    Event *WheelEventQueue::front()
+    {
+        if (_first == NULL) _first = search();
+        return _first;
+    }
+
+    void WheelEventQueue::clear()
+    {
+        for (size_t k = 0; k < _slots.size(); ++k) _slots[k].clear();
+        _over.clear();
+        _cur = 0;
+        _wsize = 0;
+        _first = NULL;
+    }
+
+    void WheelEventQueue::collect(vector<Event *> &v) const
+    {
+        _over.collect(v);
+        for (size_t k = 0; k < _slots.size(); ++k)
+            v.insert(v.end(), _slots[k].begin(), _slots[k].end());
+    }
+
+    void WheelEventQueue::getEvents(vector<Event *> &v) const
+    {
+        collect(v);
+        sort(v.begin(), v.end(), Event::Cmp());
+    }
+
+    /*-----------------------------------------------------*/
+
+    RadixEventQueue::RadixEventQueue() : _last(0), _size(0)
+    {
+    }
+
+    uint64_t RadixEventQueue::timeOf(Event *e)
+    {
+        // biased, so that the order is the one of the signed times
+        return uint64_t(int64_t(e->getTime())) ^ 0x8000000000000000ULL;
+    }
+
+    int RadixEventQueue::bucketOf(uint64_t t) const
+    {
+        uint64_t x = t ^ _last;
+        if (x == 0) return 0;
+#if defined(__GNUC__)
+        return 64 - __builtin_clzll(x);
+#else
+        int b = 0;
+        for (; x != 0; x >>= 1) ++b;
+        return b;
+#endif
+    }
+
+    void RadixEventQueue::place(Event *e)
+    {
+        int b = bucketOf(timeOf(e));
+        Bucket &bk = _buckets[b];
+        if (b == 0) {
+            bk.insert(upper_bound(bk.begin(), bk.end(), e, Event::Cmp()), e);
+            e->_qhandle = Event::NO_HANDLE;
+        }
+        else {
+            e->_qhandle = bk.size();
+            bk.push_back(e);
+        }
+    }
+
+    void RadixEventQueue::rebase(uint64_t t)
+    {
+        vector<Event *> all;
+        getEvents(all);
+        for (int b = 0; b < NBUCKETS; ++b) _buckets[b].clear();
+        _last = t;
+        for (size_t i = 0; i < all.size(); ++i) place(all[i]);
+    }
+
+    void RadixEventQueue::insert(Event *e)
+    {
+        uint64_t t = timeOf(e);
+        if (_size == 0) _last = t;
+        else if (t < _last) rebase(t);
+        place(e);
+        ++_size;
+    }
+
+    void RadixEventQueue::erase(Event *e)
+    {
+        int b = bucketOf(timeOf(e));
+        Bucket &bk = _buckets[b];
+        if (b == 0) {
+            Bucket::iterator i = lower_bound(bk.begin(), bk.end(), e, 
+                                             Event::Cmp());
+            if (i == bk.end() || *i != e) return;
+            bk.erase(i);
+        }
+        else {
+            size_t i = e->_qhandle;
+            if (i >= bk.size() || bk[i] != e) return;
+            Event *last = bk.back();
+            bk[i] = last;
+            last->_qhandle = i;
+            bk.pop_back();
+            e->_qhandle = Event::NO_HANDLE;
+        }
+        --_size;
+    }
+
+    Event *RadixEventQueue::front()
+    {
+        if (_size == 0) return NULL;
+        if (!_buckets[0].empty()) return _buckets[0].front();
+
+        int b = 1;
+        while (_buckets[b].empty()) ++b;
+
+        // all the events of bucket b go to lower buckets around 
+        // the new minimum
+        Bucket moved;
+        moved.swap(_buckets[b]);
+        uint64_t m = timeOf(moved[0]);
+        for (size_t i = 1; i < moved.size(); ++i) 
+            m = min(m, timeOf(moved[i]));
+        _last = m;
+        for (size_t i = 0; i < moved.size(); ++i) place(moved[i]);
+
+        // the old storage of bucket b is kept
+        moved.clear();
+        _buckets[b].swap(moved);
+        return _buckets[0].front();
+    }
+
+    void RadixEventQueue::clear()
+    {
+        // as in the indexed heap, the handles are checked by erase()
+        for (int b = 0; b < NBUCKETS; ++b) _buckets[b].clear();
+        _last = 0;
+        _size = 0;
+    }
+
+    void RadixEventQueue::collect(vector<Event *> &v) const
+    {
+        v.clear();
+        v.reserve(_size);
+        for (int b = 0; b < NBUCKETS; ++b)
+            v.insert(v.end(), _buckets[b].begin(), _buckets[b].end());
+    }
+
+    void RadixEventQueue::getEvents(vector<Event *> &v) const
+    {
+        collect(v);
+        sort(v.begin(), v.end(), Event::Cmp());
+    }
+
+    /*-----------------------------------------------------*/
+
+    size_t AdaptiveEventQueue::_defWindow = 10000;
+
+    namespace {
+        /// the bin of distance d: b such that d is in [2^(b - 1), 2^b)
+        inline int bin(uint64_t d)
+        {
+            int b = 0;
+            while (d != 0) { ++b; d >>= 1; }
+            return b;
+        }
+
+        /// the bin of the p-th percentile of the n samples in h
+        size_t quantile(const size_t *h, size_t n, size_t p)
+        {
+            size_t c = 0, b = 0;
+            while (b < 64 && 100 * (c + h[b]) < p * n) c += h[b++];
+            return b;
+        }
+    }
+
+    AdaptiveEventQueue::AdaptiveEventQueue(size_t window) :
+        _q(new HeapEventQueue()), _ctx(SimContext::current()), 
+        _window(window > 0 ? window : 1), _posts(0), _cancels(0), _past(0), 
+        _sizes(0), _now(int64_t(_ctx->simulation().getTime())), _steps(0)
+    {
+        fill(_horizon, _horizon + 65, 0);
+        fill(_gaps, _gaps + 65, 0);
+    }
+
+    AdaptiveEventQueue::~AdaptiveEventQueue()
+    {
+        delete _q;
+    }
+
+    void AdaptiveEventQueue::insert(Event *e)
+    {
+        int64_t t = int64_t(e->_time);
+        if (t < _now) ++_past;
+        else ++_horizon[bin(uint64_t(t - _now))];
+        _sizes += _q->size();
+        _q->insert(e);
+
+        // the last statement: the choice may destroy this object
+        if (++_posts == _window) choose();
+    }
+
+    void AdaptiveEventQueue::erase(Event *e)
+    {
+        if (e != _q->front()) ++_cancels;
+        else if (int64_t(e->_time) > _now) {
+            ++_gaps[bin(uint64_t(int64_t(e->_time) - _now))];
+            ++_steps;
+            _now = int64_t(e->_time);
+        }
+        _q->erase(e);
+    }
+
+    void AdaptiveEventQueue::choose()
+    {
+        Type t = RADIX_QUEUE;
+        int64_t width = 1;
+        size_t slots = 1;
+        if (4 * _cancels > _posts || _past > 0 || _sizes < 32 * _posts)
+            t = HEAP_QUEUE;
+        else {
+            // the median distance between the times of the events
+            size_t g = quantile(_gaps, _steps, 50);
+            if (g > 1) width = int64_t(1) << min<size_t>(g - 1, 62);
+            // the horizon of 99% of the posts
+            size_t b = quantile(_horizon, _posts, 99);
+            int64_t horizon = b == 0 ? 1 : int64_t(1) << min<size_t>(b, 62);
+            while (slots < 65536 && int64_t(slots) * width < horizon) slots *= 2;
+            if (int64_t(slots) * width >= horizon) t = WHEEL_QUEUE;
+        }
+
+        EventQueue *q = t == WHEEL_QUEUE ? new WheelEventQueue(width, slots) : create(t);
+        move(*_q, *q);
+        delete _q;
+        if (_ctx->eventQueue == this) {
+            _q = 0;
+            _ctx->eventQueue = q;
+            delete this;
+        }
+        else _q = q;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,549 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __EVENTQUEUE_HPP__
+#define __EVENTQUEUE_HPP__
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <memstats.hpp>
+#include <plist.hpp>
+
+namespace MetaSim {
+
+    class Event;
+    class SimContext;
+
+    /**
+       \ingroup metasim_ee
+
+       Packed ordering key of an event. The 64 most significant
+       bits contain the triggering time, then 16 bits of priority
+       and 48 bits of insertion counter, so that comparing two keys
+       gives the same result as comparing (time, priority, order)
+       in lexicographic order. Signed fields are biased so that
+       they compare correctly as unsigned numbers.
+    */
+#if defined(__SIZEOF_INT128__)
+    typedef unsigned __int128 EventKey;
+
+    inline EventKey makeEventKey(int64_t t, int p, uint64_t order)
+    {
+        uint64_t lo = (uint64_t(uint16_t(p + 0x8000)) << 48) |
+            (order & 0xFFFFFFFFFFFFULL);
+        return (EventKey(uint64_t(t) ^ 0x8000000000000000ULL) << 64) | lo;
+    }
+#else
+    struct EventKey {
+        uint64_t hi;
+        uint64_t lo;
+        bool operator<(const EventKey &k) const
+            { return hi < k.hi || (hi == k.hi && lo < k.lo); }
+        bool operator==(const EventKey &k) const
+            { return hi == k.hi && lo == k.lo; }
+    };
+
+    inline EventKey makeEventKey(int64_t t, int p, uint64_t order)
+    {
+        EventKey k;
+        k.hi = uint64_t(t) ^ 0x8000000000000000ULL;
+        k.lo = (uint64_t(uint16_t(p + 0x8000)) << 48) |
+            (order & 0xFFFFFFFFFFFFULL);
+        return k;
+    }
+#endif
+
+    /**
+       \ingroup metasim_ee
+
+       Abstract interface of the global event queue. The simulation
+       engine only needs to insert an event, remove a given event,
+       and look at the event with the smallest (time, priority,
+       order) triple. Different implementations trade memory for
+       speed on different workloads; all of them must order the
+       events by their packed key (see EventKey), exactly as
+       Event::Cmp does, so that the simulation traces do not
+       depend on the selected backend.
+
+       The backend is selected with Simulation::setEventQueue().
+
+       @see SetEventQueue, HeapEventQueue, CalendarEventQueue,
+       LazyHeapEventQueue, WheelEventQueue, RadixEventQueue,
+       AdaptiveEventQueue
+    */
+    class EventQueue {
+    public:
+        /// Available backends
+        typedef enum { SET_QUEUE = 0, HEAP_QUEUE, CALENDAR_QUEUE,
+                       LAZY_HEAP_QUEUE, WHEEL_QUEUE, RADIX_QUEUE,
+                       ADAPTIVE_QUEUE } Type;
+
+        virtual ~EventQueue() {}
+
+        /// Inserts an event (that must not be already in the queue)
+        virtual void insert(Event *e) = 0;
+
+        /// Removes an event from the queue
+        virtual void erase(Event *e) = 0;
+
+        /// Returns the first event, or NULL if the queue is empty
+        virtual Event *front() = 0;
+
+        virtual bool empty() const = 0;
+
+        virtual size_t size() const = 0;
+
+        /// Removes all events from the queue
+        virtual void clear() = 0;
+
+        /**
+           Copies all the queued events in v, in the same order in
+           which they will be extracted. Used for debugging and for
+           moving the events to another backend.
+        */
+        virtual void getEvents(std::vector<Event *> &v) const = 0;
+
+        /**
+           Copies all the queued events in v, in no particular
+           order (by default, as getEvents()).
+        */
+        virtual void collect(std::vector<Event *> &v) const { getEvents(v); }
+
+        /// Returns the type of this backend
+        virtual Type getType() const = 0;
+
+        /**
+           Called when an event object is destroyed, so that the
+           backend can remove any internal reference to it. Only
+           needed by backends that defer the removal of dropped
+           events.
+        */
+        virtual void forget(Event *e) {}
+
+        /// Creates a new (empty) queue of the specified type
+        static EventQueue *create(Type t);
+
+        /// Moves all the events of from to to (in their order)
+        static void move(EventQueue &from, EventQueue &to);
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       The original event queue, a red-black tree (see
+       priority_list). Every insertion allocates a node.
+    */
+    class SetEventQueue : public EventQueue {
+        class Cmp {
+        public:
+            bool operator() (Event *e1, Event *e2) const;
+        };
+        priority_list<Event *, Cmp, TrackedAllocator<Event *, QueueMem> > _queue;
+    public:
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual bool empty() const { return _queue.size() == 0; }
+        virtual size_t size() const { return _queue.size(); }
+        virtual void clear() { _queue.clear(); }
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual Type getType() const { return SET_QUEUE; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A 4-ary indexed heap. Each event stores its position in the
+       heap (see Event::_qhandle), so that removing an arbitrary
+       event costs O(log n) and there is no allocation once the
+       underlying vector has grown to its steady-state size.
+    */
+    class HeapEventQueue : public EventQueue {
+        std::vector<Event *, TrackedAllocator<Event *, QueueMem> > _heap;
+
+        void siftUp(size_t i);
+        void siftDown(size_t i);
+        void place(size_t i, Event *e);
+    public:
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front() { return _heap.empty() ? NULL : _heap[0]; }
+        virtual bool empty() const { return _heap.empty(); }
+        virtual size_t size() const { return _heap.size(); }
+        virtual void clear();
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual void collect(std::vector<Event *> &v) const
+            { v.assign(_heap.begin(), _heap.end()); }
+        virtual Type getType() const { return HEAP_QUEUE; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A calendar queue (R. Brown, CACM 1988). Time is divided in
+       slots of fixed width, and slot s is stored in bucket (s mod
+       nbuckets); each bucket is kept sorted. When most events are
+       posted a few slots ahead of the current time, insertion and
+       extraction cost O(1) on average. The number of buckets and
+       their width are adapted when the queue size doubles or
+       halves.
+    */
+    class CalendarEventQueue : public EventQueue {
+        typedef std::vector<Event *, TrackedAllocator<Event *, QueueMem> > Bucket;
+
+        std::vector<Bucket, TrackedAllocator<Bucket, QueueMem> > _buckets;
+        /// bucket width, in ticks
+        int64_t _width;
+        /// slot of the current position of the scan
+        int64_t _curSlot;
+        size_t _size;
+        /// cached first event (NULL if it has to be searched)
+        Event *_first;
+
+        static const size_t MIN_BUCKETS = 4;
+
+        int64_t slotOf(Event *e) const;
+        Bucket &bucketOf(int64_t slot)
+            { return _buckets[size_t(slot) & (_buckets.size() - 1)]; }
+
+        void resize(size_t nbuckets);
+        Event *search();
+    public:
+        CalendarEventQueue();
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual bool empty() const { return _size == 0; }
+        virtual size_t size() const { return _size; }
+        virtual void clear();
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual void collect(std::vector<Event *> &v) const;
+        virtual Type getType() const { return CALENDAR_QUEUE; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A binary heap with lazy deletion. Dropping an event does not
+       touch the heap: the event generation (stored in
+       Event::_qhandle) is incremented, so that the entry becomes a
+       tombstone, and it is discarded when it reaches the top of the
+       heap. This halves the cost of the very common "drop and
+       re-post" pattern of preempted instructions and budget
+       servers. When the fraction of tombstones exceeds a threshold
+       (see setCompactThreshold()), the heap is compacted.
+    */
+    class LazyHeapEventQueue : public EventQueue {
+        struct Entry {
+            EventKey key;
+            Event *evt;
+            size_t gen;
+        };
+        class EntryCmp {
+        public:
+            // std heaps are max-heaps
+            bool operator() (const Entry &a, const Entry &b) const
+                { return b.key < a.key; }
+        };
+
+        std::vector<Entry, TrackedAllocator<Entry, QueueMem> > _heap;
+        size_t _live;
+        double _threshold;
+
+        bool isStale(const Entry &en) const;
+        void popStale();
+        void compact();
+    public:
+        LazyHeapEventQueue();
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual bool empty() const { return _live == 0; }
+        virtual size_t size() const { return _live; }
+        virtual void clear();
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual void collect(std::vector<Event *> &v) const;
+        virtual Type getType() const { return LAZY_HEAP_QUEUE; }
+        virtual void forget(Event *e);
+
+        /**
+           Sets the maximum fraction of tombstones in the heap
+           (default 0.5). When exceeded, the heap is compacted.
+        */
+        void setCompactThreshold(double r) { _threshold = r; }
+
+        /// Returns the number of tombstones currently in the heap
+        size_t getTombstones() const { return _heap.size() - _live; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A timing wheel in front of an indexed heap. The wheel has a
+       fixed number of slots of fixed width, and covers the
+       horizon [cursor, cursor + slots * width); an event posted
+       within the horizon goes in its slot (kept sorted), the
+       others go in the heap, which acts as the upper level of the
+       wheel. When the cursor moves forward, the heap events that
+       enter the horizon are moved to the wheel. The first event
+       is the smaller of the first event of the wheel and the
+       first event of the heap, so the order is exactly the one of
+       the other backends.
+
+       Periodic arrivals and deadlines, posted a few periods ahead
+       at quantized times, cost O(1) per post when the horizon
+       covers the largest period. The geometry is set with
+       setDefaultGeometry() before selecting the backend.
+    */
+    class WheelEventQueue : public EventQueue {
+        typedef std::vector<Event *, TrackedAllocator<Event *, QueueMem> > Slot;
+
+        std::vector<Slot, TrackedAllocator<Slot, QueueMem> > _slots;
+        /// slot width, in ticks
+        int64_t _width;
+        /// first slot of the horizon
+        int64_t _cur;
+        /// number of events in the wheel
+        size_t _wsize;
+        /// events outside the horizon
+        HeapEventQueue _over;
+        /// cached first event (NULL if it has to be searched)
+        Event *_first;
+
+        static int64_t _defWidth;
+        static size_t _defSlots;
+        friend class EventQueue;
+
+        int64_t slotOf(Event *e) const;
+        Slot &slotAt(int64_t s) { return _slots[size_t(s) & (_slots.size() - 1)]; }
+        bool inHorizon(int64_t s) const
+            { return s >= _cur && s < _cur + int64_t(_slots.size()); }
+
+        void pull();
+        Event *search();
+    public:
+        /// nslots is rounded up to a power of two
+        WheelEventQueue(int64_t width, size_t nslots);
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual bool empty() const { return _wsize == 0 && _over.empty(); }
+        virtual size_t size() const { return _wsize + _over.size(); }
+        virtual void clear();
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual void collect(std::vector<Event *> &v) const;
+        virtual Type getType() const { return WHEEL_QUEUE; }
+
+        /**
+           Sets the slot width (in ticks) and the number of slots
+           of the wheels created from now on (default 1 tick, 4096
+           slots). The horizon is their product: it should cover
+           the longest period of the model, with a width close to
+           the typical distance between events.
+        */
+        static void setDefaultGeometry(int64_t width, size_t nslots);
+
+        /// Returns the number of events currently in the wheel
+        size_t getWheelSize() const { return _wsize; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A radix heap (Ahuja et al., JACM 1990), for a monotone
+       queue: the events are never posted before the last minimum
+       extracted. Bucket 0 holds the events at the time of the
+       last minimum, kept sorted by key; bucket b > 0 holds the
+       events whose time differs from it first in bit b - 1, in
+       no order. When bucket 0 is empty, the first non-empty
+       bucket is emptied in the lower ones around its minimum
+       time, so every event moves down at most 64 times and the
+       operations cost O(log C) amortized, where C is the largest
+       distance between the current time and a posted event.
+
+       An event posted before the last minimum (for instance,
+       after run_to() has stopped before the first event, or
+       after restoring a checkpoint) is accepted: all the events
+       are redistributed around its time.
+    */
+    class RadixEventQueue : public EventQueue {
+        typedef std::vector<Event *, TrackedAllocator<Event *, QueueMem> > Bucket;
+
+        static const int NBUCKETS = 65;
+
+        Bucket _buckets[NBUCKETS];
+        /// biased time of the last minimum
+        uint64_t _last;
+        size_t _size;
+
+        static uint64_t timeOf(Event *e);
+        int bucketOf(uint64_t t) const;
+
+        void place(Event *e);
+        void rebase(uint64_t t);
+    public:
+        RadixEventQueue();
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual bool empty() const { return _size == 0; }
+        virtual size_t size() const { return _size; }
+        virtual void clear();
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual void collect(std::vector<Event *> &v) const;
+        virtual Type getType() const { return RADIX_QUEUE; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A queue that chooses its backend from the workload: the
+       events go first in an indexed heap, while the posts are
+       sampled (the size of the queue, the distance of the posted
+       events from the current time, the posts in the past and
+       the events dropped before their time). After window posts
+       the best backend is chosen:
+
+       - the indexed heap (HEAP_QUEUE) if more than a fourth of
+         the events are dropped before their time (e.g. the
+         budget events of servers), if events are posted before
+         the current time, or if the queue is small;
+       - a timing wheel (WHEEL_QUEUE) if almost all the events
+         (99%) are posted within a horizon of at most 65536
+         slots, each as wide as the median distance between the
+         times of the events (e.g. periodic arrivals and
+         deadlines);
+       - the radix heap (RADIX_QUEUE) otherwise, for monotone
+         times spread over a wide range.
+
+       The events are moved to the new backend, in the same
+       order, and the queue of the context (see
+       SimContext::eventQueue) is replaced by it, so from then on
+       the events do not go through this object, which is
+       destroyed. Since the backend can change during a run, a
+       BasicEngine specialized on a backend (see StaticQueue) does
+       not accept this queue.
+    */
+    class AdaptiveEventQueue : public EventQueue {
+        EventQueue *_q;
+        SimContext *_ctx;
+        size_t _window;
+
+        // the samples
+        size_t _posts, _cancels, _past, _sizes;
+        /// the time of the last event extracted
+        int64_t _now;
+        /// the posts by distance from the current time: bin b
+        /// counts the distances in [2^(b - 1), 2^b)
+        size_t _horizon[65];
+        /// the distances between the times extracted, by bin
+        size_t _gaps[65], _steps;
+
+        static size_t _defWindow;
+
+        void choose();
+    public:
+        explicit AdaptiveEventQueue(size_t window = _defWindow);
+        virtual ~AdaptiveEventQueue();
+
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front() { return _q->front(); }
+        virtual bool empty() const { return _q->empty(); }
+        virtual size_t size() const { return _q->size(); }
+        virtual void clear() { _q->clear(); }
+        virtual void getEvents(std::vector<Event *> &v) const { _q->getEvents(v); }
+        virtual void collect(std::vector<Event *> &v) const { _q->collect(v); }
+        virtual Type getType() const { return ADAPTIVE_QUEUE; }
+        virtual void forget(Event *e) { _q->forget(e); }
+
+        /**
+           The backend in use: when the queue is the one of a
+           context, after the choice it is that of the context.
+        */
+        Type getBackend() const { return _q->getType(); }
+
+        /// Sets the number of posts sampled by the queues created from now on
+        static void setDefaultWindow(size_t window) { _defWindow = window; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       The events posted at the current time with the immediate
+       priority (see Event::process()), in FIFO order, kept out of
+       the backend of the queue: they are many (every schedule and
+       deschedule of a task goes through one), and they are
+       extracted soon after being posted, so the lane makes their
+       post, drop and extraction O(1) whatever the backend.
+
+       The events of the lane have the same time and priority, and
+       increasing insertion counters, so the first one is the
+       smallest of the lane; the first event of the queue is the
+       smaller of it and the first event of the backend (see
+       Event::getFirst()), which gives exactly the order of the
+       backend alone. A dropped event leaves a hole, skipped by
+       front(); the storage is reused as soon as the lane is
+       empty, which happens before the time moves.
+    */
+    class ImmediateLane {
+        std::vector<Event *, TrackedAllocator<Event *, QueueMem> > _v;
+        size_t _head;
+        size_t _size;
+
+    public:
+        ImmediateLane() : _v(), _head(0), _size(0) {}
+
+        /// Appends e, and returns its position (see erase())
+        size_t push(Event *e) {
+            _v.push_back(e);
+            ++_size;
+            return _v.size() - 1;
+        }
+
+        /// Removes the event at position pos
+        void erase(size_t pos) {
+            _v[pos] = 0;
+            if (--_size == 0) clear();
+        }
+
+        /// Returns the first event, or NULL if the lane is empty
+        Event *front() {
+            if (_size == 0) return 0;
+            while (_v[_head] == 0) ++_head;
+            return _v[_head];
+        }
+
+        bool empty() const { return _size == 0; }
+
+        size_t size() const { return _size; }
+
+        void clear() {
+            _v.clear();
+            _head = 0;
+            _size = 0;
+        }
+
+        /// Appends the events of the lane to v, in order
+        void getEvents(std::vector<Event *> &v) const {
+            for (size_t i = _head; i < _v.size(); ++i)
+                if (_v[i] != 0) v.push_back(_v[i]);
+        }
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -28,9 +28,11 @@
 #ifndef __FACTORY_HPP__
 #define __FACTORY_HPP__
 
+#include <atomic>
+#include <functional>
 #include <iostream>
-#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -41,18 +43,35 @@ typedef std::string defaultIDKeyType;
 template <class manufacturedObj, typename classIDKey=defaultIDKeyType>
 class genericFactory 
 {
-    // a BASE_CREATE_FN is a function that takes no parameters
-    // and returns an auto_ptr to a manufactuedObj.  Note that
-    // we use no parameters, but you could add them
-    // easily enough to allow overloaded ctors, e.g.:
-    //   typedef std::auto_ptr<manufacturedObj> (*BASE_CREATE_FN)(int);
-    typedef std::auto_ptr<manufacturedObj> (*BASE_CREATE_FN)(std::vector<std::string> &par);
-
-    // FN_REGISTRY is the registry of all the BASE_CREATE_FN
-    // pointers registered.  Functions are registered using the
-    // regCreateFn member function (see below).
-    typedef std::map<classIDKey, BASE_CREATE_FN> FN_REGISTRY;
-    FN_REGISTRY registry;
+    public:
+    // a BASE_CREATE_FN is a function that takes the parameters
+    // of the object (as strings) and returns a new
+    // manufacturedObj, owned by the caller.
+    typedef manufacturedObj *(*BASE_CREATE_FN)(std::vector<std::string> &par);
+
+    private:
+    // The registry of all the BASE_CREATE_FN pointers registered,
+    // in order of registration.  Functions are registered using
+    // the regCreateFn member function (see below).
+    struct Entry {
+        classIDKey key;
+        BASE_CREATE_FN fn;
+    };
+    std::vector<Entry> registry;
+
+    // The registration happens during the static initialization:
+    // at the first lookup, the registry is frozen into a table
+    // with a perfect hash, i.e. a seed for which all the keys go
+    // in different slots. A lookup costs one hash and one
+    // comparison. Each slot holds an index in the registry plus
+    // one (0 is an empty slot).
+    mutable std::vector<unsigned> table;
+    mutable size_t seed;
+    mutable std::atomic<bool> frozen;
+    mutable std::mutex lock;
+
+    size_t slot(const classIDKey &k, size_t s) const;
+    void freeze() const;
 
     // Singleton implementation - private ctor & copying, with
     // no implementation on the copying.
@@ -69,8 +88,12 @@ class genericFactory
     // the function that creates the class.
     void regCreateFn(const classIDKey &, BASE_CREATE_FN);
 
-    // Create a new class of the type specified by className.
-    std::auto_ptr<manufacturedObj> create(const classIDKey &className, std::vector<std::string> &parms) const;
+    // The function registered for className, NULL if none
+    BASE_CREATE_FN find(const classIDKey &className) const;
+
+    // Create a new class of the type specified by className (NULL
+    // if className has not been registered).
+    std::unique_ptr<manufacturedObj> create(const classIDKey &className, std::vector<std::string> &parms) const;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -78,40 +101,94 @@ class genericFactory
 // the implementation is self-explanatory.
 
 template <class manufacturedObj, typename classIDKey>
-genericFactory<manufacturedObj, classIDKey>::genericFactory()
+genericFactory<manufacturedObj, classIDKey>::genericFactory() :
+  registry(), table(), seed(0), frozen(false), lock()
 {
 }
 
 template <class manufacturedObj, typename classIDKey>
 genericFactory<manufacturedObj, classIDKey> &genericFactory<manufacturedObj, classIDKey>::instance()
 {
-  // Note that this is not thread-safe!
   static genericFactory theInstance;
   return theInstance;
 }
 
 // Register the creation function.  This simply associates the classIDKey
-// with the function used to create the class.  The return value is a dummy
-// value, which is used to allow static initialization of the registry.
-// See example implementations in base.cpp and derived.cpp
+// with the function used to create the class (a second registration
+// of the same key replaces the first one).
 template <class manufacturedObj, typename classIDKey>
 void genericFactory<manufacturedObj, classIDKey>::regCreateFn(const classIDKey &clName, BASE_CREATE_FN func)
 {
-  registry[clName]=func;
+  std::lock_guard<std::mutex> g(lock);
+
+  frozen.store(false, std::memory_order_release);
+  for (size_t i = 0; i < registry.size(); ++i)
+    if (registry[i].key == clName) {
+      registry[i].fn = func;
+      return;
+    }
+  Entry e = { clName, func };
+  registry.push_back(e);
+}
+
+template <class manufacturedObj, typename classIDKey>
+size_t genericFactory<manufacturedObj, classIDKey>::slot(const classIDKey &k, size_t s) const
+{
+  // mixes the hash of the key with the seed (as in splitmix64)
+  unsigned long long x = std::hash<classIDKey>()(k) ^ s;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return size_t(x) & (table.size() - 1);
+}
+
+// Looks for a seed that puts every key in its own slot: with at
+// least twice as many slots as keys, a few seeds are enough;
+// after 64 of them, the table is doubled.
+template <class manufacturedObj, typename classIDKey>
+void genericFactory<manufacturedObj, classIDKey>::freeze() const
+{
+  size_t size = 8;
+  while (size < 2 * registry.size()) size *= 2;
+
+  for (seed = 1; ; ++seed) {
+    if (seed % 64 == 0) size *= 2;
+    table.assign(size, 0);
+
+    size_t i = 0;
+    for (; i < registry.size(); ++i) {
+      unsigned &t = table[slot(registry[i].key, seed)];
+      if (t != 0) break;
+      t = unsigned(i + 1);
+    }
+    if (i == registry.size()) break;
+  }
 }
 
-// The create function simple looks up the class ID, and if it's in the list,
-// the statement "(*i).second();" calls the function.
 template <class manufacturedObj, typename classIDKey>
-std::auto_ptr<manufacturedObj> genericFactory<manufacturedObj, classIDKey>::create(const classIDKey &className, std::vector<std::string> &parms) const
+typename genericFactory<manufacturedObj, classIDKey>::BASE_CREATE_FN
+genericFactory<manufacturedObj, classIDKey>::find(const classIDKey &className) const
 {
-  std::auto_ptr<manufacturedObj> ret(0);
-  
-  typename FN_REGISTRY::const_iterator regEntry=registry.find(className);
-  if (regEntry != registry.end()) {
-    return (*regEntry).second(parms);
+  if (!frozen.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> g(lock);
+    if (!frozen.load(std::memory_order_relaxed)) {
+      freeze();
+      frozen.store(true, std::memory_order_release);
+    }
   }
-  return ret;
+
+  unsigned t = table[slot(className, seed)];
+  if (t != 0 && registry[t - 1].key == className) return registry[t - 1].fn;
+  return 0;
+}
+
+// The create function simple looks up the class ID, and if it's in the list,
+// calls the function.
+template <class manufacturedObj, typename classIDKey>
+std::unique_ptr<manufacturedObj> genericFactory<manufacturedObj, classIDKey>::create(const classIDKey &className, std::vector<std::string> &parms) const
+{
+  BASE_CREATE_FN fn = find(className);
+  return std::unique_ptr<manufacturedObj>(fn ? fn(parms) : 0);
 }
 
 // Helper template to make registration painless and simple.
@@ -120,9 +197,9 @@ template <class ancestorType,
           typename classIDKey=defaultIDKeyType>
 class registerInFactory {
   public:
-  static std::auto_ptr<ancestorType> createInstance(std::vector<std::string> &par)
+  static ancestorType *createInstance(std::vector<std::string> &par)
   {
-    return std::auto_ptr<ancestorType>(manufacturedObj::createInstance(par));
+    return manufacturedObj::createInstance(par);
   }
   registerInFactory(const classIDKey &id)
   {
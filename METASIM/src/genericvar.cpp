@@ -29,7 +29,17 @@
  * *** empty log message ***
  * 
  */
+#include <algorithm>
 #include <cmath>
+#include <fstream>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include <genericvar.hpp>
 #include <strtoken.hpp>
@@ -41,7 +51,157 @@ namespace MetaSim {
 
     static const double PDF_ERR = 0.00000000001;
 
-    void GenericVar::readPDF(ifstream &f, int mode)
+    static const char PDF_MAGIC[8] = { 'R', 'T', 'S', 'I', 'M', 'P', 'D', 'F' };
+    static const uint32_t PDF_VERSION = 1;
+    static const size_t PDF_HEADER = 16;
+
+    AliasTable::AliasTable(const map<int, double> &pdf) :
+        _pstore(pdf.size(), 1.0), _astore(pdf.size(), 0), _vstore(),
+        _map(0), _mapLen(0)
+    {
+        const size_t n = pdf.size();
+        vector<double> scaled;
+        vector<size_t> small, large;
+
+        for (map<int, double>::const_iterator i = pdf.begin(); 
+             i != pdf.end(); ++i) {
+            _vstore.push_back(i->first);
+            scaled.push_back(i->second * n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (scaled[i] < 1) small.push_back(i);
+            else large.push_back(i);
+        }
+
+        // Vose's algorithm: each small bin is completed with the
+        // probability of a large one
+        while (!small.empty() && !large.empty()) {
+            size_t s = small.back(), l = large.back();
+            small.pop_back();
+            _pstore[s] = scaled[s];
+            _astore[s] = uint32_t(l);
+            scaled[l] = (scaled[l] + scaled[s]) - 1;
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // the remaining bins (only rounding errors) are full
+        for (size_t i = 0; i < large.size(); ++i) _pstore[large[i]] = 1;
+        for (size_t i = 0; i < small.size(); ++i) _pstore[small[i]] = 1;
+
+        setStorage();
+    }
+
+    void AliasTable::setStorage()
+    {
+        _n = _vstore.size();
+        _prob = &_pstore[0];
+        _alias = &_astore[0];
+        _value = &_vstore[0];
+    }
+
+    AliasTable::AliasTable(const string &binfile) :
+        _pstore(), _astore(), _vstore(), _map(0), _mapLen(0)
+    {
+        ifstream f(binfile.c_str(), ios::binary);
+        char magic[8];
+        uint32_t hdr[2];
+
+        if (!f.is_open()) 
+            throw RandomVar::Exc(RandomVar::Exc::_FILEOPEN + binfile, 
+                                 "AliasTable");
+        f.read(magic, 8);
+        f.read((char *)hdr, sizeof(hdr));
+        if (!f || !equal(magic, magic + 8, PDF_MAGIC) || 
+            hdr[0] != PDF_VERSION || hdr[1] == 0)
+            throw RandomVar::Exc(RandomVar::Exc::_WRONGPDF, "AliasTable");
+
+        size_t n = hdr[1];
+        size_t len = PDF_HEADER + n * (sizeof(double) + 2 * sizeof(uint32_t));
+
+#ifndef _WIN32
+        f.close();
+        int fd = open(binfile.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < len) {
+            if (fd >= 0) close(fd);
+            throw RandomVar::Exc(RandomVar::Exc::_WRONGPDF, "AliasTable");
+        }
+        void *m = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED)
+            throw RandomVar::Exc(RandomVar::Exc::_FILEOPEN + binfile, 
+                                 "AliasTable");
+        _map = m;
+        _mapLen = len;
+
+        const char *base = (const char *)m + PDF_HEADER;
+        _n = n;
+        _prob = (const double *)base;
+        _alias = (const uint32_t *)(base + n * sizeof(double));
+        _value = (const int32_t *)(base + n * (sizeof(double) + 
+                                               sizeof(uint32_t)));
+#else
+        _pstore.resize(n);
+        _astore.resize(n);
+        _vstore.resize(n);
+        f.read((char *)&_pstore[0], n * sizeof(double));
+        f.read((char *)&_astore[0], n * sizeof(uint32_t));
+        f.read((char *)&_vstore[0], n * sizeof(int32_t));
+        if (!f) 
+            throw RandomVar::Exc(RandomVar::Exc::_WRONGPDF, "AliasTable");
+        setStorage();
+#endif
+        for (size_t i = 0; i < _n; ++i)
+            if (_alias[i] >= _n) {
+#ifndef _WIN32
+                munmap(_map, _mapLen);
+#endif
+                throw RandomVar::Exc(RandomVar::Exc::_WRONGPDF, 
+                                     "AliasTable");
+            }
+    }
+
+    AliasTable::~AliasTable()
+    {
+#ifndef _WIN32
+        if (_map != 0) munmap(_map, _mapLen);
+#endif
+    }
+
+    void AliasTable::save(const string &binfile) const
+    {
+        ofstream f(binfile.c_str(), ios::binary);
+        uint32_t hdr[2] = { PDF_VERSION, uint32_t(_n) };
+
+        if (!f.is_open()) 
+            throw RandomVar::Exc(RandomVar::Exc::_FILEOPEN + binfile, 
+                                 "AliasTable");
+        f.write(PDF_MAGIC, 8);
+        f.write((const char *)hdr, sizeof(hdr));
+        f.write((const char *)_prob, _n * sizeof(double));
+        f.write((const char *)_alias, _n * sizeof(uint32_t));
+        f.write((const char *)_value, _n * sizeof(int32_t));
+    }
+
+    bool AliasTable::isBinary(const string &file)
+    {
+        ifstream f(file.c_str(), ios::binary);
+        char magic[8];
+        f.read(magic, 8);
+        return f && equal(magic, magic + 8, PDF_MAGIC);
+    }
+
+    /*-----------------------------------------------------*/
+
+    namespace {
+        // tables already loaded, by file name
+        std::mutex tablesMutex;
+        map<string, std::weak_ptr<const AliasTable> > tables;
+    }
+
+    void GenericVar::readPDF(ifstream &f, map<int, double> &pdf, int mode)
     {
         int n;
         double p;
@@ -55,12 +215,12 @@ namespace MetaSim {
             cout << n << "\t" << p << "\n";
 #endif
             if (!f.eof()) {
-                if (_pdf[n] != 0) {
+                if (pdf[n] != 0) {
                     string errMsg = Exc::_WRONGPDF + string("\n");
                     throw Exc(errMsg, "GenericVar");
                 }
                 sum += p;
-                _pdf[n] = p;
+                pdf[n] = p;
             }
         }
 
@@ -72,9 +232,9 @@ namespace MetaSim {
         if (sum < (1.0 - PDF_ERR)) {
             cerr << "Warning: PDF values sum to " << sum << " < 1\n";
             if (mode == 0) {
-                _pdf[n] += (1 - sum);
+                pdf[n] += (1 - sum);
             } else {
-                _pdf[1] += (1 - sum);
+                pdf[1] += (1 - sum);
             }
         }
     }    
@@ -83,6 +243,17 @@ namespace MetaSim {
     GenericVar::GenericVar(const std::string &fileName) : 
         UniformVar(0, 1, NULL)
     {
+        std::lock_guard<std::mutex> lock(tablesMutex);
+
+        _table = tables[fileName].lock();
+        if (_table) return;
+
+        if (AliasTable::isBinary(fileName)) {
+            _table = std::make_shared<const AliasTable>(fileName);
+            tables[fileName] = _table;
+            return;
+        }
+
         ifstream inFile(fileName.c_str());
 
         if (!inFile.is_open()) {
@@ -90,29 +261,40 @@ namespace MetaSim {
             throw Exc(errMsg, "GenericVar");
         }
 
-        readPDF(inFile);
+        map<int, double> pdf;
+        readPDF(inFile, pdf);
+        if (pdf.empty()) {
+            string errMsg = Exc::_WRONGPDF + string("\n");
+            throw Exc(errMsg, "GenericVar");
+        }
+
+        _table = std::make_shared<const AliasTable>(pdf);
+        tables[fileName] = _table;
     }
 
     double GenericVar::get()
     {
-        double v, CDF;
-        map<int, double>::iterator i;
-
-        v = UniformVar::get();
-        CDF = 0;
+        return _table->sample(UniformVar::get());
+    }
+    
+    void GenericVar::convert(const string &textfile, const string &binfile)
+    {
+        ifstream inFile(textfile.c_str());
 
-        for(i = _pdf.begin(); i != _pdf.end(); i++) {
-            CDF = CDF + i->second;
-            if (CDF > v) {
-                return i->first;
-            }
+        if (!inFile.is_open()) {
+            string errMsg = Exc::_FILEOPEN  + string(textfile) + "\n";
+            throw Exc(errMsg, "GenericVar");
         }
 
-        /* We cannot arrive here... */
-        /* It means that v > 1 or that lim_{i -> \infty} CDF < 1... */
-        throw Exc("Panic", "GenericVar");
+        map<int, double> pdf;
+        readPDF(inFile, pdf);
+        if (pdf.empty()) {
+            string errMsg = Exc::_WRONGPDF + string("\n");
+            throw Exc(errMsg, "GenericVar");
+        }
+        AliasTable(pdf).save(binfile);
     }
-    
+
     RandomVar *GenericVar::createInstance(vector<string> &par)
     {
         if (par.size() != 1) 
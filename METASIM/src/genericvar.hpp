@@ -49,19 +49,92 @@
 #ifndef __GENERICVAR_HPP__
 #define __GENERICVAR_HPP__
 
+#include <cstddef>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <stdint.h>
+#include <vector>
 
 #include <randomvar.hpp>
 
 namespace MetaSim {
 
     /**
-       This random variable is used to model a generic distribution.
+       Alias table (Walker, Vose) of a discrete distribution: after
+       the construction, which costs O(n), each sample costs O(1),
+       independently of the number of values of the distribution.
+
+       A table can be saved in a compact binary file, which is
+       later mapped read-only in memory (with mmap(), where
+       available), so that no parsing is needed at startup and
+       the processes reading the same file share its pages. The
+       file is made of a 16 bytes header (the magic string
+       "RTSIMPDF", the version and the number n of values, as
+       32-bit integers), followed by the n probabilities
+       (doubles), the n aliases and the n values (32-bit
+       integers), in the byte order of the machine.
+    */
+    class AliasTable {
+        // storage used when the table is built in memory
+        std::vector<double> _pstore;
+        std::vector<uint32_t> _astore;
+        std::vector<int32_t> _vstore;
+
+        // mapped file, when the table is read from a binary file
+        void *_map;
+        size_t _mapLen;
+
+        const double *_prob;
+        const uint32_t *_alias;
+        const int32_t *_value;
+        size_t _n;
+
+        AliasTable(const AliasTable &);
+        AliasTable &operator=(const AliasTable &);
+
+        void setStorage();
+    public:
+        /// pdf contains the pairs (value, probability)
+        AliasTable(const std::map<int, double> &pdf);
+
+        /// Maps a binary file, created with save()
+        explicit AliasTable(const std::string &binfile);
+
+        ~AliasTable();
+
+        /// Returns the value corresponding to u, uniform in [0, 1)
+        inline int sample(double u) const {
+            double x = u * _n;
+            size_t i = size_t(x);
+            if (i >= _n) i = _n - 1;
+            if (x - i < _prob[i]) return _value[i];
+            else return _value[_alias[i]];
+        }
+
+        size_t size() const { return _n; }
+
+        /// Returns true if the table has been mapped from a file
+        bool isMapped() const { return _map != 0; }
+
+        /// Saves the table in binary format
+        void save(const std::string &binfile) const;
+
+        /// Returns true if file is a binary table
+        static bool isBinary(const std::string &file);
+    };
+
+    /**
+       This random variable is used to model a generic distribution,
+       read from a file of pairs (value, probability), or from a
+       binary file created by convert() (see AliasTable). Samples
+       are extracted with an alias table, which is shared by all
+       the variables created from the same file.
     */
     class GenericVar: public UniformVar {
-        std::map<int, double> _pdf;
-        void readPDF(std::ifstream &f, int mode = 0);// throw(Exc);
+        std::shared_ptr<const AliasTable> _table;
+        static void readPDF(std::ifstream &f, std::map<int, double> &pdf,
+                            int mode = 0);// throw(Exc);
     public:
         GenericVar(const std::string &filename);
 
@@ -69,6 +142,16 @@ namespace MetaSim {
   
         virtual double get(void);
 
+        /// Returns the number of values of the distribution
+        size_t getSize() const { return _table->size(); }
+
+        /**
+           Converts a text PDF file (pairs value, probability) in
+           the binary format, that can be read much faster.
+        */
+        static void convert(const std::string &textfile, 
+                            const std::string &binfile);
+
         static RandomVar *createInstance(vector<string> &par);
   };
 
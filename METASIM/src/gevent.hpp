@@ -90,6 +90,37 @@ namespace MetaSim {
 	}
     };
 
+    /**
+       \ingroup metasim_ee
+
+       Like GEvent<X>, but the handler is a template argument
+       instead of a pointer stored in the object. The call in
+       doit() is resolved at compile time, so the handler can be
+       inlined, and the event is one pointer smaller:
+
+       <pre>
+       class Server : public Entity {
+           void onSched(Event *e);
+           StaticGEvent<Server, &Server::onSched> _schedEvt;
+           ...
+       };
+       </pre>
+
+       Note that the handler must be declared before the event
+       member.
+    */
+    template<class X, void (X::*H)(Event *)>
+    class StaticGEvent : public Event {
+	X *_obj;
+
+    public:
+	StaticGEvent(X *obj, int p = Event::_DEFAULT_PRIORITY) :
+	    Event(p), _obj(obj) {}
+
+	/// Calls handler H on the object.
+	virtual void doit() { (_obj->*H)(this); }
+    };
+
     /**
        \ingroup metasim_ee
 
@@ -31,6 +31,8 @@
 #ifndef __HISTORY_HPP__
 #define __HISTORY_HPP__
 
+#include <stdint.h>
+#include <utility>
 #include <vector>
 
 /** 
@@ -38,7 +40,14 @@
  * can use deque<> and list<> as underlying container; it is coded
  * after the queue adapter, and it relys on the push_back(),
  * pop_front() interface; so any container implementing this can be
- * used in this way. */
+ * used in this way.
+ *
+ * The list is a ring of fixed capacity size(): a push overwrites the
+ * oldest value once the ring is full, so the memory does not depend
+ * on the number of values pushed. h[0] is the last value pushed; only
+ * the first count() values have been pushed (the others are the
+ * initial value). See history_window for the aggregates of the values
+ * in the ring. */
 template <class T>
 class history {
 public:
@@ -67,37 +76,39 @@ private:
   std::vector<T> c;
   size_type _size;
   int curr_pos;
+  size_type _count;
 
 public:
   history(size_type s) : 
-    c(s), _size(s), curr_pos(0) {}
+    c(s), _size(s), curr_pos(0), _count(0) {}
   history(size_type s, const T& v) : 
-    c(s, v), _size(s), curr_pos(0) {}
+    c(s, v), _size(s), curr_pos(0), _count(0) {}
   history(const history<T>& h) : 
-    c(h.c), _size(h._size), curr_pos(h.curr_pos) {}
+    c(h.c), _size(h._size), curr_pos(h.curr_pos), _count(h._count) {}
 	
   size_type size() const { return _size; }
-  void push_back(const T& v) 
-  { 
-    c[curr_pos] = v; curr_pos = (curr_pos + 1) % _size;
-  }
+
+  /// number of values pushed, up to size()
+  size_type count() const { return _count; }
+
+  bool full() const { return _count == _size; }
+
+  void push_back(const T& v) { push(v); }
   
   void push(const T& v)
   { 
-    c[curr_pos] = v; curr_pos = (curr_pos + 1) % _size;
-  }
-	
-  void push_back(T& v) 
-  { 
-    c[curr_pos] = v; curr_pos = (curr_pos + 1) % _size;
-  }
-  
-  void push(T& v)
-  { 
-    c[curr_pos] = v; curr_pos = (curr_pos + 1) % _size;
+    c[curr_pos] = v;
+    if (++curr_pos == int(_size)) curr_pos = 0;
+    if (_count < _size) ++_count;
   }
 
-  T operator[](int i) 
+  /// the value that the next push will overwrite
+  const T &oldest() const { return c[curr_pos]; }
+
+  /// forgets the values pushed (the ring keeps its capacity)
+  void clear() { curr_pos = 0; _count = 0; }
+
+  T operator[](int i) const
   { 
     int pos = curr_pos - 1 - i; if (pos < 0) pos += _size; return c[pos];
   }
@@ -107,6 +118,116 @@ public:
   {
     _size = c.size();
     curr_pos = 0;
+    _count = _size;
+  }
+};
+
+/**
+ * The last size() values of a series, with their sum, minimum and
+ * maximum kept up to date at every push, in constant time (amortized
+ * for the minimum and the maximum), and in constant memory: a moving
+ * window over a run of any length.
+ *
+ * The minimum and the maximum are kept with two monotonic queues of
+ * the values still in the window; the sum is computed again from the
+ * values each time the ring wraps, so that the rounding errors of
+ * the floating point types do not accumulate. T must be ordered by
+ * < and have + and -.
+ */
+template <class T>
+class history_window {
+public:
+  typedef typename history<T>::size_type size_type;
+
+private:
+  /// a queue of (sequence number, value), in a ring of fixed size
+  class mono_queue {
+    std::vector<std::pair<uint64_t, T> > _q;
+    size_type _head, _len;
+
+    size_type at(size_type i) const
+    { size_type p = _head + i; return p >= _q.size() ? p - _q.size() : p; }
+
+  public:
+    mono_queue(size_type s) : _q(s), _head(0), _len(0) {}
+
+    /// pushes v, after dropping the values that do not come before it
+    template <class Before>
+    void push(uint64_t seq, const T &v, Before before)
+    {
+      while (_len > 0 && !before(_q[at(_len - 1)].second, v)) --_len;
+      _q[at(_len)] = std::make_pair(seq, v);
+      ++_len;
+    }
+
+    /// drops the values older than seq
+    void expire(uint64_t seq)
+    {
+      while (_len > 0 && _q[_head].first < seq) {
+        if (++_head == _q.size()) _head = 0;
+        --_len;
+      }
+    }
+
+    const T &front() const { return _q[_head].second; }
+    void clear() { _head = _len = 0; }
+  };
+
+  static bool less(const T &a, const T &b) { return a < b; }
+  static bool greater(const T &a, const T &b) { return b < a; }
+
+  history<T> _h;
+  uint64_t _seq;
+  T _sum;
+  mono_queue _min, _max;
+
+public:
+  history_window(size_type s) :
+    _h(s, T()), _seq(0), _sum(), _min(s), _max(s) {}
+
+  size_type size() const { return _h.size(); }
+  size_type count() const { return _h.count(); }
+  bool full() const { return _h.full(); }
+  bool empty() const { return _h.count() == 0; }
+
+  void push(const T &v)
+  {
+    if (_h.full()) _sum = _sum - _h.oldest();
+    _h.push(v);
+    _sum = _sum + v;
+    ++_seq;
+    // the window holds the values from _seq - size() + 1 to _seq
+    uint64_t first = _seq > size() ? _seq - size() + 1 : 1;
+    _min.expire(first);
+    _max.expire(first);
+    _min.push(_seq, v, less);
+    _max.push(_seq, v, greater);
+    if (_seq % size() == 0) {
+      _sum = T();
+      for (size_type i = 0; i < _h.count(); ++i) _sum = _sum + _h[i];
+    }
+  }
+
+  void push_back(const T &v) { push(v); }
+
+  /// the i-th last value (0 == the last one), i < count()
+  T operator[](int i) const { return _h[i]; }
+
+  /// @name Aggregates of the values in the window (count() > 0)
+  //@{
+  T sum() const { return _sum; }
+  const T &min() const { return _min.front(); }
+  const T &max() const { return _max.front(); }
+  double mean() const { return double(_sum) / double(_h.count()); }
+  //@}
+
+  void clear()
+  {
+    _h.clear();
+    _seq = 0;
+    _sum = T();
+    _min.clear();
+    _max.clear();
   }
 };
 
@@ -0,0 +1,92 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <eventpool.hpp>
+#include <inbox.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    namespace {
+        /// the event of an action
+        class InboxEvent : public Event {
+            EventInbox::Action _action;
+        public:
+            explicit InboxEvent(EventInbox::Action &&a) : Event(), _action(std::move(a)) {}
+            void doit() { _action(); }
+        };
+    }
+
+    EventInbox::EventInbox() :
+        _head(0), _tail(new Node()), _received(0), _late(0)
+    {
+        _head.store(_tail, std::memory_order_relaxed);
+    }
+
+    EventInbox::~EventInbox()
+    {
+        while (_tail != 0) {
+            Node *n = _tail->next.load(std::memory_order_acquire);
+            delete _tail;
+            _tail = n;
+        }
+    }
+
+    void EventInbox::push(Node *n)
+    {
+        // a producer stopped between the exchange and the store
+        // hides the nodes after it until the store is done
+        Node *prev = _head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    void EventInbox::post(Tick t, const Action &action)
+    {
+        Node *n = new Node();
+        n->time = t;
+        n->action = action;
+        push(n);
+    }
+
+    void EventInbox::post(const Action &action)
+    {
+        Node *n = new Node();
+        n->now = true;
+        n->action = action;
+        push(n);
+    }
+
+    size_t EventInbox::drain()
+    {
+        size_t k = 0;
+        Tick now = SIMUL.getTime();
+        Node *n;
+        // the first node of the queue is a stub: the one drained
+        // last takes its place
+        while ((n = _tail->next.load(std::memory_order_acquire)) != 0) {
+            Tick t = n->time;
+            if (n->now) t = now;
+            else if (t < now) {
+                t = now;
+                _late++;
+            }
+            EventPool::create<InboxEvent>(std::move(n->action))->post(t, true);
+            delete _tail;
+            _tail = n;
+            k++;
+        }
+        _received += k;
+        return k;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,125 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __INBOX_HPP__
+#define __INBOX_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       Hands actions from other threads (monitors, co-simulators,
+       user interfaces) to a running simulation: any thread can
+       post() an action with a time, while the event loop of run()
+       and run_to() drains the inbox before each step (see
+       Simulation::setInbox()), turning each action into a
+       disposable event of the simulation.
+
+       The inbox is a lock-free multi-producer, single-consumer
+       queue: post() allocates a node and links it with one atomic
+       exchange, and never blocks; when the inbox is empty, the
+       loop pays a single atomic load per step. The actions are
+       executed in the thread of the simulation, so they can post
+       and drop events, activate tasks, and so on, as any other
+       event.
+
+       <pre>
+       EventInbox in;
+       SIMUL.setInbox(&in);
+       std::thread monitor([&]() {
+           in.post(5000, [&]() { task.activate(); });
+       });
+       SIMUL.run(100000);
+       </pre>
+
+       The times are checked against the current time of the
+       simulation when the action is drained: an action due in the
+       past is executed at the current time, and counted as late
+       (see getLate()). The actions of one thread are executed in
+       the order in which they are posted, if they have the same
+       time; with respect to the events already in the queue at
+       the same time and priority, they come last. When the loop
+       is paced (see WallClockPacer), an action is seen at the
+       next instant. The loop does not wait for the inbox: a
+       simulation whose queue is empty terminates.
+
+       An inbox follows one context; the actions left in it when
+       it is destroyed are discarded.
+    */
+    class EventInbox {
+    public:
+        typedef std::function<void ()> Action;
+
+        EventInbox();
+        ~EventInbox();
+
+        /**
+           Executes action at time t in the simulation. Can be
+           called by any thread, at any time.
+        */
+        void post(Tick t, const Action &action);
+
+        /// Executes action as soon as possible (at the current time)
+        void post(const Action &action);
+
+        /**
+           Called by the simulation thread: turns the actions
+           posted so far into events. Returns the number of
+           actions.
+        */
+        size_t drain();
+
+        /// True if there is nothing to drain (it may change at any time)
+        bool empty() const { return _tail->next.load(std::memory_order_acquire) == 0; }
+
+        /// Number of actions drained
+        uint64_t getReceived() const { return _received; }
+
+        /// Number of actions drained after their time
+        uint64_t getLate() const { return _late; }
+
+    private:
+        struct Node {
+            std::atomic<Node *> next;
+            Tick time;
+            bool now;
+            Action action;
+
+            Node() : next(0), time(0), now(false), action() {}
+        };
+
+        /// the last node pushed (producers)
+        std::atomic<Node *> _head;
+        char _pad[64 - sizeof(std::atomic<Node *>)];
+        /// the node before the first one to drain (consumer)
+        Node *_tail;
+
+        uint64_t _received;
+        uint64_t _late;
+
+        void push(Node *n);
+
+        EventInbox(const EventInbox &);
+        EventInbox &operator=(const EventInbox &);
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,139 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <stdint.h>
+
+#include <lzblock.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        const size_t MIN_MATCH = 4;
+        // the format requires the last 5 bytes to be literals, and
+        // the last match to start 12 bytes before the end
+        const size_t LAST_LITERALS = 5;
+        const size_t MF_LIMIT = 12;
+        const size_t MAX_OFFSET = 65535;
+        const int HASH_BITS = 12;
+
+        inline uint32_t read32(const char *p)
+        {
+            uint32_t x;
+            memcpy(&x, p, sizeof(x));
+            return x;
+        }
+
+        inline uint32_t hash(uint32_t x)
+        {
+            return (x * 2654435761U) >> (32 - HASH_BITS);
+        }
+
+        inline void putLength(vector<char> &dst, size_t len)
+        {
+            for (; len >= 255; len -= 255) dst.push_back(char(255));
+            dst.push_back(char(len));
+        }
+
+        // a sequence: literals [lit, lit + nl), then a match of ml
+        // bytes (none if ml == 0) at the given offset
+        void putSequence(vector<char> &dst, const char *lit, size_t nl,
+                         size_t offset, size_t ml)
+        {
+            size_t m = ml > 0 ? ml - MIN_MATCH : 0;
+            dst.push_back(char(((nl < 15 ? nl : 15) << 4) | 
+                               (m < 15 ? m : 15)));
+            if (nl >= 15) putLength(dst, nl - 15);
+            dst.insert(dst.end(), lit, lit + nl);
+            if (ml == 0) return;
+            dst.push_back(char(offset & 0xff));
+            dst.push_back(char(offset >> 8));
+            if (m >= 15) putLength(dst, m - 15);
+        }
+
+        inline size_t getLength(const unsigned char *src, size_t n, 
+                                size_t &ip, size_t len)
+        {
+            if (len < 15) return len;
+            unsigned char b;
+            do {
+                if (ip >= n) throw LZBlockExc("Truncated length");
+                b = src[ip++];
+                len += b;
+            } while (b == 255);
+            return len;
+        }
+    }
+
+    void lzCompress(const char *src, size_t n, vector<char> &dst)
+    {
+        dst.clear();
+        dst.reserve(n + n / 255 + 16);
+
+        size_t anchor = 0;
+        if (n > MF_LIMIT) {
+            vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+            size_t limit = n - MF_LIMIT;
+            size_t matchLimit = n - LAST_LITERALS;
+
+            for (size_t ip = 0; ip < limit; ) {
+                uint32_t h = hash(read32(src + ip));
+                int64_t ref = table[h];
+                table[h] = ip;
+                if (ref < 0 || ip - ref > MAX_OFFSET || 
+                    read32(src + ref) != read32(src + ip)) {
+                    ++ip;
+                    continue;
+                }
+                size_t len = MIN_MATCH;
+                while (ip + len < matchLimit && src[ref + len] == src[ip + len])
+                    ++len;
+                putSequence(dst, src + anchor, ip - anchor, ip - ref, len);
+                ip += len;
+                anchor = ip;
+            }
+        }
+        putSequence(dst, src + anchor, n - anchor, 0, 0);
+    }
+
+    void lzDecompress(const char *s, size_t n, char *dst, size_t size)
+    {
+        const unsigned char *src = reinterpret_cast<const unsigned char *>(s);
+        size_t ip = 0, op = 0;
+
+        while (ip < n) {
+            unsigned token = src[ip++];
+            size_t nl = getLength(src, n, ip, token >> 4);
+            if (ip + nl > n || op + nl > size) 
+                throw LZBlockExc("Literals out of the block");
+            memcpy(dst + op, src + ip, nl);
+            ip += nl;
+            op += nl;
+            if (ip == n) break;
+
+            if (ip + 2 > n) throw LZBlockExc("Truncated offset");
+            size_t offset = src[ip] | (size_t(src[ip + 1]) << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) 
+                throw LZBlockExc("Offset out of the block");
+            size_t ml = getLength(src, n, ip, token & 15) + MIN_MATCH;
+            if (op + ml > size) throw LZBlockExc("Match out of the block");
+            // the match can overlap the output
+            for (size_t i = 0; i < ml; ++i, ++op) dst[op] = dst[op - offset];
+        }
+        if (op != size) throw LZBlockExc("Wrong size of the block");
+    }
+
+} // namespace MetaSim
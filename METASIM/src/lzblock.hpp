@@ -0,0 +1,48 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __LZBLOCK_HPP__
+#define __LZBLOCK_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include <baseexc.hpp>
+
+namespace MetaSim {
+
+    /// Raised by lzDecompress() on a corrupted block
+    DECL_EXC(LZBlockExc, "LZBlock");
+
+    /**
+       \ingroup metasim_util
+
+       Compresses n bytes of src in dst (which is replaced), in the
+       LZ4 block format (greedy parsing, 64 KB window), so that
+       the blocks can also be read by the standard LZ4 tools. It is
+       meant for data with many repetitions, like the records of a
+       trace, where it is much faster than a general purpose
+       compressor.
+    */
+    void lzCompress(const char *src, size_t n, std::vector<char> &dst);
+
+    /**
+       Decompresses n bytes of src, a block produced by
+       lzCompress(), in exactly size bytes of dst. Throws
+       LZBlockExc if the block is corrupted.
+    */
+    void lzDecompress(const char *src, size_t n, char *dst, size_t size);
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,283 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <iomanip>
+#include <list>
+#include <mutex>
+#include <ostream>
+
+#include <memstats.hpp>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        // the categories are never destroyed: containers with a
+        // tracked allocator may be destroyed after main()
+        struct Registry {
+            mutex m;
+            list<MemStats::Category> cats;
+            ostream *report;
+
+            Registry() : m(), cats(), report(0) {}
+        };
+
+        Registry &registry()
+        {
+            static Registry *r = new Registry();
+            return *r;
+        }
+    }
+
+    MemStats::Category &MemStats::category(const string &n)
+    {
+        Registry &r = registry();
+        lock_guard<mutex> l(r.m);
+        for (list<Category>::iterator i = r.cats.begin(); 
+             i != r.cats.end(); ++i)
+            if (i->name == n) return *i;
+        r.cats.emplace_back(n);
+        return r.cats.back();
+    }
+
+    vector<MemStats::Category *> MemStats::getCategories()
+    {
+        Registry &r = registry();
+        lock_guard<mutex> l(r.m);
+        vector<Category *> v;
+        for (list<Category>::iterator i = r.cats.begin(); 
+             i != r.cats.end(); ++i)
+            v.push_back(&*i);
+        return v;
+    }
+
+    int64_t MemStats::getBytes(const string &n)
+    {
+        vector<Category *> v = getCategories();
+        for (size_t i = 0; i < v.size(); ++i)
+            if (v[i]->name == n) 
+                return v[i]->bytes.load(memory_order_relaxed);
+        return 0;
+    }
+
+    void MemStats::resetPeaks()
+    {
+        vector<Category *> v = getCategories();
+        for (size_t i = 0; i < v.size(); ++i)
+            v[i]->peak.store(v[i]->bytes.load(memory_order_relaxed),
+                             memory_order_relaxed);
+    }
+
+    void MemStats::print(ostream &os)
+    {
+        vector<Category *> v = getCategories();
+        int64_t bytes = 0, peak = 0;
+        uint64_t allocs = 0;
+
+        int64_t huge = 0, thp = 0;
+
+        os << left << setw(20) << "Category" << right
+           << setw(14) << "Bytes" << setw(14) << "Peak"
+           << setw(12) << "Allocs" << setw(14) << "Huge" 
+           << setw(14) << "THP" << "\n";
+        for (size_t i = 0; i < v.size(); ++i) {
+            int64_t b = v[i]->bytes.load(memory_order_relaxed);
+            int64_t p = v[i]->peak.load(memory_order_relaxed);
+            uint64_t a = v[i]->allocs.load(memory_order_relaxed);
+            int64_t h = v[i]->huge.load(memory_order_relaxed);
+            int64_t t = v[i]->thp.load(memory_order_relaxed);
+            os << left << setw(20) << v[i]->name << right
+               << setw(14) << b << setw(14) << p << setw(12) << a 
+               << setw(14) << h << setw(14) << t << "\n";
+            bytes += b;
+            peak += p;
+            allocs += a;
+            huge += h;
+            thp += t;
+        }
+        os << left << setw(20) << "Total" << right
+           << setw(14) << bytes << setw(14) << peak 
+           << setw(12) << allocs << setw(14) << huge 
+           << setw(14) << thp << endl;
+    }
+
+    void MemStats::setReport(ostream *os)
+    {
+        Registry &r = registry();
+        lock_guard<mutex> l(r.m);
+        r.report = os;
+    }
+
+    void MemStats::report()
+    {
+        ostream *os;
+        {
+            Registry &r = registry();
+            lock_guard<mutex> l(r.m);
+            os = r.report;
+        }
+        if (os) print(*os);
+    }
+
+    std::atomic<size_t> HugePages::_pages(0);
+
+    namespace {
+        std::atomic<int> hugeMode(HugePages::OFF);
+
+        /*
+          The pages mapped by HugePages, in an open addressing
+          table that is read without locks (by owns(), on every
+          delete of an event): an entry is the number of the page,
+          times 4, plus the kind of memory.
+          A removed entry becomes a tombstone.
+        */
+        const size_t TABLE = 1 << 16;
+        const uintptr_t EMPTY = 0, TOMB = 1;
+        enum { KIND_PLAIN, KIND_THP, KIND_HUGE };
+
+        std::atomic<uintptr_t> pageTable[TABLE];
+
+        size_t slot(uintptr_t page)
+        {
+            return size_t((page * 0x9E3779B97F4A7C15ULL) >> 48) & (TABLE - 1);
+        }
+
+        bool insertPage(uintptr_t page, int kind)
+        {
+            size_t s = slot(page);
+            for (size_t i = 0; i < TABLE; ++i, s = (s + 1) & (TABLE - 1)) {
+                uintptr_t v = pageTable[s].load(memory_order_relaxed);
+                if ((v == EMPTY || v == TOMB) &&
+                    pageTable[s].compare_exchange_strong(
+                        v, page * 4 + kind, memory_order_release))
+                    return true;
+            }
+            return false;
+        }
+
+        void removePage(uintptr_t page)
+        {
+            size_t s = slot(page);
+            for (size_t i = 0; i < TABLE; ++i, s = (s + 1) & (TABLE - 1)) {
+                uintptr_t v = pageTable[s].load(memory_order_acquire);
+                if (v == EMPTY) return;
+                if (v / 4 == page) {
+                    pageTable[s].store(TOMB, memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        uintptr_t pageOf(const void *p)
+        {
+            return reinterpret_cast<uintptr_t>(p) / HugePages::SIZE;
+        }
+    }
+
+    void HugePages::setMode(Mode m)
+    {
+        hugeMode.store(m, memory_order_relaxed);
+    }
+
+    HugePages::Mode HugePages::getMode()
+    {
+        return Mode(hugeMode.load(memory_order_relaxed));
+    }
+
+    uintptr_t HugePages::lookup(const void *p)
+    {
+        uintptr_t page = pageOf(p);
+        size_t s = slot(page);
+        for (size_t i = 0; i < TABLE; ++i, s = (s + 1) & (TABLE - 1)) {
+            uintptr_t v = pageTable[s].load(memory_order_acquire);
+            if (v == EMPTY) return 0;
+            if (v / 4 == page) return v;
+        }
+        return 0;
+    }
+
+    void *HugePages::map(size_t n, MemStats::Category &c)
+    {
+#ifdef __linux__
+        Mode m = getMode();
+        if (m == OFF) return 0;
+        n = round(n);
+
+        int kind = KIND_HUGE;
+        void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (m == EXPLICIT)
+            p = mmap(0, n, PROT_READ | PROT_WRITE, 
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (p == MAP_FAILED) {
+            // aligned on a huge page, so that the kernel can back
+            // all of it with huge pages
+            size_t len = n + SIZE;
+            char *q = static_cast<char *>(mmap(0, len, PROT_READ | PROT_WRITE,
+                                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (q == MAP_FAILED) return 0;
+            char *a = reinterpret_cast<char *>(
+                (reinterpret_cast<uintptr_t>(q) + SIZE - 1) & ~uintptr_t(SIZE - 1));
+            if (a > q) munmap(q, a - q);
+            if (q + len > a + n) munmap(a + n, (q + len) - (a + n));
+            p = a;
+            kind = KIND_PLAIN;
+#ifdef MADV_HUGEPAGE
+            if (madvise(p, n, MADV_HUGEPAGE) == 0) kind = KIND_THP;
+#endif
+        }
+
+        uintptr_t first = pageOf(p);
+        for (size_t i = 0; i < n / SIZE; ++i) {
+            if (!insertPage(first + i, kind)) {
+                // the table is full
+                while (i-- > 0) removePage(first + i);
+                munmap(p, n);
+                return 0;
+            }
+        }
+        _pages.fetch_add(n / SIZE, memory_order_relaxed);
+        if (kind == KIND_HUGE) c.huge.fetch_add(n, memory_order_relaxed);
+        else if (kind == KIND_THP) c.thp.fetch_add(n, memory_order_relaxed);
+        return p;
+#else
+        return 0;
+#endif
+    }
+
+    bool HugePages::unmap(void *p, size_t n, MemStats::Category &c)
+    {
+#ifdef __linux__
+        uintptr_t v = lookup(p);
+        if (v == 0) return false;
+        n = round(n);
+        if (v % 4 == KIND_HUGE) c.huge.fetch_sub(n, memory_order_relaxed);
+        else if (v % 4 == KIND_THP) c.thp.fetch_sub(n, memory_order_relaxed);
+
+        uintptr_t first = pageOf(p);
+        for (size_t i = 0; i < n / SIZE; ++i) removePage(first + i);
+        _pages.fetch_sub(n / SIZE, memory_order_relaxed);
+        munmap(p, n);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+} // namespace MetaSim
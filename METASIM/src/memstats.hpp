@@ -0,0 +1,275 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __MEMSTATS_HPP__
+#define __MEMSTATS_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <limits>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       Accounting of the memory allocated by the subsystems of the
+       simulator. Each subsystem is a category (declared with
+       DECL_MEM_CATEGORY), and its containers use a
+       TrackedAllocator, or its classes derive from MemTracked, so
+       that every allocation and deallocation updates the counters
+       of the category: the bytes in use, the peak, and the number
+       of allocations.
+
+       The counters are global (they sum all the contexts) and
+       are updated with relaxed atomic operations, which cost
+       little compared to the allocation itself. The report is
+       printed by print(), and at the end of every run by
+       Simulation::endSingleRun() when a stream has been set
+       with setReport().
+
+       <pre>
+       MemStats::setReport(&cerr);
+       SIMUL.run(100000);
+       </pre>
+    */
+    class MemStats {
+    public:
+        /// The counters of a category
+        struct Category {
+            std::string name;
+            std::atomic<int64_t> bytes;
+            std::atomic<int64_t> peak;
+            std::atomic<uint64_t> allocs;
+            /// bytes on explicit huge pages, and on memory advised
+            /// for transparent huge pages (see HugePages)
+            std::atomic<int64_t> huge;
+            std::atomic<int64_t> thp;
+
+            explicit Category(const std::string &n) :
+                name(n), bytes(0), peak(0), allocs(0), huge(0), thp(0) {}
+        };
+
+        /// The category with name n (created if needed)
+        static Category &category(const std::string &n);
+
+        /// All the categories, in order of creation
+        static std::vector<Category *> getCategories();
+
+        static void allocated(Category &c, size_t n) {
+            int64_t b = c.bytes.fetch_add(n, std::memory_order_relaxed) + n;
+            c.allocs.fetch_add(1, std::memory_order_relaxed);
+            int64_t p = c.peak.load(std::memory_order_relaxed);
+            while (b > p && !c.peak.compare_exchange_weak(
+                       p, b, std::memory_order_relaxed)) ;
+        }
+
+        static void freed(Category &c, size_t n) {
+            c.bytes.fetch_sub(n, std::memory_order_relaxed);
+        }
+
+        /// Bytes in use in category n (0 if it does not exist)
+        static int64_t getBytes(const std::string &n);
+
+        /// Sets the peaks at the current values
+        static void resetPeaks();
+
+        /// Prints a table of the categories (with their bytes on
+        /// huge pages), and their sums
+        static void print(std::ostream &os);
+
+        /// Prints the table at the end of each run on os (NULL
+        /// disables the report)
+        static void setReport(std::ostream *os);
+
+        /// Prints the table on the report stream, if any
+        static void report();
+    };
+
+    /**
+       Declares a category tag: a type whose static function
+       counters() returns the counters of the category named N.
+    */
+#define DECL_MEM_CATEGORY(TAG, N)                                    \
+    struct TAG {                                                     \
+        static MetaSim::MemStats::Category &counters() {             \
+            static MetaSim::MemStats::Category &c =                 \
+                MetaSim::MemStats::category(N);                      \
+            return c;                                                \
+        }                                                            \
+    }
+
+    DECL_MEM_CATEGORY(QueueMem, "event queue");
+    DECL_MEM_CATEGORY(EventMem, "events");
+    DECL_MEM_CATEGORY(EntityMem, "entity registry");
+    DECL_MEM_CATEGORY(TraceMem, "trace buffers");
+
+    /**
+       \ingroup metasim_util
+
+       Large blocks of memory on 2 MB pages, to reduce the misses
+       of the TLB on big event queues and models: the chunks of
+       the ModelArena, the pooled events (see EventPool) and the
+       blocks of a TrackedAllocator of at least THRESHOLD bytes
+       (e.g. the arrays of the event queues) are mapped here when
+       huge pages are enabled with setMode():
+
+       - EXPLICIT: mmap() with MAP_HUGETLB, from the pages reserved
+         by the system (vm.nr_hugepages); when there are none, as
+         TRANSPARENT;
+       - TRANSPARENT: a mapping aligned on 2 MB, advised with
+         madvise(MADV_HUGEPAGE), that the kernel backs with huge
+         pages if transparent huge pages are enabled;
+       - OFF (the default): nothing is mapped, and the memory
+         comes from operator new.
+
+       When a mapping fails, the memory comes from operator new.
+       The bytes obtained on huge pages, and those advised for
+       them, are counted in the huge and thp counters of the
+       category (see MemStats::print()). Huge pages are available
+       on Linux only: elsewhere, map() always returns NULL.
+
+       <pre>
+       HugePages::setMode(HugePages::EXPLICIT);
+       MemStats::setReport(&cerr);
+       SIMUL.run(100000);
+       </pre>
+    */
+    class HugePages {
+    public:
+        enum Mode { OFF, TRANSPARENT, EXPLICIT };
+
+        /// The size of a huge page
+        static const size_t SIZE = 2 * 1024 * 1024;
+
+        /// The blocks of a TrackedAllocator from this size on are mapped
+        static const size_t THRESHOLD = SIZE / 2;
+
+        /// Applies to the blocks allocated from now on
+        static void setMode(Mode m);
+        static Mode getMode();
+
+        /// n rounded up to a multiple of SIZE
+        static size_t round(size_t n) { return (n + SIZE - 1) / SIZE * SIZE; }
+
+        /**
+           Maps round(n) bytes, aligned on SIZE, and charges them
+           to the huge page counters of c (not to its bytes, which
+           are counted by the caller). Returns NULL if the mode is
+           OFF, or the mapping fails.
+        */
+        static void *map(size_t n, MemStats::Category &c);
+
+        /**
+           Unmaps the block p of n bytes, returned by map(); returns
+           false (and does nothing) if p was not.
+        */
+        static bool unmap(void *p, size_t n, MemStats::Category &c);
+
+        /// True if p is in a block returned by map()
+        static bool owns(const void *p) {
+            return _pages.load(std::memory_order_relaxed) != 0 && lookup(p) != 0;
+        }
+
+    private:
+        /// number of pages currently mapped
+        static std::atomic<size_t> _pages;
+
+        /// the entry of the page of p in the table of the pages (0 if none)
+        static uintptr_t lookup(const void *p);
+    };
+
+    /**
+       \ingroup metasim_util
+
+       A standard allocator that charges the memory to the
+       category Tag (see MemStats). The large blocks are mapped on
+       huge pages, if enabled (see HugePages).
+    */
+    template <class T, class Tag>
+    class TrackedAllocator {
+    public:
+        typedef T value_type;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template <class U>
+        struct rebind { typedef TrackedAllocator<U, Tag> other; };
+
+        TrackedAllocator() {}
+        template <class U>
+        TrackedAllocator(const TrackedAllocator<U, Tag> &) {}
+
+        T *allocate(size_t n, const void * = 0) {
+            size_t b = n * sizeof(T);
+            void *p = b >= HugePages::THRESHOLD ? 
+                HugePages::map(b, Tag::counters()) : 0;
+            if (p == 0) p = ::operator new(b);
+            MemStats::allocated(Tag::counters(), b);
+            return static_cast<T *>(p);
+        }
+
+        void deallocate(T *p, size_t n) {
+            size_t b = n * sizeof(T);
+            MemStats::freed(Tag::counters(), b);
+            if (b < HugePages::THRESHOLD || 
+                !HugePages::unmap(p, b, Tag::counters()))
+                ::operator delete(p);
+        }
+
+        size_t max_size() const {
+            return std::numeric_limits<size_t>::max() / sizeof(T);
+        }
+
+        bool operator==(const TrackedAllocator &) const { return true; }
+        bool operator!=(const TrackedAllocator &) const { return false; }
+    };
+
+    /**
+       \ingroup metasim_util
+
+       Base class of the classes whose objects, when allocated
+       with new, are charged to the category Tag (see MemStats).
+       The class must have a virtual destructor if objects are
+       deleted through a pointer to a base.
+    */
+    template <class Tag>
+    class MemTracked {
+    public:
+        static void *operator new(size_t n) {
+            void *p = ::operator new(n);
+            MemStats::allocated(Tag::counters(), n);
+            return p;
+        }
+
+        static void operator delete(void *p, size_t n) {
+            MemStats::freed(Tag::counters(), n);
+            ::operator delete(p);
+        }
+
+        static void *operator new(size_t, void *p) { return p; }
+        static void operator delete(void *, void *) {}
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -19,22 +19,47 @@
 #ifndef __METASIM_HPP__
 #define __METASIM_HPP__
 
+#include <asyncwriter.hpp>
 #include <baseexc.hpp>
 #include <basestat.hpp>
+#include <arena.hpp>
 #include <basetype.hpp>
+#include <campaign.hpp>
+#include <cosim.hpp>
+#include <ctmc.hpp>
 #include <debugstream.hpp>
+#include <engine.hpp>
 #include <entity.hpp>
 #include <event.hpp>
+#include <eventpool.hpp>
+#include <eventqueue.hpp>
 #include <factory.hpp>
 #include <genericvar.hpp>
 #include <gevent.hpp>
 #include <history.hpp>
+#include <inbox.hpp>
+#include <lzblock.hpp>
+#include <memstats.hpp>
+#include <pacer.hpp>
+#include <partition.hpp>
+#include <perfcounters.hpp>
 #include <plist.hpp>
+#include <probegroup.hpp>
+#include <profiler.hpp>
 #include <randomvar.hpp>
 #include <regvar.hpp>
+#include <resultstore.hpp>
+#include <simcontext.hpp>
+#include <simmetrics.hpp>
 #include <simul.hpp>
+#include <snapshots.hpp>
+#include <splitting.hpp>
+#include <stateimage.hpp>
 #include <strtoken.hpp>
 #include <tick.hpp>
+#include <timeintegral.hpp>
+#include <topology.hpp>
 #include <trace.hpp>
+#include <tracepoint.hpp>
 
 #endif
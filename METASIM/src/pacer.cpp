@@ -0,0 +1,133 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include <pacer.hpp>
+
+namespace MetaSim {
+
+    namespace {
+        int64_t wallNs()
+        {
+#ifndef _WIN32
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        void sleepUntil(int64_t ns)
+        {
+#ifndef _WIN32
+            struct timespec ts;
+            ts.tv_sec = ns / 1000000000;
+            ts.tv_nsec = ns % 1000000000;
+            // restarted if interrupted by a signal
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) != 0) ;
+#else
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns - wallNs()));
+#endif
+        }
+
+        void pinThread(int cpu)
+        {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void) cpu;
+#endif
+        }
+    }
+
+    WallClockPacer::WallClockPacer(double tickNs) :
+        _tickNs(tickNs), _spinNs(50000), _toleranceNs(100000), _cpu(-1),
+        _origin(0), _last(0), _started(false)
+    {
+        if (!(tickNs > 0)) throw PacerExc("The tick length must be positive");
+        clear();
+    }
+
+    void WallClockPacer::beginRun()
+    {
+        if (_cpu >= 0) pinThread(_cpu);
+        _origin = wallNs();
+        _last = 0;
+        _started = false;
+    }
+
+    void WallClockPacer::waitFor(Tick t)
+    {
+        // the other events of an instant already released
+        if (_started && t == _last) return;
+        _started = true;
+        _last = t;
+
+        int64_t due = _origin + int64_t(std::floor(double(t) * _tickNs));
+        int64_t now = wallNs();
+        if (now < due - _spinNs) {
+            sleepUntil(due - _spinNs);
+            now = wallNs();
+        }
+        while (now < due) now = wallNs();
+
+        int64_t late = now - due;
+        ++_instants;
+        if (late > _toleranceNs) ++_late;
+        _sum += late;
+        _sumSq += double(late) * late;
+        if (late > _max) _max = late;
+    }
+
+    double WallClockPacer::getMeanLateness() const
+    {
+        return _instants ? _sum / _instants : 0;
+    }
+
+    double WallClockPacer::getStdDevLateness() const
+    {
+        if (_instants < 2) return 0;
+        double m = getMeanLateness();
+        double v = (_sumSq - _instants * m * m) / (_instants - 1);
+        return v > 0 ? std::sqrt(v) : 0;
+    }
+
+    void WallClockPacer::write(std::ostream &os) const
+    {
+        os << "instants " << _instants << " late " << _late
+           << " mean " << getMeanLateness() << " stddev " << getStdDevLateness()
+           << " max " << _max << " ns" << std::endl;
+    }
+
+    void WallClockPacer::clear()
+    {
+        _instants = _late = 0;
+        _sum = _sumSq = 0;
+        _max = 0;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,131 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PACER_HPP__
+#define __PACER_HPP__
+
+#include <cstdint>
+#include <iosfwd>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    DECL_EXC(PacerExc, "WallClockPacer");
+
+    /**
+       \ingroup metasim_ee
+
+       Paces the event loop of run() and run_to() on the wall
+       clock (see Simulation::setPacer()), for hardware in the
+       loop: the events at time t are processed when the wall
+       clock, counted from the beginning of the run, reaches
+       t * getTickLength() nanoseconds.
+
+       The loop sleeps until a little before the instant (with
+       clock_nanosleep() on an absolute time, where available),
+       then spins for the rest, so the wake-up latency of the
+       scheduler does not add to the jitter. The lateness of each
+       instant (the time between the instant and the moment its
+       events are released, or 0 if the loop was on time) is
+       collected in the pacing statistics, and an instant is late
+       if it is more than the tolerance. When the simulation
+       falls behind, the events are processed at once, without
+       trying to recover the time lost.
+
+       <pre>
+       WallClockPacer p(1000000);   // 1 tick == 1 ms
+       p.setSpin(50000);            // spin for the last 50 us
+       p.pinTo(3);                  // the loop runs on CPU 3
+       SIMUL.setPacer(&p);
+       SIMUL.run(60000);
+       cout << p.getMeanLateness() << " " << p.getMaxLateness() << endl;
+       </pre>
+
+       The pacing is per instant, not per event: the events at
+       the same time are processed at once. The time skipped by
+       the fast-forward is not paced. An object follows one
+       context: the replicas of a parallel run are not paced.
+    */
+    class WallClockPacer {
+        double _tickNs;
+        int64_t _spinNs;
+        int64_t _toleranceNs;
+        int _cpu;
+
+        int64_t _origin;
+        Tick _last;
+        bool _started;
+
+        uint64_t _instants, _late;
+        double _sum, _sumSq;
+        int64_t _max;
+
+    public:
+        /**
+           Paces each tick to tickNs nanoseconds of wall clock.
+
+           @throws PacerExc if tickNs is not positive
+        */
+        explicit WallClockPacer(double tickNs);
+
+        double getTickLength() const { return _tickNs; }
+
+        /// The loop spins for the last ns nanoseconds before an instant
+        void setSpin(int64_t ns) { _spinNs = ns; }
+
+        /// An instant is late if it is released more than ns after its time
+        void setTolerance(int64_t ns) { _toleranceNs = ns; }
+
+        /**
+           Pins the thread that runs the loop on processor cpu (-1,
+           the default, leaves it free), at the beginning of each
+           run. Ignored where the affinity cannot be set.
+        */
+        void pinTo(int cpu) { _cpu = cpu; }
+
+        /// @name Called by the simulation
+        //@{
+        /// the wall clock of the run starts now, at time 0
+        void beginRun();
+
+        /// waits for the instant of time t
+        void waitFor(Tick t);
+        //@}
+
+        /// Number of instants paced
+        uint64_t getInstants() const { return _instants; }
+
+        /// Number of instants released after the tolerance
+        uint64_t getLateInstants() const { return _late; }
+
+        /// Mean lateness of the instants, in nanoseconds
+        double getMeanLateness() const;
+
+        /// Standard deviation of the lateness, in nanoseconds
+        double getStdDevLateness() const;
+
+        /// Maximum lateness, in nanoseconds
+        int64_t getMaxLateness() const { return _max; }
+
+        /// Writes the pacing statistics on a line
+        void write(std::ostream &os) const;
+
+        /// Resets the pacing statistics
+        void clear();
+    };
+
+} // namespace MetaSim
+
+#endif
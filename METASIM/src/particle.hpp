@@ -21,6 +21,8 @@
 #define __PARTICLE_HPP__
 
 namespace MetaSim {
+    class BaseStat;
+
     /**
        \ingroup metasim
 
@@ -35,8 +37,19 @@ namespace MetaSim {
         virtual ~ParticleInterface() {};
 
         virtual void probe() = 0;
+
+        /**
+           True if the particle feeds a stat: then the event calls
+           it only past the transitory (see
+           BaseStat::attachProbes()).
+        */
+        virtual bool isStat() const { return false; }
     };
 
+    /// Tells the stats from the other targets of a Particle
+    inline bool isStatTarget(const BaseStat *) { return true; }
+    inline bool isStatTarget(const void *) { return false; }
+
     /**
        A particle is a function object whose only job is to
        "connect" an event of a certain type (template parameter E) to a
@@ -99,6 +112,8 @@ namespace MetaSim {
         virtual void probe() {
             staptr_->probe(*evtptr_);
         }
+
+        virtual bool isStat() const { return isStatTarget(staptr_); }
     };
     /**
        @}
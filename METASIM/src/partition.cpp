@@ -0,0 +1,364 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <checkpoint.hpp>
+#include <event.hpp>
+#include <partition.hpp>
+#include <randomvar.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+#include <topology.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        /// the partitioned simulation and the partition being
+        /// simulated by the calling thread
+        thread_local PartitionedSim *_curSim = 0;
+        thread_local int _curPart = -1;
+
+        /// executes a message in the destination partition
+        class MessageEvt : public Event {
+            std::function<void ()> _action;
+        public:
+            // before any other event at the same time, so that the
+            // order does not depend on when the message was posted
+            MessageEvt(const std::function<void ()> &a) :
+                Event(_IMMEDIATE_PRIORITY), _action(a) {}
+            virtual void doit() { _action(); }
+        };
+
+        /// reusable barrier for a fixed number of threads
+        class Barrier {
+            std::mutex _m;
+            std::condition_variable _cv;
+            int _n, _count;
+            unsigned long _gen;
+        public:
+            explicit Barrier(int n) : _n(n), _count(0), _gen(0) {}
+            void wait() {
+                std::unique_lock<std::mutex> l(_m);
+                unsigned long g = _gen;
+                if (++_count == _n) {
+                    _count = 0;
+                    _gen++;
+                    _cv.notify_all();
+                }
+                else _cv.wait(l, [&] { return g != _gen; });
+            }
+        };
+    }
+
+    bool PartitionedSim::Message::operator<(const Message &m) const
+    {
+        if (time != m.time) return time < m.time;
+        if (src != m.src) return src < m.src;
+        return seq < m.seq;
+    }
+
+    PartitionedSim::PartitionedSim(int n, Tick lookahead) :
+        _parts(n), _lookahead(lookahead), _window(0), _rollbacks(0)
+    {
+        if (n < 1) throw Exc("At least one partition is needed");
+        if (lookahead < 1) throw Exc("The lookahead must be at least 1");
+
+        for (int p = 0; p < n; ++p) {
+            _parts[p].ctx.reset(new SimContext());
+            _parts[p].gen.reset(RandomVar::getGenerator()->clone());
+            _parts[p].gen->setStream(p);
+            _parts[p].sent = 0;
+            _parts[p].next = -1;
+        }
+    }
+
+    PartitionedSim::~PartitionedSim()
+    {
+        // the models must go before their contexts
+        for (size_t p = 0; p < _parts.size(); ++p) {
+            SimContext::Scope scope(_parts[p].ctx.get());
+            _parts[p].inbox.clear();
+            _parts[p].due.clear();
+            _parts[p].local.clear();
+            _parts[p].outbox.clear();
+            SIMUL.clearEventQueue();
+            _parts[p].model.reset();
+        }
+    }
+
+    SimContext *PartitionedSim::getContext(int p)
+    {
+        return _parts.at(p).ctx.get();
+    }
+
+    void PartitionedSim::build(const ModelBuilder &b)
+    {
+        for (size_t p = 0; p < _parts.size(); ++p) {
+            SimContext::Scope scope(_parts[p].ctx.get());
+            RandomGen *old = RandomVar::changeGenerator(_parts[p].gen.get());
+            try {
+                _parts[p].model = b(int(p));
+            } catch (...) {
+                RandomVar::changeGenerator(old);
+                throw;
+            }
+            RandomVar::changeGenerator(old);
+        }
+    }
+
+    int PartitionedSim::current()
+    {
+        return _curPart;
+    }
+
+    void PartitionedSim::send(int dest, Tick t, const std::function<void ()> &action)
+    {
+        if (_curSim == 0) throw Exc("send() called outside of a partition");
+        if (dest < 0 || dest >= _curSim->size()) throw Exc("Wrong destination partition");
+        if (t < SIMUL.getTime() + _curSim->_lookahead) 
+            throw Exc("Message within the lookahead");
+
+        Partition &src = _curSim->_parts[_curPart];
+        Message m;
+        m.time = t;
+        m.src = _curPart;
+        m.seq = src.sent++;
+        m.action = action;
+        src.outbox.push_back(make_pair(dest, m));
+    }
+
+    void PartitionedSim::runWindow(int p, Tick end)
+    {
+        Partition &part = _parts[p];
+        SimContext::Scope scope(part.ctx.get());
+        RandomGen *old = RandomVar::changeGenerator(part.gen.get());
+        _curSim = this;
+        _curPart = p;
+
+        try {
+            if (_window > _lookahead) {
+                if (part.saved) {
+                    // rollback: the messages sent by the previous
+                    // attempt are cancelled
+                    SIMUL.restore(*part.saved);
+                    part.sent = part.sentAtStart;
+                    part.outbox.clear();
+                }
+                else {
+                    part.saved.reset(new Checkpoint());
+                    try {
+                        SIMUL.checkpoint(*part.saved);
+                    } catch (Checkpoint::Exc &e) {
+                        // the rollback would not restore the model
+                        part.saved.reset();
+                        throw Exc(string("The optimistic mode needs a "
+                                         "model that supports checkpoints: ")
+                                  + e.what());
+                    }
+                    part.sentAtStart = part.sent;
+                }
+            }
+
+            vector<Message> in(part.due);
+            in.insert(in.end(), part.local.begin(), part.local.end());
+            sort(in.begin(), in.end());
+            for (size_t i = 0; i < in.size(); ++i)
+                (new MessageEvt(in[i].action))->post(in[i].time, true);
+
+            Event *first = Event::getFirst();
+            if (first != NULL && first->getTime() <= end) SIMUL.run_to(end);
+
+            first = Event::getFirst();
+            part.next = first != NULL ? first->getTime() : Tick(-1);
+        } catch (...) {
+            _curSim = 0;
+            _curPart = -1;
+            RandomVar::changeGenerator(old);
+            throw;
+        }
+
+        _curSim = 0;
+        _curPart = -1;
+        RandomVar::changeGenerator(old);
+    }
+
+    void PartitionedSim::deliver(Tick end)
+    {
+        // the messages due in the window are delivered at its start
+        for (size_t p = 0; p < _parts.size(); ++p) {
+            Partition &part = _parts[p];
+            vector<Message>::iterator i = part.inbox.begin();
+            while (i != part.inbox.end() && i->time <= end) ++i;
+            part.due.assign(part.inbox.begin(), i);
+            part.inbox.erase(part.inbox.begin(), i);
+            part.local.clear();
+            part.run = !part.due.empty() || 
+                (part.next >= 0 && part.next <= end);
+        }
+    }
+
+    bool PartitionedSim::exchangeLocal(Tick end)
+    {
+        // the messages due in the window, with the partitions that
+        // sent them in the last round
+        vector<vector<Message> > local(_parts.size());
+        vector<bool> changed(_parts.size(), false);
+        for (size_t s = 0; s < _parts.size(); ++s) {
+            vector<pair<int, Message> > &out = _parts[s].outbox;
+            for (size_t i = 0; i < out.size(); ++i) {
+                if (out[i].second.time > end) continue;
+                local[out[i].first].push_back(out[i].second);
+                if (_parts[s].run) changed[out[i].first] = true;
+            }
+        }
+
+        bool again = false;
+        for (size_t p = 0; p < _parts.size(); ++p) {
+            Partition &part = _parts[p];
+            sort(local[p].begin(), local[p].end());
+
+            // a message cancelled by a rollback also changes the input
+            bool same = local[p].size() == part.local.size();
+            for (size_t i = 0; same && i < local[p].size(); ++i)
+                same = !(local[p][i] < part.local[i]) && 
+                    !(part.local[i] < local[p][i]);
+
+            part.run = changed[p] || !same;
+            if (part.run) {
+                part.local.swap(local[p]);
+                _rollbacks++;
+                again = true;
+            }
+        }
+        return again;
+    }
+
+    void PartitionedSim::commit(Tick end)
+    {
+        // the messages due after the window go in the inboxes
+        for (size_t s = 0; s < _parts.size(); ++s) {
+            vector<pair<int, Message> > &out = _parts[s].outbox;
+            for (size_t i = 0; i < out.size(); ++i) 
+                if (out[i].second.time > end)
+                    _parts[out[i].first].inbox.push_back(out[i].second);
+            out.clear();
+        }
+        for (size_t p = 0; p < _parts.size(); ++p) {
+            Partition &part = _parts[p];
+            part.due.clear();
+            part.local.clear();
+            // fossil collection: the window is over
+            part.saved.reset();
+            sort(part.inbox.begin(), part.inbox.end());
+            if (!part.inbox.empty() && 
+                (part.next < 0 || part.inbox[0].time < part.next))
+                part.next = part.inbox[0].time;
+        }
+    }
+
+    unsigned long PartitionedSim::run(Tick length, int threads)
+    {
+        int n = size();
+        if (threads <= 0) threads = Topology::get().getDefaultThreads();
+        if (threads > n) threads = n;
+
+        Tick window = max(_window, _lookahead);
+        _rollbacks = 0;
+
+        for (int p = 0; p < n; ++p) {
+            SimContext::Scope scope(_parts[p].ctx.get());
+            SIMUL.initRuns(1);
+            SIMUL.initSingleRun();
+            Event *first = Event::getFirst();
+            _parts[p].next = first != NULL ? first->getTime() : Tick(-1);
+        }
+        commit(-1);
+
+        Barrier start(threads), done(threads);
+        Tick end = 0;
+        bool stop = false;
+        std::exception_ptr error;
+        std::mutex errMutex;
+        unsigned long windows = 0;
+
+        // thread w simulates the partitions w, w + threads, ...
+        auto simulate = [&](int w) {
+            for (int p = w; p < n; p += threads) {
+                if (!_parts[p].run) continue;
+                try {
+                    runWindow(p, end);
+                } catch (...) {
+                    std::lock_guard<std::mutex> l(errMutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+        };
+        auto work = [&](int w) {
+            for (;;) {
+                start.wait();
+                if (stop) return;
+                simulate(w);
+                done.wait();
+            }
+        };
+
+        vector<std::thread> pool;
+        for (int w = 1; w < threads; ++w) pool.push_back(std::thread(work, w));
+
+        for (;;) {
+            // the window starts at the first pending event
+            Tick first = -1;
+            for (int p = 0; p < n; ++p)
+                if (_parts[p].next >= 0 && (first < 0 || _parts[p].next < first))
+                    first = _parts[p].next;
+
+            if (error || first < 0 || first > length) {
+                stop = true;
+                start.wait();
+                break;
+            }
+            end = min(first + window - 1, length);
+            windows++;
+            deliver(end);
+
+            // after k rounds, the window is final up to
+            // first + k * lookahead - 1
+            for (Tick finalUpTo = first + _lookahead - 1; ; 
+                 finalUpTo += _lookahead) {
+                start.wait();
+                simulate(0);
+                done.wait();
+                if (error || finalUpTo >= end || !exchangeLocal(end)) break;
+            }
+            commit(end);
+        }
+        for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+
+        for (int p = 0; p < n; ++p) {
+            SimContext::Scope scope(_parts[p].ctx.get());
+            _parts[p].inbox.clear();
+            SIMUL.endSingleRun();
+        }
+
+        if (error) std::rethrow_exception(error);
+        return windows;
+    }
+
+} // namespace MetaSim
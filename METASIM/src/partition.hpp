@@ -0,0 +1,203 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PARTITION_HPP__
+#define __PARTITION_HPP__
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class Checkpoint;
+    class RandomGen;
+    class SimContext;
+
+    /**
+       \ingroup metasim_ee
+
+       A model split in partitions that interact only through
+       timestamped messages, simulated in parallel with
+       conservative synchronization.
+
+       Each partition is a separate simulation, with its own
+       context (see SimContext), event queue, clock and random
+       generator (stream p of a copy of the standard generator).
+       A partition sends a message to another one with send():
+       the message is an action executed in the destination
+       partition at a time that must be at least the lookahead
+       after the current time of the sender (for example, the
+       latency of a shared bus or of an inter-processor
+       interrupt).
+
+       The partitions advance in windows: a window starts at the
+       first pending event or message of all the partitions, and
+       is one lookahead long, so no message sent during a window
+       can be due in the same window. The partitions simulate the
+       window in parallel on a pool of threads; between two
+       windows the messages are delivered in the order (time,
+       sender, send order), so the results do not depend on the
+       number of threads.
+
+       When the lookahead is tiny with respect to the time
+       between two messages, the windows are too short to keep
+       the threads busy. With setOptimistic(), the windows are
+       longer than the lookahead and the partitions simulate them
+       speculatively: each partition saves its state at the start
+       of the window (see Checkpoint; the entities must save
+       their state, see Entity::saveState()), simulates the
+       window, and the messages sent within the window are
+       exchanged at the end. A partition whose input has changed
+       is brought back to the start of the window and simulates
+       it again, with the new messages; the messages it had sent
+       are cancelled. After n rounds the first n lookaheads of
+       the window are final, so a window takes at most (window /
+       lookahead) rounds, and only the partitions that actually
+       received messages run more than once. The start of the
+       window is the global virtual time: the state saved before
+       it is discarded when the window is over. The results are
+       the same as in the conservative mode.
+
+       In RTLIB, the tasks, RTKernel, MRTKernel, the processors,
+       the schedulers and the instructions save their state,
+       except BodyInstr. The servers, the resource managers and
+       ClusteredMRTKernel do not: a partition that holds one of
+       them can only be simulated in the conservative mode.
+
+       A typical use is a partitioned multiprocessor, with one
+       kernel per processor:
+
+       <pre>
+       PartitionedSim ps(128, 10);
+       ps.build([](int p) {
+           auto m = std::make_shared<Core>(p);
+           return std::shared_ptr<void>(m);
+       });
+       ps.run(1000000);
+       </pre>
+    */
+    class PartitionedSim {
+    public:
+        /// Builds the model of partition p in the current context
+        typedef std::function<std::shared_ptr<void> (int)> ModelBuilder;
+
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "PartitionedSim", "partition.cpp") {}
+        };
+
+        /**
+           @param n Number of partitions.
+           @param lookahead Minimum delay of a message (at least 1).
+        */
+        PartitionedSim(int n, Tick lookahead);
+        ~PartitionedSim();
+
+        /// Builds the model of every partition, in its context
+        void build(const ModelBuilder &b);
+
+        /**
+           Runs all the partitions from time 0 up to length, and
+           returns the number of windows.
+
+           @param threads Number of threads (0 means one for each
+           hardware thread).
+        */
+        unsigned long run(Tick length, int threads = 0);
+
+        /**
+           Called by an entity of a partition during the
+           simulation: executes action in partition dest at time
+           t. Throws an Exc if t is less than the current time of
+           the sender plus the lookahead, or if the caller is not
+           running in a partition.
+        */
+        static void send(int dest, Tick t, const std::function<void ()> &action);
+
+        /**
+           Selects the optimistic mode, with windows of the given
+           length (a multiple of the lookahead works best). A
+           length not greater than the lookahead selects the
+           conservative mode (the default). The events in the
+           queue at the start of a window cannot be disposable,
+           and the model must support checkpoints: otherwise
+           run() throws Exc at the first window, before simulating
+           it.
+        */
+        void setOptimistic(Tick window) { _window = window; }
+
+        /// Number of partition-windows simulated again after a rollback
+        unsigned long getRollbacks() const { return _rollbacks; }
+
+        /// The partition running in the calling thread, or -1
+        static int current();
+
+        int size() const { return int(_parts.size()); }
+
+        Tick getLookahead() const { return _lookahead; }
+
+        /// The context of partition p, to inspect its model
+        SimContext *getContext(int p);
+
+    private:
+        struct Message {
+            Tick time;
+            int src;
+            unsigned long seq;
+            std::function<void ()> action;
+            bool operator<(const Message &m) const;
+        };
+
+        struct Partition {
+            std::unique_ptr<SimContext> ctx;
+            std::unique_ptr<RandomGen> gen;
+            std::shared_ptr<void> model;
+            /// messages sent during the current window
+            std::vector<std::pair<int, Message> > outbox;
+            /// messages not yet due
+            std::vector<Message> inbox;
+            /// messages of previous windows due in this window
+            std::vector<Message> due;
+            /// messages sent in this window and due in it
+            std::vector<Message> local;
+            unsigned long sent;
+            /// time of the first pending event (-1 if none)
+            Tick next;
+
+            /// state at the start of the window (optimistic mode)
+            std::unique_ptr<Checkpoint> saved;
+            unsigned long sentAtStart;
+            /// to be simulated in the current round
+            bool run;
+        };
+
+        std::vector<Partition> _parts;
+        Tick _lookahead;
+        Tick _window;
+        unsigned long _rollbacks;
+
+        void runWindow(int p, Tick end);
+        void deliver(Tick end);
+        void commit(Tick end);
+        bool exchangeLocal(Tick end);
+    };
+
+} // namespace MetaSim
+
+#endif
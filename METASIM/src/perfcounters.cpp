@@ -0,0 +1,107 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <perfcounters.hpp>
+
+namespace MetaSim {
+
+#ifdef __linux__
+    namespace {
+        int openCounter(uint32_t type, uint64_t config, int group)
+        {
+            struct perf_event_attr a;
+            memset(&a, 0, sizeof(a));
+            a.size = sizeof(a);
+            a.type = type;
+            a.config = config;
+            a.disabled = group < 0;
+            a.exclude_kernel = 1;
+            a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_GROUP;
+            return int(syscall(__NR_perf_event_open, &a, 0, -1, group, 0));
+        }
+    }
+#endif
+
+    PerfCounters::PerfCounters() : _leader(-1), _n(0)
+    {
+        for (int i = 0; i < NUM_COUNTERS; ++i) _fd[i] = _slot[i] = -1;
+
+#ifdef __linux__
+        const uint32_t types[NUM_COUNTERS] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+        };
+        const uint64_t configs[NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        // the first counter that can be opened leads the group
+        for (int i = 0; i < NUM_COUNTERS; ++i) {
+            _fd[i] = openCounter(types[i], configs[i], _leader);
+            if (_fd[i] < 0) continue;
+            if (_leader < 0) _leader = _fd[i];
+            _slot[i] = _n++;
+        }
+        if (_leader >= 0) {
+            ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+#ifdef __linux__
+        for (int i = 0; i < NUM_COUNTERS; ++i) 
+            if (_fd[i] >= 0) close(_fd[i]);
+#endif
+    }
+
+    void PerfCounters::read(Values &v) const
+    {
+        memset(&v, 0, sizeof(v));
+#ifdef __linux__
+        if (_leader < 0) return;
+        // { nr, values[nr] }
+        uint64_t buf[NUM_COUNTERS + 1];
+        if (::read(_leader, buf, sizeof(buf)) < ssize_t(sizeof(uint64_t)))
+            return;
+        for (int i = 0; i < NUM_COUNTERS; ++i)
+            if (_slot[i] >= 0 && uint64_t(_slot[i]) < buf[0]) 
+                v.v[i] = buf[1 + _slot[i]];
+#endif
+    }
+
+    const char *PerfCounters::name(Counter c)
+    {
+        static const char *names[NUM_COUNTERS] = {
+            "cycles", "instructions", "L1D misses", "LLC misses", 
+            "branch misses"
+        };
+        return names[c];
+    }
+
+} // namespace MetaSim
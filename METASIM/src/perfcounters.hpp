@@ -0,0 +1,79 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PERFCOUNTERS_HPP__
+#define __PERFCOUNTERS_HPP__
+
+#include <stdint.h>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       The hardware performance counters of the calling thread,
+       read with perf_event_open() on Linux: cycles, instructions,
+       L1 data cache read misses, last level cache misses and
+       branch misses. The counters are opened as one group, so
+       that they are read together with a single system call.
+
+       On other systems, or when the kernel refuses access (see
+       /proc/sys/kernel/perf_event_paranoid) or the machine has
+       no PMU (as in many virtual machines), isAvailable() is
+       false and read() returns zeros. Counters that the CPU does
+       not support are simply missing (see has()).
+
+       The counters are per thread: the object must be read by
+       the thread that created it. Only user-space events are
+       counted.
+    */
+    class PerfCounters {
+    public:
+        typedef enum { CYCLES = 0, INSTRUCTIONS, L1D_MISSES, LLC_MISSES,
+                       BRANCH_MISSES, NUM_COUNTERS } Counter;
+
+        struct Values {
+            uint64_t v[NUM_COUNTERS];
+        };
+
+    private:
+        int _fd[NUM_COUNTERS];
+        /// position of each counter in the group read, or -1
+        int _slot[NUM_COUNTERS];
+        int _leader;
+        int _n;
+
+        PerfCounters(const PerfCounters &);
+        PerfCounters &operator=(const PerfCounters &);
+
+    public:
+        /// Opens and starts the counters
+        PerfCounters();
+        ~PerfCounters();
+
+        /// True if at least one counter is working
+        bool isAvailable() const { return _n > 0; }
+
+        /// True if counter c is working
+        bool has(Counter c) const { return _slot[c] >= 0; }
+
+        /// The current values (0 for the missing counters)
+        void read(Values &v) const;
+
+        /// A short name of counter c
+        static const char *name(Counter c);
+    };
+
+} // namespace MetaSim
+
+#endif
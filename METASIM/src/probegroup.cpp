@@ -0,0 +1,43 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <basestat.hpp>
+#include <event.hpp>
+#include <probegroup.hpp>
+#include <trace.hpp>
+
+namespace MetaSim {
+
+    ProbeGroup::~ProbeGroup()
+    {
+        for (small_vector<EventProbe *>::iterator i = _probes.begin();
+             i != _probes.end(); ++i)
+            delete *i;
+    }
+
+    void ProbeGroup::probe(Event *e)
+    {
+        for (small_vector<BaseStat *>::iterator i = _stats.begin();
+             i != _stats.end(); ++i)
+            (*i)->probe(e);
+
+        for (small_vector<EventProbe *>::iterator i = _probes.begin();
+             i != _probes.end(); ++i)
+            (*i)->probe(*e);
+
+        for (small_vector<Trace *>::iterator i = _traces.begin();
+             i != _traces.end(); ++i)
+            if ((*i)->accepts(e)) (*i)->record(e);
+    }
+
+} // namespace MetaSim
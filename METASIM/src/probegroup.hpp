@@ -0,0 +1,108 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PROBEGROUP_HPP__
+#define __PROBEGROUP_HPP__
+
+#include <smallvec.hpp>
+
+namespace MetaSim {
+
+    class BaseStat;
+    class Event;
+    class Trace;
+
+    /**
+       \ingroup metasim
+
+       The interface of a probe of a ProbeGroup: unlike a
+       ParticleInterface, it is not bound to an event, and it
+       receives the event that has been triggered.
+    */
+    class EventProbe {
+    public:
+        virtual ~EventProbe() {}
+
+        virtual void probe(Event &e) = 0;
+    };
+
+    class ProbeGroup;
+
+    /**
+       \ingroup metasim
+
+       The Particle of a ProbeGroup: connects the events of type E
+       that share the group to the object s, by calling
+       s->probe(E &). The group owns it.
+    */
+    template <class E, class S>
+    class GroupParticle : public EventProbe {
+        S *staptr_;
+    public:
+        GroupParticle(ProbeGroup *g, S *s);
+
+        virtual void probe(Event &e) { staptr_->probe(static_cast<E &>(e)); }
+    };
+
+    /**
+       \ingroup metasim
+
+       A set of stats, particles and traces shared by many events
+       (see Event::setProbeGroup()). The events created from a
+       prototype, one per message or job, share the group of the
+       prototype by pointer, so that a clone has nothing to copy
+       and, taken from an EventPool, nothing to allocate:
+
+       <pre>
+       ProbeGroup g;
+       new GroupParticle<MsgEvt, MyStat>(&g, &stat);
+       proto.setProbeGroup(&g);
+       ...
+       EventPool::create<MsgEvt>(proto)->post(t, true);
+       </pre>
+
+       The group must outlive the events that refer to it. It
+       deletes its particles, not its stats and traces.
+    */
+    class ProbeGroup {
+        small_vector<BaseStat *> _stats;
+        small_vector<EventProbe *> _probes;
+        small_vector<Trace *> _traces;
+
+        ProbeGroup(const ProbeGroup &);
+        ProbeGroup &operator=(const ProbeGroup &);
+    public:
+        ProbeGroup() : _stats(), _probes(), _traces() {}
+
+        ~ProbeGroup();
+
+        void addStat(BaseStat *s) { _stats.push_back(s); }
+
+        /// Adds p, which the group will delete
+        void addProbe(EventProbe *p) { _probes.push_back(p); }
+
+        void addTrace(Trace *t) { _traces.push_back(t); }
+
+        /// Calls the probes of the group on e, after those of e
+        void probe(Event *e);
+    };
+
+    template <class E, class S>
+    GroupParticle<E, S>::GroupParticle(ProbeGroup *g, S *s) : staptr_(s)
+    {
+        g->addProbe(this);
+    }
+
+} // namespace MetaSim
+
+#endif
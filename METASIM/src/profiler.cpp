@@ -0,0 +1,297 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <typeinfo>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <event.hpp>
+#include <profiler.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        uint64_t wallNanos()
+        {
+            return chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        inline uint64_t clockNow()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return wallNanos();
+#endif
+        }
+
+        string demangle(const char *n)
+        {
+#if defined(__GNUC__)
+            int status;
+            char *d = abi::__cxa_demangle(n, 0, 0, &status);
+            if (status == 0 && d) {
+                string s(d);
+                free(d);
+                return s;
+            }
+#endif
+            return n;
+        }
+
+        int log2(uint64_t x)
+        {
+            int i = 0;
+            while (x > 1 && i < EventProfiler::BUCKETS - 1) {
+                x >>= 1;
+                i++;
+            }
+            return i;
+        }
+    }
+
+    EventProfiler::EventProfiler(size_t sampleEvery) :
+        _index(), _entries(), _every(sampleEvery > 0 ? sampleEvery : 1),
+        _steps(0), _depthSum(0), _depthMax(0), _samples(), _clock0(0), 
+        _wall0(0), _out(0), _pmc(0), _phases(), _phase(-1), _phaseWall(0),
+        _phaseStart()
+    {
+    }
+
+    EventProfiler::Entry &EventProfiler::entry(const Event *e)
+    {
+        type_index t(typeid(*e));
+        unordered_map<type_index, size_t>::iterator i = _index.find(t);
+        if (i != _index.end()) return _entries[i->second];
+
+        Entry n;
+        n.count = n.posted = n.drops = n.cost = n.sampled = 0;
+        fill(n.hist, n.hist + BUCKETS, 0);
+        fill(n.counters, n.counters + PerfCounters::NUM_COUNTERS, 0);
+        n.name = demangle(t.name());
+        _index[t] = _entries.size();
+        _entries.push_back(n);
+        return _entries.back();
+    }
+
+    void EventProfiler::run(Event *e, size_t depth)
+    {
+        if (_steps++ == 0) {
+            _clock0 = clockNow();
+            _wall0 = wallNanos();
+        }
+        _depthSum += depth;
+        if (depth > _depthMax) _depthMax = depth;
+        bool sample = _steps % _every == 1 || _every == 1;
+        if (sample) _samples.push_back(make_pair(e->getTime(), depth));
+
+        // the entry first: action() may post a new class of events
+        Entry *en = &entry(e);
+        size_t k = en - &_entries[0];
+
+        if (sample && _pmc) {
+            PerfCounters::Values v0, v1;
+            _pmc->read(v0);
+            uint64_t t0 = clockNow();
+            e->action();
+            uint64_t c = clockNow() - t0;
+            _pmc->read(v1);
+
+            Entry &x = _entries[k];
+            x.count++;
+            x.cost += c;
+            x.hist[log2(c)]++;
+            x.sampled++;
+            for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i)
+                x.counters[i] += v1.v[i] - v0.v[i];
+            return;
+        }
+
+        uint64_t t0 = clockNow();
+        e->action();
+        uint64_t c = clockNow() - t0;
+
+        Entry &x = _entries[k];
+        x.count++;
+        x.cost += c;
+        x.hist[log2(c)]++;
+    }
+
+    void EventProfiler::beginPhase(const string &name)
+    {
+        endPhase();
+
+        size_t i = 0;
+        while (i < _phases.size() && _phases[i].name != name) ++i;
+        if (i == _phases.size()) {
+            Phase p;
+            p.name = name;
+            p.calls = p.nanos = 0;
+            fill(p.counters, p.counters + PerfCounters::NUM_COUNTERS, 0);
+            _phases.push_back(p);
+        }
+        _phase = int(i);
+        if (_pmc) _pmc->read(_phaseStart);
+        _phaseWall = wallNanos();
+    }
+
+    void EventProfiler::endPhase()
+    {
+        if (_phase < 0) return;
+
+        uint64_t w = wallNanos();
+        Phase &p = _phases[_phase];
+        p.calls++;
+        p.nanos += w - _phaseWall;
+        if (_pmc) {
+            PerfCounters::Values v;
+            _pmc->read(v);
+            for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i)
+                p.counters[i] += v.v[i] - _phaseStart.v[i];
+        }
+        _phase = -1;
+    }
+
+    void EventProfiler::reset()
+    {
+        _index.clear();
+        _entries.clear();
+        _steps = 0;
+        _depthSum = 0;
+        _depthMax = 0;
+        _samples.clear();
+        _phases.clear();
+        _phase = -1;
+    }
+
+    double EventProfiler::getMeanDepth() const
+    {
+        return _steps > 0 ? _depthSum / _steps : 0;
+    }
+
+    double EventProfiler::getNanosPerUnit() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t c = clockNow() - _clock0, w = wallNanos() - _wall0;
+        return (_steps > 0 && c > 0) ? double(w) / c : 0;
+#else
+        return 1;
+#endif
+    }
+
+    namespace {
+        // the upper bound (in units) under which a fraction q of the
+        // events fall
+        double quantile(const EventProfiler::Entry &e, double q)
+        {
+            uint64_t rank = uint64_t(q * e.count), n = 0;
+            for (int i = 0; i < EventProfiler::BUCKETS; ++i) {
+                n += e.hist[i];
+                if (n > rank) return double(uint64_t(2) << i);
+            }
+            return double(uint64_t(2) << (EventProfiler::BUCKETS - 1));
+        }
+
+        double ipc(const uint64_t *c)
+        {
+            uint64_t cycles = c[PerfCounters::CYCLES];
+            return cycles ? double(c[PerfCounters::INSTRUCTIONS]) / cycles : 0;
+        }
+
+        bool byCost(const EventProfiler::Entry *a, const EventProfiler::Entry *b)
+        {
+            return a->cost > b->cost;
+        }
+    }
+
+    void EventProfiler::print(ostream &os) const
+    {
+        double ns = getNanosPerUnit();
+        vector<const Entry *> v;
+        for (size_t i = 0; i < _entries.size(); ++i) v.push_back(&_entries[i]);
+        sort(v.begin(), v.end(), byCost);
+
+        ios::fmtflags f = os.flags();
+        os << "Events: " << _steps << ", queue length: mean " 
+           << getMeanDepth() << ", max " << _depthMax << "\n";
+        os << left << setw(40) << "event" << right 
+           << setw(12) << "count" << setw(12) << "posted" 
+           << setw(12) << "dropped" << setw(12) << "total ms" 
+           << setw(10) << "mean ns" << setw(10) << "p50 ns" 
+           << setw(10) << "p99 ns" << "\n";
+        os << fixed;
+        for (size_t i = 0; i < v.size(); ++i) {
+            const Entry &e = *v[i];
+            os << left << setw(40) << e.name.substr(0, 39) << right
+               << setw(12) << e.count << setw(12) << e.posted 
+               << setw(12) << e.getDropped()
+               << setw(12) << setprecision(3) << e.cost * ns / 1e6
+               << setw(10) << setprecision(0) 
+               << (e.count ? e.cost * ns / e.count : 0)
+               << setw(10) << quantile(e, 0.5) * ns
+               << setw(10) << quantile(e, 0.99) * ns << "\n";
+        }
+
+        bool pmc = _pmc && _pmc->isAvailable();
+        if (pmc) {
+            os << left << setw(40) << "event (per sampled event)" << right
+               << setw(10) << "sampled";
+            for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                os << setw(14) << PerfCounters::name(PerfCounters::Counter(c));
+            os << setw(8) << "IPC" << "\n";
+            for (size_t i = 0; i < v.size(); ++i) {
+                const Entry &e = *v[i];
+                if (e.sampled == 0) continue;
+                os << left << setw(40) << e.name.substr(0, 39) << right
+                   << setw(10) << e.sampled << setprecision(0);
+                for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                    os << setw(14) << double(e.counters[c]) / e.sampled;
+                os << setw(8) << setprecision(2) << ipc(e.counters) << "\n";
+            }
+        }
+
+        if (!_phases.empty()) {
+            os << left << setw(20) << "phase" << right << setw(8) << "calls"
+               << setw(12) << "total ms";
+            if (pmc) 
+                for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                    os << setw(14) << PerfCounters::name(PerfCounters::Counter(c));
+            os << (pmc ? "     IPC\n" : "\n");
+            for (size_t i = 0; i < _phases.size(); ++i) {
+                const Phase &p = _phases[i];
+                os << left << setw(20) << p.name << right << setw(8) << p.calls
+                   << setw(12) << setprecision(3) << p.nanos / 1e6;
+                if (pmc) {
+                    for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                        os << setw(14) << p.counters[c];
+                    os << setw(8) << setprecision(2) << ipc(p.counters);
+                }
+                os << "\n";
+            }
+        }
+        os.flags(f);
+    }
+
+} // namespace MetaSim
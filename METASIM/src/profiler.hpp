@@ -0,0 +1,188 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <basetype.hpp>
+#include <perfcounters.hpp>
+
+namespace MetaSim {
+
+    class Event;
+
+    /**
+       \ingroup metasim_ee
+
+       Profiles the event loop of a Simulation (see
+       Simulation::setProfiler()): for each concrete class of
+       event, it counts the events processed, posted and dropped,
+       and measures the time spent in Event::action() (the doit()
+       and the probes), with the time stamp counter where
+       available. It also follows the length of the event queue.
+
+       The costs are kept in the units of the clock, and converted
+       in nanoseconds when they are printed: a log2 histogram for
+       each class gives the median and the 99th percentile.
+
+       <pre>
+       EventProfiler prof;
+       prof.setOutput(&cout);   // print() at the end of the simulation
+       SIMUL.setProfiler(&prof);
+       SIMUL.run(100000);
+       </pre>
+
+       The simulation is also divided in phases: the engine
+       measures initSingleRun(), the main loop, endSingleRun() and
+       the collection of the stats (endSim()), and the user can
+       add others (for example, the construction of the model)
+       with beginPhase() and endPhase(). If a PerfCounters object
+       is set with setCounters(), the hardware counters are read
+       at the boundaries of each phase and around the events
+       whose queue length is sampled, which gives the counters
+       per class of events.
+
+       A profiler counts the events of one context.
+    */
+    class EventProfiler {
+    public:
+        static const int BUCKETS = 48;
+
+        /// The profile of a class of events
+        struct Entry {
+            std::string name;
+            uint64_t count;
+            uint64_t posted;
+            /// calls to drop() on a queued event, the extractions
+            /// of the event loop included
+            uint64_t drops;
+            /// clock units spent in action()
+            uint64_t cost;
+            /// events whose cost is less than 2^(i+1) units
+            uint64_t hist[BUCKETS];
+
+            /// events measured with the hardware counters, and
+            /// the sum of their counters
+            uint64_t sampled;
+            uint64_t counters[PerfCounters::NUM_COUNTERS];
+
+            uint64_t getDropped() const { return drops - count; }
+        };
+
+        /// The totals of a phase of the simulation
+        struct Phase {
+            std::string name;
+            uint64_t calls;
+            uint64_t nanos;
+            uint64_t counters[PerfCounters::NUM_COUNTERS];
+        };
+
+    private:
+        std::unordered_map<std::type_index, size_t> _index;
+        std::vector<Entry> _entries;
+
+        size_t _every;
+        uint64_t _steps;
+        double _depthSum;
+        size_t _depthMax;
+        std::vector<std::pair<Tick, size_t> > _samples;
+
+        /// clock and wall time at the first event, to convert the units
+        uint64_t _clock0, _wall0;
+        std::ostream *_out;
+
+        PerfCounters *_pmc;
+        std::vector<Phase> _phases;
+        /// the open phase (-1 if none), its start
+        int _phase;
+        uint64_t _phaseWall;
+        PerfCounters::Values _phaseStart;
+
+        Entry &entry(const Event *e);
+
+    public:
+        /// Samples the length of the queue every sampleEvery events
+        EventProfiler(size_t sampleEvery = 1024);
+
+        /**
+           Executes e->action(), measuring it; depth is the length
+           of the queue, once e has been extracted
+        */
+        void run(Event *e, size_t depth);
+
+        void posted(const Event *e) { entry(e).posted++; }
+        void dropped(const Event *e) { entry(e).drops++; }
+
+        /**
+           Reads the hardware counters c (NULL: none) in the
+           phases and in the sampled events. The object is not
+           owned by the profiler.
+        */
+        void setCounters(PerfCounters *c) { _pmc = c; }
+
+        /**
+           Starts the phase called name, ending the open one, if
+           any. The phases with the same name are summed.
+        */
+        void beginPhase(const std::string &name);
+
+        /// Ends the open phase
+        void endPhase();
+
+        const std::vector<Phase> &getPhases() const { return _phases; }
+
+        /// Forgets everything measured so far
+        void reset();
+
+        const std::vector<Entry> &getEntries() const { return _entries; }
+
+        /// Number of events processed
+        uint64_t getSteps() const { return _steps; }
+
+        /// Average and maximum length of the queue, after extraction
+        double getMeanDepth() const;
+        size_t getMaxDepth() const { return _depthMax; }
+
+        /// (time, length of the queue), every sampleEvery events
+        const std::vector<std::pair<Tick, size_t> > &getDepthSamples() const
+        {
+            return _samples;
+        }
+
+        /// Nanoseconds per clock unit
+        double getNanosPerUnit() const;
+
+        /**
+           Prints a table of the events, by decreasing total cost,
+           and one of the phases
+        */
+        void print(std::ostream &os) const;
+
+        /// Where print() writes at the end of the simulation (NULL: nowhere)
+        void setOutput(std::ostream *os) { _out = os; }
+
+        /// Called by Simulation::endSim()
+        void endSim() const { if (_out) print(*_out); }
+    };
+
+} // namespace MetaSim
+
+#endif
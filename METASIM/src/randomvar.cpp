@@ -11,14 +11,18 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <cstdlib>
+#include <typeinfo>
 
 #include <randomvar.hpp>
+#include <samplefeeder.hpp>
+#include <simcontext.hpp>
 #include <simul.hpp>
 #include <strtoken.hpp>
 
@@ -33,13 +37,16 @@ namespace MetaSim {
 
     RandomGen RandomVar::_stdgen(1);
 
-    RandomGen* RandomVar::_pstdgen(&_stdgen);
+    thread_local RandomGen* RandomVar::_pstdgen(&_stdgen);
 
     const RandNum RandomGen::A = 16807;
     const RandNum RandomGen::M = 2147483647;
     const RandNum RandomGen::Q = 127773; // M div A
     const RandNum RandomGen::R = 2836;   // M mod A
 
+    unsigned long long RandomGen::_repSpacing = 1ULL << 26;
+    unsigned long long RandomGen::_subSpacing = 1ULL << 20;
+
 
     const char * const RandomVar::Exc::_FILEOPEN = "Unable to open RandFile";
     const char * const RandomVar::Exc::_FILECLOSE = "Too short RandFile";
@@ -48,7 +55,8 @@ namespace MetaSim {
 
     /*---------------------------------------------------*/
 
-    RandomGen::RandomGen(RandNum s) : _seed(s), _xn(s)
+    RandomGen::RandomGen(RandNum s) : _seed(s), _xn(s), _rep(0), _sub(0),
+                                      _antithetic(false)
     {
     }
 
@@ -68,24 +76,280 @@ namespace MetaSim {
     void RandomGen::init(RandNum s)
     {
         _xn = _seed = s;
+        _rep = _sub = 0;
+    }
+
+    void RandomGen::skip(unsigned long long n)
+    {
+        // the sequence has period M - 1
+        n %= (unsigned long long)(M - 1);
+
+        long long a = A, r = 1;
+        while (n > 0) {
+            if (n & 1) r = (r * a) % M;
+            a = (a * a) % M;
+            n >>= 1;
+        }
+        _xn = RandNum((r * _xn) % M);
+    }
+
+    void RandomGen::setStream(unsigned long rep, unsigned long sub)
+    {
+        // everything is reduced modulo the period, to avoid
+        // overflows of the products
+        const unsigned long long P = (unsigned long long)(M - 1);
+
+        _xn = _seed;
+        skip(((rep % P) * (_repSpacing % P) + 
+              (sub % P) * (_subSpacing % P)) % P);
+        _rep = rep;
+        _sub = sub;
+    }
+
+    RandomGen *RandomGen::substream(unsigned long sub) const
+    {
+        RandomGen *g = clone();
+        g->setStream(_rep, sub);
+        return g;
+    }
+
+    double RandomGen::uniform(double a, double b)
+    {
+        double tmp = sample();
+        if (_antithetic) tmp = M - tmp;
+        return tmp * (b - a) / M + a;
+    }
+
+    void RandomGen::fillUniform(double *out, size_t n, double a, double b)
+    {
+        // derived generators that do not redefine fillUniform()
+        if (typeid(*this) != typeid(RandomGen)) {
+            for (size_t i = 0; i < n; ++i) out[i] = uniform(a, b);
+            return;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            double tmp = RandomGen::sample();
+            if (_antithetic) tmp = M - tmp;
+            out[i] = tmp * (b - a) / M + a;
+        }
+    }
+
+    RandomGen *RandomGen::create(Type t, RandNum s)
+    {
+        switch (t) {
+        case XOSHIRO256:
+            return new Xoshiro256Gen(s);
+        case PCG32:
+            return new Pcg32Gen(s);
+        default:
+            return new RandomGen(s);
+        }
+    }
+
+    void RandomGen::setStreamSpacing(unsigned long long rep,
+                                     unsigned long long sub)
+    {
+        _repSpacing = rep;
+        _subSpacing = sub;
+    }
+
+    /*---------------------------------------------------*/
+
+    // 2^-53 and 2^-32
+    static const double TWO_M53 = 1.0 / 9007199254740992.0;
+    static const double TWO_M32 = 1.0 / 4294967296.0;
+
+    static const uint64_t XOSHIRO_JUMP[4] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+
+    static const uint64_t XOSHIRO_LONG_JUMP[4] = {
+        0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+        0x77710069854ee241ULL, 0x39109bb02acbc34cULL
+    };
+
+    Xoshiro256Gen::Xoshiro256Gen(RandNum s) : RandomGen(s)
+    {
+        init(s);
+    }
+
+    void Xoshiro256Gen::init(RandNum s)
+    {
+        // splitmix64, as suggested by the authors
+        uint64_t x = uint64_t(s);
+        for (int i = 0; i < 4; ++i) {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            _init[i] = _s[i] = z ^ (z >> 31);
+        }
+        _rep = _sub = 0;
+    }
+
+    double Xoshiro256Gen::uniform(double a, double b)
+    {
+        // 53 random bits, never 0 (ExponentialVar takes the log)
+        double u = (double(next() >> 11) + 0.5) * TWO_M53;
+        if (_antithetic) u = 1 - u;
+        return u * (b - a) + a;
+    }
+
+    void Xoshiro256Gen::fillUniform(double *out, size_t n, double a, double b)
+    {
+        const double w = b - a;
+        if (_antithetic) {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (1 - (double(next() >> 11) + 0.5) * TWO_M53) * w + a;
+            return;
+        }
+        for (size_t i = 0; i < n; ++i)
+            out[i] = ((double(next() >> 11) + 0.5) * TWO_M53) * w + a;
+    }
+
+    void Xoshiro256Gen::jump(const uint64_t *poly)
+    {
+        uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (int i = 0; i < 4; ++i)
+            for (int b = 0; b < 64; ++b) {
+                if (poly[i] & (uint64_t(1) << b)) {
+                    s0 ^= _s[0];
+                    s1 ^= _s[1];
+                    s2 ^= _s[2];
+                    s3 ^= _s[3];
+                }
+                next();
+            }
+        _s[0] = s0;
+        _s[1] = s1;
+        _s[2] = s2;
+        _s[3] = s3;
+    }
+
+    void Xoshiro256Gen::skip(unsigned long long n)
+    {
+        while (n-- > 0) next();
+    }
+
+    void Xoshiro256Gen::setStream(unsigned long rep, unsigned long sub)
+    {
+        for (int i = 0; i < 4; ++i) _s[i] = _init[i];
+        for (unsigned long k = 0; k < rep; ++k) jump(XOSHIRO_LONG_JUMP);
+        for (unsigned long j = 0; j < sub; ++j) jump(XOSHIRO_JUMP);
+        _rep = rep;
+        _sub = sub;
+    }
+
+    /*---------------------------------------------------*/
+
+    Pcg32Gen::Pcg32Gen(RandNum s) : RandomGen(s)
+    {
+        init(s);
+    }
+
+    void Pcg32Gen::seed(uint64_t s, uint64_t seq)
+    {
+        _state = 0;
+        _inc = (seq << 1) | 1;
+        next();
+        _state += s;
+        next();
+    }
+
+    void Pcg32Gen::init(RandNum s)
+    {
+        _seed64 = uint64_t(s);
+        seed(_seed64, 0);
+        _rep = _sub = 0;
+    }
+
+    double Pcg32Gen::uniform(double a, double b)
+    {
+        double u = (double(next()) + 0.5) * TWO_M32;
+        if (_antithetic) u = 1 - u;
+        return u * (b - a) + a;
+    }
+
+    void Pcg32Gen::fillUniform(double *out, size_t n, double a, double b)
+    {
+        const double w = b - a;
+        if (_antithetic) {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = (1 - (double(next()) + 0.5) * TWO_M32) * w + a;
+            return;
+        }
+        for (size_t i = 0; i < n; ++i)
+            out[i] = ((double(next()) + 0.5) * TWO_M32) * w + a;
+    }
+
+    void Pcg32Gen::skip(unsigned long long n)
+    {
+        // Brown's algorithm for jumping ahead an LCG
+        uint64_t accMult = 1, accPlus = 0;
+        uint64_t curMult = MULT, curPlus = _inc;
+        while (n > 0) {
+            if (n & 1) {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            n >>= 1;
+        }
+        _state = accMult * _state + accPlus;
+    }
+
+    void Pcg32Gen::setStream(unsigned long rep, unsigned long sub)
+    {
+        seed(_seed64, rep);
+        skip((unsigned long long)(sub) << 48);
+        _rep = rep;
+        _sub = sub;
     }
 
     /*---------------------------------------------------*/
 
     const unsigned long PoissonVar::CUTOFF = 10000;
 
-    RandomVar::RandomVar(RandomGen* gen) : _gen(gen)
+    RandomVar::RandomVar(RandomGen* gen) : _gen(gen), _buf(), _bufPos(0),
+                                           _feed(0),
+                                           _ctx(SimContext::current())
     {
         if (_gen == NULL) 
             _gen = _pstdgen;
+        _ctx->randomVars.insert(this);
     }
 
-    RandomVar::RandomVar(const RandomVar &r) : _gen(r._gen)
+    RandomVar::RandomVar(const RandomVar &r) : _gen(r._gen), _buf(), 
+                                               _bufPos(0), _feed(0),
+                                               _ctx(SimContext::current())
     {
+        _ctx->randomVars.insert(this);
     }
 
     RandomVar::~RandomVar()
     {
+        if (_feed != 0) _feed->_owner->detach(*this);
+        if (_ctx != 0) _ctx->randomVars.erase(this);
+    }
+
+    void RandomVar::fill(double *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = get();
+    }
+
+    void RandomVar::setPrefetch(size_t n)
+    {
+        if (_feed != 0) _feed->_owner->detach(*this);
+        _buf.assign(n, 0);
+        _bufPos = n;
+    }
+
+    void RandomVar::refill()
+    {
+        if (_feed != 0) _feed->_owner->take(_feed, _buf);
+        else fill(&_buf[0], _buf.size());
+        _bufPos = 0;
     }
 
     RandomGen* RandomVar::changeGenerator(RandomGen *g)
@@ -115,13 +379,17 @@ namespace MetaSim {
 
     double UniformVar::get()
     {
-        double tmp;
-        tmp = _gen->sample();
-        tmp = tmp * (_max - _min) / _gen->getModule() + _min;
-  
-        return tmp;
+        return _gen->uniform(_min, _max);
     };
 
+    void UniformVar::fill(double *out, size_t n)
+    {
+        // derived classes that do not redefine fill() must not
+        // get uniform values
+        if (typeid(*this) != typeid(UniformVar)) RandomVar::fill(out, n);
+        else _gen->fillUniform(out, n, _min, _max);
+    }
+
     RandomVar *UniformVar::createInstance(vector<string> &par) 
     {
         double a,b;
@@ -141,6 +409,12 @@ namespace MetaSim {
         return -log(UniformVar::get()) * _lambda;
     };
 
+    void ExponentialVar::fill(double *out, size_t n)
+    {
+        _gen->fillUniform(out, n, 0, 1);
+        for (size_t i = 0; i < n; ++i) out[i] = -log(out[i]) * _lambda;
+    }
+
     RandomVar *ExponentialVar::createInstance(vector<string> &par) 
     {
         if (par.size() != 1)
@@ -158,6 +432,13 @@ namespace MetaSim {
         return _mu * pow (UniformVar::get(), -1/_order);
     };
 
+    void ParetoVar::fill(double *out, size_t n)
+    {
+        const double e = -1/_order;
+        _gen->fillUniform(out, n, 0, 1);
+        for (size_t i = 0; i < n; ++i) out[i] = _mu * pow(out[i], e);
+    }
+
     RandomVar *ParetoVar::createInstance(vector<string> &par) 
     {
         double a,b;
@@ -304,6 +585,28 @@ namespace MetaSim {
         return min;
     }
 
+    SampledVar::SampledVar(RandomVar &v, size_t n) :
+        RandomVar(), _samples(), _next(0), _min(0), _max(0)
+    {
+        if (n == 0) throw Exc("No samples", "SampledVar");
+        std::shared_ptr<vector<double> > a(new vector<double>(n));
+        v.fill(&(*a)[0], n);
+        _min = *min_element(a->begin(), a->end());
+        _max = *max_element(a->begin(), a->end());
+        _samples = a;
+    }
+
+    SampledVar::SampledVar(const SampledVar &s) :
+        RandomVar(s), _samples(s._samples), _next(0), _min(s._min), _max(s._max)
+    {
+    }
+
+    double SampledVar::get()
+    {
+        if (_next >= _samples->size()) _next = 0;
+        return (*_samples)[_next++];
+    }
+
     RandomVar *DetVar::createInstance(vector<string> &par) 
     {
         if (par.size() != 1) 
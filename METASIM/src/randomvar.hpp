@@ -16,6 +16,8 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -29,6 +31,9 @@ namespace MetaSim {
 
     using namespace std;
 
+    class SampleFeed;
+    class SimContext;
+
     typedef long int RandNum;
     const int MAX_SEEDS = 1000;
 
@@ -55,37 +60,242 @@ namespace MetaSim {
     //@{
     /** 
         The basic class for Random Number Generator. It is possible to
-        derive from this class to implement a new generator. */
+        derive from this class to implement a new generator.
+
+        This class implements the original Park-Miller generator
+        (a 31-bit multiplicative LCG, with Schrage's method), which
+        is kept for reproducing old results. Xoshiro256Gen and 
+        Pcg32Gen are faster, 64-bit generators with a much longer
+        period; a generator can be selected at runtime with
+        create() and RandomVar::changeGenerator(). */
     class RandomGen {
         RandNum _seed;
         RandNum _xn;
 
+        /// distance (in samples) between two streams / substreams
+        static unsigned long long _repSpacing;
+        static unsigned long long _subSpacing;
+
         // constants used by the internal pseudo-causal number generator. 
         static const RandNum A;
         static const RandNum M;
         static const RandNum Q;	// M div A
         static const RandNum R;	// M mod A
 
+    protected:
+        /// current replication stream and substream
+        unsigned long _rep;
+        unsigned long _sub;
+        /// true if uniform() returns 1 - u instead of u
+        bool _antithetic;
+
     public:
+        /// Available generators
+        typedef enum { PARK_MILLER = 0, XOSHIRO256, PCG32 } Type;
+
         /**
            Creates a Random Generator with s as initial seed.
            See file include/seeds.h for a list of seeds.
         */
         RandomGen(RandNum s);
 
+        virtual ~RandomGen() {}
+
+        /// Creates a new generator of type t, with seed s
+        static RandomGen *create(Type t, RandNum s);
+
+        /// Returns a copy of this generator (in the same state)
+        virtual RandomGen *clone() const { return new RandomGen(*this); }
+
+        /// Copies the state of g, a generator of the same type
+        virtual void assign(const RandomGen &g) { *this = g; }
+
+        /// Returns the type of this generator
+        virtual Type getType() const { return PARK_MILLER; }
+
         /** Initialize the generator with seed s */
-        void init(RandNum s);
+        virtual void init(RandNum s);
 
         /** extract the next random number from the
             sequence */
-        RandNum sample();
+        virtual RandNum sample();
+
+        /**
+           Returns a number uniformly distributed in [a, b). This
+           is what the random variables use: the 64-bit generators
+           avoid the division by the module.
+        */
+        virtual double uniform(double a, double b);
+
+        /**
+           Stores in out the next n numbers uniformly distributed
+           in [a, b): the same numbers that n calls to uniform()
+           would return, but without a virtual call per sample.
+        */
+        virtual void fillUniform(double *out, size_t n, double a, double b);
 
         /** Returns the current sequence number. */
         RandNum getCurrSeed() { return _xn; }
 
         /** return the constant M (the module of this random
             generator */
-        RandNum getModule() { return M; }
+        virtual RandNum getModule() { return M; }
+
+        /**
+           Advances the sequence by n samples, as if sample() was
+           called n times, in O(log n) steps: x(k+n) = A^n x(k)
+           mod M.
+        */
+        virtual void skip(unsigned long long n);
+
+        /**
+           Positions the generator at the beginning of substream
+           sub of the replication stream rep. The sequence starting
+           from the seed is divided in non-overlapping streams, one
+           for each replication, and each stream is divided in
+           substreams (for example, one for each entity), so that
+           replication rep always sees the same numbers, whatever
+           the order in which the replications are executed.
+        */
+        virtual void setStream(unsigned long rep, unsigned long sub = 0);
+
+        /// Returns the current replication stream
+        unsigned long getStream() const { return _rep; }
+
+        /// Returns the current substream
+        unsigned long getSubstream() const { return _sub; }
+
+        /**
+           Makes the generator antithetic: uniform() and
+           fillUniform() return b - (u - a) for every u they
+           would return otherwise, so that a run repeated on the
+           same stream with the antithetic generator draws the
+           "opposite" numbers (1 - u instead of u). The variables
+           obtained by inversion from a uniform (exponential,
+           Pareto, ...) are negatively correlated between the
+           two runs, which reduces the variance of their mean.
+           sample() is not affected. See also
+           Simulation::setAntitheticPairs().
+        */
+        void setAntithetic(bool b) { _antithetic = b; }
+
+        bool isAntithetic() const { return _antithetic; }
+
+        /**
+           Returns a new copy of this generator (to be deleted by
+           the caller) positioned at substream sub of the current
+           replication stream. Useful to give each entity its own
+           random numbers.
+        */
+        RandomGen *substream(unsigned long sub) const;
+
+        /**
+           Sets the length of the streams and substreams of the
+           Park-Miller generator. Its period is M - 1 (about
+           2^31), so with the defaults (2^26 and 2^20) there are
+           32 replications of 64 substreams each, before the
+           streams start to overlap.
+        */
+        static void setStreamSpacing(unsigned long long rep,
+                                     unsigned long long sub);
+    };
+
+    /**
+       The xoshiro256** generator (Blackman and Vigna), with 256 
+       bits of state and period 2^256 - 1. The state is
+       initialized from the seed with splitmix64.
+
+       Replication stream k starts after k long jumps (2^192
+       samples) and substream j after j further jumps (2^128
+       samples) from the seed, so setStream() costs O(k + j);
+       skip() is linear in the number of samples.
+    */
+    class Xoshiro256Gen : public RandomGen {
+        uint64_t _s[4];
+        uint64_t _init[4];
+
+        void jump(const uint64_t *poly);
+    public:
+        Xoshiro256Gen(RandNum s);
+
+        virtual RandomGen *clone() const { return new Xoshiro256Gen(*this); }
+        virtual void assign(const RandomGen &g) {
+            *this = static_cast<const Xoshiro256Gen &>(g);
+        }
+        virtual Type getType() const { return XOSHIRO256; }
+
+        virtual void init(RandNum s);
+
+        /// Returns the next 64-bit number
+        inline uint64_t next() {
+            const uint64_t r = rotl(_s[1] * 5, 7) * 9;
+            const uint64_t t = _s[1] << 17;
+            _s[2] ^= _s[0];
+            _s[3] ^= _s[1];
+            _s[1] ^= _s[2];
+            _s[0] ^= _s[3];
+            _s[2] ^= t;
+            _s[3] = rotl(_s[3], 45);
+            return r;
+        }
+
+        /// Returns the 31 most significant bits of next()
+        virtual RandNum sample() { return RandNum(next() >> 33); }
+        virtual double uniform(double a, double b);
+        virtual void fillUniform(double *out, size_t n, double a, double b);
+        virtual RandNum getModule() { return RandNum(1) << 31; }
+        virtual void skip(unsigned long long n);
+        virtual void setStream(unsigned long rep, unsigned long sub = 0);
+
+        static inline uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+    };
+
+    /**
+       The PCG32 generator (O'Neill, PCG-XSH-RR): a 64-bit LCG
+       with a permuted 32-bit output, period 2^64. 
+
+       Each replication stream uses a different increment of the
+       LCG (i.e. a different sequence), and substream j starts
+       j * 2^48 samples after the seed. skip() costs O(log n).
+    */
+    class Pcg32Gen : public RandomGen {
+        uint64_t _state;
+        uint64_t _inc;
+        uint64_t _seed64;
+
+        static const uint64_t MULT = 6364136223846793005ULL;
+
+        /// initializes state and increment as pcg32_srandom()
+        void seed(uint64_t s, uint64_t seq);
+    public:
+        Pcg32Gen(RandNum s);
+
+        virtual RandomGen *clone() const { return new Pcg32Gen(*this); }
+        virtual void assign(const RandomGen &g) {
+            *this = static_cast<const Pcg32Gen &>(g);
+        }
+        virtual Type getType() const { return PCG32; }
+
+        virtual void init(RandNum s);
+
+        /// Returns the next 32-bit number
+        inline uint32_t next() {
+            uint64_t old = _state;
+            _state = old * MULT + _inc;
+            uint32_t x = uint32_t(((old >> 18) ^ old) >> 27);
+            uint32_t rot = uint32_t(old >> 59);
+            return (x >> rot) | (x << ((-rot) & 31));
+        }
+
+        /// Returns the 31 most significant bits of next()
+        virtual RandNum sample() { return RandNum(next() >> 1); }
+        virtual double uniform(double a, double b);
+        virtual void fillUniform(double *out, size_t n, double a, double b);
+        virtual RandNum getModule() { return RandNum(1) << 31; }
+        virtual void skip(unsigned long long n);
+        virtual void setStream(unsigned long rep, unsigned long sub = 0);
     };
 
     /**
@@ -100,13 +310,31 @@ namespace MetaSim {
         static RandomGen _stdgen;
 
         /** Pointer to the current generator (used by the next
-            RandomVar object to be created. */
-        static RandomGen *_pstdgen;
+            RandomVar object to be created). Each thread has its
+            own pointer, so that replications running in parallel
+            can use different generators. */
+        static thread_local RandomGen *_pstdgen;
 
         /** The current random generator (used by this
             object). By default, it is equal to _pstdgen */
         RandomGen *_gen;
 
+        /// prefetched values (see setPrefetch())
+        std::vector<double> _buf;
+        size_t _bufPos;
+
+        /// the ring of the SampleFeeder filling _buf, or NULL
+        SampleFeed *_feed;
+        friend class SampleFeeder;
+
+        /// the context of the variable (NULL if it has been
+        /// destroyed before the variable)
+        SimContext *_ctx;
+        friend class SimContext;
+        friend class Checkpoint;
+
+        void refill();
+
     public:
 
         typedef string BASE_KEY_TYPE;
@@ -167,12 +395,45 @@ namespace MetaSim {
         /// Restore the standard generator
         static void restoreGenerator();
 
+        /// Returns the current standard generator
+        static RandomGen *getGenerator() { return _pstdgen; }
+
         /** 
             This method must be overloaded in each derived
             class to return a double according to the propoer
             distriibution. */
         virtual double get() = 0;
 
+        /**
+           Stores in out the next n values of the variable: the
+           same values that n calls to get() would return. Derived
+           classes override it to generate the whole block in a
+           tight loop.
+        */
+        virtual void fill(double *out, size_t n);
+
+        /**
+           Enables a buffer of n prefetched values (0 disables
+           it), filled in blocks with fill() and consumed by
+           draw(). The sequence of values is the same of get()
+           only if the generator of this variable is not shared
+           with other variables, as the numbers are extracted
+           from the generator in advance. The variable is detached
+           from its SampleFeeder, if any.
+        */
+        void setPrefetch(size_t n);
+
+        /**
+           Returns the next value of the variable, from the
+           prefetch buffer if enabled (or from a SampleFeeder, if
+           attached), otherwise calling get().
+        */
+        inline double draw() {
+            if (_buf.empty()) return get();
+            if (_bufPos == _buf.size()) refill();
+            return _buf[_bufPos++];
+        }
+
         virtual double getMaximum() throw(MaxException) = 0;
         virtual double getMinimum() throw(MaxException) = 0;
 
@@ -203,6 +464,7 @@ namespace MetaSim {
         UniformVar(double min, double max, RandomGen *g = NULL) 
             : RandomVar(g), _min(min), _max(max) {}
         virtual double get();
+        virtual void fill(double *out, size_t n);
         virtual ~UniformVar() {}
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException) {return _max;}
@@ -218,6 +480,7 @@ namespace MetaSim {
             UniformVar(0, 1, g), _lambda(m) {}
 
         virtual double get();
+        virtual void fill(double *out, size_t n);
 
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
@@ -234,6 +497,7 @@ namespace MetaSim {
         ParetoVar(double m, double k, RandomGen *g = NULL) : 
             UniformVar(0,1,g), _mu(m), _order(k) {};
         virtual double get();
+        virtual void fill(double *out, size_t n);
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
             {throw MaxException("ExponentialVar");}
@@ -302,6 +566,37 @@ namespace MetaSim {
 
         static RandomVar *createInstance(vector<string> &par);
     };
+
+    /**
+       Replays n samples drawn once from another variable. Copies
+       share the samples, each one from the first sample, so that
+       several models (for example, the same tasks under different
+       schedulers, each one in its own context) see exactly the
+       same values, while they are drawn only once: this is the
+       method of common random numbers. After the last sample, it
+       starts again from the first one, like DetVar.
+    */
+    class SampledVar : public RandomVar {
+        std::shared_ptr<const vector<double> > _samples;
+        size_t _next;
+        double _min, _max;
+    public:
+        /// Draws n samples from v
+        SampledVar(RandomVar &v, size_t n);
+        /// Shares the samples of s, starting from the first one
+        SampledVar(const SampledVar &s);
+        virtual ~SampledVar() {}
+
+        virtual double get();
+        virtual double getMaximum() throw(MaxException) { return _max; }
+        virtual double getMinimum() throw(MaxException) { return _min; }
+
+        /// Number of samples
+        size_t size() const { return _samples->size(); }
+
+        /// Starts again from the first sample
+        void rewind() { _next = 0; }
+    };
     //@}
 
 } // namespace MetaSim
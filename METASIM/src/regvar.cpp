@@ -93,18 +93,19 @@ namespace MetaSim {
     {
         RandomVar *temp;
                 
-        string token = get_token(str);
+        string token = token_of(str).str();
         DBGPRINT_2("token = ",  token);
                 
-        string p = get_param(str);
-        DBGPRINT_2("parms = ", p);
+        vector<substring> p;
+        split_param(param_of(str), p);
 
-        vector<string> parms = split_param(p);
+        vector<string> parms;
+        assign(p, parms);
   
         for (size_t i = 0; i < parms.size(); ++i) 
             DBGPRINT_4("par[", i, "] = ", parms[i]);
                 
-        auto_ptr<RandomVar> 
+        unique_ptr<RandomVar> 
             var(genericFactory<RandomVar>::instance().create(token,parms));
                 
         if (var.get() == 0) throw ParseExc("parsevar", str);
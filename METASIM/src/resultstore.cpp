@@ -0,0 +1,230 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <stdint.h>
+
+#include <basestat.hpp>
+#include <resultstore.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    static const char MAGIC[4] = { 'M', 'S', 'R', 'S' };
+    static const uint32_t VERSION = 1;
+    static const uint32_t ORDER_MARK = 0x01020304;
+
+    namespace {
+        void put32(ostream &os, uint32_t x) 
+        {
+            os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+        }
+
+        bool get32(istream &is, uint32_t &x)
+        {
+            return bool(is.read(reinterpret_cast<char *>(&x), sizeof(x)));
+        }
+
+        // reads the header, returns false if the file is empty
+        bool readHeader(istream &is, const string &fname, 
+                        vector<string> &columns)
+        {
+            char magic[4];
+            if (!is.read(magic, 4)) return false;
+            uint32_t version, order, n;
+            if (memcmp(magic, MAGIC, 4) != 0 || !get32(is, version) || 
+                !get32(is, order) || !get32(is, n)) 
+                throw ResultStore::Exc(fname + " is not a result store");
+            if (version != VERSION || order != ORDER_MARK)
+                throw ResultStore::Exc(fname + 
+                                       ": unsupported version or byte order");
+            columns.resize(n);
+            for (uint32_t i = 0; i < n; ++i) {
+                uint32_t len;
+                if (!get32(is, len)) 
+                    throw ResultStore::Exc(fname + ": truncated header");
+                columns[i].resize(len);
+                if (len > 0 && !is.read(&columns[i][0], len))
+                    throw ResultStore::Exc(fname + ": truncated header");
+            }
+            return true;
+        }
+    }
+
+    ResultStore::ResultStore(const string &fname, size_t blockRows) :
+        _fname(fname), _columns(), _block(), 
+        _blockRows(blockRows > 0 ? blockRows : 1), _rows(0), _out()
+    {
+        vector<vector<double> > rows;
+        ifstream in(fname.c_str(), ios::binary);
+        if (in.is_open() && readHeader(in, fname, _columns)) {
+            in.close();
+            load(fname, _columns, rows);
+            _rows = rows.size();
+        }
+        _out.open(fname.c_str(), ios::binary | ios::app);
+        if (!_out.is_open()) throw Exc("Cannot open file " + fname);
+        _block.resize(_columns.size());
+    }
+
+    ResultStore::~ResultStore()
+    {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    void ResultStore::writeHeader()
+    {
+        _out.write(MAGIC, 4);
+        put32(_out, VERSION);
+        put32(_out, ORDER_MARK);
+        put32(_out, _columns.size());
+        for (size_t i = 0; i < _columns.size(); ++i) {
+            put32(_out, _columns[i].size());
+            _out.write(_columns[i].data(), _columns[i].size());
+        }
+    }
+
+    void ResultStore::setColumns(const vector<string> &columns)
+    {
+        if (!_columns.empty()) {
+            if (columns != _columns) 
+                throw Exc("The columns of " + _fname + " are different");
+            return;
+        }
+        if (columns.empty()) throw Exc("No columns");
+        _columns = columns;
+        _block.assign(_columns.size(), vector<double>());
+        writeHeader();
+    }
+
+    void ResultStore::append(const vector<double> &row)
+    {
+        if (_columns.empty()) throw Exc("The columns have not been set");
+        if (row.size() != _columns.size()) 
+            throw Exc("The row has a wrong number of values");
+        for (size_t i = 0; i < row.size(); ++i) _block[i].push_back(row[i]);
+        ++_rows;
+        if (_block[0].size() >= _blockRows) flush();
+    }
+
+    void ResultStore::appendStats(const vector<string> &params, 
+                                  const vector<double> &values)
+    {
+        if (params.size() != values.size()) 
+            throw Exc("The parameters have a wrong number of values");
+
+        vector<string> columns(params);
+        vector<double> row(values);
+        for (BaseStat::iterator i = BaseStat::begin(); 
+             i != BaseStat::end(); ++i) {
+            columns.push_back((*i)->getName());
+            columns.push_back((*i)->getName() + ".ci");
+            row.push_back((*i)->getMean());
+            row.push_back((*i)->getExpNum() >= 3 ? 
+                          (*i)->getConfInterval() : 0);
+        }
+        setColumns(columns);
+        append(row);
+    }
+
+    void ResultStore::flush()
+    {
+        if (_block.empty() || _block[0].empty()) return;
+        uint32_t n = _block[0].size();
+        put32(_out, n);
+        for (size_t i = 0; i < _block.size(); ++i) {
+            _out.write(reinterpret_cast<const char *>(&_block[i][0]), 
+                       n * sizeof(double));
+            _block[i].clear();
+        }
+        _out.flush();
+        if (!_out) throw Exc("Cannot write on " + _fname);
+    }
+
+    void ResultStore::readRows(vector<vector<double> > &rows)
+    {
+        flush();
+        vector<string> columns;
+        load(_fname, columns, rows);
+    }
+
+    void ResultStore::load(const string &fname, vector<string> &columns,
+                           vector<vector<double> > &rows)
+    {
+        ifstream in(fname.c_str(), ios::binary);
+        if (!in.is_open()) throw Exc("Cannot open file " + fname);
+        columns.clear();
+        rows.clear();
+        if (!readHeader(in, fname, columns)) return;
+
+        uint32_t n;
+        vector<double> col;
+        while (get32(in, n)) {
+            size_t first = rows.size();
+            rows.resize(first + n, vector<double>(columns.size()));
+            col.resize(n);
+            for (size_t c = 0; c < columns.size(); ++c) {
+                if (n > 0 && !in.read(reinterpret_cast<char *>(&col[0]), 
+                                      n * sizeof(double))) 
+                    throw Exc(fname + ": truncated block");
+                for (uint32_t r = 0; r < n; ++r) rows[first + r][c] = col[r];
+            }
+        }
+    }
+
+    void ResultStore::exportTable(const string &fname, ostream &os)
+    {
+        vector<string> columns;
+        vector<vector<double> > rows;
+        load(fname, columns, rows);
+
+        for (size_t i = 0; i < columns.size(); ++i) 
+            os << columns[i] << (i + 1 < columns.size() ? "," : "");
+        os << endl;
+        for (size_t k = 0; k < rows.size(); ++k) {
+            for (size_t i = 0; i < rows[k].size(); ++i) 
+                os << rows[k][i] << (i + 1 < rows[k].size() ? "," : "");
+            os << endl;
+        }
+    }
+
+    void ResultStore::exportGnuPlot(const string &fname, const string &param,
+                                    const string &dir)
+    {
+        vector<string> columns;
+        vector<vector<double> > rows;
+        load(fname, columns, rows);
+
+        size_t p = columns.size();
+        for (size_t i = 0; i < columns.size(); ++i)
+            if (columns[i] == param) p = i;
+        if (p == columns.size()) throw Exc("Unknown column " + param);
+
+        for (size_t c = 0; c < columns.size(); ++c) {
+            size_t ci = c + 1;
+            if (ci >= columns.size() || columns[ci] != columns[c] + ".ci") 
+                continue;
+            ofstream f((dir + columns[c]).c_str());
+            if (!f.is_open()) throw Exc("Cannot open file " + dir + columns[c]);
+            f << "# " << columns[c] << endl;
+            for (size_t k = 0; k < rows.size(); ++k)
+                f << rows[k][p] << '\t' << rows[k][c] << '\t' 
+                  << rows[k][ci] << endl;
+        }
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,135 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __RESULTSTORE_HPP__
+#define __RESULTSTORE_HPP__
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       A single, append-only file for the results of many
+       simulations (for example, all the points of a Campaign),
+       instead of one file for each stat object (GnuPlotOutput).
+
+       The file is self-describing: a header with the names of the
+       columns, followed by blocks of rows stored by column (the
+       values of the first column of all the rows of the block,
+       then those of the second column, and so on). The rows are
+       buffered in memory and written one block at a time, so
+       appending a row does not touch the file system.
+
+       <pre>
+       "MSRS" version(uint32) byteorder(uint32) ncols(uint32)
+       ncols x { length(uint32) name }
+       blocks: nrows(uint32) ncols x { nrows x double }
+       </pre>
+
+       Opening an existing file appends to it: the columns must be
+       the same. The file can be read back with load(), or
+       converted to the layout of GnuPlotOutput (exportGnuPlot())
+       or to a table of comma separated values (exportTable()).
+    */
+    class ResultStore {
+        std::string _fname;
+        std::vector<std::string> _columns;
+        /// the buffered rows, by column
+        std::vector<std::vector<double> > _block;
+        size_t _blockRows;
+        size_t _rows;
+        std::ofstream _out;
+
+        ResultStore(const ResultStore &);
+        ResultStore &operator=(const ResultStore &);
+
+        void writeHeader();
+
+    public:
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "ResultStore", "resultstore.cpp") {}
+        };
+
+        /**
+           Opens (or creates) the file. The rows are written in
+           blocks of blockRows rows.
+        */
+        ResultStore(const std::string &fname, size_t blockRows = 4096);
+
+        /// Writes the buffered rows
+        ~ResultStore();
+
+        /**
+           Sets the names of the columns. If they are already set
+           (or the file already exists), they must be the same.
+        */
+        void setColumns(const std::vector<std::string> &columns);
+
+        const std::vector<std::string> &getColumns() const { return _columns; }
+
+        /// Appends a row, with one value for each column
+        void append(const std::vector<double> &row);
+
+        /**
+           Appends a row with the given parameters, followed by
+           the mean and the confidence interval (see
+           BaseStat::getConfInterval(), 0 with less than 3 runs)
+           of every stat object of the current context. The
+           columns are the parameters, then "<name>" and
+           "<name>.ci" for each stat: at the first row they are
+           set (or checked) automatically.
+        */
+        void appendStats(const std::vector<std::string> &params, 
+                         const std::vector<double> &values);
+
+        /// Number of rows in the file, including the buffered ones
+        size_t getRows() const { return _rows; }
+
+        /// Writes the buffered rows on the file
+        void flush();
+
+        /// Reads back all the rows, including the buffered ones
+        void readRows(std::vector<std::vector<double> > &rows);
+
+        /// Reads all the columns and the rows of a file
+        static void load(const std::string &fname, 
+                         std::vector<std::string> &columns,
+                         std::vector<std::vector<double> > &rows);
+
+        /// Prints a file as comma separated values, with a header
+        static void exportTable(const std::string &fname, std::ostream &os);
+
+        /**
+           Writes, for each column c having a column c.ci, a file
+           named dir + c as GnuPlotOutput does: one line per row,
+           with the value of column param, the value of c and its
+           confidence interval.
+        */
+        static void exportGnuPlot(const std::string &fname, 
+                                  const std::string &param,
+                                  const std::string &dir = "");
+    };
+
+} // namespace MetaSim
+
+#endif
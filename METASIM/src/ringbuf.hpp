@@ -0,0 +1,96 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __RINGBUF_HPP__
+#define __RINGBUF_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+   \ingroup metasim_util
+
+   A FIFO queue of at most capacity() elements, stored in a
+   circular buffer. The storage grows (doubling) as elements are
+   pushed, up to the capacity, and never shrinks: once it has
+   reached the size needed by the queue, pushing and popping do
+   not allocate.
+
+   push_back() on a full buffer does nothing and returns false.
+*/
+template <class T, class Alloc = std::allocator<T> >
+class ring_buffer {
+    std::vector<T, Alloc> _v;
+    size_t _head;
+    size_t _size;
+    size_t _max;
+
+    void grow()
+    {
+        size_t n = _v.empty() ? 4 : 2 * _v.size();
+        if (n > _max) n = _max;
+
+        std::vector<T, Alloc> v(n);
+        for (size_t i = 0; i < _size; ++i) v[i] = (*this)[i];
+        _v.swap(v);
+        _head = 0;
+    }
+
+public:
+    /// A buffer of at most max elements
+    explicit ring_buffer(size_t max = 0) : _v(), _head(0), _size(0), _max(max) {}
+
+    /// Changes the capacity, and empties the buffer
+    void setCapacity(size_t max)
+    {
+        _v.clear();
+        _head = _size = 0;
+        _max = max;
+    }
+
+    size_t capacity() const { return _max; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool full() const { return _size >= _max; }
+
+    bool push_back(const T &x)
+    {
+        if (full()) return false;
+        if (_size == _v.size()) grow();
+        _v[(_head + _size) % _v.size()] = x;
+        _size++;
+        return true;
+    }
+
+    /// the (n+1)-th element from the front (0 == first)
+    T &operator[](size_t n) { return _v[(_head + n) % _v.size()]; }
+    const T &operator[](size_t n) const { return _v[(_head + n) % _v.size()]; }
+
+    T &front() { return _v[_head]; }
+    const T &front() const { return _v[_head]; }
+    T &back() { return (*this)[_size - 1]; }
+    const T &back() const { return (*this)[_size - 1]; }
+
+    void pop_front()
+    {
+        _head = (_head + 1) % _v.size();
+        _size--;
+    }
+
+    void pop_back() { _size--; }
+
+    void clear() { _head = _size = 0; }
+};
+
+#endif // __RINGBUF_HPP__
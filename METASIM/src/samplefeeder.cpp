@@ -0,0 +1,174 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+
+#include <randomvar.hpp>
+#include <samplefeeder.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    SampleFeed::SampleFeed(SampleFeeder *owner, RandomVar *v, size_t depth) :
+        _owner(owner), _var(v), _blocks(depth), _head(0), _tail(0),
+        _failed(false), _error()
+    {
+    }
+
+    SampleFeeder::SampleFeeder(size_t block, size_t depth) :
+        _block(block > 0 ? block : 1), _depth(depth > 0 ? depth : 1),
+        _feeds(), _idle(false), _stop(false), _m(), _cv(), _thread(),
+        _waits(0)
+    {
+    }
+
+    SampleFeeder::~SampleFeeder()
+    {
+        while (!_feeds.empty()) detach(*_feeds.back()->_var);
+        if (_thread.joinable()) {
+            {
+                lock_guard<mutex> l(_m);
+                _stop = true;
+            }
+            _cv.notify_all();
+            _thread.join();
+        }
+    }
+
+    bool SampleFeeder::produce()
+    {
+        // one block for each variable at a time, so that a
+        // variable does not wait while the others are filled
+        bool any = false, more = true;
+        while (more) {
+            more = false;
+            for (size_t i = 0; i < _feeds.size(); ++i) {
+                SampleFeed *f = _feeds[i];
+                size_t t = f->_tail.load(memory_order_relaxed);
+                if (f->_failed.load(memory_order_relaxed) ||
+                    t - f->_head.load() >= _depth) continue;
+
+                vector<double> &b = f->_blocks[t % _depth];
+                b.resize(_block);
+                try {
+                    f->_var->fill(&b[0], _block);
+                } catch (...) {
+                    f->_error = current_exception();
+                    f->_failed.store(true, memory_order_release);
+                    continue;
+                }
+                f->_tail.store(t + 1, memory_order_release);
+                any = more = true;
+            }
+        }
+        return any;
+    }
+
+    void SampleFeeder::loop()
+    {
+        unique_lock<mutex> l(_m);
+        while (!_stop) {
+            if (produce()) continue;
+            // a block consumed after produce() has seen the ring
+            // full is seen by the second call, or the consumer
+            // sees _idle and wakes the thread
+            _idle.store(true);
+            if (produce()) {
+                _idle.store(false);
+                continue;
+            }
+            _cv.wait(l, [this]() { return !_idle.load() || _stop; });
+        }
+    }
+
+    void SampleFeeder::wake()
+    {
+        if (!_idle.load()) return;
+        {
+            lock_guard<mutex> l(_m);
+            _idle.store(false);
+        }
+        _cv.notify_one();
+    }
+
+    void SampleFeeder::take(SampleFeed *f, vector<double> &buf)
+    {
+        size_t h = f->_head.load(memory_order_relaxed);
+        if (f->_tail.load(memory_order_acquire) == h) {
+            ++_waits;
+            while (f->_tail.load(memory_order_acquire) == h) {
+                if (f->_failed.load(memory_order_acquire))
+                    rethrow_exception(f->_error);
+                wake();
+                this_thread::yield();
+            }
+        }
+        buf.swap(f->_blocks[h % _depth]);
+        f->_head.store(h + 1);
+        wake();
+    }
+
+    void SampleFeeder::attach(RandomVar &v)
+    {
+        if (v._feed != 0) return;
+        SampleFeed *f = new SampleFeed(this, &v, _depth);
+
+        // the prefetched samples come first
+        if (v._bufPos < v._buf.size()) {
+            v._buf.erase(v._buf.begin(), v._buf.begin() + v._bufPos);
+            v._bufPos = 0;
+        }
+        else {
+            v._buf.assign(_block, 0);
+            v._bufPos = _block;
+        }
+        {
+            lock_guard<mutex> l(_m);
+            _feeds.push_back(f);
+            v._feed = f;
+            _idle.store(false);
+        }
+        if (!_thread.joinable()) _thread = thread(&SampleFeeder::loop, this);
+        else _cv.notify_one();
+    }
+
+    void SampleFeeder::detach(RandomVar &v)
+    {
+        SampleFeed *f = v._feed;
+        if (f == 0 || f->_owner != this) return;
+        {
+            lock_guard<mutex> l(_m);
+            _feeds.erase(find(_feeds.begin(), _feeds.end(), f));
+            v._feed = 0;
+        }
+
+        // the thread is not filling f anymore
+        vector<double> rest(v._buf.begin() + v._bufPos, v._buf.end());
+        size_t t = f->_tail.load(memory_order_acquire);
+        for (size_t h = f->_head.load(); h != t; ++h) {
+            const vector<double> &b = f->_blocks[h % _depth];
+            rest.insert(rest.end(), b.begin(), b.end());
+        }
+        if (rest.empty()) {
+            v._buf.assign(_block, 0);
+            v._bufPos = _block;
+        }
+        else {
+            v._buf.swap(rest);
+            v._bufPos = 0;
+        }
+        delete f;
+    }
+
+} // namespace MetaSim
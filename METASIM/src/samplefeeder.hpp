@@ -0,0 +1,146 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SAMPLEFEEDER_HPP__
+#define __SAMPLEFEEDER_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MetaSim {
+
+    class RandomVar;
+    class SampleFeeder;
+
+    /**
+       The queue of the blocks of samples of one variable: a ring
+       of depth blocks, filled by the thread of the feeder (which
+       advances tail) and consumed by the simulation thread (which
+       advances head).
+    */
+    class SampleFeed {
+        friend class SampleFeeder;
+        friend class RandomVar;
+
+        SampleFeeder *_owner;
+        RandomVar *_var;
+        std::vector<std::vector<double> > _blocks;
+        std::atomic<size_t> _head;
+        std::atomic<size_t> _tail;
+        /// set (after _error) when fill() has thrown
+        std::atomic<bool> _failed;
+        std::exception_ptr _error;
+
+        SampleFeed(SampleFeeder *owner, RandomVar *v, size_t depth);
+    };
+
+    /**
+       \ingroup metasim_util
+
+       A thread that draws the samples of some random variables in
+       advance, on another core. Each attached variable has a ring
+       of blocks, filled with RandomVar::fill(); when draw() has
+       consumed its current block, it takes the next one from the
+       ring, without locks, and it waits only if the thread is
+       late. The samples of a variable are drawn in the same order
+       as by get(), so that a simulation gives the same results
+       with or without a feeder.
+
+       <pre>
+       unique_ptr<RandomGen> g(RandomVar::getGenerator()->substream(1));
+       ExponentialVar iat(10, g.get());
+       SampleFeeder feeder;
+       feeder.attach(iat);         // iat.draw() now reads the ring
+       </pre>
+
+       The generator of an attached variable is used by the
+       thread: it must not be used by any other object (each
+       variable needs its own, for example from
+       RandomGen::substream()), and its state is ahead of the
+       values consumed by the simulation (so it should not be
+       saved with Simulation::checkpoint()). The variables of a
+       feeder must be drawn by a single thread (usually, one
+       feeder for each SimContext); attach() and detach() must
+       be called by that thread.
+
+       If fill() throws, draw() rethrows the exception after the
+       samples drawn before it.
+    */
+    class SampleFeeder {
+        friend class RandomVar;
+
+        size_t _block;
+        size_t _depth;
+        std::vector<SampleFeed *> _feeds;
+        /// true while the thread waits for a free block
+        std::atomic<bool> _idle;
+        bool _stop;
+        std::mutex _m;
+        std::condition_variable _cv;
+        std::thread _thread;
+        /// number of times draw() has waited for the thread
+        size_t _waits;
+
+        SampleFeeder(const SampleFeeder &);
+        SampleFeeder &operator=(const SampleFeeder &);
+
+        void loop();
+
+        /// fills the free blocks of all the variables
+        bool produce();
+
+        void wake();
+
+        /// the next block of f, swapped with buf (see RandomVar::refill())
+        void take(SampleFeed *f, std::vector<double> &buf);
+
+    public:
+        /**
+           Each variable has a ring of depth blocks of block
+           samples. The thread is started at the first attach().
+        */
+        SampleFeeder(size_t block = 256, size_t depth = 4);
+
+        /// Detaches all the variables and stops the thread
+        ~SampleFeeder();
+
+        /**
+           From now on, the samples of v are drawn by the thread
+           (v must not be attached to another feeder). The samples
+           already prefetched by v (see RandomVar::setPrefetch())
+           are consumed first.
+        */
+        void attach(RandomVar &v);
+
+        /**
+           The samples of v are drawn inline again: those already
+           drawn by the thread are moved in the prefetch buffer of
+           v, so that the sequence does not change.
+        */
+        void detach(RandomVar &v);
+
+        /// Number of attached variables
+        size_t size() const { return _feeds.size(); }
+
+        /// Number of times a variable had to wait for a block
+        size_t getWaits() const { return _waits; }
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,118 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <arena.hpp>
+#include <eventpool.hpp>
+#include <eventqueue.hpp>
+#include <randomvar.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    // context selected by the thread, NULL for the default one
+    static thread_local SimContext *_current = 0;
+
+    SimContext::SimContext() :
+        eventQueue(new SetEventQueue()),
+        lane(),
+        eventCounter(0),
+        queueGeneration(1),
+        disposablePosted(false),
+        eventPools(),
+        eventSlab(0),
+        entities(),
+        randomVars(),
+        statList(),
+        totalNumOfExp(0),
+        expNum(0),
+        endOfSim(false),
+        statInit(false),
+        transitory(0),
+        statEvents(),
+        statsActive(true),
+        statActivation(0),
+        profiler(0),
+        metrics(0),
+        snapshots(0),
+        pacer(0),
+        inbox(0),
+        _sim(0),
+        _arena(0)
+    {
+        _sim = new Simulation(this);
+    }
+
+    SimContext::~SimContext()
+    {
+        if (_arena) releaseArena();
+        if (_current == this) _current = 0;
+        // the variables that outlive the context forget it
+        for (std::set<RandomVar *>::iterator i = randomVars.begin();
+             i != randomVars.end(); ++i)
+            (*i)->_ctx = 0;
+        for (size_t i = 0; i < eventPools.size(); ++i)
+            for (size_t j = 0; j < eventPools[i].size(); ++j)
+                delete eventPools[i][j];
+        delete statActivation;
+        delete _sim;
+        delete eventQueue;
+        delete eventSlab;
+    }
+
+    ModelArena &SimContext::arena()
+    {
+        if (_arena == 0) _arena = new ModelArena();
+        return *_arena;
+    }
+
+    void SimContext::releaseArena()
+    {
+        SimContext *prev = setCurrent(this);
+
+        // the objects of the model are all going away: empty the
+        // queue and the lists at once, so that they do not have
+        // to remove themselves one by one
+        _sim->clearEventQueue();
+        statList.clear();
+        statEvents.clear();
+        entities.clear();
+        _arena->release();
+        delete _arena;
+        _arena = 0;
+
+        setCurrent(prev);
+    }
+
+    SimContext *SimContext::getDefault()
+    {
+        // never destroyed, as entities and events may be static
+        // objects that outlive any other static object
+        static SimContext *def = new SimContext();
+        return def;
+    }
+
+    SimContext *SimContext::current()
+    {
+        if (_current != 0) return _current;
+        else return getDefault();
+    }
+
+    SimContext *SimContext::setCurrent(SimContext *c)
+    {
+        SimContext *prev = _current;
+        _current = c;
+        return prev;
+    }
+
+} // namespace MetaSim
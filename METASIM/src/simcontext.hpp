@@ -0,0 +1,191 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SIMCONTEXT_HPP__
+#define __SIMCONTEXT_HPP__
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <basetype.hpp>
+#include <entityregistry.hpp>
+#include <eventqueue.hpp>
+
+namespace MetaSim {
+
+    class BaseStat;
+    class Event;
+    class EventInbox;
+    class EventProfiler;
+    class EventSlab;
+    class ModelArena;
+    class RandomVar;
+    class SimMetrics;
+    class Simulation;
+    class StatSnapshots;
+    class WallClockPacer;
+
+    /**
+       \ingroup metasim_ee
+
+       The state of one simulation: the simulation engine (with
+       its clock), the event queue, the registry of the entities
+       and the list of the statistical objects.
+
+       Each thread has a current context, returned by current();
+       SIMUL, the entities, the events and the statistics created
+       in a thread belong to its current context. When no context
+       has been selected, the current context is the default one,
+       so programs that use a single simulation do not need to
+       know about contexts at all.
+
+       To run several independent simulations in the same process
+       (for example, one per thread), create one context for each
+       of them and select it with a Scope before building the
+       system:
+
+       <pre>
+       SimContext ctx;
+       SimContext::Scope s(&ctx);
+       // create tasks, kernels, stats, ...
+       SIMUL.run(1000);
+       </pre>
+
+       All the objects of a context must be destroyed before the
+       context itself, except those created in its arena (see
+       arena()). A context must not be used by two threads at the
+       same time.
+    */
+    class SimContext {
+        SimContext(const SimContext &);
+        SimContext &operator=(const SimContext &);
+
+    public:
+        SimContext();
+        ~SimContext();
+
+        /// The context of the calling thread
+        static SimContext *current();
+
+        /**
+           Selects the context of the calling thread (NULL selects
+           the default context), and returns the previous one.
+        */
+        static SimContext *setCurrent(SimContext *c);
+
+        /// The context used when none has been selected
+        static SimContext *getDefault();
+
+        /**
+           Makes a context current for the lifetime of the Scope
+           object, restoring the previous one on destruction.
+        */
+        class Scope {
+            SimContext *_prev;
+            Scope(const Scope &);
+            Scope &operator=(const Scope &);
+        public:
+            explicit Scope(SimContext *c) : _prev(setCurrent(c)) {}
+            ~Scope() { setCurrent(_prev); }
+        };
+
+        /// The simulation engine of this context
+        Simulation &simulation() { return *_sim; }
+
+        /// @name Event queue
+        //@{
+        EventQueue *eventQueue;
+        /// the events posted now with the immediate priority,
+        /// outside the backend (see ImmediateLane)
+        ImmediateLane lane;
+        /// counter for fifo insertion
+        long eventCounter;
+        /// changed when the queue is emptied at once (see
+        /// Event::clearQueue()): an event is queued only if posted
+        /// in the current generation
+        unsigned long queueGeneration;
+        /// true if a disposable event has been posted since the
+        /// queue was last emptied
+        bool disposablePosted;
+        /// free lists of recycled events, one for each type
+        /// (see EventPool)
+        std::vector<std::vector<Event *> > eventPools;
+        /// memory of the pooled events on huge pages, or NULL
+        /// (see EventSlab)
+        EventSlab *eventSlab;
+        //@}
+
+        /// @name Entity registry
+        //@{
+        EntityRegistry entities;
+
+        /// the live random variables created in the context
+        /// (checked by Checkpoint)
+        std::set<RandomVar *> randomVars;
+        //@}
+
+        /// @name Statistics
+        //@{
+        std::list<BaseStat *> statList;
+        size_t totalNumOfExp;
+        size_t expNum;
+        bool endOfSim;
+        bool statInit;
+        Tick transitory;
+        /// the events with stats attached (see Event::addStat())
+        std::vector<Event *> statEvents;
+        /// false during the transitory, when the stats of the
+        /// events are not called (see BaseStat::attachProbes())
+        bool statsActive;
+        /// the event that activates them at the end of the
+        /// transitory, or NULL
+        Event *statActivation;
+        //@}
+
+        /// The profiler of the event loop, or NULL (see Simulation::setProfiler())
+        EventProfiler *profiler;
+
+        /// The progress counters, or NULL (see Simulation::setMetrics())
+        SimMetrics *metrics;
+
+        /// The snapshots of the stats, or NULL (see Simulation::setSnapshots())
+        StatSnapshots *snapshots;
+
+        /// The wall-clock pacing of the loop, or NULL (see Simulation::setPacer())
+        WallClockPacer *pacer;
+
+        /// The actions posted by other threads, or NULL (see Simulation::setInbox())
+        EventInbox *inbox;
+
+        /**
+           The arena of the model (created at the first call): the
+           objects created in it are destroyed with the context,
+           before anything else (see ModelArena).
+        */
+        ModelArena &arena();
+
+    private:
+        Simulation *_sim;
+        ModelArena *_arena;
+
+        /// destroys the objects of the arena
+        void releaseArena();
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,159 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+
+#include <simmetrics.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        int64_t wallNanos()
+        {
+            return chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    SimMetrics::SimMetrics(uint64_t period) :
+        _events(0), _time(0), _queue(0), _run(0), _runs(0), _end(0),
+        _done(false), _start(0), _last(0),
+        _period(period > 0 ? period : 1), _file(), _interval(10),
+        _lastWrite(0)
+    {
+    }
+
+    void SimMetrics::setTextfile(const string &file, double interval)
+    {
+        _file = file;
+        _interval = interval;
+    }
+
+    void SimMetrics::beginRun(int run, int runs, Tick end)
+    {
+        int64_t now = wallNanos();
+        if (_start.load(memory_order_relaxed) == 0) {
+            _start.store(now, memory_order_relaxed);
+            _lastWrite = now;
+        }
+        _run.store(run, memory_order_relaxed);
+        _runs.store(runs, memory_order_relaxed);
+        _end.store((long int)end, memory_order_relaxed);
+        _time.store(0, memory_order_relaxed);
+        _done.store(false, memory_order_relaxed);
+        _last.store(now, memory_order_relaxed);
+    }
+
+    void SimMetrics::publish(uint64_t events, Tick now, size_t queue)
+    {
+        int64_t w = wallNanos();
+        _events.store(_events.load(memory_order_relaxed) + events,
+                      memory_order_relaxed);
+        _time.store((long int)now, memory_order_relaxed);
+        _queue.store(queue, memory_order_relaxed);
+        _last.store(w, memory_order_relaxed);
+
+        if (!_file.empty() && (w - _lastWrite) * 1e-9 >= _interval) {
+            writeTextfile(_file);
+            _lastWrite = w;
+        }
+    }
+
+    void SimMetrics::finish()
+    {
+        _last.store(wallNanos(), memory_order_relaxed);
+        _done.store(true, memory_order_release);
+        if (!_file.empty()) writeTextfile(_file);
+    }
+
+    double SimMetrics::getElapsed() const
+    {
+        int64_t s = _start.load(memory_order_relaxed);
+        if (s == 0) return 0;
+        int64_t e = isDone() ? _last.load(memory_order_relaxed) : wallNanos();
+        return (e - s) * 1e-9;
+    }
+
+    double SimMetrics::getStalledSeconds() const
+    {
+        if (isDone() || _start.load(memory_order_relaxed) == 0) return 0;
+        return (wallNanos() - _last.load(memory_order_relaxed)) * 1e-9;
+    }
+
+    double SimMetrics::getEventsPerSecond() const
+    {
+        double e = getElapsed();
+        return e > 0 ? getEvents() / e : 0;
+    }
+
+    double SimMetrics::getSimRate() const
+    {
+        double e = getElapsed();
+        if (e <= 0) return 0;
+        double ticks = double(getEndTime()) * getRun() + double(getSimTime());
+        return ticks / e;
+    }
+
+    double SimMetrics::getETA() const
+    {
+        if (isDone()) return 0;
+        double r = getSimRate();
+        if (r <= 0) return -1;
+        double left = double(getEndTime()) * (getRuns() - getRun()) -
+            double(getSimTime());
+        return left > 0 ? left / r : 0;
+    }
+
+    void SimMetrics::writePrometheus(ostream &os) const
+    {
+        os << "# HELP metasim_events_total Events processed.\n"
+           << "# TYPE metasim_events_total counter\n"
+           << "metasim_events_total " << getEvents() << "\n"
+           << "# TYPE metasim_sim_time gauge\n"
+           << "metasim_sim_time " << getSimTime() << "\n"
+           << "# TYPE metasim_queue_size gauge\n"
+           << "metasim_queue_size " << getQueueSize() << "\n"
+           << "# TYPE metasim_run gauge\n"
+           << "metasim_run " << getRun() << "\n"
+           << "# TYPE metasim_runs gauge\n"
+           << "metasim_runs " << getRuns() << "\n"
+           << "# TYPE metasim_elapsed_seconds gauge\n"
+           << "metasim_elapsed_seconds " << getElapsed() << "\n"
+           << "# TYPE metasim_events_per_second gauge\n"
+           << "metasim_events_per_second " << getEventsPerSecond() << "\n"
+           << "# TYPE metasim_sim_rate gauge\n"
+           << "metasim_sim_rate " << getSimRate() << "\n"
+           << "# TYPE metasim_eta_seconds gauge\n"
+           << "metasim_eta_seconds " << getETA() << "\n"
+           << "# TYPE metasim_done gauge\n"
+           << "metasim_done " << (isDone() ? 1 : 0) << "\n";
+    }
+
+    void SimMetrics::writeTextfile(const string &file) const
+    {
+        // the collector must never read a partial file
+        string tmp = file + ".tmp";
+        {
+            ofstream os(tmp.c_str());
+            if (!os) return;
+            writePrometheus(os);
+        }
+        rename(tmp.c_str(), file.c_str());
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,141 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SIMMETRICS_HPP__
+#define __SIMMETRICS_HPP__
+
+#include <atomic>
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       The progress of a running Simulation (see
+       Simulation::setMetrics()), readable at any time from
+       another thread, for example by a watchdog that stops the
+       configurations that are too slow or are not progressing.
+
+       The simulation thread publishes its counters (events
+       processed, simulation time, queue length, current run)
+       every getPeriod() events, with relaxed atomic stores, so
+       the overhead on the event loop is one counter and one
+       comparison per event. The rates and the estimated time to
+       completion are computed by the reader.
+
+       If a file name has been set with setTextfile(), the
+       counters are also written there (at most once every
+       interval seconds, replacing the file atomically) in the
+       text exposition format of Prometheus, to be collected by
+       the textfile collector of the node exporter.
+
+       <pre>
+       SimMetrics m;
+       m.setTextfile("/var/lib/node_exporter/sim.prom", 10);
+       SIMUL.setMetrics(&m);
+       std::thread watchdog([&]() {
+           while (!m.isDone()) {
+               if (m.getStalledSeconds() > 600) abort();
+               sleep(60);
+           }
+       });
+       SIMUL.run(1000000, 30);
+       </pre>
+
+       An object follows one context. The counters are not reset
+       between runs, only the simulation time is.
+    */
+    class SimMetrics {
+        std::atomic<uint64_t> _events;
+        std::atomic<Tick::impl_t> _time;
+        std::atomic<uint64_t> _queue;
+        std::atomic<int> _run;
+        std::atomic<int> _runs;
+        std::atomic<Tick::impl_t> _end;
+        std::atomic<bool> _done;
+        /// wall clock (ns) of the start and of the last publication
+        std::atomic<int64_t> _start;
+        std::atomic<int64_t> _last;
+
+        uint64_t _period;
+        std::string _file;
+        double _interval;
+        int64_t _lastWrite;
+
+        SimMetrics(const SimMetrics &);
+        SimMetrics &operator=(const SimMetrics &);
+
+    public:
+        /// Publishes every period events (at least 1)
+        explicit SimMetrics(uint64_t period = 4096);
+
+        uint64_t getPeriod() const { return _period; }
+
+        /**
+           Writes the counters on file every interval seconds (an
+           empty name disables the export). The file is written
+           in the simulation thread.
+        */
+        void setTextfile(const std::string &file, double interval = 10);
+
+        /// @name Called by the simulation thread
+        //@{
+        /// starts run number run (from 0) of runs, up to end
+        void beginRun(int run, int runs, Tick end);
+        /// events have been processed since the last call
+        void publish(uint64_t events, Tick now, size_t queue);
+        /// the simulation is over
+        void finish();
+        //@}
+
+        /// @name Readable from any thread
+        //@{
+        uint64_t getEvents() const { return _events.load(std::memory_order_relaxed); }
+        Tick getSimTime() const { return Tick(_time.load(std::memory_order_relaxed)); }
+        size_t getQueueSize() const { return _queue.load(std::memory_order_relaxed); }
+        int getRun() const { return _run.load(std::memory_order_relaxed); }
+        int getRuns() const { return _runs.load(std::memory_order_relaxed); }
+        Tick getEndTime() const { return Tick(_end.load(std::memory_order_relaxed)); }
+        bool isDone() const { return _done.load(std::memory_order_acquire); }
+
+        /// wall seconds since the first run started
+        double getElapsed() const;
+        /// wall seconds since the last publication (a stall
+        /// detector: it grows while an event does not terminate)
+        double getStalledSeconds() const;
+        /// events processed per wall second
+        double getEventsPerSecond() const;
+        /// ticks of simulation time per wall second, over all runs
+        double getSimRate() const;
+        /**
+           Estimated wall seconds to the end of the last run, at
+           the current simulation rate (negative if not known yet).
+        */
+        double getETA() const;
+        //@}
+
+        /// Writes the counters in the Prometheus text format
+        void writePrometheus(std::ostream &os) const;
+
+        /// Writes the counters on file, replacing it atomically
+        void writeTextfile(const std::string &file) const;
+    };
+
+} // namespace MetaSim
+
+#endif
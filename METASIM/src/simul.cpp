@@ -11,35 +11,57 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
 #include <deque>
-
+#include <exception>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
+#include <engine.hpp>
 #include <entity.hpp>
+#include <memstats.hpp>
+#include <inbox.hpp>
+#include <pacer.hpp>
+#include <particle.hpp>
+#include <randomvar.hpp>
 #include <simul.hpp>
+#include <snapshots.hpp>
+#include <stateimage.hpp>
+#include <topology.hpp>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 namespace MetaSim {
     using namespace std;
 
-    Simulation *Simulation::instance_ = 0;
-        
     class NoMoreEventsInQueue {};
 
 
-    Simulation::Simulation() : dbg(), numRuns(0), 
+    Simulation::Simulation(SimContext *c) : _ctx(c), dbg(), numRuns(0), 
                                actRuns(0),
                                globTime (0),
-                               end (false)
+                               end (false),
+                               batchStepping (false),
+                               replicaStreams (false),
+                               antitheticPairs (false),
+                               pinning (false),
+                               ffPeriod (0),
+                               ffFrom (0),
+                               ffSkipped (0),
+                               stopped (false),
+                               stopPredicates (),
+                               snapNext (0)
     {
     }
 
-    Simulation& Simulation::getInstance()
-    {
-        if (instance_ == 0) instance_ = new Simulation();
-                
-        return *instance_;
-    }
-        
         
     const Tick Simulation::getTime()
     {
@@ -52,36 +74,43 @@ namespace MetaSim {
     }
 
         
-    // this function performs one single simulation step 
-    // It returns the tick after the simulation step has been completed
-    const Tick Simulation::sim_step() 
+    // this function performs one single simulation step.
+    // It returns false if there are no events in the queue, otherwise
+    // it stores in t the tick of the executed event
+    bool Simulation::step(Tick &t)
+    {
+        return BasicEngine<>(*this).step(t);
+    }
+        
+    // this function performs all the events with the same time and
+    // priority of the first one in the queue
+    bool Simulation::batchStep(Tick &t)
     {
-        Event *temp;
-        Tick mytime;
+        return BasicEngine<>(*this).batchStep(t);
+    }
 
-        DBGENTER(_SIMUL_DBG_LEV);
+    inline Event *Simulation::nextEvent()
+    {
+        if (_ctx->inbox) drainInbox();
+        return Event::getFirst();
+    }
 
-        temp = Event::getFirst();   // takes the first event in the queue ...
-        if (temp == NULL) throw NoMoreEventsInQueue();
-        temp->drop();               // ... and extract it!
-          
-        mytime = temp->getTime();   // stores the current time 
-          
-        DBGPRINT_3("Executing event action at time [",  mytime, "]: ");
-#ifdef __DEBUG__
-        temp->print();
-        print();
-#endif
+    const Tick Simulation::sim_step() 
+    {
+        Tick t;
+        if (_ctx->inbox) drainInbox();
+        if (!step(t)) throw NoMoreEventsInQueue();
+        return t;
+    }
 
-        setTime(mytime);
-          
-        temp->action();               // do what it is supposed to do...
-        if (temp->isDisposable())     // if it has to be deleted...
-            delete temp;                // delete it!
-          
-        return mytime;
+    const Tick Simulation::sim_batch_step()
+    {
+        Tick t;
+        if (_ctx->inbox) drainInbox();
+        if (!batchStep(t)) throw NoMoreEventsInQueue();
+        return t;
     }
-        
+
     // this event returns the time of the first event in the queue
     // (i.e. the next event to be processed) or throws and exception 
     // if there is no more events in the queue
@@ -99,20 +128,60 @@ namespace MetaSim {
     // it stops before executing the first event after stop
     const Tick Simulation::run_to(const Tick &stop)
     {
-        try {
-            while (getNextEventTime() <= stop) {
-                globTime = sim_step();
-            }
-        } catch (NoMoreEventsInQueue &e) {
+        SimContext::Scope scope(_ctx);
+        Event *first = NULL;
+
+        uint64_t n = 0;
+
+        if (_ctx->profiler) _ctx->profiler->beginPhase("main loop");
+        while (!stopped && (first = nextEvent()) != NULL && 
+               first->getTime() <= stop) {
+            snapshotsTo(first->getTime());
+            paceTo(first->getTime());
+            if (batchStepping) batchStep(globTime);
+            else step(globTime);
+            if (_ctx->metrics) count(n);
+            if (!stopPredicates.empty()) checkStop();
+        }
+        if (_ctx->metrics) 
+            _ctx->metrics->publish(n, globTime, _ctx->eventQueue->size());
+        if (_ctx->profiler) _ctx->profiler->endPhase();
+        if (first == NULL && !stopped)
             cerr << "No more events in queue: simulation time = " 
                  << globTime << endl;
-        }
 
-        if (globTime < stop) globTime = stop; 
+        if (!stopped) snapshotsTo(stop);
+        if (globTime < stop && !stopped) globTime = stop; 
 
         return globTime;
     }
 
+    namespace {
+        /// stops the current simulation when its event is processed
+        class StopParticle : public ParticleInterface {
+        public:
+            void probe() { SIMUL.stop(); }
+        };
+    }
+
+    void Simulation::stopOn(Event &e)
+    {
+        e.addParticle(new StopParticle());
+    }
+
+    void Simulation::checkpoint(Checkpoint &c)
+    {
+        SimContext::Scope scope(_ctx);
+        c.take(_ctx, globTime);
+    }
+
+    void Simulation::restore(Checkpoint &c)
+    {
+        SimContext::Scope scope(_ctx);
+        globTime = c.apply(_ctx);
+        stopped = false;
+    }
+
                 
     void Simulation::initRuns(int nRuns)
     {
@@ -123,7 +192,11 @@ namespace MetaSim {
 
     void Simulation::initSingleRun()
     {
+        if (_ctx->profiler) _ctx->profiler->beginPhase("initSingleRun");
         globTime = 0;
+        stopped = false;
+        if (_ctx->snapshots) snapNext = _ctx->snapshots->getPeriod();
+        if (_ctx->pacer) _ctx->pacer->beginRun();
 
         // Run Initialization:
         // Before each run, call the newRun() of every entity
@@ -131,21 +204,475 @@ namespace MetaSim {
         Entity::callNewRun();
 
         BaseStat::newRun();
+        BaseStat::attachProbes();
+        if (_ctx->profiler) _ctx->profiler->endPhase();
     }
 
     void Simulation::endSingleRun()
     {
+        if (_ctx->profiler) _ctx->profiler->beginPhase("endSingleRun");
         Entity::callEndRun();
         BaseStat::endRun();
+        MemStats::report();
 
         clearEventQueue();
+        if (_ctx->profiler) _ctx->profiler->endPhase();
     }
 
 
+    void Simulation::count(uint64_t &n)
+    {
+        if (++n < _ctx->metrics->getPeriod()) return;
+        _ctx->metrics->publish(n, globTime, _ctx->eventQueue->size());
+        n = 0;
+    }
+
+    void Simulation::setFastForward(Tick period, Tick from)
+    {
+        if (period < 0 || from < 0) 
+            throw FastForwardExc("Negative fast-forward period or start");
+        ffPeriod = period;
+        ffFrom = from;
+    }
+
+    bool Simulation::fastForward(Tick endTick, uint64_t &n)
+    {
+        StateImage img[2];
+        std::unique_ptr<Checkpoint> stats[2];
+        int cur = 0;
+        bool prev = false;
+
+        for (Tick b = ffFrom; b < endTick; b += ffPeriod) {
+            Event *first;
+            while (!stopped && (first = nextEvent()) != NULL && 
+                   first->getTime() < b) {
+                snapshotsTo(first->getTime());
+                paceTo(first->getTime());
+                if (batchStepping) batchStep(globTime);
+                else step(globTime);
+                if (_ctx->metrics) count(n);
+                if (!stopPredicates.empty()) checkStop();
+            }
+            if (stopped) return true;
+            if (first == NULL) return false;
+
+            if (!img[cur].take(_ctx, b)) return true;
+            stats[cur].reset(new Checkpoint());
+            for (BaseStat::List::iterator i = _ctx->statList.begin();
+                 i != _ctx->statList.end(); ++i)
+                (*i)->saveState(*stats[cur]);
+
+            long int m = (long int)(endTick - b) / (long int)ffPeriod;
+            if (prev && b - ffPeriod >= _ctx->transitory && m > 0 &&
+                img[cur] == img[1 - cur]) {
+                bool ok = true;
+                for (BaseStat::List::iterator i = _ctx->statList.begin();
+                     ok && i != _ctx->statList.end(); ++i)
+                    ok = (*i)->repeat(*stats[1 - cur], m);
+                if (ok) ffSkipped = ffPeriod * m;
+                else {
+                    // back to the values at b
+                    for (BaseStat::List::iterator i = _ctx->statList.begin();
+                         i != _ctx->statList.end(); ++i)
+                        (*i)->loadState(*stats[cur]);
+                }
+                return true;
+            }
+            prev = true;
+            cur = 1 - cur;
+        }
+        return true;
+    }
+
+    bool Simulation::runCycle(Tick endTick)
+    {
+        bool more = true;
+        uint64_t n = 0;
+        if (_ctx->profiler) _ctx->profiler->beginPhase("main loop");
+        ffSkipped = 0;
+        if (ffPeriod > 0) more = fastForward(endTick, n);
+        endTick -= ffSkipped;
+        while (more && !stopped && globTime < endTick) {
+            // the last event (at or after endTick) is
+            // always processed alone
+            Event *first = nextEvent();
+            if (first == NULL) more = false;
+            else {
+                snapshotsTo(first->getTime() < endTick ? 
+                            first->getTime() : endTick);
+                paceTo(first->getTime() < endTick ? 
+                       first->getTime() : endTick);
+                if (batchStepping && first->getTime() < endTick) 
+                    more = batchStep(globTime);
+                else more = step(globTime);
+            }
+            if (_ctx->metrics) count(n);
+            if (!stopPredicates.empty()) checkStop();
+        }
+        if (!stopped) snapshotsTo(endTick);
+        globTime += ffSkipped;
+        if (_ctx->metrics) 
+            _ctx->metrics->publish(n, globTime, _ctx->eventQueue->size());
+        if (_ctx->profiler) _ctx->profiler->endPhase();
+        return more;
+    }
+
+    struct Simulation::Replica {
+        int rep;
+        std::unique_ptr<SimContext> ctx;
+        std::shared_ptr<void> model;
+        Replica *next;
+
+        Replica(int r) : rep(r), ctx(new SimContext()), model(), next(0) {}
+        ~Replica() {
+            // the model must be destroyed in its context, and
+            // before it
+            SimContext::Scope s(ctx.get());
+            model.reset();
+        }
+    };
+
+    void Simulation::setReplicaStream(RandomGen *g, unsigned long rep, 
+                                      bool pairs)
+    {
+        if (pairs) {
+            g->setStream(rep / 2);
+            g->setAntithetic(rep % 2 == 1);
+        }
+        else g->setStream(rep);
+    }
+
+    void Simulation::runReplica(Tick endTick, const ModelBuilder &build,
+                                const RandomGen &base, unsigned long rep,
+                                bool pairs, vector<double> &res, 
+                                std::atomic<Replica *> &done)
+    {
+        std::unique_ptr<Replica> r(new Replica(rep));
+        SimContext::Scope scope(r->ctx.get());
+        std::unique_ptr<RandomGen> gen(base.clone());
+        setReplicaStream(gen.get(), rep, pairs);
+        RandomGen *old = RandomVar::changeGenerator(gen.get());
+
+        try {
+            r->model = build();
+            Simulation &s = r->ctx->simulation();
+
+            s.initRuns(1);
+            s.initSingleRun();
+            s.runCycle(endTick);
+            s.endSingleRun();
+            s.endSim();
+
+            BaseStat::getLastRun(res);
+        } catch (...) {
+            RandomVar::changeGenerator(old);
+            throw;
+        }
+        RandomVar::changeGenerator(old);
+
+        Replica *p = r.release();
+        p->next = done.load();
+        while (!done.compare_exchange_weak(p->next, p)) ;
+    }
+
+    void Simulation::runReplicas(Tick endTick, const ModelBuilder &build,
+                                 int first, int last, int nThreads,
+                                 vector<vector<double> > &results)
+    {
+        if (nThreads <= 0) nThreads = Topology::get().getDefaultThreads();
+        if (nThreads > last - first) nThreads = last - first;
+
+        // replica k uses stream k of the standard generator, so the
+        // results do not depend on the number of threads
+        const RandomGen &base = *RandomVar::getGenerator();
+
+        std::atomic<int> next(first);
+        std::atomic<Replica *> done(0);
+        std::exception_ptr error;
+        std::mutex m;
+
+        // the completed replicas are merged in order of replica,
+        // so that the result does not depend on the number of
+        // threads
+        std::map<int, std::unique_ptr<Replica> > pending;
+        int merged = first;
+        auto merge = [&]() {
+            for (Replica *p = done.exchange(0); p != 0; ) {
+                Replica *n = p->next;
+                pending[p->rep].reset(p);
+                p = n;
+            }
+            while (!pending.empty() && pending.begin()->first == merged) {
+                std::unique_ptr<Replica> r(std::move(pending.begin()->second));
+                pending.erase(pending.begin());
+                SimContext::Scope scope(_ctx);
+                BaseStat::mergeFrom(r->ctx.get());
+                ++merged;
+            }
+        };
+
+        auto worker = [&](int id) {
+            // the replicas are built after pinning, on the node
+            Topology::Pin pin(id, pinning);
+            bool merging = id == 0;
+            for (int k = next++; k < last; k = next++) {
+                try {
+                    runReplica(endTick, build, base, k, antitheticPairs,
+                               results[k], done);
+                    if (merging) merge();
+                } catch (...) {
+                    std::lock_guard<std::mutex> l(m);
+                    if (!error) error = std::current_exception();
+                }
+            }
+        };
+
+        vector<std::thread> pool;
+        for (int i = 1; i < nThreads; ++i) 
+            pool.push_back(std::thread(worker, i));
+        worker(0);
+        for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+
+        if (!error) {
+            try {
+                merge();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        // the replicas that follow a failed one are not merged
+        for (Replica *p = done.exchange(0); p != 0; ) {
+            Replica *n = p->next;
+            delete p;
+            p = n;
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void Simulation::run(Tick endTick, int nRuns, int nThreads, 
+                         const ModelBuilder &build)
+    {
+        DBGENTER(_SIMUL_DBG_LEV);
+
+        if (nRuns < 1) nRuns = 1;
+        if (nRuns == 2) {
+            cout << "Warning: Simulation cannot be "
+                "initialized with 2 runs" << endl;
+            cout << "         Executing 3 runs!" << endl;
+            nRuns = 3;
+        }
+
+        {
+            // the stats accumulate the replicas from scratch
+            SimContext::Scope scope(_ctx);
+            BaseStat::newRun();
+        }
+        vector<vector<double> > results(nRuns);
+        runReplicas(endTick, build, 0, nRuns, nThreads, results);
+
+        SimContext::Scope scope(_ctx);
+        BaseStat::mergeRuns(results);
+        numRuns = actRuns = nRuns;
+        end = true;
+    }
+
+    int Simulation::runToPrecision(Tick endTick, 
+                                   const vector<BaseStat *> &stats,
+                                   double precision, int nThreads,
+                                   const ModelBuilder &build, 
+                                   int minRuns, int maxRuns,
+                                   BaseStat::CONFIDENCE_INTERVAL c)
+    {
+        DBGENTER(_SIMUL_DBG_LEV);
+
+        if (minRuns < 3) minRuns = 3;
+        if (maxRuns > 0 && minRuns > maxRuns) minRuns = maxRuns;
+
+        SimContext::Scope scope(_ctx);
+        BaseStat::newRun();
+        vector<vector<double> > results;
+        int n = 0;
+        int more = minRuns;
+
+        while (more > 0) {
+            results.resize(n + more);
+            runReplicas(endTick, build, n, n + more, nThreads, results);
+            n += more;
+            BaseStat::mergeRuns(results);
+            numRuns = actRuns = n;
+            end = true;
+
+            // the number of replicas needed by the least precise
+            // stat, assuming its variance does not change
+            double needed = n;
+            bool done = true;
+            for (size_t i = 0; i < stats.size(); ++i) {
+                double h = stats[i]->getConfInterval(c);
+                double target = precision * fabs(stats[i]->getMean());
+                if (h <= target) continue;
+                done = false;
+                if (target == 0) needed = 2.0 * n;
+                else needed = max(needed, n * (h / target) * (h / target));
+            }
+
+            if (done) break;
+            more = max(int(min(ceil(needed), 2.0 * n)) - n, 1);
+            if (maxRuns > 0 && n + more > maxRuns) more = maxRuns - n;
+        }
+        return n;
+    }
+
+#ifndef _WIN32
+    // write/read the whole buffer, restarting after signals
+    static bool writeAll(int fd, const void *p, size_t n)
+    {
+        const char *c = static_cast<const char *>(p);
+        while (n > 0) {
+            ssize_t r = ::write(fd, c, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            c += r;
+            n -= r;
+        }
+        return true;
+    }
+
+    static bool readAll(int fd, void *p, size_t n)
+    {
+        char *c = static_cast<char *>(p);
+        while (n > 0) {
+            ssize_t r = ::read(fd, c, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            c += r;
+            n -= r;
+        }
+        return true;
+    }
+
+    void Simulation::forkedReplica(Tick endTick, int rep, int fd)
+    {
+        int code = 1;
+        // the counters of the parent are not updated by the
+        // children, and the threads posting in its inbox do not
+        // reach them
+        _ctx->metrics = 0;
+        _ctx->snapshots = 0;
+        _ctx->inbox = 0;
+        try {
+            setReplicaStream(RandomVar::getGenerator(), rep, antitheticPairs);
+            runCycle(endTick);
+            endSingleRun();
+
+            vector<double> v;
+            BaseStat::getLastRun(v);
+            size_t n = v.size();
+            if (writeAll(fd, &n, sizeof(n)) &&
+                (n == 0 || writeAll(fd, &v[0], n * sizeof(double))))
+                code = 0;
+        } catch (...) {
+        }
+        ::close(fd);
+        // skip the destructors of the objects shared with the parent
+        _exit(code);
+    }
+#endif
+
+    void Simulation::runForked(Tick endTick, int nRuns, int nProcs)
+    {
+#ifdef _WIN32
+        throw ForkedRunExc("Forked runs are not supported on this platform");
+#else
+        SimContext::Scope scope(_ctx);
+        DBGENTER(_SIMUL_DBG_LEV);
+
+        if (nRuns < 1) nRuns = 1;
+        if (nRuns == 2) {
+            cout << "Warning: Simulation cannot be "
+                "initialized with 2 runs" << endl;
+            cout << "         Executing 3 runs!" << endl;
+            nRuns = 3;
+        }
+        if (nProcs <= 0) nProcs = Topology::get().getDefaultThreads();
+        if (nProcs <= 0) nProcs = 1;
+
+        // the shared warm-up
+        initRuns(nRuns);
+        initSingleRun();
+        Tick warmup = _ctx->transitory;
+        if (warmup > endTick) warmup = endTick;
+        runCycle(warmup);
+
+        cout.flush();
+        cerr.flush();
+
+        struct Child { pid_t pid; int fd; int rep; };
+        std::deque<Child> running;
+        vector<vector<double> > results(nRuns);
+        string error;
+
+        int k = 0;
+        while ((k < nRuns && error.empty()) || !running.empty()) {
+            if (k < nRuns && error.empty() && 
+                int(running.size()) < nProcs) {
+                int fds[2];
+                if (pipe(fds) != 0) {
+                    error = "cannot create a pipe";
+                    continue;
+                }
+                pid_t pid = fork();
+                if (pid == 0) {
+                    ::close(fds[0]);
+                    forkedReplica(endTick, k, fds[1]);
+                }
+                ::close(fds[1]);
+                if (pid < 0) {
+                    ::close(fds[0]);
+                    error = "cannot fork";
+                    continue;
+                }
+                Child c = { pid, fds[0], k++ };
+                running.push_back(c);
+            }
+            else {
+                Child c = running.front();
+                running.pop_front();
+
+                size_t n = 0;
+                vector<double> &v = results[c.rep];
+                bool ok = readAll(c.fd, &n, sizeof(n));
+                if (ok) {
+                    v.resize(n);
+                    ok = n == 0 || readAll(c.fd, &v[0], n * sizeof(double));
+                }
+                ::close(c.fd);
+
+                int status;
+                while (waitpid(c.pid, &status, 0) < 0 && errno == EINTR) ;
+                if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    if (error.empty()) {
+                        stringstream ss;
+                        ss << "replica " << c.rep << " failed";
+                        error = ss.str();
+                    }
+                }
+            }
+        }
+
+        endSingleRun();
+        if (!error.empty()) throw ForkedRunExc(error);
+
+        BaseStat::mergeRuns(results);
+        numRuns = actRuns = nRuns;
+        end = true;
+#endif
+    }
+
     // Main function:
     // This is the simulation engine
     void Simulation::run(Tick endTick, int nRuns) 
     {
+        SimContext::Scope scope(_ctx);
         DBGENTER(_SIMUL_DBG_LEV);
 	bool initializeRuns = true;
 	bool terminateSim = true;
@@ -193,37 +720,85 @@ namespace MetaSim {
         while (actRuns < numRuns) {
             cout << "\n Run #" << actRuns << endl;
 
+            if (replicaStreams || antitheticPairs) 
+                setReplicaStream(RandomVar::getGenerator(), actRuns, 
+                                 antitheticPairs);
+
             initSingleRun();
+            if (_ctx->metrics) 
+                _ctx->metrics->beginRun(actRuns, numRuns, endTick);
+            if (_ctx->snapshots) 
+                _ctx->snapshots->beginRun(actRuns, endTick);
 
             // MAIN CYCLE!!
-            try {
-                while (globTime < endTick) {
-                    globTime = sim_step();
-                }
-            } catch (NoMoreEventsInQueue &e) {
+            if (!runCycle(endTick))
                 cerr << "No more events in queue: simulation time =" 
                      << globTime << endl;
-            }
 
             endSingleRun();
                                 
             actRuns++;   // next run....
         }
+        if (antitheticPairs) RandomVar::getGenerator()->setAntithetic(false);
         end = true;
+        if (_ctx->metrics) _ctx->metrics->finish();
         if (terminateSim) endSim();      // the simulation is over!!
     }
 
 
     void Simulation::clearEventQueue()
     {
-        Event *temp;
-        while ((temp = Event::getFirst()) != NULL) {
-            temp->drop();
-            if (temp->isDisposable()) // if it has to be deleted...
-                delete temp;                 
-        }
+        Event::clearQueue(_ctx);
         globTime = 0;
     }
+
+    void Simulation::setProfiler(EventProfiler *p)
+    {
+        _ctx->profiler = p;
+    }
+
+    void Simulation::setMetrics(SimMetrics *m)
+    {
+        _ctx->metrics = m;
+    }
+
+    void Simulation::setSnapshots(StatSnapshots *s)
+    {
+        _ctx->snapshots = s;
+        if (s) snapNext = s->getPeriod();
+    }
+
+    void Simulation::setPacer(WallClockPacer *p)
+    {
+        _ctx->pacer = p;
+    }
+
+    void Simulation::pace(Tick t)
+    {
+        _ctx->pacer->waitFor(t);
+    }
+
+    void Simulation::setInbox(EventInbox *in)
+    {
+        _ctx->inbox = in;
+    }
+
+    void Simulation::drainInbox()
+    {
+        // an empty inbox costs a load
+        if (!_ctx->inbox->empty()) _ctx->inbox->drain();
+    }
+
+    void Simulation::takeSnapshots(Tick t)
+    {
+        Tick p = _ctx->snapshots->getPeriod();
+        for (; snapNext <= t; snapNext += p) _ctx->snapshots->take(snapNext);
+    }
+
+    void Simulation::setEventQueue(EventQueue::Type t)
+    {
+        Event::setQueueType(t);
+    }
                 
     // only for debug
     void Simulation::print()
@@ -237,12 +812,12 @@ namespace MetaSim {
     // wrappers for debug entry/exit
     void Simulation::dbgEnter(string lev, string header)
     {
+        dbg.enter(lev);
+        // the header is formatted only if it is printed
+        if (!dbg.filter()) return;
         stringstream ss;    
-        
         ss << "t = [" << globTime << "] --> " + header;
-//string h = "t = [" + string(globTime) + "] --> " + header; 
-        //dbg.enter(lev, h);
-        dbg.enter(lev, ss.str());
+        dbg.header(ss.str());
     }
                 
     void Simulation::dbgExit()
@@ -253,7 +828,12 @@ namespace MetaSim {
     void Simulation::endSim() 
     {
         // Collect statistics
+        if (_ctx->profiler) _ctx->profiler->beginPhase("stats");
         BaseStat::endSim();
+        if (_ctx->profiler) {
+            _ctx->profiler->endPhase();
+            _ctx->profiler->endSim();
+        }
     }
 }
 
@@ -14,20 +14,42 @@
 #ifndef __SIMUL_HPP__
 #define __SIMUL_HPP__
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include <basestat.hpp>
+#include <checkpoint.hpp>
 #include <debugstream.hpp>
 #include <entity.hpp>
 #include <event.hpp>
+#include <eventqueue.hpp>
+#include <profiler.hpp>
+#include <simcontext.hpp>
+#include <simmetrics.hpp>
 
 namespace MetaSim {
 
+    class RandomGen;
+    class StatSnapshots;
+
 #define _SIMUL_DBG_LEV "Simul"
+
+    /// Raised by Simulation::runForked() when a replica fails
+    DECL_EXC(ForkedRunExc, "Simulation");
+
+    /// Raised by Simulation::setFastForward() with a negative period
+    DECL_EXC(FastForwardExc, "Simulation");
   
     /** 
         \ingroup metasim_ee
   
-        This singleton implements the simulation engine and some
-        debugging facilities. The main function is <i>run(Tick
+        This class implements the simulation engine and some
+        debugging facilities. There is one engine for each
+        simulation context (see SimContext): getInstance() (and
+        the SIMUL macro) returns the engine of the current
+        context. The main function is <i>run(Tick
         lenght, size_t runs)</i> that is responsible for running
         the simulation for one or more times.
    
@@ -38,12 +60,23 @@ namespace MetaSim {
     */
     //@{
     class Simulation {
-        Simulation();
+        Simulation(SimContext *c);
         Simulation(const Simulation &);
 
-        static Simulation *instance_;
+        friend class SimContext;
+        friend class Campaign;
+        template <class, class, class> friend class BasicEngine;
+
+        /// the context this engine belongs to
+        SimContext *_ctx;
     public:
-        static Simulation &getInstance();
+        /// Returns the engine of the current context
+        static inline Simulation &getInstance() {
+            return SimContext::current()->simulation();
+        }
+
+        /// Returns the context of this engine
+        SimContext *getContext() const { return _ctx; }
                
         /**
            Enters the <i>lev</i> debug level.
@@ -105,6 +138,114 @@ namespace MetaSim {
         */
         void run(Tick length, int runs = 1);
 
+        /**
+           Builds a copy of the model in the current context, and
+           returns an object that owns it (the model is destroyed
+           when the last reference to this object is released).
+        */
+        typedef std::function<std::shared_ptr<void> ()> ModelBuilder;
+
+        /**
+           Runs independent replicas of the simulation in
+           parallel, on a pool of threads.
+
+           Each replica is executed in a new context (see
+           SimContext), where the model is created by calling
+           build(), and gets its own random generator: a copy of
+           the current standard generator, positioned at the
+           stream of the replica (see RandomGen::setStream()).
+           Hence, the results do not depend on the number of
+           threads, and they are the same of a sequential run
+           with setReplicaStreams(true).
+
+           At the end, the values collected by the replicas are
+           merged in the stat objects of this context, which must
+           be the same stat objects (in the same order) created
+           by build(): usually, the model is created once here,
+           with the same builder, for reading the results.
+
+           @code
+           std::shared_ptr<void> model = buildModel();
+           SIMUL.run(10000, 30, 0, buildModel);
+           cout << stat.getMean() << endl;
+           @endcode
+
+           The first exception raised by a replica is re-thrown
+           after all threads have terminated.
+
+           @param length Length of each simulation run.
+           @param runs Number of replicas.
+           @param threads Number of threads (0 means one for each
+           processor that the process may use, see Topology).
+           @param build The model builder.
+        */
+        void run(Tick length, int runs, int threads, 
+                 const ModelBuilder &build);
+
+        /**
+           Runs replicas in parallel, as run(length, runs,
+           threads, build), until the half-width of the
+           confidence interval of the mean of every stat object in
+           stats (see BaseStat::getConfInterval()) is at most
+           precision times the absolute value of the mean.
+
+           The replicas are executed in rounds. The first round
+           has minRuns replicas (at least 3); the following ones
+           have as many replicas as the current estimate of the
+           variance requires, at most doubling the number of
+           replicas. The rounds depend only on the collected
+           values, so the number of replicas and the results do
+           not depend on the number of threads. The stat objects
+           must belong to this context; at the end they contain
+           the values of all the replicas.
+
+           @param length Length of each simulation run.
+           @param stats The stat objects to be estimated.
+           @param precision Target half-width, relative to the mean
+           (for example, 0.01 for 1%).
+           @param threads Number of threads (0 means one for each
+           hardware thread).
+           @param build The model builder.
+           @param minRuns Number of replicas of the first round.
+           @param maxRuns Maximum number of replicas (0 means no
+           limit): when it is reached the method returns even if
+           the precision has not been reached.
+           @param c Confidence level of the intervals.
+           @return the number of executed replicas.
+        */
+        int runToPrecision(Tick length, const std::vector<BaseStat *> &stats,
+                           double precision, int threads, 
+                           const ModelBuilder &build, int minRuns = 10, 
+                           int maxRuns = 0, 
+                           BaseStat::CONFIDENCE_INTERVAL c = BaseStat::C95);
+
+        /**
+           Runs the warm-up once, then the replicas in child
+           processes (POSIX only).
+
+           The model is simulated up to the transitory (see
+           BaseStat::setTransitory()). Then one child process is
+           forked for each replica: the child moves the standard
+           generator to the stream of the replica (see
+           RandomGen::setStream()), simulates up to length, and
+           sends the values collected by the stats back to the
+           parent through a pipe. The model is shared by the
+           children copy-on-write, so neither the construction
+           nor the warm-up are repeated. At the end the values
+           are merged in the stat objects of this context, as in
+           the parallel run().
+
+           Output buffered in cout and cerr is flushed before
+           forking. Throws ForkedRunExc if a replica cannot be
+           started or does not terminate correctly.
+
+           @param length Length of each simulation run.
+           @param runs Number of replicas.
+           @param procs Maximum number of children running at the
+           same time (0 means one for each hardware thread).
+        */
+        void runForked(Tick length, int runs, int procs = 0);
+
         /**
            Returns the current simulation time.
         */
@@ -115,6 +256,63 @@ namespace MetaSim {
            called after an exception!
         */
         void clearEventQueue();
+
+        /**
+           Selects the implementation of the event queue. By
+           default, the queue is a red-black tree
+           (EventQueue::SET_QUEUE). For very large models, the
+           indexed heap (EventQueue::HEAP_QUEUE) avoids one
+           allocation per post, and the calendar queue
+           (EventQueue::CALENDAR_QUEUE) performs best when most
+           events are posted in the near future; the timing wheel
+           (EventQueue::WHEEL_QUEUE) is meant for periodic models
+           whose periods fit in its horizon, and the radix heap
+           (EventQueue::RADIX_QUEUE) for events spread over a wide
+           range of future times; EventQueue::ADAPTIVE_QUEUE
+           chooses one of them from the first events of the run
+           (see AdaptiveEventQueue). The order in
+           which events are processed is the same for all
+           backends. It can be called at any time: the events
+           already in the queue are moved to the new backend.
+        */
+        void setEventQueue(EventQueue::Type t);
+
+        /**
+           Profiles the event loop of this simulation with p (NULL
+           stops profiling), see EventProfiler. The profiler is not
+           owned by the simulation.
+        */
+        void setProfiler(EventProfiler *p);
+
+        /**
+           Publishes the progress of run() and run_to() on m (NULL
+           stops publishing), see SimMetrics. The object is not
+           owned by the simulation.
+        */
+        void setMetrics(SimMetrics *m);
+
+        /**
+           Takes the snapshots of s (NULL stops them) in the event
+           loop of run() and run_to(), every s->getPeriod() ticks,
+           see StatSnapshots. The object is not owned by the
+           simulation.
+        */
+        void setSnapshots(StatSnapshots *s);
+
+        /**
+           Paces the event loop of run() and run_to() on the wall
+           clock with p (NULL stops pacing), see WallClockPacer.
+           The object is not owned by the simulation.
+        */
+        void setPacer(WallClockPacer *p);
+
+        /**
+           Drains in before each step of run() and run_to(), and
+           of sim_step() and sim_batch_step() (NULL stops
+           draining), see EventInbox. The object is not owned by
+           the simulation.
+        */
+        void setInbox(EventInbox *in);
                 
         void print();
 
@@ -130,6 +328,155 @@ namespace MetaSim {
         */
         const Tick sim_step();
 
+        /**
+           Performs a batch of simulation steps: it processes all
+           the events having the same time and priority of the
+           first event in the queue, in the same order as
+           sim_step() would do. The current time is set only
+           once, and the queue head is checked directly, without
+           passing through getNextEventTime(). It returns the
+           time of the processed events.
+
+           @see setBatchStepping
+        */
+        const Tick sim_batch_step();
+
+        /**
+           Enables (or disables) batch stepping in run() and
+           run_to(). Useful when many events share the same time,
+           for example with synchronous periodic releases at the
+           beginning of each hyperperiod. The order of the events
+           is not changed. By default it is disabled.
+        */
+        void setBatchStepping(bool b) { batchStepping = b; }
+
+        bool isBatchStepping() const { return batchStepping; }
+
+        /**
+           If enabled, at the beginning of run k the standard
+           random generator is positioned at the beginning of
+           stream k (see RandomGen::setStream()), so that each
+           replica uses a reproducible sequence of numbers that
+           does not overlap with the others, exactly as in the
+           parallel version of run(). By default it is disabled,
+           and the generator is left as it is between runs.
+        */
+        void setReplicaStreams(bool b) { replicaStreams = b; }
+
+        bool isReplicaStreams() const { return replicaStreams; }
+
+        /**
+           If enabled, the replications are executed in antithetic
+           pairs: runs 2k and 2k+1 use the same stream k of the
+           standard generator (see setReplicaStreams()), and the
+           generator is antithetic in run 2k+1 (see
+           RandomGen::setAntithetic()). The two runs of a pair
+           are negatively correlated, so the confidence intervals
+           of the stats (see BaseStat::getConfInterval()) are
+           computed on the means of the pairs, which are
+           independent. It applies to the sequential, parallel
+           and forked runs; the number of runs should be even.
+        */
+        void setAntitheticPairs(bool b) { antitheticPairs = b; }
+
+        bool isAntitheticPairs() const { return antitheticPairs; }
+
+        /**
+           If enabled, the threads of the parallel runs (run() with
+           a builder, runToPrecision()) are pinned to the
+           processors, spread over the NUMA nodes (see Topology):
+           each replica builds its context, its model and its
+           generator on the node of its thread. The calling
+           thread, which is one of the workers, gets its affinity
+           back at the end. By default it is disabled.
+        */
+        void setPinning(bool b) { pinning = b; }
+
+        bool isPinning() const { return pinning; }
+
+        /**
+           Enables the fast-forward of run() for models whose
+           behaviour is periodic once the initial transient is
+           over, like a set of periodic tasks with constant
+           computation times, whose schedule repeats every
+           hyperperiod.
+
+           At the instants from, from + period, from + 2*period,
+           ... (up to the end of the run) the engine takes an
+           image of the state of the simulation (see StateImage)
+           before processing the events of that instant. The
+           first time the image is equal to the one taken one
+           period before (and the transitory is over), the
+           following periods are known to repeat it exactly: the
+           values recorded by the stats in the last period are
+           accounted once more for each period up to the end of
+           the run (see BaseStat::repeat()), and only the
+           remaining fraction of a period is simulated. At the
+           end, the clock is moved forward by the skipped time.
+
+           The fast-forward is never applied if an entity cannot
+           describe its state (see Entity::getSignature()) or if
+           a stat cannot extrapolate its values: then the run is
+           simulated to the end, as usual. The traces do not
+           receive the events of the skipped periods, and the
+           state of the entities at the end of the run is the
+           one they had before the clock was moved: only the
+           stats account for the skipped periods.
+
+           A period of 0 (the default) disables the fast-forward.
+           Throws FastForwardExc if period or from are negative.
+        */
+        void setFastForward(Tick period, Tick from = 0);
+
+        Tick getFastForwardPeriod() const { return ffPeriod; }
+
+        /**
+           Returns the time skipped by the fast-forward in the last
+           run (0 if the state did not repeat).
+        */
+        Tick getSkippedTime() const { return ffSkipped; }
+
+        /// A condition that ends a run early (see addStopPredicate())
+        typedef std::function<bool()> StopPredicate;
+
+        /**
+           Ends the current run after the event being processed:
+           run(), run_to() and the fast-forward return as if the
+           end of the run had been reached, and the run is
+           terminated as usual (see endSingleRun()), so the stats
+           are finalized with the values collected so far. The
+           clock stays at the time of the last event. It can be
+           called by the action of an event, by a probe, or by a
+           stop predicate.
+        */
+        void stop() { stopped = true; }
+
+        /// True if the current (or the last) run was stopped early
+        bool isStopped() const { return stopped; }
+
+        /**
+           Adds a predicate evaluated after each event of run()
+           and run_to() (after each batch with batch stepping, see
+           setBatchStepping()): the run is stopped (see stop()) as
+           soon as one of them returns true. The predicates are
+           kept until clearStopPredicates(), and they belong to
+           this simulation only: the replicas of a parallel run
+           do not evaluate them. Without predicates the main loop
+           pays a single test per event.
+        */
+        void addStopPredicate(const StopPredicate &p) 
+            { stopPredicates.push_back(p); }
+
+        void clearStopPredicates() { stopPredicates.clear(); }
+
+        /**
+           Stops the run every time e is processed (see stop()),
+           attaching a particle to it: for example, the
+           deadline event of a task, to end the run at the first
+           deadline miss. The particle cannot be removed.
+        */
+        void stopOn(Event &e);
+
                 
         /**
            Function to help testing and debugging.
@@ -170,8 +517,19 @@ namespace MetaSim {
 
         /**
            Function to help testing and debugging.
+
+           Terminates a run, and prints the memory report (see
+           MemStats::setReport()).
         */
         void endSingleRun();
+
+        /**
+           Terminates the runs started by initRuns(), and collects
+           the statistics: to be called after the last
+           endSingleRun(). Normally, it is called from
+           Simulation::run().
+        */
+        void endSim();
                 
         /**
            Function to help testing and debugging.
@@ -183,6 +541,23 @@ namespace MetaSim {
         */
         const Tick run_to(const Tick &stop);
 
+        /**
+           Stores in c an image of the current state of the
+           simulation (see Checkpoint). Throws Checkpoint::Exc
+           if a disposable event is in the queue.
+        */
+        void checkpoint(Checkpoint &c);
+
+        /**
+           Brings the simulation back to the state stored in c
+           by checkpoint(): the events posted after the
+           checkpoint are removed from the queue, and the clock,
+           the entities, the stats and the random generator go
+           back to their state at checkpoint time. A run stopped
+           by stop() can be continued after a restore.
+        */
+        void restore(Checkpoint &c);
+
         DebugStream dbg;
                
     private:
@@ -192,14 +567,111 @@ namespace MetaSim {
         */
         void setTime(Tick);
 
-        void endSim();
-
         const Tick getNextEventTime();
+
+        /**
+           Status-returning versions of sim_step() and
+           sim_batch_step(), used by the main loop: they return
+           false (without throwing) when the queue is empty,
+           otherwise they store in t the time of the processed
+           event(s).
+        */
+        bool step(Tick &t);
+        bool batchStep(Tick &t);
+
+        /// the main cycle of a run: returns false if the event
+        /// queue became empty before endTick
+        bool runCycle(Tick endTick);
+
+        /**
+           Simulates up to the instants of the fast-forward (see
+           setFastForward()) until the state repeats, and sets
+           ffSkipped. Returns false if the event queue became
+           empty.
+        */
+        bool fastForward(Tick endTick, uint64_t &n);
+
+        /// counts the events processed since the last publication
+        /// on the metrics of the context
+        void count(uint64_t &n);
+
+        /// takes the snapshots of the instants up to t
+        void takeSnapshots(Tick t);
+
+        /// called before processing the events at time t
+        void snapshotsTo(Tick t) {
+            if (_ctx->snapshots && t >= snapNext) takeSnapshots(t);
+        }
+
+        /// waits for the wall-clock instant of time t, if paced
+        void paceTo(Tick t) {
+            if (_ctx->pacer) pace(t);
+        }
+
+        void pace(Tick t);
+
+        /// the first event, after draining the inbox
+        inline Event *nextEvent();
+
+        void drainInbox();
+
+        /// evaluates the stop predicates after an event (or a batch)
+        void checkStop() {
+            for (size_t i = 0; !stopped && i < stopPredicates.size(); ++i)
+                if (stopPredicates[i]()) stopped = true;
+        }
+
+        /// body of a child process of runForked(): runs replica
+        /// rep and writes the stats values on fd
+        void forkedReplica(Tick endTick, int rep, int fd);
+
+        /// a replica of a parallel run that has completed, and
+        /// whose stats have not been merged yet
+        struct Replica;
+
+        /**
+           executes one replica of a parallel run in a new
+           context, stores the collected values in res, then
+           pushes the replica (its context and its model) on the
+           lock-free list done.
+        */
+        static void runReplica(Tick endTick, const ModelBuilder &build,
+                               const RandomGen &base, unsigned long rep,
+                               bool pairs, std::vector<double> &res,
+                               std::atomic<Replica *> &done);
+
+        /// positions g at the stream of replica rep (see
+        /// setReplicaStreams() and setAntitheticPairs())
+        static void setReplicaStream(RandomGen *g, unsigned long rep, 
+                                     bool pairs);
+
+        /**
+           executes replicas [first, last) (see runReplica()) on a
+           pool of threads, storing the values in results[k]. The
+           stats of the replicas are merged (see BaseStat::merge())
+           in the stats of this context in order of replica, by
+           the calling thread, between its replicas and at the
+           end, so the workers never wait for each other.
+        */
+        void runReplicas(Tick endTick, const ModelBuilder &build,
+                         int first, int last, int nThreads,
+                         std::vector<std::vector<double> > &results);
                 
         size_t numRuns;
         size_t actRuns;
         Tick globTime;
         bool end;
+        bool batchStepping;
+        bool replicaStreams;
+        bool antitheticPairs;
+        bool pinning;
+        Tick ffPeriod;
+        Tick ffFrom;
+        Tick ffSkipped;
+        bool stopped;
+        std::vector<StopPredicate> stopPredicates;
+        /// the instant of the next snapshot
+        Tick snapNext;
     };
 
     class DbgObj {
@@ -236,12 +708,14 @@ extern "C" {
                       SIMUL.dbg.exit();               \
                       SIMUL.dbg.disable("__FORCE__"); } while(0)
 
-#define DBGPRINT(x)   SIMUL.dbg << x << endl
-#define DBGPRINT_2(x,y) SIMUL.dbg << x << y << endl
-#define DBGPRINT_3(x,y,z) SIMUL.dbg << x << y << z << endl
-#define DBGPRINT_4(x,y,z,w) SIMUL.dbg << x << y << z << w << endl
-#define DBGPRINT_5(x,y,z,w,r) SIMUL.dbg << x << y << z << w << r << endl
-#define DBGPRINT_6(x,y,z,w,r,s) SIMUL.dbg << x << y << z << w << r << s << endl
+// the arguments are formatted only if the output is enabled
+#define DBGPRINT(x)   do { if (SIMUL.dbg.filter())             \
+                               SIMUL.dbg << x << endl; } while(0)
+#define DBGPRINT_2(x,y) DBGPRINT(x << y)
+#define DBGPRINT_3(x,y,z) DBGPRINT(x << y << z)
+#define DBGPRINT_4(x,y,z,w) DBGPRINT(x << y << z << w)
+#define DBGPRINT_5(x,y,z,w,r) DBGPRINT(x << y << z << w << r)
+#define DBGPRINT_6(x,y,z,w,r,s) DBGPRINT(x << y << z << w << r << s)
 
 #define DBGVAR(x) DBGPRINT_2("  --> " #x " = ", x)
 
@@ -0,0 +1,89 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SMALLVEC_HPP__
+#define __SMALLVEC_HPP__
+
+#include <algorithm>
+#include <cstddef>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       A vector of trivially copyable elements (typically
+       pointers) that stores up to N elements inside the object:
+       no memory is allocated until the vector grows beyond N
+       elements. Used for the lists of probes of the events,
+       which are almost always empty or very short.
+    */
+    template <class T, size_t N = 2>
+    class small_vector {
+        T _inline[N];
+        T *_data;
+        size_t _size;
+        size_t _cap;
+
+        void grow(size_t cap) {
+            T *d = new T[cap];
+            std::copy(_data, _data + _size, d);
+            if (_data != _inline) delete [] _data;
+            _data = d;
+            _cap = cap;
+        }
+
+    public:
+        typedef T *iterator;
+        typedef const T *const_iterator;
+
+        small_vector() : _data(_inline), _size(0), _cap(N) {}
+
+        small_vector(const small_vector &v) :
+            _data(_inline), _size(0), _cap(N) {
+            *this = v;
+        }
+
+        ~small_vector() { if (_data != _inline) delete [] _data; }
+
+        small_vector &operator=(const small_vector &v) {
+            if (this == &v) return *this;
+            _size = 0;
+            if (v._size > _cap) grow(v._size);
+            std::copy(v._data, v._data + v._size, _data);
+            _size = v._size;
+            return *this;
+        }
+
+        void push_back(const T &x) {
+            if (_size == _cap) grow(2 * _cap);
+            _data[_size++] = x;
+        }
+
+        void clear() { _size = 0; }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        T &operator[](size_t i) { return _data[i]; }
+        const T &operator[](size_t i) const { return _data[i]; }
+
+        iterator begin() { return _data; }
+        iterator end() { return _data + _size; }
+        const_iterator begin() const { return _data; }
+        const_iterator end() const { return _data + _size; }
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,68 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <ostream>
+
+#include <basestat.hpp>
+#include <snapshots.hpp>
+
+namespace MetaSim {
+
+    StatSnapshots::StatSnapshots(Tick period) :
+        _period(period < 1 ? Tick(1) : period), _stats(), _runs(), 
+        _times(), _values(), _run(0)
+    {
+    }
+
+    void StatSnapshots::addStat(BaseStat *s)
+    {
+        _stats.push_back(s);
+    }
+
+    void StatSnapshots::beginRun(int run, Tick end)
+    {
+        _run = run;
+        size_t n = size() + (long int)end / (long int)_period;
+        _runs.reserve(n);
+        _times.reserve(n);
+        _values.reserve(n * _stats.size());
+    }
+
+    void StatSnapshots::take(Tick t)
+    {
+        _runs.push_back(_run);
+        _times.push_back(t);
+        for (size_t k = 0; k < _stats.size(); ++k) {
+            _stats[k]->refresh();
+            _values.push_back(_stats[k]->getValue());
+        }
+    }
+
+    void StatSnapshots::write(std::ostream &os) const
+    {
+        for (size_t i = 0; i < size(); ++i) {
+            os << _runs[i] << '\t' << _times[i];
+            for (size_t k = 0; k < _stats.size(); ++k)
+                os << '\t' << getValue(i, k);
+            os << '\n';
+        }
+    }
+
+    void StatSnapshots::clear()
+    {
+        _runs.clear();
+        _times.clear();
+        _values.clear();
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,107 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SNAPSHOTS_HPP__
+#define __SNAPSHOTS_HPP__
+
+#include <iosfwd>
+#include <vector>
+
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class BaseStat;
+
+    /**
+       \ingroup metasim_stat
+
+       The time series of the current values (see
+       BaseStat::getValue(), after BaseStat::refresh()) of some
+       stats, taken by the event loop of run() and run_to() every
+       period ticks (see Simulation::setSnapshots()), without
+       posting any event.
+
+       The snapshot of instant t = k * period (k > 0) is taken
+       before processing the first event at time t or later, so
+       it contains the values after all the events before t; the
+       instants up to the end of the run are all taken, even if
+       no event happens between them. The rows of a run are
+       allocated at its beginning.
+
+       <pre>
+       StatSnapshots snap(1000);
+       snap.addStat(&missRatio);
+       SIMUL.setSnapshots(&snap);
+       SIMUL.run(100000, 10);
+       snap.write(cout);
+       </pre>
+
+       An object follows one context: the replicas of a parallel
+       run do not take snapshots. With the fast-forward (see
+       Simulation::setFastForward()), no snapshot is taken in the
+       skipped time.
+    */
+    class StatSnapshots {
+        Tick _period;
+        std::vector<BaseStat *> _stats;
+        std::vector<int> _runs;
+        std::vector<Tick> _times;
+        /// one row of _stats.size() values for each snapshot
+        std::vector<double> _values;
+        int _run;
+
+    public:
+        /// Snapshots every period ticks (at least 1)
+        explicit StatSnapshots(Tick period);
+
+        Tick getPeriod() const { return _period; }
+
+        /// Adds s to the stats in the snapshots (before the run)
+        void addStat(BaseStat *s);
+
+        /// @name Called by the simulation
+        //@{
+        /// starts run number run, up to end
+        void beginRun(int run, Tick end);
+
+        /// takes the snapshot of instant t
+        void take(Tick t);
+        //@}
+
+        /// Number of snapshots taken
+        size_t size() const { return _times.size(); }
+
+        /// Run of snapshot i
+        int getRun(size_t i) const { return _runs[i]; }
+
+        /// Instant of snapshot i
+        Tick getTime(size_t i) const { return _times[i]; }
+
+        /// Value of stat k in snapshot i
+        double getValue(size_t i, size_t k) const 
+            { return _values[i * _stats.size() + k]; }
+
+        /**
+           Writes the snapshots, one per line, as the run, the
+           instant and the values, separated by tabs.
+        */
+        void write(std::ostream &os) const;
+
+        /// Removes the snapshots
+        void clear();
+    };
+
+} // namespace MetaSim
+
+#endif
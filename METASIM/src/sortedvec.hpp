@@ -0,0 +1,106 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SORTEDVEC_HPP__
+#define __SORTEDVEC_HPP__
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+   \ingroup metasim_util
+
+   A priority list (same interface as priority_list) stored as a
+   sorted vector, so that the n-th element is reached in constant
+   time. Insertions and removals move the elements that follow,
+   which for the short queues of a scheduler is cheaper than the
+   allocation of a tree node.
+
+   Elements that compare equal to an element already in the list
+   are not inserted, as in a std::set. Removal looks for the element
+   by its position and then, if it is not there (because its key
+   has been changed while it was in the list), by its value.
+*/
+template <class T, class Compare = std::less<T> >
+class sorted_vector {
+    typedef std::vector<T> Impl;
+
+    Impl _v;
+    Compare _cmp;
+
+public:
+    typedef typename Impl::iterator iterator;
+    typedef typename Impl::const_iterator const_iterator;
+    typedef typename Impl::reference reference;
+    typedef typename Impl::const_reference const_reference;
+    typedef typename Impl::size_type size_type;
+
+    iterator begin() { return _v.begin(); }
+    iterator end() { return _v.end(); }
+    const_iterator begin() const { return _v.begin(); }
+    const_iterator end() const { return _v.end(); }
+
+    std::pair<iterator, bool> insert(const_reference x)
+    {
+        iterator i = std::lower_bound(_v.begin(), _v.end(), x, _cmp);
+        if (i != _v.end() && !_cmp(x, *i)) return std::make_pair(i, false);
+        return std::make_pair(_v.insert(i, x), true);
+    }
+
+    /// the position of x, or end()
+    iterator locate(const_reference x)
+    {
+        iterator i = std::lower_bound(_v.begin(), _v.end(), x, _cmp);
+        if (i == _v.end() || !(*i == x)) i = std::find(_v.begin(), _v.end(), x);
+        return i;
+    }
+
+    void erase(const_reference x)
+    {
+        iterator i = locate(x);
+        if (i != _v.end()) _v.erase(i);
+    }
+
+    /**
+       Moves the element in position i, whose key has changed, to
+       its new position. Only the elements between the old and
+       the new position are moved.
+    */
+    void fix(iterator i)
+    {
+        if (i != _v.begin() && _cmp(*i, *(i - 1))) {
+            iterator p = std::upper_bound(_v.begin(), i, *i, _cmp);
+            std::rotate(p, i, i + 1);
+        }
+        else if (i + 1 != _v.end() && _cmp(*(i + 1), *i)) {
+            iterator p = std::lower_bound(i + 1, _v.end(), *i, _cmp);
+            std::rotate(i, i + 1, p);
+        }
+    }
+
+    /// the (n+1)-th element (0 == first)
+    reference operator[](size_type n) { return _v[n]; }
+    const_reference operator[](size_type n) const { return _v[n]; }
+
+    const_reference front() const { return _v.front(); }
+    reference back() { return _v.back(); }
+    const_reference back() const { return _v.back(); }
+    bool empty() const { return _v.empty(); }
+    void clear() { _v.clear(); }
+    size_type size() const { return _v.size(); }
+    void reserve(size_type n) { _v.reserve(n); }
+};
+
+#endif // __SORTEDVEC_HPP__
@@ -0,0 +1,91 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <memory>
+
+#include <basestat.hpp>
+#include <checkpoint.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+#include <splitting.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    Splitting::Splitting(const Importance &importance, 
+                         const vector<double> &levels, int effort) :
+        _importance(importance), _levels(levels), _effort(effort),
+        _level(0), _hits(levels.size(), 0), _sub(0), _trials(0), _stat(0)
+    {
+        if (levels.empty() || effort <= 0) 
+            throw Exc("No levels, or no trials per level");
+        for (size_t k = 1; k < levels.size(); ++k)
+            if (levels[k] <= levels[k - 1]) 
+                throw Exc("The levels must be increasing");
+    }
+
+    double Splitting::run(Tick horizon)
+    {
+        Simulation &sim = SIMUL;
+        RandomGen *gen = RandomVar::getGenerator();
+        unsigned long stream = gen->getStream();
+
+        sim.clearStopPredicates();
+        sim.addStopPredicate([this]() { return _importance() >= _level; });
+
+        sim.initSingleRun();
+        vector<unique_ptr<Checkpoint> > from, to;
+        from.push_back(unique_ptr<Checkpoint>(new Checkpoint()));
+        try {
+            sim.checkpoint(*from.back());
+        } catch (Checkpoint::Exc &e) {
+            // refused before simulating anything
+            sim.endSingleRun();
+            sim.clearStopPredicates();
+            throw Exc(string("The model does not support checkpoints: ")
+                      + e.what());
+        }
+
+        double p = 1;
+        _hits.assign(_levels.size(), 0);
+        for (size_t k = 0; k < _levels.size() && p > 0; ++k) {
+            _level = _levels[k];
+            bool last = k + 1 == _levels.size();
+            to.clear();
+            for (int i = 0; i < _effort; ++i) {
+                sim.restore(*from[i % from.size()]);
+                gen->setStream(stream, ++_sub);
+                ++_trials;
+                // a state may have crossed more than one level
+                if (_importance() < _level) sim.run_to(horizon);
+                else sim.stop();
+                if (!sim.isStopped()) continue;
+
+                ++_hits[k];
+                if (!last) {
+                    to.push_back(unique_ptr<Checkpoint>(new Checkpoint()));
+                    sim.checkpoint(*to.back());
+                }
+            }
+            p *= double(_hits[k]) / _effort;
+            from.swap(to);
+        }
+
+        sim.endSingleRun();
+        sim.clearStopPredicates();
+        if (_stat != 0) _stat->setLastValue(p);
+        return p;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,136 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SPLITTING_HPP__
+#define __SPLITTING_HPP__
+
+#include <functional>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class BaseStat;
+
+    /**
+       \ingroup metasim_ee
+
+       Estimates the probability of a rare event by multilevel
+       splitting with fixed effort. The event is described by an
+       importance function of the state of the model (for
+       example the backlog of a queue, or the lateness of a job)
+       and an increasing list of levels: the event happens when
+       the function reaches the last level before the horizon.
+
+       Every stage simulates effort trials. The trials of the
+       first stage start from the beginning of the run; each
+       trial stops as soon as the function reaches the level of
+       the stage (see Simulation::addStopPredicate()), and the
+       state is saved (see Simulation::checkpoint()). The trials
+       of the next stage start, in turn, from these states, each
+       one on its own substream of the random generator (see
+       RandomGen::setStream()). The estimate is the product of
+       the fractions of trials that reached each level: it is
+       unbiased, so the estimates of independent calls to run()
+       can be averaged, and their variance gives a confidence
+       interval.
+
+       <pre>
+       double l[] = { 5, 10, 15, 20 };
+       Splitting s([&q]() { return q.getBacklog(); },
+                   std::vector<double>(l, l + 4), 1000);
+       double p = 0;
+       for (int i = 0; i < 30; ++i) p += s.run(10000) / 30;
+       </pre>
+
+       Each call of run() is a run of the simulation. With
+       setStat(), a stat collects the estimate as the value of
+       the run, in place of what it has recorded during the
+       trials, so its mean and confidence interval over the runs
+       are those of the estimates:
+
+       <pre>
+       s.setStat(&stat);
+       SIMUL.initRuns(30);
+       for (int i = 0; i < 30; ++i) s.run(10000);
+       SIMUL.endSim();
+       // stat.getMean() +- stat.getConfInterval()
+       </pre>
+
+       The model must support checkpoints: its entities must
+       save their state (see Entity::saveState()), and no
+       disposable event can be in the queue at a level crossing.
+       Otherwise run() throws Exc at the start, before simulating
+       anything. The engine uses the stop predicates of the
+       simulation: the ones registered by the user are removed
+       by run(). The values recorded by the other stats during
+       the trials are not meaningful.
+
+       For the deadline misses of an RTLIB task set, see
+       RTSim::MissImportance.
+    */
+    class Splitting {
+    public:
+        typedef std::function<double()> Importance;
+
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &m) : BaseExc(m, "Splitting", "splitting.hpp") {}
+        };
+
+        /**
+           The event importance() >= levels.back(), estimated with
+           effort trials per level. Throws Exc if the levels are
+           not increasing, or if effort is not positive.
+        */
+        Splitting(const Importance &importance, 
+                  const std::vector<double> &levels, int effort);
+
+        /**
+           Runs the stages of a new run of the simulation, up to
+           horizon, and returns the estimated probability of the
+           event. Throws Exc if the model does not support
+           checkpoints.
+        */
+        double run(Tick horizon);
+
+        /// The estimate of each run() is collected by s (NULL for none)
+        void setStat(BaseStat *s) { _stat = s; }
+
+        /// Number of levels
+        int getLevels() const { return int(_levels.size()); }
+
+        /// Trials of the last run that reached level k
+        int getHits(int k) const { return _hits[k]; }
+
+        /// Trials simulated so far
+        unsigned long getTrials() const { return _trials; }
+
+    private:
+        Importance _importance;
+        std::vector<double> _levels;
+        int _effort;
+        /// the level of the current stage
+        double _level;
+        std::vector<int> _hits;
+        /// the last substream used by a trial
+        unsigned long _sub;
+        unsigned long _trials;
+        BaseStat *_stat;
+    };
+
+} // namespace MetaSim
+
+#endif
@@ -0,0 +1,72 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <typeinfo>
+
+#include <entity.hpp>
+#include <event.hpp>
+#include <simcontext.hpp>
+#include <stateimage.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    StateImage::StateImage() : _base(0), _words()
+    {
+    }
+
+    void StateImage::putReal(double x)
+    {
+        int64_t w;
+        memcpy(&w, &x, sizeof(w));
+        put(w);
+    }
+
+    void StateImage::putTime(Tick t)
+    {
+        if (t == MAXTICK) put(INT64_MAX);
+        else put(int64_t(t - _base));
+    }
+
+    bool StateImage::take(SimContext *ctx, Tick now)
+    {
+        _base = now;
+        _words.clear();
+
+        vector<Event *> v;
+        Event::getQueued(ctx, v);
+        sort(v.begin(), v.end(), Event::Cmp());
+        put(v.size());
+        for (size_t i = 0; i < v.size(); ++i) {
+            Event *e = v[i];
+            // a disposable event is a new object every time, only
+            // its class is significant
+            if (e->_disposable) put(int64_t(typeid(*e).hash_code()));
+            else putRef(e);
+            putTime(e->_time);
+            put(e->_priority);
+        }
+
+        const EntityRegistry::EntityVector &ents = ctx->entities.byID();
+        for (size_t i = 0; i < ents.size(); ++i) {
+            if (ents[i] == NULL) continue;
+            put(ents[i]->getID());
+            if (!ents[i]->getSignature(*this)) return false;
+        }
+        return true;
+    }
+
+} // namespace MetaSim
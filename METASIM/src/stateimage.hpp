@@ -0,0 +1,83 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __STATEIMAGE_HPP__
+#define __STATEIMAGE_HPP__
+
+#include <stdint.h>
+#include <vector>
+
+#include <basetype.hpp>
+
+namespace MetaSim {
+
+    class SimContext;
+
+    /**
+       \ingroup metasim_ee
+
+       A comparable image of the state of a simulation, used by
+       the fast-forward of Simulation::setFastForward() to find
+       the instants where the state repeats. Unlike a
+       Checkpoint, which stores the state to restore it, an image
+       only needs to be compared with the image taken one period
+       before: the times are written relative to the instant of
+       the image, so that two states that differ only by a
+       translation in time give the same image.
+
+       The image contains the events in the queue (in order of
+       extraction, with their time and priority) and the
+       signatures of all the entities (see
+       Entity::getSignature()).
+    */
+    class StateImage {
+        Tick _base;
+        std::vector<int64_t> _words;
+
+    public:
+        StateImage();
+
+        /**
+           Fills the image from context ctx at time now. Returns
+           false if an entity cannot describe its state: then the
+           image cannot be compared.
+        */
+        bool take(SimContext *ctx, Tick now);
+
+        /// The instant of the image
+        Tick getBase() const { return _base; }
+
+        /// Number of words of the image
+        size_t size() const { return _words.size(); }
+
+        /// Appends an integer (or an enumeration, or a boolean)
+        void put(int64_t x) { _words.push_back(x); }
+
+        /// Appends a real value, bit by bit
+        void putReal(double x);
+
+        /// Appends an instant, relative to the time of the image
+        void putTime(Tick t);
+
+        /// Appends the identity of an object
+        void putRef(const void *p) { put(int64_t(intptr_t(p))); }
+
+        bool operator==(const StateImage &o) const { 
+            return _words == o._words; 
+        }
+        bool operator!=(const StateImage &o) const { return !(*this == o); }
+    };
+
+} // namespace MetaSim
+
+#endif
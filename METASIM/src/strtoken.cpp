@@ -1,143 +1,228 @@
 #include <cstdlib>
+#include <cstring>
 #include <strtoken.hpp>
 
 namespace parse_util {
 
         using namespace std;
 
+        const size_t substring::npos;
+
+        size_t substring::find(char c, size_t pos) const
+        {
+                if (pos >= _n) return npos;
+                const void *q = memchr(_p + pos, c, _n - pos);
+                return q ? static_cast<const char *>(q) - _p : npos;
+        }
+
+        size_t substring::find(const substring &s, size_t pos) const
+        {
+                if (s._n == 0) return pos <= _n ? pos : npos;
+                while (s._n <= _n && pos <= _n - s._n) {
+                        pos = find(s._p[0], pos);
+                        if (pos == npos || pos > _n - s._n) return npos;
+                        if (memcmp(_p + pos, s._p, s._n) == 0) return pos;
+                        ++pos;
+                }
+                return npos;
+        }
+
+        size_t substring::find_first_of(const substring &chars, size_t pos) const
+        {
+                for (; pos < _n; ++pos)
+                        if (chars.find(_p[pos]) != npos) return pos;
+                return npos;
+        }
+
+        size_t substring::find_first_not_of(const substring &chars, size_t pos) const
+        {
+                for (; pos < _n; ++pos)
+                        if (chars.find(_p[pos]) == npos) return pos;
+                return npos;
+        }
+
+        size_t substring::find_last_of(const substring &chars) const
+        {
+                for (size_t pos = _n; pos > 0; --pos)
+                        if (chars.find(_p[pos - 1]) != npos) return pos - 1;
+                return npos;
+        }
+
         //removes the spaces at the beginning and at the end of the string
-        string remove_spaces(const string &tk)
+        substring trim(const substring &tk)
         {
-                string temp = tk;
-                string::size_type pos = 0;
+                size_t b = 0, e = tk.size();
 
-                if (tk == "") return temp;
-                // remove spaces at the beginning...
-                temp.erase(0, temp.find_first_not_of(' '));
-                pos = temp.find_last_not_of(' ');
-                temp.erase(pos+1, temp.size() - pos - 1);
-                return temp;
+                while (b < e && tk[b] == ' ') ++b;
+                while (e > b && tk[e - 1] == ' ') --e;
+                return tk.substr(b, e - b);
         }
 
-        vector<string> split(const string &code, const string &sep)
+        void split(const substring &code, const substring &sep,
+                   vector<substring> &out)
         {
-                vector<string> temp;
-                string::size_type pos = 0;
-                string::size_type old_pos = 0;
-                int count = 0;
+                size_t pos = 0;
+                size_t old_pos = 0;
 
-                while (pos != string::npos) {
+                out.clear();
+                while (pos != substring::npos) {
                         pos = code.find(sep, old_pos);
-                        if (pos != string::npos) { 
-                                temp.push_back(remove_spaces(code.substr(old_pos,pos-old_pos)));
+                        if (pos != substring::npos) { 
+                                out.push_back(trim(code.substr(old_pos, pos - old_pos)));
                                 old_pos = pos + sep.size();
-                                count ++;
                         }
                         else {
-                                temp.push_back(remove_spaces(code.substr(old_pos, code.size()
-                                                                         - old_pos)));
+                                out.push_back(trim(code.substr(old_pos)));
                         }
                 }
-
-                return temp;
         }
 
-        vector<string> split_instr(const string &code)
+        void split_instr(const substring &code, vector<substring> &out)
         {
-                vector<string> temp;
-                string::size_type pos = 0;
-                string::size_type old_pos = 0;
+                size_t pos = 0;
+                size_t old_pos = 0;
 
-                while (pos != string::npos) {
-                        pos = code.find(';', old_pos);
-                        if (pos != string::npos) { 
-                                temp.push_back(remove_spaces(code.substr(old_pos,pos-old_pos)));
-                                old_pos = ++pos;
-                        }
+                out.clear();
+                while ((pos = code.find(';', old_pos)) != substring::npos) {
+                        out.push_back(trim(code.substr(old_pos, pos - old_pos)));
+                        old_pos = pos + 1;
                 }
-
-                return temp;
         }
 
-        string get_token(const string &instr, const string &open_par)
+        substring token_of(const substring &instr, const substring &open_par)
         {
-                string temp;
-
-                string::size_type pos = instr.find(open_par);
-                string::size_type pos1 = instr.find_first_not_of(" \n");
-
-                temp = instr.substr(pos1, pos - pos1);
+                size_t pos = instr.find(open_par);
+                size_t pos1 = instr.find_first_not_of(" \n");
 
-                return temp;
+                if (pos1 == substring::npos) return substring();
+                return instr.substr(pos1, pos - pos1);
         }
 
-        string get_param(const string &instr, const string &open_par,
-                         const string &close_par)
+        substring param_of(const substring &instr, const substring &open_par,
+                           const substring &close_par)
         {
-                string temp("");
-                string::size_type pos = instr.find(open_par);
+                size_t pos = instr.find(open_par);
 
-                if (pos != string::npos) {
-                        string::size_type end = instr.find_last_of(close_par);
-                        temp = instr.substr(pos+1, end-pos-1);
-                }
-  
-                return temp;
+                if (pos == substring::npos) return substring();
+
+                size_t end = instr.find_last_of(close_par);
+                return instr.substr(pos + 1, end - pos - 1);
         }
 
-        vector<string> split_param(const string &p, const string &sep,
-                                   char open_par, char close_par)
+        void split_param(const substring &p, vector<substring> &out,
+                         const substring &sep, char open_par, char close_par)
         {
-                vector<string> temp;
-                string::size_type pos = 0;
-                string::size_type old_pos = 0;
+                size_t pos = 0;
+                size_t old_pos = 0;
 
-                string symbols = sep + open_par;
+                char symbols[16];
+                size_t ns = sep.size() < sizeof(symbols) - 1 ?
+                        sep.size() : sizeof(symbols) - 1;
+                memcpy(symbols, sep.data(), ns);
+                symbols[ns] = open_par;
+                substring symb(symbols, ns + 1);
 
+                out.clear();
                 while (pos <= p.size()) {
-                        pos = p.find_first_of(symbols, pos);
-
-                        if (pos != string::npos)
-                                if (p[pos] == open_par) {
-                                        pos = p.find(close_par, pos);
-                                        if (pos == p.size()) pos = string::npos;
-                                        else ++pos;
-                                }
-      
-                        if (pos != string::npos) {
-                                string t = remove_spaces(p.substr(old_pos, pos - old_pos));
-
-                                temp.push_back(t);
+                        pos = p.find_first_of(symb, pos);
 
+                        // a parameter with parenthesis goes up to the
+                        // closing one (or to the end)
+                        if (pos != substring::npos && p[pos] == open_par) {
+                                pos = p.find(close_par, pos);
+                                pos = pos == substring::npos ? p.size() : pos + 1;
+                        }
+      
+                        if (pos != substring::npos) {
+                                out.push_back(trim(p.substr(old_pos, pos - old_pos)));
                                 old_pos = ++pos;
                         }
                 }
 
                 if (pos != old_pos) {
-                        string t = remove_spaces(p.substr(old_pos, p.size() - old_pos));
+                        substring t = trim(p.substr(old_pos));
 
-                        if (t != "") temp.push_back(t);
+                        if (!t.empty()) out.push_back(t);
                 }
+        }
 
+        void assign(const vector<substring> &v, vector<string> &out)
+        {
+                out.resize(v.size());
+                for (size_t i = 0; i < v.size(); ++i) v[i].assign_to(out[i]);
+        }
+
+        void parse_double(const substring &nums, double &res, substring &unit)
+        {
+                substring tmp = trim(nums);
+                size_t pos = tmp.find_first_of("smnu");
+
+                if (pos != substring::npos) unit = tmp.substr(pos);
+                else unit = substring();
+    
+                // atof() needs the terminator
+                substring snum = tmp.substr(0, pos);
+                char buf[64];
+                if (snum.size() < sizeof(buf)) {
+                        memcpy(buf, snum.data(), snum.size());
+                        buf[snum.size()] = 0;
+                        res = atof(buf);
+                }
+                else res = atof(snum.str().c_str());
+        }
+
+        static vector<string> to_strings(const vector<substring> &v)
+        {
+                vector<string> temp;
+                assign(v, temp);
                 return temp;
         }
 
+        string remove_spaces(const string &tk)
+        {
+                return trim(tk).str();
+        }
 
-        void parse_double(const string &nums, double &res, string &unit)
+        vector<string> split(const string &code, const string &sep)
+        {
+                vector<substring> v;
+                split(substring(code), substring(sep), v);
+                return to_strings(v);
+        }
+
+        vector<string> split_instr(const string &code)
         {
-                string tmp = remove_spaces(nums);
-                string::size_type pos = 0;
-                string symb = "smnu";
+                vector<substring> v;
+                split_instr(substring(code), v);
+                return to_strings(v);
+        }
 
-                pos = tmp.find_first_of(symb, pos);
+        string get_token(const string &instr, const string &open_par)
+        {
+                return token_of(instr, open_par).str();
+        }
 
-                if (pos != string::npos) 
-                        unit = tmp.substr(pos, tmp.size() - pos);
-                else unit = "";  
-    
-                string snum = tmp.substr(0,pos);
-                res = atof(snum.c_str());
+        string get_param(const string &instr, const string &open_par,
+                         const string &close_par)
+        {
+                return param_of(instr, open_par, close_par).str();
         }
+
+        vector<string> split_param(const string &p, const string &sep,
+                                   char open_par, char close_par)
+        {
+                vector<substring> v;
+                split_param(substring(p), v, substring(sep), open_par, close_par);
+                return to_strings(v);
+        }
+
+        void parse_double(const string &nums, double &res, string &unit)
+        {
+                substring u;
+                parse_double(substring(nums), res, u);
+                u.assign_to(unit);
+        }
+
         ParseExc::ParseExc(const string &where, const string &par)
                 : _where(where), _par(par)
         {
@@ -14,6 +14,7 @@
 #ifndef __STRTOKEN_HPP__
 #define __STRTOKEN_HPP__
 
+#include <cstring>
 #include <exception>
 #include <string>
 #include <vector>
@@ -31,6 +32,99 @@ namespace parse_util {
 
     using namespace std;
 
+    /**
+       A piece of a string owned by somebody else: the tokenizing
+       functions that work on substrings do not copy anything, and
+       their results are valid as long as the tokenized string is
+       not modified or destroyed.
+
+       The functions that return strings and vectors of strings
+       are wrappers around them.
+    */
+    class substring {
+        const char *_p;
+        size_t _n;
+
+    public:
+        static const size_t npos = string::npos;
+
+        substring() : _p(""), _n(0) {}
+        substring(const char *p, size_t n) : _p(p), _n(n) {}
+        substring(const char *s) : _p(s), _n(strlen(s)) {}
+        substring(const string &s) : _p(s.data()), _n(s.size()) {}
+
+        const char *data() const { return _p; }
+        size_t size() const { return _n; }
+        bool empty() const { return _n == 0; }
+        char operator[](size_t i) const { return _p[i]; }
+
+        /// As string::substr(), without copies
+        substring substr(size_t pos, size_t n = npos) const {
+            if (pos > _n) pos = _n;
+            return substring(_p + pos, n < _n - pos ? n : _n - pos);
+        }
+
+        size_t find(char c, size_t pos = 0) const;
+        size_t find(const substring &s, size_t pos = 0) const;
+        size_t find_first_of(const substring &chars, size_t pos = 0) const;
+        size_t find_first_not_of(const substring &chars, size_t pos = 0) const;
+        size_t find_last_of(const substring &chars) const;
+
+        string str() const { return string(_p, _n); }
+
+        /// Copies the substring in s, reusing its memory
+        void assign_to(string &s) const { s.assign(_p, _n); }
+
+        bool operator==(const substring &o) const {
+            return _n == o._n && memcmp(_p, o._p, _n) == 0;
+        }
+        bool operator!=(const substring &o) const { return !(*this == o); }
+    };
+
+    /// As remove_spaces(), without copies
+    substring trim(const substring &tk);
+
+    /**
+       As split(code, sep), without copies: the substrings are
+       stored in out, which is cleared first.
+    */
+    void split(const substring &code, const substring &sep,
+               vector<substring> &out);
+
+    /**
+       As split_instr(code), without copies: the instructions are
+       stored in out, which is cleared first.
+    */
+    void split_instr(const substring &code, vector<substring> &out);
+
+    /// As get_token(), without copies
+    substring token_of(const substring &instr,
+                       const substring &open_par = "(");
+
+    /// As get_param(), without copies
+    substring param_of(const substring &instr,
+                       const substring &open_par = "(",
+                       const substring &close_par = ")");
+
+    /**
+       As split_param(p, sep, open_par, close_par), without
+       copies: the parameters are stored in out, which is cleared
+       first.
+    */
+    void split_param(const substring &p, vector<substring> &out,
+                     const substring &sep = ",",
+                     char open_par = '(', char close_par = ')');
+
+    /**
+       Copies the substrings in v into out, reusing the strings
+       already in out: a factory can be fed with the same vector
+       of parameters again and again.
+    */
+    void assign(const vector<substring> &v, vector<string> &out);
+
+    /// As parse_double(nums, res, unit), without copies
+    void parse_double(const substring &nums, double &res, substring &unit);
+
     /**
        Removes trailing spaces from the beginning and from the end of
        the string \c tk.
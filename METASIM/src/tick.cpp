@@ -53,21 +53,27 @@ namespace MetaSim {
         else if (unit == "ns")  { resolution = (impl_t) num ; } 
     }
     
-    Tick::Tick(const string &s)
+    Tick::Tick(const string &s) : v(parse(substring(s)).v)
     {
-        string unit;
+    }
+
+    Tick Tick::parse(const substring &s)
+    {
+        substring unit;
         double num;
+        Tick t;
 
         parse_double(s, num, unit);
 
         if (unit != "s" && unit != "ms" && unit != "us" && unit != "ns" && unit != "") 
-            throw ParseExc("Cannot understand time unit: ", unit);
+            throw ParseExc("Cannot understand time unit: ", unit.str());
 
-        if (unit == "") { v = (impl_t)((num * default_unit) / resolution); }
-        else if (unit == "s") { v = (impl_t)((num * 1000000000) / resolution);}
-        else if (unit == "ms")  { v = (impl_t)((num * 1000000) / resolution); }
-        else if (unit == "us")  { v = (impl_t)((num * 1000) / resolution); }
-        else if (unit == "ns")  { v = (impl_t)((num) / resolution); }
+        if (unit == "") { t.v = (impl_t)((num * default_unit) / resolution); }
+        else if (unit == "s") { t.v = (impl_t)((num * 1000000000) / resolution);}
+        else if (unit == "ms")  { t.v = (impl_t)((num * 1000000) / resolution); }
+        else if (unit == "us")  { t.v = (impl_t)((num * 1000) / resolution); }
+        else if (unit == "ns")  { t.v = (impl_t)((num) / resolution); }
+        return t;
     }
 
 
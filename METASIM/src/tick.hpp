@@ -122,6 +122,9 @@ namespace MetaSim {
         /// implementation in tick.pp
         Tick(const std::string &s);
 
+        /// As Tick(const std::string &), without copying s
+        static Tick parse(const parse_util::substring &s);
+
         /// explicit conversion with trunking
         explicit Tick(double t) { v = (impl_t) t; }
 
@@ -0,0 +1,152 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TIMEINTEGRAL_HPP__
+#define __TIMEINTEGRAL_HPP__
+
+#include <vector>
+
+#include <basestat.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       The integral over the time of a piecewise constant value
+       (e.g. the length of a queue): the area up to the last
+       change, and the time of the last change. The owner of the
+       value calls set() only when the value changes, so the area
+       is kept without events or probes, and it is read at any
+       time with area(now).
+
+       <pre>
+       TimeIntegral len;
+       len.reset(0);
+       len.set(10, 2);      // 0 until 10, then 2
+       len.area(15);        // 10
+       </pre>
+    */
+    class TimeIntegral {
+        double _area;
+        Tick _last;
+        double _value;
+
+    public:
+        TimeIntegral() : _area(0), _last(0), _value(0) {}
+
+        /// Starts again from now, with value v
+        void reset(const Tick &now, double v = 0)
+            {
+                _area = 0;
+                _last = now;
+                _value = v;
+            }
+
+        /// The value becomes v at now (not before the last change)
+        void set(const Tick &now, double v)
+            {
+                if (v == _value) return;
+                _area += _value * double(now - _last);
+                _last = now;
+                _value = v;
+            }
+
+        /// The current value
+        double get() const { return _value; }
+
+        /// The time of the last change (or of the reset)
+        Tick getLastChange() const { return _last; }
+
+        /// The area from the reset until now
+        double area(const Tick &now) const
+            {
+                return _area + _value * double(now - _last);
+            }
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       The time average of the sum of some TimeIntegrals, from the
+       end of the transitory (or from the beginning of the run)
+       to the time the value is read: at the end of the run (see
+       BaseStat::endValue()) or when a snapshot is taken (see
+       BaseStat::refresh()). Nothing is recorded during the run:
+       the area at the end of the transitory is taken by an
+       event, posted only if there is a transitory.
+
+       The integrals must be reset at the beginning of the run,
+       before the value is read.
+    */
+    class StatTimeAverage : public BaseStat {
+        std::vector<const TimeIntegral *> _in;
+        double _baseArea;
+        Tick _from;
+        GEvent<StatTimeAverage> _transEvt;
+
+        void onTransitory(Event *)
+            {
+                _baseArea = area();
+                _from = SIMUL.getTime();
+            }
+
+    protected:
+        /// The sum of the areas, until now
+        double area() const
+            {
+                double a = 0;
+                for (size_t i = 0; i < _in.size(); ++i)
+                    a += _in[i]->area(SIMUL.getTime());
+                return a;
+            }
+
+        /// The time average, from the transitory until now
+        double average() const
+            {
+                Tick t = SIMUL.getTime() - _from;
+                if (t <= 0) return 0;
+                return (area() - _baseArea) / double(t);
+            }
+
+    public:
+        StatTimeAverage(std::string name = "") :
+            BaseStat(name), _in(), _baseArea(0), _from(0),
+            _transEvt(this, &StatTimeAverage::onTransitory,
+                      Event::_IMMEDIATE_PRIORITY) {}
+
+        /// Adds i to the sum
+        void add(const TimeIntegral *i) { _in.push_back(i); }
+
+        /// Not used: the value is read from the integrals
+        virtual void record(double) {}
+
+        virtual void initValue()
+            {
+                _val = 0;
+                _baseArea = 0;
+                _from = SIMUL.getTime();
+                _transEvt.drop();
+                if (getTransitory() > 0) _transEvt.post(getTransitory());
+            }
+
+        virtual void refresh() { _val = average(); }
+        virtual void endValue() { refresh(); }
+    };
+
+} // namespace MetaSim
+
+#endif
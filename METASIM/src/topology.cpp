@@ -0,0 +1,153 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <topology.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        // a list of processors as in /sys: "0-3,8,10-11"
+        vector<int> parseList(const string &s)
+        {
+            vector<int> v;
+            size_t i = 0;
+            while (i < s.size()) {
+                int a, b;
+                int n = 0;
+                if (sscanf(s.c_str() + i, "%d%n", &a, &n) != 1) break;
+                i += n;
+                b = a;
+                if (i < s.size() && s[i] == '-') {
+                    ++i;
+                    if (sscanf(s.c_str() + i, "%d%n", &b, &n) != 1) break;
+                    i += n;
+                }
+                for (int c = a; c <= b; ++c) v.push_back(c);
+                if (i < s.size() && s[i] == ',') ++i;
+                else break;
+            }
+            return v;
+        }
+    }
+
+    Topology::Topology() : _nodes(), _nodeOf(), _cpus(0)
+    {
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        for (int n = 0; ; ++n) {
+            ifstream f(("/sys/devices/system/node/node" + to_string(n) + "/cpulist").c_str());
+            if (!f.is_open()) break;
+            string line;
+            getline(f, line);
+            vector<int> cpus, all = parseList(line);
+            for (size_t i = 0; i < all.size(); ++i)
+                if (!mask || (all[i] < CPU_SETSIZE && CPU_ISSET(all[i], &allowed)))
+                    cpus.push_back(all[i]);
+            if (!cpus.empty()) _nodes.push_back(cpus);
+        }
+        if (_nodes.empty() && mask) {
+            vector<int> cpus;
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+            if (!cpus.empty()) _nodes.push_back(cpus);
+        }
+#endif
+        if (_nodes.empty()) {
+            int n = thread::hardware_concurrency();
+            vector<int> cpus;
+            for (int c = 0; c < (n > 0 ? n : 1); ++c) cpus.push_back(c);
+            _nodes.push_back(cpus);
+        }
+
+        for (size_t n = 0; n < _nodes.size(); ++n)
+            for (size_t i = 0; i < _nodes[n].size(); ++i) {
+                int c = _nodes[n][i];
+                if (c >= int(_nodeOf.size())) _nodeOf.resize(c + 1, -1);
+                _nodeOf[c] = n;
+                ++_cpus;
+            }
+    }
+
+    const Topology &Topology::get()
+    {
+        static Topology t;
+        return t;
+    }
+
+    int Topology::getWorkerCpu(size_t i) const
+    {
+        const vector<int> &cpus = _nodes[getWorkerNode(i)];
+        return cpus[(i / _nodes.size()) % cpus.size()];
+    }
+
+    size_t Topology::getNodeOf(int cpu) const
+    {
+        if (cpu < 0 || cpu >= int(_nodeOf.size()) || _nodeOf[cpu] < 0) return 0;
+        return _nodeOf[cpu];
+    }
+
+    size_t Topology::currentNode() const
+    {
+        if (_nodes.size() == 1) return 0;
+#if defined(__linux__)
+        return getNodeOf(sched_getcpu());
+#else
+        return 0;
+#endif
+    }
+
+    Topology::Pin::Pin(size_t worker, bool enabled) : _saved(), _pinned(false)
+    {
+#if defined(__linux__)
+        if (!enabled) return;
+        cpu_set_t old, set;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(old), &old) != 0) return;
+        CPU_ZERO(&set);
+        CPU_SET(Topology::get().getWorkerCpu(worker), &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) return;
+        _saved.assign(reinterpret_cast<unsigned char *>(&old),
+                      reinterpret_cast<unsigned char *>(&old) + sizeof(old));
+        _pinned = true;
+#else
+        (void) worker;
+        (void) enabled;
+#endif
+    }
+
+    Topology::Pin::~Pin()
+    {
+#if defined(__linux__)
+        if (!_pinned) return;
+        cpu_set_t old;
+        memcpy(&old, &_saved[0], sizeof(old));
+        pthread_setaffinity_np(pthread_self(), sizeof(old), &old);
+#endif
+    }
+
+} // namespace MetaSim
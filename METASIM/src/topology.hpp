@@ -0,0 +1,147 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TOPOLOGY_HPP__
+#define __TOPOLOGY_HPP__
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       The processors that this process may use, grouped by NUMA
+       node, read once from the operating system (on Linux, from
+       /sys and the affinity of the process; elsewhere, a single
+       node with all the hardware threads).
+
+       The pools of threads of the parallel runs (see
+       Simulation::run(), Campaign::run()) take their default size
+       from here, and with the pinning enabled (see
+       Simulation::setPinning()) worker i is pinned to
+       getWorkerCpu(i): the workers are spread over the nodes,
+       round robin. A worker creates its SimContext, its model,
+       its arena and its generator after being pinned, so the
+       first touch puts them in the memory of its node. The
+       read-only data shared by the workers (model images,
+       tables of the PDFs) can be replicated per node with
+       PerNode.
+    */
+    class Topology {
+        std::vector<std::vector<int> > _nodes;
+        /// the node of each processor (-1 if not usable)
+        std::vector<int> _nodeOf;
+        size_t _cpus;
+
+        Topology();
+
+    public:
+        /// The topology of this machine
+        static const Topology &get();
+
+        size_t getNodes() const { return _nodes.size(); }
+
+        /// The processors of node n that the process may use
+        const std::vector<int> &getCpus(size_t n) const { return _nodes[n]; }
+
+        /// Number of processors that the process may use
+        size_t getCpuCount() const { return _cpus; }
+
+        /// The default size of a pool of workers (one per processor)
+        size_t getDefaultThreads() const { return _cpus; }
+
+        /// The node of worker i
+        size_t getWorkerNode(size_t i) const { return i % _nodes.size(); }
+
+        /// The processor of worker i
+        int getWorkerCpu(size_t i) const;
+
+        /// The node of processor cpu (0 if unknown)
+        size_t getNodeOf(int cpu) const;
+
+        /// The node where the calling thread runs (0 if unknown)
+        size_t currentNode() const;
+
+        /**
+           Pins the calling thread to the processor of worker i
+           while it exists, then gives it back its affinity. It
+           does nothing where the affinity cannot be set.
+        */
+        class Pin {
+            std::vector<unsigned char> _saved;
+            bool _pinned;
+            Pin(const Pin &);
+            Pin &operator=(const Pin &);
+        public:
+            Pin(size_t worker, bool enabled = true);
+            ~Pin();
+        };
+    };
+
+    /**
+       \ingroup metasim_util
+
+       A read-only object replicated on each NUMA node: the first
+       thread that calls get() on a node builds the copy of the
+       node, so that it is allocated in its memory, and the other
+       threads of the node share it.
+
+       <pre>
+       PerNode<ModelImage> image([]() { return new ModelImage("model.img"); });
+       // in the builder of a replica
+       ModelFile m;
+       m.build(image.get());
+       </pre>
+    */
+    template <class T>
+    class PerNode {
+        std::function<T *()> _make;
+        std::vector<std::unique_ptr<T> > _copies;
+        std::unique_ptr<std::atomic<T *>[]> _ready;
+        std::mutex _m;
+
+        PerNode(const PerNode &);
+        PerNode &operator=(const PerNode &);
+
+    public:
+        /// make builds a copy (owned by this object)
+        explicit PerNode(const std::function<T *()> &make) :
+            _make(make), _copies(Topology::get().getNodes()),
+            _ready(new std::atomic<T *>[Topology::get().getNodes()])
+        {
+            for (size_t i = 0; i < _copies.size(); ++i) _ready[i] = 0;
+        }
+
+        /// The copy of the node of the calling thread
+        T &get()
+        {
+            size_t n = Topology::get().currentNode();
+            T *p = _ready[n].load(std::memory_order_acquire);
+            if (p) return *p;
+            std::lock_guard<std::mutex> l(_m);
+            if (!_copies[n]) {
+                _copies[n].reset(_make());
+                _ready[n].store(_copies[n].get(), std::memory_order_release);
+            }
+            return *_copies[n];
+        }
+    };
+
+} // namespace MetaSim
+
+#endif
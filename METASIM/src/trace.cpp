@@ -53,7 +53,8 @@ namespace MetaSim {
   const char * const Trace::Exc::_NO_OPEN = "File is not open";
 
   Trace::Trace(const char *filename, Type type, bool tof) 
-    :_filename(filename), toFile(tof)
+    :_filename(filename), toFile(tof), _filtered(false), _from(0), 
+     _to(MAXTICK), _kinds(), _ids()
   {
     if (tof == false) return;
     if (type == _ASCII_TRACE) 
@@ -63,7 +64,8 @@ namespace MetaSim {
   } 
 
   Trace::Trace(string filename, Type type, bool tof)
-    : _filename(filename)
+    : _filename(filename), toFile(tof), _filtered(false), _from(0), 
+      _to(MAXTICK), _kinds(), _ids()
   {
     if (tof == false) return;
     if (type == _ASCII_TRACE) 
@@ -87,6 +89,59 @@ namespace MetaSim {
     if (_os.bad()) throw Exc();
   }
 
+  void Trace::setWindow(Tick from, Tick to)
+  {
+    _from = from;
+    _to = to;
+    _filtered = true;
+  }
+
+  namespace {
+    void setFlags(vector<bool> &f, const vector<int> &v)
+    {
+      f.clear();
+      for (size_t i = 0; i < v.size(); ++i) {
+        if (v[i] < 0) continue;
+        if (size_t(v[i]) >= f.size()) f.resize(v[i] + 1, false);
+        f[v[i]] = true;
+      }
+    }
+
+    bool flag(const vector<bool> &f, int i)
+    {
+      return f.empty() || (i >= 0 && size_t(i) < f.size() && f[i]);
+    }
+  }
+
+  void Trace::setKinds(const vector<int> &kinds)
+  {
+    setFlags(_kinds, kinds);
+    _filtered = true;
+  }
+
+  void Trace::setIDs(const vector<int> &ids)
+  {
+    setFlags(_ids, ids);
+    _filtered = true;
+  }
+
+  void Trace::clearFilters()
+  {
+    _from = 0;
+    _to = MAXTICK;
+    _kinds.clear();
+    _ids.clear();
+    _filtered = false;
+  }
+
+  bool Trace::pass(const Event *e) const
+  {
+    Tick t = e->getLastTime();
+    if (t < _from || t > _to) return false;
+    if (!flag(_kinds, e->getKind())) return false;
+    return _ids.empty() || flag(_ids, e->getOwnerID());
+  }
+
   void Trace::close()
   {
     _os.close();
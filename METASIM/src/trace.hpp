@@ -55,6 +55,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <baseexc.hpp>
 #include <basetype.hpp>
@@ -76,6 +77,15 @@ namespace MetaSim {
     std::string _filename;
     std::ofstream _os;
     bool toFile;
+
+    /// true if one of the filters below is set
+    bool _filtered;
+    Tick _from, _to;
+    /// accepted kinds and owner IDs (all if empty), by value
+    std::vector<bool> _kinds, _ids;
+
+    bool pass(const Event *e) const;
+
   public:
 
     enum Type {BINARY = 0,
@@ -114,6 +124,25 @@ namespace MetaSim {
      */
     virtual void record(Event*) {};
 
+    /**
+       Records only the events triggered in [from, to]. The
+       filters are checked by Event::action() before calling
+       record(), so the events they drop cost a single test.
+    */
+    void setWindow(Tick from, Tick to = MAXTICK);
+
+    /// Records only the events of the given kinds (see Event::getKind())
+    void setKinds(const std::vector<int> &kinds);
+
+    /// Records only the events with the given owner (see Event::getOwnerID())
+    void setIDs(const std::vector<int> &ids);
+
+    /// Removes all the filters
+    void clearFilters();
+
+    /// True if the filters accept e
+    bool accepts(const Event *e) const { return !_filtered || pass(e); }
+
     /// Open the file! 
     virtual void open(bool type = BINARY);
 
@@ -134,11 +163,12 @@ namespace MetaSim {
   public:
     TraceAscii(char* file) : Trace(file, ASCII){}
 
-    /// Records the value on the file, one value per line.
+    /// Records the value on the file, one value per line (the
+    /// file is flushed only when its buffer is full, or closed).
     //@{
-    void record(double value) { _os << value << std::endl; }
-    void record(long double value){_os << value << std::endl;}
-    void record(int value){_os << value << std::endl;}
+    void record(double value) { _os << value << '\n'; }
+    void record(long double value){_os << value << '\n';}
+    void record(int value){_os << value << '\n';}
     void record(char* str){_os << str;}
 
     /// DEPRECATED substitute with the particle mechanism
@@ -0,0 +1,245 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <simul.hpp>
+#include <tracepoint.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    std::atomic<uint64_t> TracePoints::_mask(0);
+
+    namespace {
+        const char MAGIC[4] = {'M', 'S', 'T', 'P'};
+        const uint32_t VERSION = 1;
+
+        // the levels and the sites, shared by all the threads
+        struct Registry {
+            mutex m;
+            vector<string> levels;
+            vector<const TraceSite *> sites;
+        };
+
+        Registry &registry()
+        {
+            static Registry r;
+            return r;
+        }
+
+        struct Ring {
+            vector<TracePoints::Record> rec;
+            size_t next, count;
+            Ring() : rec(1 << 16), next(0), count(0) {}
+        };
+
+        thread_local Ring ring;
+
+        uint64_t levelBit(Registry &r, const string &name)
+        {
+            size_t i = 0;
+            while (i < r.levels.size() && r.levels[i] != name) ++i;
+            if (i == r.levels.size()) r.levels.push_back(name);
+            return uint64_t(1) << (i < 63 ? i : 63);
+        }
+
+        struct SiteInfo {
+            string level, msg, file;
+            int line;
+        };
+
+        void printRecord(ostream &os, const TracePoints::Record &r,
+                         const SiteInfo &s)
+        {
+            os << "t = [" << r.time << "] " << s.level << ": " << s.msg;
+            for (uint32_t i = 0; i < r.nargs; ++i) {
+                double x = r.args[i];
+                if (x == floor(x) && fabs(x) < 1e15) os << " " << int64_t(x);
+                else os << " " << x;
+            }
+            os << " (" << s.file << ":" << s.line << ")\n";
+        }
+
+        template <class T>
+        void putRaw(ostream &os, const T &x)
+        {
+            os.write((const char *)&x, sizeof(x));
+        }
+
+        void putString(ostream &os, const string &s)
+        {
+            putRaw(os, uint32_t(s.size()));
+            os.write(s.data(), s.size());
+        }
+
+        template <class T>
+        void getRaw(istream &is, T &x)
+        {
+            if (!is.read((char *)&x, sizeof(x)))
+                throw TracePoints::Exc("Truncated file");
+        }
+
+        string getString(istream &is)
+        {
+            uint32_t n;
+            getRaw(is, n);
+            string s(n, ' ');
+            if (n > 0 && !is.read(&s[0], n))
+                throw TracePoints::Exc("Truncated file");
+            return s;
+        }
+    }
+
+    TraceSite::TraceSite(const char *l, const char *m, const char *f, int n) :
+        level(l), msg(m), file(f), line(n)
+    {
+        Registry &r = registry();
+        lock_guard<mutex> g(r.m);
+        bit = levelBit(r, l);
+        id = r.sites.size();
+        r.sites.push_back(this);
+    }
+
+    uint64_t TracePoints::level(const string &name)
+    {
+        Registry &r = registry();
+        lock_guard<mutex> g(r.m);
+        return levelBit(r, name);
+    }
+
+    void TracePoints::enable(const string &name)
+    {
+        if (name == "All") _mask = ~uint64_t(0);
+        else _mask |= level(name);
+    }
+
+    void TracePoints::disable(const string &name)
+    {
+        if (name == "All") _mask = 0;
+        else _mask &= ~level(name);
+    }
+
+    void TracePoints::put(const TraceSite &s, unsigned n, const double *v)
+    {
+        Ring &g = ring;
+        Record &r = g.rec[g.next];
+        r.time = SIMUL.getTime();
+        r.site = s.id;
+        r.nargs = n;
+        memcpy(r.args, v, n * sizeof(double));
+        if (++g.next == g.rec.size()) g.next = 0;
+        if (g.count < g.rec.size()) g.count++;
+    }
+
+    void TracePoints::setSize(size_t n)
+    {
+        ring.rec.assign(n > 0 ? n : 1, Record());
+        ring.next = ring.count = 0;
+    }
+
+    void TracePoints::clear()
+    {
+        ring.next = ring.count = 0;
+    }
+
+    size_t TracePoints::size()
+    {
+        return ring.count;
+    }
+
+    void TracePoints::print(ostream &os)
+    {
+        Registry &reg = registry();
+        vector<SiteInfo> sites;
+        {
+            lock_guard<mutex> g(reg.m);
+            for (size_t i = 0; i < reg.sites.size(); ++i) {
+                SiteInfo s = { reg.sites[i]->level, reg.sites[i]->msg,
+                               reg.sites[i]->file, reg.sites[i]->line };
+                sites.push_back(s);
+            }
+        }
+        const Ring &g = ring;
+        size_t first = (g.next + g.rec.size() - g.count) % g.rec.size();
+        for (size_t k = 0; k < g.count; ++k) {
+            const Record &r = g.rec[(first + k) % g.rec.size()];
+            printRecord(os, r, sites[r.site]);
+        }
+    }
+
+    void TracePoints::save(const string &file)
+    {
+        ofstream os(file.c_str(), ios::binary);
+        if (!os.is_open()) throw Exc("Cannot open " + file);
+        os.write(MAGIC, 4);
+        putRaw(os, VERSION);
+
+        Registry &reg = registry();
+        {
+            lock_guard<mutex> g(reg.m);
+            putRaw(os, uint32_t(reg.sites.size()));
+            for (size_t i = 0; i < reg.sites.size(); ++i) {
+                putString(os, reg.sites[i]->level);
+                putString(os, reg.sites[i]->msg);
+                putString(os, reg.sites[i]->file);
+                putRaw(os, int32_t(reg.sites[i]->line));
+            }
+        }
+
+        const Ring &g = ring;
+        size_t first = (g.next + g.rec.size() - g.count) % g.rec.size();
+        putRaw(os, uint64_t(g.count));
+        for (size_t k = 0; k < g.count; ++k)
+            putRaw(os, g.rec[(first + k) % g.rec.size()]);
+        if (!os) throw Exc("Error writing " + file);
+    }
+
+    void TracePoints::decode(const string &file, ostream &os)
+    {
+        ifstream is(file.c_str(), ios::binary);
+        if (!is.is_open()) throw Exc("Cannot open " + file);
+        char magic[4];
+        uint32_t version, n;
+        if (!is.read(magic, 4) || memcmp(magic, MAGIC, 4) != 0)
+            throw Exc(file + " is not a tracepoint file");
+        getRaw(is, version);
+        if (version != VERSION) throw Exc("Unsupported version");
+
+        getRaw(is, n);
+        vector<SiteInfo> sites(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            int32_t line;
+            sites[i].level = getString(is);
+            sites[i].msg = getString(is);
+            sites[i].file = getString(is);
+            getRaw(is, line);
+            sites[i].line = line;
+        }
+
+        uint64_t count;
+        getRaw(is, count);
+        for (uint64_t k = 0; k < count; ++k) {
+            Record r;
+            getRaw(is, r);
+            if (r.site >= n || r.nargs > MAX_ARGS) throw Exc("Corrupted record");
+            printRecord(os, r, sites[r.site]);
+        }
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,141 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACEPOINT_HPP__
+#define __TRACEPOINT_HPP__
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+
+#include <baseexc.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       A tracepoint of the code (see DBG_POINT), registered the
+       first time it is reached.
+    */
+    struct TraceSite {
+        const char *level;
+        const char *msg;
+        const char *file;
+        int line;
+        /// the bit of the level in the mask of TracePoints
+        uint64_t bit;
+        uint32_t id;
+
+        TraceSite(const char *l, const char *m, const char *f, int n);
+    };
+
+    /**
+       \ingroup metasim_util
+
+       Tracepoints that are always compiled in, and enabled per
+       debug level at run time. Unlike the DBGPRINT macros, that
+       exist only if the library is compiled with __DEBUG__, a
+       disabled DBG_POINT costs the load of a mask and a test:
+
+       <pre>
+       DBG_POINT(_KERNEL_DBG_LEV, "dispatch", task->getTaskNumber());
+       </pre>
+
+       An enabled tracepoint does not format anything: it stores
+       the time, the site and its (at most MAX_ARGS numeric)
+       arguments in a ring of fixed size records, one per thread,
+       which keeps the most recent ones. The ring is decoded in
+       text with print(), or saved in a binary file with save()
+       and decoded later with decode().
+
+       There are at most 64 levels: the following ones share the
+       last bit of the mask.
+    */
+    class TracePoints {
+    public:
+        static const int MAX_ARGS = 4;
+
+        struct Record {
+            int64_t time;
+            uint32_t site;
+            uint32_t nargs;
+            double args[MAX_ARGS];
+        };
+
+        DECL_EXC(Exc, "TracePoints");
+
+    private:
+        static std::atomic<uint64_t> _mask;
+
+        static void put(const TraceSite &s, unsigned n, const double *v);
+
+    public:
+        /// The bit of a level, which is registered if new
+        static uint64_t level(const std::string &name);
+
+        /// Enables a level ("All" enables all of them)
+        static void enable(const std::string &name);
+
+        /// Disables a level ("All" disables all of them)
+        static void disable(const std::string &name);
+
+        static bool enabled(const TraceSite &s)
+        {
+            return (_mask.load(std::memory_order_relaxed) & s.bit) != 0;
+        }
+
+        /// Records a tracepoint (the arguments must convert to double)
+        template <class... A>
+        static void log(const TraceSite &s, A... a)
+        {
+            static_assert(sizeof...(A) <= MAX_ARGS, "Too many arguments");
+            const double v[] = { double(a)..., 0 };
+            put(s, sizeof...(A), v);
+        }
+
+        /// Sets the number of records of the ring (of this thread)
+        static void setSize(size_t n);
+
+        /// Empties the ring of this thread
+        static void clear();
+
+        /// Number of records in the ring of this thread
+        static size_t size();
+
+        /// Prints the records of the ring of this thread, oldest first
+        static void print(std::ostream &os);
+
+        /// Saves the sites and the ring of this thread in a binary file
+        static void save(const std::string &file);
+
+        /// Prints the records of a file written by save()
+        static void decode(const std::string &file, std::ostream &os);
+    };
+
+} // namespace MetaSim
+
+/**
+   Records msg and (at most 4) numeric arguments if level is
+   enabled, see MetaSim::TracePoints.
+*/
+#define DBG_POINT(level, msg, ...)                                      \
+    do {                                                                \
+        static const MetaSim::TraceSite __tp_site__(level, msg,         \
+                                                    __FILE__, __LINE__); \
+        if (MetaSim::TracePoints::enabled(__tp_site__))                 \
+            MetaSim::TracePoints::log(__tp_site__, ##__VA_ARGS__);      \
+    } while (0)
+
+#endif
@@ -0,0 +1,32 @@
+#include <sstream>
+#include <string>
+
+#include <asyncwriter.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+TEST_CASE("TestAsyncWriter", "testBuffers")
+{
+    std::ostringstream os;
+    std::string ref;
+    {
+        // small buffers, so that the thread writes most of them
+        AsyncWriter w(os, 16);
+        for (int i = 0; i < 1000; ++i) {
+            std::string s = std::to_string(i) + ",";
+            w.write(s.data(), s.size());
+            ref += s;
+        }
+        std::string big(40, 'x');
+        w.write(big.data(), big.size());
+        ref += big;
+        w.flush();
+        REQUIRE(os.str() == ref);
+
+        w.write("end", 3);
+        ref += "end";
+    }
+    REQUIRE(os.str() == ref);
+}
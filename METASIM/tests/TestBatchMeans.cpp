@@ -0,0 +1,101 @@
+#include <cmath>
+
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // an autoregressive process x' = 10 + 0.9 (x - 10) + e, which
+    // starts far from its steady-state mean (10)
+    class Process : public Entity {
+        GEvent<Process> _evt;
+        UniformVar _e;
+        double _x;
+        StatMean &_mean;
+        StatPercent &_above;
+    public:
+        Process(StatMean &m, StatPercent &a) : 
+            Entity("process"), _evt(this, &Process::onEvt),
+            _e(-1, 1), _x(50), _mean(m), _above(a) {}
+        void onEvt(Event *) {
+            _x = 10 + 0.9 * (_x - 10) + _e.get();
+            _mean.record(_x);
+            _above.record(_x > 10 ? 1 : 0);
+            _evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { _x = 50; _evt.post(0); }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestBatchMeans", "testSingleRun")
+{
+    StatMean mean("x");
+    StatPercent above("above");
+    Process p(mean, above);
+
+    mean.setBatchMeans();
+    above.setBatchMeans();
+    RandomVar::init(3);
+    BaseStat::setTransitory(1000);
+    SIMUL.run(101000);
+    BaseStat::setTransitory(0);
+
+    // the transitory is discarded, and the batches are long
+    // enough to be almost independent
+    REQUIRE(mean.getBatchNum() >= 20);
+    REQUIRE(mean.getBatchNum() <= 128);
+    REQUIRE(mean.getBatchSize() > 1);
+    size_t used = mean.getBatchSize() * mean.getBatchNum();
+    REQUIRE(used <= 100000);
+    REQUIRE(std::fabs(mean.getBatchMean() - mean.getValue()) < 0.01);
+
+    double h = mean.getBatchConfInterval();
+    INFO(mean.getBatchMean() << " +- " << h << ", " << used);
+    REQUIRE(h > 0);
+    REQUIRE(h < 0.05);
+    REQUIRE(std::fabs(mean.getBatchMean() - 10) < 2 * h);
+
+    REQUIRE(std::fabs(above.getBatchMean() - 0.5) < 
+            2 * above.getBatchConfInterval());
+
+    StatMean off("off");
+    REQUIRE_THROWS(off.getBatchConfInterval());
+}
+
+TEST_CASE("TestBatchMeans2", "testWarmupDetection")
+{
+    StatMean mean("x");
+    StatPercent above("above");
+    Process p(mean, above);
+
+    // no transitory: the warm-up is found by MSER-5
+    mean.setWarmupDetection();
+    RandomVar::init(3);
+    SIMUL.run(5000);
+
+    REQUIRE(mean.isWarmupOver());
+    INFO(mean.getWarmupLength());
+    REQUIRE(mean.getWarmupLength() > 0);
+    REQUIRE(mean.getWarmupLength() < 5000);
+    double h = mean.getBatchConfInterval();
+    REQUIRE(std::fabs(mean.getBatchMean() - 10) < 2 * h);
+
+    // the run stops as soon as the mean is known at 1%
+    SIMUL.addStopPredicate([&mean]() { return mean.hasPrecision(0.01); });
+    SIMUL.run(10000000);
+    SIMUL.clearStopPredicates();
+    REQUIRE(SIMUL.isStopped());
+    REQUIRE(mean.hasPrecision(0.01));
+    size_t used = mean.getBatchSize() * mean.getBatchNum();
+    INFO(used);
+    REQUIRE(used < 100000);
+    REQUIRE(std::fabs(mean.getBatchMean() - 10) < 
+            2 * mean.getBatchConfInterval());
+}
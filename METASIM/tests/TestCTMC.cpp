@@ -0,0 +1,80 @@
+#include <cmath>
+#include <vector>
+
+#include <ctmc.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+TEST_CASE("TestCTMC", "testJumps")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    RandomVar::init(7);
+
+    // from 0, to 1, 2 and 3 with weights 1:2:5, and back to 0
+    CTMC m("m");
+    for (int i = 0; i < 4; ++i) m.addState();
+    m.addTransition(0, 1, 0.001);
+    m.addTransition(0, 2, 0.0015);
+    m.addTransition(0, 2, 0.0005);
+    m.addTransition(0, 3, 0.005);
+    for (CTMC::StateId s = 1; s < 4; ++s) m.addTransition(s, 0, 0.01);
+    m.addToken(0);
+
+    std::vector<int> to(4, 0);
+    m.setObserver([&](size_t, CTMC::StateId from, CTMC::StateId t) {
+            if (from == 0) to[t]++;
+        });
+    m.compile();
+    REQUIRE(m.getTransitionCount() == 6);
+    REQUIRE(std::fabs(m.getExitRate(0) - 0.008) < 1e-12);
+    REQUIRE_THROWS(m.addTransition(1, 2, 1.0));
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(20000000);
+    SIMUL.endSingleRun();
+
+    int n = to[1] + to[2] + to[3];
+    REQUIRE(n > 50000);
+    REQUIRE((std::fabs(double(to[1]) / n - 0.125) < 0.01));
+    REQUIRE((std::fabs(double(to[2]) / n - 0.25) < 0.01));
+    REQUIRE((std::fabs(double(to[3]) / n - 0.625) < 0.01));
+
+    // the stationary distribution: 0 holds 1/8 of the time per
+    // 1/0.008, the others 1/0.01 each
+    double total = 0;
+    for (CTMC::StateId s = 0; s < 4; ++s) total += double(m.getOccupancy(s));
+    REQUIRE((std::fabs(total - 20000000) <= 1));
+    double p0 = 125.0 / (125.0 + 100.0);
+    REQUIRE((std::fabs(double(m.getOccupancy(0)) / total - p0) < 0.01));
+}
+
+TEST_CASE("TestCTMC2", "testAbsorbing")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    CTMC m("m");
+    CTMC::StateId a = m.addState("a"), b = m.addState("b");
+    m.addTransition(a, b, 0.1);
+    m.addToken(a);
+    m.addToken(b);
+
+    REQUIRE_THROWS(m.addTransition(a, 5, 0.1));
+    REQUIRE_THROWS(m.addTransition(a, b, 0));
+    REQUIRE_THROWS(m.addToken(7));
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(10000);
+    SIMUL.endSingleRun();
+
+    REQUIRE(m.getState(0) == b);
+    REQUIRE(m.getState(1) == b);
+    REQUIRE(m.getJumps() == 1);
+    REQUIRE(m.getStateName(b) == "b");
+    REQUIRE((double(m.getOccupancy(b)) + double(m.getOccupancy(a)) == 20000));
+}
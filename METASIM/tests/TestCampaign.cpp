@@ -0,0 +1,436 @@
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <basestat.hpp>
+#include <campaign.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <resultstore.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Sampler : public Entity {
+        GEvent<Sampler> _evt;
+        UniformVar _var;
+        StatMean &_stat;
+    public:
+        Sampler(StatMean &s, double max) : Entity("sampler"),
+                                           _evt(this, &Sampler::onEvt),
+                                           _var(0, max), _stat(s) {}
+        void onEvt(Event *) {
+            _stat.record(_var.get());
+            _evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+
+    struct Model {
+        StatMean stat;
+        Sampler sampler;
+        Model(double max) : stat("mean"), sampler(stat, max) {}
+    };
+
+    std::shared_ptr<void> build(const Campaign::Point &p)
+    {
+        return std::make_shared<Model>(p["max"] * p["scale"]);
+    }
+}
+
+namespace {
+    // a step at U = 0.7, as the miss ratio of a task set
+    class Step : public Entity {
+        GEvent<Step> _evt;
+        double _value;
+        StatMean &_stat;
+    public:
+        Step(StatMean &s, double v) : Entity("step"), _evt(this, &Step::onEvt),
+                                      _value(v), _stat(s) {}
+        void onEvt(Event *) { _stat.record(_value); }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+
+    struct StepModel {
+        StatMean stat;
+        Step step;
+        StepModel(double u) : stat("miss"), step(stat, u > 0.7 ? 1 : 0) {}
+    };
+}
+
+namespace {
+    // with step 0 the time never advances, as in a preemption storm
+    class Storm : public Entity {
+        GEvent<Storm> _evt;
+        Tick _step;
+        StatCount &_stat;
+    public:
+        Storm(StatCount &s, Tick step) : Entity("storm"), 
+                                         _evt(this, &Storm::onEvt),
+                                         _step(step), _stat(s) {}
+        void onEvt(Event *) { 
+            _stat.record(1);
+            _evt.post(SIMUL.getTime() + _step);
+        }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+
+    struct StormModel {
+        StatCount stat;
+        Storm storm;
+        StormModel(bool s) : stat("events"), storm(stat, s ? 0 : 1) {}
+    };
+
+    std::shared_ptr<void> buildStorm(const Campaign::Point &p)
+    {
+        return std::make_shared<StormModel>(p["storm"] > 0);
+    }
+}
+
+TEST_CASE("TestCampaign", "testGrid")
+{
+    Campaign c;
+    c.addParameter("max", std::vector<double>{10, 100});
+    c.addParameter("scale", 1, 3, 1);
+    REQUIRE(c.size() == 6);
+    REQUIRE(c.getPoint(4)["max"] == 100);
+    REQUIRE(c.getPoint(4)["scale"] == 2);
+
+    std::ostringstream out;
+    c.setOutput(&out);
+    RandomVar::init(12345);
+    c.run(build, 100, 3, 1);
+    std::vector<Campaign::Row> t1 = c.getTable();
+
+    c.setOutput(0);
+    c.run(build, 100, 3, 4);
+    const std::vector<Campaign::Row> &t4 = c.getTable();
+
+    REQUIRE(c.getColumns().size() == 1);
+    REQUIRE(c.getColumns()[0] == "mean");
+    REQUIRE(t4.size() == 6);
+    for (size_t k = 0; k < t4.size(); ++k) {
+        double max = t4[k].params[0] * t4[k].params[1];
+        REQUIRE(t4[k].values[0] > 0);
+        REQUIRE(t4[k].values[0] < max);
+        // the points do not depend on the number of threads
+        REQUIRE(t4[k].values[0] == t1[k].values[0]);
+    }
+
+    // the header and one line for each point
+    std::istringstream in(out.str());
+    std::string line;
+    int lines = 0;
+    while (std::getline(in, line)) ++lines;
+    REQUIRE(lines == 7);
+}
+
+TEST_CASE("TestCampaign2", "testResultStore")
+{
+    const char *fname = "test_campaign.msrs";
+    std::remove(fname);
+
+    Campaign c;
+    c.addParameter("max", std::vector<double>{10, 100});
+    c.addParameter("scale", 1, 3, 1);
+    {
+        // small blocks, so that the file has more than one
+        ResultStore store(fname, 4);
+        c.setStore(&store);
+        RandomVar::init(12345);
+        c.run(build, 100, 3, 2);
+        c.setStore(0);
+        REQUIRE(store.getRows() == 6);
+    }
+    {
+        // appending to an existing file
+        ResultStore store(fname);
+        REQUIRE(store.getRows() == 6);
+        REQUIRE(store.getColumns().size() == 4);
+        REQUIRE_THROWS(store.setColumns(std::vector<std::string>{"x"}));
+        store.append(std::vector<double>{1, 2, 3, 4});
+    }
+
+    std::vector<std::string> columns;
+    std::vector<std::vector<double> > rows;
+    ResultStore::load(fname, columns, rows);
+    REQUIRE(columns == (std::vector<std::string>{"max", "scale", "mean", "mean.ci"}));
+    REQUIRE(rows.size() == 7);
+    for (size_t k = 0; k < 6; ++k) {
+        // the rows are stored in the order of termination
+        REQUIRE(rows[k][2] == c.getTable()[size_t(rows[k][0] == 100) * 3 + 
+                                           size_t(rows[k][1]) - 1].values[0]);
+        REQUIRE(rows[k][3] > 0);
+    }
+    REQUIRE(rows[6][3] == 4);
+
+    std::ostringstream table;
+    ResultStore::exportTable(fname, table);
+    REQUIRE(table.str().find("max,scale,mean,mean.ci\n") == 0);
+    std::remove(fname);
+}
+
+TEST_CASE("TestCampaign3", "testDistributed")
+{
+    {
+        std::ofstream f("campaign_scale.txt");
+        f << "2\n";
+    }
+
+    Campaign c;
+    c.addParameter("max", std::vector<double>{10, 100});
+    c.addParameter("scale", 1, 3, 1);
+    RandomVar::init(12345);
+    c.run(build, 100, 3, 1);
+    std::vector<Campaign::Row> local = c.getTable();
+
+    // the file reaches the workers, in their cache directory
+    c.addFile("campaign_scale.txt");
+    int port = c.listen();
+    REQUIRE(port > 0);
+
+    size_t points[2] = {0, 0};
+    std::vector<std::thread> nodes;
+    for (int i = 0; i < 2; ++i)
+        nodes.push_back(std::thread([&, i]() {
+            Campaign w;
+            w.setCacheDir("/tmp");
+            points[i] = w.work("localhost", port, [](const Campaign::Point &p) {
+                std::ifstream f("/tmp/campaign_scale.txt");
+                double s = 0;
+                f >> s;
+                // the shipped file, or no model at all
+                if (s != 2) throw std::runtime_error("no file");
+                return build(p);
+            }, 2);
+        }));
+    c.serve(100, 3);
+    for (size_t i = 0; i < nodes.size(); ++i) nodes[i].join();
+
+    REQUIRE((points[0] + points[1]) == 6);
+    const std::vector<Campaign::Row> &t = c.getTable();
+    REQUIRE(c.getColumns().size() == 1);
+    for (size_t k = 0; k < t.size(); ++k) {
+        REQUIRE(t[k].params == local[k].params);
+        REQUIRE(t[k].values[0] == local[k].values[0]);
+        REQUIRE(t[k].conf[0] == local[k].conf[0]);
+    }
+
+    // no campaign without listen()
+    REQUIRE_THROWS(c.serve(100, 3));
+    std::remove("campaign_scale.txt");
+    std::remove("/tmp/campaign_scale.txt");
+}
+
+TEST_CASE("TestCampaign4", "testResultCache")
+{
+    const char *fname = "test_cache.msrs";
+    std::remove(fname);
+    RandomVar::init(12345);
+
+    std::vector<Campaign::Row> first;
+    {
+        ResultStore store(fname);
+        Campaign c;
+        c.addParameter("max", std::vector<double>{10, 100});
+        c.addParameter("scale", 1, 3, 1);
+        c.setStore(&store);
+        c.cacheResults("sampler-1");
+        c.run(build, 100, 3, 2);
+        REQUIRE(c.getCachedPoints() == 0);
+        REQUIRE(store.getRows() == 6);
+        first = c.getTable();
+
+        // the same points again: nothing to simulate
+        int built = 0;
+        c.run([&](const Campaign::Point &p) { ++built; return build(p); }, 100, 3, 2);
+        REQUIRE(c.getCachedPoints() == 6);
+        REQUIRE(built == 0);
+        REQUIRE(store.getRows() == 6);
+        REQUIRE(c.getColumns().size() == 1);
+        REQUIRE(c.getTable()[4].values[0] == first[4].values[0]);
+    }
+    {
+        // a larger sweep: the points with the same index are reused
+        ResultStore store(fname);
+        Campaign c;
+        c.addParameter("max", std::vector<double>{10, 100, 1000});
+        c.addParameter("scale", 1, 3, 1);
+        c.setStore(&store);
+        c.cacheResults("sampler-1");
+        std::ostringstream out;
+        c.setOutput(&out);
+        c.run(build, 100, 3, 2);
+        REQUIRE(c.getCachedPoints() == 6);
+        REQUIRE(store.getRows() == 9);
+        for (size_t k = 0; k < 6; ++k) {
+            REQUIRE(c.getTable()[k].values[0] == first[k].values[0]);
+            REQUIRE(c.getTable()[k].conf[0] == first[k].conf[0]);
+        }
+        REQUIRE(c.getTable()[8].values[0] > 0);
+        REQUIRE(out.str().find("max,scale,mean\n") == 0);
+
+        // another model, or another length, is another key
+        REQUIRE(c.getKey(c.getPoint(0), 100, 3) != c.getKey(c.getPoint(0), 200, 3));
+        c.cacheResults("sampler-2");
+        c.run(build, 100, 3, 2);
+        REQUIRE(c.getCachedPoints() == 0);
+        REQUIRE(store.getRows() == 18);
+    }
+    {
+        // a store without keys cannot be a cache
+        std::remove(fname);
+        ResultStore store(fname);
+        Campaign c;
+        c.addParameter("max", std::vector<double>{10});
+        c.addParameter("scale", std::vector<double>{1});
+        c.setStore(&store);
+        c.run(build, 10, 1, 1);
+        c.cacheResults("sampler-1");
+        REQUIRE_THROWS(c.run(build, 10, 1, 1));
+    }
+    std::remove(fname);
+}
+
+TEST_CASE("TestCampaign5", "testAdaptive")
+{
+    Campaign c;
+    c.addParameter("U", 0, 1, 1.0 / 64);
+    REQUIRE(c.size() == 65);
+    int built = 0;
+    Campaign::ModelBuilder step = [&](const Campaign::Point &p) {
+        ++built;
+        return std::shared_ptr<void>(std::make_shared<StepModel>(p["U"]));
+    };
+    size_t used = c.runAdaptive(step, 10, "miss", 20, 0, 1, 2);
+    REQUIRE(used == size_t(built));
+    REQUIRE(used <= 20);
+
+    // the step is found at the resolution of the grid (between
+    // points 44 and 45), and the flat regions are left coarse
+    const std::vector<Campaign::Row> &t = c.getTable();
+    REQUIRE(!t[44].params.empty());
+    REQUIRE(!t[45].params.empty());
+    REQUIRE(t[44].values[0] == 0);
+    REQUIRE(t[45].values[0] == 1);
+    REQUIRE(!t[0].params.empty());
+    REQUIRE(!t[64].params.empty());
+    REQUIRE(t[10].params.empty());
+    REQUIRE(t[60].params.empty());
+
+    // the unsimulated points are not printed
+    std::ostringstream out;
+    c.print(out);
+    std::istringstream in(out.str());
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(in, line)) ++lines;
+    REQUIRE(lines == used + 1);
+
+    REQUIRE_THROWS_AS(c.runAdaptive(step, 10, "none", 20), const Campaign::Exc&);
+}
+
+TEST_CASE("TestCampaign6", "testSplitRuns")
+{
+    std::vector<std::vector<Campaign::Row> > tables;
+    for (int threads = 1; threads <= 3; threads += 2) {
+        Campaign c;
+        c.addParameter("max", std::vector<double>{10, 100});
+        c.addParameter("scale", 1, 3, 1);
+        c.setSplitRuns(true);
+        std::vector<Campaign::Progress> prog;
+        c.setProgress([&](const Campaign::Progress &p) { prog.push_back(p); });
+        c.run(build, 100, 4, threads);
+
+        // a task for each run of each point
+        REQUIRE(prog.size() == 24);
+        REQUIRE(prog[0].eta > 0);
+        REQUIRE(prog.back().done == 24);
+        REQUIRE(prog.back().total == 24);
+        REQUIRE(prog.back().eta == 0);
+        tables.push_back(c.getTable());
+    }
+
+    // the runs of a point are merged whatever thread ran them
+    const std::vector<Campaign::Row> &t = tables[0];
+    REQUIRE(t.size() == 6);
+    for (size_t k = 0; k < t.size(); ++k) {
+        REQUIRE(t[k].values == tables[1][k].values);
+        REQUIRE(t[k].conf == tables[1][k].conf);
+        REQUIRE(t[k].conf[0] > 0);
+        double mid = t[k].params[0] * t[k].params[1] / 2;
+        REQUIRE(std::abs(t[k].values[0] - mid) < mid / 10);
+    }
+
+    // with one run per point, the same results as without splitting
+    Campaign a, b;
+    a.addParameter("max", std::vector<double>{10, 100});
+    a.addParameter("scale", 1, 3, 1);
+    b.addParameter("max", std::vector<double>{10, 100});
+    b.addParameter("scale", 1, 3, 1);
+    b.setSplitRuns(true);
+    a.run(build, 100, 1, 2);
+    b.run(build, 100, 1, 2);
+    for (size_t k = 0; k < a.size(); ++k)
+        REQUIRE(a.getTable()[k].values == b.getTable()[k].values);
+}
+
+namespace {
+    // runs the calm point and the storm, and returns the events
+    // of the storm, that must be stopped
+    double runStorm(const Campaign::Budget &b, bool split,
+                    const Campaign::Row &free)
+    {
+        Campaign c;
+        c.addParameter("storm", std::vector<double>{0, 1});
+        c.setBudget(b);
+        c.setSplitRuns(split);
+        c.run(buildStorm, 100, 3, 2);
+
+        REQUIRE(c.getStoppedPoints() == 1);
+        const Campaign::Row &calm = c.getTable()[0];
+        const Campaign::Row &storm = c.getTable()[1];
+        REQUIRE(!calm.stopped);
+        REQUIRE(calm.values == free.values);
+        REQUIRE(storm.stopped);
+        return storm.values[0];
+    }
+}
+
+TEST_CASE("TestCampaign7", "testBudget")
+{
+    Campaign free;
+    free.addParameter("storm", std::vector<double>{0});
+    free.run(buildStorm, 100, 3, 1);
+    const Campaign::Row &calm = free.getTable()[0];
+
+    Campaign::Budget events;
+    events.events = 5000;
+    REQUIRE(runStorm(events, false, calm) == 5000);
+
+    // stopped at the first reading of the clock
+    Campaign::Budget rate;
+    rate.minRate = 1;
+    rate.grace = 0;
+    REQUIRE(runStorm(rate, false, calm) == 1024);
+
+    Campaign::Budget clock;
+    clock.seconds = 1e-9;
+    REQUIRE(runStorm(clock, false, calm) == 1024);
+
+    // each run has a third of the events
+    Campaign::Budget split;
+    split.events = 6000;
+    REQUIRE(runStorm(split, true, calm) == 2000);
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <cosim.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // every tick, sends back twice the input 0
+    class Controller : public Entity {
+    public:
+        GEvent<Controller> evt;
+        CoSimBridge &bridge;
+        std::vector<double> seen;
+
+        Controller(CoSimBridge &b) : Entity("controller"),
+                                     evt(this, &Controller::onEvt), bridge(b) {}
+        void onEvt(Event *) {
+            seen.push_back(bridge.get(0));
+            bridge.send(1, 2 * bridge.get(0));
+            evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { evt.post(0); }
+        void endRun() {}
+    };
+
+    // a plant that, at step k, sends the value k, in two samples
+    void plant(CoSimChannel *ch, int steps, int step,
+               std::vector<CoSimSample> *got)
+    {
+        CoSimPort p(*ch, CoSimChannel::PEER);
+        p.setTimeout(10);
+        for (int k = 0; k < steps; ++k) {
+            p.wait(int64_t(k) * step, *got);
+            CoSimSample a = {int64_t(k) * step, 0, 0, -1.0};
+            CoSimSample b = {int64_t(k) * step, 0, 0, double(k)};
+            p.send(a);
+            p.send(b);
+            p.publish(int64_t(k + 1) * step);
+        }
+        p.wait(int64_t(steps) * step, *got);
+    }
+}
+
+TEST_CASE("TestCoSim", "testBatchedSteps")
+{
+    // a small ring, so that the outputs of a step do not fit
+    CoSimChannel ch(4);
+    std::vector<CoSimSample> got;
+    std::thread peer(plant, &ch, 5, 10, &got);
+
+    CoSimBridge bridge(ch, 10, 1, "bridge");
+    bridge.setTimeout(10);
+    Controller c(bridge);
+
+    SIMUL.initSingleRun();
+    REQUIRE(bridge.run(50) == 50);
+    SIMUL.endSingleRun();
+    peer.join();
+
+    REQUIRE(bridge.getSteps() == 5);
+    REQUIRE(bridge.getReceived() == 10);
+    REQUIRE(bridge.getSent() == 50);
+
+    // the inputs hold for a whole step
+    REQUIRE(c.seen.size() == 50);
+    bool ok = true;
+    for (size_t i = 0; i < c.seen.size(); ++i)
+        ok = ok && c.seen[i] == double(i / 10);
+    REQUIRE(ok);
+
+    REQUIRE(got.size() == 50);
+    ok = true;
+    for (size_t i = 0; i < got.size(); ++i)
+        ok = ok && got[i].time == int64_t(i) && got[i].signal == 1 &&
+            got[i].value == 2.0 * (i / 10);
+    REQUIRE(ok);
+}
+
+TEST_CASE("TestCoSim2", "testSharedFile")
+{
+    CoSimChannel a("cosim.shm", 8, true);
+    CoSimChannel b("cosim.shm", 8, false);
+    REQUIRE_THROWS(CoSimChannel("cosim.shm", 16, false));
+
+    CoSimPort s(a, CoSimChannel::SIMULATION), p(b, CoSimChannel::PEER);
+    CoSimSample x = {3, 2, 0, 1.5};
+    REQUIRE(s.send(x));
+    std::vector<CoSimSample> in;
+    REQUIRE(p.receive(in) == 0);
+    s.publish(7);
+    REQUIRE(p.peerTime() == 7);
+    REQUIRE(p.receive(in) == 1);
+    REQUIRE(in[0].time == 3);
+    REQUIRE(in[0].value == 1.5);
+
+    for (int i = 0; i < 8; ++i) REQUIRE(s.send(x));
+    REQUIRE(!s.send(x));
+    std::remove("cosim.shm");
+}
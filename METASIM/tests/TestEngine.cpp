@@ -0,0 +1,132 @@
+#include <engine.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // a chain of events at decreasing distance, with a probe
+    class Chain : public Entity {
+    public:
+        GEvent<Chain> evt, other;
+        int n;
+        Tick last;
+
+        Chain() : Entity("chain"), evt(this, &Chain::onEvt),
+                  other(this, &Chain::onOther), n(0), last(0) {}
+        void onEvt(Event *) {
+            n++;
+            last = SIMUL.getTime();
+            other.post(SIMUL.getTime());
+            evt.post(SIMUL.getTime() + 1 + n % 5);
+        }
+        void onOther(Event *) {}
+        void newRun() { n = 0; last = 0; evt.post(0); }
+        void endRun() {}
+    };
+
+    class CountTrace : public Trace {
+    public:
+        int n;
+        CountTrace() : Trace("count", Trace::BINARY, false), n(0) {}
+        void record(Event *) { n++; }
+    };
+}
+
+TEST_CASE("TestEngine", "testPolicies")
+{
+    Chain c;
+    CountTrace tr;
+    c.evt.addTrace(&tr);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(1000);
+    SIMUL.endSingleRun();
+    int n = c.n;
+    Tick last = c.last;
+    REQUIRE(tr.n == n);
+
+    // the same run on a specialized engine, without the probes
+    typedef BasicEngine<RadixQueue, NoProbes, NoDebug> FastEngine;
+    REQUIRE_THROWS(FastEngine(SIMUL));
+    SIMUL.setEventQueue(EventQueue::RADIX_QUEUE);
+    tr.n = 0;
+    SIMUL.initSingleRun();
+    REQUIRE(FastEngine(SIMUL).run_to(1000) == 1000);
+    SIMUL.endSingleRun();
+    REQUIRE(c.n == n);
+    REQUIRE(c.last == last);
+    REQUIRE(tr.n == 0);
+
+    // the engines share the state of the simulation
+    SIMUL.initSingleRun();
+    FastEngine fast(SIMUL);
+    Tick t;
+    REQUIRE(fast.step(t));
+    REQUIRE(t == 0);
+    REQUIRE(SIMUL.getTime() == 0);
+    REQUIRE(fast.first() == &c.other);
+    REQUIRE(BasicEngine<>(SIMUL).batchStep(t));
+    REQUIRE(tr.n == 0);
+    SIMUL.run_to(1000);
+    SIMUL.endSingleRun();
+    REQUIRE(c.n == n);
+    REQUIRE(tr.n == n - 1);
+
+    SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+}
+
+namespace {
+    // a stat fed by a particle on the chain
+    class EvtCount : public StatCount {
+    public:
+        int probes;
+        EvtCount() : StatCount("events"), probes(0) {}
+        void probe(GEvent<Chain> &) { probes++; record(1); }
+    };
+}
+
+TEST_CASE("TestEngine2", "testLazyStats")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    Chain c;
+    EvtCount s;
+    new Particle<GEvent<Chain>, EvtCount>(&c.evt, &s);
+    CountTrace tr;
+    c.other.addTrace(&tr);
+
+    // the stats of the events are attached at the end of the
+    // transitory: the traces are not
+    BaseStat::setTransitory(100);
+    SIMUL.initSingleRun();
+    REQUIRE(!c.evt.hasProbes());
+    REQUIRE(c.other.hasProbes());
+    SIMUL.run_to(99);
+    REQUIRE(!c.evt.hasProbes());
+    // but the stat is there, and will turn on
+    REQUIRE(c.evt.hasAttachedProbes());
+    REQUIRE(s.probes == 0);
+    int n = c.n;
+    REQUIRE(tr.n == n);
+
+    SIMUL.run_to(1000);
+    REQUIRE(c.evt.hasProbes());
+    REQUIRE(s.probes == c.n - n);
+    REQUIRE(s.getValue() == s.probes);
+    SIMUL.endSingleRun();
+
+    // again at each run, and at once without a transitory
+    SIMUL.initSingleRun();
+    REQUIRE(!c.evt.hasProbes());
+    SIMUL.endSingleRun();
+    BaseStat::setTransitory(0);
+    SIMUL.initSingleRun();
+    REQUIRE(c.evt.hasProbes());
+    SIMUL.endSingleRun();
+}
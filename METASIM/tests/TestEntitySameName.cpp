@@ -1,6 +1,9 @@
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <vector>
 #include <entity.hpp>
+#include <simcontext.hpp>
 #include "myentity.hpp"
 #include <catch.hpp>
 
@@ -23,3 +26,94 @@ TEST_CASE("TestEntitySameName", "testName")
     p = Entity::getPointer( me->getID() + 1 );
     REQUIRE( p == 0 );
 }
+
+TEST_CASE("TestEntitySameName2", "testRegistry")
+{
+    // the name table grows and reuses the slots of the removed
+    // entities
+    std::vector<std::unique_ptr<MyEntity> > v;
+    for (int i = 0; i < 1000; ++i) {
+        std::stringstream ss;
+        ss << "e" << i;
+        v.push_back(std::unique_ptr<MyEntity>(new MyEntity(ss.str())));
+    }
+    for (int i = 0; i < 1000; i += 2) v[i].reset();
+
+    int found = 0;
+    for (int i = 0; i < 1000; ++i) {
+        std::stringstream ss;
+        ss << "e" << i;
+        Entity *p = Entity::_find(ss.str());
+        if ((i % 2 == 0 && p == 0) || (i % 2 == 1 && p == v[i].get()))
+            found++;
+    }
+    REQUIRE(found == 1000);
+
+    MyEntity again("e0");
+    REQUIRE(Entity::_find("e0") == &again);
+    REQUIRE(Entity::getPointer(v[1]->getID()) == v[1].get());
+
+    // anonymous entities are not indexed on request
+    Entity::setIndexAnonymous(false);
+    MyEntity anon("");
+    Entity::setIndexAnonymous(true);
+    REQUIRE(Entity::_find(anon.getName()) == 0);
+    REQUIRE(Entity::getPointer(anon.getID()) == &anon);
+}
+
+namespace {
+    class Counter : public Entity {
+    public:
+        struct State {
+            int count;
+            double sum;
+        } st;
+        int newRuns;
+
+        Counter(const std::string &n = "counter") : Entity(n), newRuns(0) {
+            st.count = 1;
+            st.sum = 0.5;
+            setResetState(&st, sizeof(st));
+        }
+        void newRun() { newRuns++; }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestEntitySameName3", "testResetState")
+{
+    Counter c;
+
+    Entity::callNewRun();
+    c.st.count = 10;
+    c.st.sum = 3;
+    Entity::callNewRun();
+
+    REQUIRE(c.st.count == 1);
+    REQUIRE(c.st.sum == 0.5);
+    REQUIRE(c.newRuns == 0);
+}
+
+TEST_CASE("TestEntitySameName4", "testResetStateChurn")
+{
+    EntityRegistry &reg = SimContext::current()->entities;
+    Counter c;
+    Entity::callNewRun();
+    size_t base = reg.stateBlocks();
+
+    // a model that replaces its entities at every run
+    for (int r = 0; r < 20; ++r) {
+        std::vector<std::unique_ptr<Counter> > tmp;
+        for (int i = 0; i < 5; ++i) tmp.emplace_back(new Counter(""));
+        Entity::callNewRun();
+        tmp[0]->st.count = 7;
+        Entity::callNewRun();
+        REQUIRE(tmp[0]->st.count == 1);
+        REQUIRE(reg.stateBlocks() <= 2 * (base + 5));
+    }
+
+    c.st.count = 3;
+    Entity::callNewRun();
+    REQUIRE(c.st.count == 1);
+    REQUIRE(c.st.sum == 0.5);
+}
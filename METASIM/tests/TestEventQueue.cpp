@@ -0,0 +1,437 @@
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <simul.hpp>
+#include <event.hpp>
+#include <eventpool.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    vector<int> trace;
+
+    class TraceEvt : public Event {
+        int _id;
+    public:
+        TraceEvt(int id, int p) : Event(p), _id(id) {}
+        virtual void doit() { trace.push_back(_id); }
+    };
+
+    // posts a pseudo-random pattern of events (with many ties on
+    // time and priority), drops some of them, and returns the order
+    // in which they are processed
+    vector<int> run_pattern(EventQueue::Type t)
+    {
+        SIMUL.setEventQueue(t);
+        trace.clear();
+
+        vector<TraceEvt *> evts;
+        unsigned long x = 12345;
+        for (int i = 0; i < 500; ++i) {
+            x = (x * 1103515245 + 12345) % 2147483648UL;
+            evts.push_back(new TraceEvt(i, Event::_DEFAULT_PRIORITY + x % 3));
+            evts.back()->post(Tick(int64_t((x >> 8) % 200)));
+        }
+        for (int i = 0; i < 500; i += 7) evts[i]->drop();
+
+        SIMUL.run_to(1000);
+        SIMUL.clearEventQueue();
+
+        for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+        SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+        return trace;
+    }
+}
+
+TEST_CASE("TestEventQueue", "testBackends")
+{
+    vector<int> ref = run_pattern(EventQueue::SET_QUEUE);
+    REQUIRE(ref.size() == 500 - 72);
+
+    REQUIRE(run_pattern(EventQueue::HEAP_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::CALENDAR_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::LAZY_HEAP_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::RADIX_QUEUE) == ref);
+
+    // a horizon shorter than the pattern, so that the events also
+    // go through the heap of the wheel
+    WheelEventQueue::setDefaultGeometry(3, 16);
+    REQUIRE(run_pattern(EventQueue::WHEEL_QUEUE) == ref);
+    WheelEventQueue::setDefaultGeometry(1, 4096);
+    REQUIRE(run_pattern(EventQueue::WHEEL_QUEUE) == ref);
+}
+
+TEST_CASE("TestEventQueue5", "testBatchStepping")
+{
+    vector<int> ref = run_pattern(EventQueue::SET_QUEUE);
+
+    // batches of events with the same time and priority must be
+    // processed in the same order as single steps
+    SIMUL.setBatchStepping(true);
+    REQUIRE(run_pattern(EventQueue::SET_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::HEAP_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::WHEEL_QUEUE) == ref);
+    REQUIRE(run_pattern(EventQueue::RADIX_QUEUE) == ref);
+    SIMUL.setBatchStepping(false);
+}
+
+TEST_CASE("TestEventQueue4", "testTombstones")
+{
+    SIMUL.setEventQueue(EventQueue::LAZY_HEAP_QUEUE);
+    trace.clear();
+    {
+        TraceEvt a(1, Event::_DEFAULT_PRIORITY), b(2, Event::_DEFAULT_PRIORITY);
+        TraceEvt *c = new TraceEvt(3, Event::_DEFAULT_PRIORITY);
+
+        // drop and re-post many times, as a preempted instruction does
+        for (int i = 0; i < 100; ++i) {
+            a.drop(); a.post(50 + i % 5);
+            c->drop(); c->post(60);
+        }
+        b.post(10);
+        // destroying an event with tombstones must not leave
+        // dangling entries in the queue
+        delete c;
+
+        REQUIRE(Event::getFirst() == &b);
+        SIMUL.run_to(100);
+    }
+    REQUIRE(trace.size() == 2);
+    REQUIRE(trace[0] == 2);
+    REQUIRE(trace[1] == 1);
+    SIMUL.clearEventQueue();
+    SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+}
+
+TEST_CASE("TestEventQueue2", "testSwitchBackend")
+{
+    SIMUL.setEventQueue(EventQueue::HEAP_QUEUE);
+    TraceEvt a(1, Event::_DEFAULT_PRIORITY), b(2, Event::_DEFAULT_PRIORITY);
+    a.post(20);
+    b.post(10);
+
+    // the queued events are moved to the new backend
+    SIMUL.setEventQueue(EventQueue::CALENDAR_QUEUE);
+    REQUIRE(Event::getFirst() == &b);
+    b.drop();
+    REQUIRE(Event::getFirst() == &a);
+
+    SIMUL.clearEventQueue();
+    REQUIRE(Event::getFirst() == NULL);
+    SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+}
+
+TEST_CASE("TestEventQueue7", "testRadixBeforeMinimum")
+{
+    SIMUL.setEventQueue(EventQueue::RADIX_QUEUE);
+    trace.clear();
+    TraceEvt a(1, Event::_DEFAULT_PRIORITY), b(2, Event::_DEFAULT_PRIORITY);
+    TraceEvt c(3, Event::_DEFAULT_PRIORITY), d(4, Event::_DEFAULT_PRIORITY);
+    a.post(40);
+    b.post(Tick(int64_t(1) << 40));
+    SIMUL.initSingleRun();
+
+    // the first event is at 40, the clock stops at 35: the next
+    // posts are before the last minimum
+    REQUIRE(SIMUL.run_to(35) == 35);
+    c.post(36);
+    d.post(1000);
+    REQUIRE(Event::getFirst() == &c);
+    SIMUL.run_to(2000);
+    REQUIRE(Event::getFirst() == &b);
+    SIMUL.endSingleRun();
+    REQUIRE(trace.size() == 3);
+    REQUIRE(trace[0] == 3);
+    REQUIRE(trace[1] == 1);
+    REQUIRE(trace[2] == 4);
+    SIMUL.clearEventQueue();
+    SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+}
+
+TEST_CASE("TestEventQueue3", "testPackedKey")
+{
+    // the packed key must order negative priorities and large
+    // times exactly as the (time, priority, order) triple
+    REQUIRE(bool(makeEventKey(5, -1, 100) < makeEventKey(5, 0, 1)));
+    REQUIRE(bool(makeEventKey(5, 3, 1) < makeEventKey(5, 3, 2)));
+    REQUIRE(bool(makeEventKey(4, 100, 500) < makeEventKey(5, -100, 0)));
+    REQUIRE(bool(makeEventKey(MAXTICK - 1, 0, 0) < makeEventKey(MAXTICK, 0, 0)));
+
+    TraceEvt a(1, Event::_DEFAULT_PRIORITY), b(2, Event::_DEFAULT_PRIORITY);
+    a.post(10);
+    b.setPriority(Event::_IMMEDIATE_PRIORITY);
+    b.post(10);
+    REQUIRE(Event::getFirst() == &b);
+    SIMUL.clearEventQueue();
+}
+
+namespace {
+    struct Chain {
+        int count;
+        Chain() : count(0) {}
+        void onEvt(Event *) {
+            if (++count < 100)
+                newGEvent(this, &Chain::onEvt)->post(SIMUL.getTime() + 1, true);
+        }
+    };
+}
+
+TEST_CASE("TestEventQueue6", "testEventPool")
+{
+    Chain c;
+    GEvent<Chain> *e = newGEvent(&c, &Chain::onEvt);
+    e->post(1, true);
+    SIMUL.run_to(1000);
+    REQUIRE(c.count == 100);
+
+    // the processed events are recycled, not deleted
+    REQUIRE(EventPool::getFree<GEvent<Chain> >() > 0);
+    size_t nfree = EventPool::getFree<GEvent<Chain> >();
+    GEvent<Chain> *f = newGEvent(&c, &Chain::onEvt);
+    REQUIRE(EventPool::getFree<GEvent<Chain> >() == nfree - 1);
+    f->dispose();
+    REQUIRE(EventPool::getFree<GEvent<Chain> >() == nfree);
+    SIMUL.clearEventQueue();
+}
+
+namespace {
+    class MsgEvt : public Event {
+    public:
+        int id;
+        MsgEvt(int i) : Event(), id(i) {}
+        virtual void doit() {}
+    };
+
+    struct MsgCounter {
+        int count, sum;
+        MsgCounter() : count(0), sum(0) {}
+        void probe(MsgEvt &e) { ++count; sum += e.id; }
+    };
+}
+
+TEST_CASE("TestEventQueue8", "testProbeGroup")
+{
+    MsgCounter cnt;
+    ProbeGroup g;
+    new GroupParticle<MsgEvt, MsgCounter>(&g, &cnt);
+
+    MsgEvt proto(3);
+    REQUIRE(!proto.hasProbes());
+    proto.setProbeGroup(&g);
+    REQUIRE(proto.hasProbes());
+
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 50; ++i) {
+            MsgEvt *e = EventPool::create<MsgEvt>(proto);
+            REQUIRE(e->getProbeGroup() == &g);
+            e->post(SIMUL.getTime() + i, true);
+        }
+        // the second round only takes clones from the free list
+        if (round == 1) REQUIRE(EventPool::getFree<MsgEvt>() == 0);
+        SIMUL.run_to(SIMUL.getTime() + 100);
+    }
+    REQUIRE(cnt.count == 100);
+    REQUIRE(cnt.sum == 300);
+    REQUIRE(EventPool::getFree<MsgEvt>() == 50);
+
+    proto.setProbeGroup(NULL);
+    REQUIRE(!proto.hasProbes());
+    SIMUL.clearEventQueue();
+}
+
+TEST_CASE("TestEventQueue9", "testBulkClear")
+{
+    for (int t = 0; t <= EventQueue::RADIX_QUEUE; ++t) {
+        SIMUL.setEventQueue(EventQueue::Type(t));
+        vector<TraceEvt *> evts;
+        for (int i = 0; i < 50; ++i) {
+            evts.push_back(new TraceEvt(i, Event::_DEFAULT_PRIORITY));
+            evts.back()->post(Tick(i % 7));
+        }
+        for (int i = 0; i < 20; ++i)
+            EventPool::create<TraceEvt>(i, int(Event::_DEFAULT_PRIORITY))->post(Tick(i), true);
+        size_t nfree = EventPool::getFree<TraceEvt>();
+
+        // the queue is emptied at once, the disposable events go
+        // back to their pool, the others are not queued anymore
+        SIMUL.clearEventQueue();
+        REQUIRE(Event::getFirst() == NULL);
+        REQUIRE(EventPool::getFree<TraceEvt>() == nfree + 20);
+        int queued = 0;
+        for (size_t i = 0; i < evts.size(); ++i) if (evts[i]->isInQueue()) ++queued;
+        REQUIRE(queued == 0);
+
+        // and they can be posted (and dropped) again
+        trace.clear();
+        evts[3]->post(5);
+        evts[4]->post(2);
+        evts[5]->post(1);
+        evts[5]->drop();
+        evts[5]->drop();
+        SIMUL.run_to(10);
+        REQUIRE(trace.size() == 2);
+        REQUIRE(trace[0] == 4);
+        REQUIRE(trace[1] == 3);
+
+        SIMUL.clearEventQueue();
+        for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+    }
+    SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+}
+
+namespace {
+    // an event that posts itself again after its delay: a fixed
+    // period, or a pseudo-random one over many orders of magnitude; with a
+    // timeout, it also posts a far event and drops it at the next
+    // activation, as the budget events of the servers
+    class RepostEvt : public Event {
+        int _id;
+        int64_t _period;
+        bool _wide;
+        TraceEvt *_timeout;
+        unsigned long _x;
+    public:
+        RepostEvt(int id, int64_t period, bool wide, bool timeout) :
+            Event(), _id(id), _period(period), _wide(wide),
+            _timeout(timeout ? new TraceEvt(-1, Event::_DEFAULT_PRIORITY) : 0),
+            _x(id + 1) {}
+        ~RepostEvt() { delete _timeout; }
+        virtual void doit() {
+            trace.push_back(_id);
+            int64_t d = _period;
+            if (_wide) {
+                _x = (_x * 6364136223846793005ULL + 1442695040888963407ULL);
+                // from 1 to 2^36, as many short as long ones
+                d = 1 + int64_t((_x >> 24) % (1ULL << ((_x >> 60) * 2 + 6)));
+            }
+            post(SIMUL.getTime() + Tick(d));
+            if (_timeout) {
+                _timeout->drop();
+                _timeout->post(SIMUL.getTime() + Tick(1000000));
+            }
+        }
+    };
+
+    vector<int> run_reposts(EventQueue::Type t, bool wide, bool timeout,
+                            EventQueue::Type &chosen)
+    {
+        SIMUL.setEventQueue(t);
+        trace.clear();
+        vector<RepostEvt *> evts;
+        for (int i = 0; i < 64; ++i) {
+            evts.push_back(new RepostEvt(i, 10 + 3 * i, wide, timeout));
+            evts.back()->post(Tick(i));
+        }
+        for (int i = 0; i < 5000; ++i) SIMUL.sim_step();
+        chosen = Event::getQueueType();
+
+        SIMUL.clearEventQueue();
+        for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+        SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+        return trace;
+    }
+}
+
+TEST_CASE("TestEventQueue10", "testAdaptiveQueue")
+{
+    vector<int> ref = run_pattern(EventQueue::SET_QUEUE);
+
+    // the backend changes while the events are posted, or never
+    AdaptiveEventQueue::setDefaultWindow(100);
+    REQUIRE(run_pattern(EventQueue::ADAPTIVE_QUEUE) == ref);
+    AdaptiveEventQueue::setDefaultWindow(100000);
+    REQUIRE(run_pattern(EventQueue::ADAPTIVE_QUEUE) == ref);
+
+    // the backend depends on the workload, the order does not
+    AdaptiveEventQueue::setDefaultWindow(1000);
+    EventQueue::Type chosen;
+    for (int w = 0; w < 3; ++w) {
+        bool wide = w == 1, timeout = w == 2;
+        vector<int> r = run_reposts(EventQueue::SET_QUEUE, wide, timeout, chosen);
+        REQUIRE(chosen == EventQueue::SET_QUEUE);
+        REQUIRE(run_reposts(EventQueue::ADAPTIVE_QUEUE, wide, timeout, chosen) == r);
+        if (w == 0) REQUIRE(chosen == EventQueue::WHEEL_QUEUE);
+        if (w == 1) REQUIRE(chosen == EventQueue::RADIX_QUEUE);
+        if (w == 2) REQUIRE(chosen == EventQueue::HEAP_QUEUE);
+    }
+
+    AdaptiveEventQueue::setDefaultWindow(10000);
+}
+
+namespace {
+    /// processes the events of _now, and drops the second one
+    class NowEvt : public Event {
+        vector<Event *> _now;
+    public:
+        NowEvt(const vector<Event *> &now) : Event(-2), _now(now) {}
+        virtual void doit() {
+            trace.push_back(0);
+            for (size_t i = 0; i < _now.size(); ++i) _now[i]->process();
+            _now[1]->drop();
+        }
+    };
+
+    vector<int> run_immediate(EventQueue::Type t, size_t &lane)
+    {
+        SIMUL.setEventQueue(t);
+        trace.clear();
+
+        TraceEvt x(1, -1), y(2, Event::_IMMEDIATE_PRIORITY);
+        TraceEvt d(3, Event::_DEFAULT_PRIORITY);
+        TraceEvt p1(4, Event::_DEFAULT_PRIORITY), p2(5, Event::_DEFAULT_PRIORITY);
+        TraceEvt p3(6, Event::_DEFAULT_PRIORITY);
+        vector<Event *> now;
+        now.push_back(&p1);
+        now.push_back(&p2);
+        now.push_back(&p3);
+        NowEvt h(now);
+
+        d.post(10);
+        y.post(10);
+        x.post(10);
+        h.post(10);
+        SIMUL.sim_step();
+        lane = SimContext::current()->lane.size();
+        SIMUL.run_to(20);
+
+        SIMUL.clearEventQueue();
+        SIMUL.setEventQueue(EventQueue::SET_QUEUE);
+        return trace;
+    }
+}
+
+TEST_CASE("TestEventQueue11", "testImmediateLane")
+{
+    // the events processed now go in the lane, and are extracted
+    // after those of the backend with a smaller key
+    size_t lane;
+    vector<int> r = run_immediate(EventQueue::SET_QUEUE, lane);
+    REQUIRE(lane == 2);
+    int expected[] = { 0, 1, 2, 4, 6, 3 };
+    REQUIRE(r == vector<int>(expected, expected + 6));
+    REQUIRE(SimContext::current()->lane.empty());
+
+    REQUIRE(run_immediate(EventQueue::RADIX_QUEUE, lane) == r);
+    REQUIRE(run_immediate(EventQueue::LAZY_HEAP_QUEUE, lane) == r);
+
+    // a restored checkpoint puts the events of the lane back
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    TraceEvt a(7, Event::_DEFAULT_PRIORITY);
+    TraceEvt b(8, Event::_DEFAULT_PRIORITY);
+    b.post(5);
+    a.process();
+    Checkpoint c;
+    SIMUL.checkpoint(c);
+    a.drop();
+    SIMUL.restore(c);
+    REQUIRE(Event::getFirst() == &a);
+    trace.clear();
+    SIMUL.run_to(10);
+    REQUIRE(trace.size() == 2);
+    REQUIRE(trace[0] == 7);
+    SIMUL.clearEventQueue();
+}
@@ -0,0 +1,59 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <factory.hpp>
+
+#include "catch.hpp"
+
+using namespace std;
+
+namespace {
+    struct Shape {
+        int id;
+        string par;
+        Shape(int i, const string &p) : id(i), par(p) {}
+    };
+
+    template <int N>
+    Shape *makeShape(vector<string> &par)
+    {
+        return new Shape(N, par.empty() ? "" : par[0]);
+    }
+}
+
+TEST_CASE("Factory lookup in the frozen table")
+{
+    genericFactory<Shape> &f = genericFactory<Shape>::instance();
+
+    f.regCreateFn("circle", makeShape<1>);
+    f.regCreateFn("square", makeShape<2>);
+
+    vector<string> par(1, "red");
+    unique_ptr<Shape> s = f.create("circle", par);
+    REQUIRE(s.get() != 0);
+    REQUIRE(s->id == 1);
+    REQUIRE(s->par == "red");
+
+    REQUIRE(f.create("triangle", par).get() == 0);
+    REQUIRE(f.find("") == 0);
+
+    // registering again unfreezes the table: many keys, and one
+    // key replaced
+    for (int i = 0; i < 200; ++i) {
+        stringstream ss;
+        ss << "shape" << i;
+        f.regCreateFn(ss.str(), makeShape<3>);
+    }
+    f.regCreateFn("square", makeShape<4>);
+
+    REQUIRE(f.create("square", par)->id == 4);
+    REQUIRE(f.create("circle", par)->id == 1);
+    for (int i = 0; i < 200; ++i) {
+        stringstream ss;
+        ss << "shape" << i;
+        REQUIRE(f.find(ss.str()) == &makeShape<3>);
+    }
+    REQUIRE(f.find("shape200") == 0);
+}
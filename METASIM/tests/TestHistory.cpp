@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+
+#include <history.hpp>
+
+#include "catch.hpp"
+
+TEST_CASE("TestHistory", "testRing")
+{
+    history<int> h(3);
+    REQUIRE(h.count() == 0);
+    h.push(1);
+    h.push(2);
+    REQUIRE(h.count() == 2);
+    REQUIRE(!h.full());
+    REQUIRE(h[0] == 2);
+    REQUIRE(h[1] == 1);
+    h.push(3);
+    h.push(4);
+    REQUIRE(h.full());
+    REQUIRE(h.size() == 3);
+    REQUIRE(h[0] == 4);
+    REQUIRE(h[2] == 2);
+    REQUIRE(h.oldest() == 2);
+    h.clear();
+    REQUIRE(h.count() == 0);
+}
+
+TEST_CASE("TestHistory2", "testWindow")
+{
+    const int N = 7;
+    history_window<long> w(N);
+    std::deque<long> ref;
+
+    srand(3);
+    for (int i = 0; i < 1000; ++i) {
+        long v = rand() % 100 - 50;
+        w.push(v);
+        ref.push_back(v);
+        if (ref.size() > size_t(N)) ref.pop_front();
+
+        long sum = 0;
+        for (size_t j = 0; j < ref.size(); ++j) sum += ref[j];
+        REQUIRE(w.count() == ref.size());
+        REQUIRE(w.sum() == sum);
+        REQUIRE(w.min() == *std::min_element(ref.begin(), ref.end()));
+        REQUIRE(w.max() == *std::max_element(ref.begin(), ref.end()));
+        REQUIRE(w[0] == v);
+    }
+    REQUIRE((w.mean() == double(w.sum()) / N));
+
+    w.clear();
+    REQUIRE(w.empty());
+    w.push(5);
+    REQUIRE(w.min() == 5);
+    REQUIRE(w.max() == 5);
+    REQUIRE(w.sum() == 5);
+
+    // the sum of doubles does not drift
+    history_window<double> d(10);
+    for (int i = 0; i < 100000; ++i) d.push(0.1 * (i % 10));
+    REQUIRE((d.sum() > 4.5 - 1e-9));
+    REQUIRE((d.sum() < 4.5 + 1e-9));
+}
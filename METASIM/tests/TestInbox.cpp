@@ -0,0 +1,104 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gevent.hpp>
+#include <inbox.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // keeps the simulation going, one tick at a time, until
+    // enough actions have been executed
+    class Ticker : public Entity {
+    public:
+        GEvent<Ticker> evt;
+        std::atomic<int> &done;
+        int target;
+
+        Ticker(std::atomic<int> &d, int t) : Entity("ticker"), 
+            evt(this, &Ticker::onTick), done(d), target(t) {}
+        void onTick(Event *) {
+            if (done.load() < target) evt.post(SIMUL.getTime() + 1);
+            else std::this_thread::yield();
+        }
+        void newRun() { evt.post(0); }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestInbox", "testProducers")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    const int THREADS = 4, N = 20000;
+    std::atomic<int> done(0);
+    std::vector<std::vector<int> > seen(THREADS);
+    Ticker ticker(done, THREADS * N);
+
+    EventInbox in;
+    SIMUL.setInbox(&in);
+    SIMUL.initSingleRun();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < THREADS; ++p)
+        producers.push_back(std::thread([&, p]() {
+                    for (int i = 0; i < N; ++i)
+                        in.post([&, p, i]() { seen[p].push_back(i); done++; });
+                }));
+    SIMUL.run_to(Tick(int64_t(1) << 40));
+    for (int p = 0; p < THREADS; ++p) producers[p].join();
+    SIMUL.endSingleRun();
+    SIMUL.setInbox(NULL);
+
+    REQUIRE(done.load() == THREADS * N);
+    REQUIRE(in.getReceived() == uint64_t(THREADS * N));
+    REQUIRE(in.getLate() == 0);
+    REQUIRE(in.empty());
+    for (int p = 0; p < THREADS; ++p) {
+        REQUIRE(seen[p].size() == size_t(N));
+        bool ordered = true;
+        for (int i = 0; i < N; ++i) ordered = ordered && seen[p][i] == i;
+        REQUIRE(ordered);
+    }
+}
+
+TEST_CASE("TestInbox2", "testTimes")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    std::atomic<int> done(0);
+    Ticker ticker(done, 2);
+    std::vector<Tick> at;
+
+    EventInbox in;
+    SIMUL.setInbox(&in);
+    SIMUL.initSingleRun();
+    in.post(50, [&]() { at.push_back(SIMUL.getTime()); });
+    SIMUL.run_to(100);
+    REQUIRE(at.size() == 1);
+    REQUIRE(at[0] == Tick(50));
+    REQUIRE(in.getLate() == 0);
+
+    // in the past: executed at once
+    in.post(10, [&]() { at.push_back(SIMUL.getTime()); done = 2; });
+    SIMUL.sim_step();
+    REQUIRE(at.size() == 2);
+    REQUIRE(at[1] == Tick(100));
+    REQUIRE(in.getLate() == 1);
+
+    // discarded with the inbox
+    EventInbox *other = new EventInbox();
+    other->post(200, [&]() { at.push_back(0); });
+    delete other;
+    SIMUL.run_to(300);
+    SIMUL.endSingleRun();
+    SIMUL.setInbox(NULL);
+    REQUIRE(at.size() == 2);
+}
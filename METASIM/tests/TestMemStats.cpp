@@ -0,0 +1,116 @@
+#include <sstream>
+
+#include <arena.hpp>
+#include <eventpool.hpp>
+#include <eventqueue.hpp>
+#include <gevent.hpp>
+#include <memstats.hpp>
+#include <simul.hpp>
+#include <simcontext.hpp>
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Sink : public Entity {
+    public:
+        Sink() : Entity("sink") {}
+        void onEvent(Event *) {}
+        void newRun() {}
+        void endRun() {}
+    };
+
+    DECL_MEM_CATEGORY(TestMem, "test");
+}
+
+TEST_CASE("Memory accounting by category")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    Sink s;
+    SIMUL.setEventQueue(EventQueue::HEAP_QUEUE);
+
+    int64_t events = MemStats::getBytes("events");
+    int64_t queue = MemStats::getBytes("event queue");
+
+    std::vector<GEvent<Sink> *> v;
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(new GEvent<Sink>(&s, &Sink::onEvent));
+        v.back()->post(i);
+    }
+    int64_t d = MemStats::getBytes("events") - events;
+    REQUIRE(d == int64_t(100 * sizeof(GEvent<Sink>)));
+    d = MemStats::getBytes("event queue") - queue;
+    REQUIRE(d >= int64_t(100 * sizeof(Event *)));
+
+    for (size_t i = 0; i < v.size(); ++i) delete v[i];
+    REQUIRE(MemStats::getBytes("events") == events);
+
+    {
+        std::vector<int, TrackedAllocator<int, TestMem> > w(1000);
+        REQUIRE(MemStats::getBytes("test") == int64_t(1000 * sizeof(int)));
+    }
+    REQUIRE(MemStats::getBytes("test") == 0);
+    REQUIRE(TestMem::counters().peak.load() == int64_t(1000 * sizeof(int)));
+
+    std::stringstream ss;
+    MemStats::print(ss);
+    REQUIRE(ss.str().find("event queue") != std::string::npos);
+    REQUIRE(ss.str().find("test") != std::string::npos);
+    REQUIRE(ss.str().find("Total") != std::string::npos);
+}
+
+#ifdef __linux__
+TEST_CASE("Memory on huge pages")
+{
+    REQUIRE(HugePages::map(100, TestMem::counters()) == NULL);
+
+    HugePages::setMode(HugePages::EXPLICIT);
+    char *p = static_cast<char *>(HugePages::map(100, TestMem::counters()));
+    REQUIRE(p != NULL);
+    REQUIRE((reinterpret_cast<uintptr_t>(p) % HugePages::SIZE == 0));
+    p[0] = p[HugePages::SIZE - 1] = 1;
+    REQUIRE(HugePages::owns(p + HugePages::SIZE - 1));
+    REQUIRE((TestMem::counters().huge.load() + TestMem::counters().thp.load() 
+             <= int64_t(HugePages::SIZE)));
+    int local = 0;
+    REQUIRE(!HugePages::owns(&local));
+    REQUIRE(HugePages::unmap(p, 100, TestMem::counters()));
+    REQUIRE(!HugePages::owns(p));
+    REQUIRE(!HugePages::unmap(p, 100, TestMem::counters()));
+    REQUIRE(TestMem::counters().huge.load() == 0);
+    REQUIRE(TestMem::counters().thp.load() == 0);
+
+    {
+        std::vector<int, TrackedAllocator<int, TestMem> > w(1 << 20);
+        REQUIRE(HugePages::owns(&w[0]));
+        std::vector<int, TrackedAllocator<int, TestMem> > small(10);
+        REQUIRE(!HugePages::owns(&small[0]));
+    }
+    REQUIRE(MemStats::getBytes("test") == 0);
+
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        Sink s;
+        int *i = ctx.arena().create<int>(3);
+        REQUIRE(HugePages::owns(i));
+
+        // pooled events on huge pages, given back to the pool
+        // and deleted
+        std::vector<GEvent<Sink> *> v;
+        for (int k = 0; k < 1000; ++k) {
+            v.push_back(newGEvent(&s, &Sink::onEvent));
+            REQUIRE(HugePages::owns(v.back()));
+        }
+        delete v.back();
+        v.pop_back();
+        SIMUL.initSingleRun();
+        for (size_t k = 0; k < v.size(); ++k) v[k]->post(int(k), true);
+        SIMUL.run_to(2000);
+        SIMUL.endSingleRun();
+        REQUIRE(EventPool::getFree<GEvent<Sink> >() == 999);
+    }
+    HugePages::setMode(HugePages::OFF);
+}
+#endif
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <sstream>
+
+#include <entity.hpp>
+#include <event.hpp>
+#include <gevent.hpp>
+#include <pacer.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // two events every 3 ticks
+    class Ticker : public Entity {
+    public:
+        GEvent<Ticker> evt, other;
+        int n;
+
+        Ticker() : Entity("ticker"), evt(this, &Ticker::onEvt),
+                   other(this, &Ticker::onOther), n(0) {}
+        void onEvt(Event *) {
+            n++;
+            other.post(SIMUL.getTime());
+            evt.post(SIMUL.getTime() + 3);
+        }
+        void onOther(Event *) {}
+        void newRun() { n = 0; evt.post(0); }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestPacer", "testWallClock")
+{
+    REQUIRE_THROWS(WallClockPacer(0));
+
+    Ticker t;
+    WallClockPacer p(1000000);    // 1 ms per tick
+    p.setSpin(200000);
+    p.setTolerance(1000000000);
+    SIMUL.setPacer(&p);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SIMUL.initSingleRun();
+    SIMUL.run_to(30);
+    SIMUL.endSingleRun();
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    SIMUL.setPacer(NULL);
+
+    // instants 0, 3, ..., 30, one wait each
+    REQUIRE(t.n == 11);
+    REQUIRE(p.getInstants() == 11);
+    REQUIRE(ms >= 30);
+    REQUIRE(p.getLateInstants() == 0);
+    REQUIRE(p.getMaxLateness() >= 0);
+    REQUIRE(p.getMeanLateness() <= p.getMaxLateness());
+
+    std::ostringstream os;
+    p.write(os);
+    REQUIRE(os.str().substr(0, 11) == "instants 11");
+
+    p.clear();
+    REQUIRE(p.getInstants() == 0);
+}
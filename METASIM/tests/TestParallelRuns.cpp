@@ -0,0 +1,201 @@
+#include <memory>
+
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+#include <topology.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Sampler : public Entity {
+        GEvent<Sampler> _evt;
+        UniformVar _var;
+        StatMean &_stat;
+    public:
+        Sampler(StatMean &s) : Entity("sampler"),
+                               _evt(this, &Sampler::onEvt),
+                               _var(0, 100), _stat(s) {}
+        void onEvt(Event *) {
+            _stat.record(_var.get());
+            _evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+
+    struct Model {
+        StatMean stat;
+        Sampler sampler;
+        Model() : stat("mean"), sampler(stat) {}
+    };
+
+    std::shared_ptr<void> build() { return std::make_shared<Model>(); }
+
+    double run_parallel(int threads)
+    {
+        Model m;
+        RandomVar::init(12345);
+        SIMUL.run(100, 8, threads, build);
+        REQUIRE(m.stat.getExpNum() == 8);
+        return m.stat.getMean();
+    }
+}
+
+TEST_CASE("TestParallelRuns", "testSameResults")
+{
+    // the replicas do not depend on the number of threads
+    double m1 = run_parallel(1);
+    double m4 = run_parallel(4);
+    REQUIRE(m1 == m4);
+    REQUIRE(m1 > 0);
+    REQUIRE(m1 < 100);
+}
+
+TEST_CASE("TestParallelRuns2", "testSequentialStreams")
+{
+    double mp = run_parallel(4);
+
+    // a sequential run with replica streams gives the same results
+    Model m;
+    RandomVar::init(12345);
+    SIMUL.setReplicaStreams(true);
+    SIMUL.run(100, 8);
+    SIMUL.setReplicaStreams(false);
+    REQUIRE(m.stat.getMean() == mp);
+}
+
+namespace {
+    double run_forked(int procs)
+    {
+        Model m;
+        RandomVar::init(12345);
+        BaseStat::setTransitory(20);
+        SIMUL.runForked(100, 8, procs);
+        BaseStat::setTransitory(0);
+        REQUIRE(m.stat.getExpNum() == 8);
+        return m.stat.getMean();
+    }
+}
+
+TEST_CASE("TestParallelRuns3", "testForkedRuns")
+{
+    // the replicas share the warm-up, and do not depend on the
+    // number of processes
+    double m1 = run_forked(1);
+    double m4 = run_forked(4);
+    REQUIRE(m1 == m4);
+    REQUIRE(m1 > 0);
+    REQUIRE(m1 < 100);
+}
+
+namespace {
+    int run_precision(int threads, double &mean)
+    {
+        Model m;
+        RandomVar::init(12345);
+        std::vector<BaseStat *> stats(1, &m.stat);
+        int n = SIMUL.runToPrecision(100, stats, 0.02, threads, build);
+        REQUIRE(m.stat.getExpNum() == size_t(n));
+        REQUIRE(m.stat.getConfInterval() > 0);
+        REQUIRE(m.stat.getConfInterval() <= 0.02 * m.stat.getMean());
+        mean = m.stat.getMean();
+        return n;
+    }
+}
+
+TEST_CASE("TestParallelRuns4", "testRunToPrecision")
+{
+    // more than the 30 runs of the old table of the t-student
+    double m1, m4;
+    int n1 = run_precision(1, m1);
+    int n4 = run_precision(4, m4);
+    REQUIRE(n1 > 30);
+    REQUIRE(n1 == n4);
+    REQUIRE(m1 == m4);
+
+    Model m;
+    std::vector<BaseStat *> stats(1, &m.stat);
+    REQUIRE(SIMUL.runToPrecision(100, stats, 1e-6, 0, build, 5, 12) == 12);
+}
+
+namespace {
+    class HistSampler : public Entity {
+        GEvent<HistSampler> _evt;
+        UniformVar _var;
+        StatHistogram &_stat;
+    public:
+        HistSampler(StatHistogram &s) : Entity("sampler"),
+                                        _evt(this, &HistSampler::onEvt),
+                                        _var(0, 100), _stat(s) {}
+        void onEvt(Event *) {
+            _stat.record(_var.get());
+            _evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+
+    struct HistModel {
+        StatHistogram stat;
+        HistSampler sampler;
+        HistModel() : stat("hist", 0.9), sampler(stat) {}
+    };
+
+    std::shared_ptr<void> buildHist() { return std::make_shared<HistModel>(); }
+
+    void run_merged(int threads, double &p90, double &mean)
+    {
+        HistModel m;
+        RandomVar::init(12345);
+        SIMUL.run(100, 8, threads, buildHist);
+        // the accumulators of all the replicas are merged
+        REQUIRE(m.stat.getCount() == 8 * 101);
+        REQUIRE(m.stat.getValue() == m.stat.getQuantile(0.9));
+        p90 = m.stat.getValue();
+        mean = m.stat.getMean();
+    }
+}
+
+TEST_CASE("TestParallelRuns5", "testMergedAccumulators")
+{
+    double p1, p4, m1, m4;
+    run_merged(1, p1, m1);
+    run_merged(4, p4, m4);
+    REQUIRE(p1 == p4);
+    REQUIRE(p1 > 80);
+    REQUIRE(p1 < 100);
+    REQUIRE(m1 == m4);
+}
+
+TEST_CASE("TestParallelRuns6", "testPinnedWorkers")
+{
+    const Topology &t = Topology::get();
+    REQUIRE(t.getNodes() >= 1);
+    REQUIRE(t.getDefaultThreads() >= 1);
+    size_t cpus = 0;
+    for (size_t n = 0; n < t.getNodes(); ++n) {
+        cpus += t.getCpus(n).size();
+        REQUIRE(t.getNodeOf(t.getCpus(n)[0]) == n);
+    }
+    REQUIRE(cpus == t.getCpuCount());
+    // the workers go round robin over the nodes
+    REQUIRE(t.getWorkerNode(t.getNodes()) == 0);
+    REQUIRE(t.getNodeOf(t.getWorkerCpu(1)) == t.getWorkerNode(1));
+
+    // pinning does not change the results
+    double m = run_parallel(4);
+    SIMUL.setPinning(true);
+    REQUIRE(run_parallel(4) == m);
+    SIMUL.setPinning(false);
+
+    int built = 0;
+    PerNode<int> shared([&]() { ++built; return new int(42); });
+    REQUIRE(shared.get() == 42);
+    REQUIRE(&shared.get() == &shared.get());
+    REQUIRE(built == 1);
+}
@@ -143,3 +143,43 @@ TEST_CASE("ParseUtils4", "parsedouble")
     REQUIRE(unit == "us");
 }
 
+
+TEST_CASE("ParseUtil5", "substrings")
+{
+    using parse_util::substring;
+
+    string c = " fixed(3); delay(unif(1, 2)); wait(R) ;";
+    vector<substring> instr, params;
+
+    parse_util::split_instr(substring(c), instr);
+    REQUIRE(instr.size() == 3);
+    REQUIRE(instr[0] == "fixed(3)");
+    REQUIRE(instr[2] == "wait(R)");
+    // no copies: the pieces point into c
+    REQUIRE(instr[1].data() == c.data() + 11);
+
+    REQUIRE(parse_util::token_of(instr[1]) == "delay");
+    REQUIRE(parse_util::param_of(instr[1]) == "unif(1, 2)");
+
+    parse_util::split_param(" unif(1, 2), 3 ,x", params);
+    REQUIRE(params.size() == 3);
+    REQUIRE(params[0] == "unif(1, 2)");
+    REQUIRE(params[1] == "3");
+    REQUIRE(params[2] == "x");
+
+    // the string wrappers give the same tokens
+    vector<string> s = parse_util::split_param(" unif(1, 2), 3 ,x");
+    REQUIRE(s.size() == 3);
+    REQUIRE(s[0] == "unif(1, 2)");
+
+    vector<string> out(5, "a long string that is reused");
+    parse_util::assign(params, out);
+    REQUIRE(out.size() == 3);
+    REQUIRE(out[2] == "x");
+
+    substring unit;
+    double n;
+    parse_util::parse_double(substring(" 2.5ms "), n, unit);
+    REQUIRE(n == 2.5);
+    REQUIRE(unit == "ms");
+}
@@ -0,0 +1,182 @@
+#include <memory>
+#include <vector>
+
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <partition.hpp>
+#include <randomvar.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    class Core;
+    // the cores are owned by their partitions
+    vector<Core *> cores;
+
+    // a core that works for random intervals, and at the end of
+    // each interval sends a request to the next core, which
+    // records it
+    class Core : public Entity {
+        GEvent<Core> _evt;
+        UniformVar _var;
+        int _id;
+    public:
+        vector<pair<int, Tick> > received;
+
+        Core(int id) : Entity("core"), _evt(this, &Core::onEvt),
+                       _var(1, 20), _id(id) {}
+        void onEvt(Event *) {
+            Tick now = SIMUL.getTime();
+            int dest = (_id + 1) % int(cores.size());
+            // the action runs in the destination partition
+            Core *c = cores[dest];
+            int src = _id;
+            PartitionedSim::send(dest, now + 5, [c, src, now]() {
+                c->received.push_back(make_pair(src, now));
+            });
+            _evt.post(now + Tick(int64_t(_var.get())));
+        }
+        void newRun() { _evt.post(0); received.clear(); }
+        void endRun() {}
+    };
+
+    vector<vector<pair<int, Tick> > > run_cores(int threads)
+    {
+        RandomVar::init(4321);
+        cores.assign(4, (Core *)0);
+        PartitionedSim ps(4, 5);
+        ps.build([](int p) {
+            shared_ptr<Core> c = make_shared<Core>(p);
+            cores[p] = c.get();
+            return shared_ptr<void>(c);
+        });
+        REQUIRE(ps.run(200, threads) > 0);
+
+        vector<vector<pair<int, Tick> > > res;
+        for (int p = 0; p < 4; ++p) res.push_back(cores[p]->received);
+        return res;
+    }
+}
+
+TEST_CASE("TestPartitions", "testSameResults")
+{
+    vector<vector<pair<int, Tick> > > r1 = run_cores(1);
+    vector<vector<pair<int, Tick> > > r4 = run_cores(4);
+    REQUIRE(r1 == r4);
+    REQUIRE(r1[1].size() > 5);
+    REQUIRE(r1[1][0] == make_pair(0, Tick(0)));
+}
+
+TEST_CASE("TestPartitions2", "testLookahead")
+{
+    PartitionedSim ps(2, 10);
+    bool thrown = false;
+    SimContext::Scope scope(ps.getContext(0));
+    // outside of run(), nobody is simulating a partition
+    try {
+        PartitionedSim::send(1, 100, []() {});
+    } catch (PartitionedSim::Exc &) {
+        thrown = true;
+    }
+    REQUIRE(thrown);
+    REQUIRE(PartitionedSim::current() == -1);
+}
+
+namespace {
+    class Node;
+    // the nodes are owned by their partitions
+    vector<Node *> nodes;
+
+    // a node whose behaviour depends on the messages it receives:
+    // each message delays its next activity
+    class Node : public Entity {
+        GEvent<Node> _evt;
+        UniformVar _var;
+        int _id;
+        struct State {
+            long received;
+            long checksum;
+        } _s;
+    public:
+        Node(int id) : Entity("node"), _evt(this, &Node::onEvt),
+                       _var(1, 30), _id(id) {}
+        void onEvt(Event *) {
+            Tick now = SIMUL.getTime();
+            int dest = (_id + 1 + int(_var.get()) % 2) % int(nodes.size());
+            Node *d = nodes[dest];
+            int src = _id;
+            PartitionedSim::send(dest, now + 3, [d, src]() { d->receive(src); });
+            _evt.post(now + Tick(int64_t(_var.get())) + _s.received % 4);
+        }
+        void receive(int src) {
+            _s.received++;
+            _s.checksum = _s.checksum * 31 + src * 1000 + int64_t(SIMUL.getTime());
+        }
+        long getChecksum() const { return _s.checksum; }
+        long getReceived() const { return _s.received; }
+        void saveState(Checkpoint &c) { c.put(_s); }
+        void loadState(Checkpoint &c) { c.get(_s); }
+        void newRun() {
+            _s.received = 0;
+            _s.checksum = 0;
+            _evt.post(_id);
+        }
+        void endRun() {}
+    };
+
+    vector<long> run_nodes(int threads, Tick window, unsigned long *rollbacks = 0)
+    {
+        RandomVar::init(777);
+        nodes.assign(6, (Node *)0);
+        PartitionedSim ps(6, 3);
+        ps.setOptimistic(window);
+        ps.build([](int p) {
+            shared_ptr<Node> n = make_shared<Node>(p);
+            nodes[p] = n.get();
+            return shared_ptr<void>(n);
+        });
+        ps.run(500, threads);
+        if (rollbacks) *rollbacks = ps.getRollbacks();
+
+        vector<long> res;
+        for (int p = 0; p < 6; ++p) {
+            res.push_back(nodes[p]->getReceived());
+            res.push_back(nodes[p]->getChecksum());
+        }
+        return res;
+    }
+}
+
+TEST_CASE("TestPartitions3", "testOptimistic")
+{
+    vector<long> ref = run_nodes(1, 0);
+    REQUIRE(ref[0] > 10);
+
+    unsigned long rollbacks = 0;
+    REQUIRE(run_nodes(1, 30, &rollbacks) == ref);
+    REQUIRE(rollbacks > 0);
+    REQUIRE(run_nodes(3, 30) == ref);
+    REQUIRE(run_nodes(6, 100) == ref);
+}
+
+TEST_CASE("TestPartitions4", "testOptimisticNeedsState")
+{
+    // the cores do not save their state: they cannot be brought
+    // back to the start of a window
+    cores.assign(2, (Core *)0);
+    PartitionedSim ps(2, 5);
+    ps.setOptimistic(50);
+    ps.build([](int p) {
+        shared_ptr<Core> c = make_shared<Core>(p);
+        cores[p] = c.get();
+        return shared_ptr<void>(c);
+    });
+    REQUIRE_THROWS_AS(ps.run(200, 1), const PartitionedSim::Exc&);
+    REQUIRE(cores[0]->received.empty());
+    REQUIRE(cores[1]->received.empty());
+}
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <gevent.hpp>
+#include <perfcounters.hpp>
+#include <profiler.hpp>
+#include <simul.hpp>
+#include <simcontext.hpp>
+#include <simmetrics.hpp>
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Pinger : public Entity {
+    public:
+        GEvent<Pinger> ping, timeout;
+
+        Pinger() : Entity("pinger"), ping(this, &Pinger::onPing),
+                   timeout(this, &Pinger::onTimeout) {}
+        void onPing(Event *) {
+            // the timeout is always cancelled by the next ping
+            timeout.drop();
+            timeout.post(SIMUL.getTime() + 5);
+            ping.post(SIMUL.getTime() + 1);
+        }
+        void onTimeout(Event *) {}
+        void newRun() { ping.post(0); }
+        void endRun() { ping.drop(); timeout.drop(); }
+    };
+}
+
+TEST_CASE("Event loop profiler")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    Pinger p;
+    EventProfiler prof(10);
+    std::stringstream out;
+    prof.setOutput(&out);
+    SIMUL.setProfiler(&prof);
+
+    SIMUL.run(99);
+    SIMUL.setProfiler(NULL);
+
+    // ping and timeout are both GEvent<Pinger>
+    REQUIRE(prof.getEntries().size() == 1);
+    const EventProfiler::Entry &e = prof.getEntries()[0];
+    REQUIRE(e.count == 100);
+    REQUIRE(e.posted == 201);
+    // 99 timeouts dropped by the next ping, 2 events at the end
+    REQUIRE(e.getDropped() == 101);
+    REQUIRE(prof.getSteps() == 100);
+    REQUIRE(prof.getMaxDepth() == 1);
+    REQUIRE(prof.getDepthSamples().size() == 10);
+
+    REQUIRE(out.str().find("Events: 100") == 0);
+    REQUIRE(out.str().find("MetaSim::GEvent<") != std::string::npos);
+}
+
+TEST_CASE("Profiler phases and hardware counters")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    PerfCounters pmc;
+    EventProfiler prof(1);
+    prof.setCounters(&pmc);
+    SIMUL.setProfiler(&prof);
+
+    prof.beginPhase("build");
+    Pinger p;
+    SIMUL.run(99, 3);
+    SIMUL.setProfiler(NULL);
+
+    const std::vector<EventProfiler::Phase> &ph = prof.getPhases();
+    REQUIRE(ph.size() == 5);
+    REQUIRE(ph[0].name == "build");
+    REQUIRE(ph[0].calls == 1);
+    REQUIRE(ph[1].name == "initSingleRun");
+    REQUIRE(ph[1].calls == 3);
+    REQUIRE(ph[2].name == "main loop");
+    REQUIRE(ph[2].calls == 3);
+    REQUIRE(ph[3].name == "endSingleRun");
+    REQUIRE(ph[4].name == "stats");
+    REQUIRE(ph[4].calls == 1);
+
+    // every event is sampled; the counters may not be available
+    const EventProfiler::Entry &e = prof.getEntries()[0];
+    REQUIRE(e.sampled == e.count);
+    if (pmc.has(PerfCounters::INSTRUCTIONS)) {
+        REQUIRE(e.counters[PerfCounters::INSTRUCTIONS] > 0);
+        REQUIRE(ph[2].counters[PerfCounters::INSTRUCTIONS] > 
+                e.counters[PerfCounters::INSTRUCTIONS]);
+    }
+    else REQUIRE(e.counters[PerfCounters::INSTRUCTIONS] == 0);
+
+    std::stringstream out;
+    prof.print(out);
+    REQUIRE(out.str().find("main loop") != std::string::npos);
+}
+
+TEST_CASE("Simulation progress metrics")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    Pinger p;
+    SimMetrics m(16);
+    m.setTextfile("metrics_test.prom", 1e9);
+    SIMUL.setMetrics(&m);
+
+    REQUIRE(!m.isDone());
+    REQUIRE(m.getETA() < 0);
+
+    SIMUL.run(99, 3);
+    SIMUL.setMetrics(NULL);
+
+    REQUIRE(m.isDone());
+    REQUIRE(m.getEvents() == 300);
+    REQUIRE(m.getRun() == 2);
+    REQUIRE(m.getRuns() == 3);
+    REQUIRE(int(m.getEndTime()) == 99);
+    REQUIRE(int(m.getSimTime()) == 99);
+    REQUIRE(m.getETA() == 0);
+    REQUIRE(m.getStalledSeconds() == 0);
+
+    // written only by finish(), given the interval
+    std::ifstream is("metrics_test.prom");
+    std::stringstream ss;
+    ss << is.rdbuf();
+    REQUIRE(ss.str().find("metasim_events_total 300\n") != std::string::npos);
+    REQUIRE(ss.str().find("metasim_done 1\n") != std::string::npos);
+    std::remove("metrics_test.prom");
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <genericvar.hpp>
+#include <randomvar.hpp>
+#include <samplefeeder.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+TEST_CASE("TestRandomGen", "testSkip")
+{
+    RandomGen a(777), b(777);
+    for (int i = 0; i < 1000; ++i) a.sample();
+    b.skip(1000);
+    REQUIRE(a.sample() == b.sample());
+
+    a.setStream(3, 2);
+    b.init(777);
+    b.skip(3 * (1ULL << 26) + 2 * (1ULL << 20));
+    REQUIRE(a.sample() == b.sample());
+
+    std::unique_ptr<RandomGen> c(a.substream(2));
+    REQUIRE(c->getStream() == 3);
+}
+
+TEST_CASE("TestRandomGen2", "testBackends")
+{
+    RandomGen::Type types[] = { RandomGen::PARK_MILLER, 
+                                RandomGen::XOSHIRO256, 
+                                RandomGen::PCG32 };
+
+    for (int t = 0; t < 3; ++t) {
+        std::unique_ptr<RandomGen> g(RandomGen::create(types[t], 12345));
+        REQUIRE(g->getType() == types[t]);
+
+        UniformVar u(2, 5, g.get());
+        double first = u.get();
+        int out = 0;
+        for (int i = 0; i < 10000; ++i) {
+            double v = u.get();
+            if (v < 2 || v >= 5) out++;
+        }
+        REQUIRE(out == 0);
+
+        // streams are reproducible
+        g->setStream(0);
+        REQUIRE(u.get() == first);
+
+        std::unique_ptr<RandomGen> h(g->substream(1));
+        g->setStream(0, 1);
+        REQUIRE(h->sample() == g->sample());
+    }
+
+    // the PCG jump-ahead is exact
+    Pcg32Gen p(99), q(99);
+    for (int i = 0; i < 5000; ++i) p.sample();
+    q.skip(5000);
+    REQUIRE(p.sample() == q.sample());
+}
+
+TEST_CASE("TestRandomGen3", "testFill")
+{
+    for (int t = 0; t < 3; ++t) {
+        RandomGen::Type type = RandomGen::Type(t);
+        std::unique_ptr<RandomGen> g1(RandomGen::create(type, 4242));
+        std::unique_ptr<RandomGen> g2(RandomGen::create(type, 4242));
+
+        ExponentialVar e1(10, g1.get()), e2(10, g2.get());
+        ParetoVar p1(2, 3, g1.get()), p2(2, 3, g2.get());
+        NormalVar n1(5, 1, g1.get()), n2(5, 1, g2.get());
+
+        // the block path gives exactly the values of the scalar one
+        double v[100];
+        int diff = 0;
+        e1.fill(v, 100);
+        for (int i = 0; i < 100; ++i) if (v[i] != e2.get()) diff++;
+        p1.fill(v, 100);
+        for (int i = 0; i < 100; ++i) if (v[i] != p2.get()) diff++;
+        n1.fill(v, 100);
+        for (int i = 0; i < 100; ++i) if (v[i] != n2.get()) diff++;
+
+        // as well as the prefetch buffer
+        e1.setPrefetch(16);
+        for (int i = 0; i < 100; ++i) if (e1.draw() != e2.get()) diff++;
+        REQUIRE(diff == 0);
+    }
+}
+
+TEST_CASE("TestRandomGen4", "testAliasTable")
+{
+    {
+        std::ofstream f("test_pdf.txt");
+        f << "1 0.5\n" << "2 0.25\n" << "7 0.125\n" << "9 0.125\n";
+    }
+    GenericVar a("test_pdf.txt"), b("test_pdf.txt");
+    REQUIRE(a.getSize() == 4);
+
+    std::map<int, int> count;
+    for (int i = 0; i < 80000; ++i) count[int(a.get())]++;
+    REQUIRE(count.size() == 4);
+    REQUIRE(count[1] > 38000);
+    REQUIRE(count[1] < 42000);
+    REQUIRE(count[7] > 9000);
+    REQUIRE(count[7] < 11000);
+
+    // values outside the table are never returned
+    int total = count[1] + count[2] + count[7] + count[9];
+    REQUIRE(total == 80000);
+
+    // the binary table gives the same samples
+    GenericVar::convert("test_pdf.txt", "test_pdf.bin");
+    REQUIRE(AliasTable::isBinary("test_pdf.bin"));
+    REQUIRE(!AliasTable::isBinary("test_pdf.txt"));
+    GenericVar c("test_pdf.bin");
+    REQUIRE(c.getSize() == 4);
+
+    int diff = 0;
+    RandomVar::init(5);
+    std::vector<double> v;
+    for (int i = 0; i < 1000; ++i) v.push_back(a.get());
+    RandomVar::init(5);
+    for (int i = 0; i < 1000; ++i) if (c.get() != v[i]) diff++;
+    REQUIRE(diff == 0);
+
+    std::remove("test_pdf.txt");
+    std::remove("test_pdf.bin");
+}
+
+TEST_CASE("TestRandomGen5", "testSampleFeeder")
+{
+    std::unique_ptr<RandomGen> g1(RandomGen::create(RandomGen::XOSHIRO256, 77));
+    std::unique_ptr<RandomGen> g2(RandomGen::create(RandomGen::XOSHIRO256, 77));
+    std::unique_ptr<RandomGen> g3(g1->substream(1)), g4(g2->substream(1));
+
+    ExponentialVar e1(10, g1.get()), e2(10, g2.get());
+    NormalVar n1(5, 1, g3.get()), n2(5, 1, g4.get());
+    int diff = 0;
+
+    // the samples prefetched before attach() come first
+    e1.setPrefetch(10);
+    for (int i = 0; i < 3; ++i) if (e1.draw() != e2.get()) diff++;
+
+    {
+        SampleFeeder feeder(64, 3);
+        feeder.attach(e1);
+        feeder.attach(n1);
+        REQUIRE(feeder.size() == 2);
+        for (int i = 0; i < 5000; ++i) {
+            if (e1.draw() != e2.get()) diff++;
+            if (n1.draw() != n2.get()) diff++;
+        }
+
+        // the blocks left in the ring go back to the variable
+        feeder.detach(e1);
+        REQUIRE(feeder.size() == 1);
+        for (int i = 0; i < 1000; ++i) if (e1.draw() != e2.get()) diff++;
+        for (int i = 0; i < 100; ++i) if (n1.draw() != n2.get()) diff++;
+    }
+    for (int i = 0; i < 1000; ++i) if (n1.draw() != n2.get()) diff++;
+    REQUIRE(diff == 0);
+}
@@ -0,0 +1,188 @@
+#include <memory>
+
+#include <arena.hpp>
+
+#include <basestat.hpp>
+#include <checkpoint.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+#include <simcontext.hpp>
+#include "myentity.hpp"
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+TEST_CASE("TestSimContext", "testIsolation")
+{
+    SimContext *def = SimContext::current();
+    std::unique_ptr<MyEntity> a(new MyEntity("ctx_entity"));
+
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+
+        REQUIRE(SimContext::current() == &ctx);
+        REQUIRE(&SIMUL != &def->simulation());
+
+        // the same name can be used in another context
+        std::unique_ptr<MyEntity> b(new MyEntity("ctx_entity"));
+        REQUIRE(Entity::_find("ctx_entity") == b.get());
+
+        // the run of this context does not touch the default one
+        SIMUL.run(50);
+        REQUIRE(b->getCounter() > 0);
+        REQUIRE(a->getCounter() == 0);
+        REQUIRE(Event::getFirst() == NULL);
+    }
+
+    REQUIRE(SimContext::current() == def);
+    REQUIRE(Entity::_find("ctx_entity") == a.get());
+}
+
+namespace {
+    class Walker : public Entity {
+    public:
+        struct State {
+            double pos;
+            int steps;
+        } st;
+        GEvent<Walker> evt;
+        UniformVar var;
+        StatMean &stat;
+
+        Walker(StatMean &s) : Entity("walker"), evt(this, &Walker::onStep),
+                              var(-1, 1), stat(s) {
+            st.pos = 0;
+            st.steps = 0;
+            setResetState(&st, sizeof(st));
+        }
+        void onStep(Event *) {
+            st.pos += var.get();
+            st.steps++;
+            stat.record(st.pos);
+            evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() {}
+        void endRun() { evt.drop(); }
+    };
+}
+
+TEST_CASE("TestSimContext2", "testCheckpoint")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    StatMean stat("pos");
+    Walker w(stat);
+
+    BaseStat::init(1);
+    SIMUL.initSingleRun();
+    w.evt.post(0);
+    SIMUL.run_to(50);
+
+    Checkpoint c;
+    SIMUL.checkpoint(c);
+    REQUIRE(c.getTime() == 50);
+
+    SIMUL.run_to(100);
+    double pos = w.st.pos;
+    double mean = stat.getValue();
+    int steps = w.st.steps;
+
+    // the continuation from the checkpoint is the same
+    SIMUL.restore(c);
+    REQUIRE(SIMUL.getTime() == 50);
+    REQUIRE(w.st.steps == 51);
+    SIMUL.run_to(100);
+    REQUIRE(w.st.pos == pos);
+    REQUIRE(stat.getValue() == mean);
+    REQUIRE(w.st.steps == steps);
+
+    SIMUL.endSingleRun();
+}
+
+namespace {
+    int walkersAlive = 0;
+
+    class CountedWalker : public Walker {
+    public:
+        CountedWalker(StatMean &s) : Walker(s) { walkersAlive++; }
+        ~CountedWalker() { walkersAlive--; }
+    };
+
+    struct Pod {
+        int a;
+        double b;
+    };
+}
+
+TEST_CASE("TestSimContext3", "testArena")
+{
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelArena &a = ctx.arena();
+
+        StatMean *stat = a.create<StatMean>("arena_pos");
+        CountedWalker *w = a.create<CountedWalker>(*stat);
+        for (int i = 0; i < 100; ++i) a.create<MyEntity>();
+        REQUIRE(walkersAlive == 1);
+        REQUIRE(a.getObjects() == 102);
+
+        Pod *p = a.create<Pod>();
+        p->a = 1;
+        REQUIRE(a.getObjects() == 102);
+        REQUIRE((reinterpret_cast<size_t>(p) % alignof(Pod)) == 0);
+        REQUIRE(a.getBytes() >= 100 * sizeof(MyEntity));
+        REQUIRE(MemStats::getBytes("model arena") >= int64_t(a.getBytes()));
+
+        // the context goes away with the events still in the queue
+        BaseStat::init(1);
+        SIMUL.initSingleRun();
+        w->evt.post(0);
+        SIMUL.run_to(10);
+        REQUIRE(Event::getFirst() != NULL);
+    }
+    REQUIRE(walkersAlive == 0);
+    REQUIRE(MemStats::getBytes("model arena") == 0);
+}
+
+TEST_CASE("TestSimContext4", "testPartialCheckpoint")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    StatMean stat("pos");
+    Walker w(stat);
+
+    BaseStat::init(1);
+    SIMUL.initSingleRun();
+    w.evt.post(0);
+    SIMUL.run_to(10);
+
+    Checkpoint c;
+    {
+        // an entity that does not save its state
+        MyEntity e("stateless");
+        REQUIRE_THROWS_AS(SIMUL.checkpoint(c), const Checkpoint::Exc&);
+        REQUIRE(!c.isValid());
+    }
+    {
+        // a variable with its own generator
+        RandomGen g(7);
+        UniformVar v(0, 1, &g);
+        REQUIRE_THROWS_AS(SIMUL.checkpoint(c), const Checkpoint::Exc&);
+    }
+    {
+        // a variable with values drawn in advance
+        UniformVar v(0, 1);
+        v.setPrefetch(4);
+        SIMUL.checkpoint(c);
+        v.draw();
+        REQUIRE_THROWS_AS(SIMUL.checkpoint(c), const Checkpoint::Exc&);
+        for (int i = 0; i < 3; ++i) v.draw();
+        SIMUL.checkpoint(c);
+    }
+    REQUIRE(c.isValid());
+
+    SIMUL.endSingleRun();
+}
@@ -0,0 +1,70 @@
+#include <sstream>
+#include <string>
+
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+#include <snapshots.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // counts one every 3 ticks
+    class Counter : public Entity {
+    public:
+        GEvent<Counter> evt;
+        StatCount &count;
+
+        Counter(StatCount &c) : Entity("counter"), 
+                                evt(this, &Counter::onEvt), count(c) {}
+        void onEvt(Event *) {
+            count.record(1);
+            evt.post(SIMUL.getTime() + 3);
+        }
+        void newRun() { evt.post(0); }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestSnapshots", "testPeriodicValues")
+{
+    StatCount count("count");
+    Counter c(count);
+
+    StatSnapshots snap(10);
+    snap.addStat(&count);
+    SIMUL.setSnapshots(&snap);
+    SIMUL.run(100, 3);
+
+    // instants 10, 20, ..., 100 of every run, with the events
+    // before each instant
+    REQUIRE(snap.size() == 30);
+    bool ok = true;
+    for (size_t i = 0; i < snap.size(); ++i) {
+        Tick t = snap.getTime(i);
+        ok = ok && snap.getRun(i) == int(i / 10);
+        ok = ok && t == Tick(10 * (long int)(i % 10 + 1));
+        ok = ok && snap.getValue(i, 0) == ((long int)t + 2) / 3;
+    }
+    REQUIRE(ok);
+
+    // the instants after the last event are taken anyway
+    snap.clear();
+    snap.beginRun(0, 35);
+    SIMUL.initSingleRun();
+    c.evt.drop();
+    REQUIRE(SIMUL.run_to(35) == 35);
+    SIMUL.endSingleRun();
+    REQUIRE(snap.size() == 3);
+    REQUIRE(snap.getValue(2, 0) == 0);
+
+    std::ostringstream os;
+    snap.write(os);
+    REQUIRE(os.str().substr(0, 7) == "0\t10\t0\n");
+
+    SIMUL.setSnapshots(NULL);
+}
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+#include <splitting.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // a walk on 0, 1, 2, ... that goes up with probability q at
+    // every tick, and down otherwise
+    class Climber : public Entity {
+    public:
+        int pos;
+        GEvent<Climber> evt;
+        UniformVar var;
+        double q;
+
+        Climber(double p) : Entity("climber"), pos(0), 
+                            evt(this, &Climber::onStep), var(0, 1), q(p) {}
+        void onStep(Event *) {
+            if (var.get() < q) ++pos;
+            else pos = std::max(0, pos - 1);
+            evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { pos = 0; evt.post(0); }
+        void endRun() {}
+        void saveState(Checkpoint &c) { c.put(pos); }
+        void loadState(Checkpoint &c) { c.get(pos); }
+    };
+
+    // an entity that does not save its state
+    class Walker : public Entity {
+    public:
+        int steps;
+        GEvent<Walker> evt;
+
+        Walker() : Entity("walker"), steps(0), evt(this, &Walker::onStep) {}
+        void onStep(Event *) { ++steps; evt.post(SIMUL.getTime() + 1); }
+        void newRun() { steps = 0; evt.post(0); }
+        void endRun() {}
+    };
+
+    // probability of reaching l in n steps
+    double exactProbability(double q, int l, int n)
+    {
+        std::vector<double> p(l + 1, 0.0);
+        p[0] = 1;
+        for (int t = 0; t < n; ++t) {
+            std::vector<double> v(l + 1, 0.0);
+            v[l] = p[l];
+            for (int i = 0; i < l; ++i) {
+                v[i + 1] += p[i] * q;
+                v[std::max(0, i - 1)] += p[i] * (1 - q);
+            }
+            p = v;
+        }
+        return p[l];
+    }
+}
+
+TEST_CASE("TestSplitting", "testRareEvent")
+{
+    Climber c(0.25);
+    double exact = exactProbability(0.25, 12, 200);
+    REQUIRE(exact < 1e-3);
+
+    double l[] = { 3, 6, 9, 12 };
+    Splitting s([&c]() { return double(c.pos); }, 
+                std::vector<double>(l, l + 4), 200);
+    REQUIRE_THROWS(Splitting([&c]() { return 0.0; }, 
+                             std::vector<double>(l, l + 4), 0));
+
+    RandomVar::init(7);
+    const int n = 40;
+    double sum = 0, sq = 0;
+    for (int i = 0; i < n; ++i) {
+        double p = s.run(199);
+        sum += p;
+        sq += p * p;
+    }
+    REQUIRE(s.getHits(0) > 0);
+    REQUIRE(s.getTrials() <= n * 4 * 200);
+
+    // the estimates are unbiased
+    double mean = sum / n;
+    double se = std::sqrt((sq / n - mean * mean) / (n - 1));
+    INFO(mean << " +- " << se << " vs " << exact);
+    REQUIRE(se < 0.2 * exact);
+    REQUIRE(std::fabs(mean - exact) < 3 * se);
+}
+
+TEST_CASE("TestSplitting2", "testNoCheckpoint")
+{
+    Walker w;
+    double l[] = { 10, 20 };
+    Splitting s([&w]() { return double(w.steps); },
+                std::vector<double>(l, l + 2), 10);
+    REQUIRE_THROWS_AS(s.run(100), const Splitting::Exc&);
+    REQUIRE(w.steps == 0);
+    REQUIRE(s.getTrials() == 0);
+}
@@ -0,0 +1,41 @@
+#include <cmath>
+
+#include <basestat.hpp>
+#include <randomvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+TEST_CASE("TestStatQuantile", "testStreamingQuantiles")
+{
+    StatSummary sum;
+    StatHistogram hist("", 0.99);
+    StatQuantile p2("", 0.99);
+    BaseStat::newRun();
+
+    UniformVar u(0, 1000);
+    for (int i = 0; i < 100000; ++i) {
+        double x = u.get();
+        sum.record(x);
+        hist.record(x);
+        p2.record(x);
+    }
+    hist.record(0);
+
+    REQUIRE(sum.getCount() == 100000);
+    REQUIRE(sum.getMin() >= 0);
+    REQUIRE(sum.getMax() <= 1000);
+    REQUIRE(std::fabs(sum.getValue() - 500) < 5);
+    REQUIRE(std::fabs(std::sqrt(sum.getSampleVariance()) - 288.7) < 3);
+
+    // the relative error of the buckets is 1/128
+    REQUIRE(std::fabs(hist.getQuantile(0.99) - 990) < 12);
+    REQUIRE(std::fabs(hist.getQuantile(0.5) - 500) < 10);
+    REQUIRE(hist.getQuantile(0) == 0);
+    REQUIRE(hist.getQuantile(1) == hist.getMax());
+    // the values (between about 2^-7 and 2^10) span 18 powers of two
+    REQUIRE(hist.getBucketNum() <= 128 * 20);
+
+    REQUIRE(std::fabs(p2.getValue() - 990) < 5);
+}
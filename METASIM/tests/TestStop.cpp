@@ -0,0 +1,66 @@
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // ticks every 10, and raises an alarm at time alarmAt (if >= 0)
+    class Ticker : public Entity {
+    public:
+        GEvent<Ticker> tickEvt;
+        GEvent<Ticker> alarmEvt;
+        StatCount &ticks;
+        Tick alarmAt;
+
+        Ticker(StatCount &s) : Entity("ticker"), 
+                               tickEvt(this, &Ticker::onTick),
+                               alarmEvt(this, &Ticker::onAlarm),
+                               ticks(s), alarmAt(-1) {}
+        void onTick(Event *) {
+            ticks.record(1);
+            tickEvt.post(SIMUL.getTime() + 10);
+        }
+        void onAlarm(Event *) {}
+        void newRun() {
+            tickEvt.post(0);
+            if (alarmAt >= 0) alarmEvt.post(alarmAt);
+        }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestStop", "testStopPredicates")
+{
+    StatCount ticks("ticks");
+    Ticker t(ticks);
+
+    // the run ends after the fifth tick, and the stat is finalized
+    SIMUL.addStopPredicate([&ticks]() { return ticks.getValue() >= 5; });
+    SIMUL.run(1000);
+    REQUIRE(SIMUL.isStopped());
+    REQUIRE(ticks.getMean() == 5);
+
+    SIMUL.clearStopPredicates();
+    SIMUL.initSingleRun();
+    REQUIRE(!SIMUL.isStopped());
+    REQUIRE(SIMUL.run_to(100) == 100);
+    REQUIRE(ticks.getValue() == 11);
+    SIMUL.endSingleRun();
+
+    // on a specific event
+    SIMUL.stopOn(t.alarmEvt);
+    t.alarmAt = 55;
+    SIMUL.initSingleRun();
+    REQUIRE(SIMUL.run_to(1000) == 55);
+    REQUIRE(SIMUL.isStopped());
+    REQUIRE(ticks.getValue() == 6);
+    // the run is over: the clock does not move
+    REQUIRE(SIMUL.run_to(2000) == 55);
+    SIMUL.endSingleRun();
+
+    t.alarmAt = -1;
+}
@@ -0,0 +1,63 @@
+#include <vector>
+
+#include <gevent.hpp>
+#include <simul.hpp>
+#include <simcontext.hpp>
+#include <trace.hpp>
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Ticker : public Entity {
+    public:
+        GEvent<Ticker> evt;
+
+        Ticker() : Entity("ticker"), evt(this, &Ticker::onTick) {}
+        void onTick(Event *) { evt.post(SIMUL.getTime() + 1); }
+        void newRun() { evt.post(0); }
+        void endRun() { evt.drop(); }
+    };
+
+    class CountTrace : public Trace {
+    public:
+        std::vector<Tick> times;
+
+        CountTrace() : Trace("unused", Trace::BINARY, false) {}
+        void record(Event *e) { times.push_back(e->getLastTime()); }
+    };
+}
+
+TEST_CASE("Trace filters")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    Ticker t;
+    CountTrace all, window, kinds, ids;
+    t.evt.addTrace(&all);
+    t.evt.addTrace(&window);
+    t.evt.addTrace(&kinds);
+    t.evt.addTrace(&ids);
+
+    window.setWindow(10, 19);
+    kinds.setKinds(std::vector<int>(1, t.evt.getKind()));
+    // the events of a GEvent have no owner
+    ids.setIDs(std::vector<int>(1, 1));
+
+    SIMUL.run(30);
+    REQUIRE(all.times.size() >= 30);
+    REQUIRE(window.times.size() == 10);
+    REQUIRE(window.times.front() == 10);
+    REQUIRE(window.times.back() == 19);
+    REQUIRE(kinds.times.size() == all.times.size());
+    REQUIRE(ids.times.empty());
+
+    kinds.setKinds(std::vector<int>(1, t.evt.getKind() + 1));
+    window.clearFilters();
+    all.times.clear();
+    window.times.clear();
+    kinds.times.clear();
+    SIMUL.run(30);
+    REQUIRE(window.times.size() == all.times.size());
+    REQUIRE(kinds.times.empty());
+}
@@ -0,0 +1,78 @@
+#include <cmath>
+
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // draws u in [0, 1) at every tick, and records exp(u) and u:
+    // the expected values are e - 1 and 1/2
+    class Sampler : public Entity {
+        GEvent<Sampler> _evt;
+        UniformVar _u;
+        StatMean &_y;
+        StatMean &_x;
+    public:
+        Sampler(StatMean &y, StatMean &x) : 
+            Entity("sampler"), _evt(this, &Sampler::onEvt), 
+            _u(0, 1), _y(y), _x(x) {}
+        void onEvt(Event *) {
+            double u = _u.get();
+            _y.record(std::exp(u));
+            _x.record(u);
+            _evt.post(SIMUL.getTime() + 1);
+        }
+        void newRun() { _evt.post(0); }
+        void endRun() {}
+    };
+}
+
+TEST_CASE("TestVarianceReduction", "testAntitheticPairs")
+{
+    StatMean y("y"), x("x");
+    Sampler s(y, x);
+    RandomVar::init(5);
+
+    SIMUL.setReplicaStreams(true);
+    SIMUL.run(9, 20);
+    double h = y.getConfInterval();
+    REQUIRE(std::fabs(y.getMean() - (M_E - 1)) < 2 * h);
+
+    SIMUL.setAntitheticPairs(true);
+    SIMUL.run(9, 20);
+    double ha = y.getConfInterval();
+    double hx = x.getConfInterval();
+    double mean = y.getMean();
+    SIMUL.setAntitheticPairs(false);
+    SIMUL.setReplicaStreams(false);
+
+    INFO(h << " vs " << ha);
+    REQUIRE(ha < 0.5 * h);
+    REQUIRE(std::fabs(mean - (M_E - 1)) < 2 * ha);
+    // the mean of u is exact in every pair
+    REQUIRE(hx < 1e-6);
+    REQUIRE(!RandomVar::getGenerator()->isAntithetic());
+}
+
+TEST_CASE("TestVarianceReduction2", "testControlVariate")
+{
+    StatMean y("y"), x("x");
+    Sampler s(y, x);
+    RandomVar::init(5);
+
+    REQUIRE_THROWS(y.getControlledMean());
+    y.setControlVariate(&x, 0.5);
+    SIMUL.run(9, 20);
+
+    double h = y.getConfInterval();
+    double hc = y.getControlledConfInterval();
+    INFO(h << " vs " << hc);
+    REQUIRE(hc < 0.5 * h);
+    REQUIRE(std::fabs(y.getControlledMean() - (M_E - 1)) < 2 * hc);
+}
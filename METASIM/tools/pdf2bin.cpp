@@ -0,0 +1,41 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+ * Converts a PDF text file (pairs value, probability), as read by
+ * GenericVar, in the binary format that GenericVar maps in memory.
+ *
+ * Usage: pdf2bin <input.txt> <output.bin>
+ */
+#include <iostream>
+
+#include <genericvar.hpp>
+
+using namespace std;
+using namespace MetaSim;
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <input.txt> <output.bin>" << endl;
+        return 1;
+    }
+
+    try {
+        GenericVar::convert(argv[1], argv[2]);
+    } catch (BaseExc &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  Time to partition N tasks on M processors (see Partitioner),
+  with every heuristic (ff, bf, wf) and admission test (edf,
+  qpa, rta). The tasks have constrained deadlines and a total
+  utilization of 0.8 M, drawn from a fixed seed. The results
+  are printed one per line, as CSV (the default) or as JSON
+  objects:
+
+  partition_bench [--tasks N] [--cpus M] [--format csv|json]
+                  [--filter NAME]
+
+  N is 100000 by default, M is 256.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <partitioner.hpp>
+
+using namespace std;
+using namespace RTSim;
+
+namespace {
+
+    struct Options {
+        long tasks;
+        int cpus;
+        bool json;
+        string filter;
+
+        Options() : tasks(100000), cpus(256), json(false), filter() {}
+    };
+
+    Options opt;
+
+    /// xorshift64
+    struct Fast {
+        uint64_t s;
+        Fast() : s(88172645463325252ULL) {}
+        uint64_t next() { 
+            s ^= s << 13; s ^= s >> 7; s ^= s << 17; 
+            return s; 
+        }
+        /// uniform in [a, b]
+        long in(long a, long b) { return a + long(next() % uint64_t(b - a + 1)); }
+    };
+
+    void run(const string &name, Partitioner::fit_t fit, Partitioner::test_t test)
+    {
+        Partitioner p(opt.cpus, fit, test);
+        Fast f;
+        double u = 0.8 * opt.cpus / opt.tasks;
+        for (long i = 0; i < opt.tasks; ++i) {
+            long t = f.in(1000, 100000);
+            long c = max(1L, long(2 * u * t * f.in(1, 1000) / 1000));
+            long d = t - (t - c) * f.in(0, 20) / 100;
+            p.addTask(c, t, d);
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        size_t missed = p.partition();
+        double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        if (opt.json)
+            cout << "{\"case\":\"" << name << "\",\"tasks\":" << opt.tasks
+                 << ",\"cpus\":" << opt.cpus << ",\"missed\":" << missed
+                 << ",\"wall_ms\":" << wall * 1000 << "}" << endl;
+        else
+            cout << name << "," << opt.tasks << "," << opt.cpus << "," 
+                 << missed << "," << wall * 1000 << endl;
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--tasks N] [--cpus M]"
+             << " [--format csv|json] [--filter NAME]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--tasks") opt.tasks = atol(argv[++i]);
+        else if (a == "--cpus") opt.cpus = atoi(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else usage(argv[0]);
+    }
+    opt.tasks = max(opt.tasks, 1L);
+    opt.cpus = max(opt.cpus, 1);
+
+    if (!opt.json) cout << "case,tasks,cpus,missed,wall_ms" << endl;
+
+    const char *fits[] = {"ff", "bf", "wf"};
+    const char *tests[] = {"edf", "qpa", "rta"};
+    for (int t = 0; t < 3; ++t)
+        for (int h = 0; h < 3; ++h) {
+            string name = string(fits[h]) + "_" + tests[t];
+            if (!opt.filter.empty() && name.find(opt.filter) == string::npos) continue;
+            run(name, Partitioner::fit_t(h), Partitioner::test_t(t));
+        }
+    return 0;
+}
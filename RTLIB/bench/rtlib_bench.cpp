@@ -0,0 +1,386 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  Scaling benchmarks of the kernels and schedulers of RTSim, on
+  synthetic task sets:
+
+  - rtkernel_edf, rtkernel_fp: RTKernel with EDFScheduler and
+    FPScheduler (rate monotonic priorities), 10 to 10^E tasks;
+  - mrtkernel_gedf: MRTKernel with global EDF, 2 to 256 CPUs and
+    ten tasks per CPU;
+  - rtkernel_edf_static, rtkernel_fp_static, mrtkernel_gedf_static:
+    the same cases with the specialized schedulers and kernels of
+    statickernel.hpp (the events must be the same);
+  - cbs, grub: 1000 reservations, one task each;
+  - pip: FPScheduler with PIRManager, all the tasks sharing four
+    resources with long critical sections.
+
+  The parameters are drawn from a fixed seed, so every release
+  simulates the same task sets. One tick is taken as one
+  millisecond of simulated time. Each case runs in a child
+  process (on POSIX systems), so that its peak resident set size
+  is measured alone. The results are printed one per line, as
+  CSV (the default) or as JSON objects:
+
+  rtlib_bench [--max-tasks N] [--max-cpus M] [--format csv|json]
+              [--filter NAME]
+
+  N is 10000 by default (up to 100000), M is 256.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <metasim.hpp>
+#include <cbserver.hpp>
+#include <edfsched.hpp>
+#include <fpsched.hpp>
+#include <grubserver.hpp>
+#include <kernel.hpp>
+#include <mrtkernel.hpp>
+#include <piresman.hpp>
+#include <rttask.hpp>
+#include <statickernel.hpp>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace MetaSim;
+using namespace RTSim;
+
+namespace {
+
+    struct Options {
+        long maxTasks;
+        int maxCPUs;
+        bool json;
+        string filter;
+
+        Options() : maxTasks(10000), maxCPUs(256), json(false), filter() {}
+    };
+
+    Options opt;
+
+    /// the parameters of the task sets (xorshift64)
+    struct Fast {
+        uint64_t s;
+        Fast() : s(88172645463325252ULL) {}
+        uint64_t next() { 
+            s ^= s << 13; s ^= s >> 7; s ^= s << 17; 
+            return s; 
+        }
+        /// uniform in [a, b]
+        long in(long a, long b) { return a + long(next() % uint64_t(b - a + 1)); }
+    };
+
+    struct TaskParams {
+        long period;
+        long wcet;
+    };
+
+    /**
+       n implicit-deadline tasks of total utilization u: the
+       periods are uniform in [100 n, 1000 n], so that the number
+       of jobs in the horizon (2000 n) does not depend on n.
+    */
+    vector<TaskParams> taskSet(long n, double u)
+    {
+        Fast f;
+        vector<TaskParams> v(n);
+        for (long i = 0; i < n; ++i) {
+            v[i].period = f.in(100 * n, 1000 * n);
+            v[i].wcet = max(1L, long(u / n * v[i].period));
+        }
+        return v;
+    }
+
+    long peakRSS()
+    {
+#ifndef _WIN32
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+        return ru.ru_maxrss / 1024;
+#else
+        return ru.ru_maxrss;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    string label(const char *p, long i)
+    {
+        stringstream ss;
+        ss << p << i;
+        return ss.str();
+    }
+
+    /**
+       The objects of a case, built in its own context, which
+       runs the simulation and prints the result.
+    */
+    class Case {
+    public:
+        string name;
+        long tasks;
+        int cpus;
+        Tick horizon;
+
+        SimContext ctx;
+        vector<unique_ptr<PeriodicTask> > ts;
+
+        Case(const string &n, long t, int c) :
+            name(n), tasks(t), cpus(c), horizon(2000 * t), ctx(), ts() {}
+
+        PeriodicTask *addTask(long i, const TaskParams &p, const string &code)
+        {
+            ts.push_back(unique_ptr<PeriodicTask>(
+                new PeriodicTask(p.period, p.period, 0, label("t", i))));
+            ts.back()->insertCode(code);
+            ts.back()->setAbort(false);
+            return ts.back().get();
+        }
+
+        /// simulates up to the horizon and prints the result
+        void run()
+        {
+            SimMetrics m(1 << 20);
+            SIMUL.setMetrics(&m);
+
+            chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+            SIMUL.initSingleRun();
+            SIMUL.run_to(horizon);
+            double wall = chrono::duration<double>(
+                chrono::steady_clock::now() - t0).count();
+            uint64_t events = m.getEvents();
+            SIMUL.endSingleRun();
+            SIMUL.setMetrics(NULL);
+
+            double simSecs = double(horizon) / 1000;
+            if (opt.json)
+                cout << "{\"case\":\"" << name << "\",\"tasks\":" << tasks 
+                     << ",\"cpus\":" << cpus << ",\"events\":" << events
+                     << ",\"wall_s\":" << wall 
+                     << ",\"events_per_s\":" << events / wall
+                     << ",\"wall_per_sim_s\":" << wall / simSecs
+                     << ",\"peak_rss_kb\":" << peakRSS() << "}" << endl;
+            else
+                cout << name << "," << tasks << "," << cpus << "," << events
+                     << "," << wall << "," << events / wall << "," 
+                     << wall / simSecs << "," << peakRSS() << endl;
+        }
+    };
+
+    string fixed(long c)
+    {
+        stringstream ss;
+        ss << "fixed(" << c << ");";
+        return ss.str();
+    }
+
+    template <class Sched, class Kernel>
+    void uniprocessor(const string &n, long tasks, bool fp)
+    {
+        Case c(n, tasks, 1);
+        SimContext::Scope scope(&c.ctx);
+        Sched sched;
+        Kernel kern(&sched);
+
+        vector<TaskParams> p = taskSet(tasks, fp ? 0.7 : 0.9);
+        // rate monotonic: the priority is the rank of the period
+        vector<long> periods;
+        for (size_t i = 0; i < p.size(); ++i) periods.push_back(p[i].period);
+        sort(periods.begin(), periods.end());
+
+        for (long i = 0; i < tasks; ++i) {
+            PeriodicTask *t = c.addTask(i, p[i], fixed(p[i].wcet));
+            long prio = lower_bound(periods.begin(), periods.end(), 
+                                    p[i].period) - periods.begin();
+            kern.addTask(*t, fp ? label("", prio) : "");
+        }
+        c.run();
+        c.ts.clear();
+    }
+
+    template <class Sched>
+    void multiprocessor(const string &n, int cpus)
+    {
+        long tasks = 10 * cpus;
+        Case c(n, tasks, cpus);
+        SimContext::Scope scope(&c.ctx);
+        Sched sched;
+        MRTKernel kern(&sched, cpus);
+
+        vector<TaskParams> p = taskSet(tasks, 0.8 * cpus);
+        for (long i = 0; i < tasks; ++i)
+            kern.addTask(*c.addTask(i, p[i], fixed(p[i].wcet)));
+        c.run();
+        c.ts.clear();
+    }
+
+    void reservations(bool grub, long n)
+    {
+        Case c(grub ? "grub" : "cbs", n, 1);
+        SimContext::Scope scope(&c.ctx);
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        GrubSupervisor super;
+        vector<unique_ptr<Server> > servers;
+
+        // the tasks use about 80% of their reservation
+        vector<TaskParams> p = taskSet(n, 0.9);
+        for (long i = 0; i < n; ++i) {
+            PeriodicTask *t = 
+                c.addTask(i, p[i], fixed(max(1L, p[i].wcet * 8 / 10)));
+            if (grub) {
+                Grub *g = new Grub(p[i].wcet, p[i].period, 
+                                   label("s", i), "FIFOSched");
+                servers.push_back(unique_ptr<Server>(g));
+                super.addGrub(g);
+            }
+            else 
+                servers.push_back(unique_ptr<Server>(
+                    new CBServer(p[i].wcet, p[i].period, p[i].period, true,
+                                 label("s", i), "FIFOSched")));
+            servers.back()->addTask(*t);
+            kern.addTask(*servers.back());
+        }
+        c.run();
+        c.ts.clear();
+        servers.clear();
+    }
+
+    void pip(long tasks)
+    {
+        Case c("pip", tasks, 1);
+        SimContext::Scope scope(&c.ctx);
+        FPScheduler sched;
+        RTKernel kern(&sched);
+        PIRManager pm;
+        const int RES = 4;
+        for (int r = 0; r < RES; ++r) pm.addResource(label("R", r));
+        kern.setResManager(&pm);
+
+        // half of each job is in a critical section
+        vector<TaskParams> p = taskSet(tasks, 0.7);
+        Fast f;
+        for (long i = 0; i < tasks; ++i) {
+            long cs = max(1L, p[i].wcet / 2);
+            long pre = max(1L, (p[i].wcet - cs) / 2);
+            string r = label("R", f.in(0, RES - 1));
+            stringstream code;
+            code << "fixed(" << pre << ");wait(" << r << ");fixed(" << cs 
+                 << ");signal(" << r << ");fixed(" << pre << ");";
+            PeriodicTask *t = c.addTask(i, p[i], code.str());
+            kern.addTask(*t, label("", i));
+        }
+        c.run();
+        c.ts.clear();
+    }
+
+    bool selected(const string &n)
+    {
+        return opt.filter.empty() || n.find(opt.filter) != string::npos;
+    }
+
+    /// runs f in a child process, where available
+    template <class F>
+    void isolate(F f)
+    {
+#ifdef _WIN32
+        f();
+#else
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            int code = 0;
+            try {
+                f();
+            } catch (exception &e) {
+                cerr << e.what() << endl;
+                code = 1;
+            }
+            cout.flush();
+            _exit(code);
+        }
+        if (pid < 0) {
+            f();
+            return;
+        }
+        int status;
+        waitpid(pid, &status, 0);
+#endif
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--max-tasks N] [--max-cpus M]"
+             << " [--format csv|json] [--filter NAME]" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--max-tasks") opt.maxTasks = atol(argv[++i]);
+        else if (a == "--max-cpus") opt.maxCPUs = atoi(argv[++i]);
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else usage(argv[0]);
+    }
+    opt.maxTasks = min(max(opt.maxTasks, 10L), 100000L);
+    opt.maxCPUs = min(max(opt.maxCPUs, 2), 256);
+
+    if (!opt.json)
+        cout << "case,tasks,cpus,events,wall_s,events_per_s,"
+            "wall_per_sim_s,peak_rss_kb" << endl;
+
+    for (long n = 10; n <= opt.maxTasks; n *= 10) {
+        if (selected("rtkernel_edf")) isolate([=]() { 
+                uniprocessor<EDFScheduler, RTKernel>("rtkernel_edf", n, false); });
+        if (selected("rtkernel_edf_static")) isolate([=]() { 
+                uniprocessor<StaticEDFScheduler, StaticRTKernel<StaticEDFScheduler> >(
+                    "rtkernel_edf_static", n, false); });
+        if (selected("rtkernel_fp")) isolate([=]() { 
+                uniprocessor<FPScheduler, RTKernel>("rtkernel_fp", n, true); });
+        if (selected("rtkernel_fp_static")) isolate([=]() { 
+                uniprocessor<StaticFPScheduler, StaticRTKernel<StaticFPScheduler> >(
+                    "rtkernel_fp_static", n, true); });
+    }
+    for (int m = 2; m <= opt.maxCPUs; m *= 2) {
+        if (selected("mrtkernel_gedf")) isolate([=]() { 
+                multiprocessor<EDFScheduler>("mrtkernel_gedf", m); });
+        if (selected("mrtkernel_gedf_static")) isolate([=]() { 
+                multiprocessor<StaticEDFScheduler>("mrtkernel_gedf_static", m); });
+    }
+    if (selected("cbs")) isolate([]() { reservations(false, 1000); });
+    if (selected("grub")) isolate([]() { reservations(true, 1000); });
+    for (long n = 10; n <= 1000 && n <= opt.maxTasks; n *= 10)
+        if (selected("pip")) isolate([=]() { pip(n); });
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+  Overhead of the trace writers: the same workload (an RTKernel
+  with EDF and 50 periodic tasks) is simulated without traces and
+  with each kind of trace attached to all the tasks. For each
+  configuration it prints the best wall time of --reps runs, the
+  slowdown with respect to the untraced run, and the bytes
+  written per simulation event. For the in-memory JavaTrace, the
+  bytes are the growth of the peak resident set size over the
+  untraced run.
+
+  trace_bench [--reps N] [--horizon T] [--format csv|json]
+              [--filter NAME] [--max-slowdown X]
+
+  With --max-slowdown, the exit status is 1 if the slowdown of any
+  configuration exceeds X, so that the benchmark can be used as a
+  regression test of the overhead of the traces.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <metasim.hpp>
+#include <chrometrace.hpp>
+#include <chunktrace.hpp>
+#include <cpu.hpp>
+#include <edfsched.hpp>
+#include <flightrec.hpp>
+#include <jtrace.hpp>
+#include <json_trace.hpp>
+#include <kernel.hpp>
+#include <rttask.hpp>
+#include <texttrace.hpp>
+#include <tracepower.hpp>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace MetaSim;
+using namespace RTSim;
+
+namespace {
+
+    struct Options {
+        int reps;
+        long horizon;
+        bool json;
+        string filter;
+        double maxSlowdown;
+
+        Options() : reps(3), horizon(200000), json(false), filter(), 
+                    maxSlowdown(0) {}
+    };
+
+    Options opt;
+
+    enum Kind { NONE, JAVA_MEM, JAVA_FILE, CHUNKED, CHUNKED_COMPACT, FLIGHT,
+                JSON, NDJSON, TEXT, TEXT_ASYNC, CHROME, POWER, KINDS };
+
+    const char *kindNames[KINDS] = {
+        "none", "java_mem", "java_file", "chunked", "chunked_compact", "flight_recorder",
+        "json", "ndjson", "text", "text_async", "chrome", "power"
+    };
+
+    const char *FILE_NAME = "trace_bench.out";
+
+    long peakRSS()
+    {
+#ifndef _WIN32
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+        return ru.ru_maxrss / 1024;
+#else
+        return ru.ru_maxrss;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    long fileSize(const char *name)
+    {
+        ifstream f(name, ios::binary | ios::ate);
+        return f ? long(f.tellg()) : 0;
+    }
+
+    struct Result {
+        double wall;
+        uint64_t events;
+        long bytes;
+    };
+
+    /// simulates the workload with a trace of kind k
+    Result simulate(Kind k)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        SimMetrics m(1 << 20);
+        SIMUL.setMetrics(&m);
+
+        CPU cpu("cpu0");
+        EDFScheduler sched;
+        RTKernel kern(&sched, "kernel", &cpu);
+
+        // the same task set at every run
+        uint64_t s = 88172645463325252ULL;
+        vector<unique_ptr<PeriodicTask> > ts;
+        for (int i = 0; i < 50; ++i) {
+            s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+            long period = 100 + long(s % 901);
+            stringstream name, code;
+            name << "t" << i;
+            code << "fixed(" << max(1L, long(0.9 / 50 * period)) << ");";
+            ts.push_back(unique_ptr<PeriodicTask>(
+                new PeriodicTask(period, period, 0, name.str())));
+            ts.back()->insertCode(code.str());
+            ts.back()->setAbort(false);
+            kern.addTask(*ts.back(), "");
+        }
+
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        {
+            unique_ptr<JavaTrace> jt;
+            unique_ptr<JSONTrace> json;
+            unique_ptr<TextTrace> text;
+            unique_ptr<ChromeTrace> chrome;
+            unique_ptr<FlightRecorder> flight;
+            unique_ptr<TracePowerConsumption> power;
+            char powerFile[] = "trace_bench.out";
+
+            switch (k) {
+            case JAVA_MEM: jt.reset(new JavaTrace(FILE_NAME, false)); break;
+            case JAVA_FILE: jt.reset(new JavaTrace(FILE_NAME)); break;
+            case CHUNKED: jt.reset(new ChunkedTrace(FILE_NAME)); break;
+            case CHUNKED_COMPACT: 
+                jt.reset(new ChunkedTrace(FILE_NAME, 1 << 20, ChunkedTrace::COMPACT_RECORDS));
+                break;
+            case FLIGHT: flight.reset(new FlightRecorder(FILE_NAME)); break;
+            case JSON: json.reset(new JSONTrace(FILE_NAME)); break;
+            case NDJSON: 
+                json.reset(new JSONTrace(FILE_NAME, JSONTrace::NDJSON)); 
+                break;
+            case TEXT: text.reset(new TextTrace(FILE_NAME)); break;
+            case TEXT_ASYNC: text.reset(new TextTrace(FILE_NAME, true)); break;
+            case CHROME: chrome.reset(new ChromeTrace(FILE_NAME)); break;
+            case POWER: 
+                power.reset(new TracePowerConsumption(&cpu, 10, powerFile));
+                break;
+            default: break;
+            }
+            for (size_t i = 0; i < ts.size(); ++i) {
+                if (jt) ts[i]->setTrace(jt.get());
+                if (flight) flight->attachToTask(ts[i].get());
+                if (json) json->attachToTask(ts[i].get());
+                if (text) text->attachToTask(ts[i].get());
+                if (chrome) chrome->attachToTask(ts[i].get());
+            }
+
+            SIMUL.initSingleRun();
+            SIMUL.run_to(opt.horizon);
+            SIMUL.endSingleRun();
+            // the traces are flushed here
+            if (jt) jt->close();
+        }
+        Result r;
+        r.wall = chrono::duration<double>(
+            chrono::steady_clock::now() - t0).count();
+        r.events = m.getEvents();
+        r.bytes = fileSize(FILE_NAME);
+        SIMUL.setMetrics(NULL);
+        ts.clear();
+        remove(FILE_NAME);
+        return r;
+    }
+
+    bool selected(const string &n)
+    {
+        return opt.filter.empty() || n.find(opt.filter) != string::npos;
+    }
+
+    void usage(const char *prog)
+    {
+        cerr << "Usage: " << prog << " [--reps N] [--horizon T]"
+             << " [--format csv|json] [--filter NAME] [--max-slowdown X]" 
+             << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        if (a == "--reps") opt.reps = max(1, atoi(argv[++i]));
+        else if (a == "--horizon") opt.horizon = max(1000L, atol(argv[++i]));
+        else if (a == "--format") opt.json = string(argv[++i]) == "json";
+        else if (a == "--filter") opt.filter = argv[++i];
+        else if (a == "--max-slowdown") opt.maxSlowdown = atof(argv[++i]);
+        else usage(argv[0]);
+    }
+
+    int status = 0;
+    if (!opt.json)
+        cout << "trace,events,wall_s,slowdown,bytes,bytes_per_event" << endl;
+
+    double base = 0;
+    long rss = peakRSS();
+    // the in-memory trace runs right after the untraced one, so
+    // that the growth of the peak RSS is its own
+    for (int k = NONE; k < KINDS; ++k) {
+        if (k != NONE && !selected(kindNames[k])) continue;
+        Result best;
+        for (int r = 0; r < opt.reps; ++r) {
+            Result res = simulate(Kind(k));
+            if (k == JAVA_MEM && r == 0) 
+                res.bytes = (peakRSS() - rss) * 1024;
+            else if (k == JAVA_MEM) res.bytes = best.bytes;
+            if (r == 0 || res.wall < best.wall) best = res;
+        }
+        if (k == NONE) {
+            base = best.wall;
+            rss = peakRSS();
+        }
+
+        double slowdown = best.wall / base;
+        double bpe = best.events ? double(best.bytes) / best.events : 0;
+        if (opt.json)
+            cout << "{\"trace\":\"" << kindNames[k] << "\",\"events\":" 
+                 << best.events << ",\"wall_s\":" << best.wall 
+                 << ",\"slowdown\":" << slowdown << ",\"bytes\":" 
+                 << best.bytes << ",\"bytes_per_event\":" << bpe << "}" 
+                 << endl;
+        else
+            cout << kindNames[k] << "," << best.events << "," << best.wall 
+                 << "," << slowdown << "," << best.bytes << "," << bpe 
+                 << endl;
+
+        if (opt.maxSlowdown > 0 && slowdown > opt.maxSlowdown) {
+            cerr << kindNames[k] << ": slowdown " << slowdown 
+                 << " exceeds " << opt.maxSlowdown << endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -195,6 +195,8 @@ void read_tasks(const string & data_file, System & s)
 
 void create_feedback(const string & fback_file, Supervisor * super)
 {
+	// the requests of the same tick reach the supervisor at once
+	BudgetBatch *batch = new BudgetBatch(super, "batch");
 	string line;
 	int count = 0;
 	ifstream f(fback_file.c_str());
@@ -240,7 +242,7 @@ void create_feedback(const string & fback_file, Supervisor * super)
 			    new FeedbackModuleARSim(task_name + "_FTM");
 			//      DBGPRINT("Setting controller params: " << controller_params);
 			ftm1->setControllerParams(controller_params);
-			ftm1->setSupervisor(super, server);
+			ftm1->setBatch(batch, server);
 			ftm1->setTask(mytask);
 			mytask->setFeedbackModule(ftm1);
 		}
@@ -9,11 +9,13 @@
 #include <rttask.hpp>
 #include <instr.hpp>
 #include <taskstat.hpp>
+#include <splitting.hpp>
 
 using namespace MetaSim;
 using namespace RTSim;
 
 #define NRUNS  10000
+#define NSPLIT 30
 
 int main()
 {
@@ -85,6 +87,26 @@ int main()
 	cout << "Total count = " << count << endl;
 	cout << "DM Perc     = " << double(count) / NRUNS * 100 << endl;
 	cout << "Corr.       = " << (1 - double(count) / NRUNS) * 100 << endl;
+
+	// the same probability by splitting, on the lateness of
+	// the pending jobs (see MissImportance): each run gives an
+	// unbiased estimate, collected by the MissPercentage
+	MissImportance imp;
+	imp.attachToTask(&t1);
+	imp.attachToTask(&t2);
+	imp.attachToTask(&t3);
+
+	double levels[] = { -3, -2, -1, 1 };
+	Splitting split([&imp]() { return imp(); },
+			vector<double>(levels, levels + 4), 1000);
+	MissPercentage mp("split");
+	split.setStat(&mp);
+
+	SIMUL.initRuns(NSPLIT);
+	for (int i=0; i<NSPLIT; i++) split.run(1001);
+	SIMUL.endSim();
+	cout << "Split Perc  = " << mp.getMean() * 100 << " +- "
+	     << mp.getConfInterval() * 100 << endl;
     } catch (BaseExc &e) {
         cout << e.what() << endl;
     } 
@@ -64,7 +64,7 @@ namespace RTSim {
 				par_list.push_back(string(getName()));
 
 
-				auto_ptr<RTSim::Instr> curr = genericFactory<RTSim::Instr>::instance().create(token, par_list);
+				unique_ptr<RTSim::Instr> curr = genericFactory<RTSim::Instr>::instance().create(token, par_list);
 
 				RTSim::Instr* curr_instr = curr.release();
 				
@@ -85,8 +85,15 @@ namespace RTSim {
 		if (instr.size() != Omegaminus.size() || instr.size() != Omegaplus.size())
 			throw WrongParameterSize("instruction, OmegaPlus and OmegaMinus sizes must be all equal to the max mode number");
 		buildInstr(instr);
-		OmegaPlus.assign(Omegaplus.begin(),Omegaplus.end());
-		OmegaMinus.assign(Omegaminus.begin(), Omegaminus.end());
+		setModeTable(Omegaplus, Omegaminus);
+	}
+
+	void AVRTask::setModeTable(const vector<double> &OmegaP, const vector<double> &OmegaM) throw(WrongParameterSize)
+	{
+		if (!std::is_sorted(OmegaP.begin(), OmegaP.end()) || !std::is_sorted(OmegaM.begin(), OmegaM.end()))
+			throw WrongParameterSize("OmegaPlus and OmegaMinus must be sorted by mode");
+		OmegaPlus.assign(OmegaP.begin(), OmegaP.end());
+		OmegaMinus.assign(OmegaM.begin(), OmegaM.end());
 		std::transform(OmegaPlus.begin(), OmegaPlus.end(), OmegaPlus.begin(), std::bind1st(std::multiplies<double>(), 2 * M_PI / 60));
 		std::transform(OmegaMinus.begin(), OmegaMinus.end(), OmegaMinus.begin(), std::bind1st(std::multiplies<double>(), 2 * M_PI / 60));
 	}
@@ -109,7 +116,7 @@ namespace RTSim {
 
 	//not to be called when task is active
 	//only when a job is finished and before activate the next one
-	void AVRTask::changeStatus(double angper, double angphase, double angdl, vector<string> instr, vector<double> OmegaM, vector<double> OmegaP) throw (TaskAlreadyActive){
+	void AVRTask::changeStatus(double angper, double angphase, double angdl, vector<string> instr, vector<double> OmegaM, vector<double> OmegaP) throw (TaskAlreadyActive, WrongParameterSize){
 		if (instr.size() != OmegaM.size() || instr.size() != OmegaP.size())
 			throw WrongParameterSize("instruction, OmegaPlus and OmegaMinus sizes must be all equal to the max mode number");
 		if (isActive())
@@ -118,28 +125,51 @@ namespace RTSim {
 		AngularPhase = angphase;
 		AngularDl = angdl;
 		buildInstr(instr);
-		OmegaPlus.assign(OmegaP.begin(), OmegaP.end());
-		OmegaMinus.assign(OmegaM.begin(), OmegaM.end());
-		std::transform(OmegaPlus.begin(), OmegaPlus.end(), OmegaPlus.begin(), std::bind1st(std::multiplies<double>(), 2 * M_PI / 60));
-		std::transform(OmegaMinus.begin(), OmegaMinus.end(), OmegaMinus.begin(), std::bind1st(std::multiplies<double>(), 2 * M_PI / 60));
+		setModeTable(OmegaP, OmegaM);
 	}
 
-	void AVRTask::handleArrival(Tick arr)
+	int AVRTask::getMode(double omega) const throw (ModeOutOfIndex)
 	{
-		setRelDline(*(BufferedDeadlines.begin()));
-		BufferedDeadlines.erase(BufferedDeadlines.begin());
-		
-		mode = *(BufferedModes.begin());
-		BufferedModes.erase(BufferedModes.begin());
+		vector<double>::const_iterator m = std::lower_bound(OmegaPlus.begin(), OmegaPlus.end(), omega);
+		if (m == OmegaPlus.end())
+			throw ModeOutOfIndex("Angular velocity above the last mode");
+		return m - OmegaPlus.begin();
+	}
 
-		instrQueue.clear();
+	int AVRTask::getMode(double omega, int current) const throw (ModeOutOfIndex)
+	{
+		if (current >= (int)OmegaPlus.size() || current < 0)
+			throw ModeOutOfIndex("Mode Index out of range");
+		if (omega > OmegaPlus[current])
+			return getMode(omega);
+		if (omega < OmegaMinus[current]) {
+			//last mode whose OmegaMinus is not above omega, or the first one
+			int m = std::upper_bound(OmegaMinus.begin(), OmegaMinus.end(), omega) - OmegaMinus.begin();
+			return m > 0 ? m - 1 : 0;
+		}
+		return current;
+	}
 
-		vector<RTSim::Instr*> myCurrInstr = myInstr.at(mode);
-		vector<RTSim::Instr*>::iterator j = myCurrInstr.begin();
-		while (j!=myCurrInstr.end()){
-			addInstr(*j);
-			j++;
+	void AVRTask::getModes(const vector<double> &omega, vector<int> &modes, int current) const throw (ModeOutOfIndex)
+	{
+		modes.resize(omega.size());
+		for (unsigned int i = 0; i < omega.size(); ++i) {
+			current = getMode(omega[i], current);
+			modes[i] = current;
 		}
+	}
+
+	void AVRTask::handleArrival(Tick arr)
+	{
+		setRelDline(BufferedDeadlines.front());
+		BufferedDeadlines.pop_front();
+		
+		mode = BufferedModes.front();
+		BufferedModes.pop_front();
+
+		//the programs are precompiled: reuse the queue storage
+		const vector<RTSim::Instr*> &myCurrInstr = myInstr.at(mode);
+		instrQueue.assign(myCurrInstr.begin(), myCurrInstr.end());
 	
 		Task::handleArrival(arr);
 
@@ -162,7 +192,7 @@ namespace RTSim {
 			throw ModeOutOfIndex("Mode Index out of range");
 		Tick tt = 0;
 		
-		vector<RTSim::Instr*> myCurrInstr = myInstr.at(index);
+		const vector<RTSim::Instr*> &myCurrInstr = myInstr.at(index);
 		ConstInstrIterator i = myCurrInstr.begin();
 		while (i != myCurrInstr.end()) {
 				tt += (*i)->getWCET();
@@ -35,13 +35,35 @@ namespace RTSim {
       for a kernel to schedule a task.
   */
     class AbsTask {
+        unsigned long _handleOwner;
+        void *_handle;
+
     public:
+        AbsTask() : _handleOwner(0), _handle(0) {}
+
 	/**
 	   Virtual destructor. It avoids a warning for the presence of
 	   virtual functions.
 	*/
 	virtual ~AbsTask() {}
 
+        /**
+           An opaque handle that a scheduler stores in the task, to
+           find its own data about the task without a lookup. The
+           owner is a non-zero number that identifies the
+           scheduler: a handle set by another owner is not returned
+           (NULL). Pass owner 0 to free the slot.
+        */
+        void setSchedHandle(unsigned long owner, void *h) {
+            _handleOwner = owner;
+            _handle = owner ? h : 0;
+        }
+        void *getSchedHandle(unsigned long owner) const {
+            return (owner != 0 && _handleOwner == owner) ? _handle : 0;
+        }
+        /// The owner of the handle (0 if nobody has set it)
+        unsigned long getSchedHandleOwner() const { return _handleOwner; }
+
 	/**
 	   Called when the task is scheduled to execute.
 	*/
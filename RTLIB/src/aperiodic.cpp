@@ -0,0 +1,229 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <simul.hpp>
+
+#include <abskernel.hpp>
+#include <aperiodic.hpp>
+#include <cpu.hpp>
+#include <taskevt.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    void AperiodicEvt::doit()
+    {
+        _src->onEvent();
+    }
+
+    AperiodicSource::AperiodicSource(RandomVar *iat, RandomVar *cost, Tick rdl,
+                                     const std::string &name, size_t maxPending) :
+        Entity(name), _queue(maxPending == 0 ? size_t(-1) : maxPending),
+        _lost(0), _iat(iat), _cost(cost),
+        _begin(NULL), _end(NULL), _next(NULL),
+        _rdl(rdl), _kernel(NULL), _state(IDLE),
+        _arrival(0), _lastArrival(0), _nextArrival(0), _dl(0),
+        _jobCost(0), _done(0), _execd(0), _lastSched(0), _endTime(0),
+        _speed(CPU::SPEED_ONE), evt(this)
+    {
+    }
+
+    AperiodicSource::AperiodicSource(const WorkloadTrace &w, uint32_t task, Tick rdl,
+                                     const std::string &name, size_t maxPending) :
+        Entity(name), _queue(maxPending == 0 ? size_t(-1) : maxPending),
+        _lost(0), _iat(), _cost(),
+        _begin(w.begin(task)), _end(w.end(task)), _next(NULL),
+        _rdl(rdl), _kernel(NULL), _state(IDLE),
+        _arrival(0), _lastArrival(0), _nextArrival(0), _dl(0),
+        _jobCost(0), _done(0), _execd(0), _lastSched(0), _endTime(0),
+        _speed(CPU::SPEED_ONE), evt(this)
+    {
+    }
+
+    void AperiodicSource::newRun()
+    {
+        _queue.clear();
+        _lost = 0;
+        _state = IDLE;
+        _execd = 0;
+        _dl = 0;
+        _lastArrival = _arrival = 0;
+        if (_iat.get()) _nextArrival = Tick(_iat->draw());
+        else {
+            _next = _begin;
+            _nextArrival = _next != _end ? Tick(_next->arrival) : Tick(MAXTICK);
+        }
+        repost();
+    }
+
+    void AperiodicSource::endRun()
+    {
+        evt.drop();
+    }
+
+    void AperiodicSource::setKernel(AbsKernel *k) throw(KernAlreadySet)
+    {
+        if (_kernel != NULL) throw KernAlreadySet();
+        _kernel = k;
+    }
+
+    Tick AperiodicSource::getMaxExecutionTime() const
+    {
+        if (_cost.get()) return Tick(_cost->getMaximum());
+        Tick m = 0;
+        for (const WorkloadTrace::Record *r = _begin; r != _end; ++r)
+            if (Tick(r->demand) > m) m = Tick(r->demand);
+        return m;
+    }
+
+    Tick AperiodicSource::getExecTime() const
+    {
+        if (_state == EXEC) return _execd + SIMUL.getTime() - _lastSched;
+        return _execd;
+    }
+
+    void AperiodicSource::advance()
+    {
+        if (_iat.get()) {
+            _nextArrival += Tick(_iat->draw());
+            return;
+        }
+        ++_next;
+        _nextArrival = _next != _end ? Tick(_next->arrival) : Tick(MAXTICK);
+    }
+
+    void AperiodicSource::newJob(const Request &r)
+    {
+        _arrival = r.arrival;
+        _dl = _rdl == 0 ? Tick(MAXTICK) : r.arrival + _rdl;
+        _jobCost = r.cost;
+        _done = 0;
+        _execd = 0;
+        _state = READY;
+    }
+
+    void AperiodicSource::setEndTime(Tick t)
+    {
+        int64_t left = int64_t(_jobCost) * CPU::SPEED_ONE - _done;
+        _endTime = t;
+        if (left > 0) _endTime += Tick((left + _speed - 1) / _speed);
+    }
+
+    void AperiodicSource::repost()
+    {
+        Tick t = _nextArrival;
+        int p = Event::_DEFAULT_PRIORITY;
+
+        if (_state == EXEC && _endTime <= t) {
+            t = _endTime;
+            p = EndEvt::_END_EVT_PRIORITY;
+        }
+        evt.drop();
+        if (t == MAXTICK) return;
+        evt.setPriority(p);
+        evt.post(t);
+    }
+
+    void AperiodicSource::enqueue(const Request &r)
+    {
+        if (isActive()) {
+            if (!_queue.push_back(r)) _lost++;
+        }
+        else {
+            newJob(r);
+            _kernel->onArrival(this);
+        }
+    }
+
+    void AperiodicSource::endJob()
+    {
+        Tick t = SIMUL.getTime();
+
+        _execd += t - _lastSched;
+        _lastArrival = _arrival;
+        _kernel->onEnd(this);
+        _state = IDLE;
+
+        if (!_queue.empty()) {
+            newJob(_queue.front());
+            _queue.pop_front();
+            _kernel->onArrival(this);
+        }
+    }
+
+    void AperiodicSource::onEvent()
+    {
+        Tick t = SIMUL.getTime();
+
+        evt._end = false;
+        if (_state == EXEC && _endTime <= t) {
+            evt._end = true;
+            endJob();
+        }
+        if (_nextArrival <= t) {
+            Request r;
+            r.arrival = t;
+            r.cost = _cost.get() ? Tick(_cost->draw()) : Tick(_next->demand);
+            enqueue(r);
+            advance();
+        }
+        repost();
+    }
+
+    void AperiodicSource::schedule()
+    {
+        Tick t = SIMUL.getTime();
+
+        _state = EXEC;
+        _lastSched = t;
+        _speed = _kernel->getProcessor(this)->getFixedSpeed();
+        setEndTime(t);
+        repost();
+    }
+
+    void AperiodicSource::deschedule()
+    {
+        Tick t = SIMUL.getTime();
+
+        if (_state == EXEC) {
+            _done += int64_t(t - _lastSched) * _speed;
+            _execd += t - _lastSched;
+            _state = READY;
+        }
+        repost();
+    }
+
+    void AperiodicSource::refreshExec(double oldSpeed, double newSpeed)
+    {
+        Tick t = SIMUL.getTime();
+
+        _done += int64_t(t - _lastSched) * CPU::toFixedSpeed(oldSpeed);
+        _execd += t - _lastSched;
+        _lastSched = t;
+        _speed = CPU::toFixedSpeed(newSpeed);
+        setEndTime(t);
+        repost();
+    }
+
+    void AperiodicSource::activate()
+    {
+        Request r;
+        r.arrival = SIMUL.getTime();
+        r.cost = _cost.get() ? Tick(_cost->draw()) : getMaxExecutionTime();
+        enqueue(r);
+        repost();
+    }
+
+} // namespace RTSim
@@ -0,0 +1,203 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __APERIODIC_HPP__
+#define __APERIODIC_HPP__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include <entity.hpp>
+#include <event.hpp>
+#include <memstats.hpp>
+#include <randomvar.hpp>
+#include <ringbuf.hpp>
+
+#include <abstask.hpp>
+#include <replaytask.hpp>
+#include <task.hpp>
+#include <taskexc.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    class AbsKernel;
+    class AperiodicSource;
+
+    /**
+       \ingroup task
+
+       The only event of an AperiodicSource: it is posted at the
+       next request or at the end of the current job, whichever
+       comes first; isJobEnd() tells the probes whether a job has
+       ended when the event was processed.
+    */
+    class AperiodicEvt : public Event {
+        AperiodicSource *_src;
+        bool _end;
+
+        friend class AperiodicSource;
+    public:
+        AperiodicEvt(AperiodicSource *s) : Event(), _src(s), _end(false) {}
+
+        AperiodicSource *getSource() const { return _src; }
+
+        /// True if a job ended at the last processing of the event
+        bool isJobEnd() const { return _end; }
+
+        virtual void doit();
+    };
+
+    /**
+       \ingroup task
+
+       An open stream of aperiodic requests, for loading a server
+       (a CBServer, a PollingServer, a SporadicServer...) without a
+       Task for each request: the requests arrive with random
+       interarrival times and costs, or at the times (and with the
+       execution times) of the jobs of a task in a WorkloadTrace.
+
+       The source is added to the server as a task, and its jobs
+       are served one at a time in FIFO order: a request that
+       arrives while a job is active waits in a queue of small
+       records (arrival and cost), whose storage is reused from one
+       request to the next, with at most maxPending of them (0 for
+       no limit; the requests beyond it are lost, see
+       getLostRequests()). As for a LightTask, a single event
+       handles both the arrivals and the ends of the jobs, so the
+       memory does not depend on the number of requests.
+
+       <pre>
+       CBServer serv(2, 10, 10, true, "serv", "FIFOSched");
+       AperiodicSource src(new ExponentialVar(20), new UniformVar(1, 3));
+       serv.addTask(src);
+       FinishingTimeStat<StatMean> resp("response");
+       resp.attachToTask(&src);
+       </pre>
+
+       The costs are in cycles at the nominal speed, as the ones
+       of an ExecInstr. A request has the relative deadline rdl (0
+       means no deadline). The response time of a job goes from
+       the arrival of its request to its end, including the time
+       spent in the queue.
+    */
+    class AperiodicSource : public Entity, public AbsRTTask {
+        typedef enum { IDLE, READY, EXEC } State;
+
+        struct Request {
+            Tick arrival;
+            Tick cost;
+        };
+
+        ring_buffer<Request, TrackedAllocator<Request, ArrivalMem> > _queue;
+        long _lost;
+
+        unique_ptr<RandomVar> _iat;
+        unique_ptr<RandomVar> _cost;
+        /// the jobs replayed (from a WorkloadTrace), or NULL
+        const WorkloadTrace::Record *_begin, *_end, *_next;
+
+        Tick _rdl;
+        AbsKernel *_kernel;
+        State _state;
+
+        Tick _arrival;
+        Tick _lastArrival;
+        Tick _nextArrival;
+        Tick _dl;
+
+        /// cost of the current job, and work already done (in fixed
+        /// point, see CPU::SPEED_ONE)
+        Tick _jobCost;
+        int64_t _done;
+        /// ticks executed by the current job before _lastSched
+        Tick _execd;
+        Tick _lastSched;
+        Tick _endTime;
+        int64_t _speed;
+
+        /// the time of the request after the one at _nextArrival
+        void advance();
+        void newJob(const Request &r);
+        void endJob();
+        /// starts r, or queues it if a job is active
+        void enqueue(const Request &r);
+        /// end of the current job, executing from t at _speed
+        void setEndTime(Tick t);
+        void repost();
+
+        friend class AperiodicEvt;
+        void onEvent();
+
+        AperiodicSource(const AperiodicSource &);
+        AperiodicSource &operator=(const AperiodicSource &);
+
+    public:
+        AperiodicEvt evt;
+
+        /**
+           Requests with interarrival times drawn from iat and
+           costs drawn from cost, both owned by the source; the
+           first request arrives after the first interarrival time.
+        */
+        AperiodicSource(RandomVar *iat, RandomVar *cost, Tick rdl = 0,
+                        const std::string &name = "", size_t maxPending = 0);
+
+        /// Replays the jobs of task in w, which must outlive the source
+        AperiodicSource(const WorkloadTrace &w, uint32_t task, Tick rdl = 0,
+                        const std::string &name = "", size_t maxPending = 0);
+
+        /// Requests waiting for the current job to end
+        size_t getPending() const { return _queue.size(); }
+
+        /// Requests lost in this run, because the queue was full
+        long getLostRequests() const { return _lost; }
+
+        /// Time executed by the current (or last) job
+        Tick getExecTime() const;
+
+        /**
+           Releases a request now, out of the stream, with a cost
+           drawn from the distribution (with the largest cost of
+           the trace, when replaying one).
+        */
+        virtual void activate();
+
+        // from AbsTask
+        virtual void schedule();
+        virtual void deschedule();
+        virtual bool isActive() const { return _state != IDLE; }
+        virtual bool isExecuting() const { return _state == EXEC; }
+        virtual Tick getArrival() const { return _arrival; }
+        virtual Tick getLastArrival() const { return _lastArrival; }
+        virtual void setKernel(AbsKernel *k) throw(KernAlreadySet);
+        virtual AbsKernel *getKernel() { return _kernel; }
+        virtual void refreshExec(double oldSpeed, double newSpeed);
+        virtual Tick getMaxExecutionTime() const;
+
+        // from AbsRTTask
+        virtual Tick getDeadline() const { return _dl; }
+        virtual Tick getRelDline() const { return _rdl; }
+        virtual int getTaskNumber() const { return getID(); }
+
+        // from Entity
+        virtual void newRun();
+        virtual void endRun();
+    };
+
+} // namespace RTSim
+
+#endif
@@ -0,0 +1,150 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrono>
+
+#include <asyncstats.hpp>
+#include <simul.hpp>
+
+namespace RTSim {
+
+  namespace {
+    /// spins a few times, then yields, then sleeps
+    void backoff(int &n)
+    {
+      if (++n < 64) return;
+      if (n < 256) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  AsyncJobStats::AsyncJobStats(const string &name, size_t capacity)
+    : Trace("", Trace::BINARY, false), JobTrace("", false), Entity(name),
+      _measures(), _sinks(), _slots(), _mask(0), _head(0), _tail(0),
+      _seenHead(0), _stop(false), _failed(false), _error(), _thread(), _ctx()
+  {
+    size_t n = 1;
+    while (n < capacity) n <<= 1;
+    _slots.resize(n);
+    _mask = n - 1;
+  }
+
+  AsyncJobStats::~AsyncJobStats()
+  {
+    if (!_thread.joinable()) return;
+    _stop.store(true, memory_order_release);
+    _thread.join();
+  }
+
+  void AsyncJobStats::addMeasure(BaseStat &s, Field f)
+  {
+    Measure m = { &s, f };
+    _measures.push_back(m);
+  }
+
+  void AsyncJobStats::addSink(const Sink &s)
+  {
+    _sinks.push_back(s);
+  }
+
+  void AsyncJobStats::write(const JobRecord &r)
+  {
+    if (Tick(r.arrival + r.finish) < SimContext::current()->transitory) return;
+    if (!_thread.joinable())
+      _thread = std::thread(&AsyncJobStats::loop, this);
+
+    uint64_t t = _tail.load(memory_order_relaxed);
+    int n = 0;
+    while (t - _seenHead > _mask) {
+      _seenHead = _head.load(memory_order_acquire);
+      if (t - _seenHead <= _mask) break;
+      backoff(n);
+    }
+    _slots[t & _mask] = r;
+    _tail.store(t + 1, memory_order_release);
+  }
+
+  void AsyncJobStats::consume(const JobRecord &r)
+  {
+    bool killed = (r.flags & JobRecord::KILLED) != 0;
+    for (size_t i = 0; i < _measures.size(); ++i) {
+      const Measure &m = _measures[i];
+      if (killed && m.field != LATE) continue;
+      double late = double(r.finish) - r.deadline;
+      switch (m.field) {
+      case RESPONSE: m.stat->record(r.finish); break;
+      case LATENESS: m.stat->record(late); break;
+      case TARDINESS: m.stat->record(late > 0 ? late : 0); break;
+      case EXECUTED: m.stat->record(r.executed); break;
+      case PREEMPTIONS: m.stat->record(r.preemptions); break;
+      case LATE: m.stat->record(killed || r.isLate() ? 1 : 0); break;
+      }
+    }
+    for (size_t i = 0; i < _sinks.size(); ++i) _sinks[i](r);
+  }
+
+  void AsyncJobStats::loop()
+  {
+    SimContext::Scope scope(&_ctx);
+    uint64_t h = _head.load(memory_order_relaxed);
+    int n = 0;
+    while (true) {
+      uint64_t t = _tail.load(memory_order_acquire);
+      if (h == t) {
+        if (_stop.load(memory_order_acquire) &&
+            h == _tail.load(memory_order_acquire)) break;
+        backoff(n);
+        continue;
+      }
+      n = 0;
+      for (; h != t; ++h) {
+        // after an error, the records are only discarded
+        if (!_failed.load(memory_order_relaxed)) {
+          try {
+            consume(_slots[h & _mask]);
+          } catch (...) {
+            _error = current_exception();
+            _failed.store(true, memory_order_release);
+          }
+        }
+        _head.store(h + 1, memory_order_release);
+      }
+    }
+  }
+
+  void AsyncJobStats::flush()
+  {
+    if (!_thread.joinable()) return;
+    uint64_t t = _tail.load(memory_order_relaxed);
+    int n = 0;
+    while (_head.load(memory_order_acquire) != t) backoff(n);
+    _seenHead = t;
+    if (_failed.load(memory_order_acquire)) {
+      exception_ptr e = _error;
+      _error = exception_ptr();
+      _failed.store(false, memory_order_release);
+      rethrow_exception(e);
+    }
+  }
+
+  void AsyncJobStats::newRun()
+  {
+    clear();
+  }
+
+  void AsyncJobStats::endRun()
+  {
+    flush();
+  }
+
+} // namespace RTSim
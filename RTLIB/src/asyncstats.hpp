@@ -0,0 +1,147 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ASYNCSTATS_HPP__
+#define __ASYNCSTATS_HPP__
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <jobtrace.hpp>
+#include <simcontext.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  /**
+     \ingroup util
+
+     Moves the statistics of the jobs off the simulation thread:
+     the simulation only builds the record of each completed job
+     (as a JobTrace, see JobRecord) and puts it in a ring with a
+     single producer and a single consumer, and a helper thread
+     takes the records from the ring and updates the measures
+     attached to the pipeline, and calls its sinks.
+
+     <pre>
+     AsyncJobStats pipe;
+     StatMean resp("resp");
+     StatMax late("late");
+     pipe.addMeasure(resp, AsyncJobStats::RESPONSE);
+     pipe.addMeasure(late, AsyncJobStats::LATENESS);
+     pipe.addSink([&](const JobRecord &r) { hist.add(r.finish); });
+     for (Task *t : tasks) pipe.attachToTask(t);
+     SIMUL.run(100000);
+     </pre>
+
+     The jobs that end before the transitory are not passed to the
+     thread. At the end of each run (see endRun(), which is called
+     before the stats are collected) the pipeline waits for the
+     ring to drain, so the values of the run are complete when they
+     are collected; flush() does the same at any time.
+
+     The measures and the sinks are updated concurrently with the
+     simulation: they must not be read while it runs (e.g. by a
+     stop predicate, or a snapshot), nor be attached to an event
+     of the model as well.
+  */
+  class AsyncJobStats : public JobTrace, public Entity {
+  public:
+    typedef std::function<void (const JobRecord &)> Sink;
+
+    /// The value of a job passed to a measure
+    enum Field {
+      /// finishing time minus arrival
+      RESPONSE,
+      /// finishing time minus absolute deadline
+      LATENESS,
+      /// the lateness, if positive, 0 otherwise
+      TARDINESS,
+      /// execution time
+      EXECUTED,
+      PREEMPTIONS,
+      /// 1 if the job missed its deadline (or was killed), 0 otherwise
+      LATE
+    };
+
+    /// capacity is rounded up to a power of two
+    AsyncJobStats(const string &name = "asyncstats", size_t capacity = 1 << 12);
+    virtual ~AsyncJobStats();
+
+    /// Records f of each job in s (before the simulation starts)
+    void addMeasure(BaseStat &s, Field f);
+
+    /// Adds a sink (before the simulation starts)
+    void addSink(const Sink &s);
+
+    /**
+       Waits until all the records emitted so far have been
+       consumed, and rethrows the first exception raised by a
+       measure or a sink.
+    */
+    void flush();
+
+    virtual void newRun();
+    virtual void endRun();
+
+  protected:
+    virtual void write(const JobRecord &r);
+
+  private:
+    struct Measure {
+      BaseStat *stat;
+      Field field;
+    };
+
+    vector<Measure> _measures;
+    vector<Sink> _sinks;
+
+    vector<JobRecord> _slots;
+    size_t _mask;
+
+    /// written by the consumer
+    std::atomic<uint64_t> _head;
+    char _pad1[64 - sizeof(std::atomic<uint64_t>)];
+    /// written by the producer
+    std::atomic<uint64_t> _tail;
+    char _pad2[64 - sizeof(std::atomic<uint64_t>)];
+    /// the last head seen by the producer
+    uint64_t _seenHead;
+
+    std::atomic<bool> _stop;
+    std::atomic<bool> _failed;
+    exception_ptr _error;
+    std::thread _thread;
+
+    /// the context of the thread, so that the measures do not see
+    /// the time (and the transitory) of the simulation
+    SimContext _ctx;
+
+    void consume(const JobRecord &r);
+    void loop();
+
+    AsyncJobStats(const AsyncJobStats &);
+    AsyncJobStats &operator=(const AsyncJobStats &);
+  };
+
+} // namespace RTSim
+
+#endif
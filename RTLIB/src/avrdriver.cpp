@@ -0,0 +1,130 @@
+/***************************************************************************
+begin                : Mon Nov 3 15:54:58 CEST 2014
+copyright            : (C) 2014 Simoncelli Stefano
+email                : simoncelli.stefano@hotmail.it
+***************************************************************************/
+
+#include <cmath>
+#include <fstream>
+
+#include <simul.hpp>
+
+#include <AVRTask.hpp>
+#include <avrdriver.hpp>
+
+namespace RTSim {
+
+	using namespace std;
+	using namespace MetaSim;
+
+	AVRDriver::AVRDriver(AVRTask *t, double tps, const std::string &name)
+		: Entity(name), task(t), ticksPerSecond(tps), next(0),
+		  activationEvt(this, &AVRDriver::onActivation)
+	{
+	}
+
+	void AVRDriver::setProfile(const vector<Tick> &times, const vector<double> &rpm) throw(BaseExc)
+	{
+		if (times.size() != rpm.size())
+			throw BaseExc("times and rpm must have the same size", "AVRDriver", "avrdriver.cpp");
+		profTimes = times;
+		profRPM = rpm;
+		actTimes.clear();
+		actModes.clear();
+		actDeadlines.clear();
+	}
+
+	void AVRDriver::loadProfile(const std::string &fileName) throw(BaseExc)
+	{
+		ifstream in(fileName.c_str());
+		if (!in)
+			throw BaseExc("Cannot open " + fileName, "AVRDriver", "avrdriver.cpp");
+
+		vector<Tick> times;
+		vector<double> rpm;
+		double t, w;
+		while (in >> t >> w) {
+			times.push_back(Tick(t));
+			rpm.push_back(w);
+		}
+		if (!in.eof())
+			throw BaseExc("Malformed profile " + fileName, "AVRDriver", "avrdriver.cpp");
+		setProfile(times, rpm);
+	}
+
+	void AVRDriver::precompute()
+	{
+		actTimes.clear();
+		actModes.clear();
+		actDeadlines.clear();
+		if (profTimes.size() < 2) return;
+
+		const double period = task->getAngularPeriod();
+		const double angDl = task->getAngularDl();
+		const double radPerSecond = 2 * M_PI / 60;
+
+		// angle of the next activation, relative to the crank angle
+		// at the start of the current sample
+		double target = task->getAngularPhase();
+		int mode = -1;
+
+		for (unsigned int i = 0; i + 1 < profTimes.size(); ++i) {
+			const double omega = profRPM[i] * radPerSecond;
+			const double start = double(profTimes[i]);
+			const double span = double(profTimes[i + 1]) - start;
+			if (omega <= 0) continue;
+
+			// the speed is constant within the sample: all the
+			// activations of the sample share mode and deadline
+			const double ticksPerRad = ticksPerSecond / omega;
+			const double swept = span / ticksPerRad;
+			if (target >= swept) {
+				target -= swept;
+				continue;
+			}
+			mode = mode < 0 ? task->getMode(omega) : task->getMode(omega, mode);
+			const Tick rdl = Tick::floor(angDl * ticksPerRad);
+
+			// the tolerance keeps an activation falling on the end
+			// of the sample from being counted in both samples
+			const unsigned int n = (unsigned int)std::ceil((swept - target) / period - 1e-9);
+			const size_t first = actTimes.size();
+			actTimes.resize(first + n);
+			actModes.resize(first + n, mode);
+			actDeadlines.resize(first + n, rdl);
+			for (unsigned int k = 0; k < n; ++k)
+				actTimes[first + k] = Tick::floor(start + (target + k * period) * ticksPerRad + 0.5);
+
+			target += n * period - swept;
+		}
+	}
+
+	void AVRDriver::postNext()
+	{
+		if (next < actTimes.size())
+			activationEvt.post(actTimes[next]);
+	}
+
+	void AVRDriver::newRun()
+	{
+		if (actTimes.empty()) precompute();
+		next = 0;
+		postNext();
+	}
+
+	void AVRDriver::endRun()
+	{
+	}
+
+	void AVRDriver::onActivation(Event *e)
+	{
+		// activations rounded to the same tick are fed together
+		const Tick now = SIMUL.getTime();
+		while (next < actTimes.size() && actTimes[next] <= now) {
+			task->activate(actModes[next], actDeadlines[next]);
+			next++;
+		}
+		postNext();
+	}
+
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+begin                : Mon Nov 3 15:54:58 CEST 2014
+copyright            : (C) 2014 Simoncelli Stefano
+email                : simoncelli.stefano@hotmail.it
+***************************************************************************/
+
+#ifndef __AVRDRIVER_HPP__
+#define __AVRDRIVER_HPP__
+
+#include <string>
+#include <vector>
+
+#include <entity.hpp>
+#include <gevent.hpp>
+#include <tick.hpp>
+
+namespace RTSim {
+
+	using namespace std;
+	using namespace MetaSim;
+
+	class AVRTask;
+
+	/**
+	   Activates an AVRTask along an engine-speed profile.
+
+	   The profile is a sequence of samples (time, speed in RPM): the
+	   speed of a sample holds until the time of the next one, and the
+	   last sample only marks the end of the profile. Before the
+	   simulation starts, precompute() walks the whole profile once and
+	   stores, for every crossing of AngularPhase + k * AngularPeriod,
+	   the activation instant, the mode (with the hysteresis of
+	   AVRTask::getMode()) and the relative deadline covering AngularDl.
+	   During the simulation the driver only reads these tables.
+	*/
+	class AVRDriver : public Entity {
+	protected:
+		AVRTask *task;
+
+		/// converts the seconds of the speed to simulation ticks
+		double ticksPerSecond;
+
+		vector<Tick> profTimes;
+		vector<double> profRPM;
+
+		/// precomputed activations, one entry per job
+		vector<Tick> actTimes;
+		vector<int> actModes;
+		vector<Tick> actDeadlines;
+
+		/// next activation to be fed to the task
+		unsigned int next;
+
+		void postNext();
+
+	public:
+		GEvent<AVRDriver> activationEvt;
+
+		AVRDriver(AVRTask *t, double ticksPerSecond, const std::string &name = "");
+
+		/// times and rpm must have the same size, times sorted
+		void setProfile(const vector<Tick> &times, const vector<double> &rpm) throw(BaseExc);
+
+		/**
+		   Reads the profile from a text file with one "time rpm"
+		   sample per line. Throws a BaseExc if the file cannot be
+		   read.
+		*/
+		void loadProfile(const std::string &fileName) throw(BaseExc);
+
+		/// Fills the activation tables; called by newRun() if needed
+		void precompute();
+
+		const vector<Tick>& getActivationTimes() const { return actTimes; }
+		const vector<int>& getActivationModes() const { return actModes; }
+		const vector<Tick>& getActivationDeadlines() const { return actDeadlines; }
+
+		void onActivation(Event *e);
+
+		void newRun();
+		void endRun();
+	};
+
+}
+
+#endif
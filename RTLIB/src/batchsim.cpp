@@ -0,0 +1,316 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <batchsim.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    namespace {
+        const int64_t NEVER = numeric_limits<int64_t>::max();
+    }
+
+    /// A StatSummary loaded with the moments of a lane
+    class BatchSim::Moments : public StatSummary {
+    public:
+        Moments() : StatSummary() {}
+
+        void load(double n, double mean, double m2, double mn, double mx)
+            {
+                _count = n;
+                _val = mean;
+                _m2 = m2;
+                _min = mn;
+                _max = mx;
+            }
+    };
+
+    BatchSim::BatchSim(Policy p, int tasks, int lanes) :
+        _policy(p), _tasks(tasks), _lanes(lanes), _transitory(0),
+        _ctx(), _scratch(NULL)
+    {
+        if (tasks < 1 || tasks > MAX_TASKS) {
+            stringstream s;
+            s << "A lane has from 1 to " << MAX_TASKS << " tasks, not " << tasks;
+            throw BatchSimExc(s.str());
+        }
+        if (lanes < 1) throw BatchSimExc("No lanes");
+
+        size_t n = size_t(tasks) * lanes;
+        _period.assign(n, 0);
+        _deadline.assign(n, 0);
+        _phase.assign(n, 0);
+        _wcet.assign(n, 0);
+        _prio.resize(n);
+        for (int i = 0; i < tasks; ++i)
+            fill(_prio.begin() + i * lanes, _prio.begin() + (i + 1) * lanes, i);
+        _rel.resize(n);
+        _arr.resize(n);
+        _dl.resize(n);
+        _key.resize(n);
+        _ins.resize(n);
+        _rem.resize(n);
+        _lastSched.resize(n);
+        _pending.resize(n);
+        _active.resize(n);
+        _executed.resize(n);
+        _jobs.resize(n);
+        _late.resize(n);
+        _preemptions.resize(n);
+        for (int m = 0; m < MEASURES; ++m)
+            for (int j = 0; j < 5; ++j) _mom[m][j].resize(n);
+
+        _now.resize(lanes);
+        _next.resize(lanes);
+        _busy.resize(lanes);
+        _running.resize(lanes);
+        _bestKey.resize(lanes);
+        _bestIns.resize(lanes);
+        _best.resize(lanes);
+        _stepped.reserve(lanes);
+
+        SimContext::Scope scope(&_ctx);
+        _scratch = new Moments();
+        reset();
+    }
+
+    BatchSim::~BatchSim()
+    {
+        SimContext::Scope scope(&_ctx);
+        delete _scratch;
+    }
+
+    void BatchSim::setTask(int lane, int task, Tick period, Tick deadline,
+                           Tick phase, Tick wcet)
+    {
+        if (task < 0 || task >= _tasks) throw BatchSimExc("No such task");
+        if (lane >= _lanes) throw BatchSimExc("No such lane");
+        if (period <= 0 || wcet <= 0 || deadline <= 0)
+            throw BatchSimExc("The period, deadline and execution time must be positive");
+
+        int from = lane < 0 ? 0 : lane, to = lane < 0 ? _lanes : lane + 1;
+        for (int l = from; l < to; ++l) {
+            size_t k = size_t(task) * _lanes + l;
+            _period[k] = int64_t(period);
+            _deadline[k] = int64_t(deadline);
+            _phase[k] = int64_t(phase);
+            _wcet[k] = int64_t(wcet);
+        }
+    }
+
+    void BatchSim::setPriority(int lane, int task, int prio)
+    {
+        if (task < 0 || task >= _tasks) throw BatchSimExc("No such task");
+        if (lane >= _lanes) throw BatchSimExc("No such lane");
+
+        int from = lane < 0 ? 0 : lane, to = lane < 0 ? _lanes : lane + 1;
+        for (int l = from; l < to; ++l) _prio[size_t(task) * _lanes + l] = prio;
+    }
+
+    void BatchSim::reset()
+    {
+        _rel = _phase;
+        fill(_active.begin(), _active.end(), 0);
+        fill(_pending.begin(), _pending.end(), 0);
+        fill(_rem.begin(), _rem.end(), 0);
+        fill(_executed.begin(), _executed.end(), 0);
+        fill(_jobs.begin(), _jobs.end(), 0);
+        fill(_late.begin(), _late.end(), 0);
+        fill(_preemptions.begin(), _preemptions.end(), 0);
+        for (int m = 0; m < MEASURES; ++m)
+            for (int j = 0; j < 5; ++j)
+                fill(_mom[m][j].begin(), _mom[m][j].end(), 0.0);
+
+        fill(_now.begin(), _now.end(), 0);
+        fill(_busy.begin(), _busy.end(), 0);
+        fill(_running.begin(), _running.end(), -1);
+    }
+
+    void BatchSim::run(Tick horizon)
+    {
+        for (size_t k = 0; k < _period.size(); ++k)
+            if (_period[k] <= 0) {
+                stringstream s;
+                s << "Task " << k / _lanes << " of lane " << k % _lanes
+                  << " has no parameters";
+                throw BatchSimExc(s.str());
+            }
+
+        reset();
+        const int64_t h = int64_t(horizon);
+        const size_t L = _lanes;
+
+        for (;;) {
+            // the next instant of each lane: the end of its
+            // running job, or the next arrival of a task
+            for (size_t l = 0; l < L; ++l) {
+                int r = _running[l];
+                _next[l] = r >= 0 ? _now[l] + _rem[r * L + l] : NEVER;
+            }
+            for (int i = 0; i < _tasks; ++i) {
+                const int64_t *rel = &_rel[i * L];
+                int64_t *next = &_next[0];
+                for (size_t l = 0; l < L; ++l)
+                    next[l] = min(next[l], rel[l]);
+            }
+
+            _stepped.clear();
+            for (size_t l = 0; l < L; ++l)
+                if (_next[l] <= h) {
+                    step(int(l), _next[l]);
+                    _stepped.push_back(int(l));
+                }
+            if (_stepped.empty()) break;
+            dispatch();
+        }
+    }
+
+    void BatchSim::step(int lane, int64_t t)
+    {
+        const size_t L = _lanes;
+        int r = _running[lane];
+        if (r >= 0) {
+            size_t k = r * L + lane;
+            _rem[k] -= t - _now[lane];
+            if (_rem[k] == 0) endJob(r, lane, t);
+        }
+        _now[lane] = t;
+
+        // a busy task buffers the arrival, as Task::onArrival()
+        for (int i = 0; i < _tasks; ++i) {
+            size_t k = i * L + lane;
+            if (_rel[k] != t) continue;
+            if (_active[k]) _pending[k]++;
+            else release(k, t, t);
+            _rel[k] += _period[k];
+        }
+    }
+
+    void BatchSim::release(size_t k, int64_t arr, int64_t now)
+    {
+        _active[k] = 1;
+        _arr[k] = arr;
+        _dl[k] = arr + _deadline[k];
+        _ins[k] = now;
+        _rem[k] = _wcet[k];
+        _key[k] = _policy == EDF ? _dl[k] : _prio[k];
+    }
+
+    void BatchSim::endJob(int task, int lane, int64_t t)
+    {
+        size_t k = size_t(task) * _lanes + lane;
+        _executed[k] += t - _lastSched[k];
+        _busy[lane] += t - _lastSched[k];
+        _jobs[k]++;
+        if (t > _dl[k]) _late[k]++;
+        _running[lane] = -1;
+
+        if (t >= _transitory) {
+            record(FINISHING_TIME, k, double(t - _arr[k]));
+            record(LATENESS, k, double(max(int64_t(0), t - _dl[k])));
+            double D = double(_deadline[k]);
+            record(TARDINESS, k, max(0.0, (t - _arr[k] - D) / D));
+        }
+
+        // the buffered arrivals are the next periods of the task
+        if (_pending[k] > 0) {
+            _pending[k]--;
+            release(k, _arr[k] + _period[k], t);
+        }
+        else _active[k] = 0;
+    }
+
+    void BatchSim::record(int m, size_t k, double v)
+    {
+        double &n = _mom[m][0][k], &mean = _mom[m][1][k], &m2 = _mom[m][2][k];
+        double &mn = _mom[m][3][k], &mx = _mom[m][4][k];
+
+        if (n == 0) mn = mx = v;
+        else {
+            mn = min(mn, v);
+            mx = max(mx, v);
+        }
+        double d = v - mean;
+        mean += d / ++n;
+        m2 += d * (v - mean);
+    }
+
+    void BatchSim::dispatch()
+    {
+        const size_t L = _lanes;
+
+        // the first of the ready queue of each lane, in the order
+        // of TaskModel::TaskModelCmp: key, insertion time, task
+        fill(_bestKey.begin(), _bestKey.end(), NEVER);
+        fill(_bestIns.begin(), _bestIns.end(), NEVER);
+        fill(_best.begin(), _best.end(), -1);
+        for (int i = 0; i < _tasks; ++i) {
+            const int64_t *key = &_key[i * L], *ins = &_ins[i * L];
+            const uint8_t *act = &_active[i * L];
+            int64_t *bk = &_bestKey[0], *bi = &_bestIns[0];
+            int *best = &_best[0];
+            for (size_t l = 0; l < L; ++l) {
+                bool b = act[l] &&
+                    (key[l] < bk[l] || (key[l] == bk[l] && ins[l] < bi[l]));
+                bk[l] = b ? key[l] : bk[l];
+                bi[l] = b ? ins[l] : bi[l];
+                best[l] = b ? i : best[l];
+            }
+        }
+
+        for (size_t j = 0; j < _stepped.size(); ++j) {
+            int l = _stepped[j];
+            int b = _best[l], r = _running[l];
+            if (b == r) continue;
+            if (r >= 0) {
+                size_t k = r * L + l;
+                _executed[k] += _now[l] - _lastSched[k];
+                _busy[l] += _now[l] - _lastSched[k];
+                _preemptions[k]++;
+            }
+            _running[l] = b;
+            if (b >= 0) _lastSched[b * L + l] = _now[l];
+        }
+    }
+
+    TaskCounters BatchSim::getCounters(int lane, int task) const
+    {
+        size_t k = size_t(task) * _lanes + lane;
+        TaskCounters c = TaskCounters();
+        c.executed = Tick(_executed[k]);
+        c.jobs = _jobs[k];
+        c.late = _late[k];
+        c.preemptions = _preemptions[k];
+        return c;
+    }
+
+    void BatchSim::collect(int lane, Measure m, int task, StatSummary &s)
+    {
+        if (lane < 0 || lane >= _lanes) throw BatchSimExc("No such lane");
+        if (task >= _tasks) throw BatchSimExc("No such task");
+
+        int from = task < 0 ? 0 : task, to = task < 0 ? _tasks : task + 1;
+        for (int i = from; i < to; ++i) {
+            size_t k = size_t(i) * _lanes + lane;
+            _scratch->load(_mom[m][0][k], _mom[m][1][k], _mom[m][2][k],
+                           _mom[m][3][k], _mom[m][4][k]);
+            s.merge(*_scratch);
+        }
+    }
+
+} // namespace RTSim
@@ -0,0 +1,182 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __BATCHSIM_HPP__
+#define __BATCHSIM_HPP__
+
+#include <stdint.h>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basestat.hpp>
+#include <simcontext.hpp>
+#include <task.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    /// Raised on a task set outside the subset of BatchSim
+    DECL_EXC(BatchSimExc, "BatchSim");
+
+    /**
+       \ingroup kernels
+
+       Simulates a batch of small independent uniprocessor systems
+       (the lanes), all with the same number of tasks and the same
+       policy, and different parameters: the points of a
+       design-space exploration, without building a model for each
+       of them.
+
+       The supported subset is that of a RTKernel with an
+       EDFScheduler or a FPScheduler, no context switch delay, and
+       periodic tasks whose code is a single fixed(c) (or a
+       delay() of a constant). The deadline misses do not kill
+       the jobs, and the arrivals of a busy task are buffered
+       without limit. On this subset a lane follows the same
+       schedule as the RTKernel, with the tasks added in the same
+       order (the last tie-breaker of the ready queue): the same
+       jobs end at the same times, and are preempted at the same
+       times.
+
+       The state of the tasks is kept in arrays, one per field,
+       with the lanes of a task next to each other, so that the
+       next event of every lane and the task to run on it are
+       found by loops over the lanes that the compiler
+       vectorizes. The lanes advance in lockstep, one instant
+       each per step, and each lane processes all the events of
+       its instant at once, as the kernel does before
+       dispatching.
+
+       <pre>
+       BatchSim b(BatchSim::EDF, 3, 1000);
+       for (int l = 0; l < 1000; ++l) {
+           b.setTask(l, 0, 10, 10, 0, 2 + l % 4);
+           ...
+       }
+       b.run(100000);
+       StatSummary rt;
+       b.collect(l, BatchSim::FINISHING_TIME, 2, rt);
+       </pre>
+    */
+    class BatchSim {
+    public:
+        enum Policy { EDF, FP };
+
+        /// The measures of FinishingTimeStat, LatenessStat and TardinessStat
+        enum Measure {
+            FINISHING_TIME,
+            LATENESS,
+            TARDINESS,
+            MEASURES
+        };
+
+        /// The most tasks of a lane
+        static const int MAX_TASKS = 32;
+
+        /// @throws BatchSimExc if tasks is not in [1, MAX_TASKS]
+        BatchSim(Policy p, int tasks, int lanes);
+        ~BatchSim();
+
+        int getTasks() const { return _tasks; }
+        int getLanes() const { return _lanes; }
+
+        /**
+           Sets the parameters of a task in a lane (in all the
+           lanes if lane < 0): its period, relative deadline,
+           offset of the first arrival, and execution time.
+
+           @throws BatchSimExc if the period or the execution time
+           is not positive
+        */
+        void setTask(int lane, int task, Tick period, Tick deadline,
+                     Tick phase, Tick wcet);
+
+        /**
+           The priority of a task under FP, as in
+           FPScheduler::addTask() (the lower, the higher); by
+           default, the index of the task.
+        */
+        void setPriority(int lane, int task, int prio);
+
+        /// The jobs that end before t are not measured (the counters are)
+        void setTransitory(Tick t) { _transitory = t; }
+
+        /**
+           Simulates all the lanes from 0 up to horizon, included,
+           as Simulation::run_to() on a new run.
+        */
+        void run(Tick horizon);
+
+        /// The counters of a task in a lane, as in Task::getCounters()
+        TaskCounters getCounters(int lane, int task) const;
+
+        /// The busy time of the processor of a lane, as in CPU::getBusyTime()
+        Tick getBusyTime(int lane) const { return Tick(_busy[lane]); }
+
+        /**
+           Merges the values of measure m of task in lane (of all
+           the tasks if task < 0) into s: many lanes can be merged
+           in one StatSummary (see BaseStat::merge()).
+        */
+        void collect(int lane, Measure m, int task, StatSummary &s);
+
+        class Moments;
+
+    private:
+        Policy _policy;
+        int _tasks, _lanes;
+        int64_t _transitory;
+
+        // per task and lane, at [task * _lanes + lane]
+        std::vector<int64_t> _period, _deadline, _phase, _wcet, _prio;
+        /// next arrival, arrival and deadline of the current job
+        std::vector<int64_t> _rel, _arr, _dl;
+        /// the key of the ready queue (deadline or priority), and
+        /// the time of insertion
+        std::vector<int64_t> _key, _ins;
+        std::vector<int64_t> _rem, _lastSched, _pending;
+        std::vector<uint8_t> _active;
+
+        std::vector<int64_t> _executed;
+        std::vector<uint32_t> _jobs, _late, _preemptions;
+        /// count, mean, m2, min and max of each measure
+        std::vector<double> _mom[MEASURES][5];
+
+        // per lane
+        std::vector<int64_t> _now, _next, _busy;
+        std::vector<int> _running;
+        /// the first task of the ready queue, and its key
+        std::vector<int64_t> _bestKey, _bestIns;
+        std::vector<int> _best;
+        /// the lanes that processed an instant in this step
+        std::vector<int> _stepped;
+
+        // the scratch of collect(), in a context of its own
+        SimContext _ctx;
+        Moments *_scratch;
+
+        BatchSim(const BatchSim &);
+        BatchSim &operator=(const BatchSim &);
+
+        void reset();
+        void step(int lane, int64_t t);
+        void release(size_t k, int64_t arr, int64_t now);
+        void endJob(int task, int lane, int64_t t);
+        void record(int m, size_t k, double v);
+        void dispatch();
+    };
+
+} // namespace RTSim
+
+#endif
@@ -0,0 +1,217 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+
+#include <simul.hpp>
+
+#include <bodyinstr.hpp>
+#include <cpu.hpp>
+#include <kernel.hpp>
+#include <task.hpp>
+
+namespace RTSim {
+
+    BodyInstr::BodyInstr(Task *f, JobBody *body, const std::string &n) :
+        Instr(f, n), _body(body), _step(), _state(NONE), _evt(this),
+        _execd(0), _actTime(0), _lastTime(0), _executing(false), _cpu(0),
+        _startWork(0), _res()
+    {
+    }
+
+    void BodyInstr::newRun()
+    {
+        _state = NONE;
+        _execd = 0;
+        _actTime = 0;
+        _lastTime = 0;
+        _executing = false;
+        _cpu = 0;
+        _startWork = 0;
+    }
+
+    void BodyInstr::endRun()
+    {
+        _evt.drop();
+    }
+
+    void BodyInstr::reset()
+    {
+        _body->restart();
+        _state = NONE;
+        _execd = 0;
+        _actTime = 0;
+        _executing = false;
+        _evt.drop();
+        if (_cpu != 0) _cpu->disarm(&_evt);
+    }
+
+    Tick BodyInstr::getExecTime() const
+    {
+        if (_executing) return _execd + SIMUL.getTime() - _lastTime;
+        return _execd;
+    }
+
+    void BodyInstr::advance()
+    {
+        _step = _body->resume();
+        switch (_step.kind) {
+        case JobBody::Step::EXEC:
+            _state = EXEC;
+            _actTime = 0;
+            run();
+            break;
+        case JobBody::Step::END:
+            _state = DONE;
+            _father->onInstrEnd();
+            break;
+        default:
+            // the other steps act on the kernel from an event
+            _state = ACTION;
+            if (_step.kind == JobBody::Step::SUSPEND) _evt.process();
+            else _evt.post(SIMUL.getTime());
+            break;
+        }
+    }
+
+    void BodyInstr::run()
+    {
+        CPU *p = _father->getCPU();
+        if (p == NULL) throw InstrExc("No CPU!", "BodyInstr::schedule()");
+
+        _lastTime = SIMUL.getTime();
+        _executing = true;
+        _cpu = p;
+        _startWork = p->getWork();
+        _evt.post(p->getTimeOf(endWork()));
+        p->arm(&_evt, endWork());
+    }
+
+    void BodyInstr::account()
+    {
+        Tick t = SIMUL.getTime();
+        _actTime += _cpu->getWork() - _startWork;
+        _startWork = _cpu->getWork();
+        _execd += t - _lastTime;
+        _lastTime = t;
+    }
+
+    int64_t BodyInstr::endWork() const
+    {
+        return _startWork + int64_t(_step.time) * CPU::SPEED_ONE - _actTime;
+    }
+
+    void BodyInstr::schedule()
+    {
+        DBGENTER(_INSTR_DBG_LEV);
+
+        switch (_state) {
+        case NONE:
+            advance();
+            break;
+        case EXEC:
+            run();
+            break;
+        case ACTION:
+            if (_step.kind == JobBody::Step::SUSPEND) _evt.process();
+            else _evt.post(SIMUL.getTime());
+            break;
+        default:
+            break;
+        }
+    }
+
+    void BodyInstr::deschedule()
+    {
+        DBGENTER(_INSTR_DBG_LEV);
+
+        // a suspended body keeps its event, which resumes it
+        if (_state == EXEC && _executing) {
+            _evt.drop();
+            account();
+            _cpu->disarm(&_evt);
+            _executing = false;
+        }
+        else if (_state == ACTION) _evt.drop();
+    }
+
+    void BodyInstr::onEnd()
+    {
+        DBGENTER(_INSTR_DBG_LEV);
+
+        Tick t = SIMUL.getTime();
+        if (_state == EXEC) {
+            // the processor slowed down after the event was posted
+            if (_cpu->getWork() < endWork()) {
+                _evt.post(_cpu->getTimeOf(endWork()));
+                return;
+            }
+            _cpu->disarm(&_evt);
+            _execd += t - _lastTime;
+            _executing = false;
+            _state = NONE;
+            advance();
+        }
+        else if (_state == SUSPENDED) {
+            _state = NONE;
+            _father->getKernel()->onArrival(_father);
+        }
+        else if (_state == ACTION) {
+            _state = NONE;
+            switch (_step.kind) {
+            case JobBody::Step::LOCK:
+                if (kernel()->requestResource(_father, resource(_step.res),
+                                              _step.units))
+                    advance();
+                break;
+            case JobBody::Step::UNLOCK:
+                kernel()->releaseResource(_father, resource(_step.res),
+                                          _step.units);
+                advance();
+                break;
+            default: {
+                AbsKernel *k = _father->getKernel();
+                _state = SUSPENDED;
+                k->suspend(_father);
+                k->dispatch();
+                _evt.post(t + _step.time);
+                break;
+            }
+            }
+        }
+    }
+
+    void BodyInstr::refreshExec(double, double)
+    {
+        // the processor already moves the event (see CPU::arm())
+        if (_state != EXEC || !_executing) return;
+        _evt.drop();
+        _evt.post(_cpu->getTimeOf(endWork()));
+    }
+
+    RTKernel *BodyInstr::kernel() const
+    {
+        RTKernel *k = dynamic_cast<RTKernel *>(_father->getKernel());
+        if (k == NULL) throw InstrExc("Kernel not found!", "BodyInstr");
+        return k;
+    }
+
+    Resource *BodyInstr::resource(const char *name)
+    {
+        for (size_t i = 0; i < _res.size(); ++i)
+            if (strcmp(_res[i].first.c_str(), name) == 0) return _res[i].second;
+        _res.push_back(make_pair(string(name), kernel()->getResource(name)));
+        return _res.back().second;
+    }
+
+} // namespace RTSim
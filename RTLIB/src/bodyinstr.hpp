@@ -0,0 +1,196 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __BODYINSTR_HPP__
+#define __BODYINSTR_HPP__
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <instr.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    class CPU;
+    class Resource;
+    class RTKernel;
+
+    /**
+       \ingroup instr
+
+       The code of the jobs of a task, written as a single
+       function that suspends itself at each step (a coroutine,
+       in the style of the protothreads), instead of a list of
+       instructions:
+
+       <pre>
+       class Body : public JobBody {
+           int i;
+       public:
+           Step resume() {
+               BODY_BEGIN;
+               for (i = 0; i < 3; ++i) {
+                   BODY_AWAIT(exec(2));
+                   BODY_AWAIT(lock("R"));
+                   BODY_AWAIT(exec(1));
+                   BODY_AWAIT(unlock("R"));
+               }
+               BODY_AWAIT(suspend(5));
+               BODY_END;
+           }
+       };
+
+       task.addInstr(new BodyInstr(&task, new Body));
+       </pre>
+
+       Each BODY_AWAIT returns a Step to the BodyInstr, which
+       carries it out and calls resume() again when it is done;
+       resume() goes on right after the BODY_AWAIT. As in any
+       switch-based coroutine, the variables that live across a
+       BODY_AWAIT must be members of the body, not locals: the
+       object is the frame of the coroutine. The jobs of a task
+       never overlap, so the task has a single frame, restarted
+       at every job (see restart()).
+    */
+    class JobBody {
+    public:
+        /// What the body waits for
+        struct Step {
+            enum Kind { END, EXEC, LOCK, UNLOCK, SUSPEND };
+            Kind kind;
+            /// the execution time (EXEC) or the delay (SUSPEND)
+            Tick time;
+            /// the resource (LOCK and UNLOCK), a string that lives
+            /// as long as the body, usually a literal
+            const char *res;
+            int units;
+        };
+
+        JobBody() : _pc(0) {}
+        virtual ~JobBody() {}
+
+        /**
+           Called at the beginning of every job: by default, the
+           body restarts from BODY_BEGIN. A body with other
+           members reset them here.
+        */
+        virtual void restart() { _pc = 0; }
+
+        /// Runs the body up to the next step
+        virtual Step resume() = 0;
+
+        /// The worst-case execution time of a job (0 if unknown)
+        virtual Tick getWCET() const { return 0; }
+
+    protected:
+        /// Where resume() goes on (the line of the last BODY_AWAIT)
+        int _pc;
+
+        /// Executes for c ticks (at full speed)
+        static Step exec(Tick c) { Step s = {Step::EXEC, c, 0, 0}; return s; }
+
+        /// Locks n units of resource r, as WaitInstr
+        static Step lock(const char *r, int n = 1)
+            { Step s = {Step::LOCK, 0, r, n}; return s; }
+
+        /// Unlocks n units of resource r, as SignalInstr
+        static Step unlock(const char *r, int n = 1)
+            { Step s = {Step::UNLOCK, 0, r, n}; return s; }
+
+        /// Leaves the processor for d ticks, as SuspendInstr
+        static Step suspend(Tick d) { Step s = {Step::SUSPEND, d, 0, 0}; return s; }
+
+        /// The end of the job
+        static Step end() { Step s = {Step::END, 0, 0, 0}; return s; }
+    };
+
+#define BODY_BEGIN switch (_pc) { case 0:
+#define BODY_AWAIT(step) \
+    do { _pc = __LINE__; return (step); case __LINE__:; } while (0)
+#define BODY_END } _pc = -1; return end()
+
+    /**
+       \ingroup instr
+
+       The instruction that runs a JobBody: all the steps of a
+       job go through a single event, reposted at each step, and
+       nothing is allocated while the task runs. It can also be
+       mixed with other instructions: the next one starts when
+       the body ends.
+
+       An execution step behaves as an ExecInstr with a fixed
+       cost, a lock as a WaitInstr, an unlock as a SignalInstr,
+       and a suspension as a SuspendInstr; the resources must
+       belong to the RTKernel of the task.
+    */
+    class BodyInstr : public Instr {
+        enum State { NONE, EXEC, ACTION, SUSPENDED, DONE };
+
+        unique_ptr<JobBody> _body;
+        JobBody::Step _step;
+        State _state;
+        EndInstrEvt _evt;
+
+        /// time executed by the job
+        Tick _execd;
+        /// work done in the current step (fixed point, see CPU::SPEED_ONE)
+        int64_t _actTime;
+        Tick _lastTime;
+        bool _executing;
+        /// the processor of the current step, and its CPU::getWork() at the start
+        CPU *_cpu;
+        int64_t _startWork;
+
+        /// the resources already resolved, by name
+        vector<pair<string, Resource *> > _res;
+
+        void advance();
+        void run();
+        void account();
+        /// the CPU::getWork() of _cpu at which the step ends
+        int64_t endWork() const;
+        RTKernel *kernel() const;
+        Resource *resource(const char *name);
+
+    public:
+        /// The instruction owns body
+        BodyInstr(Task *f, JobBody *body, const std::string &n = "");
+
+        JobBody *getBody() const { return _body.get(); }
+
+        virtual void schedule();
+        virtual void deschedule();
+        virtual void onEnd();
+        virtual void reset();
+
+        virtual Tick getExecTime() const;
+        /// The body does not know its duration: its WCET
+        virtual Tick getDuration() const { return _body->getWCET(); }
+        virtual Tick getWCET() const throw(RandomVar::MaxException)
+            { return _body->getWCET(); }
+        virtual void setTrace(Trace *) {}
+
+        virtual void newRun();
+        virtual void endRun();
+
+        virtual void refreshExec(double oldSpeed, double newSpeed);
+    };
+
+} // namespace RTSim
+
+#endif
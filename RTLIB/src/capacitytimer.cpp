@@ -12,7 +12,7 @@ namespace RTSim {
     CapacityTimer::CapacityTimer() : Entity(""), 
                                      last_time(0), 
                                      value(0), 
-                                     status(STOPPED), der(1) {}
+                                     status(STOPPED), der(1), step(0) {}
 
     CapacityTimer::~CapacityTimer() {}
 
@@ -21,6 +21,7 @@ namespace RTSim {
         assert(status == STOPPED);
         der = speed;
         last_time = SIMUL.getTime();
+        step = 0;
         status = RUNNING;
     }
 
@@ -28,11 +29,39 @@ namespace RTSim {
     {
         assert(status == RUNNING);
         //value += Tick::ceil(double(SIMUL.getTime() - last_time) * der);
-	value += double(SIMUL.getTime() - last_time) * der;
+	value = elapsed();
         status = STOPPED;
         return value;
     }
 
+    void CapacityTimer::set_speed(double speed)
+    {
+        if (status == RUNNING) {
+            value = elapsed();
+            last_time = SIMUL.getTime();
+        }
+        der = speed;
+        step = 0;
+    }
+
+    void CapacityTimer::set_step(const Tick &s)
+    {
+        assert(status == RUNNING);
+        value = elapsed();
+        last_time = SIMUL.getTime();
+        step = s;
+    }
+
+    double CapacityTimer::elapsed() const
+    {
+        double v = value;
+        Tick t = last_time;
+        if (step > 0) 
+            for (; SIMUL.getTime() - t >= step; t += step) 
+                v += double(step) * der;
+        return v + double(SIMUL.getTime() - t) * der;
+    }
+
     Tick CapacityTimer::get_intercept(const Tick &v) const 
     {
 	assert(status == RUNNING && der != 0);
@@ -43,7 +72,7 @@ namespace RTSim {
     {
         if (status == RUNNING) 
             //return value + Tick::ceil(double(SIMUL.getTime() - last_time) * der);
-	    return value + double(SIMUL.getTime() - last_time) * der;
+	    return elapsed();
         else return value;
     }
 
@@ -58,6 +87,7 @@ namespace RTSim {
         status = STOPPED;
         value = 0;
         der = 1;
+        step = 0;
     }
 
     void CapacityTimer::endRun()
@@ -16,6 +16,24 @@ namespace RTSim {
 
         void start(double speed=1.0);
         double stop();
+
+        /**
+           Changes the speed (the derivative of the value) from
+           now on, without stopping the timer: the value reached
+           so far is kept, and a running timer keeps running.
+        */
+        void set_speed(double speed);
+        double get_speed() const { return der; }
+
+        /**
+           Makes a running timer count in steps of s ticks from
+           now on, as if it were stopped and started again at the
+           end of each step (0 for none): the value is the same,
+           to the last bit, as with the stops. start() and
+           set_speed() clear it (see CBServer::setCoalescing()).
+        */
+        void set_step(const Tick &s);
+
         status_t get_status() { return status; }
         double get_value() const;
         void set_value(const double &v);
@@ -34,6 +52,10 @@ namespace RTSim {
 	double value;
         status_t status;
         double der;
+        Tick step;
+
+        /// the value now, if the timer is running
+        double elapsed() const;
     };
 }
 
@@ -2,6 +2,13 @@
 
 #include <cassert>
 
+#include <edfsched.hpp>
+#include <exeinstr.hpp>
+#include <fifosched.hpp>
+#include <fpsched.hpp>
+#include <mrtkernel.hpp>
+#include <task.hpp>
+
 namespace RTSim {
 
     using namespace MetaSim;
@@ -15,11 +22,13 @@ namespace RTSim {
         cap(0),
 	last_time(0),
 	HR(HR),
-        _replEvt(this, &CBServer::onReplenishment, 
-		 Event::_DEFAULT_PRIORITY - 1),
-	_idleEvt(this, &CBServer::onIdle),
+        repl_queue(size_t(-1)),
+        capacity_queue(size_t(-1)),
+        _replEvt(this, Event::_DEFAULT_PRIORITY - 1),
+	_idleEvt(this),
         vtime(),
-	idle_policy(ORIGINAL)
+	idle_policy(ORIGINAL),
+        _coalesce(false)
     {
         DBGENTER(_SERVER_DBG_LEV);
         DBGPRINT(s);
@@ -101,7 +110,7 @@ namespace RTSim {
         last_time = SIMUL.getTime();
         vtime.start((double)P/double(Q));
         DBGPRINT_2("Last time is: ", last_time);
-        _bandExEvt.post(last_time + cap);
+        armBudget(last_time + cap);
     }
 
     /*The server is preempted. */
@@ -112,7 +121,6 @@ namespace RTSim {
         status = READY;
         cap = cap - (SIMUL.getTime() - last_time);
         vtime.stop();
-        _bandExEvt.drop();
     }
 
     /*The sporadic task ends execution*/
@@ -123,7 +131,6 @@ namespace RTSim {
         if (status == EXECUTING) {
             cap = cap - (SIMUL.getTime() - last_time);
       	    vtime.stop();
-            _bandExEvt.drop();
         }
         if (vtime.get_value() <= double(SIMUL.getTime())) 
             status = IDLE;
@@ -160,7 +167,6 @@ namespace RTSim {
 	    DBGPRINT_2("Capacity queue: ", capacity_queue.size());
             DBGPRINT_2("new_deadline: ", d);
 	    status=READY;
-	    _replEvt.post(SIMUL.getTime());
         }
 	else
 	  {
@@ -178,6 +184,70 @@ namespace RTSim {
         DBGPRINT("The status is now " << status_string[status]);
     }
 
+    bool CBServer::coalesce()
+    {
+        DBGENTER(_SERVER_DBG_LEV);
+
+        if (!_coalesce || HR || Q <= 0) return false;
+
+        // a kernel that switches at once, and orders the server by
+        // its deadline or by a fixed priority; a round robin would
+        // restart its slice at every dispatch
+        RTKernel *k = dynamic_cast<RTKernel *>(kernel);
+        if (k == 0 || dynamic_cast<MRTKernel *>(k) != 0 ||
+            k->getContextSwitchDelay() != 0) return false;
+        Scheduler *s = k->getScheduler();
+        if (dynamic_cast<EDFScheduler *>(s) == 0 &&
+            dynamic_cast<FPScheduler *>(s) == 0) return false;
+        if (dynamic_cast<FIFOScheduler *>(sched_) == 0 &&
+            dynamic_cast<EDFScheduler *>(sched_) == 0 &&
+            dynamic_cast<FPScheduler *>(sched_) == 0) return false;
+
+        // nobody watches the events of the suspension and of the
+        // dispatch that are skipped
+        Task *t = dynamic_cast<Task *>(currExe_);
+        if (t == 0 || dynamic_cast<ExecInstr *>(*t->getActInstr()) == 0)
+            return false;
+        if (_bandExEvt.hasAttachedProbes() || _schedEvt.hasAttachedProbes() ||
+            _deschedEvt.hasAttachedProbes() ||
+            _dispatchEvt.hasAttachedProbes() ||
+            t->schedEvt.hasAttachedProbes() ||
+            t->deschedEvt.hasAttachedProbes() ||
+            k->beginDispatchEvt.hasAttachedProbes() ||
+            k->endDispatchEvt.hasAttachedProbes())
+            return false;
+
+        // the exhaustions before the next event: this one and the
+        // next n - 1, while the n-th goes through the normal path,
+        // which posts the events of the task again as usual
+        Event *first = Event::getFirst();
+        Tick now = SIMUL.getTime();
+        if (first == NULL || first->getTime() <= now + Q) return false;
+        long int n = (long int)(first->getTime() - now - 1) / (long int)Q;
+
+        Tick old = d;
+        s->extract(this);
+        d = d + P * n;
+        setAbsDead(d);
+        s->insert(this);
+        if (s->getFirst() != this) {
+            s->extract(this);
+            d = old;
+            setAbsDead(d);
+            s->insert(this);
+            return false;
+        }
+
+        DBGPRINT_3("Postponing by ", n, " periods");
+        cap = Q * n;
+        last_time = now;
+        vtime.stop();
+        vtime.start((double)P/double(Q));
+        vtime.set_step(Q);
+        armBudget(last_time + cap);
+        return true;
+    }
+
     /*The server has recovered its bandwidth and there is at least one task left in the queue*/
     void CBServer::recharging_ready()
     {
@@ -249,11 +319,9 @@ namespace RTSim {
             if (status == EXECUTING) {
                 DBGPRINT_3("Server ", getName(), " is executing");
                 cap = cap - (SIMUL.getTime() - last_time);
-		_bandExEvt.drop();
-                vtime.stop();
                 last_time = SIMUL.getTime();
-                _bandExEvt.post(last_time + cap);
-                vtime.start((double)P/double(n));
+                armBudget(last_time + cap);
+                vtime.set_speed((double)P/double(n));
                 DBGPRINT_2("Reposting bandExEvt at ", last_time + cap);
             }
             Q = n;
@@ -270,14 +338,12 @@ namespace RTSim {
                 cap = cap - (SIMUL.getTime() - last_time);
 		last_time = SIMUL.getTime();
                 DBGVAR(cap);
-                _bandExEvt.drop();
-                vtime.stop();
             }
             
             Q = n;
 
             if (status == EXECUTING) {
-                vtime.start(double(P)/double(Q));
+                vtime.set_speed(double(P)/double(Q));
                 DBGPRINT("Server was executing");
                 if (cap == 0) {
                     DBGPRINT("capacity is zero, go to recharging");
@@ -286,7 +352,7 @@ namespace RTSim {
                 }
                 else {
                     DBGPRINT_2("Reposting bandExEvt at ", last_time + cap);    
-                    _bandExEvt.post(last_time + cap);
+                    armBudget(last_time + cap);
                 }
             }
         }
@@ -299,6 +365,12 @@ namespace RTSim {
 	return 0;
     }
 
+    void CBServer::setParameters(const Tick &q, const Tick &p)
+    {
+        Q = q;
+        P = p;
+    }
+
     Tick CBServer::get_remaining_budget()
     {
 	double dist = (double(getDeadline()) - vtime.get_value()) * 
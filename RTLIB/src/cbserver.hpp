@@ -3,7 +3,7 @@
 
 #include <server.hpp>
 #include <capacitytimer.hpp>
-#include <list>
+#include <ringbuf.hpp>
 
 namespace RTSim {
     using namespace MetaSim;
@@ -24,12 +24,37 @@ namespace RTSim {
         Tick changeBudget(const Tick &n);
 
         Tick changeQ(const Tick &n);
+
+        /**
+           Sets the budget and the period of the server, between
+           two runs (see Task::setPhase()).
+        */
+        void setParameters(const Tick &q, const Tick &p);
         virtual double getVirtualTime();
 	Tick get_remaining_budget(); 
 
 	policy_t get_policy() const { return idle_policy; }
 	void set_policy(policy_t p) { idle_policy = p; }  
 
+        /**
+           In soft mode, when the budget is exhausted and nothing
+           can happen before the next exhaustions (no event in the
+           queue, no probe on the events of the dispatch, a kernel
+           that still picks the server after the postponement),
+           the deadline is postponed at once by as many periods,
+           with a single re-insertion in the scheduler of the
+           kernel, and the server keeps the processor; the last
+           exhaustion before the next event goes through the
+           normal path. The finishing times, the deadlines and
+           the virtual time at every event are the same as
+           without it, but the deadline is postponed in advance:
+           it is off by default, and it should be left off if the
+           server is inspected between two events (e.g. after a
+           run_to()).
+        */
+        void setCoalescing(bool on = true) { _coalesce = on; }
+        bool isCoalescing() const { return _coalesce; }
+
     protected:
                 
         /// from idle to active contending (new work to do)
@@ -53,6 +78,9 @@ namespace RTSim {
         /// from executing to recharging (budget exhausted)
         virtual void executing_recharging();
 
+        virtual Tick getBudgetEnd() const { return last_time + cap; }
+        virtual bool coalesce();
+
         /// from recharging to active contending (budget recharged)
         virtual void recharging_ready();
 
@@ -78,21 +106,25 @@ namespace RTSim {
         /// at time t the budget should be replenished by b.
         typedef std::pair<Tick, Tick> repl_t;
 
+        /// FIFO of replenishments, in a ring buffer that stops
+        /// allocating once it has reached its largest size
+        typedef ring_buffer<repl_t, TrackedAllocator<repl_t, ReplMem> > ReplQueue;
+
         /// queue of replenishments
         /// all times are in the future!
-	std::list<repl_t> repl_queue;
+	ReplQueue repl_queue;
 
         /// at the replenishment time, the replenishment is moved
         /// from the repl_queue to the capacity_queue, so 
         /// all times are in the past.
-        std::list<repl_t> capacity_queue;
+        ReplQueue capacity_queue;
 
         /// A new event replenishment, different from the general
         /// "recharging" used in the Server class
-        GEvent<CBServer> _replEvt;
+        StaticGEvent<CBServer, &CBServer::onReplenishment> _replEvt;
 
         /// when the server becomes idle
-        GEvent<CBServer> _idleEvt;
+        StaticGEvent<CBServer, &CBServer::onIdle> _idleEvt;
 
         CapacityTimer vtime;
 
@@ -105,6 +137,8 @@ namespace RTSim {
 	    floor((d - vtime) * Q / P). 
 	*/
 	policy_t idle_policy; 
+
+        bool _coalesce;
     };
 }
 
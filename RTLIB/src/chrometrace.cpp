@@ -0,0 +1,125 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrometrace.hpp>
+#include <json_trace.hpp>
+#include <simul.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    ChromeTrace::ChromeTrace(const string &name) :
+        _os(name.c_str(), ios::binary), _writer(), _rec(), _slices(), 
+        _names(), _cpus()
+    {
+        if (!_os.is_open()) throw ChromeTraceExc("Cannot open " + name);
+        _writer.reset(new AsyncWriter(_os));
+        _rec = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"args\":{\"name\":\"CPUs\"}}";
+        output();
+    }
+
+    ChromeTrace::~ChromeTrace()
+    {
+        _rec = "\n]}\n";
+        output();
+        _writer.reset();
+    }
+
+    void ChromeTrace::output()
+    {
+        _writer->write(_rec.data(), _rec.size());
+        _rec.clear();
+    }
+
+    void ChromeTrace::addCPU(int cpu)
+    {
+        if (size_t(cpu) >= _cpus.size()) _cpus.resize(cpu + 1, false);
+        if (_cpus[cpu]) return;
+        _cpus[cpu] = true;
+        _rec += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+        jsonAppendInt(_rec, cpu);
+        _rec += ",\"args\":{\"name\":\"CPU ";
+        jsonAppendInt(_rec, cpu);
+        _rec += "\"}}";
+    }
+
+    void ChromeTrace::attachToTask(Task *t)
+    {
+        size_t id = t->getID();
+        if (id >= _names.size()) {
+            _names.resize(id + 1);
+            Slice s = { 0, -1 };
+            _slices.resize(id + 1, s);
+        }
+        _names[id].clear();
+        jsonAppendString(_names[id], t->getName());
+
+        new Particle<SchedEvt, ChromeTrace>(&t->schedEvt, this);
+        new Particle<DeschedEvt, ChromeTrace>(&t->deschedEvt, this);
+        new Particle<EndEvt, ChromeTrace>(&t->endEvt, this);
+        new Particle<DeadEvt, ChromeTrace>(&t->deadEvt, this);
+    }
+
+    void ChromeTrace::probe(SchedEvt &e)
+    {
+        Slice &s = _slices[e.getTask()->getID()];
+        s.start = SIMUL.getTime();
+        s.cpu = e.getCPU() < 0 ? 0 : e.getCPU();
+    }
+
+    void ChromeTrace::endSlice(Task *t, long now)
+    {
+        Slice &s = _slices[t->getID()];
+        if (s.cpu < 0) return;
+        addCPU(s.cpu);
+        _rec += ",\n{\"name\":\"";
+        _rec += _names[t->getID()];
+        _rec += "\",\"cat\":\"job\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        jsonAppendInt(_rec, s.cpu);
+        _rec += ",\"ts\":";
+        jsonAppendInt(_rec, s.start);
+        _rec += ",\"dur\":";
+        jsonAppendInt(_rec, now - s.start);
+        _rec += ",\"args\":{\"arrival\":";
+        jsonAppendInt(_rec, long(t->getArrival()));
+        _rec += "}}";
+        output();
+        s.cpu = -1;
+    }
+
+    void ChromeTrace::probe(DeschedEvt &e)
+    {
+        endSlice(e.getTask(), SIMUL.getTime());
+    }
+
+    void ChromeTrace::probe(EndEvt &e)
+    {
+        endSlice(e.getTask(), SIMUL.getTime());
+    }
+
+    void ChromeTrace::probe(DeadEvt &e)
+    {
+        _rec += ",\n{\"name\":\"";
+        _rec += _names[e.getTask()->getID()];
+        _rec += " deadline miss\",\"cat\":\"deadline\",\"ph\":\"i\","
+            "\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+        jsonAppendInt(_rec, long(SIMUL.getTime()));
+        _rec += "}";
+        output();
+    }
+
+}
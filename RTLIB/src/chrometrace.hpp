@@ -0,0 +1,82 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CHROMETRACE_HPP__
+#define __CHROMETRACE_HPP__
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <asyncwriter.hpp>
+#include <baseexc.hpp>
+#include <particle.hpp>
+
+#include <rttask.hpp>
+#include <taskevt.hpp>
+
+namespace RTSim {
+
+    /// Raised when the trace file cannot be opened
+    DECL_EXC(ChromeTraceExc, "ChromeTrace");
+
+    /**
+       Writes the schedule of the tasks attached to it in the JSON
+       trace event format of Chrome, that can be opened by Perfetto
+       (ui.perfetto.dev) or chrome://tracing.
+
+       Each processor is a track, where each execution of a task
+       (from its SchedEvt to its DeschedEvt or EndEvt) is a slice
+       named after the task. Deadline misses are instant events,
+       across all the tracks. The viewers take the time stamps in
+       microseconds: one tick is shown as one microsecond.
+
+       The records are formatted in a string, and written by a
+       MetaSim::AsyncWriter in blocks of 1MB. The slices still
+       open at the end of the simulation are not written.
+    */
+    class ChromeTrace {
+        struct Slice {
+            long start;
+            int cpu;  ///< -1 if the task is not executing
+        };
+
+        std::ofstream _os;
+        std::unique_ptr<MetaSim::AsyncWriter> _writer;
+        std::string _rec;
+        /// open slices and names of the tasks, by task ID
+        std::vector<Slice> _slices;
+        std::vector<std::string> _names;
+        /// processors that already have a named track
+        std::vector<bool> _cpus;
+
+        void output();
+        void addCPU(int cpu);
+        void endSlice(Task *t, long now);
+
+    public:
+        ChromeTrace(const std::string &name);
+        ~ChromeTrace();
+
+        void attachToTask(Task *t);
+
+        void probe(SchedEvt &e);
+        void probe(DeschedEvt &e);
+        void probe(EndEvt &e);
+        void probe(DeadEvt &e);
+    };
+
+}
+
+#endif
@@ -0,0 +1,372 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cstring>
+
+#include <chunktrace.hpp>
+#include <lzblock.hpp>
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  static const char MAGIC[4] = {'R', 'T', 'C', 'T'};
+  static const uint32_t VERSION = 1;
+  /// the version of the files with COMPACT_RECORDS
+  static const uint32_t VERSION_COMPACT = 2;
+
+  namespace {
+    template <class T>
+    void put(ostream &os, const T &x)
+    {
+      os.write((const char *)& x, sizeof(x));
+    }
+
+    template <class T>
+    void get(istream &is, T &x)
+    {
+      if (!is.read((char *)& x, sizeof(x)))
+        throw ChunkedTraceExc("Truncated file");
+    }
+
+    inline void putVarint(vector<char> &out, int x)
+    {
+      uint32_t v = (uint32_t(x) << 1) ^ uint32_t(x >> 31);
+      while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+      }
+      out.push_back(char(v));
+    }
+
+    inline int getVarint(const char *&p, const char *end)
+    {
+      uint32_t v = 0;
+      for (int shift = 0; ; shift += 7) {
+        if (p == end || shift > 28) throw ChunkedTraceExc("Corrupted record");
+        unsigned char b = *p++;
+        v |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+      }
+      return int(v >> 1) ^ -int(v & 1);
+    }
+
+    inline void putInt(vector<char> &out, int x)
+    {
+      TraceEvent::encode((char *)& x, sizeof(x));
+      out.insert(out.end(), (const char *)& x, (const char *)& x + sizeof(x));
+    }
+
+    inline bool hasString(int type)
+    {
+      return type == TraceEvent::TASK_NAME || type == TraceEvent::TASK_WAIT ||
+        type == TraceEvent::TASK_SIGNAL;
+    }
+
+    /// the fields of the record are deadlines
+    inline bool hasDeadlines(int type)
+    {
+      return type == TraceEvent::TASK_DLINESET || 
+        type == TraceEvent::TASK_DLINEPOST;
+    }
+  }
+
+  bool TraceChunk::hasTask(int task) const
+  {
+    return binary_search(tasks.begin(), tasks.end(), task);
+  }
+
+  ChunkedTrace::ChunkedTrace(const char *name, size_t chunkSize, format_t format)
+    : Trace(name, Trace::BINARY, true), JavaTrace(name, 0UL), _chunkSize(chunkSize > 0 ? chunkSize : 1),
+      _format(format), _raw(), _cur(), _prev(0), _queue(), _free(), _index(), _offset(0), 
+      _stop(false), _failed(false), _m(), _cv(), _thread()
+  {
+    if (!_os.is_open()) throw ChunkedTraceExc(string("Cannot open ") + name);
+    _os.write(MAGIC, 4);
+    put(_os, format == COMPACT_RECORDS ? VERSION_COMPACT : VERSION);
+    put(_os, uint32_t(_chunkSize));
+    _offset = 4 + 2 * sizeof(uint32_t);
+    _raw.reserve(_chunkSize);
+    _thread = std::thread(&ChunkedTrace::loop, this);
+  }
+
+  ChunkedTrace::~ChunkedTrace()
+  {
+    try {
+      finish();
+    } catch (...) {
+    }
+  }
+
+  void ChunkedTrace::emit(const char *rec, size_t n, int time, int task)
+  {
+    if (_raw.empty()) {
+      _cur.first = time;
+      _cur.tasks.clear();
+      _prev = 0;
+    }
+    _cur.last = time;
+    if (find(_cur.tasks.begin(), _cur.tasks.end(), task) == _cur.tasks.end())
+      _cur.tasks.push_back(task);
+    if (_format == COMPACT_RECORDS) compact(TraceRecord(rec), _prev, _raw);
+    else _raw.insert(_raw.end(), rec, rec + n);
+    if (_raw.size() >= _chunkSize) seal();
+  }
+
+  void ChunkedTrace::seal()
+  {
+    if (_raw.empty()) return;
+    sort(_cur.tasks.begin(), _cur.tasks.end());
+    _cur.rawSize = _raw.size();
+
+    vector<char> next;
+    {
+      unique_lock<mutex> l(_m);
+      _cv.wait(l, [this]() { return _queue.size() < 2; });
+      _queue.push_back(make_pair(vector<char>(), _cur));
+      _queue.back().first.swap(_raw);
+      if (!_free.empty()) {
+        next.swap(_free.back());
+        _free.pop_back();
+      }
+    }
+    _cv.notify_all();
+    next.clear();
+    next.reserve(_chunkSize);
+    _raw.swap(next);
+  }
+
+  void ChunkedTrace::loop()
+  {
+    vector<char> out;
+    unique_lock<mutex> l(_m);
+    while (true) {
+      _cv.wait(l, [this]() { return !_queue.empty() || _stop; });
+      if (_queue.empty()) break;
+
+      // the chunk stays in the queue while it is compressed, so
+      // that seal() does not fill more than two
+      vector<char> &raw = _queue.front().first;
+      TraceChunk c = _queue.front().second;
+      l.unlock();
+      // a chunk with a size comes from appendChunk(), compressed
+      const vector<char> *data = &raw;
+      if (c.size == 0) {
+        lzCompress(&raw[0], raw.size(), out);
+        data = &out;
+      }
+      c.offset = _offset;
+      c.size = data->size();
+      _os.write(&(*data)[0], data->size());
+      _offset += data->size();
+      l.lock();
+      if (!_os) _failed = true;
+      _index.push_back(c);
+      _free.push_back(vector<char>());
+      _free.back().swap(_queue.front().first);
+      _queue.pop_front();
+      _cv.notify_all();
+    }
+  }
+
+  void ChunkedTrace::appendChunk(vector<char> &data, const TraceChunk &c)
+  {
+    if (data.empty()) return;
+    seal();
+    {
+      unique_lock<mutex> l(_m);
+      _cv.wait(l, [this]() { return _queue.size() < 2; });
+      _queue.push_back(make_pair(vector<char>(), c));
+      _queue.back().first.swap(data);
+      _queue.back().second.size = _queue.back().first.size();
+    }
+    _cv.notify_all();
+  }
+
+  void ChunkedTrace::compact(const TraceRecord &r, int &prev, vector<char> &out)
+  {
+    int type = r.getType(), time = r.getTime();
+    bool str = hasString(type);
+    int fields = str ? (type == TraceEvent::TASK_NAME ? 0 : 1)
+      : int((r.size() - 16) / 4);
+    if (type < 0 || type > 15 || fields > 3) 
+      throw ChunkedTraceExc("The record cannot be compacted");
+
+    out.push_back(char(type | (fields << 4) | (str ? 0x40 : 0)));
+    putVarint(out, time - prev);
+    prev = time;
+    putVarint(out, r.getTask());
+    int base = hasDeadlines(type) ? time : 0;
+    for (int i = 0; i < fields; ++i) putVarint(out, r.field(4 + i) - base);
+    if (str) {
+      int len = r.field(4 + fields);
+      putVarint(out, len);
+      const char *p = r.data() + 4 * (5 + fields);
+      out.insert(out.end(), p, p + len);
+    }
+  }
+
+  void ChunkedTrace::expand(const char *p, const char *end, vector<char> &out)
+  {
+    int time = 0;
+    while (p < end) {
+      unsigned char kind = *p++;
+      int type = kind & 0x0f, fields = (kind >> 4) & 3;
+      bool str = (kind & 0x40) != 0;
+      time += getVarint(p, end);
+      int task = getVarint(p, end);
+      int f[3];
+      int base = hasDeadlines(type) ? time : 0;
+      for (int i = 0; i < fields; ++i) f[i] = getVarint(p, end) + base;
+      int len = str ? getVarint(p, end) : 0;
+      if (len < 0 || len > end - p) throw ChunkedTraceExc("Corrupted record");
+
+      // the size does not include the size field itself
+      putInt(out, (3 + fields) * 4 + (str ? 4 + len : 0));
+      putInt(out, type);
+      putInt(out, time);
+      putInt(out, task);
+      for (int i = 0; i < fields; ++i) putInt(out, f[i]);
+      if (str) {
+        putInt(out, len);
+        out.insert(out.end(), p, p + len);
+        p += len;
+      }
+    }
+  }
+
+  void ChunkedTrace::finish()
+  {
+    if (!_thread.joinable()) return;
+    seal();
+    {
+      lock_guard<mutex> l(_m);
+      _stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+
+    for (size_t i = 0; i < _index.size(); ++i) {
+      const TraceChunk &c = _index[i];
+      put(_os, c.offset);
+      put(_os, c.size);
+      put(_os, c.rawSize);
+      put(_os, c.first);
+      put(_os, c.last);
+      put(_os, uint32_t(c.tasks.size()));
+      for (size_t j = 0; j < c.tasks.size(); ++j) put(_os, c.tasks[j]);
+    }
+    put(_os, _offset);
+    put(_os, uint32_t(_index.size()));
+    _os.write(MAGIC, 4);
+    _os.flush();
+    if (!_os || _failed) throw ChunkedTraceExc("Error writing " + _filename);
+    Trace::close();
+  }
+
+  void ChunkedTrace::close()
+  {
+    finish();
+  }
+
+  ChunkedTraceReader::ChunkedTraceReader(const string &fname)
+    : _in(fname.c_str(), ios::binary), _format(ChunkedTrace::JAVA_RECORDS),
+      _index(), _buf(), _raw()
+  {
+    if (!_in.is_open()) throw ChunkedTraceExc("Cannot open " + fname);
+
+    char magic[4];
+    uint32_t version, chunkSize;
+    if (!_in.read(magic, 4) || memcmp(magic, MAGIC, 4) != 0)
+      throw ChunkedTraceExc(fname + " is not a chunked trace");
+    get(_in, version);
+    get(_in, chunkSize);
+    if (version == VERSION_COMPACT) _format = ChunkedTrace::COMPACT_RECORDS;
+    else if (version != VERSION) throw ChunkedTraceExc("Unsupported version");
+
+    // footer: indexOffset(uint64) nchunks(uint32) magic(4)
+    uint64_t offset;
+    uint32_t n;
+    _in.seekg(-std::streamoff(sizeof(offset) + sizeof(n) + 4), ios::end);
+    get(_in, offset);
+    get(_in, n);
+    if (!_in.read(magic, 4) || memcmp(magic, MAGIC, 4) != 0)
+      throw ChunkedTraceExc(fname + " has no index (not closed?)");
+
+    _in.seekg(offset, ios::beg);
+    _index.resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      TraceChunk &c = _index[i];
+      uint32_t nt;
+      get(_in, c.offset);
+      get(_in, c.size);
+      get(_in, c.rawSize);
+      get(_in, c.first);
+      get(_in, c.last);
+      get(_in, nt);
+      c.tasks.resize(nt);
+      for (uint32_t j = 0; j < nt; ++j) get(_in, c.tasks[j]);
+    }
+  }
+
+  void ChunkedTraceReader::readCompressed(size_t i, vector<char> &out)
+  {
+    const TraceChunk &c = _index.at(i);
+    out.resize(c.size);
+    _in.clear();
+    _in.seekg(c.offset, ios::beg);
+    if (c.size > 0 && !_in.read(&out[0], c.size))
+      throw ChunkedTraceExc("Truncated chunk");
+  }
+
+  void ChunkedTraceReader::readChunk(size_t i, vector<char> &out)
+  {
+    const TraceChunk &c = _index.at(i);
+    readCompressed(i, _buf);
+    if (_format == ChunkedTrace::COMPACT_RECORDS) {
+      _raw.resize(c.rawSize);
+      if (c.rawSize > 0) lzDecompress(&_buf[0], c.size, &_raw[0], c.rawSize);
+      ChunkedTrace::expand(_raw.data(), _raw.data() + _raw.size(), out);
+      return;
+    }
+    size_t start = out.size();
+    out.resize(start + c.rawSize);
+    if (c.rawSize > 0) 
+      lzDecompress(&_buf[0], c.size, &out[start], c.rawSize);
+  }
+
+  void ChunkedTraceReader::getEvents(int from, int to, vector<TraceEvent *> &v,
+                                     int task)
+  {
+    // the chunks are in time order: skip those that end before from
+    size_t i = 0;
+    while (i < _index.size() && _index[i].last < from) ++i;
+
+    vector<char> raw;
+    for (; i < _index.size() && _index[i].first <= to; ++i) {
+      if (task >= 0 && !_index[i].hasTask(task)) continue;
+      raw.clear();
+      readChunk(i, raw);
+
+      TraceRecordRange recs(&raw[0], &raw[0] + raw.size(), -1, task);
+      for (TraceRecordIterator r = recs.begin(); r != recs.end(); ++r) {
+        int time = (*r).getTime();
+        if (time >= from && time <= to) v.push_back((*r).toEvent());
+      }
+    }
+  }
+
+} // namespace RTSim
@@ -0,0 +1,192 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CHUNKTRACE_HPP__
+#define __CHUNKTRACE_HPP__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <jtrace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  class TraceRecord;
+
+  /// Raised when a chunked trace cannot be written or read
+  DECL_EXC(ChunkedTraceExc, "ChunkedTrace");
+
+  /// The entry of a chunk in the index of a ChunkedTrace
+  struct TraceChunk {
+    /// position of the compressed chunk in the file
+    uint64_t offset;
+    uint32_t size;
+    /// size of the records, once decompressed
+    uint32_t rawSize;
+    /// times of the first and of the last event of the chunk
+    int32_t first, last;
+    /// the tasks having events in the chunk, sorted
+    vector<int32_t> tasks;
+
+    bool hasTask(int task) const;
+  };
+
+  /**
+     \ingroup util
+
+     A JavaTrace stored in a container of compressed chunks, with
+     an index: the records (in the format of TraceEvent::write())
+     are grouped in chunks of about chunkSize bytes, each one
+     compressed (see MetaSim::lzCompress()) and written by a
+     background thread while the next one is filled. At the end an
+     index maps each chunk to its position in the file, its time
+     range and its tasks, so that a reader (ChunkedTraceReader) can
+     seek to the chunks of a time window without reading the rest.
+
+     With COMPACT_RECORDS, the records are stored in a shorter
+     form before compression: a byte with the type, the number of
+     integer fields (bits 4-5) and whether a string follows (bit
+     6); the time, as the difference from the previous record of
+     the chunk; the task, the fields (a deadline as the difference
+     from the time) and the length of the string as varints
+     (zigzag-encoded, 7 bits per byte); then the string. A record
+     of a few bytes, instead of 16 to 24, is written and
+     compressed. The reader converts the chunks back to the format
+     of TraceEvent::write(), so the code that reads the records
+     does not change.
+
+     <pre>
+     "RTCT" version(uint32: 1, or 2 with COMPACT_RECORDS) chunkSize(uint32)
+     chunks
+     index: nchunks x { offset(uint64) size(uint32) rawSize(uint32)
+                        first(int32) last(int32)
+                        ntasks(uint32) ntasks x task(int32) }
+     indexOffset(uint64) nchunks(uint32) "RTCT"
+     </pre>
+
+     The fields of the container are in the byte order of the
+     machine that wrote it, the records in that of JavaTrace.
+  */
+  class ChunkedTrace : public JavaTrace {
+  public:
+    /// The format of the records in the chunks
+    typedef enum { JAVA_RECORDS, COMPACT_RECORDS } format_t;
+
+  private:
+    size_t _chunkSize;
+    format_t _format;
+    /// the chunk being filled, and its entry
+    vector<char> _raw;
+    TraceChunk _cur;
+    /// the time of the last record of the chunk (COMPACT_RECORDS)
+    int _prev;
+
+    /// the chunks waiting to be compressed (at most two)
+    deque<pair<vector<char>, TraceChunk> > _queue;
+    /// buffers already used, to avoid allocations
+    vector<vector<char> > _free;
+    vector<TraceChunk> _index;
+    uint64_t _offset;
+    bool _stop, _failed;
+    std::mutex _m;
+    std::condition_variable _cv;
+    std::thread _thread;
+
+    void seal();
+    void loop();
+    void finish();
+
+  protected:
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+  public:
+    ChunkedTrace(const char *name, size_t chunkSize = 1 << 20,
+                 format_t format = JAVA_RECORDS);
+    virtual ~ChunkedTrace();
+
+    format_t getFormat() const { return _format; }
+
+    /// Writes the last chunk and the index, and closes the file
+    virtual void close();
+
+    /**
+       Appends a chunk of another trace as it is, without
+       decompressing it (see ChunkedTraceReader::readCompressed()):
+       the chunk being filled is written first. Its events must
+       not precede those already in the trace.
+    */
+    void appendChunk(vector<char> &data, const TraceChunk &c);
+
+    /// Appends record r to out, in the format COMPACT_RECORDS
+    static void compact(const TraceRecord &r, int &prev, vector<char> &out);
+
+    /**
+       Appends to out the records in [p, end), in the format
+       COMPACT_RECORDS, converted to that of TraceEvent::write()
+
+       @throws ChunkedTraceExc if a record is truncated
+    */
+    static void expand(const char *p, const char *end, vector<char> &out);
+  };
+
+  /**
+     \ingroup util
+
+     Reads a file written by ChunkedTrace.
+  */
+  class ChunkedTraceReader {
+    ifstream _in;
+    ChunkedTrace::format_t _format;
+    vector<TraceChunk> _index;
+    vector<char> _buf, _raw;
+
+  public:
+    /// Opens the file and reads its index
+    ChunkedTraceReader(const string &fname);
+
+    const vector<TraceChunk> &getIndex() const { return _index; }
+
+    ChunkedTrace::format_t getFormat() const { return _format; }
+
+    /**
+       Decompresses chunk i, and appends its records (in the
+       format of JavaTrace files, without the header) to out.
+    */
+    void readChunk(size_t i, vector<char> &out);
+
+    /**
+       Reads chunk i in out, as it is in the file (compressed, and
+       in the format of the trace)
+    */
+    void readCompressed(size_t i, vector<char> &out);
+
+    /**
+       Appends to v the events that happen in [from, to] (of
+       the given task, if task >= 0), reading only the chunks
+       that may contain them. The events must be deleted by the
+       caller.
+    */
+    void getEvents(int from, int to, vector<TraceEvent *> &v, int task = -1);
+  };
+
+} // namespace RTSim
+
+#endif
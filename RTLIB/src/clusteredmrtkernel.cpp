@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   begin                : Thu Apr 24 15:54:58 CEST 2003
+ *   copyright            : (C) 2003 by Giuseppe Lipari
+ *   email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <sstream>
+
+#include <clusteredmrtkernel.hpp>
+#include <cpu.hpp>
+#include <task.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    ClusteredMRTKernel::ClusteredMRTKernel(const string &name) :
+        Entity(name), _clusters(), _taskCluster()
+    {
+    }
+
+    ClusteredMRTKernel::~ClusteredMRTKernel()
+    {
+    }
+
+    MRTKernel &ClusteredMRTKernel::cluster(int c) const
+    {
+        if (c < 0 || c >= int(_clusters.size()))
+            throw RTKernelExc("Wrong cluster index");
+        return *_clusters[c];
+    }
+
+    int ClusteredMRTKernel::addCluster(Scheduler *s, int n)
+    {
+        return addCluster(s, new uniformCPUFactory(), n);
+    }
+
+    int ClusteredMRTKernel::addCluster(Scheduler *s, absCPUFactory *fact, int n)
+    {
+        string kname;
+        if (getName() != "") {
+            stringstream ss;
+            ss << getName() << "_c" << _clusters.size();
+            kname = ss.str();
+        }
+        _clusters.push_back(unique_ptr<MRTKernel>(new MRTKernel(s, fact, n, kname)));
+        return int(_clusters.size()) - 1;
+    }
+
+    int ClusteredMRTKernel::getClusterOf(const AbsRTTask *t) const
+    {
+        unordered_map<const AbsRTTask *, int>::const_iterator i =
+            _taskCluster.find(t);
+        return i != _taskCluster.end() ? i->second : -1;
+    }
+
+    void ClusteredMRTKernel::addTask(AbsRTTask &t, int c, const string &param)
+    {
+        cluster(c).addTask(t, param);
+        _taskCluster[&t] = c;
+    }
+
+    void ClusteredMRTKernel::migrate(AbsRTTask &t, int c, const string &param)
+    {
+        int old = getClusterOf(&t);
+        if (old < 0) throw RTKernelExc("The task does not belong to the kernel");
+        MRTKernel &dest = cluster(c);
+        if (old == c) return;
+
+        _clusters[old]->removeTask(t);
+        dest.addTask(t, param);
+        _taskCluster[&t] = c;
+    }
+
+    CPU *ClusteredMRTKernel::getProcessor(const AbsRTTask *t) const
+    {
+        int c = getClusterOf(t);
+        return c >= 0 ? _clusters[c]->getProcessor(t) : NULL;
+    }
+
+    vector<CPU *> ClusteredMRTKernel::getProcessors() const
+    {
+        vector<CPU *> v;
+        getProcessors(v);
+        return v;
+    }
+
+    void ClusteredMRTKernel::getProcessors(vector<CPU *> &out) const
+    {
+        out.clear();
+        for (size_t c = 0; c < _clusters.size(); ++c) {
+            const MRTKernel &k = *_clusters[c];
+            for (size_t i = 0; i < k.getProcessorCount(); ++i)
+                out.push_back(k.getProcessorAt(i));
+        }
+    }
+
+    vector<string> ClusteredMRTKernel::getRunningTasks()
+    {
+        vector<string> v;
+        for (size_t c = 0; c < _clusters.size(); ++c) {
+            const MRTKernel &k = *_clusters[c];
+            for (size_t i = 0; i < k.getProcessorCount(); ++i)
+                if (k.getTaskAt(i) != NULL) v.push_back(taskname(k.getTaskAt(i)));
+        }
+        return v;
+    }
+
+    void ClusteredMRTKernel::getRunningTasks(vector<AbsRTTask *> &out) const
+    {
+        out.clear();
+        for (size_t c = 0; c < _clusters.size(); ++c) {
+            const MRTKernel &k = *_clusters[c];
+            for (size_t i = 0; i < k.getProcessorCount(); ++i)
+                if (k.getTaskAt(i) != NULL) out.push_back(k.getTaskAt(i));
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   begin                : Thu Apr 24 15:54:58 CEST 2003
+ *   copyright            : (C) 2003 by Giuseppe Lipari
+ *   email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CLUSTEREDMRTKERNEL_HPP__
+#define __CLUSTEREDMRTKERNEL_HPP__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <entity.hpp>
+
+#include <kernel.hpp>
+#include <mrtkernel.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    class absCPUFactory;
+    class Scheduler;
+
+    /**
+        \ingroup kernel
+
+        A multiprocessor kernel with clustered scheduling: the
+        processors are partitioned into clusters, and every cluster
+        is a MRTKernel, with its own scheduler and its own ready
+        queue. A task belongs to one cluster at a time, and it is
+        scheduled globally on the processors of that cluster only.
+
+        With m processors in clusters of c, every dispatch looks at
+        a ready queue and a heap of c processors instead of m, and
+        the clusters do not share any state: c = 1 gives
+        partitioned scheduling, a single cluster gives global
+        scheduling.
+
+        The migration of a task to another cluster is explicit (see
+        migrate()), and it is allowed only between two instances
+        of the task.
+
+        <pre>
+        EDFScheduler s0, s1;
+        ClusteredMRTKernel kern("kern");
+        kern.addCluster(&s0, 4);
+        kern.addCluster(&s1, 4);
+        kern.addTask(t1, 0);
+        kern.addTask(t2, 1);
+        </pre>
+
+        @see MRTKernel
+    */
+    class ClusteredMRTKernel : public Entity {
+        /// the clusters, named <name>_c0, <name>_c1, ...
+        std::vector<std::unique_ptr<MRTKernel> > _clusters;
+
+        /// the cluster of each task
+        std::unordered_map<const AbsRTTask *, int> _taskCluster;
+
+        MRTKernel &cluster(int c) const;
+
+    public:
+        ClusteredMRTKernel(const std::string &name = "");
+
+        ~ClusteredMRTKernel();
+
+        /**
+           Adds a cluster of n processors created by the default
+           CPU factory, scheduled by s (which is not owned by the
+           kernel). Returns the index of the cluster.
+         */
+        int addCluster(Scheduler *s, int n);
+
+        /**
+           Adds a cluster of n processors created by fact (which is
+           owned by the cluster from now on), scheduled by s.
+           Returns the index of the cluster.
+         */
+        int addCluster(Scheduler *s, absCPUFactory *fact, int n);
+
+        /// Number of clusters
+        int getClusterCount() const { return int(_clusters.size()); }
+
+        /// The kernel of cluster c
+        MRTKernel *getCluster(int c) const { return &cluster(c); }
+
+        /// The cluster of task t (-1 if t does not belong to this kernel)
+        int getClusterOf(const AbsRTTask *t) const;
+
+        /**
+           Adds task t to cluster c, with the scheduling parameters
+           param.
+         */
+        void addTask(AbsRTTask &t, int c, const std::string &param = "");
+
+        /**
+           Moves task t to cluster c, with the scheduling parameters
+           param. The task must not be active: the next instance
+           will be scheduled by the new cluster.
+
+           @throws RTKernelExc if the task is active or does not
+           belong to this kernel
+         */
+        void migrate(AbsRTTask &t, int c, const std::string &param = "");
+
+        /**
+           Returns a pointer to the CPU on which t is running (NULL
+           if t is not running on any CPU)
+         */
+        CPU *getProcessor(const AbsRTTask *t) const;
+
+        /// The processors of all clusters, cluster by cluster
+        std::vector<CPU *> getProcessors() const;
+
+        /// The names of the running tasks, cluster by cluster
+        std::vector<std::string> getRunningTasks();
+
+        /**
+           Stores in out the processors of all clusters, cluster by
+           cluster, without allocating once out has grown
+        */
+        void getProcessors(std::vector<CPU *> &out) const;
+
+        /// Stores in out the running tasks, cluster by cluster
+        void getRunningTasks(std::vector<AbsRTTask *> &out) const;
+
+        void newRun() {}
+        void endRun() {}
+    };
+} // namespace RTSim
+
+#endif
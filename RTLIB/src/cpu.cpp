@@ -11,12 +11,28 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
+
+#include <simul.hpp>
+
 #include <cpu.hpp>
 
 namespace RTSim {
+
+    static bool slowerLevel(const cpulevel &a, const cpulevel &b)
+    {
+        return a.frequency < b.frequency;
+    }
+
+    static bool belowLoad(const cpulevel &l, double load)
+    {
+        return l.speed < load;
+    }
   
     CPU::CPU(const std::string &name): Entity(name), frequencySwitching(0),
-                                       index(0)
+                                       index(0), _energy(0), _lastChange(0),
+                                       _busy(0), _work(0), _workTime(0),
+                                       _armed(0), _armedWork(0), _occupancy()
     {
         cpuName = name;
         PowerSaving = false;
@@ -24,7 +40,9 @@ namespace RTSim {
   
   
     CPU::CPU(const std::string &name, int num_levels, double V[], int F[]) : 
-        Entity(name), frequencySwitching(0), index(0)
+        Entity(name), frequencySwitching(0), index(0), _energy(0),
+        _lastChange(0), _busy(0), _work(0), _workTime(0), _armed(0),
+        _armedWork(0), _occupancy()
     {
         cpuName = name;
     
@@ -33,14 +51,18 @@ namespace RTSim {
             cpulevel cl;
             cl.voltage = V[i];
             cl.frequency = F[i];
+            cl.power = F[i] * V[i] * V[i];
             steps.push_back(cl);
         }
+        stable_sort(steps.begin(), steps.end(), slowerLevel);
     
         // Setting speeds (basing upon frequencies)
         for (vector<cpulevel>::iterator iter = steps.begin(); 
-             iter != steps.end(); iter++)
+             iter != steps.end(); iter++) {
             (*iter).speed = ((double) (*iter).frequency) / 
-                ((double)F[num_levels -1]);
+                ((double)steps.back().frequency);
+            (*iter).fixedSpeed = toFixedSpeed((*iter).speed);
+        }
     
         currentLevel = num_levels - 1;
         PowerSaving = true;
@@ -63,9 +85,8 @@ namespace RTSim {
   
     double CPU::getMaxPowerConsumption()
     {
-        int numlevels = steps.size();
         if (PowerSaving) 
-            return (steps[numlevels-1].frequency)*(steps[numlevels-1].voltage)*(steps[numlevels-1].voltage);
+            return steps.back().power;
         else
             return 0;
     } 
@@ -73,7 +94,7 @@ namespace RTSim {
     double CPU::getCurrentPowerConsumption()
     {
         if (PowerSaving) 
-            return (steps[currentLevel].frequency)*(steps[currentLevel].voltage)*(steps[currentLevel].voltage);
+            return steps[currentLevel].power;
         else
             return 0;
     }
@@ -98,15 +119,27 @@ namespace RTSim {
         if (PowerSaving) { 
             DBGPRINT("pwr: PowerSaving=on");
             DBGPRINT("pwr: currentLevel=" << currentLevel);
-            for (int i=0; i < (int) steps.size(); i++) 
-                if (steps[i].speed >= newLoad) {
-                    if (i != currentLevel) 
-                        frequencySwitching++;
-                    currentLevel = i;
-                    DBGPRINT("pwr: New Level=" << currentLevel <<" New Speed=" << steps[currentLevel].speed);
-                    
-                    return steps[i].speed; //It returns the new speed
+            int i = getLevel(newLoad);
+            if (i >= 0) {
+                if (i != currentLevel) {
+                    accountEnergy();
+                    frequencySwitching++;
+                    _work = getWork();
+                    _workTime = SIMUL.getTime();
+                }
+                currentLevel = i;
+                if (_armed != 0) {
+                    Tick end = getTimeOf(_armedWork);
+                    if (!_armed->isInQueue() || end < _armed->getTime() ||
+                        _armed->hasProbes()) {
+                        _armed->drop();
+                        _armed->post(end);
+                    }
                 }
+                DBGPRINT("pwr: New Level=" << currentLevel <<" New Speed=" << steps[currentLevel].speed);
+
+                return steps[i].speed; //It returns the new speed
+            }
         }
         else 
             DBGPRINT("pwr: PowerSaving=off => Can't set a new speed!");
@@ -133,6 +166,38 @@ namespace RTSim {
             return steps[level].speed;
     }
   
+    int CPU::getLevel(double load) const
+    {
+        if (!PowerSaving) return -1;
+        vector<cpulevel>::const_iterator i =
+            lower_bound(steps.begin(), steps.end(), load, belowLoad);
+        return i == steps.end() ? -1 : int(i - steps.begin());
+    }
+
+    void CPU::getLevels(const double loads[], int levels[], int n) const
+    {
+        if (!PowerSaving) {
+            fill(levels, levels + n, -1);
+            return;
+        }
+        // the search for a load starts from the level of the previous
+        // one, if it is not greater
+        vector<cpulevel>::const_iterator from = steps.begin();
+        for (int k = 0; k < n; ++k) {
+            if (k > 0 && loads[k] < loads[k - 1]) from = steps.begin();
+            vector<cpulevel>::const_iterator i =
+                lower_bound(from, steps.end(), loads[k], belowLoad);
+            levels[k] = i == steps.end() ? -1 : int(i - steps.begin());
+            from = i;
+        }
+    }
+
+    double CPU::getPower(int level) const
+    {
+        if (!PowerSaving || level < 0 || level >= (int) steps.size()) return 0;
+        return steps[level].power;
+    }
+
     unsigned long int CPU::getFrequencySwitching() 
     {
         DBGENTER(_KERNEL_DBG_LEV);
@@ -144,6 +209,77 @@ namespace RTSim {
   
   
   
+    void CPU::accountEnergy()
+    {
+        Tick t = SIMUL.getTime();
+        _energy += getCurrentPowerConsumption() * double(t - _lastChange);
+        _lastChange = t;
+    }
+
+    double CPU::getEnergy()
+    {
+        return _energy + getCurrentPowerConsumption() *
+            double(SIMUL.getTime() - _lastChange);
+    }
+
+    Tick CPU::getTimeOf(int64_t work) const
+    {
+        int64_t left = work - getWork();
+        if (left <= 0) return SIMUL.getTime();
+        int64_t s = getFixedSpeed();
+        return SIMUL.getTime() + Tick((left + s - 1) / s);
+    }
+
+    void CPU::newRun()
+    {
+        _energy = 0;
+        _lastChange = SIMUL.getTime();
+        _busy = 0;
+        _occupancy.reset(SIMUL.getTime());
+        _work = 0;
+        _workTime = SIMUL.getTime();
+        _armed = 0;
+    }
+
+    void CPU::endRun()
+    {
+        accountEnergy();
+    }
+
+    void CPU::saveState(Checkpoint &c)
+    {
+        c.put(currentLevel);
+        c.put(frequencySwitching);
+        c.put(_energy);
+        c.put(_lastChange);
+        c.put(_busy);
+        c.put(_work);
+        c.put(_workTime);
+        c.put(_armed);
+        c.put(_armedWork);
+        c.put(_occupancy);
+    }
+
+    void CPU::loadState(Checkpoint &c)
+    {
+        c.get(currentLevel);
+        c.get(frequencySwitching);
+        c.get(_energy);
+        c.get(_lastChange);
+        c.get(_busy);
+        c.get(_work);
+        c.get(_workTime);
+        c.get(_armed);
+        c.get(_armedWork);
+        c.get(_occupancy);
+    }
+
+    bool CPU::getSignature(StateImage &s)
+    {
+        s.put(currentLevel);
+        return true;
+    }
+
     void CPU::check(){
         cout << "Checking CPU:" << cpuName << endl;;
         cout << "Max Power Consumption is :" << getMaxPowerConsumption() << endl;
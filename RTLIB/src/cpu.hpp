@@ -14,10 +14,14 @@
 #ifndef __CPU_HPP__
 #define __CPU_HPP__
 
+#include <cmath>
 #include <set>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#include <simul.hpp>
+#include <timeintegral.hpp>
 #include <trace.hpp>
 
 #include <timer.hpp>
@@ -38,6 +42,12 @@ namespace RTSim {
     
         /// The speed is a value between 0 and 1
         double speed;
+
+        /// Power consumption (frequency * voltage^2)
+        double power;
+
+        /// The speed in fixed point (see CPU::SPEED_ONE)
+        int64_t fixedSpeed;
     };
 
     /** 
@@ -53,6 +63,7 @@ namespace RTSim {
     */
     class CPU : public Entity {
 
+        /// The levels, sorted by increasing speed
         vector<cpulevel> steps;
     
         /// Name of the CPU
@@ -69,7 +80,48 @@ namespace RTSim {
         // this is the CPU index in a multiprocessor environment
         int index; 
 
+        /// Energy consumed in the run until _lastChange
+        double _energy;
+
+        /// Last time _energy has been updated
+        Tick _lastChange;
+
+        /// Time spent executing tasks in the run (see addBusyTime())
+        Tick _busy;
+
+        /// Adds the energy consumed since _lastChange
+        void accountEnergy();
+
+        /// Work executed in the run until _workTime (see getWork())
+        int64_t _work;
+
+        /// Last time _work has been updated
+        Tick _workTime;
+
+        /// The end event of the instruction running here (see arm())
+        Event *_armed;
+
+        /// The value of getWork() at which _armed is due
+        int64_t _armedWork;
+
+        /// The tasks executing here, over the time (see getOccupancy())
+        TimeIntegral _occupancy;
+
     public:
+        /**
+           The full speed in fixed point. Execution times are
+           computed in integer arithmetic: a tick at speed s
+           executes toFixedSpeed(s) units of work, and a tick of
+           computation at full speed is SPEED_ONE units.
+        */
+        static const int64_t SPEED_ONE = 1 << 20;
+
+        /// A speed (between 0 and 1) in fixed point, never 0
+        static int64_t toFixedSpeed(double s) {
+            int64_t f = llround(s * SPEED_ONE);
+            return f > 0 ? f : 1;
+        }
+
         /// Constructor for CPUs without Power Saving
         CPU(const std::string &name = "");
     
@@ -82,7 +134,7 @@ namespace RTSim {
         void setIndex(int i) { index = i; }
 
         /// get the processor index
-        int getIndex() { return index; }
+        int getIndex() const { return index; }
 
         /// Useful for debug
         virtual int getCurrentLevel();
@@ -109,11 +161,106 @@ namespace RTSim {
         virtual double getSpeed();
     
         virtual double getSpeed(int level);
+
+        /// Returns the current speed in fixed point
+        int64_t getFixedSpeed() const {
+            return PowerSaving ? steps[currentLevel].fixedSpeed : SPEED_ONE;
+        }
+
+        /**
+           Returns the work (in fixed point, see SPEED_ONE) that a
+           task running since the start of the run would have
+           executed until now. The work done by an instruction
+           between two instants is the difference of the values at
+           those instants, whatever the speed changes in between:
+           a change of speed only updates this clock.
+        */
+        int64_t getWork() const {
+            return _work + int64_t(SIMUL.getTime() - _workTime) * getFixedSpeed();
+        }
+
+        /// The first tick at which getWork() is at least work
+        Tick getTimeOf(int64_t work) const;
+
+        /**
+           Registers e as the end event of the instruction running
+           on this processor, due when getWork() reaches work. When
+           the speed changes, the event is moved earlier if the
+           work ends sooner; if it ends later, the event is left in
+           place (unless it has probes), and the instruction posts
+           it again when it is triggered too early. So a change of
+           speed costs at most one queue operation, and none when
+           the processor slows down.
+        */
+        void arm(Event *e, int64_t work) { _armed = e; _armedWork = work; }
+
+        /// Unregisters e, if it is the armed event
+        void disarm(Event *e) { if (_armed == e) _armed = 0; }
+
+        /**
+           Returns the level that setSpeed(load) would select (the
+           slowest one with a speed not smaller than load), or -1 if
+           there is none or the CPU has no Power Saving. It does not
+           change the speed.
+        */
+        int getLevel(double load) const;
+
+        /**
+           Batch version of getLevel(): levels[i] is set to
+           getLevel(loads[i]), for each of the n loads. Calling it
+           with the loads sorted is faster than in random order.
+        */
+        void getLevels(const double loads[], int levels[], int n) const;
+
+        /// Returns the power consumption of a level
+        double getPower(int level) const;
     
         virtual unsigned long int getFrequencySwitching();
+
+        /**
+           Returns the energy consumed in the current run, until
+           now: the integral of the power consumption (see
+           getCurrentPowerConsumption()) over the time, updated
+           exactly at every change of the speed level. The unit is
+           MHz * V^2 * tick. It is always 0 for a CPU without Power
+           Saving.
+        */
+        virtual double getEnergy();
+
+        /**
+           Returns the time the processor has spent executing tasks
+           in the current run, up to the last time a task left it.
+           It is a counter updated by the tasks (see
+           Task::getCounters()), read without probing any event.
+        */
+        Tick getBusyTime() const { return _busy; }
+
+        /// Called by a task that leaves the processor after t ticks
+        void addBusyTime(const Tick &t) { _busy += t; }
+
+        /**
+           The number of tasks executing on the processor (0 or
+           1) over the time, updated by the tasks when they enter
+           and leave it: unlike getBusyTime(), its area includes
+           the task executing now. The idle fraction (see
+           IdleFractionStat) is read from it without probing any
+           event.
+        */
+        const TimeIntegral &getOccupancy() const { return _occupancy; }
+
+        /// Called by a task when it starts executing here, and when it leaves
+        void enterTask() { _occupancy.set(SIMUL.getTime(), _occupancy.get() + 1); }
+        void leaveTask() { _occupancy.set(SIMUL.getTime(), _occupancy.get() - 1); }
     
-        virtual void newRun() {}
-        virtual void endRun() {}
+        virtual void newRun();
+        virtual void endRun();
+
+        /// Saves the speed level, the energy and the work done
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
+        /// Writes the current speed level (see Entity::getSignature())
+        virtual bool getSignature(StateImage &s);
     
         ///Useful for debug
         virtual void check();
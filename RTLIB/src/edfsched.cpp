@@ -32,6 +32,15 @@ namespace RTSim {
 
     void EDFScheduler::removeTask(AbsRTTask* task)
     {
+        dropModel(task);
+    }
+
+    bool EDFScheduler::getSignature(StateImage &s)
+    {
+        signQueue(s);
+        for (unsigned int i = 0; i < queueSize(); ++i)
+            s.putTime(queueAt(i)->getPriority());
+        return true;
     }
 
 
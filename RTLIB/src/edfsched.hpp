@@ -47,6 +47,20 @@ namespace RTSim {
                 }
             }
 
+        void saveState(Checkpoint &c)
+            {
+                TaskModel::saveState(c);
+                c.put(extP);
+                c.put(prio);
+            }
+
+        void loadState(Checkpoint &c)
+            {
+                TaskModel::loadState(c);
+                c.get(extP);
+                c.get(prio);
+            }
+
     };
 
 
@@ -71,6 +85,9 @@ namespace RTSim {
 
         void removeTask(AbsRTTask* task);
 
+        /// Writes the ready queue and the (relative) deadlines
+        virtual bool getSignature(StateImage &s);
+
         static EDFScheduler *createInstance(vector<string> &par);
 
     };
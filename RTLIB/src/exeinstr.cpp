@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 
+#include <checkpoint.hpp>
 #include <factory.hpp>
 #include <simul.hpp>
 #include <strtoken.hpp>
@@ -32,15 +33,36 @@ namespace RTSim {
     using namespace parse_util;
 
     ExecInstr::ExecInstr(Task *f, RandomVar *c, char *n) : 
-        Instr(f, n), cost(c), _endEvt(this) 
+        Instr(f, n), cost(c), _var(cost.get()), _next(0), _parts(), _st(),
+        _endEvt(this)
     {
         DBGTAG(_INSTR_DBG_LEV,"ExecInstr");
+        ExecInstr::newRun();
+        setResetState(&_st, sizeof(_st));
     }
 
     ExecInstr::ExecInstr(Task *f, auto_ptr<RandomVar> &c, char *n) : 
-        Instr(f, n), cost(c), _endEvt(this) 
+        Instr(f, n), cost(c), _var(cost.get()), _next(0), _parts(), _st(),
+        _endEvt(this)
     {
         DBGTAG(_INSTR_DBG_LEV,"ExecInstr");
+        ExecInstr::newRun();
+        setResetState(&_st, sizeof(_st));
+    }
+
+    ExecInstr::ExecInstr(Task *f, RandomVar &c, const std::string &n) : 
+        Instr(f, n), cost(), _var(&c), _next(0), _parts(), _st(),
+        _endEvt(this)
+    {
+        DBGTAG(_INSTR_DBG_LEV,"ExecInstr");
+        ExecInstr::newRun();
+        setResetState(&_st, sizeof(_st));
+    }
+
+    void ExecInstr::setCost(RandomVar *c)
+    {
+        cost.reset(c);
+        _var = c;
     }
 
     Instr *ExecInstr::createInstance(vector<string> &par)
@@ -52,11 +74,13 @@ namespace RTSim {
             temp = new FixedInstr(task, atoi(par[0].c_str()));
         }
         else {
-            string token = get_token(par[0]);
-            string p = get_param(par[0]);
-            vector<string> parms = split_param(p);
+            string token = token_of(par[0]).str();
+            vector<substring> p;
+            split_param(param_of(par[0]), p);
+            vector<string> parms;
+            assign(p, parms);
 
-            auto_ptr<RandomVar> var(genericFactory<RandomVar>::instance().create(token,parms));
+            auto_ptr<RandomVar> var(genericFactory<RandomVar>::instance().create(token,parms).release());
     
             if (var.get() == 0) throw ParseExc("ExecInstr", par[0]);
 
@@ -67,10 +91,14 @@ namespace RTSim {
 
     void ExecInstr::newRun() 
     {
-        actTime = lastTime = 0;
-        flag = true;
-        execdTime = 0;
-        executing = false;
+        _st.actTime = _st.lastTime = 0;
+        _st._cpu = 0;
+        _st._startWork = 0;
+        _st.flag = true;
+        _st.execdTime = 0;
+        _st.currentCost = 0;
+        _st.executing = false;
+        _st._fused = 0;
     }
 
     void ExecInstr::endRun() 
@@ -78,21 +106,49 @@ namespace RTSim {
         _endEvt.drop();
     }
 
+    void ExecInstr::saveState(Checkpoint &c)
+    {
+        Instr::saveState(c);
+        c.put(_parts);
+    }
+
+    void ExecInstr::loadState(Checkpoint &c)
+    {
+        Instr::loadState(c);
+        c.get(_parts);
+    }
+
+    bool ExecInstr::getSignature(StateImage &s)
+    {
+        if (dynamic_cast<DeltaVar *>(_var) == NULL) return false;
+
+        s.put(_st.flag);
+        s.put(_st.executing);
+        s.put(int64_t(_st.execdTime));
+        s.put(int64_t(_st.currentCost));
+        s.put(_st.actTime);
+        if (_st.executing) s.putTime(_st.lastTime);
+        s.put(_st._fused);
+        for (size_t i = 0; i < _parts.size(); ++i) 
+            s.put(int64_t(_parts[i]));
+        return true;
+    }
+
     Tick ExecInstr::getExecTime() const 
     { 
         Tick t = SIMUL.getTime();
-        if (executing) return (execdTime + t - lastTime);
-        else return execdTime;
+        if (_st.executing) return (_st.execdTime + t - _st.lastTime);
+        else return _st.execdTime;
     }
 
     Tick ExecInstr::getDuration() const 
     { 
-        return (Tick)cost->get();
+        return (Tick)_var->get();
     }
 
     Tick ExecInstr::getWCET() const throw(RandomVar::MaxException)
     { 
-        return (Tick) cost->getMaximum();
+        return (Tick) _var->getMaximum();
     }
 
     void ExecInstr::schedule() throw (InstrExc)
@@ -100,37 +156,35 @@ namespace RTSim {
         DBGENTER(_INSTR_DBG_LEV);
 
         Tick t = SIMUL.getTime();
-        lastTime = t;
-        executing = true;
+        _st.lastTime = t;
+        _st.executing = true;
 
-        if (flag) {
+        if (_st.flag) {
   
             DBGPRINT_3("Initializing ExecInstr ",
                        getName(), 
                        " at first schedule.");
             DBGPRINT_2("Time executed during the prev. instance: ", 
-                       execdTime);
+                       _st.execdTime);
 
-            execdTime = 0; 
-            actTime = 0;
-            flag = false;
-            currentCost = Tick(cost->get());
+            _st.execdTime = 0; 
+            _st.actTime = 0;
+            _st.flag = false;
+            _st.currentCost = Tick(_var->draw());
+            fuse();
 
             DBGPRINT_2("Time to execute for this instance: ",
-                       currentCost);
+                       _st.currentCost);
         }
 
         CPU *p = _father->getCPU();
         if (!dynamic_cast<CPU *>(p)) 
             throw InstrExc("No CPU!", "ExeInstr::schedule()");
 
-        double currentSpeed = p->getSpeed();
-  
-        Tick tmp = 0;
-        if (((double)currentCost) > actTime)
-            tmp = (Tick) ceil( ((double)currentCost - actTime)/currentSpeed);
-        
-        _endEvt.post(t + tmp);
+        _st._cpu = p;
+        _st._startWork = p->getWork();
+        _endEvt.post(p->getTimeOf(endWork()));
+        p->arm(&_endEvt, endWork());
 	      
         DBGPRINT("End of ExecInstr::schedule() ");
         
@@ -145,19 +199,13 @@ namespace RTSim {
 
         _endEvt.drop();
 
-        if (executing) {
-            CPU *p = _father->getOldCPU();
-            if (!dynamic_cast<CPU *>(p)) 
-                throw InstrExc("No CPU!", 
-                               "ExeInstr::deschedule()");
-    
-            double currentSpeed = p->getSpeed();
-
-            actTime += ((double)(t - lastTime))*currentSpeed;// number of cycles
-            execdTime += (t - lastTime);// number of ticks
-            lastTime = t; 
+        if (_st.executing) {
+            _st.actTime += _st._cpu->getWork() - _st._startWork;
+            _st.execdTime += (t - _st.lastTime);// number of ticks
+            _st.lastTime = t; 
+            _st._cpu->disarm(&_endEvt);
         }
-        executing = false;
+        _st.executing = false;
 
         
     }
@@ -172,13 +220,21 @@ namespace RTSim {
         DBGENTER(_INSTR_DBG_LEV);
         DBGPRINT("Ending ExecInstr named: " << getName());
 
+        // the processor slowed down after the event was posted
+        if (_st.executing && _st._cpu->getWork() < endWork()) {
+            _endEvt.post(_st._cpu->getTimeOf(endWork()));
+            return;
+        }
+        if (_st._cpu != 0) _st._cpu->disarm(&_endEvt);
+
         Tick t = SIMUL.getTime();
-        execdTime += t - lastTime;
-        flag = true;
-        executing = false;
-        lastTime = t;
-        actTime = 0;
+        _st.execdTime += t - _st.lastTime;
+        _st.flag = true;
+        _st.executing = false;
+        _st.lastTime = t;
+        _st.actTime = 0;
         _endEvt.drop();
+        if (_st._fused > 0) split();
 
         DBGPRINT("internal data set... now calling the _father->onInstrEnd()");
 
@@ -192,10 +248,12 @@ namespace RTSim {
     {
         DBGENTER(_INSTR_DBG_LEV);
 
-        actTime = lastTime = 0;
-        flag = true;
-        execdTime = 0;
+        _st.actTime = _st.lastTime = 0;
+        _st.flag = true;
+        _st.execdTime = 0;
+        _st._fused = 0;
         _endEvt.drop();
+        if (_st._cpu != 0) _st._cpu->disarm(&_endEvt);
 
         DBGPRINT("internal data reset...");
 
@@ -203,6 +261,48 @@ namespace RTSim {
     }
 
 
+    void ExecInstr::fuse()
+    {
+        _st._fused = 0;
+        _parts.clear();
+        if (_endEvt.hasAttachedProbes()) return;
+
+        for (ExecInstr *i = _next; i != 0 && !i->_endEvt.hasAttachedProbes();
+             i = i->_next) {
+            if (_parts.empty()) _parts.push_back(_st.currentCost);
+            i->enterJob(_epoch);
+            i->_st.flag = false;
+            i->_st.currentCost = Tick(i->_var->draw());
+            _parts.push_back(i->_st.currentCost);
+            _st.currentCost += i->_st.currentCost;
+            _st._fused++;
+        }
+        DBGPRINT_2("Instructions merged: ", _st._fused);
+    }
+
+    void ExecInstr::split()
+    {
+        // the segment ran for execdTime ticks: each instruction gets
+        // the ticks between the boundaries of its own cycles
+        double total = (double)_st.currentCost;
+        Tick done = _st.execdTime;
+        double cum = 0;
+        Tick prev = 0;
+        ExecInstr *i = this;
+        for (unsigned int k = 0; k <= _st._fused; ++k, i = i->_next) {
+            cum += (double)_parts[k];
+            Tick b = done;
+            if (k < _st._fused)
+                b = total > 0 ? Tick(floor((double)done * cum / total + 0.5))
+                    : Tick(0);
+            i->_st.execdTime = b - prev;
+            i->_st.flag = true;
+            i->_st.executing = false;
+            i->_st.lastTime = _st.lastTime;
+            prev = b;
+        }
+    }
+
     Instr *FixedInstr::createInstance(vector<string> &par)
     {
         Task *task = dynamic_cast<Task *>(Entity::_find(par[1]));
@@ -210,18 +310,17 @@ namespace RTSim {
     }
 
 
-    void ExecInstr::refreshExec(double oldSpeed, double newSpeed){
-        Tick t = SIMUL.getTime();
+    int64_t ExecInstr::endWork() const
+    {
+        return _st._startWork + int64_t(_st.currentCost) * CPU::SPEED_ONE
+            - _st.actTime;
+    }
+
+    void ExecInstr::refreshExec(double, double)
+    {
+        if (!_st.executing) return;
         _endEvt.drop();
-        actTime += ((double)(t - lastTime))*oldSpeed;
-        execdTime += (t - lastTime);
-        lastTime = t;
-   
-        Tick tmp = 0;
-        if (((double)currentCost) > actTime)
-            tmp = (Tick) ceil ((((double) currentCost) - actTime)/newSpeed);
-	   
-        _endEvt.post(t + tmp);
+        _endEvt.post(_st._cpu->getTimeOf(endWork()));
     }
 
 }
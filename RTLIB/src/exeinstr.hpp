@@ -29,6 +29,7 @@
 #define __EXEINSTR_HPP__
 
 #include <memory>
+#include <vector>
 
 //From metasim
 #include <debugstream.hpp>
@@ -44,6 +45,8 @@ namespace RTSim {
   using namespace std;
   using namespace MetaSim;
 
+  class CPU;
+
   /** 
       \ingroup instr
 
@@ -51,26 +54,53 @@ namespace RTSim {
       basic block of time-consuming computation, and are the basic
       building block of a real task
 
+      The state of a run is reset with a memcpy between two runs
+      (see Entity::setResetState()), so derived classes cannot
+      rely on newRun(), which is not called. The cost is a
+      parameter, and is left out of that state (see setCost()).
+
       @author Luigi Palopoli, Giuseppe Lipari, Gerardo Lamastra, Antonio Casile
       @version 2.0 
       @see Instr */
 
   class ExecInstr : public Instr {
   protected:
-    /// End of Instruction flag
-    bool flag;         
     /// Random var representing the instruction cost/duration
     auto_ptr<RandomVar> cost;
-    /// Actual Real-Time execution of the instruction
-    Tick execdTime;    
-    /// Duration of the current instruction 
-    Tick currentCost;  
-    /// Execution time spent by the instruction
-    double actTime;   
-    /// Last instant of time this instruction was scheduled
-    Tick lastTime;     
-    /// True if the instruction is currently executing
-    bool executing;    
+    /// The cost actually used: cost, or a variable of a TaskProgram
+    RandomVar *_var;
+    /// The following instruction, if it is an ExecInstr too
+    ExecInstr *_next;
+    /// Costs of this and of the merged instructions
+    vector<Tick> _parts;
+
+    /// The state of a run, reset with a memcpy between two runs
+    /// (see Entity::setResetState())
+    struct RunState {
+        /// End of Instruction flag
+        bool flag;
+        /// Actual Real-Time execution of the instruction
+        Tick execdTime;
+        /// Duration of the current instruction
+        Tick currentCost;
+        /// Work done by the instruction (fixed point, see CPU::SPEED_ONE)
+        int64_t actTime;
+        /// The processor it is executing on
+        CPU *_cpu;
+        /// CPU::getWork() of _cpu when it was last scheduled
+        int64_t _startWork;
+        /// Last instant of time this instruction was scheduled
+        Tick lastTime;
+        /// True if the instruction is currently executing
+        bool executing;
+        /// Number of following instructions merged in this job
+        unsigned int _fused;
+    } _st;
+
+    void fuse();
+    void split();
+    /// The CPU::getWork() of _cpu at which the instruction ends
+    int64_t endWork() const;
   public:
 
     EndInstrEvt _endEvt;
@@ -81,10 +111,23 @@ namespace RTSim {
     */
     ExecInstr(Task *f, RandomVar *c, char *n = "");
     ExecInstr(Task *f, auto_ptr<RandomVar> &c, char *n="");
+    /**
+       Builds an instruction whose cost is c, a variable that is
+       not owned by the instruction (it belongs to a TaskProgram,
+       and may be shared by many instructions).
+    */
+    ExecInstr(Task *f, RandomVar &c, const std::string &n = "");
     static Instr *createInstance(vector<string> &par);
 
     virtual ~ExecInstr() {}
 
+    /**
+       Changes the cost of the instruction to c, which is now
+       owned by the instruction (between two runs, see
+       Task::setPhase()).
+    */
+    void setCost(RandomVar *c);
+
     //Virtual methods from Instr
     virtual void schedule() throw (InstrExc);
     virtual void deschedule();
@@ -94,14 +137,32 @@ namespace RTSim {
     virtual Tick getWCET() const throw(RandomVar::MaxException);
     virtual Tick getExecTime() const;
     virtual void setTrace(Trace *t);
+    virtual unsigned int getSpan() const { return _st._fused + 1; }
+
+    /**
+       Links this instruction to the following one in the task
+       code (see Task::insertCode()). At its first schedule in a
+       job, the instruction draws the cost of the untraced
+       ExecInstrs that follow it and executes them as a single
+       segment, with one end event. At the end, the execution
+       time of the segment is split among them in proportion to
+       their cost, so each one still reports its own.
+    */
+    void setNext(ExecInstr *n) { _next = n; }
 
     //From Entity...
     virtual void newRun();
     virtual void endRun();
+    /// Saves the state of the run and the costs of a merged segment
+    virtual void saveState(Checkpoint &c);
+    virtual void loadState(Checkpoint &c);
+    /// Only an instruction with a deterministic cost can describe its state
+    virtual bool getSignature(StateImage &s);
 
 
-    /** Function inherited from Instr. It refreshes the state of the 
-     *  executing instruction when a change of the CPU speed occurs. 
+    /** Function inherited from Instr. The processor already moves
+     *  the end event when its speed changes (see CPU::arm()): this
+     *  only posts it again at the exact end.
      */ 
     void refreshExec(double oldSpeed, double newSpeed);
 
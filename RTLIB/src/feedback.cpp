@@ -4,7 +4,7 @@
 namespace RTSim {
 
     AbstractFeedbackModule::AbstractFeedbackModule(const std::string &name) :
-        Entity(name), task(0)
+        Entity(name), task(0), _request(-1)
     {
     }
 
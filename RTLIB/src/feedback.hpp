@@ -8,6 +8,8 @@ namespace RTSim {
 
     using namespace MetaSim;
 
+    class BudgetBatch;
+    class Server;
     class Task;
 
     /**
@@ -17,6 +19,11 @@ namespace RTSim {
     class AbstractFeedbackModule : public Entity {
     protected:
         Task *task;
+    private:
+        // the slot of the pending request in its BudgetBatch (-1
+        // if there is none)
+        int _request;
+        friend class BudgetBatch;
     public:
         AbstractFeedbackModule(const std::string &name);
         virtual ~AbstractFeedbackModule();
@@ -25,6 +32,13 @@ namespace RTSim {
 
         virtual void notify(const Tick &exec_time) = 0;
 
+        /**
+           Called by a BudgetBatch with the effective change delta
+           to the budget of s, when the requests of the tick have
+           been passed to the supervisor.
+        */
+        virtual void onBudgetGranted(Server *s, const Tick &delta) {}
+
         virtual void newRun() = 0;
         virtual void endRun() = 0;
     };
@@ -8,8 +8,8 @@
 
 namespace RTSim {
     FeedbackModuleARSim::FeedbackModuleARSim(const std::string &name) :
-        AbstractFeedbackModule(name), sp(0), ss(0), p_ctrl(0),
-        _sched_err(0), _required_bw(0), _granted_bw(0)
+        AbstractFeedbackModule(name), sp(0), batch(0), ss(0), p_ctrl(0),
+        _sched_err(0), _required_bw(0), _granted_bw(0), _asked_from(0)
     {
     }
 
@@ -20,6 +20,14 @@ namespace RTSim {
     void FeedbackModuleARSim::setSupervisor(Supervisor *s, Server *s2)
     {
         sp = s;
+        batch = 0;
+        ss = s2;
+    }
+
+    void FeedbackModuleARSim::setBatch(BudgetBatch *b, Server *s2)
+    {
+        sp = 0;
+        batch = b;
         ss = s2;
     }
 
@@ -97,15 +105,20 @@ namespace RTSim {
             DBGVAR(_required_bw);
             delta_budget = -(Tick)floor( (double)ss->getBudget()-(double)ss->getPeriod()*(double)_required_bw );
             DBGVAR(delta_budget);
-	    Tick old_budget = ss->getBudget();
-	    Tick granted_delta_budget = sp->changeBudget(ss, delta_budget);
-	    Tick new_budget = old_budget + granted_delta_budget;
-	    DBGVAR(new_budget);
-	    _granted_bw = double(new_budget) / (double)ss->getPeriod();
-            DBGVAR(_granted_bw);
+	    _asked_from = ss->getBudget();
+	    if (batch != 0) batch->request(ss, delta_budget, this);
+	    else onBudgetGranted(ss, sp->changeBudget(ss, delta_budget));
 	}
     }
 
+    void FeedbackModuleARSim::onBudgetGranted(Server *s, const Tick &delta)
+    {
+        Tick new_budget = _asked_from + delta;
+        DBGVAR(new_budget);
+        _granted_bw = double(new_budget) / (double)s->getPeriod();
+        DBGVAR(_granted_bw);
+    }
+
     /** @TODO Supervisor from ARSim, or from RTLib ? */
     void FeedbackModuleARSim::onJobStart(const Tick &start_error)
     {
@@ -24,9 +24,11 @@ namespace RTSim {
 //         std::vector<int> deltas;
 //         int index;
         Supervisor *sp;
+        BudgetBatch *batch;
         Server *ss;
         Controller *p_ctrl;
         double _sched_err, _required_bw, _granted_bw;
+        Tick _asked_from;
 
     public:
 
@@ -35,6 +37,11 @@ namespace RTSim {
 
         void setSupervisor(Supervisor *s, Server *s2);
 
+        /** Requests the budget through b, which passes the
+         ** requests of the same tick to its supervisor at once
+         **/
+        void setBatch(BudgetBatch *b, Server *s2);
+
 //         void addSample(int d);
 
         virtual void notify(const Tick &exec_time);
@@ -58,6 +65,8 @@ namespace RTSim {
 	 **/
         virtual void onJobStart(const Tick &start_error);
 
+        virtual void onBudgetGranted(Server *s, const Tick &delta);
+
         /** Retrieve the maximum budget as required by the controller */
         virtual Tick getRequiredBudget() const;
 
@@ -20,10 +20,7 @@ namespace RTSim {
     {
         FIFOModel *model = new FIFOModel(task); 	
 
-        if (find(task) != NULL) 
-            throw RTSchedExc("Element already present");
-	
-        _tasks[task] = model;
+        enqueueModel(model);
     }
 
     void FIFOScheduler::addTask(AbsRTTask* task, const std::string &p)
@@ -40,4 +37,12 @@ namespace RTSim {
         // time quantum)
         return new FIFOScheduler;
     }
+
+    bool FIFOScheduler::getSignature(StateImage &s)
+    {
+        signQueue(s);
+        for (unsigned int i = 0; i < queueSize(); ++i)
+            s.putTime(queueAt(i)->getPriority());
+        return true;
+    }
 }
@@ -46,7 +46,10 @@ namespace RTSim {
 
         void addTask(AbsRTTask *t, const std::string &p);
 
-        void removeTask(AbsRTTask *t) {}
+        void removeTask(AbsRTTask *t) { dropModel(t); }
+
+        /// Writes the ready queue and the (relative) arrivals
+        virtual bool getSignature(StateImage &s);
 
         static FIFOScheduler *createInstance(vector<string> &par);
     };
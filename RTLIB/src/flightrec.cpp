@@ -0,0 +1,85 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <sstream>
+
+#include <flightrec.hpp>
+#include <task.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  FlightRecorder::FlightRecorder(const char *name, size_t events, int window)
+    : Trace(name, Trace::BINARY, false), JavaTrace(name, 0UL),
+      _ring(events > 0 ? events : 1), _head(0), _count(0), _window(window),
+      _names(), _trigger(), _onMiss(true), _last(0), _files()
+  {
+    // the records are encoded as for a file, but kept in memory
+    toFile = true;
+  }
+
+  void FlightRecorder::attachToTask(Task *t)
+  {
+    t->setTrace(this);
+    t->deadEvt.addTrace(this);
+  }
+
+  void FlightRecorder::emit(const char *rec, size_t n, int time, int task)
+  {
+    TraceRecord r(rec);
+    _last = time;
+    if (r.getType() == TraceEvent::TASK_NAME) {
+      _names.insert(_names.end(), rec, rec + n);
+      return;
+    }
+
+    size_t i = (_head + _count) % _ring.size();
+    if (_count == _ring.size()) _head = (_head + 1) % _ring.size();
+    else _count++;
+    _ring[i].rec.assign(rec, rec + n);
+    _ring[i].time = time;
+
+    if ((_onMiss && r.getType() == TraceEvent::TASK_DLINEMISS) ||
+        (_trigger && _trigger(r)))
+      dump(time);
+  }
+
+  void FlightRecorder::dump(int now)
+  {
+    string base = _filename, ext;
+    size_t dot = base.rfind('.');
+    if (dot != string::npos && base.find('/', dot) == string::npos) {
+      ext = base.substr(dot);
+      base.erase(dot);
+    }
+    stringstream fname;
+    fname << base << "_" << _files.size() + 1 << ext;
+
+    ofstream f(fname.str().c_str(), ios::binary);
+    if (!f.is_open()) throw Exc("Cannot open " + fname.str(), "FlightRecorder");
+    const char cver[] = "version 1.2";
+    f.write(cver, sizeof(cver));
+    if (!_names.empty()) f.write(&_names[0], _names.size());
+    for (size_t k = 0; k < _count; ++k) {
+      const Slot &s = _ring[(_head + k) % _ring.size()];
+      if (_window > 0 && s.time < now - _window) continue;
+      f.write(&s.rec[0], s.rec.size());
+    }
+    if (!f) throw Exc("Error writing " + fname.str(), "FlightRecorder");
+    _files.push_back(fname.str());
+    _head = _count = 0;
+  }
+
+} // namespace RTSim
@@ -0,0 +1,112 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __FLIGHTREC_HPP__
+#define __FLIGHTREC_HPP__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <jtrace.hpp>
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  class Task;
+
+  /**
+     \ingroup util
+
+     A JavaTrace that keeps only the last events in memory, and
+     writes them to disk when something goes wrong: the records
+     (see JavaTrace::writeRecord()) are copied in a ring of
+     slots, whose buffers are reused, so that tracing costs a
+     copy of a few bytes per event and no output at all.
+
+     When the trigger fires (by default, on a deadline miss) the
+     events of the ring, not older than window ticks if window is
+     not 0, are written in a JavaTrace file named after the
+     recorder (name_1.trc, name_2.trc, ... for name.trc), which
+     starts with the names of all the tasks traced so far. Then
+     the ring is emptied. A trigger can also be fired with
+     trigger(), for instance by a probe on a server event.
+
+     A recorder is meant for one kernel: its tasks are attached
+     with attachToTask(), which also traces their deadline
+     misses.
+  */
+  class FlightRecorder : public JavaTrace {
+  public:
+    /// Decides, from the last record, if the ring must be dumped
+    typedef std::function<bool(const TraceRecord &)> Trigger;
+
+  private:
+    struct Slot {
+      vector<char> rec;
+      int time;
+    };
+
+    vector<Slot> _ring;
+    /// the oldest slot, and the number of used slots
+    size_t _head, _count;
+    int _window;
+    /// NAME records, written at the beginning of each dump
+    vector<char> _names;
+    Trigger _trigger;
+    bool _onMiss;
+    int _last;
+    vector<string> _files;
+
+    void dump(int now);
+
+  protected:
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+  public:
+    /**
+       Keeps the last events events, not older than window ticks
+       (if window is not 0).
+    */
+    FlightRecorder(const char *name, size_t events = 4096, int window = 0);
+
+    /// Traces t, and its deadline misses
+    void attachToTask(Task *t);
+
+    /**
+       Adds a trigger: the ring is dumped after a record for
+       which f returns true.
+    */
+    void setTrigger(const Trigger &f) { _trigger = f; }
+
+    /// Enables (the default) or disables the dumps on deadline misses
+    void setTriggerOnMiss(bool f) { _onMiss = f; }
+
+    /// Dumps the ring now
+    void trigger() { dump(_last); }
+
+    /// Number of events in the ring
+    size_t size() const { return _count; }
+
+    /// The files written so far
+    const vector<string> &getFiles() const { return _files; }
+
+    virtual void close() {}
+  };
+
+} // namespace RTSim
+
+#endif
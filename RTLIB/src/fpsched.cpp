@@ -18,14 +18,130 @@
 
 namespace RTSim {
 
+    /// index of the least significant bit set in w (w != 0)
+    static inline int first_set(uint64_t w)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(w);
+#else
+        int i = 0;
+        while (!(w & 1)) { w >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    FPScheduler::FPScheduler() : Scheduler(), _inLevels(0), _useLevels(true)
+    {
+        for (int i = 0; i < LEVELS / WORD_BITS; ++i) _bitmap[i] = 0;
+    }
+
+    void FPScheduler::queueInsert(TaskModel *m)
+    {
+        if (!_useLevels) {
+            Scheduler::queueInsert(m);
+            return;
+        }
+
+        Tick p = m->getKeyPriority();
+        if (p < 0 || p >= LEVELS) {
+            DBGPRINT_2("Priority out of the bitmap range: ", p);
+            useGenericQueue();
+            Scheduler::queueInsert(m);
+            return;
+        }
+
+        int l = int(p);
+        if (_levels[l].insert(m).second) {
+            _inLevels++;
+            _bitmap[l / WORD_BITS] |= uint64_t(1) << (l % WORD_BITS);
+        }
+    }
+
+    void FPScheduler::queueErase(TaskModel *m)
+    {
+        if (!_useLevels) {
+            Scheduler::queueErase(m);
+            return;
+        }
+
+        Tick p = m->getKeyPriority();
+        if (p < 0 || p >= LEVELS) return;
+
+        int l = int(p);
+        size_t n = _levels[l].size();
+        _levels[l].erase(m);
+        if (_levels[l].size() == n) return;
+
+        _inLevels--;
+        if (_levels[l].empty())
+            _bitmap[l / WORD_BITS] &= ~(uint64_t(1) << (l % WORD_BITS));
+    }
+
+    void FPScheduler::queueRekey(TaskModel *m)
+    {
+        if (!_useLevels) {
+            Scheduler::queueRekey(m);
+            return;
+        }
+
+        // the level of the old key, then the level of the new one
+        queueErase(m);
+        m->updateKey();
+        queueInsert(m);
+    }
+
+    TaskModel *FPScheduler::queueAt(unsigned int n)
+    {
+        if (!_useLevels) return Scheduler::queueAt(n);
+        if (n >= _inLevels) return NULL;
+
+        for (int w = 0; w < LEVELS / WORD_BITS; ++w) {
+            uint64_t bits = _bitmap[w];
+            while (bits != 0) {
+                int l = w * WORD_BITS + first_set(bits);
+                if (n < _levels[l].size()) return _levels[l][n];
+                n -= _levels[l].size();
+                bits &= bits - 1;
+            }
+        }
+        return NULL;
+    }
+
+    size_t FPScheduler::queueSize() const
+    {
+        if (!_useLevels) return Scheduler::queueSize();
+        return _inLevels;
+    }
+
+    void FPScheduler::queueClear()
+    {
+        Scheduler::queueClear();
+        for (int w = 0; w < LEVELS / WORD_BITS; ++w) {
+            uint64_t bits = _bitmap[w];
+            while (bits != 0) {
+                _levels[w * WORD_BITS + first_set(bits)].clear();
+                bits &= bits - 1;
+            }
+            _bitmap[w] = 0;
+        }
+        _inLevels = 0;
+    }
+
+    void FPScheduler::useGenericQueue()
+    {
+        for (unsigned int i = 0; i < _inLevels; ++i)
+            Scheduler::queueInsert(queueAt(i));
+        for (int l = 0; l < LEVELS; ++l) _levels[l].clear();
+        for (int w = 0; w < LEVELS / WORD_BITS; ++w) _bitmap[w] = 0;
+        _inLevels = 0;
+        _useLevels = false;
+    }
+
     void FPScheduler::addTask(AbsRTTask *task, int prio) throw(RTSchedExc)
     {
         FPModel *model = new FPModel(task, prio); 	
 
-        if (find(task) != NULL) 
-            throw RTSchedExc("Element already present");
-	
-        _tasks[task] = model;
+        enqueueModel(model);
     }
 
     FPScheduler * FPScheduler::createInstance(vector<string> &par)
@@ -49,5 +165,26 @@ namespace RTSim {
 
         
     }
+
+    void FPScheduler::saveState(Checkpoint &c)
+    {
+        c.put(_useLevels);
+        Scheduler::saveState(c);
+    }
+
+    void FPScheduler::loadState(Checkpoint &c)
+    {
+        // the models go back in the queue that was in use
+        c.get(_useLevels);
+        Scheduler::loadState(c);
+    }
+
+    bool FPScheduler::getSignature(StateImage &s)
+    {
+        signQueue(s);
+        for (unsigned int i = 0; i < queueSize(); ++i)
+            s.put(int64_t(queueAt(i)->getPriority()));
+        return true;
+    }
         
 }
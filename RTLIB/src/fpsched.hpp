@@ -14,6 +14,8 @@
 #ifndef __FPSCHED_HPP__
 #define __FPSCHED_HPP__
 
+#include <stdint.h>
+
 #include <scheduler.hpp>
 
 #define _FP_SCHED_DBG	"fpsched"
@@ -32,10 +34,20 @@ namespace RTSim {
        This class redefines only the addTask function, because most of the
        work is done in the Scheduler class. The user must specify the
        priority of each task esplicitily.
+
+       The ready queue is a bitmap of the non-empty priority
+       levels, plus one queue per level (the Linux rt class way):
+       the highest priority level is found with a find-first-set,
+       and inserting or extracting a task does not depend on the
+       number of ready tasks at other levels. This works for the
+       priorities from 0 to LEVELS - 1; as soon as a task with a
+       priority out of this range is inserted, the scheduler moves
+       all the tasks to the generic queue of Scheduler, and keeps
+       using it.
     */
     class FPScheduler : public Scheduler
     {
-    protected:
+    public:
 
         class FPModel: public TaskModel
         {
@@ -52,10 +64,47 @@ namespace RTSim {
             void changePriority(Tick p) {
                 setPriority(p);
             }
+
+            void saveState(Checkpoint &c) {
+                TaskModel::saveState(c);
+                c.put(_prio);
+            }
+
+            void loadState(Checkpoint &c) {
+                TaskModel::loadState(c);
+                c.get(_prio);
+            }
         };
 
+    protected:
+
+        /// Number of priority levels of the bitmap queue
+        static const int LEVELS = 256;
+        static const int WORD_BITS = 64;
+        typedef sorted_vector<TaskModel *, TaskModel::TaskModelCmp> Level;
+
+        /// One queue per priority level
+        Level _levels[LEVELS];
+        /// bit i is set if _levels[i] is non empty
+        uint64_t _bitmap[LEVELS / WORD_BITS];
+        /// number of models in the levels
+        size_t _inLevels;
+        /// false once the generic queue is in use
+        bool _useLevels;
+
+        void queueInsert(TaskModel *m);
+        void queueErase(TaskModel *m);
+        void queueRekey(TaskModel *m);
+        TaskModel *queueAt(unsigned int n);
+        size_t queueSize() const;
+        void queueClear();
+
+        /// Moves all the models to the generic queue
+        void useGenericQueue();
 
     public:
+        FPScheduler();
+
         /**
            Empty definition of pure virtual function addTask.
 
@@ -75,7 +124,14 @@ namespace RTSim {
 
         void addTask(AbsRTTask *t, const std::string &p);
 
-        void removeTask(AbsRTTask *t) {}
+        void removeTask(AbsRTTask *t) { dropModel(t); }
+
+        /// Saves the queue in use and the models (see Scheduler::saveState())
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
+        /// Writes the ready queue and the priorities
+        virtual bool getSignature(StateImage &s);
                         
         static FPScheduler *createInstance(vector<string> &par);
 
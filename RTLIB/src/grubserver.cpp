@@ -11,7 +11,8 @@ namespace RTSim {
 	servers(),
 	total_u(0),
 	residual_capacity(0),
-	active_u(0) {}
+	active_u(0),
+	n_active(0) {}
 
     GrubSupervisor::~GrubSupervisor() {}
 
@@ -25,34 +26,51 @@ namespace RTSim {
 	return true;
     }
 
-    void GrubSupervisor::set_active(Grub *g) 
+    void GrubSupervisor::update_rates()
     {
-	for (auto sp = servers.begin();
-	        sp != servers.end();
+	for (auto sp = executing.begin();
+	        sp != executing.end();
 	            ++sp) 
-	    (*sp)->updateBudget();
+	    (*sp)->updateRates();
+    }
 
+    void GrubSupervisor::add_executing(Grub *g)
+    {
+	executing.push_back(g);
+    }
+
+    void GrubSupervisor::remove_executing(Grub *g)
+    {
+	for (auto sp = executing.begin(); sp != executing.end(); ++sp) 
+	    if (*sp == g) {
+		*sp = executing.back();
+		executing.pop_back();
+		return;
+	    }
+    }
+
+    void GrubSupervisor::set_active(Grub *g) 
+    {
 	active_u += g->getUtil();
+	n_active++;
+	update_rates();
+    }
 
-	for (auto sp = servers.begin();
-	        sp != servers.end();
-	            ++sp) 
-	    (*sp)->startAccounting();
+    void GrubSupervisor::set_active(const std::vector<Grub *> &v) 
+    {
+	if (v.empty()) return;
+	for (auto sp = v.begin(); sp != v.end(); ++sp) 
+	    active_u += (*sp)->getUtil();
+	n_active += v.size();
+	update_rates();
     }
 
     void GrubSupervisor::set_idle(Grub *g) 
     {
-	for (auto sp = servers.begin();
-	        sp != servers.end();
-	            ++sp) 
-	    (*sp)->updateBudget();
-
 	active_u -= g->getUtil();
-
-	for (auto sp = servers.begin();
-	        sp != servers.end();
-	            ++sp) 
-	    (*sp)->startAccounting();
+	// do not let the rounding errors accumulate
+	if (--n_active == 0) active_u = 0;
+	update_rates();
     }
 
     Tick GrubSupervisor::get_capacity()
@@ -65,6 +83,8 @@ namespace RTSim {
     void GrubSupervisor::newRun() 
     {
 	active_u = 0;
+	n_active = 0;
+	executing.clear();
 	residual_capacity=0;
 	//cout << "NEW RUN" << endl;
     }
@@ -119,9 +139,23 @@ namespace RTSim {
 		cout << "Supervisor utilization: " << supervisor->getActiveUtilization() << endl;
 		assert(0);
 	    }
-	    _bandExEvt.post(SIMUL.getTime() + cap.get_intercept(0));
+	    armBudget(SIMUL.getTime() + delta);
 	}
     }
+
+    void Grub::updateRates()
+    {
+	if (status == EXECUTING) {
+	    vtime.set_speed(supervisor->getActiveUtilization()/getUtil());
+	    cap.set_speed(-supervisor->getActiveUtilization());
+	    armBudget(getBudgetEnd());
+	}
+    }
+
+    Tick Grub::getBudgetEnd() const
+    {
+	return SIMUL.getTime() + cap.get_intercept(0);
+    }
     
     void Grub::onIdle(Event *evt)
     {
@@ -157,6 +191,7 @@ namespace RTSim {
     {
 	DBGENTER(_SERVER_DBG_LEV);
         status = EXECUTING;
+	supervisor->add_executing(this);
 	Tick extra = supervisor->get_capacity();
 	//cout << "Extra: " << extra << endl;
 	cap.set_value(cap.get_value() + double(extra));
@@ -167,6 +202,7 @@ namespace RTSim {
     {
 	DBGENTER(_SERVER_DBG_LEV);
 	updateBudget();
+	supervisor->remove_executing(this);
 	status = READY;
     }
     
@@ -174,6 +210,7 @@ namespace RTSim {
     {
 	DBGENTER(_SERVER_DBG_LEV);
 	updateBudget();
+	supervisor->remove_executing(this);
 	status = RELEASING;
 	if (SIMUL.getTime() < Tick(vtime.get_value())) 
 	    _idleEvt.post(Tick(vtime.get_value()));
@@ -195,6 +232,7 @@ namespace RTSim {
     {
 	DBGENTER(_SERVER_DBG_LEV);
 	updateBudget();
+	supervisor->remove_executing(this);
 	status = RECHARGING;
 	if (getDeadline() < SIMUL.getTime()) 
 	    _rechargingEvt.post(SIMUL.getTime()); 
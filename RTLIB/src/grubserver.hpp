@@ -31,17 +31,39 @@ namespace RTSim {
     };
 
     /** This supervisor stores the status of all registered servers, 
-	so to be able to compute U^act */
+	so to be able to compute U^act. 
+
+        U^act is updated incrementally when a server becomes active
+        or idle; only the servers that are currently executing
+        (whose budget depends on U^act) are re-accounted, by
+        changing the rates of their timers in place, so the cost
+        of a transition does not depend on the number of
+        registered servers. */
     class GrubSupervisor : public Entity {
         std::vector<Grub *> servers;
+        /// the servers in the EXECUTING state
+        std::vector<Grub *> executing;
         double total_u;
         Tick residual_capacity;
         double active_u;
+        /// number of active servers (to reset U^act when it is 0)
+        int n_active;
+
+        /// the new U^act in the rates of the executing servers
+        void update_rates();
+
+        friend class Grub;
+        void add_executing(Grub *g);
+        void remove_executing(Grub *g);
     public:
         GrubSupervisor(const std::string &name = "");
         ~GrubSupervisor();
         bool addGrub(Grub *g);
         void set_active(Grub *g);
+        /** Activates all the servers in v at once (for example,
+            the servers woken up at the same tick): the executing
+            servers are re-accounted only once. */
+        void set_active(const std::vector<Grub *> &v);
         void set_idle(Grub *g);
         void set_capacity(Tick cap) { residual_capacity = cap; }
         Tick get_capacity();
@@ -77,6 +99,14 @@ namespace RTSim {
 	void updateBudget();
 	void startAccounting();
 
+	/**
+	   Moves the rates of the budget and of the virtual time to
+	   the current U^act, without stopping the timers. A later
+	   budget exhaustion leaves the budget event where it is
+	   (see Server::armBudget()).
+	*/
+	void updateRates();
+
         Tick changeBudget(const Tick &new_budget);
 
 	double getVirtualTime() { return vtime.get_value(); }
@@ -87,6 +117,9 @@ namespace RTSim {
     protected:
 	void onIdle(Event *evt);
 
+	/// when the budget reaches 0 at the current rate
+	virtual Tick getBudgetEnd() const;
+
         /// from idle to active contending (new work to do)
         void idle_ready();
 
@@ -32,6 +32,7 @@
 #include <baseexc.hpp>
 #include <entity.hpp>
 #include <event.hpp>
+#include <memstats.hpp>
 #include <randomvar.hpp>
 
 //...from rtlib
@@ -59,6 +60,8 @@ namespace RTSim {
 
     };
 
+    DECL_MEM_CATEGORY(InstrMem, "instructions");
+
     /**
        \ingroup instr
  
@@ -70,16 +73,22 @@ namespace RTSim {
        A task contains a list of instructions, that are executed in
        sequence.
 
+       Instructions allocated with new are charged to the
+       "instructions" category of MemStats.
+
        @see Task.
 
        @todo Implement labels, and non-sequential constructs.
     */
-    class Instr: public Entity {
+    class Instr: public Entity, public MetaSim::MemTracked<InstrMem> {
     protected:
         Task* _father;
+        /// the last job of the task that reached the instruction
+        unsigned long _epoch;
     public:
         typedef string BASE_KEY_TYPE;
-        Instr(Task *f, const std::string &n = "") :Entity(n), _father(f) {}
+        Instr(Task *f, const std::string &n = "") :
+            Entity(n), _father(f), _epoch(0) {}
         virtual ~Instr() {}
 
         /** 
@@ -112,6 +121,22 @@ namespace RTSim {
         */ 
         virtual void reset() = 0;
 
+        /**
+           Called by the task before scheduling the instruction in
+           its job number e: the first time the job reaches the
+           instruction, the instruction is reset. This way, the
+           instructions that a job does not reach are not touched.
+        */
+        void enterJob(unsigned long e) {
+            if (_epoch != e) {
+                _epoch = e;
+                reset();
+            }
+        }
+
+        /// True if job number e has reached the instruction
+        bool inJob(unsigned long e) const { return _epoch == e; }
+
         /**
            Returns how long the instrucion has been executed from the last
            reset().
@@ -132,10 +157,27 @@ namespace RTSim {
 
         virtual void setTrace(Trace*) = 0;
 
+        /**
+           Number of instructions of the task code that end, in
+           the current job, when this one ends (see
+           ExecInstr::setNext()).
+        */
+        virtual unsigned int getSpan() const { return 1; }
+
         // virtual methods from entity
         virtual void newRun() = 0;
         virtual void endRun() = 0;  
 
+        /// Saves the reset block and the last job that reached the instruction
+        virtual void saveState(MetaSim::Checkpoint &c) {
+            Entity::saveState(c);
+            c.put(_epoch);
+        }
+        virtual void loadState(MetaSim::Checkpoint &c) {
+            Entity::loadState(c);
+            c.get(_epoch);
+        }
+
         /** 
             It refreshes the state of the executing instruction 
             when a change of the CPU speed occurs. 
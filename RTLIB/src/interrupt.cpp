@@ -44,6 +44,7 @@ namespace RTSim {
 	burst_lenght(burstlenght),
 	count(0),
 	max_act(0),
+	batch(false),
 	triggerEvt(this, &Interrupt::onTrigger)
     {
 	if (burst_lenght == NULL) burst_lenght = new DeltaVar(1);   
@@ -77,6 +78,17 @@ namespace RTSim {
 
   void Interrupt::onTrigger(Event *e)
   {
+    if (batch) {
+      int n = max_act > 0 ? max_act : 1;
+      burst.resize(n);
+      for (int i=0; i<n; ++i) burst[i] = SIMUL.getTime() + i * bp;
+      for (unsigned int i=0; i<tasks.size(); ++i) tasks[i]->activateBurst(burst);
+
+      triggerEvt.post(burst.back() + (int)(int_time->get()));
+      max_act = static_cast<int>(burst_lenght->get());
+      return;
+    }
+
     for (unsigned int i=0; i<tasks.size(); ++i) tasks[i]->activate();
     
     count ++;
@@ -68,6 +68,12 @@ namespace RTSim {
     /// max number of activations in this round 
     int max_act;
 
+    /// if true, a whole burst is delivered by one trigger
+    bool batch;
+
+    /// arrival times of the current burst (batch mode)
+    vector<Tick> burst;
+
   public:
 
     /// Trigger Event
@@ -89,6 +95,16 @@ namespace RTSim {
     /// add a task to the interrupt activation list
     void addTask(Task *t);
 
+    /**
+       Selects the batch mode: at the start of each burst, the
+       arrival times of the whole burst are computed and buffered
+       in each task (see Task::activateBurst()), and the trigger
+       event is posted only once per burst. The result is the same
+       as in the default mode if the tasks have no other source of
+       activations.
+     */
+    void setBatch(bool b) { batch = b; }
+
     /**
        Called by the trigger event. Activates the tasks and posts the
        trigger event again.
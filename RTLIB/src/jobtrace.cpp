@@ -0,0 +1,166 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <fstream>
+
+#include <jobtrace.hpp>
+#include <task.hpp>
+#include <taskevt.hpp>
+
+namespace RTSim {
+
+  namespace {
+    const char MAGIC[8] = { 'R', 'T', 'S', 'I', 'M', 'J', 'O', 'B' };
+    const uint32_t VERSION = 1;
+  }
+
+  JobTrace::JobTrace(const char *name, bool tof)
+    : Trace(name, Trace::BINARY, tof), _jobs(), _data(), _writer(), _last(0)
+  {
+    if (!toFile) return;
+    if (!_os.is_open()) throw JobTraceExc(string("Cannot open ") + name);
+
+    uint32_t h[2] = { VERSION, uint32_t(sizeof(JobRecord)) };
+    _os.write(MAGIC, sizeof(MAGIC));
+    _os.write(reinterpret_cast<const char *>(h), sizeof(h));
+    _writer.reset(new AsyncWriter(_os));
+  }
+
+  JobTrace::~JobTrace()
+  {
+    if (toFile) {
+      _writer.reset();
+      if (_os.is_open()) Trace::close();
+    }
+  }
+
+  void JobTrace::close()
+  {
+    if (!toFile) return;
+    if (_writer) _writer->flush();
+    Trace::close();
+  }
+
+  void JobTrace::clear()
+  {
+    _data.clear();
+    _jobs.clear();
+    _last = 0;
+  }
+
+  void JobTrace::attachToTask(Task *t)
+  {
+    t->arrEvt.addTrace(this);
+    t->fakeArrEvt.addTrace(this);
+    t->schedEvt.addTrace(this);
+    t->deschedEvt.addTrace(this);
+    t->endEvt.addTrace(this);
+    t->killEvt.addTrace(this);
+  }
+
+  void JobTrace::emit(Job &j)
+  {
+    j.open = false;
+    write(j.rec);
+  }
+
+  void JobTrace::write(const JobRecord &r)
+  {
+    if (toFile) _writer->write(&r, sizeof(JobRecord));
+    else _data.push_back(r);
+  }
+
+  void JobTrace::record(Event *e)
+  {
+    if (!TaskEvt::isTaskEvt(e)) return;
+    TaskEvt *ee = static_cast<TaskEvt *>(e);
+    Task *task = ee->getTask();
+    Tick now = e->getLastTime();
+
+    // a new run: the jobs of the previous one never ended
+    if (now < _last)
+      for (size_t i = 0; i < _jobs.size(); ++i) _jobs[i].open = false;
+    _last = now;
+
+    size_t id = task->getID();
+    if (id >= _jobs.size()) {
+      Job j = { JobRecord(), false };
+      _jobs.resize(2 * id + 1, j);
+    }
+    Job &j = _jobs[id];
+    JobRecord &r = j.rec;
+
+    switch (ee->getKind()) {
+    case TaskEvt::ARR_EVT:
+    case TaskEvt::FAKE_ARR_EVT: {
+      // a buffered arrival does not start a job
+      Tick arr = task->getArrival();
+      if (j.open && r.arrival == int64_t(arr)) break;
+      memset(&r, 0, sizeof(r));
+      r.task = int32_t(id);
+      r.arrival = int64_t(arr);
+      r.deadline = int32_t(int64_t(task->getDeadline()) - r.arrival);
+      r.start = -1;
+      j.open = true;
+      break;
+    }
+    case TaskEvt::SCHED_EVT: {
+      if (!j.open) break;
+      if (r.start < 0) r.start = int32_t(int64_t(now) - r.arrival);
+      int cpu = ee->getCPU();
+      if (cpu >= 0 && cpu < 64) r.cpus |= uint64_t(1) << cpu;
+      break;
+    }
+    case TaskEvt::DESCHED_EVT:
+      if (j.open) r.preemptions++;
+      break;
+    case TaskEvt::KILL_EVT:
+      if (!j.open) break;
+      r.flags |= JobRecord::KILLED;
+      // fall through
+    case TaskEvt::END_EVT:
+      if (!j.open) break;
+      r.finish = int32_t(int64_t(now) - r.arrival);
+      r.executed = int32_t(int64_t(task->getExecTime()));
+      emit(j);
+      break;
+    default:
+      break;
+    }
+  }
+
+  void JobTrace::read(const string &fname, vector<JobRecord> &out)
+  {
+    ifstream in(fname.c_str(), ios::binary);
+    if (!in) throw JobTraceExc("Cannot open " + fname);
+
+    char magic[sizeof(MAGIC)];
+    uint32_t h[2];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(h), sizeof(h));
+    if (!in || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        h[0] != VERSION || h[1] != sizeof(JobRecord))
+      throw JobTraceExc(fname + " is not a job trace");
+
+    in.seekg(0, ios::end);
+    size_t len = size_t(in.tellg()) - sizeof(MAGIC) - sizeof(h);
+    if (len % sizeof(JobRecord) != 0) throw JobTraceExc("Truncated file");
+    in.seekg(sizeof(MAGIC) + sizeof(h), ios::beg);
+
+    size_t n = out.size();
+    out.resize(n + len / sizeof(JobRecord));
+    if (len > 0) in.read(reinterpret_cast<char *>(&out[n]), len);
+  }
+
+} // namespace RTSim
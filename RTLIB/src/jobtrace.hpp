@@ -0,0 +1,122 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __JOBTRACE_HPP__
+#define __JOBTRACE_HPP__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <asyncwriter.hpp>
+#include <baseexc.hpp>
+#include <trace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  class Task;
+
+  /// Raised when a job trace cannot be written or read
+  DECL_EXC(JobTraceExc, "JobTrace");
+
+  /**
+     \ingroup util
+
+     The record of a job in a JobTrace. The times of the job,
+     except the arrival, are relative to the arrival.
+  */
+  struct JobRecord {
+    enum { KILLED = 1 };
+
+    int32_t task;
+    /// number of times the job has been descheduled
+    uint16_t preemptions;
+    uint16_t flags;
+    int64_t arrival;
+    int32_t deadline;
+    /// the first schedule, and the end (or the kill)
+    int32_t start;
+    int32_t finish;
+    int32_t executed;
+    /// the processors on which it executed (the first 64)
+    uint64_t cpus;
+
+    Tick getResponseTime() const { return Tick(finish); }
+    bool isLate() const { return finish > deadline; }
+  };
+
+  /**
+     \ingroup util
+
+     A trace with a single fixed-size record per job (see
+     JobRecord), written when the job ends or is killed,
+     instead of one record per event: it is the trace to use
+     when only the statistics of the jobs are needed, and it is
+     a few times smaller than a JavaTrace.
+
+     The records are written on the file through an
+     AsyncWriter, after a header (the magic string "RTSIMJOB",
+     the version and the size of a record, as 32-bit integers),
+     in the byte order of the machine; with tof false, they are
+     kept in memory (see getData()). The tasks are traced with
+     attachToTask().
+  */
+  class JobTrace : public virtual Trace {
+    struct Job {
+      JobRecord rec;
+      bool open;
+    };
+
+    /// the current job of each task, by ID
+    vector<Job> _jobs;
+    vector<JobRecord> _data;
+    std::unique_ptr<AsyncWriter> _writer;
+    Tick _last;
+
+    void emit(Job &j);
+
+  protected:
+    /**
+       Called with each completed job: by default, the record is
+       written on the file, or kept in memory.
+    */
+    virtual void write(const JobRecord &r);
+
+  public:
+    JobTrace(const char *name, bool tof = true);
+    virtual ~JobTrace();
+
+    /// Traces the jobs of t
+    void attachToTask(Task *t);
+
+    virtual void record(Event *e);
+
+    virtual void close();
+
+    /// The records, if not written on a file
+    const vector<JobRecord> &getData() const { return _data; }
+
+    /// Discards the records in memory, and the open jobs
+    void clear();
+
+    /// Appends to out the records of a file written by a JobTrace
+    static void read(const string &fname, vector<JobRecord> &out);
+  };
+
+} // namespace RTSim
+
+#endif
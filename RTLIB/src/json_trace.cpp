@@ -5,32 +5,95 @@ namespace RTSim {
 
     using namespace std;
     using namespace MetaSim;
-    
 
-    JSONTrace::JSONTrace(const string& name)
+    namespace {
+        const size_t BUF_SIZE = 1 << 16;
+
+        const char DIGITS[] = 
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+    }
+
+    void jsonAppendInt(string &s, int64_t x)
+    {
+        // two digits at a time
+        char tmp[24];
+        char *p = tmp + sizeof(tmp);
+        uint64_t u = x < 0 ? 0 - uint64_t(x) : uint64_t(x);
+        while (u >= 100) {
+            unsigned d = unsigned(u % 100) * 2;
+            u /= 100;
+            *--p = DIGITS[d + 1];
+            *--p = DIGITS[d];
+        }
+        if (u >= 10) {
+            *--p = DIGITS[u * 2 + 1];
+            *--p = DIGITS[u * 2];
+        }
+        else *--p = char('0' + u);
+        if (x < 0) *--p = '-';
+        s.append(p, tmp + sizeof(tmp) - p);
+    }
+
+    void jsonAppendString(string &s, const string &x)
+    {
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (x[i] == '"' || x[i] == '\\') s += '\\';
+            s += x[i];
+        }
+    }
+
+    JSONTrace::JSONTrace(const string& name, Format f) :
+        fd(), first_event(true), _format(f), _buf()
     {
         fd.open(name.c_str());
-        fd << "{" << endl;
-        fd << "    \"events\" : \[" << endl; 
-        first_event = true;
+        _buf.reserve(BUF_SIZE + 256);
+        if (_format == ARRAY) _buf += "{\n    \"events\" : [\n";
     }
 
     JSONTrace::~JSONTrace() {
-        fd << "] }" << endl;
+        if (_format == ARRAY) _buf += "] }\n";
+        flush(true);
         fd.close();
     }
 
+    void JSONTrace::flush(bool force)
+    {
+        if (_buf.size() < BUF_SIZE && !force) return;
+        fd.write(_buf.data(), _buf.size());
+        _buf.clear();
+    }
+
     void JSONTrace::writeTaskEvent(const Task &tt, const std::string &evt_name)
     {
-        if (!first_event) 
-            fd << "," << endl;
-        else
-            first_event = false;
-        fd << "{ " ;
-        fd << "\"time\" : \"" << SIMUL.getTime() << "\", ";  
-        fd << "\"event_type\" : \"" << evt_name << "\", ";
-        fd << "\"task_name\" : \"" <<  tt.getName() << "\",";
-        fd << "\"arrival_time\" : \"" << tt.getArrival() << "\"}";
+        if (_format == NDJSON) {
+            _buf += "{\"time\":";
+            jsonAppendInt(_buf, long(SIMUL.getTime()));
+            _buf += ",\"event_type\":\"";
+            _buf += evt_name;
+            _buf += "\",\"task_id\":";
+            jsonAppendInt(_buf, tt.getID());
+            _buf += ",\"arrival_time\":";
+            jsonAppendInt(_buf, long(tt.getArrival()));
+            _buf += "}\n";
+        }
+        else {
+            if (!first_event) _buf += ",\n";
+            else first_event = false;
+            _buf += "{ \"time\" : \"";
+            jsonAppendInt(_buf, long(SIMUL.getTime()));
+            _buf += "\", \"event_type\" : \"";
+            _buf += evt_name;
+            _buf += "\", \"task_name\" : \"";
+            _buf += tt.getName();
+            _buf += "\",\"arrival_time\" : \"";
+            jsonAppendInt(_buf, long(tt.getArrival()));
+            _buf += "\"}";
+        }
+        flush();
     }
 
     void JSONTrace::probe(ArrEvt& e)
@@ -65,6 +128,14 @@ namespace RTSim {
     
     void JSONTrace::attachToTask(Task* t)
     {
+        if (_format == NDJSON) {
+            _buf += "{\"task_id\":";
+            jsonAppendInt(_buf, t->getID());
+            _buf += ",\"task_name\":\"";
+            jsonAppendString(_buf, t->getName());
+            _buf += "\"}\n";
+            flush();
+        }
         new Particle<ArrEvt, JSONTrace>(&t->arrEvt, this);
         new Particle<EndEvt, JSONTrace>(&t->endEvt, this);
         new Particle<SchedEvt, JSONTrace>(&t->schedEvt, this);
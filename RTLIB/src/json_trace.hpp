@@ -16,6 +16,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <stdint.h>
 #include <string>
 
 #include <baseexc.hpp>
@@ -28,14 +29,55 @@
 #include <taskevt.hpp>
 
 namespace RTSim {
+
+    /// Appends x to s, in decimal
+    void jsonAppendInt(std::string &s, int64_t x);
+
+    /// Appends x to s, escaping quotes and backslashes
+    void jsonAppendString(std::string &s, const std::string &x);
+
+    /**
+       Writes the events of the tasks attached to it in a JSON
+       file. In the ARRAY format (the default) the file is a single
+       object with an array of events, whose fields are strings:
+
+       <pre>
+       { "events" : [
+       { "time" : "0", "event_type" : "arrival", "task_name" : "T1",
+         "arrival_time" : "0"}, ... ] }
+       </pre>
+
+       In the NDJSON format each line is a JSON object, so that the
+       file can be read while it is written, and one line at a
+       time. The numeric fields are numbers, and tasks are referred
+       by their ID: the names are written once, in a line for each
+       task, when the task is attached.
+
+       <pre>
+       {"task_id":3,"task_name":"T1"}
+       {"time":0,"event_type":"arrival","task_id":3,"arrival_time":0}
+       </pre>
+
+       The output is formatted in a buffer, and written to the file
+       when the buffer is full.
+    */
     class JSONTrace {
+    public:
+        typedef enum { ARRAY, NDJSON } Format;
+
     protected:
         std::ofstream fd;
         bool first_event;
+        Format _format;
+        std::string _buf;
 
         void writeTaskEvent(const Task &tt, const std::string &evt_name);
+
+        /// writes the buffer, if full (or always, if force is true)
+        void flush(bool force = false);
+
     public:
-        JSONTrace(const std::string& name);
+        JSONTrace(const std::string& name, Format f = ARRAY);
         
         ~JSONTrace();
         
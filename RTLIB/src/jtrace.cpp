@@ -12,6 +12,7 @@
  *                                                                         *
  ***************************************************************************/
 #include <algorithm>
+#include <cstring>
 #include <string>
 
 #include <simul.hpp>
@@ -19,7 +20,7 @@
 #include <server.hpp>
 #include <jtrace.hpp>
 #include <task.hpp>
-#include <task.hpp>
+#include <tracemap.hpp>
 #include <waitinstr.hpp>
 
 namespace RTSim {
@@ -32,11 +33,22 @@ namespace RTSim {
   string JavaTrace::version = "1.2";
 
   JavaTrace::JavaTrace(const char *name, bool tof, unsigned long int limit)
-    :Trace(name, Trace::BINARY, tof), taskList(10)
+    :Trace(name, Trace::BINARY, tof), _named()
   {
     if (endianess == TRACE_UNKNOWN_ENDIAN) probeEndianess();
     const char cver[] = "version 1.2";
-    if (toFile) _os.write(cver, sizeof(cver));
+    if (toFile) {
+      _os.write(cver, sizeof(cver));
+      _writer.reset(new AsyncWriter(_os));
+    }
+    filenum = 0;
+    fileLimit = limit;
+  }
+
+  JavaTrace::JavaTrace(const char *name, unsigned long int limit)
+    :Trace(name, Trace::BINARY, true), _named()
+  {
+    if (endianess == TRACE_UNKNOWN_ENDIAN) probeEndianess();
     filenum = 0;
     fileLimit = limit;
   }
@@ -45,7 +57,10 @@ namespace RTSim {
   {
     // WARNING: the data vector is cleared but its content isn't. It
     // must be deleted manually (close).
-    if (toFile) Trace::close();
+    if (toFile) {
+      _writer.reset();
+      if (_os.is_open()) Trace::close();
+    }
     else data.clear();
   }
 
@@ -67,118 +82,165 @@ namespace RTSim {
 
   void JavaTrace::close()
   {
-    if (toFile) Trace::close();
+    if (toFile) {
+      if (_writer) _writer->flush();
+      Trace::close();
+    }
     else {
       for (unsigned int i = 0; i < data.size(); i++) delete data[i];
       data.clear();
     }
   }
 
+  namespace {
+    inline void putInt(char *&p, int x)
+    {
+      TraceEvent::encode((char *)& x, sizeof(x));
+      memcpy(p, &x, sizeof(x));
+      p += sizeof(x);
+    }
+  }
+
+  void JavaTrace::writeRecord(int type, int time, int task, int n, int a,
+                              int b, const string *str)
+  {
+    // the size does not include the size field itself
+    int size = (3 + n) * sizeof(int);
+    if (str) size += sizeof(int) + str->size();
+    _rec.resize(size + sizeof(int));
+
+    char *p = &_rec[0];
+    putInt(p, size);
+    putInt(p, type);
+    putInt(p, time);
+    putInt(p, task);
+    if (n > 0) putInt(p, a);
+    if (n > 1) putInt(p, b);
+    if (str) {
+      putInt(p, str->size());
+      memcpy(p, str->data(), str->size());
+    }
+    emit(&_rec[0], _rec.size(), time, task);
+  }
+
+  void JavaTrace::emit(const char *rec, size_t n, int time, int task)
+  {
+    _writer->write(rec, n);
+  }
+
+  void JavaTrace::append(const TraceRecord &r)
+  {
+    if (toFile) emit(r.data(), r.size(), r.getTime(), r.getTask());
+  }
+
   void JavaTrace::record(Event* e)
   {
     DBGENTER(_JTRACE_DBG_LEV);
-    TaskEvt* ee = dynamic_cast<TaskEvt*>(e);
-
-    if (ee == NULL) {
+    if (!TaskEvt::isTaskEvt(e)) {
       DBGPRINT("The event is not a TaskEvt");
       
       return;
     }
+    TaskEvt* ee = static_cast<TaskEvt*>(e);
 
     Task* task = ee->getTask();
     if (task != NULL) {
-      vector<int>::const_iterator p = find(taskList.begin(), taskList.end(),
-					   task->getID());
-      if (p == taskList.end()) {
-	TraceNameEvent* a = new TraceNameEvent(ee->getLastTime(),
-					       task->getID(), task->getName());
-	if (toFile) a->write(_os);
-	else data.push_back(a);
-	taskList.push_back(task->getID());
+      size_t id = task->getID();
+      if (id >= _named.size()) _named.resize(2 * id + 1, false);
+      if (!_named[id]) {
+	if (toFile)
+	  writeRecord(TraceEvent::TASK_NAME, ee->getLastTime(), task->getID(),
+		      0, 0, 0, &task->getName());
+	else data.push_back(new TraceNameEvent(ee->getLastTime(),
+					       task->getID(), task->getName()));
+	_named[id] = true;
       }
     }
  
     // at this point we have to see what kind of event it is...
 
-    if (dynamic_cast<ArrEvt*>(e) != NULL) {
+    switch (ee->getKind()) {
+    case TaskEvt::ARR_EVT: {
       DBGPRINT("ArrEvt");
-      ArrEvt* tae = dynamic_cast<ArrEvt*>(e);
-      TraceArrEvent* a = new TraceArrEvent(e->getLastTime(), task->getID());
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-      Task* rttask = dynamic_cast<Task*>(task);
-      if (rttask) {
-	TraceDlineSetEvent* b = new TraceDlineSetEvent(tae->getLastTime(),
-						       rttask->getID(),
-						       rttask->getDeadline());
-	if (toFile) b->write(_os);
-	else data.push_back(b);
+      if (toFile) 
+	writeRecord(TraceEvent::TASK_ARRIVAL, e->getLastTime(), task->getID(), 0);
+      else data.push_back(new TraceArrEvent(e->getLastTime(), task->getID()));
+      if (task) {
+	if (toFile) 
+	  writeRecord(TraceEvent::TASK_DLINESET, ee->getLastTime(), 
+		      task->getID(), 1, task->getDeadline());
+	else data.push_back(new TraceDlineSetEvent(ee->getLastTime(),
+						   task->getID(),
+						   task->getDeadline()));
       }
-    } else if (dynamic_cast<EndEvt*>(e) != NULL) {
+      break;
+    }
+    case TaskEvt::END_EVT: {
       DBGPRINT("EndEvt");
-      EndEvt* tee = dynamic_cast<EndEvt*>(e);
-
-      TraceEndEvent* a = new TraceEndEvent(tee->getLastTime(), task->getID(),
-					   tee->getCPU());
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-    } else if (dynamic_cast<DeschedEvt*>(e) != NULL) {
+      if (toFile)
+	writeRecord(TraceEvent::TASK_END, ee->getLastTime(), task->getID(),
+		    1, ee->getCPU());
+      else data.push_back(new TraceEndEvent(ee->getLastTime(), task->getID(),
+					    ee->getCPU()));
+      break;
+    }
+    case TaskEvt::DESCHED_EVT: {
       DBGPRINT("DeschedEvt");
-      DeschedEvt *tde = dynamic_cast<DeschedEvt *>(e);
-
-      TraceDeschedEvent* a = new TraceDeschedEvent(tde->getLastTime(),
-						   task->getID(),
-						   tde->getCPU());
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-    } else if (dynamic_cast<WaitEvt*>(e) != NULL) {
+      if (toFile)
+	writeRecord(TraceEvent::TASK_DESCHEDULE, ee->getLastTime(), 
+		    task->getID(), 1, ee->getCPU());
+      else data.push_back(new TraceDeschedEvent(ee->getLastTime(),
+						task->getID(),
+						ee->getCPU()));
+      break;
+    }
+    case TaskEvt::WAIT_EVT: {
       DBGPRINT("WaitEvt");
-      WaitEvt* we = dynamic_cast<WaitEvt*>(e);
-      //WaitInstr* instr = dynamic_cast<WaitInstr*>(we->getInstr());
+      WaitEvt* we = static_cast<WaitEvt*>(ee);
       WaitInstr* instr = we->getInstr();
       string res = instr->getResource();
-      TraceWaitEvent* a = new TraceWaitEvent(we->getLastTime(),
-					     task->getID(), res);
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-    } else if (dynamic_cast<SignalEvt*>(e) != NULL) {
+      // the resource ID is always 1, as in TraceWaitEvent::write()
+      if (toFile)
+	writeRecord(TraceEvent::TASK_WAIT, we->getLastTime(), task->getID(),
+		    1, 1, 0, &res);
+      else data.push_back(new TraceWaitEvent(we->getLastTime(),
+					     task->getID(), res));
+      break;
+    }
+    case TaskEvt::SIGNAL_EVT: {
       DBGPRINT("SignalEvt");
-      SignalEvt* se = dynamic_cast<SignalEvt*>(e);
-      //SignalInstr* instr = dynamic_cast<SignalInstr*>(se->getInstr());
+      SignalEvt* se = static_cast<SignalEvt*>(ee);
       SignalInstr* instr = se->getInstr();
       string res = instr->getResource();
-      TraceSignalEvent* a = new TraceSignalEvent(se->getLastTime(),
-						 task->getID(), res);
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-    } else if (dynamic_cast<SchedEvt*>(e) != NULL) {
+      if (toFile)
+	writeRecord(TraceEvent::TASK_SIGNAL, se->getLastTime(), task->getID(),
+		    1, 1, 0, &res);
+      else data.push_back(new TraceSignalEvent(se->getLastTime(),
+					       task->getID(), res));
+      break;
+    }
+    case TaskEvt::SCHED_EVT: {
       DBGPRINT("SchedEvt");
-      SchedEvt* tse = dynamic_cast<SchedEvt*>(e);
-
-      TraceSchedEvent* a = new TraceSchedEvent(tse->getLastTime(),
-					       task->getID(), tse->getCPU());
-      if (toFile) a->write(_os);
-      else data.push_back(a);
-//     } else if (dynamic_cast<DlinePostEvt*>(e) != NULL) {
-//       DBGPRINT("DlinePostEvt");
-//       DlinePostEvt* dpe = dynamic_cast<DlinePostEvt*>(e);
-//       TraceDlinePostEvent* a = new TraceDlinePostEvent(dpe->getLastTime(),
-// 						       task->getID(),
-// 						       dpe->getPrevDline(),
-// 						       dpe->getPostDline());
-//       if (toFile) a->write(_os);
-//       else data.push_back(a);
-    } else if (dynamic_cast<DeadEvt*>(e) != NULL) {
+      if (toFile)
+	writeRecord(TraceEvent::TASK_SCHEDULE, ee->getLastTime(), 
+		    task->getID(), 1, ee->getCPU());
+      else data.push_back(new TraceSchedEvent(ee->getLastTime(),
+					      task->getID(), ee->getCPU()));
+      break;
+    }
+    case TaskEvt::DEAD_EVT: {
       DBGPRINT("DlineMissEvt");
-      DeadEvt* de = dynamic_cast<DeadEvt*>(e);
-      TraceDlineMissEvent* a = new TraceDlineMissEvent(de->getLastTime(),
-						       task->getID());
-      if (toFile) a->write(_os);
-      else data.push_back(a);
+      if (toFile)
+	writeRecord(TraceEvent::TASK_DLINEMISS, ee->getLastTime(), 
+		    task->getID(), 0);
+      else data.push_back(new TraceDlineMissEvent(ee->getLastTime(),
+						  task->getID()));
+      break;
+    }
+    default:
+      break;
     }
 
-    if (toFile) _os.flush();
-    
   }         
 
 }
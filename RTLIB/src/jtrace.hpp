@@ -16,8 +16,10 @@
  
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
  
+#include <asyncwriter.hpp>
 #include <baseexc.hpp>
 #include <basetype.hpp>
 #include <event.hpp>
@@ -29,6 +31,8 @@
 
 namespace RTSim {
 
+  class TraceRecord;
+
   using namespace std;
   using namespace MetaSim;
 
@@ -39,7 +43,12 @@ namespace RTSim {
      This is really a basic one, more complicated traces may be generated
      if it is necessary; the trace file is coded so that it can be directly
      fed into a Java interface, with no problems deriving from the
-     Big/Little endian issue
+     Big/Little endian issue.
+
+     When tracing to a file, the events are encoded directly (in
+     the same format of TraceEvent::write()) in the buffers of an
+     AsyncWriter, which writes them on the file from a
+     background thread: no object is allocated for each event.
    */
   class JavaTrace: public virtual Trace {
   public:
@@ -61,7 +70,35 @@ namespace RTSim {
     // The number of the traced events
     unsigned long int counter, fileLimit;
 
-    vector<int> taskList;
+    /// the tasks whose name has already been traced, by ID
+    vector<bool> _named;
+
+    std::unique_ptr<AsyncWriter> _writer;
+
+    /// the record being encoded
+    vector<char> _rec;
+
+    /**
+       Encodes a record with n (0, 1 or 2) integer fields a and b,
+       followed by string str (if not NULL), and passes it to
+       emit().
+    */
+    void writeRecord(int type, int time, int task, int n, int a = 0,
+                     int b = 0, const string *str = NULL);
+
+    /**
+       Outputs an encoded record of n bytes, about an event of
+       task at the given time. By default, it is appended to the
+       file. Derived classes that store the records in another
+       format override it.
+    */
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+    /**
+       For the derived classes that override emit(): opens the
+       file, but does not write the header.
+    */
+    JavaTrace(const char *name, unsigned long int limit);
 
   public:
     JavaTrace(const char *name, bool tof = true,
@@ -70,6 +107,12 @@ namespace RTSim {
 
     virtual void close();
 
+    /**
+       Appends a record read from another trace, or decoded by a
+       TraceBus (only when tracing to a file)
+    */
+    void append(const TraceRecord &r);
+
     vector<TraceEvent*> getData() {return data;}
 
     // The Little/Big Endian coding functions!
@@ -14,11 +14,13 @@
 #include <algorithm>
 
 #include <simul.hpp>
+#include <tracepoint.hpp>
 
 #include <cpu.hpp>
 #include <kernel.hpp>
 #include <resmanager.hpp>
 #include <scheduler.hpp>
+#include <server.hpp>
 #include <task.hpp>
 #include <reginstr.hpp>
 
@@ -81,9 +83,63 @@ namespace RTSim {
     { 
         t.setKernel(this);
         _handled.push_back(&t); 
+        _params.push_back(params);
         _sched->addTask(&t, params);
     }
 
+    Scheduler *RTKernel::replaceScheduler(Scheduler *s, const vector<string> &params)
+    {
+        if (!params.empty() && params.size() != _handled.size())
+            throw RTKernelExc("There must be one parameter per task");
+        // between two runs, the event queue is empty
+        if (Event::getFirst() != NULL)
+            throw RTKernelExc("Replacing the scheduler during a run");
+
+        // the old scheduler drops the tasks first, so that the new
+        // one can take their handle (see Scheduler::find()); the
+        // jobs left at the end of the last run leave its queue
+        for (size_t i = 0; i < _handled.size(); ++i) {
+            if (_handled[i]->isActive()) _sched->extract(_handled[i]);
+            _sched->removeTask(_handled[i]);
+        }
+        s->reserveTasks(_handled.size());
+        size_t n = 0;
+        try {
+            for (; n < _handled.size(); ++n) 
+                s->addTask(_handled[n], params.empty() ? _params[n] : params[n]);
+        } catch (...) {
+            while (n > 0) s->removeTask(_handled[--n]);
+            for (size_t i = 0; i < _handled.size(); ++i) 
+                _sched->addTask(_handled[i], _params[i]);
+            throw;
+        }
+
+        Scheduler *old = _sched;
+        _sched = s;
+        s->setKernel(this);
+        if (!params.empty()) _params.assign(params.begin(), params.end());
+        _currExe = NULL;
+        return old;
+    }
+
+    void RTKernel::reserveTasks(size_t n)
+    {
+        _sched->reserveTasks(n);
+    }
+
+    void RTKernel::removeTask(AbsRTTask &t)
+    {
+        deque<AbsRTTask *>::iterator i = find(_handled.begin(), _handled.end(), &t);
+        if (i == _handled.end()) 
+            throw RTKernelExc("The task does not belong to the kernel");
+        if (t.isActive()) throw RTKernelExc("Removing an active task");
+
+        _sched->removeTask(&t);
+        _params.erase(_params.begin() + (i - _handled.begin()));
+        _handled.erase(i);
+        t.setKernel(NULL);
+    }
+
     CPU* RTKernel::getProcessor(const AbsRTTask* t) const
     {
         return _cpu;
@@ -122,6 +178,7 @@ namespace RTSim {
     {
         _sched->discardTasks(f);
         _handled.clear();
+        _params.clear();
     }
 
     void RTKernel::onArrival(AbsRTTask *task)
@@ -129,6 +186,7 @@ namespace RTSim {
         DBGENTER(_KERNEL_DBG_LEV);
 	 DBGPRINT_2("Inserting ",
                    taskname(task));
+        DBG_POINT(_KERNEL_DBG_LEV, "arrival", task->getTaskNumber());
 	
 	_sched->insert(task);
 
@@ -147,6 +205,7 @@ namespace RTSim {
         if (getProcessor(task) == NULL) {
             throw RTKernelExc("Received a onEnd of a non executing task");
         }
+        DBG_POINT(_KERNEL_DBG_LEV, "end", task->getTaskNumber());
         _sched->extract(task);
         _currExe = NULL;
         
@@ -174,13 +233,24 @@ namespace RTSim {
                        taskname(newExe));
 
         if(_currExe != newExe){
+                AbsRTTask *oldExe = _currExe;
                 if (_currExe != NULL){ 
 			_currExe->deschedule();
 		}
 		if( newExe != NULL) { 
+                        DBG_POINT(_KERNEL_DBG_LEV, "context switch", 
+                                  newExe->getTaskNumber());
 			_isContextSwitching = true;
                 	_currExe = newExe;
-                	endDispatchEvt.post(SIMUL.getTime() + _contextSwitchDelay);
+                        // without a delay, nothing can happen in the
+                        // middle of the switch: end it now, unless
+                        // someone is probing the event, or the old
+                        // task is still being descheduled
+                        if (_contextSwitchDelay == 0 && !endDispatchEvt.hasProbes() &&
+                            (oldExe == NULL || deschedulesAtOnce(oldExe)))
+                            onEndDispatch(&endDispatchEvt);
+                        else
+                            endDispatchEvt.post(SIMUL.getTime() + _contextSwitchDelay);
 		}
         }
         else {
@@ -192,11 +262,17 @@ namespace RTSim {
     }
 
 
+    bool RTKernel::deschedulesAtOnce(AbsRTTask *t)
+    {
+        return dynamic_cast<Server *>(t) == NULL;
+    }
+
     void RTKernel::onEndDispatch(Event* e)
     {
         DBGENTER(_KERNEL_DBG_LEV);
 
 	_currExe->schedule();
+        DBG_POINT(_KERNEL_DBG_LEV, "running", _currExe->getTaskNumber());
 
         DBGPRINT_2("Now Running: ",
                    taskname(_currExe));
@@ -220,6 +296,24 @@ namespace RTSim {
 
     bool RTKernel::requestResource(AbsRTTask *t, const string &r, int n) 
         throw(RTKernelExc)
+    {
+        return requestResource(t, getResource(r), n);
+    } 
+
+    void RTKernel::releaseResource(AbsRTTask *t, const string &r, int n) 
+        throw(RTKernelExc)
+    { 
+        releaseResource(t, getResource(r), n);
+    }
+
+    Resource *RTKernel::getResource(const string &r) throw(RTKernelExc)
+    {
+        if (_resMng == 0) throw RTKernelExc("Resource Manager not set!");
+        return _resMng->getResource(r);
+    }
+
+    bool RTKernel::requestResource(AbsRTTask *t, Resource *r, int n) 
+        throw(RTKernelExc)
     {
         DBGENTER(_KERNEL_DBG_LEV);
 
@@ -230,7 +324,7 @@ namespace RTSim {
         return ret;
     } 
 
-    void RTKernel::releaseResource(AbsRTTask *t, const string &r, int n) 
+    void RTKernel::releaseResource(AbsRTTask *t, Resource *r, int n) 
         throw(RTKernelExc)
     { 
         if (_resMng == 0) throw RTKernelExc("Resource Manager not set!");
@@ -276,6 +370,25 @@ namespace RTSim {
         _currExe = NULL;
     }
 
+    void RTKernel::saveState(Checkpoint &c)
+    {
+        c.put(_currExe);
+        c.put(_isContextSwitching);
+    }
+
+    void RTKernel::loadState(Checkpoint &c)
+    {
+        c.get(_currExe);
+        c.get(_isContextSwitching);
+    }
+
+    bool RTKernel::getSignature(StateImage &s)
+    {
+        s.putRef(_currExe);
+        s.put(_isContextSwitching);
+        return true;
+    }
+
     void RTKernel::print() const
     {
     }
@@ -283,11 +396,14 @@ namespace RTSim {
     std::vector<std::string>  RTKernel::getRunningTasks()
     {
         std::vector<std::string> tmp_ts;
-        std::string tmp_name = taskname(_currExe);
-
-        if (tmp_name != "(nil)")
-            tmp_ts.push_back(tmp_name);
-
+        const std::string &n = taskname(_currExe);
+        if (n != "(nil)") tmp_ts.push_back(n);
         return tmp_ts;
     }
+
+    void RTKernel::getRunningTasks(std::vector<AbsRTTask *> &out) const
+    {
+        out.clear();
+        if (_currExe != NULL) out.push_back(_currExe);
+    }
 }
@@ -33,6 +33,7 @@ namespace RTSim {
 
     class Scheduler;
     class ResManager;
+    class Resource;
 
     /**
        \ingroup kernels
@@ -94,6 +95,9 @@ namespace RTSim {
         /// List of the tasks.
         deque<AbsRTTask *> _handled;
 
+        /// The scheduling parameters of the tasks, as in _handled
+        deque<string> _params;
+
 	bool _isContextSwitching;
     
 	Tick  _contextSwitchDelay;
@@ -106,6 +110,16 @@ namespace RTSim {
         */
         bool internalCpu;
 
+        /**
+           True if the deschedule() of t has been handled when
+           it returns, except for the events it has posted now. A
+           server deschedules its task with one more event: the
+           end of a zero-delay dispatch must then still be an
+           event, so that the task is descheduled before the new
+           one is scheduled.
+        */
+        static bool deschedulesAtOnce(AbsRTTask *t);
+
 	friend class DispatchEvt;
 	friend class BeginDispatchEvt;
 	friend class EndDispatchEvt;
@@ -220,6 +234,23 @@ namespace RTSim {
         */
         virtual void releaseResource(AbsRTTask *t, const string &r, int n=1)
             throw(RTKernelExc);
+
+        /**
+           Returns the resource called r, as known by the
+           resource manager: the handle can be passed to the
+           following functions, which do not look up the name.
+           If the resource manager has not been set, a
+           RTKernelExc is raised.
+        */
+        Resource *getResource(const string &r) throw(RTKernelExc);
+
+        /// As requestResource(t, name, n), with a handle
+        virtual bool requestResource(AbsRTTask *t, Resource *r, int n=1)
+            throw(RTKernelExc);
+
+        /// As releaseResource(t, name, n), with a handle
+        virtual void releaseResource(AbsRTTask *t, Resource *r, int n=1)
+            throw(RTKernelExc);
     
 
         /**
@@ -252,6 +283,40 @@ namespace RTSim {
         */
         virtual void addTask(AbsRTTask &t, const string &param ="");
 
+        /**
+           Removes task t from the kernel, so that it can be
+           added to another kernel. The task must not be
+           active.
+
+           @throws RTKernelExc if the task is active or does not
+           belong to this kernel
+        */
+        virtual void removeTask(AbsRTTask &t);
+
+        /**
+           Replaces the scheduler between two runs, keeping the
+           tasks, their instructions and their statistics: each
+           task is removed from the old scheduler and added to s,
+           in the order in which it was added to the kernel, with
+           params[i] (with the parameters it was added with if
+           params is empty). The old scheduler is returned, and it
+           is not deleted.
+
+           @throws RTKernelExc during a run (if there are events
+           in the queue), or if params does not have one element
+           per task; if s does not accept a task, the old
+           scheduler is kept
+        */
+        Scheduler *replaceScheduler(Scheduler *s,
+                                    const vector<string> &params = vector<string>());
+
+        /**
+           Makes room for n more tasks, in the kernel and in its
+           scheduler, before adding a large task set (see
+           LightTaskSet).
+        */
+        virtual void reserveTasks(size_t n);
+
         /**
            Returns a pointer to the CPU on which t is runnig
            (NULL if t is not running on any CPU). In this
@@ -308,6 +373,13 @@ namespace RTSim {
            _currExe pointer to NULL.
         */   
         virtual void endRun();
+
+        /// Saves the executing task (see Entity::saveState())
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
+        /// Writes the executing task (see Entity::getSignature())
+        virtual bool getSignature(StateImage &s);
     
         /**
            Prints the status of the objects on the DEBUG
@@ -347,6 +419,12 @@ namespace RTSim {
             _contextSwitchDelay = t; 
         }
 
+        /// The overhead of the context switching
+        Tick getContextSwitchDelay() const { return _contextSwitchDelay; }
+
+        /// The scheduler of the kernel
+        Scheduler *getScheduler() const { return _sched; }
+
         /**
          It returns the name of the task (std::string) stored in a
          std::vector<std::string>.
@@ -355,6 +433,13 @@ namespace RTSim {
          running at the same time.
          */
         virtual std::vector<std::string> getRunningTasks();
+
+        /**
+           Stores in out the running task, if any, without
+           allocating once out has grown: a monitor can call it at
+           every job with the same vector.
+         */
+        virtual void getRunningTasks(std::vector<AbsRTTask *> &out) const;
     };
   
 } // namespace RTSim 
@@ -0,0 +1,364 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <exception>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#include <simul.hpp>
+
+#include <abskernel.hpp>
+#include <cpu.hpp>
+#include <kernel.hpp>
+#include <lighttask.hpp>
+#include <simcontext.hpp>
+#include <taskevt.hpp>
+#include <topology.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    void LightTaskEvt::doit()
+    {
+        _task->onEvent();
+    }
+
+    LightTask::LightTask(Tick period, Tick wcet, Tick rdl, Tick phase,
+                         const std::string &name) :
+        Entity(name), _period(period), _rdl(rdl == 0 ? period : rdl),
+        _phase(phase), _wcet(wcet), _cost(),
+        _kernel(NULL), _state(IDLE),
+        _arrival(0), _lastArrival(0), _nextArrival(0), _dl(0),
+        _jobCost(0), _done(0), _execd(0), _lastSched(0), _endTime(0),
+        _speed(CPU::SPEED_ONE), _pending(0), _missCount(0),
+        taskEvt(this)
+    {
+    }
+
+    LightTask::LightTask(Tick period, RandomVar *c, Tick rdl, Tick phase,
+                         const std::string &name) :
+        Entity(name), _period(period), _rdl(rdl == 0 ? period : rdl),
+        _phase(phase), _wcet(0), _cost(c),
+        _kernel(NULL), _state(IDLE),
+        _arrival(0), _lastArrival(0), _nextArrival(0), _dl(0),
+        _jobCost(0), _done(0), _execd(0), _lastSched(0), _endTime(0),
+        _speed(CPU::SPEED_ONE), _pending(0), _missCount(0),
+        taskEvt(this)
+    {
+    }
+
+    LightTask::LightTask(Tick period, Tick wcet, Tick rdl, Tick phase,
+                         const std::string &name, Entity::Deferred d) :
+        Entity(name, d), _period(period), _rdl(rdl == 0 ? period : rdl),
+        _phase(phase), _wcet(wcet), _cost(),
+        _kernel(NULL), _state(IDLE),
+        _arrival(0), _lastArrival(0), _nextArrival(0), _dl(0),
+        _jobCost(0), _done(0), _execd(0), _lastSched(0), _endTime(0),
+        _speed(CPU::SPEED_ONE), _pending(0), _missCount(0),
+        taskEvt(this)
+    {
+    }
+
+    void LightTask::setParameters(Tick period, Tick wcet, Tick rdl, Tick phase)
+    {
+        _period = period;
+        _wcet = wcet;
+        _cost.reset();
+        _rdl = rdl == 0 ? period : rdl;
+        _phase = phase;
+    }
+
+    void LightTask::newRun()
+    {
+        _state = IDLE;
+        _pending = 0;
+        _missCount = 0;
+        _execd = 0;
+        _dl = 0;
+        _lastArrival = _arrival = _nextArrival = _phase;
+        repost();
+    }
+
+    void LightTask::endRun()
+    {
+        taskEvt.drop();
+    }
+
+    void LightTask::setKernel(AbsKernel *k) throw(KernAlreadySet)
+    {
+        if (_kernel != NULL) throw KernAlreadySet();
+        _kernel = k;
+    }
+
+    Tick LightTask::getMaxExecutionTime() const
+    {
+        if (_cost.get()) return Tick(_cost->getMaximum());
+        return _wcet;
+    }
+
+    Tick LightTask::getExecTime() const
+    {
+        if (_state == EXEC) return _execd + SIMUL.getTime() - _lastSched;
+        return _execd;
+    }
+
+    void LightTask::newJob(Tick arr)
+    {
+        _arrival = arr;
+        _dl = arr + _rdl;
+        _jobCost = _cost.get() ? Tick(_cost->draw()) : _wcet;
+        _done = 0;
+        _execd = 0;
+        _state = READY;
+    }
+
+    void LightTask::setEndTime(Tick t)
+    {
+        int64_t left = int64_t(_jobCost) * CPU::SPEED_ONE - _done;
+        _endTime = t;
+        if (left > 0) _endTime += Tick((left + _speed - 1) / _speed);
+    }
+
+    void LightTask::repost()
+    {
+        Tick t = _nextArrival;
+        int p = Event::_DEFAULT_PRIORITY;
+
+        if (_state == EXEC && _endTime <= t) {
+            t = _endTime;
+            p = EndEvt::_END_EVT_PRIORITY;
+        }
+        taskEvt.drop();
+        taskEvt.setPriority(p);
+        taskEvt.post(t);
+    }
+
+    void LightTask::onArrival()
+    {
+        if (isActive()) _pending++;
+        else {
+            newJob(SIMUL.getTime());
+            _kernel->onArrival(this);
+        }
+    }
+
+    void LightTask::endJob()
+    {
+        Tick t = SIMUL.getTime();
+
+        _execd += t - _lastSched;
+        if (t > _dl) _missCount++;
+        _lastArrival = _arrival;
+        _kernel->onEnd(this);
+        _state = IDLE;
+
+        if (_pending > 0) {
+            _pending--;
+            newJob(_arrival + _period);
+            _kernel->onArrival(this);
+        }
+    }
+
+    void LightTask::onEvent()
+    {
+        Tick t = SIMUL.getTime();
+
+        taskEvt._end = false;
+        if (_state == EXEC && _endTime <= t) {
+            taskEvt._end = true;
+            endJob();
+        }
+        if (_nextArrival <= t) {
+            _nextArrival = t + _period;
+            onArrival();
+        }
+        repost();
+    }
+
+    void LightTask::schedule()
+    {
+        Tick t = SIMUL.getTime();
+
+        _state = EXEC;
+        _lastSched = t;
+        _speed = _kernel->getProcessor(this)->getFixedSpeed();
+        setEndTime(t);
+        repost();
+    }
+
+    void LightTask::deschedule()
+    {
+        Tick t = SIMUL.getTime();
+
+        if (_state == EXEC) {
+            _done += int64_t(t - _lastSched) * _speed;
+            _execd += t - _lastSched;
+            _state = READY;
+        }
+        repost();
+    }
+
+    void LightTask::refreshExec(double oldSpeed, double newSpeed)
+    {
+        Tick t = SIMUL.getTime();
+
+        _done += int64_t(t - _lastSched) * CPU::toFixedSpeed(oldSpeed);
+        _execd += t - _lastSched;
+        _lastSched = t;
+        _speed = CPU::toFixedSpeed(newSpeed);
+        setEndTime(t);
+        repost();
+    }
+
+    void LightTask::activate()
+    {
+        _nextArrival = SIMUL.getTime();
+        repost();
+    }
+
+    LightTaskSet::LightTaskSet(const vector<Tick> &period,
+                               const vector<Tick> &wcet,
+                               const vector<Tick> &rdl,
+                               const vector<Tick> &phase,
+                               const string &prefix, int threads) :
+        _tasks(NULL), _n(period.size())
+    {
+        if (wcet.size() != _n || (!rdl.empty() && rdl.size() != _n) ||
+            (!phase.empty() && phase.size() != _n))
+            throw Exc("The parameter arrays have different sizes");
+
+        bool named = !prefix.empty() ||
+            SimContext::current()->entities.isIndexAnonymous();
+        Entity::reserve(_n, named);
+
+        size_t t = threads > 0 ? size_t(threads)
+            : Topology::get().getDefaultThreads();
+        if (t > _n / MIN_SHARD) t = _n / MIN_SHARD;
+
+        _tasks = static_cast<LightTask *>(::operator new(_n * sizeof(LightTask)));
+        if (t > 1) {
+            build(period, wcet, rdl, phase, prefix, t);
+            return;
+        }
+
+        size_t i = 0;
+        try {
+            for (; i < _n; ++i)
+                construct(i, period, wcet, rdl, phase, prefix, false);
+        } catch (...) {
+            destroy(i);
+            throw;
+        }
+    }
+
+    void LightTaskSet::construct(size_t i, const vector<Tick> &period,
+                                 const vector<Tick> &wcet,
+                                 const vector<Tick> &rdl,
+                                 const vector<Tick> &phase,
+                                 const string &prefix, bool deferred)
+    {
+        string name;
+        if (!prefix.empty()) {
+            stringstream ss;
+            ss << prefix << i;
+            name = ss.str();
+        }
+        Tick d = rdl.empty() ? Tick(0) : rdl[i];
+        Tick p = phase.empty() ? Tick(0) : phase[i];
+        if (deferred)
+            new (&_tasks[i]) LightTask(period[i], wcet[i], d, p, name,
+                                       Entity::Deferred());
+        else
+            new (&_tasks[i]) LightTask(period[i], wcet[i], d, p, name);
+    }
+
+    void LightTaskSet::build(const vector<Tick> &period,
+                             const vector<Tick> &wcet,
+                             const vector<Tick> &rdl,
+                             const vector<Tick> &phase,
+                             const string &prefix, size_t threads)
+    {
+        SimContext *ctx = SimContext::current();
+
+        // shard k is [k * _n / threads, (k + 1) * _n / threads)
+        vector<size_t> done(threads);
+        vector<exception_ptr> error(threads);
+        vector<std::thread> pool;
+        for (size_t k = 0; k < threads; ++k) {
+            pool.push_back(std::thread([&, k]() {
+                SimContext::Scope scope(ctx);
+                size_t b = k * _n / threads, e = (k + 1) * _n / threads;
+                done[k] = b;
+                try {
+                    for (; done[k] < e; ++done[k])
+                        construct(done[k], period, wcet, rdl, phase, prefix, true);
+                } catch (...) {
+                    error[k] = current_exception();
+                }
+            }));
+        }
+        for (size_t k = 0; k < threads; ++k) pool[k].join();
+
+        exception_ptr first;
+        for (size_t k = 0; k < threads && !first; ++k) first = error[k];
+        if (first) {
+            // nothing is registered yet
+            for (size_t k = threads; k > 0; --k) {
+                size_t b = (k - 1) * _n / threads;
+                while (done[k - 1] > b) _tasks[--done[k - 1]].~LightTask();
+            }
+            ::operator delete(_tasks);
+            _tasks = NULL;
+            rethrow_exception(first);
+        }
+
+        // the IDs and the names, in order
+        try {
+            for (size_t i = 0; i < _n; ++i) _tasks[i].registerEntity();
+        } catch (...) {
+            destroy(_n);
+            throw;
+        }
+    }
+
+    LightTaskSet::~LightTaskSet()
+    {
+        destroy(_n);
+    }
+
+    void LightTaskSet::destroy(size_t n)
+    {
+        // in reverse order, so that the registry shrinks at once
+        while (n > 0) _tasks[--n].~LightTask();
+        ::operator delete(_tasks);
+        _tasks = NULL;
+    }
+
+    void LightTaskSet::addTo(RTKernel &k, const string &param)
+    {
+        k.reserveTasks(_n);
+        for (size_t i = 0; i < _n; ++i) k.addTask(_tasks[i], param);
+    }
+
+    void LightTaskSet::addTo(RTKernel &k, const vector<string> &param)
+    {
+        if (param.size() != _n) 
+            throw Exc("One set of parameters per task is needed");
+        k.reserveTasks(_n);
+        for (size_t i = 0; i < _n; ++i) k.addTask(_tasks[i], param[i]);
+    }
+
+} // namespace RTSim
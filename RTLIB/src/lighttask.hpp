@@ -0,0 +1,286 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __LIGHTTASK_HPP__
+#define __LIGHTTASK_HPP__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <entity.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+
+#include <abstask.hpp>
+#include <taskexc.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    class AbsKernel;
+    class LightTask;
+    class RTKernel;
+
+    /**
+       \ingroup task
+
+       The only event of a LightTask. It is posted at the next
+       arrival of the task or at the end of its current job,
+       whichever comes first; isJobEnd() tells the probes whether a
+       job has ended when the event was processed.
+    */
+    class LightTaskEvt : public Event {
+        LightTask *_task;
+        bool _end;
+
+        friend class LightTask;
+    public:
+        LightTaskEvt(LightTask *t) : Event(), _task(t), _end(false) {}
+
+        LightTask *getTask() const { return _task; }
+
+        /// True if a job ended at the last processing of the event
+        bool isJobEnd() const { return _end; }
+
+        virtual void doit();
+    };
+
+    /**
+       \ingroup task
+
+       A compact periodic task, for simulations with very large
+       task sets. Every job executes for a constant or random
+       number of cycles, with no pseudo-instructions, and the task
+       uses a single event (see LightTaskEvt) for both its arrivals
+       and the end of its jobs.
+
+       The task can be scheduled by RTKernel and MRTKernel like a
+       Task. The arrivals that happen while a job is active are
+       counted, and the corresponding jobs start, one after the
+       other, when the current job ends (their arrival time is the
+       previous one plus the period). activate() releases a job
+       immediately and restarts the periodic arrivals from the
+       current time, as Task::activate() does.
+
+       FinishingTimeStat, LatenessStat, TardinessStat,
+       MissPercentage and MissCount can be attached with
+       attachToTask(LightTask *). Traces are not supported.
+    */
+    class LightTask : public Entity, public AbsRTTask {
+        typedef enum { IDLE, READY, EXEC } State;
+
+        Tick _period;
+        Tick _rdl;
+        Tick _phase;
+        /// cost of every job, if _cost is NULL
+        Tick _wcet;
+        unique_ptr<RandomVar> _cost;
+
+        AbsKernel *_kernel;
+        State _state;
+
+        Tick _arrival;
+        Tick _lastArrival;
+        Tick _nextArrival;
+        Tick _dl;
+
+        /// cost of the current job, and work already done (in fixed
+        /// point, see CPU::SPEED_ONE)
+        Tick _jobCost;
+        int64_t _done;
+        /// ticks executed by the current job before _lastSched
+        Tick _execd;
+        Tick _lastSched;
+        Tick _endTime;
+        int64_t _speed;
+
+        /// arrivals buffered while a job is active
+        int _pending;
+        int _missCount;
+
+        void newJob(Tick arr);
+        void endJob();
+        void onArrival();
+        /// end of the current job, executing from t at _speed
+        void setEndTime(Tick t);
+        void repost();
+
+        friend class LightTaskEvt;
+        void onEvent();
+
+    public:
+        LightTaskEvt taskEvt;
+
+        /**
+           A task whose jobs execute wcet cycles. A relative
+           deadline of 0 means the period.
+        */
+        LightTask(Tick period, Tick wcet, Tick rdl = 0, Tick phase = 0,
+                  const std::string &name = "");
+
+        /**
+           A task whose job costs are drawn from c, which is now
+           owned by the task.
+        */
+        LightTask(Tick period, RandomVar *c, Tick rdl = 0, Tick phase = 0,
+                  const std::string &name = "");
+
+        /**
+           As LightTask(period, wcet, rdl, phase, name), but the
+           task is not registered until registerEntity() is
+           called (see Entity::Deferred).
+        */
+        LightTask(Tick period, Tick wcet, Tick rdl, Tick phase,
+                  const std::string &name, Entity::Deferred d);
+
+        Tick getPeriod() const { return _period; }
+
+        /**
+           Changes the parameters of the task, between two runs
+           (see Task::setPhase()): from now on, every job executes
+           wcet cycles. A relative deadline of 0 means the period.
+        */
+        void setParameters(Tick period, Tick wcet, Tick rdl = 0, Tick phase = 0);
+
+        /// Time executed by the current (or last) job
+        Tick getExecTime() const;
+
+        /// Jobs that finished after their deadline in this run
+        int getMissCount() const { return _missCount; }
+
+        // from AbsTask
+        virtual void schedule();
+        virtual void deschedule();
+        virtual void activate();
+        virtual bool isActive() const { return _state != IDLE; }
+        virtual bool isExecuting() const { return _state == EXEC; }
+        virtual Tick getArrival() const { return _arrival; }
+        virtual Tick getLastArrival() const { return _lastArrival; }
+        virtual void setKernel(AbsKernel *k) throw(KernAlreadySet);
+        virtual AbsKernel *getKernel() { return _kernel; }
+        virtual void refreshExec(double oldSpeed, double newSpeed);
+        virtual Tick getMaxExecutionTime() const;
+
+        // from AbsRTTask
+        virtual Tick getDeadline() const { return _dl; }
+        virtual Tick getRelDline() const { return _rdl; }
+        virtual int getTaskNumber() const { return getID(); }
+
+        // from Entity
+        virtual void newRun();
+        virtual void endRun();
+    };
+
+    /**
+       \ingroup task
+
+       A large set of LightTask objects, built in bulk from the
+       arrays of their parameters: the tasks (with their events)
+       are allocated in a single block, after making room for them
+       in the entity registry, and addTo() reserves the containers
+       of the kernel and of its scheduler before adding them.
+
+       <pre>
+       vector<Tick> period(n), wcet(n);
+       ...
+       LightTaskSet set(period, wcet);
+       set.addTo(kern);
+       </pre>
+
+       The set owns the tasks: it must not be destroyed while they
+       are handled by a kernel.
+
+       With more than one thread, the tasks are constructed in
+       parallel, each thread building a contiguous shard of the
+       block without registering them (see Entity::Deferred); then
+       they are registered in order, so they get the same IDs and
+       names as with a single thread, and the simulation is the
+       same.
+    */
+    class LightTaskSet {
+        LightTask *_tasks;
+        size_t _n;
+
+        LightTaskSet(const LightTaskSet &);
+        LightTaskSet &operator=(const LightTaskSet &);
+
+        /// constructs task i (deferred, if not registered)
+        void construct(size_t i, const std::vector<Tick> &period,
+                       const std::vector<Tick> &wcet,
+                       const std::vector<Tick> &rdl,
+                       const std::vector<Tick> &phase,
+                       const std::string &prefix, bool deferred);
+
+        void build(const std::vector<Tick> &period,
+                   const std::vector<Tick> &wcet,
+                   const std::vector<Tick> &rdl,
+                   const std::vector<Tick> &phase,
+                   const std::string &prefix, size_t threads);
+
+        void destroy(size_t n);
+
+    public:
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "LightTaskSet", "lighttask.cpp") {}
+        };
+
+        /**
+           Task i has period period[i] and executes wcet[i] cycles;
+           rdl and phase can be empty (relative deadline equal to
+           the period, phase 0). If prefix is not empty, the tasks
+           are named <prefix>0, <prefix>1, ..., otherwise they are
+           anonymous (see Entity::setIndexAnonymous()).
+
+           The tasks are constructed by threads threads (0 means
+           one for each processor, see Topology); the sets smaller
+           than MIN_SHARD tasks for each thread use less threads.
+
+           @throws Exc if the arrays have different sizes
+        */
+        LightTaskSet(const std::vector<Tick> &period,
+                     const std::vector<Tick> &wcet,
+                     const std::vector<Tick> &rdl = std::vector<Tick>(),
+                     const std::vector<Tick> &phase = std::vector<Tick>(),
+                     const std::string &prefix = "", int threads = 1);
+
+        /// the smallest shard built by a thread of its own
+        static const size_t MIN_SHARD = 4096;
+
+        ~LightTaskSet();
+
+        size_t size() const { return _n; }
+
+        LightTask &operator[](size_t i) { return _tasks[i]; }
+        const LightTask &operator[](size_t i) const { return _tasks[i]; }
+
+        /// Adds all the tasks to k, with the same parameters
+        void addTo(RTKernel &k, const std::string &param = "");
+
+        /**
+           Adds all the tasks to k, task i with parameters
+           param[i].
+
+           @throws Exc if param has not one element per task
+        */
+        void addTo(RTKernel &k, const std::vector<std::string> &param);
+    };
+
+} // namespace RTSim
+
+#endif
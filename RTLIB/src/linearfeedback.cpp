@@ -0,0 +1,153 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+#include <linearfeedback.hpp>
+#include <strtoken.hpp>
+#include <task.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    namespace {
+        double number(const string &key, const string &s)
+        {
+            char *end;
+            double v = strtod(s.c_str(), &end);
+            if (s.empty() || *end != 0)
+                throw LinearController::Exc("Wrong value " + s + " for " + key);
+            return v;
+        }
+    }
+
+    LinearController::LinearController(const string &params) :
+        _na(0), _nb(0), _target(0), _min(0), _max(1)
+    {
+        for (int i = 0; i < MAX_ORDER; ++i) _a[i] = 0;
+        for (int i = 0; i <= MAX_ORDER; ++i) _b[i] = 0;
+
+        istringstream in(params);
+        string word;
+        while (in >> word) {
+            size_t eq = word.find('=');
+            if (eq == string::npos) throw Exc("Missing value for " + word);
+            string key = word.substr(0, eq), value = word.substr(eq + 1);
+            if (key == "a") coefficients(key, value, _a, MAX_ORDER, _na);
+            else if (key == "b") coefficients(key, value, _b, MAX_ORDER + 1, _nb);
+            else if (key == "target") _target = number(key, value);
+            else if (key == "min") _min = number(key, value);
+            else if (key == "max") _max = number(key, value);
+            else throw Exc("Unknown parameter " + key);
+        }
+        if (_min > _max) throw Exc("min is greater than max");
+    }
+
+    void LinearController::coefficients(const string &key, const string &value,
+                                        double *c, int max, int &n)
+    {
+        vector<string> v = parse_util::split(value, ",");
+        if (int(v.size()) > max) throw Exc("Too many coefficients " + key);
+        for (n = 0; n < int(v.size()); ++n) c[n] = number(key, v[n]);
+    }
+
+    double LinearController::output(const double *e, const double *u) const
+    {
+        double y = 0;
+        for (int i = 0; i < _na; ++i) y += _a[i] * u[i];
+        for (int i = 0; i < _nb; ++i) y += _b[i] * e[i];
+        return y;
+    }
+
+    LinearFeedbackModule::LinearFeedbackModule(const string &name,
+                                               const LinearController &c) :
+        AbstractFeedbackModule(name), _ctrl(c), _sup(0), _batch(0), _server(0),
+        _init_bw(0), _required_bw(0), _granted_bw(0), _asked_from(0)
+    {
+        newRun();
+    }
+
+    void LinearFeedbackModule::setServer(Server *s)
+    {
+        _server = s;
+        _init_bw = double(s->getBudget()) / double(s->getPeriod());
+        newRun();
+    }
+
+    void LinearFeedbackModule::setSupervisor(Supervisor *sup, Server *s)
+    {
+        _sup = sup;
+        _batch = 0;
+        setServer(s);
+    }
+
+    void LinearFeedbackModule::setBatch(BudgetBatch *b, Server *s)
+    {
+        _sup = 0;
+        _batch = b;
+        setServer(s);
+    }
+
+    void LinearFeedbackModule::notify(const Tick &)
+    {
+        if (_server == 0) return;
+
+        double period = double(_server->getPeriod());
+        for (int i = LinearController::MAX_ORDER; i > 0; --i) _e[i] = _e[i - 1];
+        _e[0] = (double(SIMUL.getTime()) - double(task->getDeadline())) / period
+            - _ctrl.getTarget();
+
+        double u = _ctrl.output(_e, _u);
+        for (int i = LinearController::MAX_ORDER - 1; i > 0; --i) _u[i] = _u[i - 1];
+        _u[0] = u;
+        _required_bw = _ctrl.clip(u);
+
+        Tick budget = _server->getBudget();
+        Tick delta = Tick::ceil(_required_bw * period) - budget;
+        if (delta == 0) return;
+
+        _asked_from = budget;
+        if (_batch != 0) _batch->request(_server, delta, this);
+        else if (_sup != 0) onBudgetGranted(_server, _sup->changeBudget(_server, delta));
+    }
+
+    void LinearFeedbackModule::onBudgetGranted(Server *s, const Tick &delta)
+    {
+        _granted_bw = double(_asked_from + delta) / double(s->getPeriod());
+    }
+
+    void LinearFeedbackModule::newRun()
+    {
+        for (int i = 0; i <= LinearController::MAX_ORDER; ++i) _e[i] = 0;
+        for (int i = 0; i < LinearController::MAX_ORDER; ++i) _u[i] = _init_bw;
+        _required_bw = _granted_bw = _init_bw;
+    }
+
+    void LinearFeedbackModule::endRun()
+    {
+    }
+
+    Tick LinearFeedbackModule::getRequiredBudget() const
+    {
+        return _server == 0 ? Tick(0) : Tick::ceil(_required_bw * double(_server->getPeriod()));
+    }
+
+    Tick LinearFeedbackModule::getGrantedBudget() const
+    {
+        return _server == 0 ? Tick(0) : Tick::round(_granted_bw * double(_server->getPeriod()));
+    }
+
+}
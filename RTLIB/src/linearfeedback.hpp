@@ -0,0 +1,137 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __LINEARFEEDBACK_HPP__
+#define __LINEARFEEDBACK_HPP__
+
+#include <string>
+
+#include <baseexc.hpp>
+#include <feedback.hpp>
+#include <supervisor.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    /**
+       The coefficients of a linear controller, compiled once from
+       their text and shared by any number of LinearFeedbackModule:
+
+       u(k) = a1 u(k-1) + ... + an u(k-n) + b0 e(k) + ... + bm e(k-m)
+
+       where e(k) is the scheduling error of job k (its finishing
+       time minus its deadline, as a fraction of the period of the
+       server) minus target, and u(k) is the bandwidth required for
+       the next jobs, clipped to [min, max]. For example, an
+       integral controller that keeps the jobs 10% of the period
+       early:
+
+       <pre>
+       LinearController c("a=1 b=0.5 target=-0.1 min=0.05 max=0.5");
+       </pre>
+
+       At most MAX_ORDER coefficients a, and MAX_ORDER + 1
+       coefficients b, can be given (separated by commas); the
+       missing ones are 0. By default, min is 0 and max is 1.
+    */
+    class LinearController {
+    public:
+        enum { MAX_ORDER = 4 };
+
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "LinearController", "linearfeedback.cpp") {}
+        };
+
+        /// @throws Exc on a wrong parameter
+        LinearController(const std::string &params);
+
+        int getOrder() const { return _na; }
+
+        /**
+           The output u(k), given the errors e[0] = e(k), e[1] =
+           e(k-1), ... and the outputs u[0] = u(k-1), u[1] = u(k-2),
+           ... (before clipping)
+        */
+        double output(const double *e, const double *u) const;
+
+        double clip(double u) const { return u < _min ? _min : (u > _max ? _max : u); }
+
+        double getTarget() const { return _target; }
+
+    private:
+        double _a[MAX_ORDER];
+        double _b[MAX_ORDER + 1];
+        int _na, _nb;
+        double _target, _min, _max;
+
+        void coefficients(const std::string &key, const std::string &value,
+                          double *c, int max, int &n);
+    };
+
+    /**
+       A feedback module that sets the budget of a server with a
+       LinearController, at the end of every job of its task. Its
+       state is a fixed-size vector of past errors and outputs, so
+       that a job end does not allocate memory nor parse anything.
+
+       The new budget is requested to the supervisor directly (see
+       setSupervisor()), or through a BudgetBatch (see setBatch()),
+       which passes the requests of all the modules of the same tick
+       to the supervisor with one call.
+    */
+    class LinearFeedbackModule : public AbstractFeedbackModule {
+        const LinearController &_ctrl;
+        Supervisor *_sup;
+        BudgetBatch *_batch;
+        Server *_server;
+
+        // most recent first
+        double _e[LinearController::MAX_ORDER + 1];
+        double _u[LinearController::MAX_ORDER];
+
+        double _init_bw, _required_bw, _granted_bw;
+
+        // the budget when the pending request was made
+        Tick _asked_from;
+
+        void setServer(Server *s);
+
+    public:
+        LinearFeedbackModule(const std::string &name, const LinearController &c);
+
+        /// Requests the budget of s to sup, at every job end
+        void setSupervisor(Supervisor *sup, Server *s);
+
+        /// Requests the budget of s to the supervisor of b, at the end of each tick
+        void setBatch(BudgetBatch *b, Server *s);
+
+        virtual void notify(const Tick &exec_time);
+        virtual void onBudgetGranted(Server *s, const Tick &delta);
+        virtual void newRun();
+        virtual void endRun();
+
+        /// The bandwidth required by the controller for the next jobs
+        double getRequiredBandwidth() const { return _required_bw; }
+
+        /// The bandwidth granted by the supervisor
+        double getGrantedBandwidth() const { return _granted_bw; }
+
+        Tick getRequiredBudget() const;
+        Tick getGrantedBudget() const;
+    };
+}
+
+#endif
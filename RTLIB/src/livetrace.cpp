@@ -0,0 +1,209 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <livetrace.hpp>
+
+namespace RTSim {
+
+  namespace {
+    const char MAGIC[8] = {'R', 'T', 'L', 'I', 'V', 'E', '0', '1'};
+    const size_t LINE = 64;
+    enum { TAIL = 1, RESERVE, HEAD, ATTACHES, DATA };
+
+    bool powerOf2(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+    inline std::atomic<uint64_t> &word(void *map, int line)
+    {
+      return *reinterpret_cast<std::atomic<uint64_t> *>
+        (static_cast<char *>(map) + line * LINE);
+    }
+
+    /// the size of the record at pos, read across the end of the ring
+    inline uint32_t recordSize(const char *data, uint64_t capacity,
+                               uint64_t pos)
+    {
+      unsigned char b[4];
+      for (int i = 0; i < 4; ++i) b[i] = data[(pos + i) & (capacity - 1)];
+      return 4 + ((uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) |
+                  (uint32_t(b[2]) << 8) | uint32_t(b[3]));
+    }
+
+    void *mapFile(const string &name, size_t len, bool create)
+    {
+#ifndef _WIN32
+      int fd = open(name.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR,
+                    0600);
+      if (fd < 0) throw LiveTraceExc("Cannot open " + name);
+      struct stat st;
+      if ((create && ftruncate(fd, len) != 0) ||
+          fstat(fd, &st) != 0 || size_t(st.st_size) < len) {
+        close(fd);
+        throw LiveTraceExc(name + " is not a live trace");
+      }
+      void *m = mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (m == MAP_FAILED) throw LiveTraceExc("Cannot map " + name);
+      return m;
+#else
+      throw LiveTraceExc("live traces are not supported");
+#endif
+    }
+
+    void unmapFile(void *map, size_t len)
+    {
+#ifndef _WIN32
+      munmap(map, len);
+#endif
+    }
+  }
+
+  LiveTrace::LiveTrace(const char *name, size_t capacity)
+    : Trace(name, Trace::BINARY, false), JavaTrace(name, 0UL),
+      _map(0), _len(DATA * LINE + capacity), _capacity(capacity), _data(0),
+      _head(0), _tail(0), _attaches(0), _dropped(0)
+  {
+    if (!powerOf2(capacity))
+      throw LiveTraceExc("the capacity must be a power of 2");
+    _map = mapFile(name, _len, true);
+    toFile = true;
+
+    char *base = static_cast<char *>(_map);
+    _data = base + DATA * LINE;
+    for (int l = TAIL; l < DATA; ++l)
+      new (&word(_map, l)) std::atomic<uint64_t>(0);
+    memcpy(base + sizeof(MAGIC), &_capacity, sizeof(_capacity));
+    // the magic last: a reader does not attach to a ring half-built
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(base, MAGIC, sizeof(MAGIC));
+  }
+
+  LiveTrace::~LiveTrace()
+  {
+    unmapFile(_map, _len);
+  }
+
+  void LiveTrace::close()
+  {
+  }
+
+  void LiveTrace::emit(const char *rec, size_t n, int, int)
+  {
+    if (n > _capacity / 2) {
+      ++_dropped;
+      return;
+    }
+
+    // a new reader: its viewer needs the names again
+    uint64_t a = word(_map, ATTACHES).load(std::memory_order_relaxed);
+    if (a != _attaches) {
+      _attaches = a;
+      _named.assign(_named.size(), false);
+    }
+
+    uint64_t end = _tail + n;
+    while (end - _head > _capacity)
+      _head += recordSize(_data, _capacity, _head);
+    word(_map, HEAD).store(_head, std::memory_order_release);
+    word(_map, RESERVE).store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t off = _tail & (_capacity - 1);
+    size_t first = n < _capacity - off ? n : _capacity - off;
+    memcpy(_data + off, rec, first);
+    memcpy(_data, rec + first, n - first);
+
+    _tail = end;
+    word(_map, TAIL).store(_tail, std::memory_order_release);
+  }
+
+  LiveTraceReader::LiveTraceReader(const string &name, bool fromStart)
+    : _map(0), _len(0), _capacity(0), _data(0), _pos(0), _lost(0)
+  {
+    // the header first, to know the capacity
+    void *h = mapFile(name, DATA * LINE, false);
+    uint64_t cap;
+    bool ok = memcmp(h, MAGIC, sizeof(MAGIC)) == 0;
+    memcpy(&cap, static_cast<char *>(h) + sizeof(MAGIC), sizeof(cap));
+    unmapFile(h, DATA * LINE);
+    if (!ok || !powerOf2(cap)) throw LiveTraceExc(name + " is not a live trace");
+
+    _capacity = cap;
+    _len = DATA * LINE + cap;
+    _map = mapFile(name, _len, false);
+    _data = static_cast<const char *>(_map) + DATA * LINE;
+
+    word(ATTACHES).fetch_add(1, std::memory_order_relaxed);
+    _pos = word(fromStart ? HEAD : TAIL).load(std::memory_order_acquire);
+  }
+
+  LiveTraceReader::~LiveTraceReader()
+  {
+    unmapFile(_map, _len);
+  }
+
+  std::atomic<uint64_t> &LiveTraceReader::word(int line) const
+  {
+    return RTSim::word(_map, line);
+  }
+
+  void LiveTraceReader::copy(uint64_t pos, char *dst, size_t n) const
+  {
+    size_t off = pos & (_capacity - 1);
+    size_t first = n < _capacity - off ? n : _capacity - off;
+    memcpy(dst, _data + off, first);
+    memcpy(dst + first, _data, n - first);
+  }
+
+  bool LiveTraceReader::next(vector<char> &rec)
+  {
+    for (;;) {
+      uint64_t tail = word(TAIL).load(std::memory_order_acquire);
+      if (_pos == tail) return false;
+      if (tail - _pos > _capacity) {
+        ++_lost;
+        _pos = word(HEAD).load(std::memory_order_acquire);
+        continue;
+      }
+
+      // the record may be overwritten while it is copied: its
+      // size is checked only if the copy is still valid
+      uint32_t size = recordSize(_data, _capacity, _pos);
+      bool fits = size >= 16 && size <= tail - _pos;
+      if (fits) {
+        rec.resize(size);
+        copy(_pos, &rec[0], size);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t reserve = word(RESERVE).load(std::memory_order_relaxed);
+      if (reserve - _pos > _capacity) {
+        ++_lost;
+        _pos = word(HEAD).load(std::memory_order_acquire);
+        continue;
+      }
+      if (!fits) throw LiveTraceExc("a corrupted record");
+      _pos += size;
+      return true;
+    }
+  }
+
+} // namespace RTSim
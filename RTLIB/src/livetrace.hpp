@@ -0,0 +1,143 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __LIVETRACE_HPP__
+#define __LIVETRACE_HPP__
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <jtrace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  /// Raised when a live trace cannot be created or attached
+  DECL_EXC(LiveTraceExc, "LiveTrace");
+
+  /**
+     \ingroup util
+
+     A JavaTrace published in a ring of shared memory, for a
+     viewer that follows a long simulation while it runs, without
+     a trace on disk. The records (in the format of
+     TraceEvent::write()) are copied in a file mapped with mmap()
+     (e.g. under /dev/shm), which any number of readers
+     (LiveTraceReader) can map, and leave, at any time.
+
+     The writer never waits for the readers: when the ring is
+     full, the oldest records are overwritten. A reader that falls
+     behind loses them, notices it, and goes on from the oldest
+     record still in the ring. Since a new reader has missed the
+     names of the tasks, they are traced again after each attach.
+
+     <pre>
+     "RTLIVE01" capacity(uint64)                  (a cache line)
+     tail(uint64)                                 (a cache line)
+     reserve(uint64)                              (a cache line)
+     head(uint64)                                 (a cache line)
+     attaches(uint64)                             (a cache line)
+     capacity bytes of records
+     </pre>
+
+     The positions are byte counters that never wrap (the offset
+     in the ring is the position modulo the capacity): the
+     records are in [head, tail), and reserve is the end of the
+     record being written, so that a reader checks, after copying
+     a record, that the writer has not reached it in the
+     meantime.
+  */
+  class LiveTrace : public JavaTrace {
+    void *_map;
+    size_t _len;
+    uint64_t _capacity;
+    char *_data;
+    /// copies of head and tail (only the writer changes them)
+    uint64_t _head, _tail;
+    uint64_t _attaches;
+    unsigned long _dropped;
+
+  protected:
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+  public:
+    /**
+       Creates (or truncates) the file name, with a ring of
+       capacity bytes (a power of 2).
+
+       @throws LiveTraceExc if the file cannot be mapped
+    */
+    LiveTrace(const char *name, size_t capacity = 1 << 20);
+    virtual ~LiveTrace();
+
+    /// Does nothing: the ring stays readable until the destruction
+    virtual void close();
+
+    size_t getCapacity() const { return _capacity; }
+
+    /// The records too large for the ring (more than half of it)
+    unsigned long getDropped() const { return _dropped; }
+  };
+
+  /**
+     \ingroup util
+
+     A reader of a LiveTrace, in the same process or in another
+     one. It starts at the newest record, or at the oldest one
+     still in the ring with fromStart.
+
+     <pre>
+     LiveTraceReader r("/dev/shm/sim.live");
+     vector<char> rec;
+     while (viewing) {
+       while (r.next(rec)) show(TraceRecord(&rec[0]));
+       wait();
+     }
+     </pre>
+  */
+  class LiveTraceReader {
+    void *_map;
+    size_t _len;
+    uint64_t _capacity;
+    const char *_data;
+    uint64_t _pos;
+    unsigned long _lost;
+
+    void copy(uint64_t pos, char *dst, size_t n) const;
+    std::atomic<uint64_t> &word(int line) const;
+
+    LiveTraceReader(const LiveTraceReader &);
+    LiveTraceReader &operator=(const LiveTraceReader &);
+
+  public:
+    /// @throws LiveTraceExc if name is not a live trace
+    LiveTraceReader(const string &name, bool fromStart = false);
+    ~LiveTraceReader();
+
+    /**
+       Copies the next record in rec, and returns true; returns
+       false if the writer has not written one yet.
+    */
+    bool next(vector<char> &rec);
+
+    /// How many times the writer has overwritten records not read yet
+    unsigned long getLost() const { return _lost; }
+  };
+
+} // namespace RTSim
+
+#endif
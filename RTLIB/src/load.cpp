@@ -11,10 +11,14 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <thread>
 
 #include <exeinstr.hpp>
 #include <load.hpp>
+#include <schedanalysis.hpp>
 
 namespace RTSim {
 
@@ -648,4 +652,74 @@ namespace RTSim {
         //dbg.disable("__tset__");
     }
 
+    const size_t UUniFastGen::SETS_PER_STREAM = 1024;
+    const int UUniFastGen::DISCARD_LIMIT = 1000;
+
+    UUniFastGen::UUniFastGen(int n, double u, Tick tMin, Tick tMax, 
+                             Tick gcd, double uMax) :
+        _n(n), _u(u), _uMax(uMax), _tMin(tMin), _tMax(tMax), _gcd(gcd)
+    {
+    }
+
+    bool UUniFastGen::generate(RandomGen &g, double *u, Tick *c, Tick *t) const
+    {
+        bool ok = false;
+        for (int k = 0; !ok && k < DISCARD_LIMIT; ++k) {
+            double sum = _u;
+            ok = true;
+            for (int i = 0; i < _n - 1; ++i) {
+                double next = sum * pow(g.uniform(0, 1), 1.0 / (_n - i - 1));
+                u[i] = sum - next;
+                sum = next;
+                ok = ok && u[i] <= _uMax;
+            }
+            u[_n - 1] = sum;
+            ok = ok && sum <= _uMax;
+        }
+        if (!ok) return false;
+
+        double lmin = log(double(_tMin));
+        double lmax = log(double(_tMax));
+        for (int i = 0; i < _n; ++i) {
+            Tick p = Tick::round(exp(g.uniform(lmin, lmax)) / double(_gcd)) * _gcd;
+            t[i] = max(p, _gcd);
+            c[i] = max(Tick::round(u[i] * double(t[i])), Tick(1));
+        }
+        return true;
+    }
+
+    void UUniFastGen::generate(TaskSetBatch &b, size_t nsets, const RandomGen &g,
+                               unsigned nthreads) const
+    {
+        size_t first = b.addSets(nsets, _n);
+        size_t groups = (nsets + SETS_PER_STREAM - 1) / SETS_PER_STREAM;
+        if (nthreads == 0) nthreads = max(1u, thread::hardware_concurrency());
+        nthreads = min<size_t>(nthreads, groups);
+
+        atomic<bool> failed(false);
+        // thread h generates the groups h, h + nthreads, ...
+        auto run = [&](unsigned h) {
+            vector<double> u(_n);
+            for (size_t j = h; j < groups && !failed; j += nthreads) {
+                unique_ptr<RandomGen> r(g.substream(j));
+                size_t last = min(nsets, (j + 1) * SETS_PER_STREAM);
+                for (size_t k = j * SETS_PER_STREAM; k < last; ++k) {
+                    size_t s = first + k;
+                    if (!generate(*r, &u[0], b.getC(s), b.getT(s))) {
+                        failed = true;
+                        return;
+                    }
+                    copy(b.getT(s), b.getT(s) + _n, b.getD(s));
+                }
+            }
+        };
+        if (nthreads <= 1) run(0);
+        else {
+            vector<thread> threads;
+            for (unsigned h = 0; h < nthreads; ++h) threads.push_back(thread(run, h));
+            for (size_t h = 0; h < threads.size(); ++h) threads[h].join();
+        }
+        if (failed) throw RandomTaskSetFactory::Exc(RandomTaskSetFactory::Exc::_LOAD_GEN);
+    }
+
 }
@@ -22,6 +22,8 @@
 
 namespace RTSim {
 
+    class TaskSetBatch;
+
     /** 
         \ingroup util
 
@@ -602,6 +604,58 @@ namespace RTSim {
         virtual bool generate();
     };
 
+    /**
+       \ingroup util
+
+       Generates the parameters of random periodic task sets with
+       the UUniFast algorithm (Bini and Buttazzo): the utilizations
+       of the n tasks are uniformly distributed among the vectors
+       whose sum is u. Utilizations larger than uMax are discarded
+       and drawn again (UUniFast-Discard). The periods are
+       log-uniform in [tMin, tMax], multiples of gcd, the
+       computation times are rounded to the closest tick (at least
+       1), and the deadlines are equal to the periods.
+
+       Unlike the RandomTaskSetFactory, it creates no task and no
+       random variable: the parameters are written in arrays
+       given by the caller, for example those of a TaskSetBatch.
+    */
+    class UUniFastGen {
+        int _n;
+        double _u;
+        double _uMax;
+        Tick _tMin, _tMax, _gcd;
+
+    public:
+        /// Sets generated on each substream by generate(TaskSetBatch&, ...)
+        static const size_t SETS_PER_STREAM;
+        /// Utilization vectors discarded before giving up
+        static const int DISCARD_LIMIT;
+
+        UUniFastGen(int n, double u, Tick tMin, Tick tMax, 
+                    Tick gcd = 1, double uMax = 1);
+
+        /**
+           Generates one set using the numbers of g, and writes the
+           utilizations, computation times and periods of its tasks
+           in u, c and t (n elements each). Returns false if too
+           many utilization vectors have been discarded.
+        */
+        bool generate(RandomGen &g, double *u, Tick *c, Tick *t) const;
+
+        /**
+           Appends nsets task sets to b, generating them on
+           nthreads threads (0 means one per core). The sets are
+           drawn in groups of SETS_PER_STREAM, group j from
+           substream j of g (see RandomGen::substream()), so that
+           the result does not depend on the number of threads.
+           Throws RandomTaskSetFactory::Exc if a set cannot be
+           generated.
+        */
+        void generate(TaskSetBatch &b, size_t nsets, const RandomGen &g,
+                      unsigned nthreads = 0) const;
+    };
+
 } // namespace RTsim 
 
 #endif
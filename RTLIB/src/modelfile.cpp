@@ -0,0 +1,769 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <arena.hpp>
+#include <basestat.hpp>
+#include <factory.hpp>
+#include <simcontext.hpp>
+
+#include <cbserver.hpp>
+#include <cpu.hpp>
+#include <fcfsresmanager.hpp>
+#include <grubserver.hpp>
+#include <jtrace.hpp>
+#include <json_trace.hpp>
+#include <kernel.hpp>
+#include <lighttask.hpp>
+#include <modelfile.hpp>
+#include <mrtkernel.hpp>
+#include <piresman.hpp>
+#include <pollingserver.hpp>
+#include <rttask.hpp>
+#include <sporadicserver.hpp>
+#include <taskprogram.hpp>
+#include <taskstat.hpp>
+#include <texttrace.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace parse_util;
+
+    namespace {
+        ModelArena &arena()
+        {
+            return SimContext::current()->arena();
+        }
+
+        // the next line of text from pos, without the comment
+        substring nextLine(const substring &text, size_t &pos)
+        {
+            size_t end = text.find('\n', pos);
+            if (end == substring::npos) end = text.size();
+            substring line = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            bool quoted = false;
+            for (size_t i = 0; i < line.size(); ++i) {
+                if (line[i] == '"') quoted = !quoted;
+                else if (line[i] == '#' && !quoted) return line.substr(0, i);
+            }
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                return line.substr(0, line.size() - 1);
+            return line;
+        }
+
+        bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+        enum { KW_TASK, KW_LIGHT, KW_KERNEL, KW_SERVER, KW_RESOURCE,
+               KW_CPU, KW_STAT, KW_TRACE, KW_NUM };
+
+        const char *keywords[KW_NUM] = { "task", "light", "kernel", "server",
+                                         "resource", "cpu", "stat", "trace" };
+
+        int keywordOf(const substring &w)
+        {
+            for (int i = 0; i < KW_NUM; ++i)
+                if (w == keywords[i]) return i;
+            return -1;
+        }
+
+        // the image starts with the magic, the version, the hash
+        // and the size of the text, and the name of the file
+        const char MAGIC[8] = { 'R', 'T', 'S', 'I', 'M', 'M', 'D', 'L' };
+        const uint32_t VERSION = 1;
+
+        uint64_t hashOf(const string &text)
+        {
+            // FNV-1a: the same on every run, unlike std::hash
+            uint64_t h = 14695981039346656037ULL;
+            for (size_t i = 0; i < text.size(); ++i) {
+                h ^= (unsigned char) text[i];
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        template <class T>
+        void put(string &out, const T &v)
+        {
+            out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+        }
+
+        void putString(string &out, const substring &s)
+        {
+            put(out, uint32_t(s.size()));
+            out.append(s.data(), s.size());
+        }
+
+        // reads the fields of an image, in place
+        struct Reader {
+            const char *p, *e;
+            const string &name;
+
+            void get(void *v, size_t n)
+            {
+                if (size_t(e - p) < n)
+                    throw ModelFile::Exc(name + " is a damaged image");
+                memcpy(v, p, n);
+                p += n;
+            }
+
+            template <class T>
+            T get()
+            {
+                T v;
+                get(&v, sizeof(T));
+                return v;
+            }
+
+            substring getString()
+            {
+                size_t n = get<uint32_t>();
+                if (size_t(e - p) < n)
+                    throw ModelFile::Exc(name + " is a damaged image");
+                substring s(p, n);
+                p += n;
+                return s;
+            }
+        };
+
+        string readFile(const string &name)
+        {
+            ifstream f(name.c_str(), ios::in | ios::binary);
+            if (!f) throw ModelFile::Exc("cannot open " + name);
+
+            f.seekg(0, ios::end);
+            string text(size_t(f.tellg()), '\0');
+            f.seekg(0, ios::beg);
+            if (!text.empty()) f.read(&text[0], text.size());
+            return text;
+        }
+
+        template <class S>
+        void attachStat(const vector<Task *> &v, const string &name)
+        {
+            S *s = arena().create<S>(name);
+            for (size_t i = 0; i < v.size(); ++i) s->attachToTask(v[i]);
+        }
+
+        template <template <class> class M>
+        void createStat(const substring &type, const vector<Task *> &v,
+                        const string &name)
+        {
+            if (type == "mean") attachStat<M<StatMean> >(v, name);
+            else if (type == "max") attachStat<M<StatMax> >(v, name);
+            else if (type == "min") attachStat<M<StatMin> >(v, name);
+            else throw ModelFile::Exc("unknown stat type " + type.str());
+        }
+    }
+
+    ModelImage::ModelImage(const string &name) :
+        _map(0), _len(0), _copy(), _begin(0), _end(0), _hash(0), _size(0),
+        _source()
+    {
+        const char *base;
+
+#ifndef _WIN32
+        int fd = open(name.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            throw ModelFile::Exc("cannot open " + name);
+        }
+        _len = st.st_size;
+        if (_len < sizeof(MAGIC)) {
+            close(fd);
+            throw ModelFile::Exc(name + " is not a model image");
+        }
+        // private: the pages are shared until someone writes them
+        void *m = mmap(0, _len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) throw ModelFile::Exc("cannot map " + name);
+        _map = m;
+        base = (const char *) m;
+#else
+        ifstream f(name.c_str(), ios::binary);
+        if (!f.is_open()) throw ModelFile::Exc("cannot open " + name);
+        _copy.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+        _len = _copy.size();
+        if (_len < sizeof(MAGIC))
+            throw ModelFile::Exc(name + " is not a model image");
+        base = _copy.data();
+#endif
+
+        Reader r = { base + sizeof(MAGIC), base + _len, name };
+        if (memcmp(base, MAGIC, sizeof(MAGIC)) != 0 ||
+            r.get<uint32_t>() != VERSION) {
+#ifndef _WIN32
+            munmap(_map, _len);
+#endif
+            throw ModelFile::Exc(name + " is not a model image");
+        }
+        _hash = r.get<uint64_t>();
+        _size = r.get<uint64_t>();
+        r.getString().assign_to(_source);
+        _begin = r.p;
+        _end = r.e;
+    }
+
+    ModelImage::~ModelImage()
+    {
+#ifndef _WIN32
+        if (_map != 0) munmap(_map, _len);
+#endif
+    }
+
+    bool ModelImage::matches(const string &text) const
+    {
+        return _size == text.size() && _hash == hashOf(text);
+    }
+
+    ModelFile::ModelFile() :
+        _kernels(), _resman(), _grubs(), _servers(), _cpus(), _taskNames(),
+        _tasks(), _lights(), _where(), _line(0), _attrs(), _key(),
+        _record(false), _image()
+    {
+    }
+
+    ModelFile::~ModelFile()
+    {
+    }
+
+    void ModelFile::error(const string &msg) const
+    {
+        stringstream ss;
+        ss << _where << ":" << _line << ": " << msg;
+        throw Exc(ss.str());
+    }
+
+    void ModelFile::rethrow() const
+    {
+        try {
+            throw;
+        }
+        catch (Exc &) {
+            throw;
+        }
+        catch (BaseExc &e) {
+            error(e.what());
+        }
+        catch (ParseExc &e) {
+            error(e.what());
+        }
+    }
+
+    void ModelFile::load(const string &name)
+    {
+        parse(readFile(name), name);
+    }
+
+    void ModelFile::load(const string &name, const string &image)
+    {
+        string text = readFile(name);
+
+        unique_ptr<ModelImage> img;
+        try {
+            img.reset(new ModelImage(image));
+        }
+        catch (Exc &) {
+            // missing or stale: written again below
+        }
+        if (img && img->matches(text)) {
+            build(*img);
+            return;
+        }
+        img.reset();
+
+        bool rec = _record;
+        _record = true;
+        try {
+            parse(text, name);
+        }
+        catch (...) {
+            _record = rec;
+            throw;
+        }
+        _record = rec;
+        saveImage(image);
+    }
+
+    void ModelFile::parse(const string &text, const string &where)
+    {
+        substring all(text);
+        vector<substring> words;
+
+        _where = where;
+        _line = 0;
+        if (_record) beginImage(text, where);
+        else _image.clear();
+
+        size_t pos = 0;
+        while (pos < all.size()) {
+            substring line = nextLine(all, pos);
+            ++_line;
+
+            tokenize(line, words);
+            if (words.empty()) continue;
+            if (words.size() < 2) error("missing name after " + words[0].str());
+
+            int kw = keywordOf(words[0]);
+            if (kw < 0) error("unknown keyword " + words[0].str());
+            if (_record) recordLine(kw, words[1]);
+
+            try {
+                if (kw == KW_LIGHT) pos = parseLight(words[1], all, pos);
+                else declare(kw, words[1]);
+            }
+            catch (...) {
+                rethrow();
+            }
+        }
+    }
+
+    void ModelFile::build(const ModelImage &image)
+    {
+        Reader r = { image.begin(), image.end(), image.getSource() };
+
+        _where = image.getSource();
+        _line = 0;
+        _image.clear();
+
+        vector<Tick> cols[4];
+        while (r.p < r.e) {
+            int kw = r.get<uint8_t>();
+            _line = r.get<uint32_t>();
+            substring name = r.getString();
+            size_t n = r.get<uint32_t>();
+            _attrs.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                _attrs[i].key = r.getString();
+                _attrs[i].value = r.getString();
+            }
+            if (kw >= KW_NUM) throw Exc(image.getSource() + " is a damaged image");
+
+            try {
+                if (kw != KW_LIGHT) {
+                    declare(kw, name);
+                    continue;
+                }
+
+                RTKernel *k = lookup(_kernels, required("kernel"), "kernel");
+                string param = attr("param").str();
+                _line = r.get<uint32_t>();
+                n = r.get<uint64_t>();
+                for (int c = 0; c < 4; ++c) {
+                    cols[c].resize(n);
+                    for (size_t i = 0; i < n; ++i)
+                        cols[c][i] = Tick(r.get<Tick::impl_t>());
+                }
+                buildLight(name, k, param, cols);
+            }
+            catch (...) {
+                rethrow();
+            }
+        }
+    }
+
+    void ModelFile::declare(int kw, const substring &name)
+    {
+        switch (kw) {
+        case KW_TASK: parseTask(name); break;
+        case KW_KERNEL: parseKernel(name); break;
+        case KW_SERVER: parseServer(name); break;
+        case KW_RESOURCE: parseResource(name); break;
+        case KW_CPU: parseCPU(name); break;
+        case KW_STAT: parseStat(name); break;
+        case KW_TRACE: parseTrace(name); break;
+        }
+    }
+
+    void ModelFile::beginImage(const string &text, const string &where)
+    {
+        _image.clear();
+        _image.append(MAGIC, sizeof(MAGIC));
+        put(_image, VERSION);
+        put(_image, hashOf(text));
+        put(_image, uint64_t(text.size()));
+        putString(_image, where);
+    }
+
+    void ModelFile::recordLine(int kw, const substring &name)
+    {
+        put(_image, uint8_t(kw));
+        put(_image, uint32_t(_line));
+        putString(_image, name);
+        put(_image, uint32_t(_attrs.size()));
+        for (size_t i = 0; i < _attrs.size(); ++i) {
+            putString(_image, _attrs[i].key);
+            putString(_image, _attrs[i].value);
+        }
+    }
+
+    void ModelFile::recordLight(const vector<Tick> cols[4])
+    {
+        put(_image, uint32_t(_line));
+        put(_image, uint64_t(cols[0].size()));
+        for (int c = 0; c < 4; ++c)
+            for (size_t i = 0; i < cols[c].size(); ++i)
+                put(_image, Tick::impl_t(cols[c][i]));
+    }
+
+    void ModelFile::saveImage(const string &name) const
+    {
+        if (_image.empty()) throw Exc("no image recorded");
+
+        // written aside and renamed, so that a reader never sees
+        // half an image
+        string tmp = name + ".tmp";
+        {
+            ofstream f(tmp.c_str(), ios::out | ios::binary | ios::trunc);
+            if (!f) throw Exc("cannot write " + tmp);
+            f.write(_image.data(), _image.size());
+            if (!f) throw Exc("cannot write " + tmp);
+        }
+        if (rename(tmp.c_str(), name.c_str()) != 0)
+            throw Exc("cannot write " + name);
+    }
+
+    void ModelFile::tokenize(const substring &line, vector<substring> &words)
+    {
+        words.clear();
+        _attrs.clear();
+
+        size_t i = 0, n = line.size();
+        while (true) {
+            while (i < n && isSpace(line[i])) ++i;
+            if (i == n) break;
+
+            size_t b = i;
+            size_t eq = substring::npos;
+            bool quoted = false;
+            while (i < n && (quoted || !isSpace(line[i]))) {
+                if (line[i] == '"') quoted = !quoted;
+                else if (line[i] == '=' && eq == substring::npos && !quoted) eq = i;
+                ++i;
+            }
+            if (quoted) error("unterminated quote");
+
+            if (eq == substring::npos) {
+                // a bare word: the keyword, the name, or a flag
+                if (words.size() < 2) words.push_back(line.substr(b, i - b));
+                else {
+                    Attr a = { line.substr(b, i - b), substring() };
+                    _attrs.push_back(a);
+                }
+                continue;
+            }
+
+            Attr a = { line.substr(b, eq - b), line.substr(eq + 1, i - eq - 1) };
+            if (a.value.size() >= 2 && a.value[0] == '"')
+                a.value = a.value.substr(1, a.value.size() - 2);
+            _attrs.push_back(a);
+        }
+    }
+
+    ModelFile::substring ModelFile::attr(const char *key, const substring &def) const
+    {
+        substring k(key);
+        for (size_t i = 0; i < _attrs.size(); ++i)
+            if (_attrs[i].key == k) return _attrs[i].value;
+        return def;
+    }
+
+    bool ModelFile::has(const char *key) const
+    {
+        substring k(key);
+        for (size_t i = 0; i < _attrs.size(); ++i)
+            if (_attrs[i].key == k) return true;
+        return false;
+    }
+
+    ModelFile::substring ModelFile::required(const char *key) const
+    {
+        if (!has(key)) error(string("missing attribute ") + key);
+        return attr(key);
+    }
+
+    Tick ModelFile::tick(const char *key, const Tick &def) const
+    {
+        if (!has(key)) return def;
+        return Tick::parse(attr(key));
+    }
+
+    template <class T>
+    T *ModelFile::lookup(const unordered_map<string, T *> &m,
+                         const substring &name, const char *what)
+    {
+        name.assign_to(_key);
+        typename unordered_map<string, T *>::const_iterator i = m.find(_key);
+        if (i == m.end()) error(string("unknown ") + what + " " + _key);
+        return i->second;
+    }
+
+    RTKernel *ModelFile::getKernel(const string &name) const
+    {
+        unordered_map<string, RTKernel *>::const_iterator i = _kernels.find(name);
+        return i != _kernels.end() ? i->second : NULL;
+    }
+
+    Server *ModelFile::getServer(const string &name) const
+    {
+        unordered_map<string, Server *>::const_iterator i = _servers.find(name);
+        return i != _servers.end() ? i->second : NULL;
+    }
+
+    CPU *ModelFile::getCPU(const string &name) const
+    {
+        unordered_map<string, CPU *>::const_iterator i = _cpus.find(name);
+        return i != _cpus.end() ? i->second : NULL;
+    }
+
+    void ModelFile::parseCPU(const substring &name)
+    {
+        vector<substring> levels;
+        split(required("levels"), ",", levels);
+
+        vector<double> V(levels.size());
+        vector<int> F(levels.size());
+        for (size_t i = 0; i < levels.size(); ++i) {
+            size_t c = levels[i].find(':');
+            if (c == substring::npos) error("a level must be voltage:frequency");
+            V[i] = atof(levels[i].substr(0, c).str().c_str());
+            F[i] = atoi(levels[i].substr(c + 1).str().c_str());
+        }
+
+        _cpus[name.str()] = arena().create<CPU>(name.str(), int(V.size()),
+                                                &V[0], &F[0]);
+    }
+
+    void ModelFile::parseKernel(const substring &name)
+    {
+        substring s = required("sched");
+        vector<substring> pv;
+        split_param(param_of(s), pv);
+        vector<string> p;
+        assign(pv, p);
+
+        unique_ptr<Scheduler> sp = FACT(Scheduler).create(token_of(s).str(), p);
+        if (!sp) error("unknown scheduler " + s.str());
+        Scheduler *sched = sp.get();
+        // owned by the arena, destroyed after the kernel
+        arena().create<unique_ptr<Scheduler> >(std::move(sp));
+
+        RTKernel *k;
+        substring cpus = attr("cpus");
+        if (cpus.empty()) {
+            CPU *c = has("cpu") ? lookup(_cpus, attr("cpu"), "cpu") : NULL;
+            k = arena().create<RTKernel>(sched, name.str(), c);
+        }
+        else if (isdigit(cpus[0])) {
+            k = arena().create<MRTKernel>(sched, atoi(cpus.str().c_str()),
+                                          name.str());
+        }
+        else {
+            MRTKernel *m = arena().create<MRTKernel>(sched, name.str());
+            vector<substring> v;
+            split(cpus, ",", v);
+            for (size_t i = 0; i < v.size(); ++i)
+                m->addCPU(lookup(_cpus, v[i], "cpu"));
+            k = m;
+        }
+        _kernels[name.str()] = k;
+
+        substring rm = attr("resman");
+        if (rm.empty()) return;
+
+        ResManager *r;
+        if (rm == "fcfs") r = arena().create<FCFSResManager>();
+        else if (rm == "pi") r = arena().create<PIRManager>();
+        else error("unknown resource manager " + rm.str());
+        k->setResManager(r);
+        _resman[name.str()] = r;
+    }
+
+    void ModelFile::parseResource(const substring &name)
+    {
+        ResManager *r = lookup(_resman, required("kernel"), "resource manager of");
+        substring units = attr("units", "1");
+        r->addResource(name.str(), atoi(units.str().c_str()));
+    }
+
+    void ModelFile::parseServer(const substring &name)
+    {
+        substring type = required("type");
+        string kname = required("kernel").str();
+        RTKernel *k = lookup(_kernels, kname, "kernel");
+        Tick q = Tick::parse(required("budget"));
+        Tick p = Tick::parse(required("period"));
+        string sched = attr("sched", "FIFOSched").str();
+
+        Server *s;
+        if (type == "cbs")
+            s = arena().create<CBServer>(q, p, tick("deadline", p), !has("soft"),
+                                         name.str(), sched);
+        else if (type == "polling")
+            s = arena().create<PollingServer>(q, p, name.str(), sched);
+        else if (type == "sporadic")
+            s = arena().create<SporadicServer>(q, p, name.str(), sched);
+        else if (type == "grub") {
+            Grub *g = arena().create<Grub>(q, p, name.str(), sched);
+            GrubSupervisor *&sup = _grubs[kname];
+            if (sup == NULL) sup = arena().create<GrubSupervisor>();
+            sup->addGrub(g);
+            s = g;
+        }
+        else error("unknown server type " + type.str());
+
+        k->addTask(*s, attr("param").str());
+        _servers[name.str()] = s;
+    }
+
+    void ModelFile::parseTask(const substring &name)
+    {
+        Tick period = Tick::parse(required("period"));
+        long qs = has("queue") ? atol(attr("queue").str().c_str()) : 100;
+
+        PeriodicTask *t = arena().create<PeriodicTask>(period, tick("deadline", period),
+                                                       tick("offset", 0),
+                                                       name.str(), qs);
+
+        // the tasks with the same code share the program
+        required("code").assign_to(_key);
+        t->insertCode(TaskProgram::get(_key));
+
+        if (has("server"))
+            lookup(_servers, attr("server"), "server")->addTask(*t, attr("param").str());
+        else
+            lookup(_kernels, required("kernel"), "kernel")->addTask(*t, attr("param").str());
+
+        _tasks.push_back(t);
+        _taskNames[t->getName()] = t;
+    }
+
+    size_t ModelFile::parseLight(const substring &name, const substring &text,
+                                 size_t pos)
+    {
+        RTKernel *k = lookup(_kernels, required("kernel"), "kernel");
+        string param = attr("param").str();
+
+        // period, wcet, deadline and offset of each task
+        vector<Tick> cols[4];
+
+        while (true) {
+            if (pos >= text.size()) error("light without end");
+            substring line = nextLine(text, pos);
+            ++_line;
+
+            size_t n = 0, i = 0;
+            while (true) {
+                while (i < line.size() && isSpace(line[i])) ++i;
+                if (i == line.size()) break;
+                size_t b = i;
+                while (i < line.size() && !isSpace(line[i])) ++i;
+                substring w = line.substr(b, i - b);
+
+                if (n == 0 && w == "end") {
+                    if (_record) recordLight(cols);
+                    buildLight(name, k, param, cols);
+                    return pos;
+                }
+                if (n == 4) error("too many values for a light task");
+                cols[n++].push_back(Tick::parse(w));
+            }
+            if (n == 0) continue;
+            if (n < 2) error("a light task needs period and wcet");
+            for (; n < 4; ++n)
+                cols[n].push_back(n == 2 ? cols[0].back() : Tick(0));
+        }
+    }
+
+    void ModelFile::buildLight(const substring &name, RTKernel *k,
+                               const string &param, vector<Tick> cols[4])
+    {
+        int threads = has("threads") ? atoi(attr("threads").str().c_str()) : 1;
+        LightTaskSet *set = arena().create<LightTaskSet>(cols[0], cols[1], cols[2],
+                                                         cols[3], name.str(), threads);
+        set->addTo(*k, param);
+        _lights.push_back(set);
+    }
+
+    void ModelFile::tasksOf(const substring &list, vector<Task *> &out)
+    {
+        out.clear();
+        if (list == "*") {
+            out = _tasks;
+            return;
+        }
+
+        vector<substring> v;
+        split(list, ",", v);
+        for (size_t i = 0; i < v.size(); ++i)
+            out.push_back(lookup(_taskNames, v[i], "task"));
+    }
+
+    void ModelFile::parseStat(const substring &name)
+    {
+        vector<Task *> v;
+        tasksOf(attr("tasks", "*"), v);
+
+        substring m = required("measure");
+        substring type = attr("type", "mean");
+        string n = name.str();
+
+        if (m == "finish") createStat<FinishingTimeStat>(type, v, n);
+        else if (m == "lateness") createStat<LatenessStat>(type, v, n);
+        else if (m == "tardiness") createStat<TardinessStat>(type, v, n);
+        else if (m == "preemption") createStat<PreemptionStat>(type, v, n);
+        else error("unknown measure " + m.str());
+    }
+
+    void ModelFile::parseTrace(const substring &name)
+    {
+        vector<Task *> v;
+        tasksOf(attr("tasks", "*"), v);
+
+        string file = attr("file", name).str();
+        substring type = attr("type", "text");
+
+        if (type == "text") {
+            TextTrace *t = arena().create<TextTrace>(file);
+            for (size_t i = 0; i < v.size(); ++i) t->attachToTask(v[i]);
+        }
+        else if (type == "json") {
+            JSONTrace *t = arena().create<JSONTrace>(file);
+            for (size_t i = 0; i < v.size(); ++i) t->attachToTask(v[i]);
+        }
+        else if (type == "java") {
+            JavaTrace *t = arena().create<JavaTrace>(file.c_str());
+            for (size_t i = 0; i < v.size(); ++i) v[i]->setTrace(t);
+        }
+        else error("unknown trace type " + type.str());
+    }
+
+} // namespace RTSim
@@ -0,0 +1,284 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __MODELFILE_HPP__
+#define __MODELFILE_HPP__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <strtoken.hpp>
+#include <tick.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    class CPU;
+    class GrubSupervisor;
+    class LightTaskSet;
+    class ResManager;
+    class RTKernel;
+    class Server;
+    class Task;
+
+    /**
+       \ingroup util
+
+       The image of a model file: its declarations, already split
+       in words and attributes, and the light task sets already
+       converted to ticks, so that building the model does not
+       parse any text (see ModelFile::saveImage()).
+
+       The image is mapped read-only in memory (with mmap(), where
+       available; otherwise it is read as a whole), and it is not
+       modified while a model is built: the threads of a Campaign
+       can share the same image, each building its own model in
+       its own SimContext. It is a startup artifact, written in the
+       byte order of the machine, and not a snapshot of a running
+       simulation (see Simulation::checkpoint()).
+    */
+    class ModelImage {
+    public:
+        ModelImage(const std::string &name);
+
+        ~ModelImage();
+
+        /// True if the image was built from text
+        bool matches(const std::string &text) const;
+
+        /// The name of the file it was built from
+        const std::string &getSource() const { return _source; }
+
+        const char *begin() const { return _begin; }
+        const char *end() const { return _end; }
+
+    private:
+        void *_map;
+        size_t _len;
+        std::string _copy;
+        const char *_begin, *_end;
+        uint64_t _hash;
+        uint64_t _size;
+        std::string _source;
+
+        ModelImage(const ModelImage &);
+        ModelImage &operator=(const ModelImage &);
+    };
+
+    /**
+       \ingroup util
+
+       Builds a model from a text description, in a single pass,
+       so that a different topology does not need a rebuild. All
+       the objects are created in the arena of the current
+       SimContext (see ModelArena), which owns them.
+
+       Every line declares an object: a keyword, a name, and a
+       list of attributes key=value (the values with spaces are
+       quoted). Everything after a # is a comment. An object must
+       be declared before it is used.
+
+       <pre>
+       cpu c0 levels=1.0:500,1.3:1000
+       kernel k sched=EDFSched cpu=c0 resman=pi
+       kernel m sched=FPSched cpus=4
+       resource R kernel=k units=1
+       server s type=cbs budget=2 period=10 kernel=k sched=FIFOSched
+       task t1 period=10 deadline=10 offset=0 kernel=k code="fixed(2);wait(R);fixed(1);signal(R);"
+       task t2 period=20 server=s code="delay(unif(1,3));"
+       light l kernel=m param=5
+         100 10        # period wcet [deadline [offset]]
+         200 20 150
+       end
+       stat ft measure=finish type=mean tasks=t1,t2
+       trace tr file=trace.txt type=text tasks=*
+       </pre>
+
+       - cpu: a processor with its power levels (voltage:frequency);
+       - kernel: a RTKernel, on the processor cpu=, or a
+         MRTKernel with cpus= processors (a number, or a list of
+         names); sched= is the name of a scheduler in the factory,
+         with its parameters (e.g. RRSched(10)); resman= (fcfs or
+         pi) sets a resource manager;
+       - resource: a resource of the manager of a kernel;
+       - server: a cbs, polling, sporadic or grub server, added
+         to a kernel (param= is passed to Kernel::addTask());
+       - task: a PeriodicTask, added to a kernel or to a server;
+         the tasks with the same code share the parsed program
+         (see TaskProgram);
+       - light: a block of LightTask objects, built in bulk (see
+         LightTaskSet) and named <name>0, <name>1, ...; with
+         threads=, they are constructed in parallel;
+       - stat: a measure (finish, lateness, tardiness or
+         preemption) of type mean, max or min, on a list of tasks
+         (* for all);
+       - trace: a trace (text, java or json) of a list of tasks,
+         in file= (by default, the name of the trace).
+
+       The times can have a unit (e.g. 10ms), as in Tick(const
+       std::string &).
+
+       The image of a large file can be saved and used instead of
+       the file at the next startup (see ModelImage):
+
+       <pre>
+       ModelFile m;
+       m.load("model.txt", "model.img");  // parses model.txt only if it changed
+       </pre>
+    */
+    class ModelFile {
+    public:
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "ModelFile", "modelfile.cpp") {}
+        };
+
+        ModelFile();
+
+        ~ModelFile();
+
+        /**
+           Reads the file name at once, and builds the model.
+
+           @throws Exc on the first error, with its line
+        */
+        void load(const std::string &name);
+
+        /**
+           Builds the model described by text. where is the name
+           used in the error messages.
+
+           @throws Exc on the first error, with its line
+        */
+        void parse(const std::string &text, const std::string &where = "");
+
+        /**
+           As load(name), using the image file as a cache: if it
+           was built from the current content of name, the model
+           is built from the image; otherwise, name is parsed and
+           the image is written again.
+        */
+        void load(const std::string &name, const std::string &image);
+
+        /// Builds the model from an image
+        void build(const ModelImage &image);
+
+        /**
+           Records the image of the models parsed from now on
+           (see saveImage()).
+        */
+        void recordImage(bool on = true) { _record = on; }
+
+        /**
+           Writes the image of the last model parsed with
+           recordImage() on.
+
+           @throws Exc if there is none, or on a write error
+        */
+        void saveImage(const std::string &name) const;
+
+        /// The kernel called name (NULL if there is none)
+        RTKernel *getKernel(const std::string &name) const;
+
+        /// The server called name (NULL if there is none)
+        Server *getServer(const std::string &name) const;
+
+        /// The processor called name (NULL if there is none)
+        CPU *getCPU(const std::string &name) const;
+
+        /// The tasks, in order of declaration
+        const std::vector<Task *> &getTasks() const { return _tasks; }
+
+        /// The light task sets, in order of declaration
+        const std::vector<LightTaskSet *> &getLightTaskSets() const { return _lights; }
+
+    private:
+        typedef parse_util::substring substring;
+
+        struct Attr {
+            substring key;
+            substring value;
+        };
+
+        std::unordered_map<std::string, RTKernel *> _kernels;
+        std::unordered_map<std::string, ResManager *> _resman;
+        std::unordered_map<std::string, GrubSupervisor *> _grubs;
+        std::unordered_map<std::string, Server *> _servers;
+        std::unordered_map<std::string, CPU *> _cpus;
+        std::unordered_map<std::string, Task *> _taskNames;
+        std::vector<Task *> _tasks;
+        std::vector<LightTaskSet *> _lights;
+
+        // where and line of the current line, for the errors
+        std::string _where;
+        int _line;
+
+        // reused from one line to the next
+        std::vector<Attr> _attrs;
+        std::string _key;
+
+        bool _record;
+        std::string _image;
+
+        ModelFile(const ModelFile &);
+        ModelFile &operator=(const ModelFile &);
+
+        void error(const std::string &msg) const;
+
+        /// Rethrows the current exception as an Exc, with the line
+        void rethrow() const;
+
+        /// Builds the object declared with keyword kw
+        void declare(int kw, const substring &name);
+
+        /// Splits a line in words and attributes
+        void tokenize(const substring &line, std::vector<substring> &words);
+
+        /// The value of attribute key, def if there is none
+        substring attr(const char *key, const substring &def = substring()) const;
+        substring required(const char *key) const;
+        bool has(const char *key) const;
+        Tick tick(const char *key, const Tick &def) const;
+
+        template <class T>
+        T *lookup(const std::unordered_map<std::string, T *> &m,
+                  const substring &name, const char *what);
+
+        void parseCPU(const substring &name);
+        void parseKernel(const substring &name);
+        void parseResource(const substring &name);
+        void parseServer(const substring &name);
+        void parseTask(const substring &name);
+        void parseStat(const substring &name);
+        void parseTrace(const substring &name);
+        void tasksOf(const substring &list, std::vector<Task *> &out);
+
+        /// Parses a light block, from the line after its header
+        size_t parseLight(const substring &name, const substring &text,
+                          size_t pos);
+        void buildLight(const substring &name, RTKernel *k,
+                        const std::string &param, std::vector<Tick> cols[4]);
+
+        void beginImage(const std::string &text, const std::string &where);
+        void recordLine(int kw, const substring &name);
+        void recordLight(const std::vector<Tick> cols[4]);
+    };
+
+} // namespace RTSim
+
+#endif
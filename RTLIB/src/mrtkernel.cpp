@@ -26,13 +26,6 @@ namespace RTSim {
     using namespace std;
     using namespace MetaSim;
 
-    template<class IT>
-    void clean_mapcontainer(IT b, IT e)
-    {
-        for (IT i=b; i!=e; i++) delete i->second;
-    }
-
-
     BeginDispatchMultiEvt::BeginDispatchMultiEvt(MRTKernel &k, CPU &c)
         : Event(Event::_DEFAULT_PRIORITY + 10), 
           _kernel(k),
@@ -61,66 +54,229 @@ namespace RTSim {
 
     vector<CPU*> MRTKernel::getProcessors() const
     {
-        vector<CPU*> s;// = new vector<const CPU*>;
+        vector<CPU*> s;
 
-        typedef map<CPU *, AbsRTTask *>::const_iterator IT;
-        int j = 0;
-
-        for(IT i = _m_currExe.begin(); i != _m_currExe.end(); i++, j++)
-            s[j] = i->first;
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            s.push_back(_cpus[i].cpu);
         return s;
     }
 
-    CPU *MRTKernel::getFreeProcessor()
+    MRTKernel::CPUState *MRTKernel::cpuState(const CPU *c)
     {
-        for(ITCPU i=_m_currExe.begin(); i!=_m_currExe.end(); i++)
-            if (i->second == NULL) return i->first;
+        size_t idx = c->getIndex();
+        if (idx < _cpus.size() && _cpus[idx].cpu == c) return &_cpus[idx];
+
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            if (_cpus[i].cpu == c) return &_cpus[i];
         return NULL;
     }
 
+    const MRTKernel::CPUState *MRTKernel::cpuState(const CPU *c) const
+    {
+        return const_cast<MRTKernel *>(this)->cpuState(c);
+    }
 
-    bool MRTKernel::isDispatched(CPU *p)
+    MRTKernel::TaskState &MRTKernel::taskState(const AbsRTTask *t)
     {
-        map<const AbsRTTask *, CPU *>::iterator j = _m_dispatched.begin();
+        unordered_map<const AbsRTTask *, size_t>::iterator i =
+            _taskSlot.find(t);
+        if (i != _taskSlot.end()) return _tasks[i->second];
+
+        TaskState ts = { NULL, NULL, NULL };
+        _taskSlot[t] = _tasks.size();
+        _tasks.push_back(ts);
+        return _tasks.back();
+    }
 
-        for (; j !=_m_dispatched.end(); ++j ) 
-            if (j->second == p) return true;
+    const MRTKernel::TaskState *
+    MRTKernel::findTaskState(const AbsRTTask *t) const
+    {
+        unordered_map<const AbsRTTask *, size_t>::const_iterator i =
+            _taskSlot.find(t);
+        if (i == _taskSlot.end()) return NULL;
+        return &_tasks[i->second];
+    }
 
-        return false;
+    void MRTKernel::setCurrExe(CPUState &c, AbsRTTask *t)
+    {
+        if (c.currExe != NULL) {
+            TaskState &old = taskState(c.currExe);
+            if (old.exec == c.cpu) old.exec = NULL;
+        }
+        c.currExe = t;
+        if (t != NULL) taskState(t).exec = c.cpu;
     }
 
-    MRTKernel::ITCPU MRTKernel::getNextFreeProc(ITCPU s, ITCPU e)
+    void MRTKernel::setDispatched(const AbsRTTask *t, CPU *p)
     {
-        for (ITCPU i=s; i!=e; ++i) 
-            if (i->second == NULL && !isDispatched(i->first)) return i;
+        TaskState &ts = taskState(t);
+        if (ts.dispatched == p) return;
 
-        return e;
+        if (ts.dispatched != NULL) {
+            CPUState *o = cpuState(ts.dispatched);
+            o->dispatched = NULL;
+            heapFix(o - &_cpus[0]);
+        }
+        ts.dispatched = p;
+        if (p != NULL) {
+            CPUState *c = cpuState(p);
+            // a processor holds one dispatched task at most
+            if (c->dispatched != NULL) taskState(c->dispatched).dispatched = NULL;
+            c->dispatched = const_cast<AbsRTTask *>(t);
+            heapFix(c - &_cpus[0]);
+        }
     }
 
+    void MRTKernel::extractTask(AbsRTTask *t)
+    {
+        bool valid = (_sched->getExtractCount() == _heapStamp);
+        _sched->extract(t);
+        if (valid) _heapStamp = _sched->getExtractCount();
+    }
 
+    bool MRTKernel::heapBefore(size_t a, size_t b)
+    {
+        AbsRTTask *ta = _cpus[a].dispatched;
+        AbsRTTask *tb = _cpus[b].dispatched;
 
-    void MRTKernel::internalConstructor(int n)
+        if (ta == NULL || tb == NULL) {
+            if (ta == tb) return a < b;
+            return ta == NULL;
+        }
+        return _sched->higherPriority(tb, ta);
+    }
+
+    void MRTKernel::heapSwap(int i, int j)
     {
-        for(int i=0; i<n; i++)  {
-            CPU *c = _CPUFactory->createCPU();
-            _m_currExe[c] = NULL;
-            _isContextSwitching[c] = false;
-            _beginEvt[c] = new BeginDispatchMultiEvt(*this, *c);
-            _endEvt[c] = new EndDispatchMultiEvt(*this, *c);
+        swap(_heap[i], _heap[j]);
+        _cpus[_heap[i]].heapPos = i;
+        _cpus[_heap[j]].heapPos = j;
+    }
+
+    void MRTKernel::heapUp(int i)
+    {
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!heapBefore(_heap[i], _heap[parent])) break;
+            heapSwap(i, parent);
+            i = parent;
         }
+    }
+
+    void MRTKernel::heapDown(int i)
+    {
+        int n = _heap.size();
+        for (;;) {
+            int m = i;
+            int l = 2 * i + 1, r = 2 * i + 2;
+            if (l < n && heapBefore(_heap[l], _heap[m])) m = l;
+            if (r < n && heapBefore(_heap[r], _heap[m])) m = r;
+            if (m == i) break;
+            heapSwap(i, m);
+            i = m;
+        }
+    }
+
+    void MRTKernel::heapPush(size_t c)
+    {
+        if (_cpus[c].heapPos >= 0) return;
+        _cpus[c].heapPos = _heap.size();
+        _heap.push_back(c);
+        heapUp(_cpus[c].heapPos);
+    }
+
+    void MRTKernel::heapRemove(size_t c)
+    {
+        int i = _cpus[c].heapPos;
+        if (i < 0) return;
+
+        int last = _heap.size() - 1;
+        if (i != last) heapSwap(i, last);
+        _heap.pop_back();
+        _cpus[c].heapPos = -1;
+        if (i != last) {
+            heapUp(i);
+            heapDown(_cpus[_heap[i]].heapPos);
+        }
+    }
+
+    void MRTKernel::heapFix(size_t c)
+    {
+        int i = _cpus[c].heapPos;
+        if (i < 0) return;
+        heapUp(i);
+        heapDown(_cpus[c].heapPos);
+    }
+
+    void MRTKernel::heapCheck()
+    {
+        // if someone else took a task out of the queue (to
+        // change its priority, for example) the keys may be stale
+        if (_sched->getExtractCount() != _heapStamp) heapRebuild();
+    }
+
+    void MRTKernel::heapRebuild()
+    {
+        _heap.clear();
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            _cpus[i].heapPos = -1;
+            if (!_cpus[i].pending) {
+                _cpus[i].heapPos = _heap.size();
+                _heap.push_back(i);
+            }
+        }
+        for (int i = int(_heap.size()) / 2 - 1; i >= 0; --i) heapDown(i);
+        _heapStamp = _sched->getExtractCount();
+    }
+
+    CPU *MRTKernel::getFreeProcessor()
+    {
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            if (_cpus[i].currExe == NULL) return _cpus[i].cpu;
+        return NULL;
+    }
+
+
+    bool MRTKernel::isDispatched(CPU *p)
+    {
+        CPUState *c = cpuState(p);
+        return c != NULL && c->dispatched != NULL;
+    }
+
+    void MRTKernel::newCPUState(CPU *c)
+    {
+        CPUState cs;
+        cs.cpu = c;
+        cs.currExe = NULL;
+        cs.dispatched = NULL;
+        cs.isContextSwitching = false;
+        cs.pending = false;
+        cs.heapPos = -1;
+        cs.beginEvt = new BeginDispatchMultiEvt(*this, *c);
+        cs.endEvt = new EndDispatchMultiEvt(*this, *c);
+        _cpus.push_back(cs);
+        heapPush(_cpus.size() - 1);
+    }
+
+    void MRTKernel::internalConstructor(int n)
+    {
+        for(int i=0; i<n; i++)  
+            newCPUState(_CPUFactory->createCPU());
 
         _sched->setKernel(this);
     }
 
     MRTKernel::MRTKernel(Scheduler *s, absCPUFactory *fact, int n, 
                          const string& name) 
-        : RTKernel(s,name) , _CPUFactory(fact), _migrationDelay(0)
+        : RTKernel(s,name) , _CPUFactory(fact), _pending(0), _heapStamp(0),
+          _migrationDelay(0)
     { 
         internalConstructor(n);
     }
 
     MRTKernel::MRTKernel(Scheduler *s, int n, const string&name) 
-        : RTKernel(s, name), _migrationDelay(0)
+        : RTKernel(s, name), _pending(0), _heapStamp(0),
+          _migrationDelay(0)
     { 
         _CPUFactory = new uniformCPUFactory();
 
@@ -128,7 +284,8 @@ namespace RTSim {
     }
 
     MRTKernel::MRTKernel(Scheduler *s, const string& name) 
-        : RTKernel(s, name), _migrationDelay(0)
+        : RTKernel(s, name), _pending(0), _heapStamp(0),
+          _migrationDelay(0)
     {
         _CPUFactory = new uniformCPUFactory();
 
@@ -138,61 +295,67 @@ namespace RTSim {
     MRTKernel::~MRTKernel()
     {
         delete _CPUFactory;
-        clean_mapcontainer(_beginEvt.begin(), _beginEvt.end());
-        clean_mapcontainer(_endEvt.begin(), _endEvt.end());
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            delete _cpus[i].beginEvt;
+            delete _cpus[i].endEvt;
+        }
     }
 
     void MRTKernel::addCPU(CPU *c) 
     { 
         DBGENTER(_KERNEL_DBG_LEV);
-        _m_currExe[c] = NULL; 
-        _isContextSwitching[c] = false;
-        _beginEvt[c] = new BeginDispatchMultiEvt(*this, *c);
-        _endEvt[c] = new EndDispatchMultiEvt(*this, *c);
+        newCPUState(c);
     }
     
     void MRTKernel::addTask(AbsRTTask &t, const string &param)
     {
         RTKernel::addTask(t, param);
-        _m_oldExe[&t] = NULL;
-        _m_dispatched[&t] = NULL;
+        taskState(&t).oldExe = NULL;
+        setDispatched(&t, NULL);
+    }
+
+    void MRTKernel::reserveTasks(size_t n)
+    {
+        RTKernel::reserveTasks(n);
+        _tasks.reserve(_tasks.size() + n);
+        _taskSlot.reserve(_taskSlot.size() + n);
+    }
+
+    void MRTKernel::removeTask(AbsRTTask &t)
+    {
+        RTKernel::removeTask(t);
+        taskState(&t).oldExe = NULL;
+        setDispatched(&t, NULL);
     }
 
     CPU *MRTKernel::getProcessor(const AbsRTTask *t) const
-   {
+    {
         DBGENTER(_KERNEL_DBG_LEV);
-        CPU* ret = NULL;
 
-        typedef  map<CPU*, AbsRTTask*>::const_iterator IT;
- 
-        for (IT i = _m_currExe.begin(); i != _m_currExe.end(); i++)
-            if (i->second == t) ret = i->first;
-        return ret;
+        const TaskState *ts = findTaskState(t);
+        return ts != NULL ? ts->exec : NULL;
     }
 
     CPU* MRTKernel::getOldProcessor(const AbsRTTask* t) const
     {
-        CPU *ret = NULL;
-
         DBGENTER(_KERNEL_DBG_LEV);
 
-        ret = _m_oldExe.find(t)->second;
-        
-        return ret;
+        const TaskState *ts = findTaskState(t);
+        return ts != NULL ? ts->oldExe : NULL;
     }
 
     void MRTKernel::suspend(AbsRTTask *task)
     {
         DBGENTER(_MRTKERNEL_DBG_LEV);
 
-        _sched->extract(task);
+        extractTask(task);
         CPU *p = getProcessor(task);
         if (p != NULL){
             task->deschedule();
 
-            _m_currExe[p] = NULL;
-            _m_oldExe[task] = p;
-            _m_dispatched[task] = NULL;
+            setCurrExe(*cpuState(p), NULL);
+            taskState(task).oldExe = p;
+            setDispatched(task, NULL);
         }
     }
 
@@ -201,8 +364,22 @@ namespace RTSim {
         DBGENTER(_KERNEL_DBG_LEV);
 
         _sched->insert(t);
-        
-        dispatch();
+
+        heapCheck();
+        if (_pending > 0 || taskState(t).dispatched != NULL) {
+            // some dispatch is in progress, look at the whole queue
+            dispatch();
+            return;
+        }
+
+        // every other task among the first m is already
+        // dispatched: t can only take the root of the heap
+        if (_heap.empty()) return;
+        CPUState &c = _cpus[_heap[0]];
+        if (c.dispatched == NULL || _sched->higherPriority(t, c.dispatched)) {
+            DBGPRINT_4("Dispatching ", taskname(t), " on processor ", c.cpu);
+            dispatch(c.cpu);
+        }
     }
 
     void MRTKernel::onEnd(AbsRTTask *task)
@@ -214,10 +391,10 @@ namespace RTSim {
         if (p == NULL) 
             throw RTKernelExc("Received a onEnd of a non executing task"); 
 
-        _sched->extract(task);
-        _m_oldExe[task] = p;
-        _m_currExe[p] = NULL;
-        _m_dispatched[task] = NULL;
+        extractTask(task);
+        taskState(task).oldExe = p;
+        setCurrExe(*cpuState(p), NULL);
+        setDispatched(task, NULL);
 
         dispatch(p);
     }
@@ -225,55 +402,38 @@ namespace RTSim {
     void MRTKernel::dispatch()
     {
         DBGENTER(_KERNEL_DBG_LEV);
-        
-        int ncpu = _m_currExe.size();
-        int num_newtasks = 0; // tells us how many "new" tasks in the 
-                              // ready queue
-        int i;
 
-        for (i=0; i<ncpu; ++i) {
-            AbsRTTask *t = _sched->getTaskN(i);
-            if (t == NULL) break;
-            else if (getProcessor(t) == NULL &&
-                     _m_dispatched[t] == NULL) num_newtasks++;
-        }        
+        heapCheck();
+
+        int ncpu = _cpus.size();
+        // the pending processors will take a new task each
+        int absorbed = _pending;
 
         _sched->print();
-        DBGPRINT_2("New tasks: ", num_newtasks);
         print();
-        if (num_newtasks == 0) return; // nothing to do 
-                                       
-        ITCPU start = _m_currExe.begin();
-        ITCPU stop = _m_currExe.end();
-        ITCPU f = start;
-        do {
-            f = getNextFreeProc(f, stop);
-            if (f != stop) {
-                DBGPRINT_2("Dispatching on free processor ", 
-                           f->first);
-                dispatch(f->first);
-                num_newtasks--;
-                f++;
+
+        for (int i = 0; i < ncpu; ++i) {
+            AbsRTTask *t = _sched->getTaskN(i);
+            if (t == NULL) break;
+
+            const TaskState &ts = taskState(t);
+            if (ts.exec != NULL || ts.dispatched != NULL) continue;
+
+            DBGPRINT_2("New task: ", taskname(t));
+            if (absorbed > 0) {
+                absorbed--;
+                continue;
             }
-            else { // no more free processors
-                // now we deschedule tasks
-                for(;;) {
-                    AbsRTTask *t = _sched->getTaskN(i++);
-                    if (t == NULL) 
-                        throw RTKernelExc("Can't find enough tasks to deschedule!");
-
-                    CPU *c = _m_dispatched[t];                   
-                    if (c != NULL) {
-                        DBGPRINT_4("Dispatching on processor ", c, 
-                                   " which is executing task ", taskname(t));
-                        
-                        dispatch(c);
-                        num_newtasks--;    
-                        break;
-                    }
-                }
-            } 
-        } while (num_newtasks > 0);        
+
+            if (_heap.empty())
+                throw RTKernelExc("Can't find enough tasks to deschedule!");
+
+            CPU *c = _cpus[_heap[0]].cpu;
+            DBGPRINT_4("Dispatching on processor ", c,
+                       " which is executing task ",
+                       taskname(_cpus[_heap[0]].dispatched));
+            dispatch(c);
+        }
     }
 
     void MRTKernel::dispatch(CPU *p)
@@ -282,18 +442,26 @@ namespace RTSim {
 
         if (p == NULL) throw RTKernelExc("Dispatch with NULL parameter");
 
+        CPUState *c = cpuState(p);
+        if (c == NULL) throw RTKernelExc("Dispatch on an unknown processor");
+
         DBGPRINT_2("dispatching on processor ", p);
-        _beginEvt[p]->drop();
+        c->beginEvt->drop();
+        if (!c->pending) {
+            c->pending = true;
+            _pending++;
+            heapRemove(c - &_cpus[0]);
+        }
 
-        if (_isContextSwitching[p]) {
+        if (c->isContextSwitching) {
             DBGPRINT("Context switch is disabled!");
-            _beginEvt[p]->post(_endEvt[p]->getTime());
-            _endEvt[p]->drop();
-            if (_endEvt[p]->getTask() != NULL) 
-                _m_dispatched[_endEvt[p]->getTask()] = NULL;
+            c->beginEvt->post(c->endEvt->getTime());
+            c->endEvt->drop();
+            if (c->endEvt->getTask() != NULL) 
+                setDispatched(c->endEvt->getTask(), NULL);
         }
         else 
-            _beginEvt[p]->post(SIMUL.getTime());
+            c->beginEvt->post(SIMUL.getTime());
     }
 
     void MRTKernel::onBeginDispatchMulti(BeginDispatchMultiEvt* e)
@@ -302,20 +470,24 @@ namespace RTSim {
 
         // if necessary, deschedule the task.
         CPU * p = e->getCPU();
-        AbsRTTask *dt  = _m_currExe[p];
+        CPUState &c = *cpuState(p);
+        AbsRTTask *dt  = c.currExe;
         AbsRTTask *st  = NULL;
 
+        c.pending = false;
+        _pending--;
+
         if ( dt != NULL ) {
-            _m_oldExe[dt] = p;
-            _m_currExe[p] = NULL;
-            _m_dispatched[dt] = NULL;
+            taskState(dt).oldExe = p;
+            setCurrExe(c, NULL);
+            setDispatched(dt, NULL);
             dt->deschedule();
         }
 
         // select the first non dispatched task in the queue
         int i = 0;
         while ((st = _sched->getTaskN(i)) != NULL) 
-            if (_m_dispatched[st] == NULL) break;
+            if (taskState(st).dispatched == NULL) break;
             else i++;
 
         if (st == NULL) {
@@ -324,13 +496,21 @@ namespace RTSim {
 
         DBGPRINT_4("Scheduling task ", taskname(st), " on cpu ", p);
         
-        if (st) _m_dispatched[st] = p;
-        _endEvt[p]->setTask(st);
-        _isContextSwitching[p] = true;
         Tick overhead (_contextSwitchDelay);
-        if (st != NULL && _m_oldExe[st] != p && _m_oldExe[st] != NULL) 
-            overhead += _migrationDelay;
-        _endEvt[p]->post(SIMUL.getTime() + overhead);        
+        if (st) {
+            setDispatched(st, p);
+            CPU *o = taskState(st).oldExe;
+            if (o != p && o != NULL) 
+                overhead += _migrationDelay;
+        }
+        heapPush(&c - &_cpus[0]);
+        c.endEvt->setTask(st);
+        c.isContextSwitching = true;
+        if (overhead == 0 && !c.endEvt->hasProbes() &&
+            (dt == NULL || deschedulesAtOnce(dt)))
+            onEndDispatchMulti(c.endEvt);
+        else
+            c.endEvt->post(SIMUL.getTime() + overhead);        
     }
 
     void MRTKernel::onEndDispatchMulti(EndDispatchMultiEvt* e)
@@ -340,8 +520,9 @@ namespace RTSim {
 
         AbsRTTask *st = e->getTask();
         CPU *p = e->getCPU();
+        CPUState &c = *cpuState(p);
 
-        _m_currExe[p] = st;
+        setCurrExe(c, st);
 
         DBGPRINT_2("CPU: ", p);
         DBGPRINT_2("Task: ", taskname(st));
@@ -349,74 +530,118 @@ namespace RTSim {
         // st could be null (because of an idling processor)
         if (st) st->schedule();
 
-	_isContextSwitching[p] = false;
+	c.isContextSwitching = false;
         _sched->notify(st);
     }
 
     void MRTKernel::printState()
     {
         Entity *task;
-        for (ITCPU i=_m_currExe.begin(); i!=_m_currExe.end(); i++) {
-            task = dynamic_cast<Entity *>(i->second);
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            task = dynamic_cast<Entity *>(_cpus[i].currExe);
             if (task != NULL) 
-                cout << i->first->getName() << " : " << task->getName() << "   ";
+                cout << _cpus[i].cpu->getName() << " : " << task->getName() << "   ";
             else 
-                cout << i->first->getName() << " :   0   ";
+                cout << _cpus[i].cpu->getName() << " :   0   ";
         }
         cout << endl;
     }
 
     void MRTKernel::newRun()
     {
-        for (ITCPU i=_m_currExe.begin(); i!=_m_currExe.end(); i++) {
-            if (i->second!=NULL)
-                _sched->extract(i->second);
-            i->second=NULL;
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            if (_cpus[i].currExe != NULL)
+                _sched->extract(_cpus[i].currExe);
+            _cpus[i].currExe = NULL;
+            _cpus[i].dispatched = NULL;
+            _cpus[i].pending = false;
         }
-        map<const AbsRTTask *, CPU *>::iterator j = _m_dispatched.begin();
-        for ( ; j != _m_dispatched.end(); ++j )
-            j->second = NULL;
-
-        j = _m_oldExe.begin();
-        for ( ; j != _m_oldExe.end(); ++j )
-            j->second = NULL;
+        _pending = 0;
+        for (size_t j = 0; j < _tasks.size(); ++j) {
+            _tasks[j].exec = NULL;
+            _tasks[j].oldExe = NULL;
+            _tasks[j].dispatched = NULL;
+        }
+        heapRebuild();
     }
 
     void MRTKernel::endRun()
     { 
-        for (ITCPU i=_m_currExe.begin(); i!=_m_currExe.end(); i++) {
-            if (i->second!=NULL)
-                _sched->extract(i->second);
-            i->second=NULL;
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            if (_cpus[i].currExe != NULL)
+                _sched->extract(_cpus[i].currExe);
+            setCurrExe(_cpus[i], NULL);
         }
     }
 
+    void MRTKernel::saveState(Checkpoint &c)
+    {
+        RTKernel::saveState(c);
+        c.put(_cpus);
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            c.put(_cpus[i].endEvt->getTask());
+        c.put(_tasks);
+        c.put(_heap);
+        c.put(_pending);
+        c.put(_heapStamp);
+    }
+
+    void MRTKernel::loadState(Checkpoint &c)
+    {
+        RTKernel::loadState(c);
+        c.get(_cpus);
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            AbsRTTask *t;
+            c.get(t);
+            _cpus[i].endEvt->setTask(t);
+        }
+        // the tasks that got a slot after the image have no state
+        std::vector<TaskState> v;
+        c.get(v);
+        for (size_t j = 0; j < _tasks.size(); ++j) {
+            if (j < v.size()) _tasks[j] = v[j];
+            else _tasks[j].exec = _tasks[j].oldExe = _tasks[j].dispatched = NULL;
+        }
+        c.get(_heap);
+        c.get(_pending);
+        c.get(_heapStamp);
+    }
+
     void MRTKernel::print()
     {
         DBGPRINT("Executing");
-        for (ITCPU i = _m_currExe.begin(); i != _m_currExe.end(); ++i)
-            DBGPRINT_4("  [", i->first, "] --> ", taskname(i->second));
-        map<const AbsRTTask *, CPU *>::iterator j = _m_dispatched.begin();
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            DBGPRINT_4("  [", _cpus[i].cpu, "] --> ",
+                       taskname(_cpus[i].currExe));
+        unordered_map<const AbsRTTask *, size_t>::iterator j =
+            _taskSlot.begin();
         DBGPRINT("Dispatched");
-        for ( ; j != _m_dispatched.end(); ++j) 
-            DBGPRINT_4("  [", taskname(j->first), "] --> ", j->second);
+        for ( ; j != _taskSlot.end(); ++j) 
+            DBGPRINT_4("  [", taskname(j->first), "] --> ",
+                       _tasks[j->second].dispatched);
     }
 
     AbsRTTask* MRTKernel::getTask(CPU* c)
     {
-        return _m_currExe[c];
+        CPUState *cs = cpuState(c);
+        return cs != NULL ? cs->currExe : NULL;
     }
     
     std::vector<std::string> MRTKernel::getRunningTasks()
     {
         std::vector<std::string> tmp_ts;
-        for (auto i = _m_currExe.begin(); i != _m_currExe.end(); i++)
-        {
-            std::string tmp_name = taskname((*i).second);
-            if (tmp_name != "(nil)")
-                tmp_ts.push_back(tmp_name);
+        for (size_t i = 0; i < _cpus.size(); ++i) {
+            const std::string &n = taskname(_cpus[i].currExe);
+            if (n != "(nil)") tmp_ts.push_back(n);
         }
         return tmp_ts;
     }
+
+    void MRTKernel::getRunningTasks(std::vector<AbsRTTask *> &out) const
+    {
+        out.clear();
+        for (size_t i = 0; i < _cpus.size(); ++i)
+            if (_cpus[i].currExe != NULL) out.push_back(_cpus[i].currExe);
+    }
     
 }
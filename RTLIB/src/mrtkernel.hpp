@@ -14,6 +14,7 @@
 #ifndef __MRTKERNEL_HPP__
 #define __MRTKERNEL_HPP__
 
+#include <unordered_map>
 #include <vector>
 
 #include <kernel.hpp>
@@ -80,7 +81,7 @@ namespace RTSim {
           resource access related operations and thus implements a
           resource allocation policy;
 
-        - a map of pointers to CPU and task, which keeps the
+        - a vector of per-processor states, which keeps the
           information about current task assignment to CPUs;
         
         - the set of tasks handled by this kernel.
@@ -105,28 +106,60 @@ namespace RTSim {
         /// CPU Factory. Used in one of the constructors.
         absCPUFactory *_CPUFactory;
 
-        /// The currently executing tasks (one per processor).
-        std::map<CPU *, AbsRTTask *> _m_currExe;
+        /// The state of a processor handled by the kernel
+        struct CPUState {
+            CPU *cpu;
+            /// The currently executing task (NULL if idle)
+            AbsRTTask *currExe;
+            /// The task dispatched on this processor (NULL if none)
+            AbsRTTask *dispatched;
+            /// true is the CPU is on a context switch
+            bool isContextSwitching;
+            /// true if the BeginDispatchMultiEvt has been posted
+            bool pending;
+            /// position in _heap (-1 while pending)
+            int heapPos;
+            BeginDispatchMultiEvt *beginEvt;
+            EndDispatchMultiEvt *endEvt;
+        };
+
+        /// The state of a task handled by the kernel
+        struct TaskState {
+            /// Where the task is executing (NULL if it is not)
+            CPU *exec;
+            /// Where the task was executing before being suspended
+            CPU *oldExe;
+            /// This denotes where the task has been dispatched. The
+            /// set of dispatched tasks includes the set of executing
+            /// tasks: first a task is dispatched, (but not executing
+            /// yet) in the onBeginDispatchMulti. Then, in the
+            /// onEndDispatchMulti, its execution starts on the
+            /// processor.
+            CPU *dispatched;
+        };
+
+        /// The processors, in the order they have been added
+        std::vector<CPUState> _cpus;
+
+        /// The state of the tasks, indexed by _taskSlot
+        std::vector<TaskState> _tasks;
+        std::unordered_map<const AbsRTTask *, size_t> _taskSlot;
 
-        /// Where the task was executing before being suspended
-        std::map<const AbsRTTask *, CPU*> _m_oldExe; 
-
-        /// This denotes where the task has been dispatched.  The set
-        /// of dispatched tasks includes the set of executing tasks:
-        /// first a task is dispatched, (but not executing yet) in the
-        /// onBeginDispatchMulti. Then, in the onEndDispatchMulti, its
-        /// execution starts on the processor.
-        std::map<const AbsRTTask *, CPU*> _m_dispatched; 
+        /**
+           The processors that are not pending, as a binary heap
+           whose root is the processor to take first: an idle
+           processor if any (the one added first), otherwise the
+           one whose dispatched task has the lowest priority. Keys
+           are compared with Scheduler::higherPriority().
+        */
+        std::vector<size_t> _heap;
 
-        /// true is the CPU is on a context switch
-        std::map<CPU*, bool> _isContextSwitching;
+        /// number of pending processors
+        int _pending;
 
-        /// The BeginDispatchMultiEvt for every CPU
-        std::map<CPU*, BeginDispatchMultiEvt *> _beginEvt;
+        /// Scheduler::getExtractCount() when _heap was last valid
+        unsigned long _heapStamp;
 
-        /// The EndDispatchMultiEvt for every CPU
-        std::map<CPU*, EndDispatchMultiEvt *> _endEvt;
-    
         /// the amount of delay due to migration (will become a
         /// RandomVar eventually).
 	Tick  _migrationDelay;
@@ -140,8 +173,40 @@ namespace RTSim {
 
         bool isDispatched(CPU *p); 
 
-        typedef map<CPU *, AbsRTTask *>::iterator ITCPU;
-        ITCPU getNextFreeProc(ITCPU s, ITCPU e);
+        void newCPUState(CPU *c);
+
+        /**
+           The state of processor c (NULL if the kernel does not
+           handle it). O(1) when c->getIndex() is the position of c
+           in _cpus, as for the CPUs built by the factory.
+        */
+        CPUState *cpuState(const CPU *c);
+        const CPUState *cpuState(const CPU *c) const;
+
+        /// The state of task t (created if t is not known yet)
+        TaskState &taskState(const AbsRTTask *t);
+        const TaskState *findTaskState(const AbsRTTask *t) const;
+
+        /// Sets the task executing on processor c
+        void setCurrExe(CPUState &c, AbsRTTask *t);
+
+        /// Sets where task t is dispatched (NULL for nowhere)
+        void setDispatched(const AbsRTTask *t, CPU *p);
+
+        /// Extracts t from the scheduler, keeping _heap valid
+        void extractTask(AbsRTTask *t);
+
+        /// true if processor a comes before b in _heap
+        bool heapBefore(size_t a, size_t b);
+        void heapSwap(int i, int j);
+        void heapUp(int i);
+        void heapDown(int i);
+        void heapPush(size_t c);
+        void heapRemove(size_t c);
+        void heapFix(size_t c);
+        /// rebuilds _heap if the scheduler order may have changed
+        void heapCheck();
+        void heapRebuild();
 
     public:
   
@@ -178,6 +243,10 @@ namespace RTSim {
          */
         void addTask(AbsRTTask &t, const std::string &param = "");
 
+        // inherited from RTKernel
+        virtual void removeTask(AbsRTTask &t);
+        virtual void reserveTasks(size_t n);
+
         // inherited from RTKernel
         virtual void onArrival(AbsRTTask *);
         virtual void suspend(AbsRTTask *);
@@ -198,10 +267,15 @@ namespace RTSim {
         void dispatch(CPU *cpu);
 
         /**
-           This function is called by the onArrival and by the
-            activate function. When we call this, we first select a
-            free processor, then we call the other dispatch,
-            specifying on which processor we need to schedule.
+           This function is called by the activate function and by
+            anyone who changed the ready queue. Every task among the
+            first m (the number of processors) of the queue that has
+            not been dispatched yet takes the processor at the root
+            of the heap (a free one, or the one running the task
+            with the lowest priority), and then we call the other
+            dispatch, specifying on which processor we need to
+            schedule. onArrival() does the same with the arrived
+            task only, comparing it with the root of the heap.
          */
         virtual void dispatch();
 
@@ -224,9 +298,19 @@ namespace RTSim {
         /**
            Returns a vector containing the pointers to the processors.
            
-           Deprecated, will be removed soon
+           Deprecated, will be removed soon: see
+           getProcessorCount() and getProcessorAt()
          */
         std::vector<CPU*> getProcessors() const;
+
+        /// The number of processors
+        size_t getProcessorCount() const { return _cpus.size(); }
+
+        /// The i-th processor, in the order they were added
+        CPU *getProcessorAt(size_t i) const { return _cpus[i].cpu; }
+
+        /// The task executing on the i-th processor (NULL if idle)
+        AbsRTTask *getTaskAt(size_t i) const { return _cpus[i].currExe; }
         
         /**
            Set the migration delay. This is the overhead to be added
@@ -240,6 +324,13 @@ namespace RTSim {
         virtual void newRun();
         virtual void endRun();
         virtual void print();
+
+        /// Saves the state of the processors and of the tasks
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
+        /// The fast-forward is not supported on multiprocessors
+        virtual bool getSignature(StateImage &s) { return false; }
         virtual void printState();
 
         /** 
@@ -255,6 +346,9 @@ namespace RTSim {
          different running task.
          */
         virtual std::vector<std::string> getRunningTasks();
+
+        /// Stores in out the running tasks, processor by processor
+        virtual void getRunningTasks(std::vector<AbsRTTask *> &out) const;
     };
 } // namespace RTSim
 
@@ -0,0 +1,297 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <sstream>
+
+#include <arena.hpp>
+#include <simul.hpp>
+
+#include <kernel.hpp>
+#include <lighttask.hpp>
+#include <partitioner.hpp>
+#include <schedanalysis.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    Partitioner::Partitioner(int m, fit_t fit, test_t test) :
+        _fit(fit), _test(test), _c(), _t(), _d(), _cpu(), _bins(),
+        _tree(), _leaves(1), _order()
+    {
+        if (m <= 0) throw Exc("No processors");
+        _bins.resize(m);
+        while (_leaves < size_t(m)) _leaves *= 2;
+    }
+
+    void Partitioner::addTask(Tick c, Tick t, Tick d)
+    {
+        if (d == 0) d = t;
+        if (c <= 0 || t <= 0 || d <= 0 || d > t) 
+            throw Exc("Wrong task parameters");
+        _c.push_back(c);
+        _t.push_back(t);
+        _d.push_back(d);
+    }
+
+    double Partitioner::load(size_t i) const
+    {
+        if (_test == EDF_UTIL) return double(_c[i]) / double(_d[i]);
+        return double(_c[i]) / double(_t[i]);
+    }
+
+    bool Partitioner::admits(int k, size_t i)
+    {
+        Bin &b = _bins[k];
+        double c = double(_c[i]), d = double(_d[i]), u = c / double(_t[i]);
+
+        switch (_test) {
+        case EDF_UTIL:
+            return b.load <= 1 - load(i);
+        case QPA: {
+            if (b.u > 1 - u) return false;
+            if (b.density <= 1 - c / d) return true;
+            // the interval to check grows as 1 / (1 - U): when it
+            // is too long, the task goes to another processor
+            double la = (b.slack + (double(_t[i]) - d) * u) / (1 - b.u - u);
+            Tick dmax = b.D.empty() ? _d[i] : max(_d[i], b.D.back());
+            if (!(la <= QPA_INTERVAL * double(dmax))) return false;
+            // the demand at the deadline of the last task rejected,
+            // then at the deadline of the new one
+            if (b.rejR >= _d[i] &&
+                b.rejC + ((b.rejR - _d[i]) / long(_t[i]) + 1) * _c[i] > b.rejR)
+                return false;
+            Tick h = 0;
+            for (size_t j = 0; j < b.D.size() && b.D[j] <= _d[i]; ++j)
+                h += ((_d[i] - b.D[j]) / long(b.T[j]) + 1) * b.C[j];
+            if (h + _c[i] > _d[i]) {
+                b.rejC = h;
+                b.rejR = _d[i];
+                return false;
+            }
+            if (approxDemand(b, i)) return true;
+            b.C.push_back(_c[i]);
+            b.T.push_back(_t[i]);
+            b.D.push_back(_d[i]);
+            bool ok = analysis::qpaTest(&b.C[0], &b.T[0], &b.D[0], int(b.C.size()));
+            b.C.pop_back();
+            b.T.pop_back();
+            b.D.pop_back();
+            return ok;
+        }
+        case RTA: {
+            if (b.u > 1 - u) return false;
+            // every task of higher priority executes once before the
+            // new one ends; the bounds have a margin for the
+            // rounding errors
+            double lower = std::max(c + b.sumC, c / (1 - b.u));
+            if (lower > d * (1 + 1e-9)) return false;
+            if ((c + b.sumC - b.sumCU) / (1 - b.u) <= d * (1 - 1e-9)) return true;
+            Tick r = Tick(std::floor(lower * (1 - 1e-9)));
+            // a longer task ends at least as much later than the
+            // last one rejected by the same bin
+            if (b.rejC > 0 && _c[i] >= b.rejC) {
+                Tick from = b.rejR + (_c[i] - b.rejC);
+                if (from > _d[i]) return false;
+                r = std::max(r, from);
+            }
+            const vector<int> &v = b.tasks;
+            int n = int(v.size());
+            r = analysis::responseTime(
+                n, r, _d[i],
+                [&](int j) { return j < n ? _c[v[j]] : _c[i]; },
+                [&](int j) { return j < n ? _t[v[j]] : _t[i]; });
+            if (r <= _d[i]) return true;
+            b.rejC = _c[i];
+            b.rejR = r;
+            return false;
+        }
+        }
+        return false;
+    }
+
+    bool Partitioner::approxDemand(const Bin &b, size_t i) const
+    {
+        // the demand of a task, after its first deadline, is not
+        // greater than C + U (t - D): their sum is linear between
+        // two deadlines, and it is enough to check it at each one
+        double sc = 0, su = 0;
+        bool ok = true;
+        auto add = [&](Tick c, Tick t, Tick d) {
+            double u = double(c) / double(t);
+            sc += double(c) - u * double(d);
+            su += u;
+            ok = ok && sc + su * double(d) <= double(d) * (1 - 1e-9);
+        };
+        size_t p = upper_bound(b.D.begin(), b.D.end(), _d[i]) - b.D.begin();
+        for (size_t j = 0; j < p && ok; ++j) add(b.C[j], b.T[j], b.D[j]);
+        add(_c[i], _t[i], _d[i]);
+        for (size_t j = p; j < b.D.size() && ok; ++j) add(b.C[j], b.T[j], b.D[j]);
+        return ok;
+    }
+
+    void Partitioner::place(int k, size_t i)
+    {
+        Bin &b = _bins[k];
+        double c = double(_c[i]), u = c / double(_t[i]);
+
+        if (_fit != FIRST_FIT) _order.erase(make_pair(b.load, k));
+
+        _cpu[i] = k;
+        b.tasks.push_back(int(i));
+        b.u += u;
+        b.density += c / double(_d[i]);
+        b.load = _test == EDF_UTIL ? b.density : b.u;
+        b.sumC += c;
+        b.sumCU += c * u;
+        b.slack += (double(_t[i]) - double(_d[i])) * u;
+        b.rejC = b.rejR = 0;
+        if (_test == QPA) {
+            size_t p = upper_bound(b.D.begin(), b.D.end(), _d[i]) - b.D.begin();
+            b.C.insert(b.C.begin() + p, _c[i]);
+            b.T.insert(b.T.begin() + p, _t[i]);
+            b.D.insert(b.D.begin() + p, _d[i]);
+        }
+
+        if (_fit == FIRST_FIT) updateTree(k);
+        else _order.insert(make_pair(b.load, k));
+    }
+
+    int Partitioner::firstFit(size_t node, size_t lo, size_t hi, int k, double max) const
+    {
+        if (hi < size_t(k) || _tree[node] > max) return -1;
+        if (lo == hi) return int(lo);
+        size_t mid = (lo + hi) / 2;
+        int f = firstFit(2 * node, lo, mid, k, max);
+        if (f >= 0) return f;
+        return firstFit(2 * node + 1, mid + 1, hi, k, max);
+    }
+
+    void Partitioner::updateTree(int k)
+    {
+        size_t n = _leaves + k;
+        _tree[n] = _bins[k].load;
+        for (n /= 2; n > 0; n /= 2) _tree[n] = min(_tree[2 * n], _tree[2 * n + 1]);
+    }
+
+    int Partitioner::find(size_t i)
+    {
+        double max = 1 - load(i);
+
+        if (_fit == FIRST_FIT) {
+            for (int k = firstFit(1, 0, _leaves - 1, 0, max); k >= 0;
+                 k = firstFit(1, 0, _leaves - 1, k + 1, max))
+                if (admits(k, i)) return k;
+        }
+        else if (_fit == BEST_FIT) {
+            // the fullest processor first
+            set<pair<double, int> >::iterator j = _order.upper_bound(make_pair(max, INT_MAX));
+            while (j != _order.begin()) {
+                --j;
+                if (admits(j->second, i)) return j->second;
+            }
+        }
+        else {
+            set<pair<double, int> >::iterator j = _order.begin();
+            for (; j != _order.end() && j->first <= max; ++j)
+                if (admits(j->second, i)) return j->second;
+        }
+        return -1;
+    }
+
+    size_t Partitioner::partition()
+    {
+        for (size_t k = 0; k < _bins.size(); ++k) {
+            Bin &b = _bins[k];
+            b.tasks.clear();
+            b.u = b.density = b.load = b.sumC = b.sumCU = b.slack = 0;
+            b.rejC = b.rejR = 0;
+            b.C.clear();
+            b.T.clear();
+            b.D.clear();
+        }
+        _cpu.assign(size(), -1);
+
+        // the leaves after the last processor are never chosen
+        _tree.assign(2 * _leaves, 2.0);
+        _order.clear();
+        for (size_t k = 0; k < _bins.size(); ++k) {
+            if (_fit == FIRST_FIT) updateTree(int(k));
+            else _order.insert(make_pair(0.0, int(k)));
+        }
+
+        vector<int> idx(size());
+        for (size_t i = 0; i < idx.size(); ++i) idx[i] = int(i);
+        if (_test == RTA)
+            stable_sort(idx.begin(), idx.end(), [this](int a, int b) {
+                    return _d[a] < _d[b] || (_d[a] == _d[b] && _t[a] < _t[b]); });
+        else 
+            stable_sort(idx.begin(), idx.end(), [this](int a, int b) {
+                    return load(a) > load(b); });
+
+        size_t missed = 0;
+        for (size_t h = 0; h < idx.size(); ++h) {
+            int k = find(idx[h]);
+            if (k >= 0) place(k, idx[h]);
+            else ++missed;
+        }
+        return missed;
+    }
+
+    void Partitioner::build(const vector<RTKernel *> &kernels,
+                            vector<LightTaskSet *> &sets,
+                            const string &prefix) const
+    {
+        if (kernels.size() != _bins.size()) 
+            throw Exc("There must be one kernel per processor");
+
+        ModelArena &arena = SimContext::current()->arena();
+        vector<Tick> period, wcet, rdl;
+        vector<string> param;
+        for (size_t k = 0; k < _bins.size(); ++k) {
+            const vector<int> &v = _bins[k].tasks;
+            period.clear();
+            wcet.clear();
+            rdl.clear();
+            for (size_t j = 0; j < v.size(); ++j) {
+                period.push_back(_t[v[j]]);
+                wcet.push_back(_c[v[j]]);
+                rdl.push_back(_d[v[j]]);
+            }
+
+            string name;
+            if (!prefix.empty()) {
+                stringstream ss;
+                ss << prefix << k << "_";
+                name = ss.str();
+            }
+            LightTaskSet *s = arena.create<LightTaskSet>(period, wcet, rdl,
+                                                         vector<Tick>(), name);
+            if (_test == RTA) {
+                param.resize(v.size());
+                for (size_t j = 0; j < v.size(); ++j) {
+                    stringstream ss;
+                    ss << j;
+                    param[j] = ss.str();
+                }
+                s->addTo(*kernels[k], param);
+            }
+            else s->addTo(*kernels[k]);
+            sets.push_back(s);
+        }
+    }
+
+} // namespace RTSim
@@ -0,0 +1,212 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PARTITIONER_HPP__
+#define __PARTITIONER_HPP__
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basetype.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    class LightTaskSet;
+    class RTKernel;
+
+    /**
+       \ingroup util
+
+       Assigns tasks (computation time C, period T, relative
+       deadline D <= T) to m processors, each scheduled on its own,
+       with a bin-packing heuristic and an admission test:
+
+       - EDF_UTIL: EDF, with the density test (the sum of C /
+         min(D, T) not greater than 1; it is the utilization test
+         when D = T);
+       - QPA: EDF, with the processor demand (analysis::qpaTest()),
+         tried only when the density test and the test with the
+         approximated demand fail (Baruah and Fisher, "The
+         partitioned multiprocessor scheduling of sporadic task
+         systems", RTSS 2005), and on a processor not
+         too close to full (see QPA_INTERVAL);
+       - RTA: fixed priorities, deadline monotonic, with the
+         response time analysis.
+
+       The tasks are placed in decreasing order of density (of
+       utilization for QPA), except with RTA, where they are placed
+       in priority order: a new task is then always the lowest
+       priority task of its processor, and its admission does not
+       change the response times of the others. Its response time
+       is first compared with an upper bound (see Bini et al., "A
+       response-time bound in fixed-priority scheduling with
+       arbitrary deadlines", IEEE Trans. on Computers, 2009) and
+       with lower bounds, computed in constant time, and it is
+       computed exactly (starting from the lower bound) only when
+       the deadline lies in between.
+
+       The processors with room for a task are found in O(log m)
+       (by a tree of the loads for FIRST_FIT, an ordered set for
+       BEST_FIT and WORST_FIT): with EDF_UTIL, 100000 tasks are
+       placed on hundreds of processors in milliseconds; with QPA
+       and RTA, the time goes in the exact analysis on the
+       processors close to full.
+
+       <pre>
+       Partitioner p(256, Partitioner::FIRST_FIT, Partitioner::EDF_UTIL);
+       for (...) p.addTask(c, t, d);
+       if (p.partition() > 0) ...;   // some tasks did not fit
+       p.build(kernels, sets, "t");  // one LightTaskSet per processor
+       </pre>
+    */
+    class Partitioner {
+    public:
+        typedef enum { FIRST_FIT, BEST_FIT, WORST_FIT } fit_t;
+        typedef enum { EDF_UTIL, QPA, RTA } test_t;
+
+        /**
+           With QPA, the processor demand is not checked on an
+           interval longer than QPA_INTERVAL times the largest
+           deadline: the task is not admitted.
+        */
+        static const int QPA_INTERVAL = 100;
+
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string &msg) :
+                BaseExc(msg, "Partitioner", "partitioner.cpp") {}
+        };
+
+        /// @throws Exc if m is not positive
+        Partitioner(int m, fit_t fit = FIRST_FIT, test_t test = EDF_UTIL);
+
+        /**
+           Adds a task, with relative deadline d (the period if it
+           is 0).
+
+           @throws Exc if c or t are not positive, or d > t
+        */
+        void addTask(Tick c, Tick t, Tick d = 0);
+
+        /// Number of tasks
+        size_t size() const { return _c.size(); }
+
+        /// Number of processors
+        int getProcessors() const { return int(_bins.size()); }
+
+        /**
+           Places all the tasks (forgetting a previous partition),
+           and returns the number of tasks that could not be
+           placed.
+        */
+        size_t partition();
+
+        /// The processor of task i, -1 if it was not placed
+        int getCPU(size_t i) const { return _cpu[i]; }
+
+        /**
+           The tasks on processor k, in the order they have been
+           placed (for RTA, in decreasing priority order)
+        */
+        const std::vector<int> &getTasks(int k) const { return _bins[k].tasks; }
+
+        /// The utilization of processor k
+        double getUtilization(int k) const { return _bins[k].u; }
+
+        /**
+           Builds the model: the tasks on processor k become a
+           LightTaskSet, created in the arena of the current
+           SimContext (see ModelArena), and added to kernels[k].
+           With RTA, the parameter of a task is its priority (0 is
+           the highest, as for FPScheduler); otherwise it is
+           empty. If prefix is not empty, the tasks of processor k
+           are named <prefix><k>_0, <prefix><k>_1, ...
+
+           @throws Exc if there is not one kernel per processor
+        */
+        void build(const std::vector<RTKernel *> &kernels,
+                   std::vector<LightTaskSet *> &sets,
+                   const std::string &prefix = "") const;
+
+    private:
+        struct Bin {
+            std::vector<int> tasks;
+            /// utilization, density, and the load used for the fit
+            double u, density, load;
+            /// for the response time bounds (RTA)
+            double sumC, sumCU;
+            /**
+               The computation time of the last task rejected by the
+               response time analysis, and a lower bound of its
+               response time (0 if there is none since the last
+               change). The response time grows at least as the
+               computation time, so the analysis of the next task
+               can resume from it. With QPA, the demand of the
+               processor at the deadline of the last task rejected,
+               and that deadline.
+            */
+            Tick rejC, rejR;
+            /// the sum of (T - D) U, for the interval of QPA
+            double slack;
+            /// the parameters of the tasks, by deadline (QPA)
+            std::vector<Tick> C, T, D;
+        };
+
+        fit_t _fit;
+        test_t _test;
+
+        std::vector<Tick> _c, _t, _d;
+        std::vector<int> _cpu;
+        std::vector<Bin> _bins;
+
+        /// the minimum load of each subtree of processors (FIRST_FIT)
+        std::vector<double> _tree;
+        size_t _leaves;
+
+        /// the loads and the processors, ordered (BEST_FIT, WORST_FIT)
+        std::set<std::pair<double, int> > _order;
+
+        double load(size_t i) const;
+
+        /// True if task i can be added to processor k
+        bool admits(int k, size_t i);
+
+        /**
+           True if task i and the tasks of b pass the test with the
+           approximated demand bound function (a sufficient test,
+           in linear time)
+        */
+        bool approxDemand(const Bin &b, size_t i) const;
+
+        void place(int k, size_t i);
+
+        /**
+           The first processor from k on with a load not greater
+           than max, or -1, in the subtree node (processors lo to
+           hi)
+        */
+        int firstFit(size_t node, size_t lo, size_t hi, int k, double max) const;
+        void updateTree(int k);
+
+        /// The processor for task i, or -1
+        int find(size_t i);
+    };
+
+} // namespace RTSim
+
+#endif
@@ -34,6 +34,8 @@ namespace RTSim {
 
     void PIRManager::newRun()
     {
+        blocked.clear();
+        waiting.clear();
     }
 
     void PIRManager::endRun()
@@ -55,45 +57,22 @@ namespace RTSim {
         // if resource is not free...
         if (r->isLocked()) {
             DBGPRINT("Resource is locked");
-            // Task that owns the resource
-            AbsRTTask *owner = dynamic_cast<AbsRTTask *>(r->getOwner());
-            TaskModel* ownerModel = _sched->find(owner);
-
-            if (ownerModel == NULL) {
-                throw BaseExc("Cannot find owner model!");
-            }   
-
-            // remove the owner from the scheduler. It is not executing.
-            _sched->extract(owner);
-
             // suspend the task.
             _kernel->suspend(t);
 
-            DBGPRINT("Raising priority");
-            // owner priority = task priority
-            ownerModel->changePriority(taskModel->getPriority());
-
-            // reactivate the owner with the new priority
-            _kernel->activate(owner);
-
             // push the blocked task into the blocked queue
-            blocked[r->getName()].insert(taskModel);
+            blocked[r].insert(taskModel);
+            waiting[taskModel] = r;
+
+            DBGPRINT("Raising priority");
+            inherit(r, taskModel->getPriority());
     
             ret = false;
         }
         else {
             // save owner's priority
             DBGPRINT("Storing old priority");
-
-            // (if the entry in oldPriorities does not exist?)
-            if (oldPriorities.find(t) == oldPriorities.end()) {
-                PRIORITY_MAP mm;
-                mm[r->getName()] = taskModel->getPriority();
-                oldPriorities[t] = mm;
-            }
-            else {
-                (oldPriorities[t])[r->getName()] = taskModel->getPriority(); 
-            }
+            taskModel->pushPriority(r);
 
             r->lock(t);
             ret = true;
@@ -111,19 +90,62 @@ namespace RTSim {
         DBGENTER(_PIRESMAN_DBG_LEV);
 
         r->unlock();
+        Tick prio = taskModel->popPriority(r);
         // see if there is any blocked task
-        if (!blocked[r->getName()].empty()) 
+        BLOCKED_QUEUE &q = blocked[r];
+        if (!q.empty()) 
         {
-            TaskModel *newTaskModel = blocked[r->getName()].front();
-            blocked[r->getName()].erase(newTaskModel);
-            _kernel->suspend(t);
-            taskModel->changePriority((oldPriorities[t])[r->getName()]);
-            if (t->isActive()) _kernel->activate(t);
+            TaskModel *newTaskModel = q.front();
+            q.erase(newTaskModel);
+            waiting.erase(newTaskModel);
+            // in place: t may be at the end of its last instruction
+            _sched->setPriority(t, prio);
+
+            // the new owner inherits from the tasks still blocked
+            newTaskModel->pushPriority(r);
+            if (!q.empty()) {
+                Tick p = q.front()->getPriority();
+                if (p < newTaskModel->getPriority())
+                    _sched->setPriority(newTaskModel->getTask(), p);
+            }
             _kernel->activate(newTaskModel->getTask());
             r->lock(newTaskModel->getTask());
         }
+    }
 
-        
+    void PIRManager::inherit(Resource *r, Tick p)
+    {
+        DBGENTER(_PIRESMAN_DBG_LEV);
+
+        while (r != NULL) {
+            TaskModel *ownerModel = _sched->find(r->getOwner());
+
+            if (ownerModel == NULL) {
+                throw BaseExc("Cannot find owner model!");
+            }   
+
+            // the rest of the chain has at least this priority
+            if (ownerModel->getPriority() <= p) break;
+
+            // owner priority = task priority, the owner (not
+            // executing) moves in the ready queue
+            unordered_map<const TaskModel *, Resource *>::iterator w =
+                waiting.find(ownerModel);
+            if (w == waiting.end()) {
+                _sched->setPriority(ownerModel->getTask(), p);
+                break;
+            }
+
+            // the owner is blocked too: it moves in its blocked
+            // queue (ordered by the keys of the models), and the
+            // owner of that resource inherits
+            BLOCKED_QUEUE &q = blocked[w->second];
+            q.erase(ownerModel);
+            _sched->setPriority(ownerModel->getTask(), p);
+            ownerModel->updateKey();
+            q.insert(ownerModel);
+            r = w->second;
+        }
     }
 
 } // namespace RTSim
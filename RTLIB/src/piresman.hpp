@@ -14,7 +14,7 @@
 #ifndef __PIRESMAN_HPP__
 #define __PIRESMAN_HPP__
 
-#include <map>
+#include <unordered_map>
 
 #include <plist.hpp>
 
@@ -35,6 +35,12 @@ namespace RTSim {
        same interface of any Resource Manager class, in addition it has a
        setScheduler() function, because the PI needs the scheduler for
        changing the priority of a task.
+
+       The priority of a task when it locks a resource is saved in
+       its model (TaskModel::pushPriority(), tagged with the
+       resource) and restored when it releases the resource. The
+       owner of a resource inherits the priority of a blocked task
+       in place, with Scheduler::setPriority().
     */
     class PIRManager : public ResManager {
 //         Scheduler *_sched;
@@ -50,9 +56,6 @@ namespace RTSim {
          */
 //         void setScheduler(Scheduler *s);
 
-        /**
-         * @todo clear the maps!!
-         */
         void newRun();
 
         void endRun();
@@ -70,18 +73,21 @@ namespace RTSim {
         virtual void release(AbsRTTask *t, Resource *r, int n=1);
 
     private:
-        /// correspondence task / priority 
-        typedef map<std::string, int> PRIORITY_MAP;
-        
         /// Blocked tasks, ordered by priority. 
         /// There is one such queue for each resource
         typedef priority_list<TaskModel *, TaskModel::TaskModelCmp> BLOCKED_QUEUE;
 
-        // Stores the old task priorities
-        map<AbsRTTask *, PRIORITY_MAP> oldPriorities;
-
         // stores the blocked tasks for each resource, ordered by priority
-        map<string, BLOCKED_QUEUE> blocked;
+        std::unordered_map<const Resource *, BLOCKED_QUEUE> blocked;
+
+        // the resource each blocked task is waiting for
+        std::unordered_map<const TaskModel *, Resource *> waiting;
+
+        /**
+           The owner of r inherits priority p, and so on along the
+           chain of the blocked owners.
+        */
+        void inherit(Resource *r, Tick p);
     };
 }
 
@@ -13,7 +13,8 @@ namespace RTSim {
         P(p),
         cap(0),
         last_time(0),
-        recharging_time(0)
+        recharging_time(0),
+        skipped(false)
     {
         DBGENTER(_SERVER_DBG_LEV);
         dline = p;
@@ -26,9 +27,29 @@ namespace RTSim {
         cap = 0;
         last_time = 0;
         recharging_time = 0;
+        skipped = false;
         status = IDLE;
     }
 
+    void PollingServer::onArrival(AbsRTTask *t)
+    {
+        DBGENTER(_SERVER_DBG_LEV);
+
+        if (status == RECHARGING && skipped) {
+            skipped = false;
+            if (SIMUL.getTime() < recharging_time) {
+                _rechargingEvt.post(recharging_time);
+                _dlineMissEvt.post(recharging_time);
+            }
+            else {
+                recharging_idle();
+                currExe_ = NULL;
+                sched_->notify(NULL);
+            }
+        }
+        Server::onArrival(t);
+    }
+
 
     void PollingServer::endRun()
     {
@@ -90,6 +111,12 @@ namespace RTSim {
         cap = 0;
         _bandExEvt.drop();
 
+        // with nothing to do, the end of the period would only
+        // make the server idle (see onArrival())
+        _rechargingEvt.drop();
+        _dlineMissEvt.drop();
+        skipped = true;
+
         
     }
 
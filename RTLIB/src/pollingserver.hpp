@@ -18,12 +18,25 @@
 
 namespace RTSim {
 
+    /**
+       A polling server: when its queue becomes empty, the budget
+       is lost until the end of the current period.
+
+       The end of a period in which the queue has become empty is
+       not posted: it would only bring the server back to idle.
+       The server stays in RECHARGING, and the state of the
+       skipped end of period is reconstructed at the next arrival
+       (see onArrival()), so a mostly idle server costs no event
+       per period.
+    */
     class PollingServer : public Server {
     private:
         Tick Q, P;
         Tick cap; 
         Tick last_time;
         Tick recharging_time;
+        /// the end of the current period has not been posted
+        bool skipped;
     public:
         PollingServer(Tick q, Tick p, const std::string &name, 
                       const std::string &sched = "FIFOSched");
@@ -39,6 +52,13 @@ namespace RTSim {
         /** @todo to be completed */
         virtual double getVirtualTime() {return 0;}
 
+        /**
+           Posts the end of the current period, if it has been
+           skipped and it is still in the future; otherwise the
+           server is idle, as the end of period would have left it.
+        */
+        virtual void onArrival(AbsRTTask *t);
+
     protected:
                 
         /// from idle to active contending (new work to do)
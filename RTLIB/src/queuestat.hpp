@@ -0,0 +1,92 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __QUEUESTAT_HPP__
+#define __QUEUESTAT_HPP__
+
+#include <string>
+
+#include <timeintegral.hpp>
+
+#include <cpu.hpp>
+#include <kernel.hpp>
+#include <scheduler.hpp>
+#include <server.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    /**
+       \ingroup measures
+
+       The average length of the ready queues of some schedulers
+       over the time (the executing tasks included), summed. It
+       reads Scheduler::getReadyLength(), so it does not probe
+       any event.
+
+       <pre>
+       ReadyQueueStat q("ready");
+       q.attachToKernel(&kern);
+       </pre>
+    */
+    class ReadyQueueStat : public StatTimeAverage {
+    public:
+        ReadyQueueStat(std::string name = "") : StatTimeAverage(name) {}
+
+        void attachToScheduler(Scheduler *s) { add(&s->getReadyLength()); }
+
+        void attachToKernel(RTKernel *k) { attachToScheduler(k->getScheduler()); }
+    };
+
+    /**
+       \ingroup measures
+
+       The average backlog of some servers over the time, summed
+       (see Server::getBacklog()).
+    */
+    class BacklogStat : public StatTimeAverage {
+    public:
+        BacklogStat(std::string name = "") : StatTimeAverage(name) {}
+
+        void attachToServer(Server *s) { add(&s->getBacklog()); }
+    };
+
+    /**
+       \ingroup measures
+
+       The fraction of the time in which some processors are
+       idle, on average over the processors (see
+       CPU::getOccupancy()).
+    */
+    class IdleFractionStat : public StatTimeAverage {
+        int _cpus;
+    public:
+        IdleFractionStat(std::string name = "") :
+            StatTimeAverage(name), _cpus(0) {}
+
+        void attachToCPU(CPU *c)
+            {
+                add(&c->getOccupancy());
+                _cpus++;
+            }
+
+        virtual void refresh()
+            {
+                _val = _cpus > 0 ? 1 - average() / _cpus : 0;
+            }
+    };
+
+} // namespace RTSim
+
+#endif
@@ -0,0 +1,226 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <simul.hpp>
+
+#include <exeinstr.hpp>
+#include <replaytask.hpp>
+
+namespace RTSim {
+
+    namespace {
+        const char MAGIC[8] = { 'R', 'T', 'S', 'I', 'M', 'W', 'L', 'D' };
+        const uint32_t VERSION = 1;
+        const size_t HEADER = 24;
+
+        bool byTaskArrival(const WorkloadTrace::Job &a, const WorkloadTrace::Job &b)
+        {
+            if (a.task != b.task) return a.task < b.task;
+            return a.arrival < b.arrival;
+        }
+
+        template <class T>
+        void write(ofstream &f, const T &v)
+        {
+            f.write(reinterpret_cast<const char *>(&v), sizeof(T));
+        }
+    }
+
+    WorkloadTrace::WorkloadTrace(const string &binfile) :
+        _map(0), _len(0), _copy(), _dir(0), _jobs(0), _ntasks(0), _njobs(0)
+    {
+        const char *base;
+
+#ifndef _WIN32
+        int fd = open(binfile.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            throw Exc("Cannot open " + binfile);
+        }
+        _len = st.st_size;
+        if (_len < HEADER) {
+            close(fd);
+            throw Exc(binfile + " is not a workload trace");
+        }
+        void *m = mmap(0, _len, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) throw Exc("Cannot map " + binfile);
+        // the tasks read their jobs in parallel, each one in
+        // order: read the whole file ahead of the simulation
+        madvise(m, _len, MADV_WILLNEED);
+        _map = m;
+        base = (const char *) m;
+#else
+        ifstream f(binfile.c_str(), ios::binary);
+        if (!f.is_open()) throw Exc("Cannot open " + binfile);
+        _copy.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+        _len = _copy.size();
+        if (_len < HEADER) throw Exc(binfile + " is not a workload trace");
+        base = _copy.data();
+#endif
+
+        uint32_t version, ntasks;
+        uint64_t njobs;
+        memcpy(&version, base + 8, 4);
+        memcpy(&ntasks, base + 12, 4);
+        memcpy(&njobs, base + 16, 8);
+        if (memcmp(base, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION ||
+            _len != HEADER + ntasks * sizeof(Entry) + njobs * sizeof(Record)) {
+#ifndef _WIN32
+            munmap(_map, _len);
+#endif
+            throw Exc(binfile + " is not a workload trace");
+        }
+        _ntasks = ntasks;
+        _njobs = njobs;
+        _dir = reinterpret_cast<const Entry *>(base + HEADER);
+        _jobs = reinterpret_cast<const Record *>(_dir + _ntasks);
+    }
+
+    WorkloadTrace::~WorkloadTrace()
+    {
+#ifndef _WIN32
+        if (_map != 0) munmap(_map, _len);
+#endif
+    }
+
+    const WorkloadTrace::Entry *WorkloadTrace::find(uint32_t task) const
+    {
+        size_t lo = 0, hi = _ntasks;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (_dir[mid].id < task) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < _ntasks && _dir[lo].id == task) return &_dir[lo];
+        return 0;
+    }
+
+    const WorkloadTrace::Record *WorkloadTrace::begin(uint32_t task) const
+    {
+        const Entry *e = find(task);
+        return e ? _jobs + e->first : _jobs;
+    }
+
+    const WorkloadTrace::Record *WorkloadTrace::end(uint32_t task) const
+    {
+        const Entry *e = find(task);
+        return e ? _jobs + e->first + e->count : _jobs;
+    }
+
+    void WorkloadTrace::save(const vector<Job> &jobs, const string &binfile)
+    {
+        vector<Job> v(jobs);
+        stable_sort(v.begin(), v.end(), byTaskArrival);
+
+        vector<Entry> dir;
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (dir.empty() || dir.back().id != v[i].task) {
+                Entry e = { v[i].task, 0, i, 0 };
+                dir.push_back(e);
+            }
+            dir.back().count++;
+        }
+
+        ofstream f(binfile.c_str(), ios::out | ios::binary | ios::trunc);
+        if (!f) throw Exc("Cannot write " + binfile);
+        f.write(MAGIC, sizeof(MAGIC));
+        write(f, VERSION);
+        write(f, uint32_t(dir.size()));
+        write(f, uint64_t(v.size()));
+        if (!dir.empty())
+            f.write(reinterpret_cast<const char *>(&dir[0]), dir.size() * sizeof(Entry));
+        for (size_t i = 0; i < v.size(); ++i) {
+            Record r = { int64_t(v[i].arrival), int64_t(v[i].demand) };
+            write(f, r);
+        }
+        if (!f) throw Exc("Cannot write " + binfile);
+    }
+
+    void WorkloadTrace::convert(const string &textfile, const string &binfile)
+    {
+        ifstream f(textfile.c_str());
+        if (!f) throw Exc("Cannot open " + textfile);
+
+        vector<Job> jobs;
+        string line, arr, dem;
+        int n = 0;
+        while (getline(f, line)) {
+            ++n;
+            stringstream ss(line);
+            Job j;
+            if (!(ss >> j.task)) continue;
+            if (!(ss >> arr >> dem)) {
+                stringstream msg;
+                msg << textfile << ":" << n << ": a job needs task, arrival and execution time";
+                throw Exc(msg.str());
+            }
+            j.arrival = Tick(arr);
+            j.demand = Tick(dem);
+            jobs.push_back(j);
+        }
+        save(jobs, binfile);
+    }
+
+    ReplayTask::ReplayTask(const WorkloadTrace &w, uint32_t id, Tick rdl,
+                           const string &name, long qs) :
+        Task(NULL, rdl, 0, name, qs),
+        _first(w.begin(id)), _end(w.end(id)), _next(_first), _job(_first),
+        _demand(0), _min(0), _max(0), _cost(*this)
+    {
+        for (const WorkloadTrace::Record *r = _first; r != _end; ++r) {
+            if (r == _first || r->demand < _min) _min = r->demand;
+            if (r->demand > _max) _max = r->demand;
+        }
+        addInstr(new ExecInstr(this, _cost, getName() + "_replay"));
+        compileCode();
+    }
+
+    void ReplayTask::newRun()
+    {
+        Task::newRun();
+        _next = _job = _first;
+        _demand = 0;
+        if (_next != _end) arrEvt.post(Tick(_next->arrival));
+    }
+
+    void ReplayTask::reactivate()
+    {
+        // the arrival just processed
+        ++_next;
+        if (_next != _end) arrEvt.post(Tick(_next->arrival));
+    }
+
+    void ReplayTask::handleArrival(Tick arr)
+    {
+        // the jobs of the lost arrivals are skipped
+        while (_job != _end && _job->arrival < arr) ++_job;
+        if (_job != _end) _demand = _job++->demand;
+        Task::handleArrival(arr);
+    }
+
+} // namespace RTSim
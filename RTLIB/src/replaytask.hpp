@@ -0,0 +1,179 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __REPLAYTASK_HPP__
+#define __REPLAYTASK_HPP__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <randomvar.hpp>
+
+#include <task.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    /**
+       \ingroup task
+
+       A log of the jobs of a real system (the task, the arrival
+       time and the execution time of each job), replayed by
+       ReplayTask objects.
+
+       The log is saved in a compact binary file, which is mapped
+       read-only in memory (with mmap(), where available, asking
+       the kernel to read it ahead; otherwise it is read as a
+       whole): the processes replaying the same log share its
+       pages, and no parsing is needed at startup. The file is
+       made of a 24 bytes header (the magic string "RTSIMWLD", the
+       version and the number of tasks, as 32-bit integers, and
+       the number of jobs, as a 64-bit integer), followed by the
+       directory of the tasks (id, then index and number of its
+       jobs, sorted by id) and by the jobs of each task, in order
+       of arrival (arrival and execution time, in ticks, as 64-bit
+       integers), in the byte order of the machine.
+    */
+    class WorkloadTrace {
+    public:
+        class Exc : public BaseExc {
+        public:
+            Exc(const string &msg) :
+                BaseExc(msg, "WorkloadTrace", "replaytask.cpp") {}
+        };
+
+        /// A job of the log
+        struct Job {
+            uint32_t task;
+            Tick arrival;
+            Tick demand;
+        };
+
+        /// A job of a task, as stored in the file
+        struct Record {
+            int64_t arrival;
+            int64_t demand;
+        };
+
+        /// Maps a binary file, created with save() or convert()
+        explicit WorkloadTrace(const string &binfile);
+
+        ~WorkloadTrace();
+
+        /// The jobs of task, sorted by arrival (none if the task
+        /// is not in the log)
+        const Record *begin(uint32_t task) const;
+        const Record *end(uint32_t task) const;
+
+        /// Number of tasks
+        size_t tasks() const { return _ntasks; }
+
+        /// Number of jobs
+        size_t size() const { return _njobs; }
+
+        /// Saves the jobs, in any order, in binary format
+        static void save(const vector<Job> &jobs, const string &binfile);
+
+        /**
+           Converts a text log (one job per line: task, arrival and
+           execution time, the times with an optional unit as in
+           Tick(const std::string &)) in the binary format.
+        */
+        static void convert(const string &textfile, const string &binfile);
+
+    private:
+        struct Entry {
+            uint32_t id;
+            uint32_t pad;
+            uint64_t first;
+            uint64_t count;
+        };
+
+        void *_map;
+        size_t _len;
+        string _copy;
+
+        const Entry *_dir;
+        const Record *_jobs;
+        size_t _ntasks;
+        size_t _njobs;
+
+        const Entry *find(uint32_t task) const;
+
+        WorkloadTrace(const WorkloadTrace &);
+        WorkloadTrace &operator=(const WorkloadTrace &);
+    };
+
+    /**
+       \ingroup task
+
+       A task whose jobs arrive at the times recorded in a
+       WorkloadTrace, each one executing for its recorded
+       execution time, in order: the recorded workload can be
+       simulated under different scheduling policies. The task
+       executes a single instruction, whose cost is the execution
+       time of the current job; its relative deadline is fixed.
+
+       When an arrival is lost (see Task::setArrivalPolicy()), its
+       execution time is skipped with it. After the last job of
+       the log, the task does not arrive any more. The trace must
+       outlive the task.
+
+       <pre>
+       WorkloadTrace w("log.bin");
+       ReplayTask t(w, 3, 10, "t3");
+       kern.addTask(t);
+       </pre>
+    */
+    class ReplayTask : public Task {
+        // the execution time of the current job
+        class DemandVar : public RandomVar {
+            const ReplayTask &_t;
+        public:
+            DemandVar(const ReplayTask &t) : _t(t) {}
+            virtual double get() { return double(_t._demand); }
+            virtual double getMaximum() throw(MaxException) { return double(_t._max); }
+            virtual double getMinimum() throw(MaxException) { return double(_t._min); }
+        };
+
+        const WorkloadTrace::Record *_first, *_end;
+        // the next arrival, and the next job to start
+        const WorkloadTrace::Record *_next, *_job;
+        Tick _demand, _min, _max;
+        DemandVar _cost;
+
+    protected:
+        virtual void reactivate();
+        virtual void handleArrival(Tick arrival);
+
+    public:
+        /// Replays the jobs of task id of w
+        ReplayTask(const WorkloadTrace &w, uint32_t id, Tick rdl,
+                   const string &name = "", long qs = 1000);
+
+        virtual void newRun();
+
+        /// Number of jobs in the log
+        size_t getJobs() const { return _end - _first; }
+
+        /// Execution time of the current job
+        Tick getDemand() const { return _demand; }
+    };
+
+} // namespace RTSim
+
+#endif
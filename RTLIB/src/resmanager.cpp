@@ -61,26 +61,27 @@ namespace RTSim {
         _res.push_back(r);
     }
 
-    bool ResManager::request(AbsRTTask *t, const string &name, int n) 
+    Resource *ResManager::getResource(const string &name) const
     {
-        DBGENTER(_RESMAN_DBG_LEV);
-
         Resource *r = dynamic_cast<Resource *>( Entity::_find(name) );
-        bool ret = request(t,r,n);
+        if (r == NULL) 
+            throw BaseExc("Resource " + name + " not found", 
+                          "ResManager", "resmanager.cpp");
+        return r;
+    }
 
-        
+    bool ResManager::request(AbsRTTask *t, const string &name, int n) 
+    {
+        DBGENTER(_RESMAN_DBG_LEV);
 
-        return ret;
+        return request(t, getResource(name), n);
     }
 
     void ResManager::release(AbsRTTask *t, const string &name, int n)
     {
         DBGENTER(_RESMAN_DBG_LEV);
 
-        Resource *r = dynamic_cast<Resource *>( Entity::_find(name) );
-        release(t,r,n);
-        
-        
+        release(t, getResource(name), n);
     }
 
 }
@@ -90,6 +90,20 @@ namespace RTSim {
          */
         void release(AbsRTTask *t, const std::string &name, int n=1);
 
+        /**
+           Returns the resource called name, so that the
+           instructions can resolve it once and then use the
+           handle-based request() and release(). Throws a
+           BaseExc if there is no such resource.
+        */
+        Resource *getResource(const std::string &name) const;
+
+        /// As request(t, name, n), on a resource returned by getResource()
+        virtual bool request(AbsRTTask *t, Resource *r, int n=1) = 0;
+
+        /// As release(t, name, n), on a resource returned by getResource()
+        virtual void release(AbsRTTask *t, Resource *r, int n=1) = 0;
+
         /*
          * Function called to specify that task t uses the resource called
          * name. This function is not necessary in simple resource managers,
@@ -117,9 +131,6 @@ namespace RTSim {
         void setKernel(AbsKernel *k, Scheduler *s);
 
         std::vector<Resource *> _res;
-
-        virtual bool request(AbsRTTask *t, Resource *r, int n=1) = 0;
-        virtual void release(AbsRTTask *t, Resource *r, int n=1) = 0;
     };
 } // namespace RTSim 
 
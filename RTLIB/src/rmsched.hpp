@@ -54,6 +54,16 @@ namespace RTSim {
                 }
             }
 
+            void saveState(Checkpoint &c) {
+                FPModel::saveState(c);
+                c.put(extP);
+            }
+
+            void loadState(Checkpoint &c) {
+                FPModel::loadState(c);
+                c.get(extP);
+            }
+
         };
 
     public:
@@ -65,7 +75,7 @@ namespace RTSim {
 
         void addTask(AbsRTTask *t, const std::string &p);
 
-        void removeTask(AbsRTTask *t) { }
+        void removeTask(AbsRTTask *t) { dropModel(t); }
     };
 
 }
@@ -30,7 +30,7 @@ namespace RTSim {
     }
 
     RRScheduler::RRScheduler(int defSlice) : 
-        Scheduler(), defaultSlice(defSlice), _rrEvt(this, &RRScheduler::round)
+        Scheduler(), defaultSlice(defSlice), _rrEvt(this)
     {
         DBGENTER(_RR_SCHED_DBG_LEV);
         DBGPRINT_2("DEFAULT SLICE = ", defaultSlice);
@@ -53,7 +53,10 @@ namespace RTSim {
         if (task != NULL) {
             RRModel* model = dynamic_cast<RRModel *>(find(task));
             if (model == 0) throw RRSchedExc("Cannot find task");
-            if (model->getRRSlice() > 0) {
+            // a task alone in the queue would only rotate with
+            // itself: the slice is armed by the next dispatch
+            // that finds a competitor
+            if (model->getRRSlice() > 0 && queueSize() > 1) {
                 _rrEvt.post(SIMUL.getTime() + model->getRRSlice());
                 DBGPRINT_2("rrEvt post at time ", 
                            SIMUL.getTime() + model->getRRSlice());
@@ -63,6 +66,27 @@ namespace RTSim {
         
     }
 
+    void RRScheduler::insert(AbsRTTask *task)
+    {
+        DBGENTER(_RR_SCHED_DBG_LEV);
+        Scheduler::insert(task);
+
+        if (queueSize() != 2 || _rrEvt.isInQueue()) return;
+
+        // the first task has been running alone, without slice
+        // timer: arm it at the end of its current slice
+        RRModel* first = dynamic_cast<RRModel *>(_queue.front());
+        Task* t = dynamic_cast<Task*>(first->getTask());
+        Tick slice = first->getRRSlice();
+        if (t == NULL || slice <= 0) return;
+
+        long int elapsed = SIMUL.getTime() - t->getLastSched();
+        long int n = elapsed > 0 ? (elapsed + long(slice) - 1) / long(slice) : 1;
+        Tick end = t->getLastSched() + n * slice;
+        _rrEvt.post(end);
+        DBGPRINT_2("rrEvt post at time ", end);
+    }
+
     void RRScheduler::round(Event *)
     {
         DBGENTER(_RR_SCHED_DBG_LEV);
@@ -72,8 +96,10 @@ namespace RTSim {
         if (model->isRoundExpired()) {
             DBGPRINT("Round expired");
             _queue.erase(model);
+            _extractCount++;
             if (model->isActive()) {
                 model->setInsertTime(SIMUL.getTime());
+                model->updateKey();
                 _queue.insert(model);
             }
         }
@@ -84,7 +110,7 @@ namespace RTSim {
 
         if (first != 0) {
             Tick slice = first->getRRSlice();
-            if (slice == 0) _rrEvt.drop();
+            if (slice == 0 || queueSize() == 1) _rrEvt.drop();
             else {
                 if (first != model || first->isRoundExpired()) {
                     _rrEvt.drop();
@@ -108,7 +134,7 @@ namespace RTSim {
         if (find(task) != NULL) 
             throw RRSchedExc("Element already present");
 	
-        _tasks[task] = model;
+        enqueueModel(model);
         
         model->setRRSlice(defaultSlice);
         DBGPRINT_2("Default slice set: ", defaultSlice); 
@@ -128,7 +154,7 @@ namespace RTSim {
         if (find(task) != NULL) 
             throw RRSchedExc("Element already present");
 	
-        _tasks[task] = model;
+        enqueueModel(model);
         
         int slice = 0;
         
@@ -78,8 +78,6 @@ namespace RTSim {
             bool isRoundExpired();
         };
 
-        GEvent<RRScheduler> _rrEvt;
-    
         int defaultSlice;
 
     public:
@@ -93,10 +91,19 @@ namespace RTSim {
         virtual void setRRSlice(AbsRTTask* task, Tick slice);
 
         /**
-           Notify to recompute the round
+           Notify to recompute the round. The slice timer is
+           posted only if another task is ready: the kernel calls
+           notify() again at the next dispatch, which starts a
+           full slice as it always did.
         */
         virtual void notify(AbsRTTask* task);
 
+        /**
+           Arms the slice timer of the running task, which was not
+           armed while the task was alone.
+        */
+        virtual void insert(AbsRTTask *task);
+
         /**
            This is called by the event rrEvt.
         */
@@ -106,9 +113,12 @@ namespace RTSim {
 
         void addTask(AbsRTTask *t, const std::string &p);
 
-        void removeTask(AbsRTTask *t) {}
+        void removeTask(AbsRTTask *t) { dropModel(t); }
 
         static RRScheduler *createInstance(vector<string> &par);
+
+    private:
+        StaticGEvent<RRScheduler, &RRScheduler::round> _rrEvt;
     };
 
 } // namespace RTSim
@@ -0,0 +1,244 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <basestat.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+#include <jobtrace.hpp>
+#include <modelfile.hpp>
+#include <rtsimc.h>
+#include <task.hpp>
+
+using namespace MetaSim;
+using namespace RTSim;
+
+// the C records are the C++ ones
+static_assert(sizeof(rtsim_job) == sizeof(JobRecord), "rtsim_job != JobRecord");
+static_assert(offsetof(rtsim_job, cpus) == offsetof(JobRecord, cpus), 
+              "rtsim_job != JobRecord");
+
+struct rtsim_model {
+    std::unique_ptr<SimContext> ctx;
+    std::unique_ptr<ModelFile> file;
+    std::unique_ptr<JobTrace> jobs;
+    std::vector<BaseStat *> stats;
+
+    rtsim_model() : ctx(new SimContext()), file(), jobs(), stats() {}
+
+    ~rtsim_model() {
+        SimContext::Scope scope(ctx.get());
+        // the tasks refer to the trace: they go first, with the
+        // arena of the context
+        file.reset();
+        ctx.reset();
+        jobs.reset();
+    }
+};
+
+namespace {
+    thread_local std::string lastError;
+
+    void fail(const std::string &msg) { lastError = msg; }
+
+    void fail(std::exception &e) { lastError = e.what(); }
+
+    rtsim_model *build(const std::string &what, bool isFile)
+    {
+        std::unique_ptr<rtsim_model> m(new rtsim_model());
+        try {
+            SimContext::Scope scope(m->ctx.get());
+            m->file.reset(new ModelFile());
+            if (isFile) m->file->load(what);
+            else m->file->parse(what, "model");
+            for (BaseStat::iterator i = BaseStat::begin(); i != BaseStat::end(); ++i)
+                m->stats.push_back(*i);
+        } catch (std::exception &e) {
+            fail(e);
+            return 0;
+        }
+        lastError.clear();
+        return m.release();
+    }
+
+    rtsim_buffer empty()
+    {
+        rtsim_buffer b = {0, 0, 0};
+        return b;
+    }
+
+    const rtsim_field JOB_FIELDS[] = {
+        {"task", 'i', 4, offsetof(rtsim_job, task)},
+        {"preemptions", 'u', 2, offsetof(rtsim_job, preemptions)},
+        {"flags", 'u', 2, offsetof(rtsim_job, flags)},
+        {"arrival", 'i', 8, offsetof(rtsim_job, arrival)},
+        {"deadline", 'i', 4, offsetof(rtsim_job, deadline)},
+        {"start", 'i', 4, offsetof(rtsim_job, start)},
+        {"finish", 'i', 4, offsetof(rtsim_job, finish)},
+        {"executed", 'i', 4, offsetof(rtsim_job, executed)},
+        {"cpus", 'u', 8, offsetof(rtsim_job, cpus)},
+    };
+}
+
+extern "C" {
+
+int rtsim_version(void)
+{
+    return RTSIM_C_VERSION;
+}
+
+const char *rtsim_last_error(void)
+{
+    return lastError.c_str();
+}
+
+rtsim_model *rtsim_model_parse(const char *text)
+{
+    if (!text) {
+        fail("no text");
+        return 0;
+    }
+    return build(text, false);
+}
+
+rtsim_model *rtsim_model_load(const char *fname)
+{
+    if (!fname) {
+        fail("no file name");
+        return 0;
+    }
+    return build(fname, true);
+}
+
+void rtsim_model_free(rtsim_model *m)
+{
+    delete m;
+}
+
+int rtsim_trace_jobs(rtsim_model *m, int on)
+{
+    SimContext::Scope scope(m->ctx.get());
+    // the events keep a pointer to the trace: it is never detached,
+    // only filtered out
+    if (!on) {
+        if (m->jobs) m->jobs->setWindow(MAXTICK, MAXTICK);
+        return 0;
+    }
+    try {
+        if (!m->jobs) {
+            m->jobs.reset(new JobTrace("jobs", false));
+            const std::vector<Task *> &tasks = m->file->getTasks();
+            for (size_t i = 0; i < tasks.size(); ++i) m->jobs->attachToTask(tasks[i]);
+        }
+        m->jobs->clearFilters();
+    } catch (std::exception &e) {
+        fail(e);
+        return -1;
+    }
+    return 0;
+}
+
+int rtsim_run(rtsim_model *m, int64_t length, int runs)
+{
+    if (length <= 0 || runs < 1) {
+        fail("the length and the runs must be positive");
+        return -1;
+    }
+    SimContext::Scope scope(m->ctx.get());
+    try {
+        if (m->jobs) m->jobs->clear();
+        Simulation &s = m->ctx->simulation();
+        s.initRuns(runs);
+        for (int i = 0; i < runs; ++i) {
+            s.initSingleRun();
+            s.run_to(Tick(length));
+            s.endSingleRun();
+        }
+        s.endSim();
+    } catch (std::exception &e) {
+        m->ctx->simulation().clearEventQueue();
+        fail(e);
+        return -1;
+    }
+    return 0;
+}
+
+size_t rtsim_stat_count(const rtsim_model *m)
+{
+    return m->stats.size();
+}
+
+const char *rtsim_stat_name(const rtsim_model *m, size_t i)
+{
+    if (i >= m->stats.size()) return 0;
+    return m->stats[i]->getName().c_str();
+}
+
+double rtsim_stat_mean(const rtsim_model *m, size_t i)
+{
+    if (i >= m->stats.size() || m->stats[i]->getRunData().empty()) return 0;
+    SimContext::Scope scope(m->ctx.get());
+    return m->stats[i]->getMean();
+}
+
+double rtsim_stat_conf(const rtsim_model *m, size_t i)
+{
+    if (i >= m->stats.size() || m->stats[i]->getRunData().size() < 3) return 0;
+    SimContext::Scope scope(m->ctx.get());
+    return m->stats[i]->getConfInterval();
+}
+
+rtsim_buffer rtsim_stat_runs(const rtsim_model *m, size_t i)
+{
+    if (i >= m->stats.size()) return empty();
+    const std::vector<double> &v = m->stats[i]->getRunData();
+    rtsim_buffer b = {v.empty() ? 0 : &v[0], v.size(), sizeof(double)};
+    return b;
+}
+
+size_t rtsim_task_count(const rtsim_model *m)
+{
+    return m->file->getTasks().size();
+}
+
+const char *rtsim_task_name(const rtsim_model *m, size_t i)
+{
+    if (i >= m->file->getTasks().size()) return 0;
+    return m->file->getTasks()[i]->getName().c_str();
+}
+
+int32_t rtsim_task_id(const rtsim_model *m, size_t i)
+{
+    if (i >= m->file->getTasks().size()) return -1;
+    return m->file->getTasks()[i]->getID();
+}
+
+rtsim_buffer rtsim_jobs(const rtsim_model *m)
+{
+    if (!m->jobs) return empty();
+    const std::vector<JobRecord> &v = m->jobs->getData();
+    rtsim_buffer b = {v.empty() ? 0 : &v[0], v.size(), sizeof(JobRecord)};
+    return b;
+}
+
+const rtsim_field *rtsim_job_fields(size_t *n)
+{
+    if (n) *n = sizeof(JOB_FIELDS) / sizeof(JOB_FIELDS[0]);
+    return JOB_FIELDS;
+}
+
+} // extern "C"
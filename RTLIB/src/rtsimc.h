@@ -0,0 +1,131 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __RTSIMC_H__
+#define __RTSIMC_H__
+
+/*
+  The C interface of RTSim, for the languages that load a shared
+  library through a foreign function interface (Python ctypes or
+  cffi, R .C, ...).
+
+  A model is built from the text of a model file (see the
+  ModelFile class), in its own simulation context, and run. The
+  results are returned as buffers that point into the memory of
+  the model, without copying: element i of a buffer is at
+  (const char *) data + i * stride, and it stays valid until the
+  model is run again or freed.
+
+      rtsim_model *m = rtsim_model_load("model.txt");
+      if (!m) puts(rtsim_last_error());
+      rtsim_trace_jobs(m, 1);
+      rtsim_run(m, 100000, 1);
+      rtsim_buffer jobs = rtsim_jobs(m);     // rtsim_job records
+      rtsim_buffer ft = rtsim_stat_runs(m, 0);   // doubles, one per run
+      rtsim_model_free(m);
+
+  The functions that can fail return NULL or -1, and set the
+  message returned by rtsim_last_error() (one per thread). A
+  model must be used by one thread at a time; different models
+  can run on different threads.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The version of this interface: it changes only if the layout
+   of the structures or the meaning of a function changes. */
+#define RTSIM_C_VERSION 1
+
+typedef struct rtsim_model rtsim_model;
+
+/* A typed array in the memory of a model */
+typedef struct rtsim_buffer {
+    const void *data;
+    size_t length;
+    size_t stride;
+} rtsim_buffer;
+
+/* The record of a job (the layout of RTSim::JobRecord): the
+   times, except the arrival, are relative to the arrival */
+typedef struct rtsim_job {
+    int32_t task;
+    uint16_t preemptions;
+    uint16_t flags;          /* 1 == killed */
+    int64_t arrival;
+    int32_t deadline;
+    int32_t start;
+    int32_t finish;
+    int32_t executed;
+    uint64_t cpus;           /* the processors used (the first 64) */
+} rtsim_job;
+
+/* A field of a record, to describe it to a numerical library
+   (e.g. a numpy dtype): type is 'i' (signed) or 'u' (unsigned),
+   size in bytes */
+typedef struct rtsim_field {
+    const char *name;
+    char type;
+    int size;
+    size_t offset;
+} rtsim_field;
+
+int rtsim_version(void);
+
+/* The last error of the calling thread ("" if none) */
+const char *rtsim_last_error(void);
+
+/* Builds a model from the text of a model file, or from a file */
+rtsim_model *rtsim_model_parse(const char *text);
+rtsim_model *rtsim_model_load(const char *fname);
+
+void rtsim_model_free(rtsim_model *m);
+
+/* Records the jobs of all the tasks of the model in the next runs
+   (on != 0), see rtsim_jobs() */
+int rtsim_trace_jobs(rtsim_model *m, int on);
+
+/* Runs the model runs times, each time up to length ticks;
+   the stats and the jobs of previous runs are discarded */
+int rtsim_run(rtsim_model *m, int64_t length, int runs);
+
+/* The stats declared by the model, in order of declaration */
+size_t rtsim_stat_count(const rtsim_model *m);
+const char *rtsim_stat_name(const rtsim_model *m, size_t i);
+double rtsim_stat_mean(const rtsim_model *m, size_t i);
+/* half-width of the 95% confidence interval (0 with less than 3 runs) */
+double rtsim_stat_conf(const rtsim_model *m, size_t i);
+/* the value of stat i in every run (doubles) */
+rtsim_buffer rtsim_stat_runs(const rtsim_model *m, size_t i);
+
+/* The tasks of the model, in order of declaration, and the
+   number that identifies them in the job records */
+size_t rtsim_task_count(const rtsim_model *m);
+const char *rtsim_task_name(const rtsim_model *m, size_t i);
+int32_t rtsim_task_id(const rtsim_model *m, size_t i);
+
+/* The jobs of the last runs (rtsim_job records) */
+rtsim_buffer rtsim_jobs(const rtsim_model *m);
+
+/* The fields of rtsim_job, n of them */
+const rtsim_field *rtsim_job_fields(size_t *n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,6 +12,31 @@ namespace RTSim {
     {
     }
 
+    void PeriodicTask::setPeriod(Tick p)
+    {
+        period = p;
+        delete changeIAT(new DeltaVar(p));
+    }
+
+    Tick PeriodicTask::hyperperiod(const vector<PeriodicTask *> &tasks)
+    {
+        long int h = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            long int p = tasks[i]->getPeriod();
+            if (h == 0) h = p;
+            else {
+                long int a = h, b = p;
+                while (b != 0) {
+                    long int r = a % b;
+                    a = b;
+                    b = r;
+                }
+                h = h / a * p;
+            }
+        }
+        return Tick(h);
+    }
+
     PeriodicTask* PeriodicTask::createInstance(vector<string>& par)
     {
 	Tick i = Tick(par[0]);
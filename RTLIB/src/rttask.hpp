@@ -41,6 +41,21 @@ namespace RTSim {
                      const std::string &name = "", long qs = 100);
 	
         inline Tick getPeriod() { return period; } 
+
+        /**
+           Changes the period of the task (between two runs, see
+           Task::setPhase()). The relative deadline does not
+           change: call setRelDline() too if it must follow the
+           period.
+        */
+        void setPeriod(Tick p);
+
+        /**
+           Returns the least common multiple of the periods of the
+           tasks (0 if there are none), the period to give to
+           Simulation::setFastForward().
+        */
+        static Tick hyperperiod(const std::vector<PeriodicTask *> &tasks);
 	
 	
         /** Used to build tasks with the Factory.  The string
@@ -0,0 +1,144 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <sampledtrace.hpp>
+#include <task.hpp>
+#include <taskevt.hpp>
+
+namespace RTSim {
+
+  SampledTrace::SampledTrace(Trace &trace, const string &name, unsigned long n,
+                             double fraction, RandNum seed)
+    : Trace(name, Trace::ASCII, true), _trace(trace), _every(n == 0 ? 1 : n),
+      _fraction(fraction), _seed(seed), _gen(seed), _tasks(), _closed(false),
+      _last(0)
+  {
+  }
+
+  SampledTrace::~SampledTrace()
+  {
+    if (!_closed && _os.is_open()) close();
+  }
+
+  SampledTrace::TaskInfo &SampledTrace::info(Task *t)
+  {
+    size_t id = t->getID();
+    if (id >= _tasks.size()) {
+      TaskInfo empty = { NULL, false, 0, 0, 0, deque<int64_t>(), false };
+      _tasks.resize(2 * id + 1, empty);
+    }
+    TaskInfo &ti = _tasks[id];
+    if (ti.task == NULL) {
+      // drawn on the stream of the task, whatever the order
+      _gen.init(_seed);
+      _gen.setStream(id);
+      ti.task = t;
+      ti.selected = _gen.uniform(0, 1) < _fraction;
+      ti.phase = _gen.sample() % _every;
+    }
+    return ti;
+  }
+
+  void SampledTrace::attachToTask(Task *t)
+  {
+    info(t);
+    t->setTrace(this);
+    t->killEvt.addTrace(this);
+    t->deadEvt.addTrace(this);
+  }
+
+  void SampledTrace::startJob(TaskInfo &ti)
+  {
+    // the arrivals lost before this job are skipped
+    int64_t a = int64_t(ti.task->getArrival());
+    while (!ti.pending.empty() && ti.pending.front() < a) ti.pending.pop_front();
+    ti.current = !ti.pending.empty() && ti.pending.front() == a;
+    if (ti.current) ti.pending.pop_front();
+  }
+
+  void SampledTrace::record(Event *e)
+  {
+    if (!TaskEvt::isTaskEvt(e)) return;
+    TaskEvt *ee = static_cast<TaskEvt *>(e);
+    Task *task = ee->getTask();
+    if (task == NULL) return;
+
+    // a new run: the jobs of the previous one never started
+    Tick now = e->getLastTime();
+    if (now < _last)
+      for (size_t i = 0; i < _tasks.size(); ++i) {
+        _tasks[i].pending.clear();
+        _tasks[i].current = false;
+      }
+    _last = now;
+
+    // the arrivals of all the tasks are counted, for the scale
+    TaskInfo &ti = info(task);
+    bool arrival = ee->getKind() == TaskEvt::ARR_EVT;
+    if (!ti.selected) {
+      if (arrival) ti.arrivals++;
+      return;
+    }
+
+    bool pass;
+    switch (ee->getKind()) {
+    case TaskEvt::ARR_EVT: {
+      pass = (ti.arrivals++ % _every) == ti.phase;
+      if (pass) {
+        ti.sampled++;
+        ti.pending.push_back(int64_t(now));
+      }
+      // not buffered: the job has started
+      if (task->getArrival() == now) startJob(ti);
+      break;
+    }
+    case TaskEvt::FAKE_ARR_EVT:
+      startJob(ti);
+      pass = ti.current;
+      break;
+    default:
+      pass = ti.current;
+      break;
+    }
+
+    if (pass && _trace.accepts(e)) _trace.record(e);
+  }
+
+  double SampledTrace::getScale() const
+  {
+    unsigned long arr = 0, smp = 0;
+    for (size_t i = 0; i < _tasks.size(); ++i) {
+      if (_tasks[i].task == NULL) continue;
+      arr += _tasks[i].arrivals;
+      smp += _tasks[i].sampled;
+    }
+    return smp == 0 ? 1.0 : double(arr) / smp;
+  }
+
+  void SampledTrace::close()
+  {
+    if (_closed) return;
+    _closed = true;
+
+    _os << "sample jobs " << _every << " tasks " << _fraction
+        << " seed " << _seed << endl;
+    for (size_t i = 0; i < _tasks.size(); ++i) {
+      const TaskInfo &ti = _tasks[i];
+      if (ti.task == NULL) continue;
+      _os << "task " << i << " " << ti.task->getName() << " "
+          << ti.selected << " " << ti.arrivals << " " << ti.sampled << endl;
+    }
+    Trace::close();
+  }
+
+} // namespace RTSim
@@ -0,0 +1,118 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SAMPLEDTRACE_HPP__
+#define __SAMPLEDTRACE_HPP__
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <randomvar.hpp>
+#include <trace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  class Task;
+
+  /**
+     \ingroup util
+
+     Passes to another trace the events of a sample of the jobs:
+     one job every n of each task (the job whose arrival is the
+     k-th of the task, for k = phase, phase + n, ...), of a
+     fraction of the tasks. The tasks and the phase of each one
+     are chosen with a generator of its own (a Pcg32Gen, on the
+     stream of the task ID), so that the streams of the
+     simulation are not perturbed, and the sample does not
+     depend on the order in which the tasks are attached.
+
+     All the events of a sampled job (including its arrival,
+     even if it is buffered) are passed on, those of the other
+     jobs are dropped. At the end (see close()), the file of
+     the sampled trace receives the metadata of the sample, in
+     text: the parameters, and the number of arrivals and of
+     sampled arrivals of each task, to scale the counts taken
+     from the trace:
+
+     <pre>
+     sample jobs 10 tasks 0.25 seed 1
+     task <id> <name> <selected> <arrivals> <sampled>
+     ...
+     </pre>
+
+     <pre>
+     JavaTrace jt("trace.trc");
+     SampledTrace st(jt, "trace.sample", 10, 0.25);
+     for (Task *t : tasks) st.attachToTask(t);
+     </pre>
+  */
+  class SampledTrace : public virtual Trace {
+    struct TaskInfo {
+      Task *task;
+      bool selected;
+      unsigned long phase;
+      unsigned long arrivals, sampled;
+      /// the sampled arrivals not yet started
+      deque<int64_t> pending;
+      /// true if the current job is sampled
+      bool current;
+    };
+
+    Trace &_trace;
+    unsigned long _every;
+    double _fraction;
+    RandNum _seed;
+    Pcg32Gen _gen;
+    vector<TaskInfo> _tasks;
+    bool _closed;
+    Tick _last;
+
+    TaskInfo &info(Task *t);
+    void startJob(TaskInfo &ti);
+
+  public:
+    /**
+       Samples for trace one job every n of a fraction of the
+       tasks; the metadata are written on the file name.
+    */
+    SampledTrace(Trace &trace, const string &name, unsigned long n,
+                 double fraction = 1.0, RandNum seed = 1);
+    virtual ~SampledTrace();
+
+    /// Traces the events of t (as Task::setTrace()), and its kills
+    void attachToTask(Task *t);
+
+    virtual void record(Event *e);
+
+    /// Writes the metadata, and closes the file
+    virtual void close();
+
+    /// True if t is in the sample of tasks
+    bool isSelected(Task *t) { return info(t).selected; }
+
+    /**
+       The ratio between the arrivals of all the tasks and the
+       sampled ones (1 if none has been sampled): the factor
+       that scales a count taken from the trace.
+    */
+    double getScale() const;
+  };
+
+} // namespace RTSim
+
+#endif
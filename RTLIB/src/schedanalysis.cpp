@@ -0,0 +1,218 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cmath>
+#include <thread>
+
+#include <load.hpp>
+#include <schedanalysis.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    namespace analysis {
+
+        static Tick at(const Tick *v, int i) { return v[i]; }
+
+        Tick responseTime(const Tick *C, const Tick *T, int i, Tick limit)
+        {
+            return responseTime(i, 0, limit, 
+                                [C](int j) { return at(C, j); },
+                                [T](int j) { return at(T, j); });
+        }
+
+        bool rtaTest(const Tick *C, const Tick *T, const Tick *D, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                if (responseTime(C, T, i, D[i]) > D[i]) return false;
+            return true;
+        }
+
+        void schedulingPoints(Tick d, const Tick *T, int i, vector<Tick> &p)
+        {
+            p.clear();
+            p.push_back(d);
+            for (int j = i - 1; j >= 0; --j) {
+                size_t n = p.size();
+                for (size_t h = 0; h < n; ++h) {
+                    Tick x = p[h] / long(T[j]) * T[j];
+                    if (x > 0) p.push_back(x);
+                }
+            }
+            sort(p.begin(), p.end());
+            p.erase(unique(p.begin(), p.end()), p.end());
+        }
+
+        bool schedPointTest(const Tick *C, const Tick *T, const Tick *D, int n)
+        {
+            vector<Tick> p;
+            for (int i = 0; i < n; ++i) {
+                schedulingPoints(D[i], T, i, p);
+                bool ok = false;
+                for (size_t h = 0; !ok && h < p.size(); ++h) {
+                    Tick w = C[i];
+                    for (int j = 0; j < i; ++j)
+                        w += (p[h] + T[j] - 1) / long(T[j]) * C[j];
+                    ok = w <= p[h];
+                }
+                if (!ok) return false;
+            }
+            return true;
+        }
+
+        Tick demand(const Tick *C, const Tick *T, const Tick *D, int n, Tick t)
+        {
+            Tick h = 0;
+            for (int i = 0; i < n; ++i)
+                if (t >= D[i]) h += ((t - D[i]) / long(T[i]) + 1) * C[i];
+            return h;
+        }
+
+        /// the largest absolute deadline smaller than t, or 0
+        static Tick prevDeadline(const Tick *T, const Tick *D, int n, Tick t)
+        {
+            Tick d = 0;
+            for (int i = 0; i < n; ++i)
+                if (D[i] < t) 
+                    d = max(d, Tick((t - D[i] - 1) / long(T[i]) * T[i] + D[i]));
+            return d;
+        }
+
+        bool qpaTest(const Tick *C, const Tick *T, const Tick *D, int n)
+        {
+            if (n == 0) return true;
+
+            double u = 0, slack = 0;
+            Tick dmin = D[0], dmax = D[0];
+            Tick w = 0;
+            for (int i = 0; i < n; ++i) {
+                u += double(C[i]) / double(T[i]);
+                slack += double(T[i] - D[i]) * double(C[i]) / double(T[i]);
+                dmin = min(dmin, D[i]);
+                dmax = max(dmax, D[i]);
+                w += C[i];
+            }
+            if (u > 1) return false;
+
+            // the synchronous busy period bounds the interval to
+            // check, and so does La (Zhang and Burns) when u < 1: it
+            // is much shorter when u is close to 1 and the deadlines
+            // close to the periods
+            double la = u < 1 ? max(double(dmax), slack / (1 - u)) : 0;
+            Tick l;
+            do {
+                l = w;
+                if (u < 1 && double(l) >= la) {
+                    l = Tick(std::ceil(la));
+                    break;
+                }
+                w = 0;
+                for (int i = 0; i < n; ++i)
+                    w += (l + T[i] - 1) / long(T[i]) * C[i];
+            } while (w > l);
+
+            Tick t = prevDeadline(T, D, n, l + 1);
+            Tick h = demand(C, T, D, n, t);
+            while (h <= t && h > dmin) {
+                if (h < t) t = h;
+                else t = prevDeadline(T, D, n, t);
+                h = demand(C, T, D, n, t);
+            }
+            return h <= dmin;
+        }
+    }
+
+    TaskSetBatch::TaskSetBatch() : _c(), _t(), _d(), _first(1, 0), _device(0)
+    {
+        // the devices copy the parameters as arrays of 64-bit integers
+        static_assert(sizeof(Tick) == sizeof(int64_t), "Tick is not 64 bits");
+    }
+
+    void TaskSetBatch::addTask(Tick c, Tick t, Tick d)
+    {
+        _c.push_back(c);
+        _t.push_back(t);
+        _d.push_back(d);
+    }
+
+    void TaskSetBatch::endSet()
+    {
+        _first.push_back(_c.size());
+    }
+
+    void TaskSetBatch::add(const RandomTaskSetFactory &f)
+    {
+        for (int i = 0; i < f.size(); ++i) 
+            addTask(f.getMaxCT(i), f.getMinIAT(i), f.getDeadline(i));
+        endSet();
+    }
+
+    size_t TaskSetBatch::addSets(size_t nsets, int n)
+    {
+        size_t k = size();
+        _c.resize(_c.size() + nsets * n);
+        _t.resize(_t.size() + nsets * n);
+        _d.resize(_d.size() + nsets * n);
+        for (size_t j = 0; j < nsets; ++j) 
+            _first.push_back(_first.back() + n);
+        return k;
+    }
+
+    void TaskSetBatch::clear()
+    {
+        _c.clear();
+        _t.clear();
+        _d.clear();
+        _first.assign(1, 0);
+    }
+
+    bool TaskSetBatch::analyze(test_t test, size_t k) const
+    {
+        int n = getSize(k);
+        if (n == 0) return true;
+        switch (test) {
+        case RTA: return analysis::rtaTest(getC(k), getT(k), getD(k), n);
+        case SCHED_POINTS: return analysis::schedPointTest(getC(k), getT(k), getD(k), n);
+        case QPA: return analysis::qpaTest(getC(k), getT(k), getD(k), n);
+        }
+        return false;
+    }
+
+    void TaskSetBatch::analyze(test_t test, vector<char> &res, unsigned nthreads) const
+    {
+        res.assign(size(), 0);
+        if (size() > 0 && _device != 0 && _device->available() &&
+            _device->analyze(*this, test, res))
+            return;
+
+        if (nthreads == 0) nthreads = max(1u, thread::hardware_concurrency());
+        nthreads = min<size_t>(nthreads, size());
+
+        // the sets are divided in contiguous slices, so that every
+        // thread writes its own part of res
+        auto run = [this, test, &res](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k) res[k] = analyze(test, k);
+        };
+        if (nthreads <= 1) {
+            run(0, size());
+            return;
+        }
+        vector<thread> threads;
+        size_t slice = (size() + nthreads - 1) / nthreads;
+        for (size_t first = 0; first < size(); first += slice)
+            threads.push_back(thread(run, first, min(first + slice, size())));
+        for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    }
+
+} // namespace RTSim
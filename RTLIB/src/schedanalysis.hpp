@@ -0,0 +1,215 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SCHEDANALYSIS_HPP__
+#define __SCHEDANALYSIS_HPP__
+
+#include <algorithm>
+#include <vector>
+
+#include <basetype.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    class RandomTaskSetFactory;
+    class TaskSetBatch;
+
+    /**
+       \ingroup util
+
+       Schedulability tests on task sets described by arrays of
+       computation times C, periods (or minimum interarrival times)
+       T and relative deadlines D, with D <= T. The fixed priority
+       tests take the tasks in decreasing priority order. These are
+       the same computations made by the supervisors (SchedRTA,
+       SchedPoint, ...) on the live servers, and they can be used
+       to analyse many task sets without simulating them.
+    */
+    namespace analysis {
+
+        /**
+           Response time of task i under fixed priorities, tasks 0 to
+           i-1 having higher priority. C(j) and T(j) return the
+           computation time and the period of task j. The iteration
+           starts from r, which must not exceed the response time
+           (0 or the response time for smaller computation times
+           are fine), and it stops as soon as the response time
+           exceeds limit.
+        */
+        template <class Cost, class Period>
+        Tick responseTime(int i, Tick r, Tick limit, Cost C, Period T)
+        {
+            Tick r_cur;
+            Tick r_new = std::max(r, Tick(C(i)));
+            do {
+                r_cur = r_new;
+                r_new = C(i);
+                for (int j = 0; j < i; ++j)
+                    // This is a ceil()
+                    r_new += (r_cur + T(j) - 1) / long(T(j)) * C(j);
+            } while (r_new > r_cur && r_new <= limit);
+            return r_new;
+        }
+
+        /// Response time of task i (see above), from scratch
+        Tick responseTime(const Tick *C, const Tick *T, int i, Tick limit);
+
+        /// Response time analysis of n tasks under fixed priorities
+        bool rtaTest(const Tick *C, const Tick *T, const Tick *D, int n);
+
+        /**
+           Fills p with the scheduling points, in increasing order,
+           of a task with deadline d and higher priority tasks with
+           periods T[0] ... T[i-1].
+        */
+        void schedulingPoints(Tick d, const Tick *T, int i, std::vector<Tick> &p);
+
+        /// Scheduling-points test of n tasks under fixed priorities
+        bool schedPointTest(const Tick *C, const Tick *T, const Tick *D, int n);
+
+        /// The demand-bound function of n tasks in an interval of length t
+        Tick demand(const Tick *C, const Tick *T, const Tick *D, int n, Tick t);
+
+        /**
+           Quick Processor-demand Analysis (Zhang and Burns) of n
+           tasks under EDF.
+        */
+        bool qpaTest(const Tick *C, const Tick *T, const Tick *D, int n);
+    }
+
+    /**
+       \ingroup util
+
+       A device (e.g. a GPU) that runs the tests of a whole
+       TaskSetBatch at once, installed with
+       TaskSetBatch::setDevice(). The parameters of the sets are
+       already laid out for a copy to the device: three contiguous
+       arrays of 64-bit integers (see TaskSetBatch::getC()), and
+       the index of the first task of each set (see
+       TaskSetBatch::getFirst()), so that each set can be given
+       to a block of threads. A device must give the same results
+       of the functions in namespace analysis.
+    */
+    class AnalysisDevice {
+    public:
+        virtual ~AnalysisDevice() {}
+
+        /// The name of the device, for the logs
+        virtual const char *getName() const = 0;
+
+        /// False if the device is not present, or cannot be used
+        virtual bool available() const = 0;
+
+        /**
+           Runs test (a TaskSetBatch::test_t) on all the sets of
+           batch, storing the result of set k in res[k] (already
+           sized). Returns false if it cannot (e.g. the batch does
+           not fit in its memory): the batch is then analysed on
+           the processors.
+        */
+        virtual bool analyze(const TaskSetBatch &batch, int test,
+                             std::vector<char> &res) = 0;
+    };
+
+    /**
+       \ingroup util
+
+       A batch of task sets to be analysed together, stored as a
+       structure of arrays: the parameters of all the tasks of all
+       the sets are in three vectors, one set after the other.
+
+       <pre>
+       TaskSetBatch batch;
+       for (int k = 0; k < n; ++k) {
+           factory.renormalize(u);   // or any other generation
+           batch.add(factory);
+       }
+       std::vector<char> ok;
+       batch.analyze(TaskSetBatch::RTA, ok);
+       </pre>
+    */
+    class TaskSetBatch {
+        std::vector<Tick> _c, _t, _d;
+        /// the first task of each set, plus the end of the last set
+        std::vector<size_t> _first;
+        AnalysisDevice *_device;
+
+    public:
+        typedef enum { RTA, SCHED_POINTS, QPA } test_t;
+
+        TaskSetBatch();
+
+        /// Adds a task to the set being built
+        void addTask(Tick c, Tick t, Tick d);
+
+        /// Closes the set being built, and starts a new one
+        void endSet();
+
+        /**
+           Adds the task set generated by f (worst-case computation
+           times, minimum interarrival times and deadlines)
+        */
+        void add(const RandomTaskSetFactory &f);
+
+        /**
+           Appends nsets sets of n tasks each, with all the
+           parameters to 0, to be filled through getC(), getT() and
+           getD(). Returns the index of the first new set.
+        */
+        size_t addSets(size_t nsets, int n);
+
+        /// Removes all the task sets
+        void clear();
+
+        /// Number of (closed) task sets
+        size_t size() const { return _first.size() - 1; }
+
+        /// Number of tasks of set k
+        int getSize(size_t k) const { return _first[k + 1] - _first[k]; }
+
+        const Tick *getC(size_t k) const { return &_c[0] + _first[k]; }
+        const Tick *getT(size_t k) const { return &_t[0] + _first[k]; }
+        const Tick *getD(size_t k) const { return &_d[0] + _first[k]; }
+        Tick *getC(size_t k) { return &_c[0] + _first[k]; }
+        Tick *getT(size_t k) { return &_t[0] + _first[k]; }
+        Tick *getD(size_t k) { return &_d[0] + _first[k]; }
+
+        /// The first task of each set, plus the end of the last set
+        const std::vector<size_t> &getFirst() const { return _first; }
+
+        /**
+           Analyses the batches on device d, when it is available,
+           instead of on the processors (NULL, the default, to use
+           only the processors). The device is not owned.
+        */
+        void setDevice(AnalysisDevice *d) { _device = d; }
+
+        AnalysisDevice *getDevice() const { return _device; }
+
+        /// Runs test on set k
+        bool analyze(test_t test, size_t k) const;
+
+        /**
+           Runs test on all the sets, on the device if there is one
+           available, otherwise dividing them among nthreads threads
+           (0 means one per core). The result of set k is stored in
+           res[k].
+        */
+        void analyze(test_t test, std::vector<char> &res, unsigned nthreads = 0) const;
+    };
+
+} // namespace RTSim
+
+#endif
@@ -20,7 +20,10 @@ namespace RTSim {
 
     SchedInstr::SchedInstr(Task * f, const string& s, char *n)
         : Instr(f, n), _endEvt(this), _threEvt(f, this) 
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     Instr* SchedInstr::createInstance(vector<string> &par)
     {
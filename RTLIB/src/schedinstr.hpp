@@ -43,7 +43,7 @@ namespace RTSim {
   protected:
     SchedInstr * ti;
   public:
-    SchedIEvt(Task* t, SchedInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3), ti(in)
+    SchedIEvt(Task* t, SchedInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3, SCHEDI_EVT), ti(in)
     {}
     SchedInstr *getInstr() {return ti;} 
     virtual void doit() {}
@@ -3,6 +3,7 @@
 #include <math.h>
 #include <sporadicserver.hpp>
 #include <algorithm>
+#include <schedanalysis.hpp>
 
 namespace RTSim {
 
@@ -19,12 +20,14 @@ namespace RTSim {
 	period.push_back(pp);
         wcet.push_back(cc);
         U.push_back(double(cc)/double(pp));
+        _memo.clear();
     }
 
     SchedPoint::SchedPoint(const string &name) : 
         Entity(name), counter(0), 
         last_change_time(0), servers(), period(), wcet(), lambdas(),
-        OneTaskConstraints(), exactConstraints(), schedpoints(), U(), task(0) 
+        coeffs(), _firstRow(), _stride(0), schedpoints(), U(), task(0),
+        _changeEvt(), _memo()
     {    
     }
     
@@ -48,7 +51,12 @@ namespace RTSim {
 
         if (delta_budget > 0) {
             DBGPRINT("Positive part");
-            lambda = sensitivity(index);  
+            const double *l = _memo.find(index, wcet);
+            if (l != 0) lambda = *l;
+            else {
+                lambda = sensitivity(index);
+                _memo.insert(index, wcet, lambda);
+            }
 	    DBGVAR(lambda);
             if (double(delta_budget)/double(period[index]) <= lambda){
                 DBGPRINT("Less than or equal to lambda");
@@ -82,8 +90,7 @@ namespace RTSim {
                 DBGPRINT_2("delta_budget < 0, new change time at ", last_change_time);
             }
 	    else if (delta_budget > 0) {
-                ChangeBudgetEvt *e = new ChangeBudgetEvt(this, s, delta_budget + s->getBudget());
-                e->post(last_change_time, true);
+                _changeEvt.add(s, delta_budget + s->getBudget(), last_change_time);
                 DBGPRINT_2("delta_budget > 0, new change time at ", last_change_time);
             }
         }
@@ -91,114 +98,54 @@ namespace RTSim {
         return delta_budget;
     }
 
-    void SchedPoint::onChangeBudget(ChangeBudgetEvt *e)
-    {
-        DBGPRINT("SchedPoint::onChangeBudget(ChangeBudgetEvt *e)");
-        Server *ss = e->getServer();
-        ss->changeBudget(e->getBudget());
-    }
-
     
     SchedPoint::row_t SchedPoint::SetP(int D, const row_t &period, int task)
     {
-
         //task is the task being analysed
-        int n = task;
-        row_t schp, schP;
-        row_t  aux;
-	schp.clear();
-        schp.push_back(D);
-
-	DBGPRINT("Computing scheduling points" << n);
-        
-	for (int i=n-1;i>-1;i--) {
-          // for (int i=0;i<n;i++){  
-            DBGPRINT("Computing aux for i=" << i); 
-            for (int j=0;j<(int)schp.size();j++) {
-                Tick p = Tick::floor(floor(double(schp[j])/double(period[i]))*
-                                     double(period[i]));
-                if (p>0)
-                    aux.push_back(p);
-            }
-
-            DBGVECTOR(aux);
-
-            for (int j=0;j<(int)aux.size();j++) 
-                schp.push_back(aux[j]);
-
-            aux.clear();
-
-        } 
-	  DBGPRINT("Schedp son");   
-	 DBGVECTOR(schp);
-
-	sort(schp.begin(), schp.end());
-	schP.push_back(schp[0]);
-
-	for (int h=1;h<int(schp.size());h++)
-            if (schp[h]!=schp[h-1])
-	    	schP.push_back(schp[h]);
-		DBGPRINT("Schedp ordenados y sin repeticion son");  
-	 DBGVECTOR(schP);
+        row_t schP;
+	DBGPRINT("Computing scheduling points" << task);
+        analysis::schedulingPoints(D, task > 0 ? &period[0] : 0, task, schP);
+	DBGPRINT("Schedp ordenados y sin repeticion son");  
+	DBGVECTOR(schP);
         return schP;
     }
 
-    SchedPoint::constraints SchedPoint::buildconstraints()
+    void SchedPoint::buildconstraints()
     {    
       //DBGENTER(_SERVER_DBG_LEV);
 	DBGPRINT("Buildconstraints");
         int  ntasks=period.size();
-	u_row_t curCoef;
 
         DBGVAR(ntasks);
 
         DBGVECTOR(period);
 
-        exactConstraints.clear();
+        // round the rows to a multiple of 4 doubles
+        _stride = (ntasks + 3) & ~size_t(3);
+        coeffs.clear();
+        _firstRow.clear();
         for (int curTask=0;curTask<ntasks;curTask++){
-            row_t schedP;
             // compute the scheduling points
-            schedP=SetP(period[curTask], period, curTask);
- 
-            // initialize the empty matrix
-            OneTaskConstraints.clear();
-             DBGVAR(curTask);
-             DBGVAR(OneTaskConstraints.size());
-             DBGVAR(schedP.size());
+            row_t schedP=SetP(period[curTask], period, curTask);
+            DBGVAR(curTask);
+            DBGVAR(schedP.size());
 
+            _firstRow.push_back(coeffs.size() / _stride);
             for (int curPoint=0; curPoint<(int)schedP.size(); curPoint++){
-                curCoef.clear();
                 // the current scheduling point
                 double t = schedP[curPoint];
                 DBGPRINT("Current scheduling point: " << t);
-                DBGPRINT("Now computing the coefficient");
-                //compute the coefficients
-                for (int j=0;j <= curTask-1;j++) { 
-                    DBGPRINT("PASA: j=" << j);
-                    curCoef.push_back(ceil((double(t)/double(period[j]))));
-		    DBGVAR(ceil((double(t)/double(period[j]))));
-                }
-                DBGPRINT("Now filling the rest of the vector");
-		curCoef.push_back(1);
-                for (int j=0;j<ntasks-curTask-1;j++) curCoef.push_back(0);
-	        
-                DBGPRINT("Before normalization: ");
-                DBGVECTOR(curCoef);
-                DBGPRINT("Now normalizing");
-                for (int i=0;i<(int)curCoef.size();i++) {
-                    curCoef[i]=double(curCoef[i])*double(period[i])/double(t);
-                }
-                DBGVECTOR(curCoef);
-
-                // store the normalized coefficients
-                OneTaskConstraints.push_back(curCoef);
+                size_t row = coeffs.size();
+                coeffs.resize(row + _stride, 0);
+                for (int j=0;j <= curTask-1;j++)
+                    coeffs[row + j] = ceil(t/double(period[j])) * 
+                        double(period[j]) / t;
+                coeffs[row + curTask] = double(period[curTask]) / t;
+                DBGVAR(row / _stride);
             }  
-            DBGPRINT("Finished computing the OneTaskConstraints");
-            DBGVAR(OneTaskConstraints.size());
-            //store all the coefficients for curTask schedulability
-            exactConstraints.push_back(OneTaskConstraints);
         }
-        return exactConstraints;
+        _firstRow.push_back(coeffs.size() / _stride);
+        _memo.clear();
     }
 
     // Tick SchedPoint::sensitivity(const constraints
@@ -208,13 +155,8 @@ namespace RTSim {
 
       //        DBGENTER(_SERVER_DBG_LEV);
         int nTask=U.size();
-        u_row_t lambdaVec;
-        matriz curConstraint;
-        u_row_t product;
-        double suma;
 	DBGPRINT("Sensitivity");
         DBGVAR(nTask);
-        DBGVAR(exactConstraints.size());
         DBGVAR(task);
 	DBGPRINT("utilization vector");
 	DBGVECTOR(U);
@@ -222,47 +164,31 @@ namespace RTSim {
 	DBGVECTOR(wcet);
         DBGPRINT("period");  
 	DBGVECTOR(period);
+        if (_firstRow.size() != size_t(nTask) + 1)
+            throw SchedPointExc("buildconstraints() has not been called");
+
+        // the utilizations, padded as the rows of coefficients
+        u_row_t u(_stride, 0);
+        std::copy(U.begin(), U.end(), u.begin());
+        const double *uu = &u[0];
+
+        double minimo = 0;
         for (int i=0; i<nTask; i++) {
-            curConstraint = exactConstraints[i];
-            DBGPRINT("curConstraints");
-            for (unsigned row=0;row<curConstraint.size();row++){
-                DBGVAR(row);
-                DBGVECTOR(curConstraint[row]);
-            }
-            for (unsigned row=0;row<curConstraint.size();row++) {
-                suma=0;
-                for (int col=0;col<nTask;col++) {  
-                    suma += curConstraint[row][col]*U[col];
-                }
-                product.push_back(suma);
-            }
-            for (unsigned col=0;col<product.size();col++){ 
-                product[col]=1-product[col];
-            }
-            for (unsigned row=0;row<product.size();row++){ 
-                if (curConstraint[row][task]==0)
-                    product[row]=100000000;
-                else
-                    product[row] = product[row]/curConstraint[row][task];
-            }
-            DBGPRINT("Product after dividing by curConstraint");
-            DBGVECTOR(product);
             double maximo=0;
-            for(int i=0;i<(int)product.size();i++) {
-                if (maximo < product[i])
-                    maximo = product[i];
+            for (size_t row=_firstRow[i]; row<_firstRow[i+1]; row++) {
+                const double *c = &coeffs[row * _stride];
+                // a plain loop on contiguous memory, that the
+                // compiler can vectorize
+                double suma=0;
+                for (size_t col=0; col<_stride; col++)
+                    suma += c[col]*uu[col];
+                double product = (c[task]==0) ? 100000000 : 
+                    (1-suma)/c[task];
+                if (maximo < product)
+                    maximo = product;
             }
-            lambdaVec.push_back(maximo);
-            //DBGVAR(maximo);
-            product.clear();
-        }
-        double minimo = lambdaVec[0];
-        DBGPRINT("lambdaVec");
-        DBGVECTOR(lambdaVec);
-        for(int i=0;i<(int)lambdaVec.size();i++) {
-            if (minimo > lambdaVec[i])
-                minimo = lambdaVec[i];
-            // DBGVAR(minimo);
+            if (i == 0 || minimo > maximo)
+                minimo = maximo;
         }
         //DBGVAR(minimo);
         return (minimo);
@@ -276,6 +202,7 @@ namespace RTSim {
     void SchedPoint::newRun()
     {
         last_change_time = 0;      
+        _changeEvt.clear();
     }
     
     void SchedPoint::endRun()
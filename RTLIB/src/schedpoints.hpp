@@ -51,12 +51,17 @@ namespace RTSim {
         //std::vector<double> lambdas;
         u_row_t lambdas;
       
-        matriz OneTaskConstraints;
-      
-        constraints exactConstraints;
-
-        //These are the matrix for the exact constraints
-        //std::vector<constraints> exactConstraints;
+        /* The exact constraints: for every task i and every
+           scheduling point t of i, the normalized coefficients
+           ceil(t/T_j)*T_j/t (j < i), 1*T_i/t and zeros (j > i).
+           They are stored row by row in a single buffer, each row
+           padded with zeros to _stride elements, so that the
+           products with the utilization vector run on contiguous
+           memory. The rows of task i go from _firstRow[i] to
+           _firstRow[i+1] (excluded). */
+        u_row_t coeffs;
+        std::vector<size_t> _firstRow;
+        size_t _stride;
  
         //these are the SchedPoints
         row_t schedpoints;
@@ -65,21 +70,11 @@ namespace RTSim {
 
         int task;
     
-        class ChangeBudgetEvt;
-        friend class ChangeBudgetEvt;
-        void onChangeBudget(ChangeBudgetEvt *e);
-
-        class ChangeBudgetEvt : public Event {
-            SchedPoint *sp;
-            Server *ss;
-            Tick budget;
-        public:
-            ChangeBudgetEvt(SchedPoint *s1, Server *s2, double b) :
-                Event(), sp(s1), ss(s2), budget(b) {}
-            virtual void doit() { sp->onChangeBudget(this); }
-            Server *getServer() { return ss; }
-            Tick getBudget() { return budget; }
-        };
+        /// the accepted changes that will be applied later
+        BudgetChangeEvt _changeEvt;
+
+        /// sensitivity() for the budgets in wcet
+        AdmissionCache<double> _memo;
 
     public:
  
@@ -95,7 +90,8 @@ namespace RTSim {
         
         row_t SetP(int D, const row_t &schedpoints, int task);
 
-        constraints buildconstraints();
+        /// Computes the scheduling points and the exact constraints
+        void buildconstraints();
 
         //  Tick  sensitivity(const constraints &exactConstraints, const row_t &U, int task);
 
@@ -123,6 +119,9 @@ namespace RTSim {
         */
         void addServer(Server *s);
 
+        /// The memo of the sensitivities (see AdmissionCache)
+        AdmissionCache<double> &getMemo() { return _memo; }
+
         void newRun();
         void endRun();
 
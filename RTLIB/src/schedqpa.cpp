@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cassert>
+
+#include <schedanalysis.hpp>
+#include <schedqpa.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    SchedQPA::SchedQPA(const string &name) : 
+        Entity(name), servers(), _points(), _dbf(), _horizon(0),
+        last_change_time(0), _changeEvt()
+    {
+    }
+
+    SchedQPA::~SchedQPA()
+    {
+    }
+
+    void SchedQPA::addServer(Server *s)
+    {
+        ServerInfo info;
+        info.p_server = s;
+        info.Q = s->getBudget();
+        info.T = s->getPeriod();
+        info.D = s->getRelDline();
+        if (info.D == 0 || info.D > info.T) info.D = info.T;
+        s->setSupervisorIndex(servers.size());
+        servers.push_back(info);
+
+        // the new server changes the demand at every point
+        _points.clear();
+        _dbf.clear();
+        _horizon = 0;
+    }
+
+    Tick SchedQPA::jobs(int i, Tick t) const
+    {
+        const ServerInfo &s = servers[i];
+        if (t < s.D) return 0;
+        return (t - s.D) / long(s.T) + 1;
+    }
+
+    Tick SchedQPA::busyPeriod(int i, Tick q) const
+    {
+        Tick l, w = 0;
+        for (int j = 0; j < (int)servers.size(); ++j)
+            w += j == i ? q : servers[j].Q;
+        do {
+            l = w;
+            w = 0;
+            for (int j = 0; j < (int)servers.size(); ++j)
+                w += (l + servers[j].T - 1) / long(servers[j].T) * 
+                    (j == i ? q : servers[j].Q);
+        } while (w > l);
+        return l;
+    }
+
+    void SchedQPA::extendPoints(Tick l)
+    {
+        if (l <= _horizon) return;
+
+        vector<Tick> p;
+        for (int i = 0; i < (int)servers.size(); ++i)
+            for (Tick d = jobs(i, _horizon) * servers[i].T + servers[i].D; 
+                 d <= l; d += servers[i].T)
+                p.push_back(d);
+        sort(p.begin(), p.end());
+        p.erase(unique(p.begin(), p.end()), p.end());
+
+        for (size_t k = 0; k < p.size(); ++k) {
+            Tick h = 0;
+            for (int i = 0; i < (int)servers.size(); ++i)
+                h += jobs(i, p[k]) * servers[i].Q;
+            _points.push_back(p[k]);
+            _dbf.push_back(h);
+        }
+        _horizon = l;
+    }
+
+    void SchedQPA::addDemand(int i, Tick delta)
+    {
+        size_t k = lower_bound(_points.begin(), _points.end(), servers[i].D) - 
+            _points.begin();
+        for (; k < _points.size(); ++k)
+            _dbf[k] += jobs(i, _points[k]) * delta;
+        servers[i].Q += delta;
+    }
+
+    Tick SchedQPA::maxIncrement(int i, Tick delta)
+    {
+        const ServerInfo &s = servers[i];
+
+        // first, the utilization must not exceed 1 (otherwise
+        // the busy period does not end)
+        double u = 0;
+        for (int j = 0; j < (int)servers.size(); ++j)
+            if (j != i) u += double(servers[j].Q) / double(servers[j].T);
+        Tick maxQ = Tick::floor((1 - u) * double(s.T) + 1e-9);
+        delta = min(delta, maxQ - s.Q);
+
+        // then, the demand at every deadline of the new busy
+        // period; a smaller increment shortens the busy period, so
+        // the deadlines already examined are enough
+        while (delta > 0) {
+            Tick l = busyPeriod(i, s.Q + delta);
+            extendPoints(l);
+            Tick best = delta;
+            size_t k = lower_bound(_points.begin(), _points.end(), s.D) - 
+                _points.begin();
+            for (; k < _points.size() && _points[k] <= l; ++k) {
+                Tick n = jobs(i, _points[k]);
+                Tick slack = _points[k] - _dbf[k];
+                if (slack < n * best) best = slack / long(n);
+            }
+            if (best == delta) break;
+            delta = best;
+        }
+        return max(delta, Tick(0));
+    }
+
+    bool SchedQPA::isSchedulable() const
+    {
+        vector<Tick> C, T, D;
+        for (size_t i = 0; i < servers.size(); ++i) {
+            C.push_back(servers[i].Q);
+            T.push_back(servers[i].T);
+            D.push_back(servers[i].D);
+        }
+        if (servers.empty()) return true;
+        return analysis::qpaTest(&C[0], &T[0], &D[0], servers.size());
+    }
+
+    Tick SchedQPA::changeBudget(Server *s, Tick db)
+    {
+        int index = s->getSupervisorIndex();
+        if (index < 0 || index >= (int)servers.size() || 
+            servers[index].p_server != s)
+            throw SchedQPAExc("Server not handled by " + getName());
+        DBGVAR(index);
+        DBGVAR(db);
+
+        Tick delta_budget;
+        if (db > 0) delta_budget = maxIncrement(index, db);
+        else delta_budget = max(db, Tick(1) - servers[index].Q);
+        addDemand(index, delta_budget);
+        DBGVAR(delta_budget);
+
+	if (last_change_time <= SIMUL.getTime()) {
+            last_change_time = s->changeBudget(delta_budget + s->getBudget());
+            DBGPRINT_2("in the past, new change time at ", last_change_time);
+        }
+        else {
+            DBGPRINT("in the future"); 
+            if (delta_budget < 0) {
+                last_change_time = 
+                    max(last_change_time, s->changeBudget(delta_budget + s->getBudget()));
+                DBGPRINT_2("delta_budget < 0, new change time at ", last_change_time);
+            }
+	    else if (delta_budget > 0) {
+                _changeEvt.add(s, delta_budget + s->getBudget(), last_change_time);
+                DBGPRINT_2("delta_budget > 0, new change time at ", last_change_time);
+            }
+        }
+
+        return delta_budget;
+    }
+
+    void SchedQPA::newRun()
+    {
+        last_change_time = 0;      
+        _changeEvt.clear();
+    }
+    
+    void SchedQPA::endRun()
+    {
+    }
+  
+}
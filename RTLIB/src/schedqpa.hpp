@@ -0,0 +1,102 @@
+#ifndef __SCHEDQPA_H__
+#define __SCHEDQPA_H__
+
+#include <vector>
+
+#include <supervisor.hpp>
+#include <server.hpp>
+
+namespace RTSim {
+    using namespace MetaSim;
+
+    /**
+       Admission control for servers scheduled by EDF (CBServer,
+       Grub, ...), based on the processor demand: a budget change
+       is accepted if the demand-bound function stays below the
+       line dbf(t) = t for all the deadlines in the synchronous
+       busy period (see analysis::qpaTest()). The relative deadline
+       of a server is its getRelDline(), or its period if this is 0.
+
+       The demand-bound function is cached at every absolute
+       deadline of the busy period, so that a change to the budget
+       of one server only updates the terms of that server, and
+       the largest admissible budget is computed in one pass over
+       the deadlines.
+    */
+    class SchedQPA : public Entity, public Supervisor {
+    public:
+        struct ServerInfo {
+            Server *p_server;
+            Tick Q, T, D;
+        };
+
+    protected:
+        std::vector<ServerInfo> servers;
+
+        // the absolute deadlines up to _horizon, in increasing order
+        std::vector<Tick> _points;
+        // the demand-bound function at each point
+        std::vector<Tick> _dbf;
+        Tick _horizon;
+
+        Tick last_change_time;
+
+        /// the accepted changes that will be applied later
+        BudgetChangeEvt _changeEvt;
+
+        // not implemented
+        SchedQPA(const SchedQPA&);
+        SchedQPA& operator=(const SchedQPA&);
+
+        /// number of deadlines of server i in [0, t]
+        Tick jobs(int i, Tick t) const;
+
+        /// the synchronous busy period if server i had budget q
+        Tick busyPeriod(int i, Tick q) const;
+
+        /// caches the deadlines up to l
+        void extendPoints(Tick l);
+
+        /// adds delta to the budget of server i in the cache
+        void addDemand(int i, Tick delta);
+
+        /// the largest admissible increment (up to delta) of server i
+        Tick maxIncrement(int i, Tick delta);
+
+    public:
+        class SchedQPAExc : public BaseExc {
+        public:
+            SchedQPAExc(const string& m) : 
+                BaseExc(m,"SchedQPA","schedqpa.cpp") {};
+        };
+
+        SchedQPA(const string &name);
+        ~SchedQPA();
+
+        /**
+           This function requests a change (positive or negative) to
+           the budget of the server. The function is usually called
+           from a feedback module. 
+
+           @param delta_budget increment (or decrement) in the budget
+
+           @return the effective increment (or decrement) in the
+           budget.
+        */
+        Tick changeBudget(Server *s, Tick delta_budget);
+
+        /**
+           Adds a new server to the algorithm, with its current
+           budget.
+        */
+        void addServer(Server *s);
+
+        /// Runs the complete QPA test on the current budgets
+        bool isSchedulable() const;
+
+        void newRun();
+        void endRun();
+    };
+}
+
+#endif
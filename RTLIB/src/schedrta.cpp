@@ -3,6 +3,7 @@
 #include <math.h>
 #include <sporadicserver.hpp>
 #include <algorithm>
+#include <schedanalysis.hpp>
 
 namespace RTSim {
 
@@ -23,11 +24,13 @@ namespace RTSim {
 	period.push_back(pp);
         wcet.push_back(cc);
         U.push_back(double(cc)/double(pp));
-
+        _tryIndex = -1;
+        _memo.clear();
+        updateResponseTimes();
     }
 
     SchedRTA::SchedRTA(const string &name) : 
-        Entity(name)
+        Entity(name), _tryIndex(-1), _tryBudget(0), _memo(), _budgets()
     {
     }
 
@@ -37,16 +40,14 @@ namespace RTSim {
 
     Tick SchedRTA::computeResponseTime(int i) const
     {
-        Tick r_cur;
-        Tick r_new = servers[i].Q;
-        do {
-            r_cur = r_new;
-            r_new = servers[i].Q;
-            for (int j = 0; j < i; ++j)
-                // This is a ceil()
-                r_new += (r_cur + servers[j].P - 1) / int(servers[j].P) * servers[j].Q;
-        } while(r_new > r_cur && r_new <= servers[i].P);
-        return r_new;
+        return computeResponseTime(i, servers[i].Q);
+    }
+
+    Tick SchedRTA::computeResponseTime(int i, Tick r) const
+    {
+        return analysis::responseTime(i, r, servers[i].P,
+                                      [this](int j) { return servers[j].Q; },
+                                      [this](int j) { return servers[j].P; });
     }
 
     void SchedRTA::updateResponseTimes()
@@ -57,6 +58,14 @@ namespace RTSim {
       }
     }
 
+    void SchedRTA::updateResponseTimes(int i, bool increased)
+    {
+        for (int j = i; j < (int) servers.size(); ++j)
+            servers[j].R = increased ? computeResponseTime(j, servers[j].R) :
+                computeResponseTime(j);
+        _tryIndex = -1;
+    }
+
     bool SchedRTA::tryBudget(int i, Tick b)
     {
       //      DBGENTER(_SERVER_DBG_LEV);
@@ -69,17 +78,30 @@ namespace RTSim {
 	    DBGVAR(servers[h].P);
 	    DBGVAR(U[h]);
 	  }
-        bool schedules = computeResponseTime(i) <= servers[i].P;
-        for (int j = i + 1; schedules && j < (int)servers.size(); ++j)
+        // pick the closest lower bounds for the fixed points
+        bool fromTry = _tryIndex == i && b >= _tryBudget;
+        bool fromR = b >= old_b;
+        _newR.resize(servers.size());
+        bool schedules = true;
+        for (int j = i; schedules && j < (int)servers.size(); ++j)
 	  {
-	    schedules = computeResponseTime(j) <= servers[j].P;
+            Tick r = servers[j].Q;
+            if (fromTry) r = _tryR[j];
+            else if (fromR) r = servers[j].R;
+            _newR[j] = computeResponseTime(j, r);
+	    schedules = _newR[j] <= servers[j].P;
 	    DBGVAR(j);
-	    DBGVAR(computeResponseTime(j));
+	    DBGVAR(_newR[j]);
 	    DBGVAR(servers[j].Q);
 	    DBGVAR(servers[j].P);
 	    
 	  }
 	    servers[i].Q = old_b;
+            if (schedules) {
+                _tryIndex = i;
+                _tryBudget = b;
+                _tryR.swap(_newR);
+            }
 	    DBGVAR(schedules);
 	    DBGVAR(b);
         return schedules;
@@ -121,11 +143,16 @@ namespace RTSim {
         assert(i < (int)servers.size());
         Tick cur_b = servers[i].Q;
         Tick new_b = cur_b + db;
-        Tick max_b = searchBudget(i);
+        _budgets.resize(servers.size());
+        for (size_t j = 0; j < servers.size(); ++j) _budgets[j] = servers[j].Q;
+        const Tick *m = _memo.find(i, _budgets);
+        Tick max_b = m != 0 ? *m : searchBudget(i);
+        if (m == 0) _memo.insert(i, _budgets, max_b);
         if (new_b > max_b)
             new_b = max_b;
         servers[i].p_server->changeBudget(new_b);
         servers[i].Q = new_b;
+        updateResponseTimes(i, new_b >= cur_b);
         return new_b - cur_b;
     }
 
@@ -138,9 +165,11 @@ namespace RTSim {
 
     void SchedRTA::updateU(int task,Tick req)
     {
+        bool increased = req >= servers[task].Q;
         wcet[task]=req;
         U[task]=double (double(wcet[task])/double(period[task]));
 	servers[task].Q=req;
+        updateResponseTimes(task, increased);
     }
 
     void SchedRTA::newRun()
@@ -39,6 +39,27 @@ namespace RTSim {
         
         u_row_t U;
 
+      /**********************************************************/
+
+        /* The response times of the last feasible tryBudget(), for
+           the servers from _tryIndex on. Since the RTA iteration is
+           monotone in the budgets, they are lower bounds of the
+           response times for any larger budget of server _tryIndex,
+           and the next tries start from them. The committed
+           response times (ServerInfo::R) are used in the same way
+           for any budget larger than the current one. */
+        int _tryIndex;
+        Tick _tryBudget;
+        row_t _tryR;
+        row_t _newR;
+
+        /// Recomputes R for the servers from i on, after changing Q[i]
+        void updateResponseTimes(int i, bool increased);
+
+        /// searchBudget() for the budgets Q of the servers
+        AdmissionCache<Tick> _memo;
+        row_t _budgets;
+
       /**********************************************************/
 
         // not implemented
@@ -74,6 +95,9 @@ namespace RTSim {
         */
         void addServer(Server *s);
 
+        /// The memo of the largest budgets (see AdmissionCache)
+        AdmissionCache<Tick> &getMemo() { return _memo; }
+
       /*This function is called to update the vector utilization**/
       void updateU(int task,Tick req);
 
@@ -82,6 +106,10 @@ namespace RTSim {
 
         void updateResponseTimes();
         Tick computeResponseTime(int i) const;
+        /** Iterates from r, which must not exceed the response
+            time of server i (its previous value for a smaller
+            budget, for example). */
+        Tick computeResponseTime(int i, Tick r) const;
         Tick searchBudget(int i, Tick b1, Tick b2);
         Tick searchBudget(int i);
         bool tryBudget(int i, Tick b);
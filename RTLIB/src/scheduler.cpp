@@ -23,8 +23,9 @@ namespace RTSim {
     using namespace MetaSim;
 
     TaskModel::TaskModel(AbsRTTask* t)
-        : _rtTask(t), active(false), 
-         _insertTime(0), _threshold(INT_MAX) 
+        : _keyPrio(0), _keyTime(0), _keyNumber(0),
+         active(false), _rtTask(t),
+         _insertTime(0), _threshold(INT_MAX)
     {
     }
 
@@ -32,17 +33,6 @@ namespace RTSim {
     {
     }
 
-    bool TaskModel::TaskModelCmp::operator()(TaskModel* a, TaskModel* b)
-    {
-        if (a->getPriority() < b->getPriority()) return true;
-        else if (a->getPriority() == b->getPriority()) {
-            if (a->getInsertTime() < b->getInsertTime()) return true;
-            else if (a->getInsertTime() == b->getInsertTime())
-                if (a->getTaskNumber() < b->getTaskNumber()) return true;
-        }
-        return false;
-    }
-
     void TaskModel::setActive()
     {
         active = true;
@@ -60,7 +50,146 @@ namespace RTSim {
 
 /*-----------------------------------------------------------------*/
 
-    Scheduler::Scheduler(): Entity(""), _kernel(0), _queue(), _tasks(), _currExe(0)
+    unsigned long Scheduler::_lastHandleId = 0;
+
+    Tick TaskModel::popPriority(const void *tag)
+    {
+        for (size_t i = _saved.size(); i > 0; --i)
+            if (_saved[i - 1].first == tag) {
+                Tick p = _saved[i - 1].second;
+                _saved.erase(_saved.begin() + (i - 1));
+                return p;
+            }
+        return getPriority();
+    }
+
+    void TaskModel::saveState(Checkpoint &c)
+    {
+        c.put(_keyPrio);
+        c.put(_keyTime);
+        c.put(_keyNumber);
+        c.put(active);
+        c.put(_insertTime);
+        c.put(_threshold);
+        c.put(_saved);
+    }
+
+    void TaskModel::loadState(Checkpoint &c)
+    {
+        c.get(_keyPrio);
+        c.get(_keyTime);
+        c.get(_keyNumber);
+        c.get(active);
+        c.get(_insertTime);
+        c.get(_threshold);
+        c.get(_saved);
+    }
+
+/*-----------------------------------------------------------------*/
+
+    size_t ReadyQueue::position(int64_t p, int64_t t, int64_t n) const
+    {
+        size_t size = _models.size();
+        const int64_t *prio = size ? &_prio[0] : NULL;
+        const int64_t *time = size ? &_time[0] : NULL;
+        const int64_t *num = size ? &_num[0] : NULL;
+
+        if (size <= LINEAR) {
+            // the keys are sorted: the smaller ones come first
+            size_t k = 0;
+            for (size_t i = 0; i < size; ++i)
+                k += (prio[i] < p) | ((prio[i] == p) & 
+                     ((time[i] < t) | ((time[i] == t) & (num[i] < n))));
+            return k;
+        }
+
+        size_t lo = 0, hi = size;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            bool less = prio[mid] < p || (prio[mid] == p && 
+                (time[mid] < t || (time[mid] == t && num[mid] < n)));
+            if (less) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    bool ReadyQueue::sameKey(size_t i, TaskModel *m) const
+    {
+        return _prio[i] == int64_t(m->_keyPrio) && 
+            _time[i] == int64_t(m->_keyTime) && _num[i] == m->_keyNumber;
+    }
+
+    void ReadyQueue::insertAt(size_t i, TaskModel *m)
+    {
+        _models.insert(_models.begin() + i, m);
+        _prio.insert(_prio.begin() + i, int64_t(m->_keyPrio));
+        _time.insert(_time.begin() + i, int64_t(m->_keyTime));
+        _num.insert(_num.begin() + i, int64_t(m->_keyNumber));
+    }
+
+    void ReadyQueue::eraseAt(size_t i)
+    {
+        _models.erase(_models.begin() + i);
+        _prio.erase(_prio.begin() + i);
+        _time.erase(_time.begin() + i);
+        _num.erase(_num.begin() + i);
+    }
+
+    bool ReadyQueue::insert(TaskModel *m)
+    {
+        size_t i = position(int64_t(m->_keyPrio), int64_t(m->_keyTime), 
+                            m->_keyNumber);
+        if (i < _models.size() && sameKey(i, m)) return false;
+        insertAt(i, m);
+        return true;
+    }
+
+    size_t ReadyQueue::locate(TaskModel *m) const
+    {
+        size_t i = position(int64_t(m->_keyPrio), int64_t(m->_keyTime), 
+                            m->_keyNumber);
+        if (i < _models.size() && _models[i] == m) return i;
+        // the key of m has been changed while in the queue
+        for (i = 0; i < _models.size(); ++i)
+            if (_models[i] == m) break;
+        return i;
+    }
+
+    void ReadyQueue::erase(TaskModel *m)
+    {
+        size_t i = locate(m);
+        if (i < _models.size()) eraseAt(i);
+    }
+
+    void ReadyQueue::fix(size_t i)
+    {
+        TaskModel *m = _models[i];
+        eraseAt(i);
+        insert(m);
+    }
+
+    void ReadyQueue::clear()
+    {
+        _models.clear();
+        _prio.clear();
+        _time.clear();
+        _num.clear();
+    }
+
+    void ReadyQueue::reserve(size_t n)
+    {
+        _models.reserve(n);
+        _prio.reserve(n);
+        _time.reserve(n);
+        _num.reserve(n);
+    }
+
+/*-----------------------------------------------------------------*/
+
+    Scheduler::Scheduler(): Entity(""), _kernel(0), _queue(), _tasks(),
+                            _handleId(++_lastHandleId), _currExe(0),
+                            _extractCount(0), _readyLen()
     {
     }
 
@@ -71,13 +200,29 @@ namespace RTSim {
     {
         AbsRTTask* task = model->getTask();
 
-        if (find(task) != NULL) throw RTSchedExc("Element already present");
-	
-        _tasks[task] = model;
+        if (!_tasks.insert(make_pair(task, model)).second)
+            throw RTSchedExc("Element already present");
+
+        if (task->getSchedHandleOwner() == 0)
+            task->setSchedHandle(_handleId, model);
+    }
+
+    void Scheduler::dropModel(AbsRTTask* task)
+    {
+        map<AbsRTTask*, TaskModel*>::iterator mi = _tasks.find(task);
+        if (mi == _tasks.end()) return;
+
+        if (task->getSchedHandleOwner() == _handleId)
+            task->setSchedHandle(0, NULL);
+        delete mi->second;
+        _tasks.erase(mi);
     }
 
     TaskModel* Scheduler::find(AbsRTTask* task)
     {
+        void *h = task->getSchedHandle(_handleId);
+        if (h != NULL) return static_cast<TaskModel *>(h);
+
         map<AbsRTTask*, TaskModel*>::iterator mi = _tasks.find(task);
 	
         if (mi == _tasks.end()) 
@@ -90,7 +235,7 @@ namespace RTSim {
         _kernel = k;
     }
 
-    void Scheduler::insert(AbsRTTask* task) throw(RTSchedExc, BaseExc)
+    void Scheduler::insert(AbsRTTask* task)
     {
         DBGENTER("Scheduler");
 
@@ -105,21 +250,59 @@ namespace RTSim {
   
         model->setInsertTime(SIMUL.getTime());
         model->setActive();
+        model->updateKey();
 
-        _queue.insert(model);
-
-        
+        queueInsert(model);
+        trackReady();
     }
 
-    void Scheduler::extract(AbsRTTask* task) throw(RTSchedExc, BaseExc)
+    void Scheduler::extract(AbsRTTask* task)
     {
         TaskModel* model = find(task);
 	
         if (model == NULL) // raise an exception
             throw RTSchedExc("AbsRTTask not found");
 		
-        _queue.erase(model);
+        queueErase(model);
+        _extractCount++;
         model->setInactive();
+        trackReady();
+    }
+
+    bool Scheduler::higherPriority(AbsRTTask *a, AbsRTTask *b)
+    {
+        TaskModel *ma = find(a);
+        TaskModel *mb = find(b);
+
+        if (ma == NULL || mb == NULL)
+            throw RTSchedExc("AbsRTTask not found");
+
+        return TaskModel::TaskModelCmp()(ma, mb);
+    }
+
+    void Scheduler::queueRekey(TaskModel *m)
+    {
+        size_t i = _queue.locate(m);
+        m->updateKey();
+        if (i < _queue.size()) _queue.fix(i);
+        else _queue.insert(m);
+    }
+
+    void Scheduler::setPriority(AbsRTTask *task, Tick p)
+    {
+        TaskModel* model = find(task);
+
+        if (model == NULL)
+            throw RTSchedExc("AbsRTTask not found");
+
+        model->changePriority(p);
+        // otherwise the key is computed by insert()
+        if (!model->isActive()) return;
+
+        model->setInsertTime(SIMUL.getTime());
+        queueRekey(model);
+        // the order of the queue has changed
+        _extractCount++;
     }
 
     int Scheduler::getPriority(AbsRTTask* task) throw(RTSchedExc)
@@ -167,37 +350,25 @@ namespace RTSim {
         if (model == NULL)
             throw RTSchedExc("AbsRTTask not found");
 
-//      if (oldPriorities.find(task) == oldPriorities.end())
-        oldPriorities[task] = model->getPriority();
-//      else 
-//          oldPriorities[t] = model->getPriority(); 
-
-	extract(task);
+        model->pushPriority(this);
 
 	int tmp = model->getThreshold();
 
         //TODO: add some logic to avoid using or minimize threshold  
 
-	model->changePriority(tmp);
-	
-	insert(task);
+	setPriority(task, tmp);
 	
 	return tmp;
     }
 
     void Scheduler::disableThreshold(AbsRTTask *task) throw(RTSchedExc)
     {
-	//TODO: remove the old priority from the oldPriorities map	
         TaskModel* model = find(task);
 	
         if (model == NULL)
             throw RTSchedExc("AbsRTTask not found");
 
-	extract(task);
-
-	model->changePriority(model->getPriority());
-	
-	insert(task);
+	setPriority(task, model->popPriority(this));
 
 	_kernel->dispatch();
     }
@@ -206,7 +377,13 @@ namespace RTSim {
     {
         typedef map<AbsRTTask*, TaskModel*>::iterator IT;
 
-        _queue.clear();
+        queueClear();
+        _extractCount++;
+        trackReady();
+
+        for (IT j = _tasks.begin(); j != _tasks.end(); ++j)
+            if (j->first->getSchedHandle(_handleId) != NULL)
+                j->first->setSchedHandle(0, NULL);
 
         IT i = _tasks.begin();
 
@@ -224,18 +401,9 @@ namespace RTSim {
     {
         DBGENTER("Kernel");
 
-        if ( _queue.size() <= n ) {
-            
-            return NULL;
-        }
+        TaskModel *m = queueAt(n);
 
-        priority_list<TaskModel*, TaskModel::TaskModelCmp>::iterator it = 
-            _queue.begin();
-        for (unsigned int i = 0; i < n; i++) it++;
-
-        
-
-        return (*it)->getTask();    
+        return m != NULL ? m->getTask() : NULL;
     }
 
     void Scheduler::notify(AbsRTTask* task)
@@ -247,26 +415,62 @@ namespace RTSim {
 
     void Scheduler::newRun()
     {
-        _queue.clear();
+        queueClear();
+        _extractCount++;
+        _readyLen.reset(SIMUL.getTime());
 
         typedef map<AbsRTTask*, TaskModel*>::iterator IT;
 
-        for (IT i = _tasks.begin(); i != _tasks.end(); ++i) 
+        for (IT i = _tasks.begin(); i != _tasks.end(); ++i) {
             i->second->setInactive();
+            i->second->clearPriorities();
+        }
     }
 
     void Scheduler::endRun()
     {
     }
 
-    void Scheduler::print()
+    void Scheduler::saveState(Checkpoint &c)
+    {
+        typedef map<AbsRTTask*, TaskModel*>::iterator IT;
+
+        for (IT i = _tasks.begin(); i != _tasks.end(); ++i)
+            i->second->saveState(c);
+        c.put(queueSize());
+        for (unsigned int i = 0; i < queueSize(); ++i) c.put(queueAt(i));
+        c.put(_currExe);
+        c.put(_extractCount);
+        c.put(_readyLen);
+    }
+
+    void Scheduler::loadState(Checkpoint &c)
     {
-        priority_list<TaskModel*, TaskModel::TaskModelCmp>::iterator it = 
-            _queue.begin(); 
+        typedef map<AbsRTTask*, TaskModel*>::iterator IT;
 
+        queueClear();
+        for (IT i = _tasks.begin(); i != _tasks.end(); ++i)
+            i->second->loadState(c);
+        // the keys are back, so the models go in the same order
+        size_t n;
+        c.get(n);
+        for (size_t i = 0; i < n; ++i) {
+            TaskModel *m;
+            c.get(m);
+            queueInsert(m);
+        }
+        c.get(_currExe);
+        c.get(_extractCount);
+        c.get(_readyLen);
+    }
+
+    void Scheduler::print()
+    {
+#ifdef __DEBUG__
         DBGPRINT("Ready queue: ");
-        for (; it != _queue.end(); ++it)
-            DBGPRINT_2(taskname((*it)->getTask()), " -> ");
+        for (unsigned int i = 0; i < queueSize(); ++i)
+            DBGPRINT_2(taskname(queueAt(i)->getTask()), " -> ");
+#endif
     }
 
     AbsRTTask* Scheduler::getFirst()
@@ -274,4 +478,12 @@ namespace RTSim {
         return getTaskN(0);
  
     }
+
+    void Scheduler::signQueue(StateImage &s)
+    {
+        s.putRef(_currExe);
+        s.put(queueSize());
+        for (unsigned int i = 0; i < queueSize(); ++i)
+            s.putRef(queueAt(i)->getTask());
+    }
 }
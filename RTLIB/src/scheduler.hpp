@@ -16,10 +16,16 @@
 
 #include <baseexc.hpp>
 #include <plist.hpp>
+#include <sortedvec.hpp>
 #include <simul.hpp>
 #include <entity.hpp>
+#include <timeintegral.hpp>
 #include <abstask.hpp>
 
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
 namespace RTSim {
 
     using namespace MetaSim;
@@ -47,12 +53,24 @@ namespace RTSim {
     */
     class TaskModel {
     protected:
-        AbsRTTask* _rtTask;
+        /// The ordering key (see updateKey()), first, with the
+        /// fields read by the ready queue: the comparisons of
+        /// the queue only touch the first cache line of a model
+        Tick _keyPrio;
+        Tick _keyTime;
+        int _keyNumber;
         bool active;
+        AbsRTTask* _rtTask;
+
         int _insertTime;
 
 	int _threshold;
 
+        /// The saved priorities (see pushPriority()), last on top
+        std::vector<std::pair<const void *, Tick> > _saved;
+
+        friend class ReadyQueue;
+
     public:
         TaskModel(AbsRTTask *t);
 
@@ -86,6 +104,32 @@ namespace RTSim {
 	 */
 	void setThreshold(const int th){ _threshold = th; }
 
+        /**
+           Saves the current priority, tagged with tag (a resource,
+           for example), before it is raised.
+        */
+        void pushPriority(const void *tag) {
+            _saved.push_back(std::make_pair(tag, getPriority()));
+        }
+
+        /**
+           Removes the most recent priority saved with tag and
+           returns it. Returns the current priority if nothing has
+           been saved with tag.
+        */
+        Tick popPriority(const void *tag);
+
+        /// Discards all the saved priorities
+        void clearPriorities() { _saved.clear(); }
+
+        /**
+           Saves the key, the flags and the saved priorities (see
+           Scheduler::saveState()). A model with more state must
+           override it, together with loadState().
+        */
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
         /**
          * Set the active flag of the task. It happens when
          * the task is inserted in the queue.
@@ -114,6 +158,35 @@ namespace RTSim {
         */ 
         virtual Tick getInsertTime() { return _insertTime; }
 
+        /**
+           Computes the key used by TaskModelCmp, i.e. the
+           priority, the insertion time and the task number. The
+           scheduler calls it when the model is inserted in the
+           queue; the priority of a model in the queue must be
+           changed with Scheduler::setPriority().
+         */
+        /// The priority in the key (see updateKey())
+        Tick getKeyPriority() const { return _keyPrio; }
+
+        void updateKey() {
+            _keyPrio = getPriority();
+            _keyTime = getInsertTime();
+            _keyNumber = getTaskNumber();
+        }
+
+        /**
+           As updateKey(), for a model of class Model: the priority
+           and the insertion time are read without virtual calls
+           (see StaticScheduler).
+        */
+        template <class Model>
+        void updateKeyAs() {
+            Model *m = static_cast<Model *>(this);
+            _keyPrio = m->Model::getPriority();
+            _keyTime = m->Model::getInsertTime();
+            _keyNumber = getTaskNumber();
+        }
+
         class TaskModelCmp {
         public:
             /* 
@@ -146,11 +219,72 @@ namespace RTSim {
 
                @todo check if this works with multi-processors (I
                guess not).
+
+               The comparison uses the keys cached by updateKey(),
+               not the current priority of the models.
             */
-            bool operator()(TaskModel* a, TaskModel* b);
+            bool operator()(TaskModel* a, TaskModel* b) {
+                if (a->_keyPrio != b->_keyPrio) return a->_keyPrio < b->_keyPrio;
+                if (a->_keyTime != b->_keyTime) return a->_keyTime < b->_keyTime;
+                return a->_keyNumber < b->_keyNumber;
+            }
         };
     };
 
+    /**
+       \ingroup kernels
+
+       The ready queue of a scheduler: the models in TaskModelCmp
+       order, with a copy of their keys (see
+       TaskModel::updateKey()) in three parallel arrays, so that
+       the position of a model is found without touching the
+       other models. Up to LINEAR models, the position is the
+       number of smaller keys, counted by a loop without branches
+       that the compiler vectorizes; beyond that, it is found by
+       a binary search.
+
+       As in a sorted_vector, a model with the same key as a
+       model in the queue is not inserted, and the n-th model is
+       reached in constant time.
+    */
+    class ReadyQueue {
+        std::vector<TaskModel *> _models;
+        std::vector<int64_t> _prio;
+        std::vector<int64_t> _time;
+        std::vector<int64_t> _num;
+
+        static const size_t LINEAR = 64;
+
+        /// number of keys smaller than (p, t, n)
+        size_t position(int64_t p, int64_t t, int64_t n) const;
+        bool sameKey(size_t i, TaskModel *m) const;
+        void insertAt(size_t i, TaskModel *m);
+        void eraseAt(size_t i);
+
+    public:
+        /// inserts m with its current key, false if the key is taken
+        bool insert(TaskModel *m);
+
+        /// removes m (also if its key has been changed in the queue)
+        void erase(TaskModel *m);
+
+        /// the position of m, or size()
+        size_t locate(TaskModel *m) const;
+
+        /// moves the model in position i, whose key has changed
+        void fix(size_t i);
+
+        /// the (n+1)-th model (0 == first)
+        TaskModel *operator[](size_t n) const { return _models[n]; }
+
+        TaskModel *front() const { return _models.front(); }
+
+        size_t size() const { return _models.size(); }
+        bool empty() const { return _models.empty(); }
+        void clear();
+        void reserve(size_t n);
+    };
+
     /** 
         \ingroup kernels
 
@@ -185,18 +319,32 @@ namespace RTSim {
         */
         virtual void removeTask(AbsRTTask *task) = 0;
 
+        /**
+           Makes room for n more tasks in the ready queue, before
+           adding a large task set.
+        */
+        virtual void reserveTasks(size_t n) { _queue.reserve(_queue.size() + n); }
+
         /**
          * Insert a task in the queue.
          */
-        virtual void insert(AbsRTTask *) throw(RTSchedExc, BaseExc);
+        virtual void insert(AbsRTTask *);
 
         /**
          *  extract a task from the queue.
          */
-        virtual void extract(AbsRTTask *) throw(RTSchedExc, BaseExc);
+        virtual void extract(AbsRTTask *);
 
         int getPriority(AbsRTTask* task) throw(RTSchedExc);
 
+        /**
+           Changes the priority of task. If the task is in the
+           queue, it is moved to its new position in place (as if
+           it had been extracted and inserted again, so it goes
+           after the tasks of the same priority).
+         */
+        void setPriority(AbsRTTask *task, Tick p);
+
         void changePriority(AbsRTTask* task, const std::string &params) 
             throw(RTSchedExc);
 
@@ -225,13 +373,39 @@ namespace RTSim {
         /**
          *  returns the (n+1)-th (0==first) task in the queue
          *  or NULL if the queue has less than n+1 elements.
+         *  It takes constant time.
          */ 
         virtual AbsRTTask * getTaskN(unsigned int);
 
         /**
          * Returns the number of elements in queue.
          */
-        virtual int getSize() { return _queue.size(); }
+        virtual int getSize() { return queueSize(); }
+
+        /**
+           Returns true if task a precedes task b in the queue
+           order (i.e. it has a higher priority), as decided by
+           TaskModel::TaskModelCmp. Both tasks must have been added
+           to the scheduler, but they need not be in the queue.
+         */
+        bool higherPriority(AbsRTTask *a, AbsRTTask *b);
+
+        /**
+           Returns how many times a task has been taken out of the
+           queue, including the reinsertions done to change its
+           priority or its position. A kernel that caches the
+           order of the tasks can compare two values to know if
+           the order may have changed behind its back.
+         */
+        unsigned long getExtractCount() const { return _extractCount; }
+
+        /**
+           The length of the queue over the time (the executing
+           tasks included), updated by insert() and extract() only
+           when it changes: its time average is read without
+           probing the scheduler (see ReadyQueueStat).
+         */
+        const TimeIntegral &getReadyLength() const { return _readyLen; }
 
 
         /**
@@ -253,33 +427,88 @@ namespace RTSim {
         virtual void endRun();
         virtual void print();
 
+        /// Saves the models and the order of the ready queue
+        virtual void saveState(Checkpoint &c);
+        virtual void loadState(Checkpoint &c);
+
     protected:
+        /**
+           Writes the executing task and the order of the ready
+           queue, for the signature of the schedulers whose
+           models have no other state (see Entity::getSignature())
+        */
+        void signQueue(StateImage &s);
         /// pointer to the kernel
         AbsKernel* _kernel;
 
-        /// priority queue, ordered by a TaskModelCmp
-        priority_list<TaskModel*, TaskModel::TaskModelCmp> _queue;
+        /// priority queue, ordered by a TaskModelCmp. It is a
+        /// sorted array, so getTaskN() takes constant time.
+        ReadyQueue _queue;
+
+        /**
+           @name Queue storage
 
-        /// map between tasks and models
+           The functions that store the models of the ready tasks:
+           by default they use _queue. A scheduler can keep the
+           ready models in another structure by redefining all of
+           them; the models must be kept in TaskModelCmp order.
+        */
+        //@{
+        /// puts a model (just re-keyed) in the queue
+        virtual void queueInsert(TaskModel *m) { _queue.insert(m); }
+        /// removes a model from the queue
+        virtual void queueErase(TaskModel *m) { _queue.erase(m); }
+        /// moves a model of the queue after re-keying it
+        virtual void queueRekey(TaskModel *m);
+        /// the (n+1)-th model of the queue, or NULL
+        virtual TaskModel *queueAt(unsigned int n) {
+            return n < _queue.size() ? _queue[n] : NULL;
+        }
+        virtual size_t queueSize() const { return _queue.size(); }
+        virtual void queueClear() { _queue.clear(); }
+        //@}
+
+        /// map between tasks and models. find() looks here only for
+        /// the tasks whose handle (see AbsTask::setSchedHandle())
+        /// belongs to another scheduler.
         map<AbsRTTask*, TaskModel*> _tasks;
+
+        /// identifies this scheduler as the owner of task handles
+        unsigned long _handleId;
+        static unsigned long _lastHandleId;
         
         /// current executing task
 	AbsRTTask* _currExe;
 
-        // stores the old task priorities
-        map<AbsRTTask *, int> oldPriorities;
+        /// incremented every time a model leaves the queue
+        unsigned long _extractCount;
+
+        /// see getReadyLength()
+        TimeIntegral _readyLen;
+
+        /// Updates _readyLen after the queue has changed
+        void trackReady() { _readyLen.set(SIMUL.getTime(), double(queueSize())); }
 
         /**
            This is the internal version of the addTask, it
            enqueues a model and adds the corresponding task to
-           the kernel.
+           the kernel. The model is also stored in the task handle,
+           if no other scheduler is using it.
         */
         virtual void enqueueModel(TaskModel* model);
 
+        /**
+           The reverse of enqueueModel(): forgets the model of a
+           task that is not in the queue, and deletes it. Used by
+           removeTask().
+        */
+        void dropModel(AbsRTTask* task);
+
         /** 
          * This function returns a TaskModel from a task. It is
          * used mainly inside this class, but it can also be
-         * used by some resource manager. */
+         * used by some resource manager. It takes constant time
+         * when the task handle belongs to this scheduler. */
         TaskModel* find(AbsRTTask* task);
     
         /// @todo change it into ResManager
@@ -0,0 +1,90 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <particle.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+
+#include <exeinstr.hpp>
+#include <sensitivity.hpp>
+#include <task.hpp>
+#include <taskevt.hpp>
+
+namespace RTSim {
+
+    WCETSensitivity::WCETSensitivity(Tick horizon) :
+        _horizon(horizon), _costs(), _missed(false), _missTime(0),
+        _runs(0), _simulated(0)
+    {
+    }
+
+    void WCETSensitivity::addTask(Task *t)
+    {
+        const std::vector<Instr *> &code = t->getInstrQueue();
+        for (size_t i = 0; i < code.size(); ++i) {
+            ExecInstr *e = dynamic_cast<ExecInstr *>(code[i]);
+            if (e == NULL) continue;
+            Cost c = { e, e->getWCET() };
+            _costs.push_back(c);
+        }
+        new Particle<DeadEvt, WCETSensitivity>(&t->deadEvt, this);
+    }
+
+    void WCETSensitivity::probe(const DeadEvt &e)
+    {
+        if (!_missed) {
+            _missed = true;
+            _missTime = SIMUL.getTime();
+            SIMUL.stop();
+        }
+    }
+
+    void WCETSensitivity::scale(double f)
+    {
+        for (size_t i = 0; i < _costs.size(); ++i)
+            _costs[i].instr->setCost(
+                new DeltaVar(double(Tick::ceil(double(_costs[i].base) * f))));
+    }
+
+    bool WCETSensitivity::isSchedulable(double f)
+    {
+        scale(f);
+        _missed = false;
+        _missTime = 0;
+
+        SIMUL.initSingleRun();
+        _simulated += SIMUL.run_to(_horizon);
+        SIMUL.endSingleRun();
+
+        ++_runs;
+        return !_missed;
+    }
+
+    double WCETSensitivity::search(double lo, double hi, double precision)
+    {
+        double f;
+        if (!isSchedulable(lo)) f = 0;
+        else if (isSchedulable(hi)) f = hi;
+        else {
+            while (hi - lo > precision) {
+                double mid = (lo + hi) / 2;
+                if (isSchedulable(mid)) lo = mid;
+                else hi = mid;
+            }
+            f = lo;
+        }
+        scale(1);
+        return f;
+    }
+
+} // namespace RTSim
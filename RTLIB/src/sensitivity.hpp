@@ -0,0 +1,113 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SENSITIVITY_HPP__
+#define __SENSITIVITY_HPP__
+
+#include <vector>
+
+#include <basetype.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    class DeadEvt;
+    class ExecInstr;
+    class Task;
+
+    /**
+       \ingroup util
+
+       Sensitivity analysis by simulation: it finds the largest
+       factor by which the WCETs of a set of tasks can be scaled
+       without missing a deadline in the first horizon ticks of
+       the simulation.
+
+       Every candidate factor is a run of the simulation that
+       already exists: the costs of the ExecInstrs of the tasks
+       are replaced between two runs (see ExecInstr::setCost()),
+       and the run stops at the first deadline miss, so an
+       unschedulable factor usually costs a small fraction of the
+       horizon. The factors are bisected, since a larger WCET can
+       only cause more misses with fixed periods.
+
+       The costs of the instructions must be deterministic (see
+       Instr::getWCET()); they are the ones with factor 1, and
+       they are restored at the end of search().
+
+       <pre>
+       WCETSensitivity s(hyperperiod);
+       s.addTask(&t1);
+       s.addTask(&t2);
+       double f = s.search(1.0, 4.0, 0.01);
+       </pre>
+
+       The deadline events of the tasks are watched by the object
+       (see Particle), which must live as long as the tasks.
+    */
+    class WCETSensitivity {
+        struct Cost {
+            ExecInstr *instr;
+            Tick base;
+        };
+
+        Tick _horizon;
+        std::vector<Cost> _costs;
+        bool _missed;
+        Tick _missTime;
+        int _runs;
+        Tick _simulated;
+
+        void scale(double f);
+
+    public:
+        /// A search on the first horizon ticks of every run
+        explicit WCETSensitivity(Tick horizon);
+
+        /**
+           Adds the execution instructions of t to the ones scaled
+           by the factor.
+        */
+        void addTask(Task *t);
+
+        /**
+           Runs the simulation with the WCETs scaled by f (rounded
+           up to the tick), until the horizon or the first deadline
+           miss. Returns true if no deadline was missed. The
+           costs are left scaled.
+        */
+        bool isSchedulable(double f);
+
+        /**
+           Bisects [lo, hi] until its width is below precision, and
+           returns the largest factor found schedulable, or 0 if lo
+           is not. Returns hi if hi is schedulable.
+        */
+        double search(double lo, double hi, double precision);
+
+        /// Time of the first miss in the last run (if any)
+        Tick getMissTime() const { return _missTime; }
+
+        /// Runs of the simulation so far
+        int getRuns() const { return _runs; }
+
+        /// Ticks simulated by all the runs so far
+        Tick getSimulatedTime() const { return _simulated; }
+
+        void probe(const DeadEvt &e);
+    };
+
+} // namespace RTSim
+
+#endif
@@ -30,12 +30,13 @@ namespace RTSim {
         kernel(0),
         sched_(0),
         currExe_(0),
-        _bandExEvt(this, &Server::onBudgetExhausted, Event::_DEFAULT_PRIORITY + 4),
-        _dlineMissEvt(this, &Server::onDlineMiss, Event::_DEFAULT_PRIORITY + 6),
-        _rechargingEvt(this, &Server::onRecharging, Event::_DEFAULT_PRIORITY - 1),
-	_schedEvt(this, &Server::onSched),
-	_deschedEvt(this, &Server::onDesched),
-	_dispatchEvt(this, &Server::onDispatch, Event::_DEFAULT_PRIORITY + 5)
+        supervisor_index(-1),
+        _bandExEvt(this, Event::_DEFAULT_PRIORITY + 4),
+        _dlineMissEvt(this, Event::_DEFAULT_PRIORITY + 6),
+        _rechargingEvt(this, Event::_DEFAULT_PRIORITY - 1),
+	_schedEvt(this),
+	_deschedEvt(this),
+	_dispatchEvt(this, Event::_DEFAULT_PRIORITY + 5)
     {
         DBGENTER(_SERVER_DBG_LEV);
         string s_name = parse_util::get_token(s);
@@ -47,7 +48,7 @@ namespace RTSim {
         DBGPRINT("PARAMETERS: ");
         for (int i=0; i<p.size(); ++i) DBGPRINT(p[i]);
 
-        auto_ptr<Scheduler> curr = FACT(Scheduler).create(s_name, p);
+        unique_ptr<Scheduler> curr = FACT(Scheduler).create(s_name, p);
         sched_ = curr.release();
         if (!sched_) throw ParseExc("Server::Server()", s);
 
@@ -181,11 +182,25 @@ namespace RTSim {
         dispatch();
     }
         
+    void Server::armBudget(Tick t)
+    {
+        if (_bandExEvt.isInQueue() && _bandExEvt.getTime() <= t) return;
+        _bandExEvt.drop();
+        _bandExEvt.post(t);
+    }
+
     void Server::onBudgetExhausted(Event *)
     {
         DBGENTER(_SERVER_DBG_LEV);
 
-        assert(status == EXECUTING);
+        // a lazily armed event (see armBudget())
+        if (status != EXECUTING) return;
+        Tick end = getBudgetEnd();
+        if (end > SIMUL.getTime()) {
+            _bandExEvt.post(end);
+            return;
+        }
+        if (coalesce()) return;
 
         _dispatchEvt.drop();
 
@@ -211,7 +226,18 @@ namespace RTSim {
         assert(status == READY);
 
         ready_executing();
-        dispatch();
+
+        // the root kernel has just picked this server: if it has a
+        // task to run and nothing else is due now, dispatch it at
+        // once instead of going through the event queue, unless
+        // someone is probing the event
+        Event *first = Event::getFirst();
+        if (sched_->getFirst() != NULL && !_dispatchEvt.isInQueue() &&
+            !_dispatchEvt.hasProbes() &&
+            (first == NULL || first->getTime() > SIMUL.getTime()))
+            onDispatch(&_dispatchEvt);
+        else
+            dispatch();
     }
                 
     void Server::onDesched(Event *)
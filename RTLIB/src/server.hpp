@@ -34,6 +34,8 @@ namespace RTSim {
 
     class CPU;
 
+    DECL_MEM_CATEGORY(ReplMem, "replenishment queues");
+
     /// Enumeration of possible server states 
     typedef enum {IDLE, 
                   READY, 
@@ -97,17 +99,12 @@ namespace RTSim {
         AbsKernel *kernel;
         ResManager *globResManager;
 
-        GEvent<Server> _bandExEvt;
-        GEvent<Server> _dlineMissEvt;
-        GEvent<Server> _rechargingEvt;
-
-        GEvent<Server> _schedEvt;
-        GEvent<Server> _deschedEvt;
-        GEvent<Server> _dispatchEvt;
-
         Scheduler *sched_;
                 
         AbsRTTask *currExe_;
+
+        /// index of the server in its Supervisor, -1 if none
+        int supervisor_index;
                 
         /** Sets the current relative deadline (if any)*/
         inline void setDeadline(Tick d) { dline = d; }
@@ -141,6 +138,34 @@ namespace RTSim {
         /// from recharging to idle (nothing remains to be done)
         virtual void recharging_idle() = 0;
 
+        /**
+           The time at which the budget of the executing server is
+           exhausted, computed from the last time it was scheduled.
+           Servers that arm the budget event with armBudget() must
+           return the exact time; the default (the current time)
+           makes every budget event count.
+        */
+        virtual Tick getBudgetEnd() const { return SIMUL.getTime(); }
+
+        /**
+           Arms the budget exhaustion event at time t. An event
+           that is already armed at an earlier time is left where
+           it is (so a preemption does not need to drop it): when
+           it fires, onBudgetExhausted() ignores it if the server
+           is not executing, and moves it to getBudgetEnd() if the
+           budget is not over yet.
+        */
+        void armBudget(Tick t);
+
+        /**
+           Called by onBudgetExhausted() when the budget is over,
+           before the server is suspended: a server that can go
+           through the exhaustion without leaving the processor
+           (see CBServer::setCoalescing()) does it, and returns
+           true. By default, it returns false.
+        */
+        virtual bool coalesce() { return false; }
+
     public:
 
         /** 
@@ -197,6 +222,12 @@ namespace RTSim {
         */
         void addTask(AbsRTTask &task, const std::string &params = "");
 
+        /**
+           The backlog of the server over the time: the number of
+           its active tasks (see Scheduler::getReadyLength()).
+        */
+        const TimeIntegral &getBacklog() const { return sched_->getReadyLength(); }
+
         /**  
              Inherited from AbsRTTask. This function is called
              when the server is selected to execute. 
@@ -339,6 +370,14 @@ namespace RTSim {
         /** print the server status (only for debugging) */
         inline std::string getStatusString() const { return status_string[status];}
 
+        /** 
+            The index given to the server by the Supervisor that
+            handles it (-1 if none), so that the supervisor does
+            not have to look the server up.
+        */
+        inline int getSupervisorIndex() const { return supervisor_index; }
+        inline void setSupervisorIndex(int i) { supervisor_index = i; }
+
         void newRun(); 
         void endRun();
 
@@ -376,6 +415,17 @@ namespace RTSim {
 	virtual bool isContextSwitching() const { return false; }
 
 //	virtual std::vector<std::string> getRunningTasks() = 0;
+
+    protected:
+        // declared after the handlers, which are template
+        // arguments of the events
+        StaticGEvent<Server, &Server::onBudgetExhausted> _bandExEvt;
+        StaticGEvent<Server, &Server::onDlineMiss> _dlineMissEvt;
+        StaticGEvent<Server, &Server::onRecharging> _rechargingEvt;
+
+        StaticGEvent<Server, &Server::onSched> _schedEvt;
+        StaticGEvent<Server, &Server::onDesched> _deschedEvt;
+        StaticGEvent<Server, &Server::onDispatch> _dispatchEvt;
     };
 } // namespace RTSim
 
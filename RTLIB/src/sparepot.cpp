@@ -6,13 +6,14 @@ namespace RTSim {
     using namespace std;
     SparePot::SparePot(const string &name) : Entity(name),
                                              server_vector(),
-                                             servers(),
                                              counter(0),
+                                             dim(0),
                                              pi(),
                                              delta(),
                                              coeff(),
                                              last_change_time(0),
-                                             spare_budget(0)
+                                             spare_budget(0),
+                                             _changeEvt(EndEvt::_END_EVT_PRIORITY + 4)
     {
     }
     
@@ -48,6 +49,11 @@ namespace RTSim {
 
         sort(server_vector.begin(), server_vector.end());
 
+        dim = server_vector.size();
+        pi.assign(dim * dim, 0);
+        coeff.assign(dim * dim, 0);
+        delta.assign(dim, 0);
+
         DBGPRINT("Now the vector is sorted, compute response times");
         // then compute response times
         vector<double> response_time(server_vector.size());
@@ -117,23 +123,12 @@ namespace RTSim {
     
     void SparePot::addMyServer(SporadicServer *s, const row_t &m)
     {
-        servers[s] = counter;
-        counter ++;
-        
-        row_t myrow;
-        for (int i=0; i<counter; i++) myrow.push_back(m[i]);
-
-        coeff.push_back(myrow);
-        delta.push_back(0);
-        
-        //row_t myrow(counter);
-        for(int i=0; i<counter; i++) myrow[i] = 0;
+        if (counter == 0 || counter >= dim) 
+            throw SparePotExc("addMyServer() called out of compute_matrix()");
 
-        pi.push_back(myrow);
-        
-        for (int i=0; i<counter-1; i++) {
-            pi[i].push_back(0);
-        }
+        s->setSupervisorIndex(counter);
+        for (int j=0; j<counter; j++) coeff_ij(counter, j) = m[j];
+        counter ++;
     }
 
     void SparePot::setSpare(const Tick &budget, const Tick &period)
@@ -141,17 +136,12 @@ namespace RTSim {
         if (counter != 0) 
             throw SparePotExc("setSpare() must be called first!");
         
-        servers[0] = 0;
         counter++;
 
         spare_budget = budget;
         
-        row_t myrow;
-        coeff.push_back(myrow);
-        delta.push_back(budget);
-
-        myrow.push_back(-budget);
-        pi.push_back(myrow);
+        delta[0] = budget;
+        pi_ij(0, 0) = -budget;
     }
 
     
@@ -161,7 +151,9 @@ namespace RTSim {
 
 	SporadicServer *s = (SporadicServer *) ss;
 
-        int index = servers[s];
+        int index = s->getSupervisorIndex();
+        if (index <= 0 || index >= counter)
+            throw SparePotExc("Server not handled by " + getName());
         double ret = 0;
         double delta_budget = double(db);
 
@@ -172,20 +164,20 @@ namespace RTSim {
             DBGPRINT("Positive part");
             for (int j=index; j>=0 && delta_budget>0; j--) {
                 if (delta[j] > 0) {
-                    DBGVAR(coeff[index][j]);
-                    double x = min(delta_budget, coeff[index][j]*delta[j]);
-                    pi[index][j] = pi[index][j] + x;
-                    pi[j][index] = pi[j][index] + x/coeff[index][j];
+                    DBGVAR(coeff_ij(index, j));
+                    double x = min(delta_budget, coeff_ij(index, j)*delta[j]);
+                    pi_ij(index, j) = pi_ij(index, j) + x;
+                    pi_ij(j, index) = pi_ij(j, index) + x/coeff_ij(index, j);
 
                     delta[index] = delta[index] - x;
-                    delta[j] = delta[j] - x/coeff[index][j];
+                    delta[j] = delta[j] - x/coeff_ij(index, j);
 
                     delta_budget = delta_budget - x;
                     ret = ret + x;
                     
                     DBGPRINT_4("j=", j, " x = ", x); 
-                    DBGPRINT_4("pi[index][j] = ", pi[index][j],
-                               " pi[j][index] = ", pi[j][index]);
+                    DBGPRINT_4("pi_ij(index, j) = ", pi_ij(index, j),
+                               " pi_ij(j, index) = ", pi_ij(j, index));
                     DBGPRINT_4("delta[index] = ", delta[index],
                                " delta[j] = ", delta[j]);
                     DBGPRINT_2("delta_budget = ", delta_budget);
@@ -196,19 +188,19 @@ namespace RTSim {
         else if (delta_budget < 0) {
             DBGPRINT("Negative part");
             for (int j=0; j<index && delta_budget < 0; j++) {
-                double x = min(pi[index][j], -delta_budget);
-                pi[index][j] = pi[index][j] - x;
-                pi[j][index] = pi[j][index] - x/coeff[index][j];
+                double x = min(pi_ij(index, j), -delta_budget);
+                pi_ij(index, j) = pi_ij(index, j) - x;
+                pi_ij(j, index) = pi_ij(j, index) - x/coeff_ij(index, j);
 
                 delta[index] = delta[index] + x;
-                delta[j] = delta[j] + x/coeff[index][j];
+                delta[j] = delta[j] + x/coeff_ij(index, j);
 
                 delta_budget = delta_budget + x;
                 ret = ret - x;
 
                 DBGPRINT_4("j=", j, " x = ", x); 
-                DBGPRINT_4("pi[index][j] = ", pi[index][j],
-                           " pi[j][index] = ", pi[j][index]);
+                DBGPRINT_4("pi_ij(index, j) = ", pi_ij(index, j),
+                           " pi_ij(j, index) = ", pi_ij(j, index));
                 DBGPRINT_4("delta[index] = ", delta[index],
                            " delta[j] = ", delta[j]);
                 DBGPRINT_2("delta_budget = ", delta_budget);
@@ -218,14 +210,14 @@ namespace RTSim {
                 DBGPRINT_2("delta_budget is still ", delta_budget);
                 DBGVAR(delta[index]);
 
-                pi[index][index] = pi[index][index] + delta_budget;
+                pi_ij(index, index) = pi_ij(index, index) + delta_budget;
 
                 //assert(delta[index] == 0);
 
                 delta[index] = delta[index] - delta_budget;
 
                 DBGPRINT_2("delta[index] = ", delta[index]);
-                DBGPRINT_2("pi[index][index] = ", pi[index][index]);
+                DBGPRINT_2("pi_ij(index, index) = ", pi_ij(index, index));
 
                 ret = ret + delta_budget;
             }
@@ -244,8 +236,7 @@ namespace RTSim {
                 DBGPRINT_2("ret < 0, new change time at ", last_change_time);
             }
             else if (ret > 0) {
-                ChangeBudgetEvt *e = new ChangeBudgetEvt(this, s, Tick::ceil(ret)+s->getBudget());
-                e->post(last_change_time, true);
+                _changeEvt.add(s, Tick::ceil(ret)+s->getBudget(), last_change_time);
                 DBGPRINT_2("ret > 0, new change time at ", last_change_time);
             }
         }
@@ -253,30 +244,20 @@ namespace RTSim {
         return Tick::floor(ret);
     }
 
-    void SparePot::onChangeBudget(ChangeBudgetEvt *e)
-    {
-        DBGENTER(_SPARE_POT_DBG_LEV);
-        SporadicServer *ss = e->getServer();
-        ss->changeBudget(Tick::floor(e->getBudget()));
-    }
-
     void SparePot::newRun()
     {
         DBGENTER(_SPARE_POT_DBG_LEV);
         last_change_time = 0;
+        _changeEvt.clear();
         
         DBGVAR(delta.size());
         delta[0] = spare_budget;
         
         DBGVAR(pi.size());
-        pi[0][0] = -spare_budget;
-
-        for (int j=1; j<counter; j++) pi[0][j] = 0;
+        pi.assign(pi.size(), 0);
+        pi_ij(0, 0) = -spare_budget;
 
-        for (int i=1; i<counter; i++) {
-            delta[i] = 0;
-            for (int j=0; j<counter; j++) pi[i][j] = 0;
-        }
+        for (int i=1; i<counter; i++) delta[i] = 0;
     }
 
     void SparePot::endRun()
@@ -2,7 +2,6 @@
 #define __SPAREPOT_H__
 
 #include <vector>
-#include <map>
 #include <sporadicserver.hpp>
 #include <supervisor.hpp>
 
@@ -34,18 +33,25 @@ namespace RTSim {
     protected:
         std::vector<server_struct> server_vector;
 
-        std::map<SporadicServer *, int> servers;
+        // the index of each server is stored in the server (see
+        // Server::getSupervisorIndex())
         int counter;
+
+        // size of the matrices (the spare plus the servers)
+        int dim;
         
-        // this is the lend/borrow matrix
-        std::vector<row_t> pi;
+        // this is the lend/borrow matrix, stored by rows
+        row_t pi;
 
         // this is the total amount of budget lended/borrowed by each
         // server
         std::vector<double> delta;
 
-        // these are called mij in the paper
-        std::vector<row_t> coeff;
+        // these are called mij in the paper, stored by rows
+        row_t coeff;
+
+        double &pi_ij(int i, int j) { return pi[i * dim + j]; }
+        double &coeff_ij(int i, int j) { return coeff[i * dim + j]; }
 
         Tick last_change_time;
 
@@ -111,21 +117,8 @@ namespace RTSim {
         void setSpare(const Tick &budget, const Tick &period);
 
 
-        class ChangeBudgetEvt;
-        friend class ChangeBudgetEvt;
-        void onChangeBudget(ChangeBudgetEvt *e);
-
-        class ChangeBudgetEvt : public Event {
-            SparePot *sp;
-            SporadicServer *ss;
-            Tick budget;
-        public:
-            ChangeBudgetEvt(SparePot *s1, SporadicServer *s2, Tick b) :
-                Event(EndEvt::_END_EVT_PRIORITY + 4), sp(s1), ss(s2), budget(b) {}
-            virtual void doit() { sp->onChangeBudget(this); }
-            SporadicServer *getServer() { return ss; }
-            Tick getBudget() { return budget; }
-        };
+        /// the accepted changes that will be applied later
+        BudgetChangeEvt _changeEvt;
     };
 
     inline bool operator<(const SparePot::server_struct &a, const SparePot::server_struct &b)
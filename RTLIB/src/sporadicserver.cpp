@@ -14,8 +14,8 @@ namespace RTSim {
         cap(0),
         last_time(0),
         recharging_time(0),
-        repl_queue(),
-        capacity_queue(),
+        repl_queue(size_t(-1)),
+        capacity_queue(size_t(-1)),
         _replEvt(this, &SporadicServer::onReplenishment, 
 		 Event::_DEFAULT_PRIORITY - 1),
 	_idleEvt(this, &SporadicServer::onIdle),
@@ -89,7 +89,7 @@ namespace RTSim {
 
         DBGPRINT_2("Last time is: ", last_time);
 
-        _bandExEvt.post(last_time + cap);
+        armBudget(last_time + cap);
     }
 
     void SporadicServer::executing_ready()
@@ -99,7 +99,6 @@ namespace RTSim {
         status = READY;
         
         cap = cap - (SIMUL.getTime() - last_time);
-        _bandExEvt.drop();
         vtime.stop();
         repl_queue.back().second += SIMUL.getTime() - last_time;
     }
@@ -112,7 +111,6 @@ namespace RTSim {
 
         if (status == EXECUTING) {
             cap = cap - (SIMUL.getTime() - last_time);
-            _bandExEvt.drop();
             repl_queue.back().second += SIMUL.getTime() - last_time;
             check_repl();
 
@@ -227,6 +225,11 @@ namespace RTSim {
 
     void SporadicServer::prepare_replenishment(const Tick &t)
     {
+        // the budget consumed from now on is added to the last
+        // replenishment: if it is due at the same time, it is
+        // the same replenishment
+        if (!repl_queue.empty() && repl_queue.back().first == t + P) return;
+
         repl_t r;
         r.first = t + P;
         r.second = 0; // still don't know...
@@ -260,11 +263,9 @@ namespace RTSim {
                 DBGPRINT_3("Server ", getName(), " is executing");
                 cap = cap - (SIMUL.getTime() - last_time);
                 repl_queue.back().second += SIMUL.getTime() - last_time;
-                _bandExEvt.drop();
-                vtime.stop();
                 last_time = SIMUL.getTime();
-                _bandExEvt.post(last_time + cap);
-                vtime.start((double)P/double(n));
+                armBudget(last_time + cap);
+                vtime.set_speed((double)P/double(n));
                 DBGPRINT_2("Reposting bandExEvt at ", last_time + cap);
             }
             Q = n;
@@ -282,8 +283,6 @@ namespace RTSim {
                 repl_queue.back().second += SIMUL.getTime() - last_time;
                 last_time = SIMUL.getTime();
                 DBGVAR(cap);
-                _bandExEvt.drop();
-                vtime.stop();
             }
 
             // First, reduce the current capacity
@@ -299,30 +298,30 @@ namespace RTSim {
             DBGVAR(delta);
 
             // if there is some delta left, reduce the capacity queue
-            list<repl_t>::iterator i= capacity_queue.begin();
-            while (delta > 0 && i!=capacity_queue.end()) {
-                Tick x = min(delta, i->second);
-                i->second -= x;
+            size_t i = 0;
+            while (delta > 0 && i < capacity_queue.size()) {
+                Tick x = min(delta, capacity_queue[i].second);
+                capacity_queue[i].second -= x;
                 delta -= x;
                 DBGPRINT_2("Capacity queue dec, now delta is: ", delta);
                 i++;
             }
             
             // if there is some delta left, reduce the replenishment queue
-            i = repl_queue.begin();
-            Tick last_repl_time = repl_queue.begin()->first;
-            while (delta>0 && i!=repl_queue.end()) {
-                Tick x = min(delta, i->second);
-                i->second -= x;
+            i = 0;
+            Tick last_repl_time = repl_queue.front().first;
+            while (delta > 0 && i < repl_queue.size()) {
+                Tick x = min(delta, repl_queue[i].second);
+                repl_queue[i].second -= x;
                 delta -= x;
                 DBGPRINT_2("Repl queue dec, now delta is: ", delta);
-                DBGVAR(i->second);
-                last_repl_time = i->first;
+                DBGVAR(repl_queue[i].second);
+                last_repl_time = repl_queue[i].first;
                 i++;
             }
             
             // cannot be true, or delta > Q
-            assert((delta == 0) || (i!=repl_queue.end()));
+            assert((delta == 0) || (i < repl_queue.size()));
 
             // the time of the first non-zero replenishment
             ret = last_repl_time;
@@ -345,7 +344,7 @@ namespace RTSim {
             }
 
             if (status == EXECUTING) {
-                vtime.start(double(P)/double(Q));
+                vtime.set_speed(double(P)/double(Q));
                 DBGPRINT("Server was executing");
                 if (cap == 0) {
                     DBGPRINT("capacity is zero, go to recharging");
@@ -359,7 +358,7 @@ namespace RTSim {
                 }
                 else {
                     DBGPRINT_2("Reposting bandExEvt at ", last_time + cap);    
-                    _bandExEvt.post(last_time + cap);
+                    armBudget(last_time + cap);
                 }
             }
         }
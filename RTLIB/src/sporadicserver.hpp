@@ -3,7 +3,7 @@
 
 #include <server.hpp>
 #include <capacitytimer.hpp>
-#include <list>
+#include <ringbuf.hpp>
 
 namespace RTSim {
     
@@ -19,15 +19,20 @@ namespace RTSim {
         /// replenishment: it is a pair of <t,b>, meaning that
         /// at time t the budget should be replenished by b.
         typedef std::pair<Tick, Tick> repl_t;
+
+        /// FIFO of replenishments, in a ring buffer that stops
+        /// allocating once it has reached its largest size
+        typedef ring_buffer<repl_t, TrackedAllocator<repl_t, ReplMem> > ReplQueue;
         
         /// queue of replenishments
-        /// all times are in the future!
-        std::list<repl_t> repl_queue;
+        /// all times are in the future! Two replenishments at
+        /// the same time are merged (see prepare_replenishment())
+        ReplQueue repl_queue;
         
         /// at the replenishment time, the replenishment is moved
         /// from the repl_queue to the capacity_queue, so
         /// all times are in the past.
-        std::list<repl_t> capacity_queue;
+        ReplQueue capacity_queue;
         
         /// A new event replenishment, different from the general
         /// "recharging" used in the Server class
@@ -75,6 +80,8 @@ namespace RTSim {
         
         /// from executing to recharging (budget exhausted)
         virtual void executing_recharging();
+
+        virtual Tick getBudgetEnd() const { return last_time + cap; }
         
         /// from recharging to active contending (budget recharged)
         virtual void recharging_ready();
@@ -0,0 +1,182 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __STATICKERNEL_HPP__
+#define __STATICKERNEL_HPP__
+
+#include <simul.hpp>
+#include <tracepoint.hpp>
+
+#include <edfsched.hpp>
+#include <fpsched.hpp>
+#include <kernel.hpp>
+
+namespace RTSim {
+
+    using namespace MetaSim;
+
+    /**
+       \ingroup sched
+
+       A Base scheduler whose models are all of class Model, with
+       the operations used by the kernels at every job (insert(),
+       extract(), getFirst(), getTaskN()) compiled for them: the
+       priority of the models and the queue of Base are reached
+       without virtual calls, so the compiler can inline them.
+
+       It behaves exactly as Base, and it can be used wherever Base
+       is (e.g. with a MRTKernel, for global EDF). Base must create
+       only models of class Model (a scheduler that derives from
+       Base with other models cannot be specialized this way).
+
+       @see StaticEDFScheduler, StaticFPScheduler, StaticRTKernel
+    */
+    template <class Base, class Model>
+    class StaticScheduler : public Base {
+    public:
+        void insert(AbsRTTask *task)
+        {
+            TaskModel *m = this->find(task);
+            if (m == NULL) throw RTSchedExc("AbsRTTaskNotFound");
+
+            Model *model = static_cast<Model *>(m);
+            model->Model::setInsertTime(SIMUL.getTime());
+            model->setActive();
+            model->template updateKeyAs<Model>();
+            this->Base::queueInsert(model);
+            this->_readyLen.set(SIMUL.getTime(), double(this->Base::queueSize()));
+        }
+
+        void extract(AbsRTTask *task)
+        {
+            TaskModel *m = this->find(task);
+            if (m == NULL) throw RTSchedExc("AbsRTTask not found");
+
+            this->Base::queueErase(m);
+            this->_extractCount++;
+            m->setInactive();
+            this->_readyLen.set(SIMUL.getTime(), double(this->Base::queueSize()));
+        }
+
+        AbsRTTask *getFirst() { return getTaskN(0); }
+
+        AbsRTTask *getTaskN(unsigned int n)
+        {
+            TaskModel *m = this->Base::queueAt(n);
+            return m != NULL ? m->getTask() : NULL;
+        }
+    };
+
+    /// EDF, with the deadline read without virtual calls
+    typedef StaticScheduler<EDFScheduler, EDFModel> StaticEDFScheduler;
+
+    /// Fixed priorities, on the bitmap queue of FPScheduler
+    typedef StaticScheduler<FPScheduler, FPScheduler::FPModel> StaticFPScheduler;
+
+    /**
+       \ingroup kernels
+
+       A RTKernel bound to a scheduler of class Sched (usually a
+       StaticScheduler): the scheduler is called without virtual
+       calls at every arrival, end and dispatch, so the whole path
+       from the event of a task to the choice of the next one can
+       be inlined.
+
+       @code
+       StaticEDFScheduler sched;
+       StaticRTKernel<StaticEDFScheduler> kern(&sched);
+       @endcode
+
+       The simulation is the same as with a RTKernel and the
+       corresponding generic scheduler (see rtlib_bench).
+    */
+    template <class Sched>
+    class StaticRTKernel : public RTKernel {
+        Sched *_static;
+
+    public:
+        StaticRTKernel(Sched *s, const std::string &name = "", CPU *c = NULL) :
+            RTKernel(s, name, c), _static(s) {}
+
+        void activate(AbsRTTask *task) { _static->Sched::insert(task); }
+
+        void suspend(AbsRTTask *task)
+        {
+            _static->Sched::extract(task);
+            if (_currExe == task) {
+                task->deschedule();
+                _currExe = NULL;
+            }
+        }
+
+        void onArrival(AbsRTTask *task)
+        {
+            DBGENTER(_KERNEL_DBG_LEV);
+            DBG_POINT(_KERNEL_DBG_LEV, "arrival", task->getTaskNumber());
+
+            _static->Sched::insert(task);
+            if (!_isContextSwitching) RTKernel::dispatch();
+            else {
+                beginDispatchEvt.drop();
+                beginDispatchEvt.post(endDispatchEvt.getTime());
+            }
+        }
+
+        void onEnd(AbsRTTask *task)
+        {
+            DBGENTER(_KERNEL_DBG_LEV);
+
+            if (_cpu == NULL)
+                throw RTKernelExc("Received a onEnd of a non executing task");
+            DBG_POINT(_KERNEL_DBG_LEV, "end", task->getTaskNumber());
+            _static->Sched::extract(task);
+            _currExe = NULL;
+            RTKernel::dispatch();
+        }
+
+        void onBeginDispatch(Event *e)
+        {
+            DBGENTER(_KERNEL_DBG_LEV);
+
+            AbsRTTask *newExe = _static->Sched::getFirst();
+            if (_currExe == newExe) {
+                _static->Sched::notify(newExe);
+                return;
+            }
+            if (_currExe != NULL) _currExe->deschedule();
+            if (newExe == NULL) return;
+
+            DBG_POINT(_KERNEL_DBG_LEV, "context switch", newExe->getTaskNumber());
+            _isContextSwitching = true;
+            _currExe = newExe;
+            // as in RTKernel::onBeginDispatch()
+            if (_contextSwitchDelay == 0 && !endDispatchEvt.hasProbes())
+                StaticRTKernel::onEndDispatch(&endDispatchEvt);
+            else
+                endDispatchEvt.post(SIMUL.getTime() + _contextSwitchDelay);
+        }
+
+        void onEndDispatch(Event *e)
+        {
+            DBGENTER(_KERNEL_DBG_LEV);
+
+            _currExe->schedule();
+            DBG_POINT(_KERNEL_DBG_LEV, "running", _currExe->getTaskNumber());
+            _isContextSwitching = false;
+            _static->Sched::notify(_currExe);
+        }
+    };
+
+} // namespace RTSim
+
+#endif
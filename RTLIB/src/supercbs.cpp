@@ -29,7 +29,8 @@ namespace RTSim {
     servers(), 
     period(),
     wcet(),
-    U() 
+    U(),
+    _changeEvt()
     {    
     }
     
@@ -83,8 +84,7 @@ namespace RTSim {
                 DBGPRINT_2("delta_budget < 0, new change time at ", last_change_time);
             }
 	    else if (delta_budget > 0) {
-                ChangeBudgetEvt *e = new ChangeBudgetEvt(this, s, delta_budget + s->getBudget());
-                e->post(last_change_time, true);
+                _changeEvt.add(s, delta_budget + s->getBudget(), last_change_time);
                 DBGPRINT_2("delta_budget > 0, new change time at ", last_change_time);
             }
         }
@@ -92,13 +92,6 @@ namespace RTSim {
         return delta_budget;
     }
 
-    void SuperCBS::onChangeBudget(ChangeBudgetEvt *e)
-    {
-        DBGPRINT("SuperCBS::onChangeBudget(ChangeBudgetEvt *e)");
-        Server *ss = e->getServer();
-        ss->changeBudget(e->getBudget());
-    }
-
     
 
 
@@ -129,6 +122,7 @@ namespace RTSim {
       void SuperCBS::newRun()
     {
         last_change_time = 0;      
+        _changeEvt.clear();
     }
     
     void SuperCBS::endRun()
@@ -47,21 +47,8 @@ namespace RTSim {
 
         int task;
     
-        class ChangeBudgetEvt;
-        friend class ChangeBudgetEvt;
-        void onChangeBudget(ChangeBudgetEvt *e);
-
-        class ChangeBudgetEvt : public Event {
-            SuperCBS *sp;
-            Server *ss;
-            Tick budget;
-        public:
-            ChangeBudgetEvt(SuperCBS *s1, Server *s2, double b) :
-                Event(), sp(s1), ss(s2), budget(b) {}
-            virtual void doit() { sp->onChangeBudget(this); }
-            Server *getServer() { return ss; }
-            Tick getBudget() { return budget; }
-        };
+        /// the accepted changes that will be applied later
+        BudgetChangeEvt _changeEvt;
 
     public:
  
@@ -0,0 +1,115 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+
+#include <feedback.hpp>
+#include <supervisor.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+
+    void Supervisor::changeBudgets(const vector<Server *> &s, vector<Tick> &delta)
+    {
+        for (size_t i = 0; i < s.size(); ++i)
+            if (delta[i] < 0) delta[i] = changeBudget(s[i], delta[i]);
+        for (size_t i = 0; i < s.size(); ++i)
+            if (delta[i] > 0) delta[i] = changeBudget(s[i], delta[i]);
+    }
+
+    void BudgetChangeEvt::add(Server *s, Tick b, Tick t)
+    {
+        Batch &batch = _batches[t];
+        Batch::iterator i = batch.begin();
+        while (i != batch.end() && i->first != s) ++i;
+        if (i != batch.end()) i->second = b;
+        else batch.push_back(make_pair(s, b));
+
+        if (!isInQueue()) post(t);
+        else if (t < getTime()) {
+            drop();
+            post(t);
+        }
+    }
+
+    void BudgetChangeEvt::doit()
+    {
+        Batch batch;
+        batch.swap(_batches.begin()->second);
+        _batches.erase(_batches.begin());
+        if (!_batches.empty()) post(_batches.begin()->first);
+
+        for (Batch::iterator i = batch.begin(); i != batch.end(); ++i)
+            i->first->changeBudget(i->second);
+    }
+
+    void BudgetChangeEvt::clear()
+    {
+        drop();
+        _batches.clear();
+    }
+
+    BudgetBatch::BudgetBatch(Supervisor *s, const string &name) :
+        Entity(name), _sup(s), _servers(), _deltas(), _from(),
+        _flushServers(), _flushDeltas(), _flushFrom(), _calls(0),
+        _flushEvt(this, Event::_DEFAULT_PRIORITY + 16)
+    {
+    }
+
+    void BudgetBatch::request(Server *s, Tick delta, AbstractFeedbackModule *from)
+    {
+        if (from != 0 && from->_request >= 0) {
+            _deltas[from->_request] = delta;
+            return;
+        }
+        if (from != 0) from->_request = int(_servers.size());
+        _servers.push_back(s);
+        _deltas.push_back(delta);
+        _from.push_back(from);
+        if (!_flushEvt.isInQueue()) _flushEvt.post(SIMUL.getTime());
+    }
+
+    void BudgetBatch::onFlush(Event *)
+    {
+        _flushServers.swap(_servers);
+        _flushDeltas.swap(_deltas);
+        _flushFrom.swap(_from);
+
+        for (size_t i = 0; i < _flushFrom.size(); ++i)
+            if (_flushFrom[i] != 0) _flushFrom[i]->_request = -1;
+
+        _sup->changeBudgets(_flushServers, _flushDeltas);
+        ++_calls;
+
+        for (size_t i = 0; i < _flushFrom.size(); ++i)
+            if (_flushFrom[i] != 0)
+                _flushFrom[i]->onBudgetGranted(_flushServers[i], _flushDeltas[i]);
+
+        _flushServers.clear();
+        _flushDeltas.clear();
+        _flushFrom.clear();
+    }
+
+    void BudgetBatch::newRun()
+    {
+        for (size_t i = 0; i < _from.size(); ++i)
+            if (_from[i] != 0) _from[i]->_request = -1;
+        _servers.clear();
+        _deltas.clear();
+        _from.clear();
+        _flushEvt.drop();
+        _calls = 0;
+    }
+
+}
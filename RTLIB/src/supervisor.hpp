@@ -1,10 +1,20 @@
 #ifndef __SUPERVISOR_HPP__
 #define __SUPERVISOR_HPP__
 
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <entity.hpp>
+#include <event.hpp>
+#include <gevent.hpp>
 #include <server.hpp>
 
 namespace RTSim {
     using namespace MetaSim;
+
+    class AbstractFeedbackModule;
  
     /**
        This abstract class is an interface for a supervisor.  A
@@ -19,8 +29,179 @@ namespace RTSim {
     public:
         virtual Tick changeBudget(Server *s, Tick delta) = 0;
         virtual void addServer(Server *s) = 0;
+
+        /**
+           Requests the changes delta[i] to the budgets of servers
+           s[i] all at once, for example when many servers ask for
+           budget at the same time, and replaces each delta[i] with
+           the effective change. The decrements are handled first,
+           so that the budget they release is available for the
+           increments.
+        */
+        virtual void changeBudgets(const std::vector<Server *> &s,
+                                   std::vector<Tick> &delta);
+
         virtual ~Supervisor() {}
     };
+
+    /**
+       A bounded memo of the admission tests of a supervisor: the
+       result of the test for a server, given the budgets of all
+       the servers (which are in ticks, hence already quantized).
+       In a feedback loop that oscillates, the same budgets come
+       back many times, and the test is not repeated.
+
+       It holds at most capacity() results, and the oldest one is
+       replaced by a new one. The supervisor must clear() it when
+       its servers change.
+    */
+    template <class V>
+    class AdmissionCache {
+        struct Entry {
+            int server;
+            size_t hash;
+            std::vector<Tick> budgets;
+            V value;
+        };
+        std::vector<Entry> _entries;
+        size_t _next;
+        size_t _capacity;
+        unsigned long _hits;
+        unsigned long _misses;
+
+        static size_t hashOf(int server, const std::vector<Tick> &b)
+        {
+            uint64_t h = 1469598103934665603ULL ^ uint64_t(server);
+            for (size_t i = 0; i < b.size(); ++i)
+                h = (h ^ uint64_t(int64_t(b[i]))) * 1099511628211ULL;
+            return size_t(h);
+        }
+
+    public:
+        explicit AdmissionCache(size_t capacity = 64) :
+            _entries(), _next(0), _capacity(capacity), _hits(0), _misses(0) {}
+
+        /// The result for server with the given budgets, or NULL
+        const V *find(int server, const std::vector<Tick> &budgets)
+        {
+            size_t h = hashOf(server, budgets);
+            for (size_t i = 0; i < _entries.size(); ++i) {
+                const Entry &e = _entries[i];
+                if (e.hash == h && e.server == server && e.budgets == budgets) {
+                    ++_hits;
+                    return &e.value;
+                }
+            }
+            ++_misses;
+            return 0;
+        }
+
+        void insert(int server, const std::vector<Tick> &budgets, const V &v)
+        {
+            if (_capacity == 0) return;
+            Entry *e;
+            if (_entries.size() < _capacity) {
+                _entries.push_back(Entry());
+                e = &_entries.back();
+            }
+            else {
+                e = &_entries[_next];
+                _next = (_next + 1) % _capacity;
+            }
+            e->server = server;
+            e->hash = hashOf(server, budgets);
+            e->budgets = budgets;
+            e->value = v;
+        }
+
+        /// Forgets all the results
+        void clear() { _entries.clear(); _next = 0; }
+
+        /// Changes the number of results (0 disables the memo)
+        void setCapacity(size_t n) { clear(); _capacity = n; }
+
+        size_t capacity() const { return _capacity; }
+        size_t size() const { return _entries.size(); }
+        unsigned long getHits() const { return _hits; }
+        unsigned long getMisses() const { return _misses; }
+    };
+
+    /**
+       The budget changes that a supervisor has accepted, but that
+       can only be applied later (when the previous changes have
+       taken effect, see Server::changeBudget()). All the changes
+       for the same time are applied by one event, and if the same
+       server asks for more changes at that time only the last
+       budget is set.
+    */
+    class BudgetChangeEvt : public Event {
+        typedef std::vector<std::pair<Server *, Tick> > Batch;
+        std::map<Tick, Batch> _batches;
+    public:
+        BudgetChangeEvt(int p = _DEFAULT_PRIORITY) : Event(p), _batches() {}
+
+        /// Sets the budget of s to b at time t
+        void add(Server *s, Tick b, Tick t);
+
+        /// Applies the changes of the earliest batch
+        virtual void doit();
+
+        /// Forgets all the pending changes
+        void clear();
+    };
+
+    /**
+       The budget changes requested to a supervisor during the same
+       tick, for example by the feedback modules of many servers
+       whose jobs end at the same time. They are passed to
+       Supervisor::changeBudgets() with one call, after the other
+       events of the tick, and each module is told the effective
+       change (see AbstractFeedbackModule::onBudgetGranted()).
+
+       A module has at most one pending request: if it asks again
+       in the same tick, its new request replaces the previous one.
+       The buffers are kept from one tick to the next, so no memory
+       is allocated once they have grown.
+    */
+    class BudgetBatch : public Entity {
+        Supervisor *_sup;
+        std::vector<Server *> _servers;
+        std::vector<Tick> _deltas;
+        std::vector<AbstractFeedbackModule *> _from;
+
+        // the batch being applied (a module can ask again from
+        // onBudgetGranted(), for the next one)
+        std::vector<Server *> _flushServers;
+        std::vector<Tick> _flushDeltas;
+        std::vector<AbstractFeedbackModule *> _flushFrom;
+
+        unsigned long _calls;
+
+        void onFlush(Event *);
+
+        StaticGEvent<BudgetBatch, &BudgetBatch::onFlush> _flushEvt;
+
+        BudgetBatch(const BudgetBatch &);
+        BudgetBatch &operator=(const BudgetBatch &);
+    public:
+        BudgetBatch(Supervisor *s, const std::string &name = "");
+
+        /**
+           Asks the supervisor to change the budget of s by delta,
+           at the end of the current tick. from (if any) is told
+           the effective change.
+        */
+        void request(Server *s, Tick delta, AbstractFeedbackModule *from = 0);
+
+        /// The requests waiting for the end of the tick
+        size_t getPending() const { return _servers.size(); }
+
+        /// The calls to Supervisor::changeBudgets() since the start of the run
+        unsigned long getCalls() const { return _calls; }
+
+        void newRun();
+        void endRun() {}
+    };
 }
 
 #endif
@@ -13,6 +13,8 @@ namespace RTSim {
 	resumeEvt(this, &SuspendInstr::onEnd),
 	delay(d)
     {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
     }
 
     SuspendInstr * SuspendInstr::createInstance(vector<string> &par)
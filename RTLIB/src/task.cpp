@@ -13,6 +13,7 @@
  ***************************************************************************/
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 #include <regvar.hpp>
 #include <factory.hpp>
@@ -20,6 +21,7 @@
 #include <strtoken.hpp>
 
 #include <abskernel.hpp>
+#include <exeinstr.hpp>
 #include <instr.hpp>
 #include <task.hpp>
 
@@ -39,15 +41,17 @@ namespace RTSim {
     Task::Task(RandomVar *iat, Tick rdl, Tick ph,
                const std::string &name, long qs, Tick maxC)
 	: Entity(name), 
-	  int_time(iat), lastArrival(0), phase(ph), 
-	  arrival(0), execdTime(0), _maxC(maxC), 
-	  arrQueue(), arrQueueSize(qs), 
-	  state(TSK_IDLE),
-	  instrQueue(),
-	  actInstr(),
-	  _kernel(NULL),
-	  _lastSched(0),
-	  _dl(0), _rdl(rdl),
+	  state(TSK_IDLE), _kernel(NULL), actInstr(),
+	  arrival(0), execdTime(0), _dl(0), _lastSched(0), _lastDesched(-1),
+	  _preemptedJob(0),
+	  _epoch(0), _rdl(rdl), lastArrival(0), _counters(),
+	  int_time(iat), phase(ph), _maxC(maxC), 
+	  arrQueue(qs < 0 ? size_t(-1) : size_t(qs)), arrQueueSize(qs),
+	  _arrPolicy(ARR_DROP_NEWEST), _lostArrivals(0),
+	  _succ(), _chained(false), _origin(0), _lastOrigin(0),
+	  _origins(qs < 0 ? size_t(-1) : size_t(qs)),
+	  _chainPosted(false), _chainArr(0),
+	  instrQueue(), _fusion(false),
 	  feedback(NULL),
 	  arrEvt(this), endEvt(this), schedEvt(this),
 	  deschedEvt(this), fakeArrEvt(this), killEvt(this), 
@@ -62,18 +66,25 @@ namespace RTSim {
         } else throw EmptyTask();
         
 	state = TSK_IDLE;
-        while (chkBuffArrival()) unbuffArrival();
+        arrQueue.clear();
+        _origins.clear();
+        _lostArrivals = 0;
         
         lastArrival = arrival = phase;
+        _lastOrigin = _origin = phase;
+        _chainPosted = false;
         if (int_time != NULL) arrEvt.post(arrival);
         _dl = 0;
+        _counters = TaskCounters();
+        _lastSched = 0;
+        _lastDesched = -1;
+        _preemptedJob = 0;
     }
     
     void Task::endRun(void)
     {
-        while (!arrQueue.empty()) {
-            arrQueue.pop_front();
-        }
+        arrQueue.clear();
+        _origins.clear();
         arrEvt.drop();
         endEvt.drop();
         schedEvt.drop();
@@ -81,6 +92,105 @@ namespace RTSim {
         fakeArrEvt.drop();
         deadEvt.drop();
     }
+
+    void Task::saveState(Checkpoint &c)
+    {
+        c.put(state);
+        c.put(_kernel);
+        c.put(actInstr - instrQueue.begin());
+        c.put(arrival);
+        c.put(execdTime);
+        c.put(_dl);
+        c.put(_lastSched);
+        c.put(_lastDesched);
+        c.put(_preemptedJob);
+        c.put(_epoch);
+        c.put(_rdl);
+        c.put(lastArrival);
+        c.put(_counters);
+        c.put(_lostArrivals);
+        c.put(arrQueue.size());
+        for (size_t i = 0; i < arrQueue.size(); ++i) c.put(arrQueue[i]);
+        c.put(_origin);
+        c.put(_lastOrigin);
+        c.put(_origins.size());
+        for (size_t i = 0; i < _origins.size(); ++i) c.put(_origins[i]);
+        c.put(_chainPosted);
+        c.put(_chainArr);
+        // the processor of the events, for the traces
+        c.put(endEvt.getCPU());
+        c.put(schedEvt.getCPU());
+        c.put(deschedEvt.getCPU());
+        c.put(deadEvt.getCPU());
+    }
+
+    void Task::loadState(Checkpoint &c)
+    {
+        InstrList::difference_type pos;
+        size_t n;
+        Tick t;
+        int cpu;
+
+        c.get(state);
+        c.get(_kernel);
+        c.get(pos);
+        actInstr = instrQueue.begin() + pos;
+        c.get(arrival);
+        c.get(execdTime);
+        c.get(_dl);
+        c.get(_lastSched);
+        c.get(_lastDesched);
+        c.get(_preemptedJob);
+        c.get(_epoch);
+        c.get(_rdl);
+        c.get(lastArrival);
+        c.get(_counters);
+        c.get(_lostArrivals);
+        arrQueue.clear();
+        c.get(n);
+        for (size_t i = 0; i < n; ++i) {
+            c.get(t);
+            arrQueue.push_back(t);
+        }
+        c.get(_origin);
+        c.get(_lastOrigin);
+        _origins.clear();
+        c.get(n);
+        for (size_t i = 0; i < n; ++i) {
+            c.get(t);
+            _origins.push_back(t);
+        }
+        c.get(_chainPosted);
+        c.get(_chainArr);
+        c.get(cpu);
+        endEvt.setCPU(cpu);
+        c.get(cpu);
+        schedEvt.setCPU(cpu);
+        c.get(cpu);
+        deschedEvt.setCPU(cpu);
+        c.get(cpu);
+        deadEvt.setCPU(cpu);
+    }
+
+    bool Task::getSignature(StateImage &s)
+    {
+        if (dynamic_cast<DeltaVar *>(int_time) == NULL || feedback != NULL)
+            return false;
+
+        s.put(state);
+        s.putTime(arrival);
+        s.putTime(lastArrival);
+        s.putTime(_dl);
+        s.put(int64_t(execdTime));
+        s.put(arrQueue.size());
+        for (size_t i = 0; i < arrQueue.size(); ++i) 
+            s.putTime(arrQueue[i]);
+        s.put(actInstr - instrQueue.begin());
+        // the instructions already reached by the current job
+        for (size_t i = 0; i < instrQueue.size(); ++i)
+            s.put(instrQueue[i]->inJob(_epoch));
+        return true;
+    }
     
     /* Methods from the interface... */
     bool Task::isActive(void) const
@@ -115,7 +225,7 @@ namespace RTSim {
     {
         DBGENTER(_TASK_DBG_LEV);
         
-        if (_kernel != NULL) throw KernAlreadySet();
+        if (_kernel != NULL && k != NULL) throw KernAlreadySet();
         
         _kernel = k;
         
@@ -145,7 +255,7 @@ namespace RTSim {
         Tick v;
         
         if (int_time != NULL) {
-            v = (Tick) int_time->get();
+            v = (Tick) int_time->draw();
             if (v > 0) arrEvt.post(SIMUL.getTime() + v);
         }
     }
@@ -162,15 +272,11 @@ namespace RTSim {
         execdTime = 0;
         actInstr = instrQueue.begin();
         
-        // reset all instructions
-        ConstInstrIterator p = instrQueue.begin();
-        while (p != instrQueue.end()) {
-            (*p)->reset();
-            p++;
-        }
+        // instructions are reset when they are first reached
+        _epoch++;
 	state = TSK_READY;
         _dl = getArrival() + _rdl;
-        if (_dl >= SIMUL.getTime()) deadEvt.post(_dl);
+        if (_dl >= SIMUL.getTime() && deadEvt.isWatched()) deadEvt.post(_dl);
         
     }
 
@@ -203,7 +309,7 @@ namespace RTSim {
     
     Tick Task::getExecTime() const
     {
-        if (isActive()) {
+        if (isActive() && (*actInstr)->inJob(_epoch)) {
             return execdTime + (*actInstr)->getExecTime();
         } else {
             return execdTime;
@@ -215,6 +321,11 @@ namespace RTSim {
         Tick time = arrQueue.front();
         
         arrQueue.pop_front();
+        _origin = time;
+        if (_chained) {
+            _origin = _origins.front();
+            _origins.pop_front();
+        }
         
         return time;
     }
@@ -226,9 +337,40 @@ namespace RTSim {
     
     void Task::buffArrival()
     {
-        if ((int)arrQueue.size() <= arrQueueSize) {
-            arrQueue.push_back(SIMUL.getTime());
+        buffArrival(SIMUL.getTime());
+    }
+
+    void Task::buffArrival(Tick t)
+    {
+        buffArrival(t, t);
+    }
+
+    void Task::buffArrival(Tick t, Tick origin)
+    {
+        if (_arrPolicy != ARR_COUNT_ONLY) {
+            if (arrQueue.push_back(t)) {
+                if (_chained) _origins.push_back(origin);
+                return;
+            }
+            if (_arrPolicy == ARR_DROP_OLDEST && !arrQueue.empty()) {
+                arrQueue.pop_front();
+                arrQueue.push_back(t);
+                if (_chained) {
+                    _origins.pop_front();
+                    _origins.push_back(origin);
+                }
+            }
         }
+        _lostArrivals++;
+    }
+    
+    void Task::releaseBuffArrival()
+    {
+        // arrivals buffered by activateBurst() may be in the future
+        if (arrQueue.front() > SIMUL.getTime()) 
+            fakeArrEvt.post(arrQueue.front());
+        else 
+            fakeArrEvt.process();
     }
     
     void Task::unbuffArrival()
@@ -236,6 +378,7 @@ namespace RTSim {
         
         if (!arrQueue.empty()) {
             arrQueue.pop_back();
+            if (_chained) _origins.pop_back();
         }
     }
     
@@ -274,11 +417,18 @@ namespace RTSim {
     {
         DBGENTER(_TASK_DBG_LEV);
         
+        // the arrival of a chain, posted because it is probed
+        Tick origin = _chainPosted ? _chainArr : SIMUL.getTime();
+        _chainPosted = false;
+
         if (!isActive()) {
             // Standard Task Arrival: do standard
             // book-keeping and forward the event to the
-            // father
+            // father; a future buffered arrival waits
+            // for the end of this instance
+            fakeArrEvt.drop();
             handleArrival(SIMUL.getTime());
+            _origin = origin;
             _kernel->onArrival(this);
         } else {
             DBGPRINT("[Buffered]");
@@ -289,12 +439,53 @@ namespace RTSim {
             // true
             // from old Task ...
 
-            deadEvt.process();
+            if (deadEvt.isWatched()) deadEvt.process();
             
-            buffArrival();
+            buffArrival(SIMUL.getTime(), origin);
         }
         reactivate();
     }
+
+    void Task::chainArrival(Tick origin)
+    {
+        DBGENTER(_TASK_DBG_LEV);
+
+        if (arrEvt.hasProbes()) {
+            _chainPosted = true;
+            _chainArr = origin;
+            activate();
+        } else if (!isActive()) {
+            // as onArrival(), without the event: the kernel
+            // has a dispatch pending for the end of the
+            // predecessor, and takes this arrival with it
+            fakeArrEvt.drop();
+            handleArrival(SIMUL.getTime());
+            _origin = origin;
+            _kernel->onArrival(this);
+        } else {
+            if (deadEvt.isWatched()) deadEvt.process();
+            buffArrival(SIMUL.getTime(), origin);
+        }
+    }
+
+    void Task::addSuccessor(Task *t)
+    {
+        // t must not reach this task
+        vector<Task *> open(1, t);
+        while (!open.empty()) {
+            Task *u = open.back();
+            open.pop_back();
+            if (u == this) 
+                throw BadSuccessor("addSuccessor(): " + t->getName() + 
+                                   " would close a cycle");
+            open.insert(open.end(), u->_succ.begin(), u->_succ.end());
+        }
+        _succ.push_back(t);
+        if (!t->_chained) {
+            t->_chained = true;
+            t->_origins.clear();
+        }
+    }
     
     void Task::onEndInstance(Event *e)
     {
@@ -311,8 +502,13 @@ namespace RTSim {
             throw TaskNotExecuting("OnEnd() on a non-executing task");
         }
         
+        if (SIMUL.getTime() > _dl) _counters.late++;
+        _counters.jobs++;
+        leaveCPU(getCPU());
+
         actInstr = instrQueue.begin();
         lastArrival = arrival;
+        _lastOrigin = _origin;
         
         int cpu_index = getCPU()->getIndex();
         
@@ -322,6 +518,9 @@ namespace RTSim {
         endEvt.setCPU(cpu_index);
         _kernel->onEnd(this);
 	state = TSK_IDLE;
+
+        for (size_t i = 0; i < _succ.size(); ++i) 
+            _succ[i]->chainArrival(_lastOrigin);
         
         if (feedback) {
             DBGPRINT("Calling the feedback module");
@@ -334,7 +533,7 @@ namespace RTSim {
                    chkBuffArrival());
         
         if (chkBuffArrival()) {
-            fakeArrEvt.process();
+            releaseBuffArrival();
             
             DBGPRINT("[Fake Arrival generated]");
         }
@@ -351,12 +550,15 @@ namespace RTSim {
         }
         
         endEvt.drop();
+        if (isExecuting()) leaveCPU(getCPU());
         
-        (*actInstr)->deschedule();
-        execdTime += (*actInstr)->getExecTime();
+        if ((*actInstr)->inJob(_epoch)) {
+            (*actInstr)->deschedule();
+            execdTime += (*actInstr)->getExecTime();
+        }
         
         if (chkBuffArrival()) {
-            fakeArrEvt.post(SIMUL.getTime());
+            fakeArrEvt.post(max(SIMUL.getTime(), arrQueue.front()));
             DBGPRINT("[Fake Arrival generated]");
         }
         
@@ -374,6 +576,7 @@ namespace RTSim {
         // normal code
         
         lastArrival = arrival;
+        _lastOrigin = _origin;
         
         int cpu_index = getCPU()->getIndex();
         
@@ -395,7 +598,7 @@ namespace RTSim {
                    chkBuffArrival());
         
         if (chkBuffArrival()) {
-            fakeArrEvt.process();
+            releaseBuffArrival();
             
             DBGPRINT("[Fake Arrival generated]");
         }
@@ -419,9 +622,17 @@ namespace RTSim {
         
         schedEvt.setCPU(cpu_index);
         deschedEvt.drop();
+
+        // a job descheduled and scheduled at once is not preempted
+        if (_preemptedJob == _epoch && SIMUL.getTime() == _lastDesched)
+            _counters.preemptions--;
+        _preemptedJob = 0;
+        _lastSched = SIMUL.getTime();
+        getCPU()->enterTask();
         
 	state = TSK_EXEC;
         
+        (*actInstr)->enterJob(_epoch);
         (*actInstr)->schedule();
         
         // from Task ...
@@ -447,6 +658,10 @@ namespace RTSim {
         DBGPRINT_2("CPU: ", getCPU());
         deschedEvt.setCPU(cpu_index);
         endEvt.drop();
+        leaveCPU(getOldCPU());
+        _counters.preemptions++;
+        _lastDesched = SIMUL.getTime();
+        _preemptedJob = _epoch;
         
         (*actInstr)->deschedule();
         
@@ -467,12 +682,15 @@ namespace RTSim {
         //     DBGPRINT("not executing...");
         //     throw TaskNotExecuting("OnInstrEnd() on a non executing task");
         // }
-        execdTime += (*actInstr)->getExecTime();
-        actInstr++;
+        for (unsigned int n = (*actInstr)->getSpan(); n > 0; --n) {
+            execdTime += (*actInstr)->getExecTime();
+            actInstr++;
+        }
         if (actInstr == instrQueue.end()) {
             DBGPRINT("End of instruction list");
 	    endEvt.post(SIMUL.getTime());
         } else if (isExecuting()) {          
+            (*actInstr)->enterJob(_epoch);
             (*actInstr)->schedule();
             DBGPRINT("Next instr scheduled");
         }
@@ -500,6 +718,15 @@ namespace RTSim {
         arrEvt.drop();
         arrEvt.post(t);
     }
+
+    void Task::activateBurst(const vector<Tick> &times)
+    {
+        if (times.empty()) return;
+
+        unsigned int i = 0;
+        if (!isActive() && !chkBuffArrival()) activate(times[i++]);
+        for (; i < times.size(); ++i) buffArrival(times[i]);
+    }
     
     Tick Task::getWCET() const
     {
@@ -518,14 +745,20 @@ namespace RTSim {
     {
         DBGENTER(_TASK_DBG_LEV);
         
-        vector<string> instr = split_instr(code);
-        
+        // the substrings point into code, the strings are reused
+        // from one instruction to the next
+        vector<substring> instr, params;
+        split_instr(substring(code), instr);
+
+        string token;
+        vector<string> par_list;
+
         for (unsigned int i=0; i<instr.size(); ++i) {
             vector<string>::iterator j;
             
-            string token = get_token(instr[i]);
-            string param = get_param(instr[i]);
-            vector<string> par_list = split_param(param);
+            token_of(instr[i]).assign_to(token);
+            split_param(param_of(instr[i]), params);
+            assign(params, par_list);
             
             par_list.push_back(string(getName()));
             
@@ -534,7 +767,7 @@ namespace RTSim {
                 DBGPRINT_2(" - ", *j);
             DBGPRINT("");
             
-            auto_ptr<Instr> curr = genericFactory<Instr>::instance().create(token, par_list);
+            unique_ptr<Instr> curr = genericFactory<Instr>::instance().create(token, par_list);
             
             Instr *curr_instr = curr.release();
             
@@ -547,7 +780,40 @@ namespace RTSim {
             printInstrList();
         }
         
-        
+        compileCode();
+    }
+
+    void Task::insertCode(const TaskProgram &p)
+    {
+        DBGENTER(_TASK_DBG_LEV);
+
+        for (unsigned int i = 0; i < p.size(); ++i) {
+            const TaskProgram::Step &s = p[i];
+            Instr *curr_instr;
+
+            if (s.cost) curr_instr = new ExecInstr(this, *s.cost);
+            else {
+                vector<string> par_list = s.params;
+                par_list.push_back(string(getName()));
+                unique_ptr<Instr> curr = genericFactory<Instr>::instance().create(s.token, par_list);
+                curr_instr = curr.release();
+                if (!curr_instr) throw ParseExc("insertCode", s.token);
+            }
+            addInstr(curr_instr);
+        }
+
+        compileCode();
+    }
+
+    void Task::compileCode()
+    {
+        ExecInstr *prev = 0;
+        for (InstrIterator i = instrQueue.begin(); i != instrQueue.end(); ++i) {
+            ExecInstr *e = dynamic_cast<ExecInstr *>(*i);
+            if (prev) prev->setNext(_fusion ? e : 0);
+            prev = e;
+        }
+        if (prev) prev->setNext(0);
     }
     
     void Task::printInstrList() const
@@ -582,11 +848,12 @@ namespace RTSim {
         
     }
     
-    std::string taskname(const AbsRTTask *t)
+    const std::string &taskname(const AbsRTTask *t)
     {
+        static const std::string nil("(nil)");
         const Entity *e = dynamic_cast<const Entity *>(t);
-        if (e) return string(e->getName());
-        else return "(nil)";
+        if (e) return e->getName();
+        else return nil;
     }
     
     Task* Task::createInstance(vector<string> &par)
@@ -616,6 +883,23 @@ namespace RTSim {
     }
     
     
+    void Task::leaveCPU(CPU *c)
+    {
+        Tick t = SIMUL.getTime() - _lastSched;
+        _counters.executed += t;
+        if (c != NULL) {
+            c->addBusyTime(t);
+            c->leaveTask();
+        }
+    }
+
+    int Task::getMissCount() const
+    {
+        int n = _counters.late + _counters.killed;
+        if (isActive() && SIMUL.getTime() > _dl) return n + 1;
+        return n;
+    }
+
     void Task::killOnMiss(bool kill)
     {
         deadEvt.setKill(kill);
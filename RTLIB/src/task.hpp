@@ -17,7 +17,9 @@
 /* Headers from MetaSim */
 #include <entity.hpp>
 #include <gevent.hpp>
+#include <memstats.hpp>
 #include <randomvar.hpp>
+#include <ringbuf.hpp>
 #include <strtoken.hpp>
 #include <trace.hpp>
 
@@ -27,6 +29,7 @@
 #include <taskevt.hpp>
 #include <feedback.hpp>
 #include <taskexc.hpp>
+#include <taskprogram.hpp>
 
 #define _TASK_DBG_LEV "Task"
 
@@ -39,6 +42,44 @@ namespace RTSim {
     // Task states
     typedef enum { TSK_IDLE, TSK_READY, TSK_EXEC, TSK_BLOCKED } task_state;
 
+    /**
+       What a task does with an arrival that comes while it is
+       active and its arrival buffer is full (see
+       Task::setArrivalPolicy()):
+
+       - ARR_DROP_NEWEST: the arrival is discarded;
+       - ARR_DROP_OLDEST: the oldest buffered arrival is discarded
+       to make room for the new one;
+       - ARR_COUNT_ONLY: arrivals are never buffered, those that come
+       while the task is active are only counted.
+
+       In all cases, the discarded arrivals are counted (see
+       Task::getLostArrivals()).
+    */
+    typedef enum { ARR_DROP_NEWEST, ARR_DROP_OLDEST, ARR_COUNT_ONLY } arr_policy;
+
+    /// the memory of the arrival buffers (see MetaSim::MemStats)
+    DECL_MEM_CATEGORY(ArrivalMem, "arrival queues");
+
+    /**
+       \ingroup tasks
+
+       The counters of a Task in the current run, kept by the task
+       itself as it is scheduled and descheduled: the stats that
+       only need totals (e.g. GlobalPreemptionStat) read them at
+       the end of the run, instead of being called at every event.
+    */
+    struct TaskCounters {
+        /// time executed, up to the last time the task left its processor
+        MetaSim::Tick executed;
+        /// jobs ended, and those of them that ended after their deadline
+        uint32_t jobs, late;
+        /// jobs killed at their deadline (see Task::killOnMiss())
+        uint32_t killed;
+        /// descheduling of a job, unless it is scheduled again at once
+        uint32_t preemptions;
+    };
+
     /** 
         \ingroup tasks
 
@@ -71,31 +112,76 @@ namespace RTSim {
 	Task & operator=(const Task &);
 
     protected:
-	MetaSim::RandomVar *int_time;  // The task is owner of this varible
-        MetaSim::Tick lastArrival;     // The arrival of the last instance!
-        MetaSim::Tick phase;           // Initial phasing for first arrival
+        typedef std::vector<Instr *> InstrList;
+        typedef std::vector<Instr *>::iterator InstrIterator;
+        typedef std::vector<Instr *>::const_iterator ConstInstrIterator;
+
+        /** @name Job state
+            The state read and written at every scheduling decision
+            and at every step of a job, kept together so that it
+            spans as few cache lines as possible when a kernel walks
+            many tasks. The configuration of the task, which is only
+            read at the arrivals, comes after it.
+        */
+        //@{
+	task_state state;      // IDLE, READY, EXECUTING, BLOCKED 
+        AbsKernel *_kernel;
+        InstrIterator actInstr;
         MetaSim::Tick arrival;         // Arrival time of the current (last) instance
         MetaSim::Tick execdTime;       // Actual Real-Time execution of the task
+        MetaSim::Tick _dl;
+        MetaSim::Tick _lastSched;
+
+        /// last descheduling, to tell the preemptions (see TaskCounters)
+        MetaSim::Tick _lastDesched;
+        /// the job whose last descheduling was counted as a
+        /// preemption (0 if none, or if it has been taken back)
+        unsigned long _preemptedJob;
+        //@}
+
+        /// number of the current job, see Instr::enterJob()
+        unsigned long _epoch;
+        MetaSim::Tick _rdl;
+        MetaSim::Tick lastArrival;     // The arrival of the last instance!
+
+        TaskCounters _counters;
+
+	MetaSim::RandomVar *int_time;  // The task is owner of this varible
+        MetaSim::Tick phase;           // Initial phasing for first arrival
         MetaSim::Tick _maxC;           // Maximum computation time 
-	std::deque <MetaSim::Tick> arrQueue; // Arrival queue, sorted FIFO
+	ring_buffer<MetaSim::Tick, 
+                    MetaSim::TrackedAllocator<MetaSim::Tick, ArrivalMem> > 
+        arrQueue; // Arrival queue, sorted FIFO
         int arrQueueSize;      // -1 stands for no-limit
-
-	task_state state;      // IDLE, READY, EXECUTING, BLOCKED 
+        arr_policy _arrPolicy;
+        long _lostArrivals;    // arrivals discarded in this run
+
+        /** @name Chain
+            The tasks activated at the end of every job (see
+            addSuccessor()), and the arrival of the first task of
+            the chain for the current job and for the last one
+            ended. _origins follows arrQueue, for a task that has
+            a predecessor.
+        */
+        //@{
+        std::vector<Task *> _succ;
+        bool _chained;
+        MetaSim::Tick _origin;
+        MetaSim::Tick _lastOrigin;
+        ring_buffer<MetaSim::Tick, 
+                    MetaSim::TrackedAllocator<MetaSim::Tick, ArrivalMem> > 
+        _origins;
+        /// origin of the arrival posted by chainArrival(), if any
+        bool _chainPosted;
+        MetaSim::Tick _chainArr;
+        //@}
 
         //bool active;           // true if the current request has not completed
         //bool executing;        // true if the task is currently executing
 
-        typedef std::vector<Instr *> InstrList;
-        typedef std::vector<Instr *>::iterator InstrIterator;
-        typedef std::vector<Instr *>::const_iterator ConstInstrIterator;
         InstrList instrQueue;
-        InstrIterator actInstr;
-
-        AbsKernel *_kernel;
-
-        MetaSim::Tick _lastSched;
-        MetaSim::Tick _dl;
-        MetaSim::Tick _rdl;
+        /// true if the consecutive ExecInstrs run as one segment
+        bool _fusion;
 
         AbstractFeedbackModule *feedback;
 
@@ -167,6 +253,9 @@ namespace RTSim {
         */
         void onSched(MetaSim::Event *);
 
+        /// Accounts the execution since the last scheduling (on c)
+        void leaveCPU(CPU *c);
+
         /**
            This event handler is invoked everytime the task is suspended 
            by the kernel or by another entity, or it suspends itself. 
@@ -195,7 +284,7 @@ namespace RTSim {
             @todo re-think this function to implement a different kind of
             task.
         */
-        void reactivate();
+        virtual void reactivate();
 
         /** 
             Handle arrival. This is the true arrival event handler.
@@ -208,6 +297,18 @@ namespace RTSim {
         /** handles buffered arrivals:  inserts an arrival in the buffer */
         void buffArrival();
 
+        /** as buffArrival(), for an arrival at time t (possibly in the
+            future: it is released at t if the task is idle by then) */
+        void buffArrival(Tick t);
+
+        /** as buffArrival(t), for an arrival of a chain that
+            started at origin */
+        void buffArrival(Tick t, Tick origin);
+
+        /** handles buffered arrivals: posts the fake arrival for the
+            first buffered arrival, now or at its time if later */
+        void releaseBuffArrival();
+
         /** handles buffered arrivals: removes an arrival from the buffer */
         void unbuffArrival();
 
@@ -218,6 +319,17 @@ namespace RTSim {
             arrival */
         bool chkBuffArrival() const;
 
+        /// links the consecutive ExecInstrs of the code, with
+        /// setFusion()
+        void compileCode();
+
+        /**
+           Activates the task at the end of a job of a
+           predecessor, for a chain started at origin (see
+           addSuccessor()).
+        */
+        void chainArrival(Tick origin);
+
 	// blocking a task: 
 	// I deschedule the task, then it goes into the blocking state. 
 	// It can be unblocked only when an Unblock() is called
@@ -240,9 +352,10 @@ namespace RTSim {
             @param name Unique name for this entity. 
 
             @param qs Maximum size of the arrival buffer. This is the maximum 
-            number of arrivals that can be buffered. By default, this is
-            equal to __LONG_MAX__. If equal to zero, an arrival event is 
-            discarded when the task is already active.
+            number of arrivals that can be buffered (-1 for no limit). The
+            buffer storage grows with the buffered arrivals, up to this
+            size. If equal to zero, an arrival event is discarded when
+            the task is already active. See also setArrivalPolicy().
 
             @param maxC Worst-case execution time of an instance. This 
             parameter is not used for the simulation itself, but only 
@@ -278,6 +391,23 @@ namespace RTSim {
         */
         virtual void endRun();
 
+        /**
+           Saves the state of the current job, the pending
+           arrivals and the counters (see Entity::saveState()).
+           The instructions save their own state.
+        */
+        virtual void saveState(MetaSim::Checkpoint &c);
+        virtual void loadState(MetaSim::Checkpoint &c);
+
+        /**
+           Writes the state of the current job, the pending
+           arrivals and the position in the code (see
+           Entity::getSignature()). Only a task with a
+           deterministic inter-arrival time and without feedback
+           can describe its state.
+        */
+        virtual bool getSignature(MetaSim::StateImage &s);
+
         /** 
             This functions activates the tasks (post the arrival event at
             the current time).
@@ -295,6 +425,58 @@ namespace RTSim {
         */
         virtual void activate(Tick t);
 
+        /**
+           Activates the task at times[0] (the current time) and
+           buffers the following arrivals of times, which must be
+           sorted. This is meant for bursts of interrupts: the
+           arrivals are queued at once, and one that is still in the
+           future when the task becomes idle is released at its
+           time. The result is the same as activating the task at
+           each time only if nothing else activates it meanwhile.
+        */
+        void activateBurst(const vector<Tick> &times);
+
+        /**
+           Adds t to the successors of this task: at the end of
+           every job of this task, t is activated at once, in the
+           same dispatch, without posting its arrival event (unless
+           the arrival of t is probed, e.g. traced: then the event
+           is posted now, as with activate()). A successor that is
+           still active buffers the arrival, as usual. The
+           successors are activated in the order they were added,
+           and they are meant to be activated only by their
+           predecessors.
+
+           Every job of a chain carries the arrival of the job of
+           the first task that started it (see getChainOrigin()),
+           so that ChainLatencyStat on the last task measures the
+           end-to-end latency:
+
+           <pre>
+           Task sense(...), control(0, 10, 0, "control"), act(0, 10, 0, "act");
+           sense.addSuccessor(&control);
+           control.addSuccessor(&act);
+           ChainLatencyStat<StatMax> e2e("e2e");
+           e2e.attachToTask(&act);
+           </pre>
+
+           @throws BadSuccessor if t would close a cycle
+        */
+        void addSuccessor(Task *t);
+
+        /// The successors, in the order of activation
+        const std::vector<Task *> &getSuccessors() const { return _succ; }
+
+        /**
+           The arrival of the first task of the chain that
+           activated the current (or last) job; the arrival of
+           the job itself, if the task has no predecessor.
+        */
+        Tick getChainOrigin() const { return _origin; }
+
+        /// As getChainOrigin(), for the last job ended
+        Tick getLastChainOrigin() const { return _lastOrigin; }
+
         /** 
             This method permits to kill a task instance that is currently
             executing. The instruction pointer is reset to the first
@@ -452,8 +634,35 @@ namespace RTSim {
         Tick getDeadline() const {return _dl;}
         Tick getRelDline() const {return _rdl;}
 
+        /**
+           Returns the number of deadline misses in this run: the
+           jobs that finished after their deadline, plus the
+           current job if its deadline has passed. It is computed
+           at the end of the jobs, so it does not need the deadEvt:
+           the task posts the deadEvt only if it aborts the
+           simulation, kills the job, or if some probe (a trace, a
+           MissCount...) is attached to it. Attach probes before
+           the job arrives.
+        */
+        int getMissCount() const;
+
+        /// The counters of the current run
+        const TaskCounters &getCounters() const { return _counters; }
+
         void setRelDline(const Tick& dl) {_rdl = dl;}
 
+        /**
+           Sets the phase (the first arrival) of the task. Like
+           the other setters of the parameters (setRelDline(),
+           PeriodicTask::setPeriod(), ExecInstr::setCost()), it is
+           meant to re-use a model between two runs, after
+           endSingleRun() and before initSingleRun(): the
+           schedulers take the new parameters into account when
+           the tasks arrive again.
+        */
+        void setPhase(const Tick &ph) { phase = ph; }
+        Tick getPhase() const { return phase; }
+
         /** 
             Returns a pointer to the CPU on which this task is executing.
         */
@@ -496,9 +705,23 @@ namespace RTSim {
             between 4 and 10 ticks; the fourth one is a signal on resource
             Res1; finally, the last instruction has variable execution
             time uniformely distributed between 10 and 20 ticks.
+
+            With setFusion(), consecutive fixed() and delay()
+            instructions are then executed as a single segment,
+            with one end event (see ExecInstr::setNext()), unless
+            they are traced.
         */
         void insertCode(const string &code); //throw(ParseExc);
 
+        /**
+           Inserts the instructions of a program parsed in
+           advance. Many tasks can be loaded with the same
+           program: the code is not parsed again, and the cost of
+           their fixed() and delay() instructions is drawn from the
+           variables of the program (see TaskProgram).
+        */
+        void insertCode(const TaskProgram &p);
+
         /**
            Sets the feedback module for this task (optional, by
            default no feedback is needed).
@@ -523,12 +746,32 @@ namespace RTSim {
 
         int getTaskNumber() const { return getID();}	
 
+        /// Sets the overflow policy of the arrival buffer
+        void setArrivalPolicy(arr_policy p) { _arrPolicy = p; }
+        arr_policy getArrivalPolicy() const { return _arrPolicy; }
+
+        /// Number of arrivals discarded in this run
+        long getLostArrivals() const { return _lostArrivals; }
+
         void setAbort(bool f) { deadEvt.setAbort(f); }
+
+        /**
+           Executes the consecutive ExecInstrs of the code as a
+           single segment, with one end event (see
+           ExecInstr::setNext()). It is off by default: the costs
+           of a segment are drawn at its start, not one by one,
+           and its inner boundaries are not events any more, so a
+           task with random costs, or whose instructions end at
+           the instant of another event, may not give the same
+           trace as without it.
+        */
+        void setFusion(bool f) { _fusion = f; compileCode(); }
+        bool getFusion() const { return _fusion; }
     };
 
     /// returns the task name, or "(nil)" if the pointer does not point 
     /// to a task entity
-    std::string taskname(const AbsRTTask *t);
+    const std::string &taskname(const AbsRTTask *t);
 
 } // namespace RTSim
 
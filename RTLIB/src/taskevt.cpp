@@ -22,6 +22,11 @@
 
 namespace RTSim {
     
+    int TaskEvt::getOwnerID() const
+    {
+        return _task ? _task->getID() : -1;
+    }
+
     void ArrEvt::doit()
     {
         _task->onArrival(this);
@@ -61,6 +66,7 @@ namespace RTSim {
         }
         if (_kill && _task->isActive() == true)
         {
+            _task->_counters.killed++;
             _task->killInstance();
         }
     }
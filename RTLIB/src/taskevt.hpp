@@ -28,6 +28,10 @@ namespace RTSim {
        \ingroup task
 
        This class is the base class for all task events.
+
+       Each task event class sets its kind tag (see
+       Event::getKind()), so a trace can recognise it with
+       isTaskEvt() and a switch on getKind(), without RTTI.
     */
     class TaskEvt : public MetaSim::Event
     {
@@ -36,13 +40,40 @@ namespace RTSim {
         int _cpu;
 
     public:
-        TaskEvt(Task* t, int p = _DEFAULT_PRIORITY) : 
-            MetaSim::Event(p), _cpu(-1)  {_task = t;}
+        /// Kind tags of the task events
+        typedef enum {
+            TASK_EVT = 100,  ///< a task event of unspecified kind
+            ARR_EVT,
+            END_EVT,
+            KILL_EVT,
+            SCHED_EVT,
+            DESCHED_EVT,
+            FAKE_ARR_EVT,
+            DLINE_SET_EVT,
+            DEAD_EVT,
+            WAIT_EVT,
+            SIGNAL_EVT,
+            SCHEDI_EVT,
+            THRE_EVT,
+            LAST_TASK_EVT = 199
+        } Kind;
+
+        TaskEvt(Task* t, int p = _DEFAULT_PRIORITY, Kind k = TASK_EVT) : 
+            MetaSim::Event(p), _cpu(-1)  {_task = t; _kind = k;}
+
+        /// True if e is a TaskEvt (or a derived class)
+        static bool isTaskEvt(const Event *e) {
+            return e->getKind() >= TASK_EVT && e->getKind() <= LAST_TASK_EVT;
+        }
+
         Task* getTask() const {return _task;}
         void setTask(Task* t) {_task = t;}
 
         int getCPU() {return _cpu;}
         void setCPU(int cpu) {_cpu = cpu;}
+
+        /// The ID of the task
+        virtual int getOwnerID() const;
     };
 
     /// arrival event for a task
@@ -50,7 +81,7 @@ namespace RTSim {
     class ArrEvt: public TaskEvt
     {
     public:
-        ArrEvt(Task* t) :TaskEvt(t) {}
+        ArrEvt(Task* t) :TaskEvt(t, _DEFAULT_PRIORITY, ARR_EVT) {}
         virtual void doit();
 
     };
@@ -61,7 +92,7 @@ namespace RTSim {
     {
     public:
         static const int _END_EVT_PRIORITY = _DEFAULT_PRIORITY - 2;
-        EndEvt(Task* t) :TaskEvt(t, _END_EVT_PRIORITY) {}
+        EndEvt(Task* t) :TaskEvt(t, _END_EVT_PRIORITY, END_EVT) {}
         virtual void doit();
     };
     
@@ -71,7 +102,7 @@ namespace RTSim {
     {
     public:
         static const int _END_EVT_PRIORITY = _DEFAULT_PRIORITY - 2;
-        KillEvt(Task* t) :TaskEvt(t, _END_EVT_PRIORITY) {}
+        KillEvt(Task* t) :TaskEvt(t, _END_EVT_PRIORITY, KILL_EVT) {}
         virtual void doit();
     };
 
@@ -80,7 +111,7 @@ namespace RTSim {
     class SchedEvt: public TaskEvt
     {
     public:
-        SchedEvt(Task* t) : TaskEvt(t) {}
+        SchedEvt(Task* t) : TaskEvt(t, _DEFAULT_PRIORITY, SCHED_EVT) {}
         virtual void doit();
     };
 
@@ -90,7 +121,7 @@ namespace RTSim {
     class DeschedEvt: public TaskEvt
     {
     public:
-        DeschedEvt(Task* t) :TaskEvt(t) {}
+        DeschedEvt(Task* t) :TaskEvt(t, _DEFAULT_PRIORITY, DESCHED_EVT) {}
         virtual void doit();
     };
 
@@ -99,7 +130,7 @@ namespace RTSim {
     class FakeArrEvt: public TaskEvt
     {
     public:
-        FakeArrEvt(Task* t) :TaskEvt(t) { setPriority(_DEFAULT_PRIORITY - 1); }
+        FakeArrEvt(Task* t) :TaskEvt(t, _DEFAULT_PRIORITY, FAKE_ARR_EVT) { setPriority(_DEFAULT_PRIORITY - 1); }
         virtual void doit();
     };
 
@@ -114,7 +145,7 @@ namespace RTSim {
         Tick _dline;
 
     public:
-        DlineSetEvt(Task* t) :TaskEvt(t) {}
+        DlineSetEvt(Task* t) :TaskEvt(t, _DEFAULT_PRIORITY, DLINE_SET_EVT) {}
         virtual void doit() {}
         void setDline(Tick d) {_dline = d;}
         Tick getDline() {return _dline;}
@@ -131,11 +162,22 @@ namespace RTSim {
         static const int _DEAD_EVT_PRIORITY = EndEvt::_END_EVT_PRIORITY + 3; 
 
         DeadEvt(Task* t, bool abort, bool kill)
-            : TaskEvt(t, _DEAD_EVT_PRIORITY), _abort(abort), _kill(kill) {}
+            : TaskEvt(t, _DEAD_EVT_PRIORITY, DEAD_EVT), _abort(abort), _kill(kill) {}
 
         virtual void doit();  
         void setAbort(bool f) {_abort = f;}
         void setKill(bool f) {_kill = f;}
+
+        /**
+           True if the event has an effect: it aborts the
+           simulation, kills the job, or it is probed, also by
+           stats that are still off in the transitory (the
+           deadline may fall past it). Otherwise the task does not
+           post it (see Task::getMissCount()).
+        */
+        bool isWatched() const {
+            return _abort || _kill || hasAttachedProbes();
+        }
     };
 
 } // namespace RTSim
@@ -45,6 +45,11 @@ namespace RTSim {
                      "task.cpp") {}
     };
 
+    class BadSuccessor : public BaseExc {
+    public:
+        BadSuccessor(string msg) :BaseExc(msg, "Task", "task.cpp") {}
+    };
+
 }
 
 #endif
@@ -0,0 +1,89 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cctype>
+#include <cstdlib>
+
+#include <factory.hpp>
+
+#include <taskprogram.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+    using namespace parse_util;
+
+    static RandomVar *parseCost(const string &token, const string &param)
+    {
+        if (token == "fixed" || isdigit(param.c_str()[0]))
+            return new DeltaVar(atoi(param.c_str()));
+
+        string t = token_of(param).str();
+        vector<substring> v;
+        split_param(param_of(param), v);
+        vector<string> p;
+        assign(v, p);
+        unique_ptr<RandomVar> var(genericFactory<RandomVar>::instance().create(t, p));
+        if (var.get() == 0) throw ParseExc("TaskProgram", param);
+        return var.release();
+    }
+
+    TaskProgram::TaskProgram(const string &code) : _steps()
+    {
+        vector<substring> instr, params;
+        split_instr(substring(code), instr);
+
+        try {
+            for (unsigned int i = 0; i < instr.size(); ++i) {
+                Step s;
+                s.token = token_of(instr[i]).str();
+                split_param(param_of(instr[i]), params);
+                assign(params, s.params);
+                s.cost = NULL;
+                if (s.token == "fixed" || s.token == "delay") {
+                    if (s.params.empty()) throw ParseExc("TaskProgram", instr[i].str());
+                    s.cost = parseCost(s.token, s.params[0]);
+                }
+                _steps.push_back(s);
+            }
+        }
+        catch (...) {
+            for (unsigned int i = 0; i < _steps.size(); ++i) delete _steps[i].cost;
+            throw;
+        }
+    }
+
+    TaskProgram::~TaskProgram()
+    {
+        for (unsigned int i = 0; i < _steps.size(); ++i) delete _steps[i].cost;
+    }
+
+    const TaskProgram &TaskProgram::get(const string &code)
+    {
+        static map<string, unique_ptr<TaskProgram> > programs;
+
+        unique_ptr<TaskProgram> &p = programs[code];
+        if (!p) {
+            try {
+                p.reset(new TaskProgram(code));
+            }
+            catch (...) {
+                programs.erase(code);
+                throw;
+            }
+        }
+        return *p;
+    }
+
+} // namespace RTSim
@@ -0,0 +1,89 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TASKPROGRAM_HPP__
+#define __TASKPROGRAM_HPP__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//From metasim
+#include <randomvar.hpp>
+#include <strtoken.hpp>
+
+namespace RTSim {
+
+    using namespace std;
+    using namespace MetaSim;
+
+    /**
+       \ingroup instr
+
+       The code of a task, parsed once (see Task::insertCode() for
+       the syntax), which can be given to any number of tasks with
+       Task::insertCode(const TaskProgram &).
+
+       The program keeps, for each instruction, its name and its
+       parameters, and for the fixed() and delay() instructions the
+       random variable of their cost. The tasks loaded with a
+       program do not parse the code again and do not build their
+       own variables: their ExecInstrs draw from the variables of
+       the program, which must then live as long as the tasks. Note
+       that a variable with an internal state (e.g., a DetVar) is
+       shared by all these tasks.
+
+       @code
+       const TaskProgram &p = TaskProgram::get("fixed(2);delay(unif(1,4));");
+       for (int i = 0; i < n; ++i) tasks[i]->insertCode(p);
+       @endcode
+    */
+    class TaskProgram {
+    public:
+        struct Step {
+            /// name of the instruction, as in the code
+            string token;
+            /// its parameters
+            vector<string> params;
+            /// cost of a fixed() or delay() instruction, NULL otherwise
+            RandomVar *cost;
+        };
+
+    private:
+        vector<Step> _steps;
+
+        TaskProgram(const TaskProgram &);
+        TaskProgram &operator=(const TaskProgram &);
+
+    public:
+        /// Parses code, throws ParseExc if it is not valid
+        explicit TaskProgram(const string &code);
+        ~TaskProgram();
+
+        /// Number of instructions of the program
+        size_t size() const { return _steps.size(); }
+
+        const Step &operator[](size_t i) const { return _steps[i]; }
+
+        /**
+           The program of code. Each distinct code string is parsed
+           at its first request, and the program is kept until the
+           end of the executable.
+        */
+        static const TaskProgram &get(const string &code);
+    };
+
+} // namespace RTSim
+
+#endif
@@ -15,11 +15,18 @@
 #define __TASKSTAT_HPP__
 
 #include <string>
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <vector>
 
 #include <baseexc.hpp>
 #include <basestat.hpp>
+#include <checkpoint.hpp>
+#include <gevent.hpp>
 
+#include <aperiodic.hpp>
+#include <lighttask.hpp>
 #include <task.hpp>
 
 namespace RTSim {
@@ -37,6 +44,98 @@ namespace RTSim {
 
     };
 
+    /**
+       \ingroup measures
+
+       The sum of the counters (see TaskCounters) of some tasks,
+       for the stats that only need totals: instead of probing the
+       events of the tasks, they read the sum at the end of the
+       run (see BaseStat::endValue()) or when a snapshot is taken
+       (see BaseStat::refresh()). The counters at the end of the
+       transitory are taken by an event, posted only if there is a
+       transitory, and subtracted. With the fast-forward (see
+       Simulation::setFastForward()), the sum is extrapolated over
+       the skipped periods (see repeat()).
+    */
+    class TaskCounterSum {
+        std::vector<Task *> _tasks;
+        TaskCounters _base;
+        /// the counters of the periods skipped by the fast-forward
+        TaskCounters _skip;
+        GEvent<TaskCounterSum> _transEvt;
+
+        TaskCounters total() const
+            {
+                TaskCounters c = TaskCounters();
+                for (size_t i = 0; i < _tasks.size(); ++i) {
+                    const TaskCounters &t = _tasks[i]->getCounters();
+                    c.executed += t.executed;
+                    c.jobs += t.jobs;
+                    c.late += t.late;
+                    c.killed += t.killed;
+                    c.preemptions += t.preemptions;
+                }
+                return c;
+            }
+
+        void onTransitory(Event *) { _base = total(); }
+
+    public:
+        TaskCounterSum() :
+            _tasks(), _base(), _skip(),
+            _transEvt(this, &TaskCounterSum::onTransitory,
+                      Event::_IMMEDIATE_PRIORITY) {}
+
+        void add(Task *t) { _tasks.push_back(t); }
+
+        /// Called by the initValue() of the stat, with its transitory
+        void newRun(const Tick &transitory)
+            {
+                _base = _skip = TaskCounters();
+                _transEvt.drop();
+                if (transitory > 0) _transEvt.post(transitory);
+            }
+
+        /// The counters since the end of the transitory
+        TaskCounters get() const
+            {
+                TaskCounters c = total();
+                c.executed += _skip.executed - _base.executed;
+                c.jobs += _skip.jobs - _base.jobs;
+                c.late += _skip.late - _base.late;
+                c.killed += _skip.killed - _base.killed;
+                c.preemptions += _skip.preemptions - _base.preemptions;
+                return c;
+            }
+
+        /// @name Called by saveState(), loadState() and repeat() of the stat
+        //@{
+        void save(Checkpoint &c) const
+            {
+                c.put(get());
+            }
+
+        /// the counters are restored by the tasks (see Task::saveState())
+        void load(Checkpoint &c)
+            {
+                TaskCounters t;
+                c.get(t);
+            }
+
+        /// adds m times what has been counted since save()
+        void repeat(Checkpoint &c, double m)
+            {
+                TaskCounters t, now = get();
+                c.get(t);
+                _skip.executed += Tick(int64_t(m)) * (now.executed - t.executed);
+                _skip.jobs += uint32_t(m * (now.jobs - t.jobs));
+                _skip.late += uint32_t(m * (now.late - t.late));
+                _skip.killed += uint32_t(m * (now.killed - t.killed));
+                _skip.preemptions += uint32_t(m * (now.preemptions - t.preemptions));
+            }
+        //@}
+    };
+
     /**
        Abstract Statistical Probe Definitions; the user need to combine
        an abstract probe referring the quantity to measure with the kind
@@ -57,14 +156,23 @@ namespace RTSim {
         Tick descTime;
         Tick schedTime;
     public:
-        PreemptionStat(string name = "") : Measure(name) {};
+        PreemptionStat(string name = "") : 
+            Measure(name), count(0), descTime(-1), schedTime(-1) {};
+
+        // the probes start at the end of the transitory, with
+        // the job in progress
+        virtual void initValue() {
+            Measure::initValue();
+            count = 0;
+            descTime = schedTime = -1;
+        }
  
         void probe(const DeschedEvt &e) {
             if (e.getLastTime() != schedTime) {
                 descTime = e.getLastTime();
                 count ++;
             }
-            if (e.getLastTime() < Measure::_transitory)
+            if (e.getLastTime() < Measure::getTransitory())
                 count = 0;
         }
 
@@ -72,7 +180,7 @@ namespace RTSim {
             if (e.getLastTime() != descTime) 
                 schedTime = e.getLastTime();
             else count --;
-            if (e.getLastTime() < Measure::_transitory)
+            if (e.getLastTime() < Measure::getTransitory())
                 count = 0;
         }
 
@@ -93,50 +201,47 @@ namespace RTSim {
     /** 
         \ingroup measures
 
-        Counts the total number of preemptions.
+        Counts the total number of preemptions: the times a job
+        leaves its processor, unless it is scheduled again at
+        once. It reads the counters of the tasks (see
+        TaskCounterSum), so it does not probe their events.
     */
     class GlobalPreemptionStat : public StatCount {
-        int idSched;
-        int idDesched;
-        Tick descTime;
-        Tick schedTime; 
+        TaskCounterSum _sum;
     public:
   
-        GlobalPreemptionStat(string name = "") : StatCount(name) { 
-            idSched = -1;
-            idDesched = -1;
-            descTime = MAXTICK;
-            schedTime = MAXTICK;
+        GlobalPreemptionStat(string name = "") : StatCount(name), _sum() {}
+
+        virtual void attachToTask(Task *t) { _sum.add(t); }
+
+        virtual void initValue() {
+            StatCount::initValue();
+            _sum.newRun(getTransitory());
         }
 
-        void probe(const SchedEvt &se)
+        virtual void refresh() { _val = _sum.get().preemptions; }
+        virtual void endValue() { refresh(); }
+
+        virtual void saveState(Checkpoint &c)
             {
-                if (SIMUL.getTime() < _transitory) return;
-                if (se.getTime() == descTime && se.getTask()->getID() == idDesched)
-                    record(-1);
+                StatCount::saveState(c);
+                _sum.save(c);
             }
 
-        void probe(const DeschedEvt &de)
+        virtual void loadState(Checkpoint &c)
             {
-                if (SIMUL.getTime() < _transitory) return;
-                descTime = SIMUL.getTime();
-                idDesched = de.getTask()->getID();
-                record(1);
+                StatCount::loadState(c);
+                _sum.load(c);
             }
 
-        virtual void attachToTask(Task *t)
+        virtual bool repeat(Checkpoint &c, double m)
             {
-                new Particle<SchedEvt, GlobalPreemptionStat>(&t->schedEvt, this);
-                new Particle<DeschedEvt, GlobalPreemptionStat>(&t->deschedEvt, this);
+                double v;
+                if (!repeatBase(c, v)) return false;
+                _sum.repeat(c, m);
+                refresh();
+                return true;
             }
-
-        virtual void initValue() {
-            idSched = -1;
-            idDesched = -1;
-            descTime = MAXTICK;
-            schedTime = MAXTICK;
-            StatCount::initValue();
-        }
     };
 
     // --------------------------------------------------------------
@@ -152,9 +257,14 @@ namespace RTSim {
 
         FinishingTimeStat(string name = "") : Measure(name) {};
 
+        /// Passes a parameter to the measure (e.g., the quantile
+        /// of StatHistogram or StatQuantile)
+        template <class P>
+        FinishingTimeStat(string name, P p) : Measure(name, p) {}
+
         void probe(const EndEvt &ee) 
             {
-                if (ee.getLastTime() < Measure::_transitory) return;
+                if (ee.getLastTime() < Measure::getTransitory()) return;
                 Task *t = ee.getTask();
                 Measure::record(ee.getLastTime() - t->getLastArrival());
             }
@@ -163,6 +273,70 @@ namespace RTSim {
             {
                 new Particle<EndEvt, FinishingTimeStat>(&t->endEvt, this);
             }
+
+        void probe(const LightTaskEvt &e)
+            {
+                if (!e.isJobEnd() || e.getLastTime() < Measure::getTransitory())
+                    return;
+                Measure::record(e.getLastTime() - e.getTask()->getLastArrival());
+            }
+
+        void attachToTask(LightTask *t)
+            {
+                new Particle<LightTaskEvt, FinishingTimeStat>(&t->taskEvt, this);
+            }
+
+        /// The response times of the requests of an aperiodic source
+        void probe(const AperiodicEvt &e)
+            {
+                if (!e.isJobEnd() || e.getLastTime() < Measure::getTransitory())
+                    return;
+                Measure::record(e.getLastTime() - e.getSource()->getLastArrival());
+            }
+
+        void attachToTask(AperiodicSource *s)
+            {
+                new Particle<AperiodicEvt, FinishingTimeStat>(&s->evt, this);
+            }
+    };
+
+    /**
+       \ingroup measures
+
+       Measures the end-to-end latency of a chain of tasks (see
+       Task::addSuccessor()): attached to the last task of the
+       chain, it records, at the end of each of its jobs, the time
+       since the arrival of the job of the first task that started
+       it. With a streaming measure (e.g. StatQuantile), the
+       latencies are not stored.
+
+       <pre>
+       ChainLatencyStat<StatQuantile> p99("e2e", 0.99);
+       p99.attachToTask(&act);
+       </pre>
+    */
+    template <class Measure>
+    class ChainLatencyStat : public Measure {
+    public:
+
+        ChainLatencyStat(string name = "") : Measure(name) {};
+
+        /// Passes a parameter to the measure (e.g., the quantile
+        /// of StatHistogram or StatQuantile)
+        template <class P>
+        ChainLatencyStat(string name, P p) : Measure(name, p) {}
+
+        void probe(const EndEvt &ee)
+            {
+                if (ee.getLastTime() < Measure::getTransitory()) return;
+                Task *t = ee.getTask();
+                Measure::record(ee.getLastTime() - t->getLastChainOrigin());
+            }
+
+        void attachToTask(Task *t)
+            {
+                new Particle<EndEvt, ChainLatencyStat>(&t->endEvt, this);
+            }
     };
 
     /**
@@ -178,9 +352,14 @@ namespace RTSim {
     public:
         LatenessStat(string name = "") : Measure(name){};
 
+        /// Passes a parameter to the measure (e.g., the quantile
+        /// of StatHistogram or StatQuantile)
+        template <class P>
+        LatenessStat(string name, P p) : Measure(name, p) {}
+
         void probe(const EndEvt &ee)
             {
-                if (ee.getLastTime() < Measure::_transitory) return;
+                if (ee.getLastTime() < Measure::getTransitory()) return;
 
                 Task *t = ee.getTask();
                 Tick f = ee.getLastTime();
@@ -193,6 +372,23 @@ namespace RTSim {
             {
                 new Particle<EndEvt, LatenessStat>(&t->endEvt, this); 
             }
+
+        void probe(const LightTaskEvt &e)
+            {
+                if (!e.isJobEnd() || e.getLastTime() < Measure::getTransitory())
+                    return;
+
+                LightTask *t = e.getTask();
+                Tick f = e.getLastTime();
+                Tick d = t->getLastArrival() + t->getRelDline();
+                if (f > d) Measure::record (f - d);
+                else Measure::record(0);
+            }
+
+        void attachToTask(LightTask *t)
+            {
+                new Particle<LightTaskEvt, LatenessStat>(&t->taskEvt, this);
+            }
     };
 
     /**
@@ -210,9 +406,14 @@ namespace RTSim {
     public:
         TardinessStat(string name = "") : Measure(name){};
 
+        /// Passes a parameter to the measure (e.g., the quantile
+        /// of StatHistogram or StatQuantile)
+        template <class P>
+        TardinessStat(string name, P p) : Measure(name, p) {}
+
         void probe(const EndEvt &ee) 
             {
-                if (ee.getLastTime() < Measure::_transitory) return;
+                if (ee.getLastTime() < Measure::getTransitory()) return;
 
                 Task *t = (Task *)ee.getTask();
                 double f = (double)ee.getLastTime();
@@ -225,6 +426,23 @@ namespace RTSim {
             {
                 new Particle<EndEvt, TardinessStat>(&t->endEvt, this);
             }
+
+        void probe(const LightTaskEvt &e)
+            {
+                if (!e.isJobEnd() || e.getLastTime() < Measure::getTransitory())
+                    return;
+
+                LightTask *t = e.getTask();
+                double f = (double)e.getLastTime();
+                double a = (double)t->getLastArrival();
+                double D = (double)t->getRelDline();
+                Measure::record(max(0.0,(f-a-D)/D));
+            }
+
+        void attachToTask(LightTask *t)
+            {
+                new Particle<LightTaskEvt, TardinessStat>(&t->taskEvt, this);
+            }
     };
 
     /**
@@ -240,7 +458,7 @@ namespace RTSim {
     
         void probe(const EndEvt &ee)
             {
-                if (ee.getLastTime() < Measure::_transitory) return;
+                if (ee.getLastTime() < Measure::getTransitory()) return;
 
                 Task *t = (Task *)ee.getTask();
                 double ex = (double)t->getExecTime();
@@ -258,8 +476,9 @@ namespace RTSim {
     /**
        \ingroup measures
 
-       Computes the miss percentage. It can be applied to a single task or
-       to the entire task set.
+       Computes the miss percentage: the jobs that ended after their
+       deadline, over the jobs that ended. It can be applied to a
+       single task or to the entire task set.
     */
     class MissPercentage : public StatPercent {
     public:
@@ -267,7 +486,7 @@ namespace RTSim {
 
         void probe(const EndEvt &ee)
             {
-                if (ee.getLastTime() < _transitory) return;
+                if (ee.getLastTime() < getTransitory()) return;
 
                 Task *task = (Task *) ee.getTask();
                 if (SIMUL.getTime() > task->getLastArrival() + 
@@ -281,13 +500,30 @@ namespace RTSim {
             {
                 new Particle<EndEvt, MissPercentage>(&t->endEvt, this);
             }
+
+        void probe(const LightTaskEvt &e)
+            {
+                if (!e.isJobEnd() || e.getLastTime() < getTransitory()) return;
+
+                LightTask *t = e.getTask();
+                if (e.getLastTime() > t->getLastArrival() + t->getRelDline())
+                    record(1.0);
+                else record(0.0);
+            }
+
+        void attachToTask(LightTask *t)
+            {
+                new Particle<LightTaskEvt, MissPercentage>(&t->taskEvt, this);
+            }
     };
 
   
     /**
        \ingroup measures
 
-       Computes the number of deadline misses . It can be applied to a
+       Computes the number of deadline misses: the times the
+       deadline event of a Task fires, and the jobs of a LightTask
+       that end after their deadline. It can be applied to a
        single task or to the entire task set.
     */
     class MissCount : public StatCount {
@@ -300,6 +536,70 @@ namespace RTSim {
             {
                 new Particle<DeadEvt, MissCount>(&t->deadEvt, this);
             }
+
+        /// a LightTask has no deadline event: misses are counted at the end of the job
+        void probe(const LightTaskEvt &e)
+            {
+                LightTask *t = e.getTask();
+                if (e.isJobEnd() &&
+                    e.getLastTime() > t->getLastArrival() + t->getRelDline())
+                    record(1.0);
+            }
+
+        void attachToTask(LightTask *t)
+            {
+                new Particle<LightTaskEvt, MissCount>(&t->taskEvt, this);
+            }
+    };
+
+    /**
+       \ingroup measures
+
+       An importance function for the estimate of the probability
+       of a deadline miss by splitting (see MetaSim::Splitting):
+       the lateness of the pending jobs of the tasks (the current
+       time minus their deadline, at most 0 until the deadline
+       event), and 1 once a job has missed its deadline. The last
+       level is then 1, the others are not greater than 0:
+
+       <pre>
+       MissImportance imp;
+       imp.attachToTask(&t1);
+       imp.attachToTask(&t2);
+       double l[] = { -4, -2, -1, 0, 1 };
+       Splitting s([&imp]() { return imp(); },
+                   std::vector<double>(l, l + 5), 500);
+       </pre>
+
+       The misses are counted by a MissCount, so they are
+       restored with the checkpoints of the trials.
+    */
+    class MissImportance {
+        MissCount _misses;
+        std::vector<Task *> _tasks;
+
+        MissImportance(const MissImportance &);
+        MissImportance &operator=(const MissImportance &);
+
+    public:
+        MissImportance() : _misses(), _tasks() {}
+
+        void attachToTask(Task *t)
+            {
+                _misses.attachToTask(t);
+                _tasks.push_back(t);
+            }
+
+        double operator()()
+            {
+                if (_misses.getValue() > 0) return 1;
+                double v = -std::numeric_limits<double>::max();
+                for (size_t i = 0; i < _tasks.size(); ++i)
+                    if (_tasks[i]->isActive())
+                        v = std::max(v, double(SIMUL.getTime() -
+                                               _tasks[i]->getDeadline()));
+                return v;
+            }
     };
 
 
@@ -1,67 +1,89 @@
+#include <json_trace.hpp>
 #include <texttrace.hpp>
 
 namespace RTSim {
         using namespace std;
         using namespace MetaSim;
 
-        TextTrace::TextTrace(const string& name)
-		{
-			fd.open(name.c_str());
-		}
+        namespace {
+            const size_t BUF_SIZE = 1 << 16;
+        }
 
-		TextTrace::~TextTrace()
-		{
-			fd.close();
-		}
+        TextTrace::TextTrace(const string& name, bool async) :
+            fd(), _buf(), _writer()
+        {
+            fd.open(name.c_str());
+            _buf.reserve(BUF_SIZE + 256);
+            if (async) _writer.reset(new AsyncWriter(fd));
+        }
 
-		void TextTrace::probe(ArrEvt& e)
-		{
-			Task* tt = e.getTask();
-            fd << "[Time:" << SIMUL.getTime() << "]\t";  
-            fd << tt->getName() << " arrived at " 
-            << tt->getArrival() << endl;                
-		}
+        TextTrace::~TextTrace()
+        {
+            flush();
+            _writer.reset();
+            fd.close();
+        }
 
-		void TextTrace::probe(EndEvt& e)
-		{
-			Task* tt = e.getTask();
-			fd << "[Time:" << SIMUL.getTime() << "]\t";
-			fd << tt->getName()<<" ended, its arrival was " 
-				<< tt->getArrival() << endl;
-		}
+        void TextTrace::output(bool force)
+        {
+            if (_buf.size() < BUF_SIZE && !force) return;
+            if (_writer) _writer->write(_buf.data(), _buf.size());
+            else fd.write(_buf.data(), _buf.size());
+            _buf.clear();
+        }
 
-		void TextTrace::probe(SchedEvt& e)
-		{
-			Task* tt = e.getTask();
-			fd << "[Time:" << SIMUL.getTime() << "]\t";  
-			fd << tt->getName()<<" scheduled its arrival was " 
-				<< tt->getArrival() << endl; 
-		}
+        void TextTrace::flush()
+        {
+            output(true);
+            if (_writer) _writer->flush();
+            else fd.flush();
+        }
 
-		void TextTrace::probe(DeschedEvt& e)
-		{
-			Task* tt = e.getTask();
-			fd << "[Time:" << SIMUL.getTime() << "]\t";  
-			fd << tt->getName()<<" descheduled its arrival was " 
-				<< tt->getArrival() << endl;
-		}
+        void TextTrace::writeLine(Task *t, const char *what)
+        {
+            _buf += "[Time:";
+            jsonAppendInt(_buf, long(SIMUL.getTime()));
+            _buf += "]\t";
+            _buf += t->getName();
+            _buf += what;
+            jsonAppendInt(_buf, long(t->getArrival()));
+            _buf += '\n';
+            output();
+        }
 
-		void TextTrace::probe(DeadEvt& e)
-		{
-			Task* tt = e.getTask();
-			fd << "[Time:" << SIMUL.getTime() << "]\t";  
-			fd << tt->getName()<<" missed its arrival was " 
-				<< tt->getArrival() << endl;
-		}
+        void TextTrace::probe(ArrEvt& e)
+        {
+            writeLine(e.getTask(), " arrived at ");
+        }
 
-		void TextTrace::attachToTask(Task* t)
-		{
-			new Particle<ArrEvt, TextTrace>(&t->arrEvt, this);
-			new Particle<EndEvt, TextTrace>(&t->endEvt, this);
-			new Particle<SchedEvt, TextTrace>(&t->schedEvt, this);
-			new Particle<DeschedEvt, TextTrace>(&t->deschedEvt, this);
-			new Particle<DeadEvt, TextTrace>(&t->deadEvt, this);
-		}
+        void TextTrace::probe(EndEvt& e)
+        {
+            writeLine(e.getTask(), " ended, its arrival was ");
+        }
+
+        void TextTrace::probe(SchedEvt& e)
+        {
+            writeLine(e.getTask(), " scheduled its arrival was ");
+        }
+
+        void TextTrace::probe(DeschedEvt& e)
+        {
+            writeLine(e.getTask(), " descheduled its arrival was ");
+        }
+
+        void TextTrace::probe(DeadEvt& e)
+        {
+            writeLine(e.getTask(), " missed its arrival was ");
+        }
+
+        void TextTrace::attachToTask(Task* t)
+        {
+            new Particle<ArrEvt, TextTrace>(&t->arrEvt, this);
+            new Particle<EndEvt, TextTrace>(&t->endEvt, this);
+            new Particle<SchedEvt, TextTrace>(&t->schedEvt, this);
+            new Particle<DeschedEvt, TextTrace>(&t->deschedEvt, this);
+            new Particle<DeadEvt, TextTrace>(&t->deadEvt, this);
+        }
     
         VirtualTrace::VirtualTrace(map<string, int> *r)
         {
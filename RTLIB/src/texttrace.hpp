@@ -16,8 +16,10 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
+#include <asyncwriter.hpp>
 #include <baseexc.hpp>
 #include <basetype.hpp>
 #include <event.hpp>
@@ -31,13 +33,38 @@ namespace RTSim {
     using namespace std;
     using namespace MetaSim;
     
+    /**
+       Writes the events of the tasks attached to it in a text
+       file, one line per event:
+
+       <pre>
+       [Time:10]	T1 arrived at 10
+       </pre>
+
+       The lines are formatted in a buffer (the numbers without
+       going through the stream), which is written when full, by
+       flush() and at the end. With async, the buffers are written
+       from a background thread, by an AsyncWriter as for the
+       binary traces.
+    */
     class TextTrace {
     protected:
         ofstream fd;
+        string _buf;
+        std::unique_ptr<AsyncWriter> _writer;
+
+        void writeLine(Task *t, const char *what);
+
+        /// writes the buffer, if full (or always, if force is true)
+        void output(bool force = false);
+
     public:
-        TextTrace(const string& name);
+        TextTrace(const string& name, bool async = false);
         
         ~TextTrace();
+
+        /// Writes all the lines traced so far on the file
+        void flush();
         
         void probe(ArrEvt& e);
         
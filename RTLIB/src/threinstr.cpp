@@ -21,7 +21,10 @@ namespace RTSim {
 
     ThreInstr::ThreInstr(Task * f, const string& th, char *n)
         : Instr(f, n), _endEvt(this), _threEvt(f, this), _th(th)  
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     Instr* ThreInstr::createInstance(vector<string> &par)
     {
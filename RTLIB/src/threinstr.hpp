@@ -43,7 +43,7 @@ namespace RTSim {
   protected:
     ThreInstr * ti;
   public:
-    ThreEvt(Task* t, ThreInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3), ti(in)
+    ThreEvt(Task* t, ThreInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3, THRE_EVT), ti(in)
     {}
     ThreInstr *getInstr() {return ti;} 
     virtual void doit() {}
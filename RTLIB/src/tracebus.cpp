@@ -0,0 +1,145 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <tracebus.hpp>
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  TraceBus::TraceBus(bool background, size_t blockSize)
+    : Trace("", Trace::BINARY, false), JavaTrace("", 0UL), _sinks(),
+      _background(background), _blockSize(blockSize > 0 ? blockSize : 1),
+      _raw(), _queue(), _free(), _stop(false), _error(), _m(), _cv(), _thread()
+  {
+    // the records are encoded, but not written by JavaTrace
+    toFile = true;
+    if (_background) {
+      _raw.reserve(_blockSize);
+      _thread = std::thread(&TraceBus::loop, this);
+    }
+  }
+
+  TraceBus::~TraceBus()
+  {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  void TraceBus::subscribe(const Sink &s)
+  {
+    _sinks.push_back(s);
+  }
+
+  void TraceBus::subscribe(JavaTrace &t)
+  {
+    JavaTrace *p = &t;
+    _sinks.push_back([p](const TraceRecord &r) { p->append(r); });
+  }
+
+  void TraceBus::deliver(const vector<char> &block)
+  {
+    TraceRecordRange all(&block[0], &block[0] + block.size());
+    for (TraceRecordIterator i = all.begin(); i != all.end(); ++i)
+      for (size_t j = 0; j < _sinks.size(); ++j) _sinks[j](*i);
+  }
+
+  void TraceBus::emit(const char *rec, size_t n, int, int)
+  {
+    if (!_background) {
+      TraceRecord r(rec);
+      for (size_t j = 0; j < _sinks.size(); ++j) _sinks[j](r);
+      return;
+    }
+    _raw.insert(_raw.end(), rec, rec + n);
+    if (_raw.size() >= _blockSize) seal();
+  }
+
+  void TraceBus::seal()
+  {
+    if (_raw.empty()) return;
+    vector<char> next;
+    {
+      unique_lock<mutex> l(_m);
+      _cv.wait(l, [this]() { return _queue.size() < 2; });
+      _queue.push_back(vector<char>());
+      _queue.back().swap(_raw);
+      if (!_free.empty()) {
+        next.swap(_free.back());
+        _free.pop_back();
+      }
+    }
+    _cv.notify_all();
+    next.clear();
+    next.reserve(_blockSize);
+    _raw.swap(next);
+  }
+
+  void TraceBus::loop()
+  {
+    unique_lock<mutex> l(_m);
+    while (true) {
+      _cv.wait(l, [this]() { return !_queue.empty() || _stop; });
+      if (_queue.empty()) break;
+
+      // the block stays in the queue while the sinks consume it,
+      // so that seal() does not fill more than two
+      vector<char> &block = _queue.front();
+      l.unlock();
+      try {
+        deliver(block);
+      } catch (...) {
+        lock_guard<mutex> g(_m);
+        if (!_error) _error = current_exception();
+      }
+      l.lock();
+      _free.push_back(vector<char>());
+      _free.back().swap(_queue.front());
+      _queue.pop_front();
+      _cv.notify_all();
+    }
+  }
+
+  void TraceBus::flush()
+  {
+    if (!_thread.joinable()) return;
+    seal();
+    exception_ptr e;
+    {
+      unique_lock<mutex> l(_m);
+      _cv.wait(l, [this]() { return _queue.empty(); });
+      e = _error;
+      _error = exception_ptr();
+    }
+    if (e) rethrow_exception(e);
+  }
+
+  void TraceBus::close()
+  {
+    if (!_thread.joinable()) return;
+    seal();
+    {
+      lock_guard<mutex> l(_m);
+      _stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+    if (_error) {
+      exception_ptr e = _error;
+      _error = exception_ptr();
+      rethrow_exception(e);
+    }
+  }
+
+} // namespace RTSim
@@ -0,0 +1,119 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACEBUS_HPP__
+#define __TRACEBUS_HPP__
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <jtrace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  /**
+     \ingroup util
+
+     A trace that decodes each event once, into a record in the
+     format of TraceEvent::write() (see TraceRecord), and passes
+     the record to all the sinks subscribed to it. A task is
+     attached to the bus only (see Task::setTrace()), so that the
+     events are decoded once however many formats are written:
+     each sink only consumes a record already encoded.
+
+     A sink is any function of a TraceRecord: a JavaTrace writing
+     on a file (or a ChunkedTrace, LiveTrace or FlightRecorder,
+     see subscribe(JavaTrace &)), the add() of a TraceLOD, or a
+     lambda. With background, the records are collected in
+     blocks of about blockSize bytes, and the sinks are called by
+     a thread while the next block is filled: the simulation
+     only pays the decoding.
+
+     <pre>
+     TraceBus bus(true);
+     ChunkedTrace chunks("run.trc");
+     LiveTrace live("/dev/shm/run.live");
+     TraceLOD lod(...);
+     bus.subscribe(chunks);
+     bus.subscribe(live);
+     bus.subscribe([&](const TraceRecord &r) { lod.add(r); });
+     for (Task *t : tasks) t->setTrace(&bus);
+     SIMUL.run(100000);
+     bus.close();            // before closing the sinks
+     chunks.close();
+     </pre>
+
+     The filters of the bus (see Trace::setWindow()) apply to all
+     its sinks.
+  */
+  class TraceBus : public JavaTrace {
+  public:
+    typedef std::function<void (const TraceRecord &)> Sink;
+
+  private:
+    vector<Sink> _sinks;
+    bool _background;
+    size_t _blockSize;
+    /// the block being filled
+    vector<char> _raw;
+
+    /// the blocks waiting for the sinks (at most two)
+    deque<vector<char> > _queue;
+    vector<vector<char> > _free;
+    bool _stop;
+    exception_ptr _error;
+    std::mutex _m;
+    std::condition_variable _cv;
+    std::thread _thread;
+
+    void deliver(const vector<char> &block);
+    void seal();
+    void loop();
+
+  protected:
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+  public:
+    TraceBus(bool background = false, size_t blockSize = 1 << 16);
+    virtual ~TraceBus();
+
+    /// Adds a sink (before the simulation starts)
+    void subscribe(const Sink &s);
+
+    /// Adds a trace writing on a file as a sink (see JavaTrace::append())
+    void subscribe(JavaTrace &t);
+
+    size_t getSinks() const { return _sinks.size(); }
+
+    /**
+       Waits until all the records traced so far have been passed
+       to the sinks. With background, rethrows the first
+       exception raised by a sink.
+    */
+    void flush();
+
+    /// Flushes, and stops the thread
+    virtual void close();
+  };
+
+} // namespace RTSim
+
+#endif
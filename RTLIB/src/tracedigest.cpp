@@ -0,0 +1,116 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <iomanip>
+
+#include <simul.hpp>
+
+#include <task.hpp>
+#include <taskevt.hpp>
+#include <tracedigest.hpp>
+
+namespace RTSim {
+
+  namespace {
+    const uint64_t SEED = 14695981039346656037ULL;
+
+    // FNV-1a on 64 bits words, with a final mix of the word
+    inline uint64_t mix(uint64_t h, uint64_t v)
+    {
+      v *= 0x9e3779b97f4a7c15ULL;
+      v ^= v >> 32;
+      return (h ^ v) * 1099511628211ULL;
+    }
+  }
+
+  TraceDigest::TraceDigest(Tick window, const string &name)
+    : Trace(name.c_str(), Trace::BINARY, false), Entity(name),
+      _window(window), _run(SEED), _win(SEED), _winEnd(window), _count(0),
+      _windows(), _runs()
+  {
+  }
+
+  void TraceDigest::attachToTask(Task *t)
+  {
+    t->setTrace(this);
+    t->killEvt.addTrace(this);
+    t->deadEvt.addTrace(this);
+  }
+
+  void TraceDigest::closeWindows(Tick t)
+  {
+    // the windows before t, including the empty ones
+    while (_winEnd <= t) {
+      _windows.push_back(_win);
+      _win = SEED;
+      _winEnd += _window;
+    }
+  }
+
+  void TraceDigest::record(Event *e)
+  {
+    if (!TaskEvt::isTaskEvt(e)) return;
+    TaskEvt *ee = static_cast<TaskEvt *>(e);
+    Tick now = e->getLastTime();
+
+    uint64_t v[4] = { uint64_t(int64_t(now)), uint64_t(ee->getKind()),
+                      uint64_t(int64_t(ee->getTask() ? ee->getTask()->getID() : -1)),
+                      uint64_t(int64_t(ee->getCPU())) };
+    if (_window > 0) closeWindows(now);
+    for (int i = 0; i < 4; ++i) {
+      _run = mix(_run, v[i]);
+      _win = mix(_win, v[i]);
+    }
+    _count++;
+  }
+
+  void TraceDigest::newRun()
+  {
+    _run = _win = SEED;
+    _winEnd = _window;
+    _count = 0;
+    _windows.clear();
+  }
+
+  void TraceDigest::endRun()
+  {
+    _runs.push_back(_run);
+    if (_window > 0) {
+      closeWindows(SIMUL.getTime());
+      // the last window, even if partial
+      _windows.push_back(_win);
+      _win = SEED;
+    }
+  }
+
+  long TraceDigest::firstDifference(const vector<uint64_t> &a,
+                                    const vector<uint64_t> &b)
+  {
+    size_t n = a.size() < b.size() ? a.size() : b.size();
+    for (size_t i = 0; i < n; ++i)
+      if (a[i] != b[i]) return long(i);
+    return a.size() == b.size() ? -1 : long(n);
+  }
+
+  void TraceDigest::print(ostream &os) const
+  {
+    ios::fmtflags f = os.flags();
+    os << hex << setfill('0');
+    for (size_t i = 0; i < _runs.size(); ++i)
+      os << "run " << dec << i << " " << hex << setw(16) << _runs[i] << "\n";
+    for (size_t i = 0; i < _windows.size(); ++i)
+      os << "window " << dec << i << " " << hex << setw(16) << _windows[i] << "\n";
+    os.flags(f);
+  }
+
+} // namespace RTSim
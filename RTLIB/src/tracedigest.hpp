@@ -0,0 +1,103 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACEDIGEST_HPP__
+#define __TRACEDIGEST_HPP__
+
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <entity.hpp>
+#include <trace.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  class Task;
+
+  /**
+     \ingroup util
+
+     A trace that writes nothing: it hashes the events of the
+     tasks (time, kind, task ID and processor of each one, in
+     the order in which they are triggered) with a fast
+     non-cryptographic hash, to check that two versions of the
+     engine produce the same schedule without comparing their
+     traces.
+
+     The digest of each run is kept (see getRunDigests()).
+     With window > 0, the events of each interval [k window,
+     (k+1) window) of the current run have their own digest
+     too (see getWindows()), so that the first interval where
+     two runs differ can be found with firstDifference().
+
+     <pre>
+     TraceDigest d(1000);
+     for (Task *t : tasks) d.attachToTask(t);
+     SIMUL.run(100000);
+     cout << hex << d.getRunDigests()[0] << endl;
+     </pre>
+  */
+  class TraceDigest : public Entity, public virtual Trace {
+    Tick _window;
+    uint64_t _run, _win;
+    /// end of the current window
+    Tick _winEnd;
+    unsigned long _count;
+    vector<uint64_t> _windows;
+    vector<uint64_t> _runs;
+
+    void closeWindows(Tick t);
+
+  public:
+    TraceDigest(Tick window = 0, const string &name = "");
+
+    /// Hashes the events of t (as Task::setTrace()), its kills
+    /// and its deadline misses
+    void attachToTask(Task *t);
+
+    virtual void record(Event *e);
+
+    virtual void newRun();
+    virtual void endRun();
+
+    /// The digest of the current run, so far
+    uint64_t getDigest() const { return _run; }
+
+    /// Number of events hashed in the current run
+    unsigned long getCount() const { return _count; }
+
+    /// The digests of the runs ended so far
+    const vector<uint64_t> &getRunDigests() const { return _runs; }
+
+    /// The digests of the windows of the current (or last) run
+    const vector<uint64_t> &getWindows() const { return _windows; }
+
+    /**
+       Index of the first window where a and b differ (if one is
+       shorter, its end counts as a difference), -1 if equal.
+    */
+    static long firstDifference(const vector<uint64_t> &a,
+                                const vector<uint64_t> &b);
+
+    /// Writes the digests of the runs and of the windows, in hex
+    void print(ostream &os) const;
+  };
+
+} // namespace RTSim
+
+#endif
@@ -0,0 +1,295 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cstring>
+
+#include <tracelod.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  static const char MAGIC[4] = {'R', 'T', 'L', 'D'};
+  static const uint32_t VERSION = 1;
+
+  namespace {
+    template <class T>
+    void put(ostream &os, const T &x)
+    {
+      os.write((const char *)& x, sizeof(x));
+    }
+
+    template <class T>
+    void get(istream &is, T &x)
+    {
+      if (!is.read((char *)& x, sizeof(x)))
+        throw TraceLodExc("Truncated file");
+    }
+
+    bool byId(const TraceCell &a, const TraceCell &b)
+    {
+      return a.id < b.id;
+    }
+
+    typedef vector<vector<TraceCell> > Level;
+
+    /// Each bin of up is the sum of two bins of down
+    void merge(const Level &down, Level &up)
+    {
+      up.assign((down.size() + 1) / 2, vector<TraceCell>());
+      for (size_t i = 0; i < down.size(); ++i) {
+        vector<TraceCell> &u = up[i / 2];
+        for (size_t j = 0; j < down[i].size(); ++j) {
+          const TraceCell &c = down[i][j];
+          vector<TraceCell>::iterator k =
+            lower_bound(u.begin(), u.end(), c, byId);
+          if (k != u.end() && k->id == c.id) {
+            k->busy += c.busy;
+            k->misses += c.misses;
+          }
+          else u.insert(k, c);
+        }
+      }
+    }
+  }
+
+  const TraceCell *TraceBin::find(int32_t id) const
+  {
+    TraceCell c;
+    c.id = id;
+    vector<TraceCell>::const_iterator i =
+      lower_bound(cells.begin(), cells.end(), c, byId);
+    return i != cells.end() && i->id == id ? &*i : NULL;
+  }
+
+  TracePyramid::TracePyramid(int width)
+    : _width(width), _last(0), _bins(), _start(), _cpu()
+  {
+    if (width <= 0) throw TraceLodExc("The width of the bins must be positive");
+  }
+
+  TraceCell &TracePyramid::cell(size_t bin, int32_t id)
+  {
+    if (bin >= _bins.size()) _bins.resize(bin + 1);
+    vector<TraceCell> &b = _bins[bin];
+    for (size_t i = 0; i < b.size(); ++i)
+      if (b[i].id == id) return b[i];
+    TraceCell c = {id, 0, 0};
+    b.push_back(c);
+    return b.back();
+  }
+
+  void TracePyramid::addBusy(int32_t id, int from, int to)
+  {
+    while (from < to) {
+      int bin = from / _width;
+      int end = min(to, (bin + 1) * _width);
+      cell(bin, id).busy += end - from;
+      from = end;
+    }
+  }
+
+  void TracePyramid::add(const TraceRecord &r)
+  {
+    int t = r.getTime();
+    int task = r.getTask();
+    if (t < 0 || task < 0) return;
+    if (t > _last) _last = t;
+    if (size_t(task) >= _start.size()) {
+      _start.resize(task + 1, -1);
+      _cpu.resize(task + 1, -1);
+    }
+
+    switch (r.getType()) {
+    case TraceEvent::TASK_SCHEDULE:
+      _start[task] = t;
+      _cpu[task] = r.getCPU();
+      break;
+    case TraceEvent::TASK_DESCHEDULE:
+    case TraceEvent::TASK_END:
+      if (_start[task] >= 0) {
+        addBusy(task, _start[task], t);
+        addBusy(TraceCell::cpu(_cpu[task]), _start[task], t);
+        _start[task] = -1;
+      }
+      break;
+    case TraceEvent::TASK_DLINEMISS:
+      // charged also to the processor the task ran on last
+      cell(t / _width, task).misses++;
+      if (_cpu[task] >= 0) cell(t / _width, TraceCell::cpu(_cpu[task])).misses++;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void TracePyramid::add(const char *begin, const char *end)
+  {
+    for (TraceRecordIterator i(begin, end), e(end, end); i != e; ++i)
+      add(*i);
+  }
+
+  void TracePyramid::save(const string &name) const
+  {
+    vector<Level> levels(1);
+    {
+      TracePyramid p(*this);
+      for (size_t task = 0; task < p._start.size(); ++task)
+        if (p._start[task] >= 0) {
+          p.addBusy(task, p._start[task], _last);
+          p.addBusy(TraceCell::cpu(p._cpu[task]), p._start[task], _last);
+        }
+      if (p._bins.size() <= size_t(_last / _width)) p._bins.resize(_last / _width + 1);
+      levels[0].swap(p._bins);
+    }
+    for (size_t i = 0; i < levels[0].size(); ++i)
+      sort(levels[0][i].begin(), levels[0][i].end(), byId);
+    while (levels.back().size() > 1) {
+      levels.push_back(Level());
+      merge(levels[levels.size() - 2], levels.back());
+    }
+
+    ofstream os(name.c_str(), ios::binary);
+    if (!os.is_open()) throw TraceLodExc("Cannot open " + name);
+    os.write(MAGIC, 4);
+    put(os, VERSION);
+    put(os, int32_t(_width));
+    put(os, uint32_t(levels.size()));
+
+    uint64_t offset = 4 + 3 * sizeof(uint32_t) + levels.size() * 2 * sizeof(uint64_t);
+    for (size_t l = 0; l < levels.size(); ++l) {
+      put(os, uint64_t(levels[l].size()));
+      put(os, offset);
+      offset += (levels[l].size() + 1) * sizeof(uint64_t);
+      for (size_t i = 0; i < levels[l].size(); ++i)
+        offset += levels[l][i].size() * sizeof(TraceCell);
+    }
+    for (size_t l = 0; l < levels.size(); ++l) {
+      const Level &level = levels[l];
+      uint64_t cells = uint64_t(os.tellp()) + (level.size() + 1) * sizeof(uint64_t);
+      for (size_t i = 0; i <= level.size(); ++i) {
+        put(os, cells);
+        if (i < level.size()) cells += level[i].size() * sizeof(TraceCell);
+      }
+      for (size_t i = 0; i < level.size(); ++i)
+        if (!level[i].empty())
+          os.write((const char *)&level[i][0], level[i].size() * sizeof(TraceCell));
+    }
+    os.flush();
+    if (!os) throw TraceLodExc("Error writing " + name);
+  }
+
+  void TracePyramid::build(const string &trace, const string &lod, int width)
+  {
+    ChunkedTraceReader r(trace);
+    TracePyramid p(width);
+    vector<char> buf;
+    for (size_t i = 0; i < r.getIndex().size(); ++i) {
+      buf.clear();
+      r.readChunk(i, buf);
+      if (!buf.empty()) p.add(&buf[0], &buf[0] + buf.size());
+    }
+    p.save(lod);
+  }
+
+  TracePyramidReader::TracePyramidReader(const string &fname)
+    : _in(fname.c_str(), ios::binary), _width(0), _bins(), _index()
+  {
+    if (!_in.is_open()) throw TraceLodExc("Cannot open " + fname);
+
+    char magic[4];
+    uint32_t version, levels;
+    if (!_in.read(magic, 4) || memcmp(magic, MAGIC, 4) != 0)
+      throw TraceLodExc(fname + " is not a trace summary");
+    get(_in, version);
+    if (version != VERSION) throw TraceLodExc(fname + ": unknown version");
+    get(_in, _width);
+    get(_in, levels);
+    _bins.resize(levels);
+    _index.resize(levels);
+    for (uint32_t l = 0; l < levels; ++l) {
+      get(_in, _bins[l]);
+      get(_in, _index[l]);
+    }
+  }
+
+  int TracePyramidReader::levelFor(int64_t from, int64_t to, size_t n) const
+  {
+    for (int l = 0; l < getLevels(); ++l) {
+      int64_t w = getWidth(l);
+      if (uint64_t((to - from + w - 1) / w) <= n) return l;
+    }
+    return getLevels() - 1;
+  }
+
+  void TracePyramidReader::read(int level, int64_t from, int64_t to,
+                                vector<TraceBin> &out) const
+  {
+    out.clear();
+    int64_t w = getWidth(level);
+    uint64_t nbins = getBins(level);
+    if (from < 0) from = 0;
+    if (to <= from || uint64_t(from / w) >= nbins) return;
+    uint64_t first = from / w;
+    uint64_t last = min(uint64_t((to - 1) / w), nbins - 1);
+
+    vector<uint64_t> offs(last - first + 2);
+    _in.seekg(_index[level] + first * sizeof(uint64_t));
+    if (!_in.read((char *)&offs[0], offs.size() * sizeof(uint64_t)))
+      throw TraceLodExc("Truncated file");
+
+    vector<TraceCell> cells((offs.back() - offs[0]) / sizeof(TraceCell));
+    _in.seekg(offs[0]);
+    if (!cells.empty() &&
+        !_in.read((char *)&cells[0], cells.size() * sizeof(TraceCell)))
+      throw TraceLodExc("Truncated file");
+
+    out.resize(offs.size() - 1);
+    for (size_t i = 0; i < out.size(); ++i) {
+      out[i].start = (first + i) * w;
+      out[i].cells.assign(cells.begin() + (offs[i] - offs[0]) / sizeof(TraceCell),
+                          cells.begin() + (offs[i + 1] - offs[0]) / sizeof(TraceCell));
+    }
+  }
+
+  LodTrace::LodTrace(const char *name, int width, size_t chunkSize)
+    : Trace(name, Trace::BINARY, true), ChunkedTrace(name, chunkSize),
+      _lod(width), _saved(false)
+  {
+  }
+
+  LodTrace::~LodTrace()
+  {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  void LodTrace::emit(const char *rec, size_t n, int time, int task)
+  {
+    ChunkedTrace::emit(rec, n, time, task);
+    _lod.add(TraceRecord(rec));
+  }
+
+  void LodTrace::close()
+  {
+    ChunkedTrace::close();
+    if (_saved) return;
+    _saved = true;
+    _lod.save(_filename + ".lod");
+  }
+
+} // namespace RTSim
@@ -0,0 +1,180 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACELOD_HPP__
+#define __TRACELOD_HPP__
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <chunktrace.hpp>
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  /// Raised when a trace summary cannot be written or read
+  DECL_EXC(TraceLodExc, "TracePyramid");
+
+  /**
+     The summary of a task (id >= 0) or of a processor (id ==
+     TraceCell::cpu(n)) in a time bin: the time it executed in the
+     bin, and the deadlines it missed.
+  */
+  struct TraceCell {
+    int32_t id;
+    int32_t misses;
+    int64_t busy;
+
+    static int32_t cpu(int n) { return -1 - n; }
+  };
+
+  /// A time bin of a level of a TracePyramid
+  struct TraceBin {
+    int64_t start;
+    /// the tasks and the processors that have something in the bin
+    vector<TraceCell> cells;
+
+    /// The cell of id (NULL if there is none)
+    const TraceCell *find(int32_t id) const;
+  };
+
+  /**
+     \ingroup util
+
+     A level-of-detail pyramid over a JavaTrace, for the viewers
+     of very long traces: level 0 splits the time in bins of the
+     given width, and each level has bins twice as wide as the one
+     below, up to a single bin over the whole horizon. A bin holds
+     the busy time (between a SCHEDULE record and the next
+     DESCHEDULE or END of the same task) and the deadline misses
+     of each task and of each processor, so that the utilization
+     is busy / width.
+
+     The records are added one by one (from a MappedTrace, from
+     the chunks of a ChunkedTrace, see build(), or online, see
+     LodTrace) and the pyramid is written with save():
+
+     <pre>
+     "RTLD" version(uint32) width(int32) nlevels(uint32)
+     nlevels x { nbins(uint64) indexOffset(uint64) }
+     per level: (nbins + 1) x offset(uint64)
+                cells of its bins, in order: { id(int32) misses(int32) busy(int64) }
+     </pre>
+
+     in the byte order of the machine. A viewer (TracePyramidReader)
+     reads the directory, picks the level for its zoom and reads the
+     index and the cells of the bins on the screen only; at level 0
+     it can switch to the events themselves, with
+     ChunkedTraceReader::getEvents().
+
+     The summary is of a single run: the times must not go back.
+  */
+  class TracePyramid {
+    int _width;
+    int _last;
+    /// the bins of level 0
+    vector<vector<TraceCell> > _bins;
+    /// for each task, the start and the processor of its execution
+    vector<int> _start, _cpu;
+
+    void addBusy(int32_t id, int from, int to);
+    TraceCell &cell(size_t bin, int32_t id);
+
+  public:
+    TracePyramid(int width);
+
+    int getWidth() const { return _width; }
+
+    void add(const TraceRecord &r);
+
+    /// Adds the records between begin and end
+    void add(const char *begin, const char *end);
+
+    /**
+       Writes the pyramid; the tasks still executing are closed at
+       the time of the last record.
+
+       @throws TraceLodExc on a write error
+    */
+    void save(const string &name) const;
+
+    /**
+       Writes in lod the pyramid of the ChunkedTrace file trace,
+       decompressing one chunk at a time.
+    */
+    static void build(const string &trace, const string &lod, int width);
+  };
+
+  /**
+     \ingroup util
+
+     Reads a file written by TracePyramid, one window at a time.
+  */
+  class TracePyramidReader {
+    mutable ifstream _in;
+    int _width;
+    vector<uint64_t> _bins, _index;
+
+  public:
+    /// Opens the file and reads its directory
+    TracePyramidReader(const string &fname);
+
+    int getLevels() const { return _bins.size(); }
+
+    int64_t getWidth(int level) const { return int64_t(_width) << level; }
+
+    uint64_t getBins(int level) const { return _bins.at(level); }
+
+    /**
+       The finest level that covers [from, to) with at most n
+       bins.
+    */
+    int levelFor(int64_t from, int64_t to, size_t n) const;
+
+    /**
+       Replaces the content of out with the bins of level that
+       overlap [from, to), reading only their index entries and
+       their cells.
+    */
+    void read(int level, int64_t from, int64_t to, vector<TraceBin> &out) const;
+  };
+
+  /**
+     \ingroup util
+
+     A ChunkedTrace that builds the TracePyramid of its records
+     while they are written, and saves it next to the trace (in
+     <name>.lod) when it is closed.
+  */
+  class LodTrace : public ChunkedTrace {
+    TracePyramid _lod;
+    bool _saved;
+
+  protected:
+    virtual void emit(const char *rec, size_t n, int time, int task);
+
+  public:
+    LodTrace(const char *name, int width, size_t chunkSize = 1 << 20);
+    virtual ~LodTrace();
+
+    virtual void close();
+  };
+
+} // namespace RTSim
+
+#endif
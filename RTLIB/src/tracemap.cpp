@@ -0,0 +1,146 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  static const char VERSION[] = "version 1.2";
+
+  string TraceRecord::getString() const
+  {
+    int i = (getType() == TraceEvent::TASK_NAME) ? 4 : 5;
+    size_t len = field(i);
+    if (4 * (i + 1) + len > size()) throw TraceMapExc("Truncated record");
+    return string(data() + 4 * (i + 1), len);
+  }
+
+  TraceEvent *TraceRecord::toEvent() const
+  {
+    static const int fields[TraceEvent::EVT_NUMBER] = 
+      { 0, 1, 1, 1, 2, 1, 1, 1, 0, 0, 0 };
+
+    int type = getType();
+    if (type < 0 || type >= TraceEvent::EVT_NUMBER)
+      throw TraceMapExc("Unknown record type");
+    if (size() < size_t(4 * (4 + fields[type])))
+      throw TraceMapExc("Truncated record");
+
+    int time = getTime(), task = getTask();
+    switch (type) {
+    case TraceEvent::TASK_ARRIVAL: return new TraceArrEvent(time, task);
+    case TraceEvent::TASK_SCHEDULE: 
+      return new TraceSchedEvent(time, task, getCPU());
+    case TraceEvent::TASK_DESCHEDULE: 
+      return new TraceDeschedEvent(time, task, getCPU());
+    case TraceEvent::TASK_END: return new TraceEndEvent(time, task, getCPU());
+    case TraceEvent::TASK_DLINEPOST:
+      return new TraceDlinePostEvent(time, task, getDeadline(), 
+                                     getNewDeadline());
+    case TraceEvent::TASK_DLINESET: 
+      return new TraceDlineSetEvent(time, task, getDeadline());
+    case TraceEvent::TASK_WAIT: 
+      return new TraceWaitEvent(time, task, getString());
+    case TraceEvent::TASK_SIGNAL: 
+      return new TraceSignalEvent(time, task, getString());
+    case TraceEvent::TASK_IDLE: return new TraceIdleEvent(time, task);
+    case TraceEvent::TASK_NAME: 
+      return new TraceNameEvent(time, task, getString());
+    default: return new TraceDlineMissEvent(time, task);
+    }
+  }
+
+  void TraceRecordIterator::check() const
+  {
+    // size, type, time and task at least
+    if (_end - _p < 16) throw TraceMapExc("Truncated record");
+    int size = TraceRecord(_p).field(0);
+    if (size < 12 || _end - _p - 4 < size) 
+      throw TraceMapExc("Truncated record");
+  }
+
+  void TraceRecordIterator::skip()
+  {
+    for (; _p != _end; _p += TraceRecord(_p).size()) {
+      check();
+      TraceRecord r(_p);
+      if ((_type < 0 || r.getType() == _type) && 
+          (_task < 0 || r.getTask() == _task)) 
+        break;
+    }
+  }
+
+  MappedTrace::MappedTrace(const string &fname)
+    : _map(0), _len(0), _copy(), _begin(0), _end(0)
+  {
+    const char *base;
+
+#ifndef _WIN32
+    int fd = open(fname.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0) close(fd);
+      throw TraceMapExc("Cannot open " + fname);
+    }
+    _len = st.st_size;
+    if (_len < sizeof(VERSION)) {
+      close(fd);
+      throw TraceMapExc(fname + " is not a trace");
+    }
+    void *m = mmap(0, _len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) throw TraceMapExc("Cannot map " + fname);
+    // the records are read once, in order
+    madvise(m, _len, MADV_SEQUENTIAL);
+    _map = m;
+    base = (const char *)m;
+#else
+    ifstream f(fname.c_str(), ios::binary);
+    if (!f.is_open()) throw TraceMapExc("Cannot open " + fname);
+    _copy.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+    _len = _copy.size();
+    if (_len < sizeof(VERSION)) throw TraceMapExc(fname + " is not a trace");
+    base = _copy.data();
+#endif
+
+    if (memcmp(base, VERSION, sizeof(VERSION)) != 0) {
+#ifndef _WIN32
+      munmap(_map, _len);
+#endif
+      throw TraceMapExc(fname + " is not a trace");
+    }
+    _begin = base + sizeof(VERSION);
+    _end = base + _len;
+  }
+
+  MappedTrace::~MappedTrace()
+  {
+#ifndef _WIN32
+    if (_map != 0) munmap(_map, _len);
+#endif
+  }
+
+} // namespace RTSim
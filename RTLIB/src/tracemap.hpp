@@ -0,0 +1,198 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACEMAP_HPP__
+#define __TRACEMAP_HPP__
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+#include <baseexc.hpp>
+#include <traceevent.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  /// Raised when a trace file cannot be mapped, or is corrupted
+  DECL_EXC(TraceMapExc, "MappedTrace");
+
+  /**
+     \ingroup util
+
+     A record of a JavaTrace file, read in place: the object only
+     holds a pointer to the record, whose fields (big endian
+     integers, see TraceEvent::encode()) are decoded when they
+     are asked for. The record is made of its size (not counting
+     the size field), type, time and task, followed by the
+     payload of its type.
+  */
+  class TraceRecord {
+    const unsigned char *_p;
+
+  public:
+    explicit TraceRecord(const char *p = NULL)
+      : _p((const unsigned char *)p) {}
+
+    /// the i-th integer field of the record (0 is the size)
+    int field(int i) const
+    {
+      const unsigned char *q = _p + 4 * i;
+      return int((unsigned(q[0]) << 24) | (unsigned(q[1]) << 16) |
+                 (unsigned(q[2]) << 8) | unsigned(q[3]));
+    }
+
+    const char *data() const { return (const char *)_p; }
+
+    /// the size of the whole record, including the size field
+    size_t size() const { return 4 + field(0); }
+
+    int getType() const { return field(1); }
+    int getTime() const { return field(2); }
+    int getTask() const { return field(3); }
+
+    /// the processor of a SCHEDULE, DESCHEDULE or END record
+    int getCPU() const { return field(4); }
+
+    /**
+       The deadline of a DLINESET record, or the old deadline of a
+       DLINEPOST record
+    */
+    int getDeadline() const { return field(4); }
+
+    /// the new deadline of a DLINEPOST record
+    int getNewDeadline() const { return field(5); }
+
+    /// the resource of a WAIT or SIGNAL record, the name of a NAME one
+    string getString() const;
+
+    /// A new TraceEvent with the content of the record
+    TraceEvent *toEvent() const;
+  };
+
+  /**
+     \ingroup util
+
+     Iterates over the records between two pointers, skipping
+     those that do not match a type and a task (-1 matches all
+     of them). The records are checked (their size must lie in
+     the buffer) as the iterator advances.
+  */
+  class TraceRecordIterator {
+    const char *_p, *_end;
+    int _type, _task;
+
+    void check() const;
+    void skip();
+
+  public:
+    typedef forward_iterator_tag iterator_category;
+    typedef TraceRecord value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const TraceRecord *pointer;
+    typedef TraceRecord reference;
+
+    TraceRecordIterator(const char *p = NULL, const char *end = NULL,
+                        int type = -1, int task = -1)
+      : _p(p), _end(end), _type(type), _task(task) { skip(); }
+
+    TraceRecord operator*() const { return TraceRecord(_p); }
+
+    TraceRecordIterator &operator++()
+    {
+      _p += TraceRecord(_p).size();
+      skip();
+      return *this;
+    }
+
+    TraceRecordIterator operator++(int)
+    {
+      TraceRecordIterator i(*this);
+      ++*this;
+      return i;
+    }
+
+    bool operator==(const TraceRecordIterator &i) const { return _p == i._p; }
+    bool operator!=(const TraceRecordIterator &i) const { return _p != i._p; }
+  };
+
+  /// The records of a buffer that match a type and a task
+  class TraceRecordRange {
+    const char *_begin, *_end;
+    int _type, _task;
+
+  public:
+    TraceRecordRange(const char *b, const char *e, int type = -1,
+                     int task = -1)
+      : _begin(b), _end(e), _type(type), _task(task) {}
+
+    TraceRecordIterator begin() const
+    {
+      return TraceRecordIterator(_begin, _end, _type, _task);
+    }
+
+    TraceRecordIterator end() const
+    {
+      return TraceRecordIterator(_end, _end);
+    }
+  };
+
+  /**
+     \ingroup util
+
+     A JavaTrace file mapped read-only in memory (with mmap(),
+     where available; otherwise it is read as a whole), whose
+     records are read in place instead of being built one by one
+     with TraceEvent::read():
+
+     <pre>
+     MappedTrace t("trace.trc");
+     for (TraceRecord r : t.select(TraceEvent::TASK_END, 17))
+         sum += r.getTime();
+     </pre>
+  */
+  class MappedTrace {
+    void *_map;
+    size_t _len;
+    string _copy;
+    const char *_begin, *_end;
+
+    MappedTrace(const MappedTrace &);
+    MappedTrace &operator=(const MappedTrace &);
+
+  public:
+    MappedTrace(const string &fname);
+    ~MappedTrace();
+
+    TraceRecordIterator begin() const
+    {
+      return TraceRecordIterator(_begin, _end);
+    }
+
+    TraceRecordIterator end() const { return TraceRecordIterator(_end, _end); }
+
+    /// The records of the given type and task (-1 == any)
+    TraceRecordRange select(int type, int task = -1) const
+    {
+      return TraceRecordRange(_begin, _end, type, task);
+    }
+
+    /// Size of the records, in bytes
+    size_t size() const { return _end - _begin; }
+  };
+
+} // namespace RTSim
+
+#endif
@@ -0,0 +1,182 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <climits>
+
+#include <taskevt.hpp>
+#include <traceevent.hpp>
+#include <tracemerge.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  namespace {
+    /// The priority of the event that writes a record of type t
+    int priorityOf(int t)
+    {
+      switch (t) {
+      case TraceEvent::TASK_END: return EndEvt::_END_EVT_PRIORITY;
+      case TraceEvent::TASK_DLINEMISS: return DeadEvt::_DEAD_EVT_PRIORITY;
+      // see WaitEvt
+      case TraceEvent::TASK_WAIT: return Event::_DEFAULT_PRIORITY - 3;
+      default: return Event::_DEFAULT_PRIORITY;
+      }
+    }
+  }
+
+  /// A trace being merged, read one chunk at a time
+  struct TraceMerger::Stream {
+    ChunkedTraceReader in;
+    int index;
+    /// the next chunk to read
+    size_t chunk;
+    /// the records read and not consumed, from pos on
+    vector<char> buf;
+    size_t pos;
+    /// the size of the records of the next event
+    size_t len;
+
+    Stream(const string &name, int i) :
+      in(name), index(i), chunk(0), buf(), pos(0), len(0) {}
+
+    bool more() const { return chunk < in.getIndex().size(); }
+
+    /// Appends the next chunk to the records not consumed
+    bool load()
+    {
+      if (!more()) return false;
+      buf.erase(buf.begin(), buf.begin() + pos);
+      pos = 0;
+      in.readChunk(chunk++, buf);
+      return true;
+    }
+
+    TraceRecord at(size_t off) const { return TraceRecord(&buf[pos + off]); }
+
+    /// True if there is a whole record at off, reading the next chunks
+    bool has(size_t off)
+    {
+      while (true) {
+        size_t p = pos + off;
+        if (p + 4 <= buf.size()) {
+          size_t n = at(off).size();
+          if (n < 16) throw ChunkedTraceExc("Corrupted record");
+          if (p + n <= buf.size()) return true;
+        }
+        if (!load()) return false;
+      }
+    }
+
+    /// The size of the records of the next event, and its priority
+    size_t event(int &prio)
+    {
+      size_t n = 0;
+      if (at(0).getType() == TraceEvent::TASK_NAME && has(at(0).size()))
+        n = at(0).size();
+      TraceRecord r = at(n);
+      int type = r.getType();
+      size_t end = n + r.size();
+      prio = priorityOf(type);
+      if (type == TraceEvent::TASK_ARRIVAL && has(end)) {
+        r = at(n);
+        TraceRecord d = at(end);
+        if (d.getType() == TraceEvent::TASK_DLINESET &&
+            d.getTime() == r.getTime() && d.getTask() == r.getTask())
+          end += d.size();
+      }
+      return end;
+    }
+  };
+
+  TraceMerger::TraceMerger(const vector<string> &traces) :
+    _streams(), _heads(), _cur(0), _left(0), _copied(0), _data()
+  {
+    try {
+      for (size_t i = 0; i < traces.size(); ++i) {
+        _streams.push_back(new Stream(traces[i], int(i)));
+        push(_streams.back());
+      }
+    } catch (...) {
+      for (size_t i = 0; i < _streams.size(); ++i) delete _streams[i];
+      throw;
+    }
+  }
+
+  TraceMerger::~TraceMerger()
+  {
+    for (size_t i = 0; i < _streams.size(); ++i) delete _streams[i];
+  }
+
+  void TraceMerger::push(Stream *s)
+  {
+    Head h;
+    h.stream = s->index;
+    if (s->pos < s->buf.size()) {
+      if (!s->has(0)) throw ChunkedTraceExc("Truncated record");
+      h.time = s->at(0).getTime();
+      s->len = s->event(h.priority);
+    }
+    else if (s->more()) {
+      // before all the events of its first time
+      h.time = s->in.getIndex()[s->chunk].first;
+      h.priority = INT_MIN;
+    }
+    else return;
+    _heads.insert(h);
+  }
+
+  bool TraceMerger::step(TraceRecord &r, ChunkedTrace *out)
+  {
+    if (_left == 0) {
+      if (_cur != 0) push(_cur);
+      _cur = 0;
+      while (!_heads.empty() && _heads.begin()->priority == INT_MIN) {
+        Stream *s = _streams[_heads.begin()->stream];
+        _heads.erase(_heads.begin());
+        const TraceChunk &c = s->in.getIndex()[s->chunk];
+        if (out != 0 && out->getFormat() == s->in.getFormat() &&
+            (_heads.empty() || c.last < _heads.begin()->time)) {
+          s->in.readCompressed(s->chunk++, _data);
+          out->appendChunk(_data, c);
+          ++_copied;
+        }
+        else s->load();
+        push(s);
+      }
+      if (_heads.empty()) return false;
+      _cur = _streams[_heads.begin()->stream];
+      _left = _cur->len;
+      _heads.erase(_heads.begin());
+    }
+
+    // the buffer does not change until the next call
+    r = _cur->at(0);
+    _cur->pos += r.size();
+    _left -= r.size();
+    return true;
+  }
+
+  bool TraceMerger::next(TraceRecord &r)
+  {
+    return step(r, 0);
+  }
+
+  void TraceMerger::write(ChunkedTrace &out)
+  {
+    TraceRecord r;
+    while (step(r, &out)) out.append(r);
+  }
+
+} // namespace RTSim
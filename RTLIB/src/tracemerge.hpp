@@ -0,0 +1,123 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACEMERGE_HPP__
+#define __TRACEMERGE_HPP__
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <chunktrace.hpp>
+#include <tracemap.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+
+  /**
+     \ingroup util
+
+     Merges the ChunkedTrace files written by the partitions (or
+     the replications) of a parallel run in a single trace, in
+     time order, as if a single simulation had traced all their
+     tasks.
+
+     The events of the same time are ordered as the simulator
+     orders them, by priority (the priority of the event that
+     produced the record: a TASK_END record comes before a
+     TASK_ARRIVAL one, see EndEvt) and then, since a record does
+     not tell its order of insertion, by the position of its
+     trace in the list: the result does not depend on how the
+     workers were scheduled. The records of the same event (a
+     TASK_NAME and the record that follows it, a TASK_ARRIVAL
+     and its TASK_DLINESET) are never separated, and the records
+     of a trace keep their order.
+
+     Each trace is read one chunk at a time. When merging in a
+     ChunkedTrace, a chunk that ends before the next event of all
+     the other traces (as told by the index) is copied as it is,
+     without decompressing it, if the formats of the records are
+     the same: traces that overlap little are
+     merged at the speed of the disk.
+
+     <pre>
+     vector<string> parts = {"part0.trc", "part1.trc"};
+     TraceMerger m(parts);
+     ChunkedTrace out("all.trc");
+     m.write(out);
+     out.close();
+     </pre>
+
+     The task IDs are not changed.
+  */
+  class TraceMerger {
+  public:
+    /// @throws ChunkedTraceExc if a trace cannot be read
+    TraceMerger(const vector<string> &traces);
+    ~TraceMerger();
+
+    /**
+       The next record, in global order, valid until the next
+       call; false at the end.
+    */
+    bool next(TraceRecord &r);
+
+    /// Writes the records not read yet in out
+    void write(ChunkedTrace &out);
+
+    /// The chunks copied without decompressing them by write()
+    size_t getCopiedChunks() const { return _copied; }
+
+    struct Stream;
+
+  private:
+    /// the next event of a stream
+    struct Head {
+      int time, priority, stream;
+
+      bool operator<(const Head &h) const
+      {
+        if (time != h.time) return time < h.time;
+        if (priority != h.priority) return priority < h.priority;
+        return stream < h.stream;
+      }
+    };
+
+    vector<Stream *> _streams;
+    set<Head> _heads;
+    /// the stream of the event being read, and its bytes left
+    Stream *_cur;
+    size_t _left;
+    size_t _copied;
+    /// a buffer for the chunks copied
+    vector<char> _data;
+
+    TraceMerger(const TraceMerger &);
+    TraceMerger &operator=(const TraceMerger &);
+
+    /// Inserts the head of stream s, if it has one
+    void push(Stream *s);
+
+    /**
+       Moves to the next record: before the first record of an
+       event, the chunks of a stream that end before the others
+       are copied in out (if not NULL), and the next chunk of a
+       stream at the end of its buffer is read.
+    */
+    bool step(TraceRecord &r, ChunkedTrace *out);
+  };
+
+} // namespace RTSim
+
+#endif
@@ -9,6 +9,8 @@ namespace RTSim {
      *
      * This class exports a periodic trace of the power saved by the CPU.
      * The trace is saved on a file called "power.txt" every 10 msec.
+     * For the energy consumed in a run, CPU::getEnergy() is exact
+     * and needs no periodic event.
      */
     class TracePowerConsumption:
         public PeriodicTimer, public TraceAscii
@@ -0,0 +1,353 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <chunktrace.hpp>
+#include <tracemap.hpp>
+#include <tracestats.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  struct TraceStats::Sums {
+    StatSummary m[MEASURES];
+    int64_t misses;
+
+    Sums() : misses(0)
+    {
+      for (int i = 0; i < MEASURES; ++i) m[i].initValue();
+    }
+  };
+
+  namespace {
+    /// The jobs of a task that have not ended, and the state of the probes
+    struct Job {
+      struct Arrival {
+        int time, deadline;
+      };
+      /// in order of arrival: the first one is executing
+      deque<Arrival> pending;
+      /// relative deadline (-1 until known)
+      int rel;
+      /// of the first pending job
+      int64_t exec;
+      int preemptions;
+      /// start of the current execution (-1 if not executing)
+      int running;
+      /// as in PreemptionStat
+      int schedTime, descTime;
+
+      Job() : pending(), rel(-1), exec(0), preemptions(0), running(-1),
+              schedTime(-1), descTime(-1) {}
+
+      bool idle() const { return pending.empty() && running < 0; }
+    };
+
+    /// A task in a range of chunks
+    struct TaskState {
+      Job job;
+      /// an arrival has been found, and the jobs are measured
+      bool synced;
+      /// the records before it, which continue the jobs of the
+      /// ranges before
+      vector<char> head;
+
+      TaskState() : job(), synced(false), head() {}
+    };
+
+    void measure(const Job &j, int f, TraceStats::Sums &s)
+    {
+      double a = j.pending.front().time, d = j.pending.front().deadline;
+      double D = d - a;
+      s.m[TraceStats::FINISHING_TIME].record(f - a);
+      s.m[TraceStats::LATENESS].record(max(0.0, f - d));
+      s.m[TraceStats::TARDINESS].record(D > 0 ? max(0.0, (f - a - D) / D) : 0.0);
+      s.m[TraceStats::UTILIZATION].record(D > 0 ? j.exec / D : 0.0);
+      s.m[TraceStats::PREEMPTIONS].record(j.preemptions);
+      s.m[TraceStats::MISSED].record(f > d ? 1.0 : 0.0);
+    }
+
+    /**
+       Applies r to j; the jobs that end are measured in s (if
+       any). The jobs of a task are executed in order of arrival
+       (see Task::handleArrival()): an END record ends the first
+       pending job.
+    */
+    void step(Job &j, const TraceRecord &r, TraceStats::Sums *s, int transitory)
+    {
+      int t = r.getTime();
+      switch (r.getType()) {
+      case TraceEvent::TASK_ARRIVAL: {
+        Job::Arrival a = {t, j.rel >= 0 ? t + j.rel : t};
+        j.pending.push_back(a);
+        break;
+      }
+      case TraceEvent::TASK_DLINESET:
+        // the deadline of a buffered arrival is not set yet when
+        // the record is written: it is known from those before
+        if (j.pending.size() == 1 || (!j.pending.empty() && j.rel < 0)) {
+          j.pending.back().deadline = r.getDeadline();
+          j.rel = r.getDeadline() - j.pending.back().time;
+        }
+        break;
+      case TraceEvent::TASK_SCHEDULE:
+        if (t != j.descTime) j.schedTime = t;
+        else j.preemptions--;
+        j.running = t;
+        break;
+      case TraceEvent::TASK_DESCHEDULE:
+        if (j.running >= 0) j.exec += t - j.running;
+        j.running = -1;
+        if (t != j.schedTime) {
+          j.descTime = t;
+          j.preemptions++;
+        }
+        break;
+      case TraceEvent::TASK_END:
+        if (j.running >= 0) j.exec += t - j.running;
+        j.running = -1;
+        if (!j.pending.empty()) {
+          if (s != NULL && t >= transitory) measure(j, t, *s);
+          j.pending.pop_front();
+        }
+        j.exec = 0;
+        j.preemptions = 0;
+        break;
+      default:
+        break;
+      }
+    }
+
+    void replay(const vector<char> &recs, Job &j, TraceStats::Sums *s,
+                int transitory)
+    {
+      if (recs.empty()) return;
+      const char *end = &recs[0] + recs.size();
+      for (TraceRecordIterator r(&recs[0], end), e(end, end); r != e; ++r)
+        step(j, *r, s, transitory);
+    }
+  }
+
+  struct TraceStats::Segment {
+    SimContext ctx;
+    /// the chunks of the range
+    size_t from, to;
+    map<int, Sums *> sums;
+    map<int, TaskState> tasks;
+
+    Segment() : ctx(), from(0), to(0), sums(), tasks() {}
+
+    ~Segment()
+    {
+      for (map<int, Sums *>::iterator i = sums.begin(); i != sums.end(); ++i)
+        delete i->second;
+    }
+
+    Sums &sum(int task)
+    {
+      Sums *&s = sums[task];
+      if (s == NULL) {
+        SimContext::Scope scope(&ctx);
+        s = new Sums();
+      }
+      return *s;
+    }
+  };
+
+  TraceStats::TraceStats(const string &trace, int threads)
+    : _name(trace), _threads(threads), _transitory(0), _ctx(), _sums(),
+      _all(NULL), _tasks()
+  {
+  }
+
+  TraceStats::~TraceStats()
+  {
+    clear();
+  }
+
+  void TraceStats::clear()
+  {
+    for (map<int, Sums *>::iterator i = _sums.begin(); i != _sums.end(); ++i)
+      delete i->second;
+    _sums.clear();
+    delete _all;
+    _all = NULL;
+    _tasks.clear();
+  }
+
+  void TraceStats::read(Segment &s) const
+  {
+    SimContext::Scope scope(&s.ctx);
+    ChunkedTraceReader r(_name);
+    vector<char> raw;
+    for (size_t i = s.from; i < s.to; ++i) {
+      raw.clear();
+      r.readChunk(i, raw);
+      if (raw.empty()) continue;
+      const char *end = &raw[0] + raw.size();
+      for (TraceRecordIterator k(&raw[0], end), e(end, end); k != e; ++k) {
+        TraceRecord rec = *k;
+        int task = rec.getTask();
+        if (task < 0) continue;
+        map<int, TaskState>::iterator it = s.tasks.find(task);
+        if (it == s.tasks.end()) {
+          it = s.tasks.insert(make_pair(task, TaskState())).first;
+          // the trace starts with no job
+          it->second.synced = s.from == 0;
+        }
+        TaskState &ts = it->second;
+        Sums &sum = s.sum(task);
+        int type = rec.getType();
+        if (type == TraceEvent::TASK_DLINEMISS) sum.misses++;
+
+        // the records before the first arrival belong to the jobs
+        // of the ranges before; from the first arrival on, the
+        // task is assumed to have no other job (checked by
+        // compute())
+        if (!ts.synced) {
+          if (type != TraceEvent::TASK_ARRIVAL) {
+            ts.head.insert(ts.head.end(), rec.data(), rec.data() + rec.size());
+            continue;
+          }
+          ts.synced = true;
+        }
+        step(ts.job, rec, &sum, _transitory);
+      }
+    }
+  }
+
+  void TraceStats::add(const map<int, Sums *> &sums)
+  {
+    for (map<int, Sums *>::const_iterator i = sums.begin(); i != sums.end(); ++i) {
+      Sums *&s = _sums[i->first];
+      if (s == NULL) s = new Sums();
+      for (int m = 0; m < MEASURES; ++m) {
+        s->m[m].merge(i->second->m[m]);
+        _all->m[m].merge(i->second->m[m]);
+      }
+      s->misses += i->second->misses;
+      _all->misses += i->second->misses;
+    }
+  }
+
+  void TraceStats::compute()
+  {
+    size_t n = ChunkedTraceReader(_name).getIndex().size();
+    int threads = _threads > 0 ? _threads : thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+    if (size_t(threads) > n) threads = max<size_t>(n, 1);
+
+    vector<Segment> segs(threads);
+    for (int k = 0; k < threads; ++k) {
+      segs[k].from = n * k / threads;
+      segs[k].to = n * (k + 1) / threads;
+    }
+    exception_ptr error;
+    mutex m;
+    auto worker = [&](int k) {
+      try {
+        read(segs[k]);
+      } catch (...) {
+        lock_guard<mutex> l(m);
+        if (!error) error = current_exception();
+      }
+    };
+    vector<thread> pool;
+    for (int k = 1; k < threads; ++k) pool.push_back(thread(worker, k));
+    worker(0);
+    for (size_t k = 0; k < pool.size(); ++k) pool[k].join();
+    if (error) rethrow_exception(error);
+
+    // joins the ranges in order: the head of a task completes the
+    // jobs of the ranges before, and must leave the task without
+    // jobs at the first arrival, as assumed by read(); otherwise
+    // (a job that arrived before is still waiting, in an overload)
+    // the task is measured again on the range, sequentially
+    Segment joined;
+    SimContext::Scope scope(&joined.ctx);
+    map<int, Job> open;
+    for (int k = 0; k < threads; ++k) {
+      Segment &seg = segs[k];
+      set<int> again;
+      for (map<int, TaskState>::iterator i = seg.tasks.begin(); i != seg.tasks.end(); ++i) {
+        Job &j = open[i->first];
+        if (i->second.synced) {
+          Job check(j);
+          replay(i->second.head, check, NULL, _transitory);
+          if (!check.idle()) {
+            again.insert(i->first);
+            continue;
+          }
+        }
+        replay(i->second.head, j, &joined.sum(i->first), _transitory);
+        if (i->second.synced) j = i->second.job;
+      }
+      if (again.empty()) continue;
+
+      ChunkedTraceReader r(_name);
+      vector<char> raw;
+      for (size_t c = seg.from; c < seg.to; ++c) {
+        raw.clear();
+        r.readChunk(c, raw);
+        if (raw.empty()) continue;
+        const char *end = &raw[0] + raw.size();
+        for (TraceRecordIterator i(&raw[0], end), e(end, end); i != e; ++i) {
+          int task = (*i).getTask();
+          if (again.count(task) == 0) continue;
+          Sums &sum = joined.sum(task);
+          if ((*i).getType() == TraceEvent::TASK_DLINEMISS) sum.misses++;
+          step(open[task], *i, &sum, _transitory);
+        }
+      }
+      for (set<int>::iterator i = again.begin(); i != again.end(); ++i) {
+        delete seg.sums[*i];
+        seg.sums.erase(*i);
+      }
+    }
+
+    clear();
+    SimContext::Scope own(&_ctx);
+    _all = new Sums();
+    for (int k = 0; k < threads; ++k) add(segs[k].sums);
+    add(joined.sums);
+    for (map<int, Sums *>::iterator i = _sums.begin(); i != _sums.end(); ++i)
+      _tasks.push_back(i->first);
+  }
+
+  StatSummary &TraceStats::get(Measure m, int task)
+  {
+    if (m < 0 || m >= MEASURES) throw TraceStatsExc("Unknown measure");
+    if (_all == NULL) throw TraceStatsExc("compute() has not been called");
+    if (task < 0) return _all->m[m];
+    map<int, Sums *>::const_iterator i = _sums.find(task);
+    if (i == _sums.end()) throw TraceStatsExc("No such task in the trace");
+    return i->second->m[m];
+  }
+
+  int64_t TraceStats::getMissCount(int task) const
+  {
+    if (_all == NULL) throw TraceStatsExc("compute() has not been called");
+    if (task < 0) return _all->misses;
+    map<int, Sums *>::const_iterator i = _sums.find(task);
+    return i == _sums.end() ? 0 : i->second->misses;
+  }
+
+} // namespace RTSim
@@ -0,0 +1,129 @@
+/***************************************************************************
+ begin                : Thu Apr 24 15:54:58 CEST 2003
+ copyright            : (C) 2003 by Giuseppe Lipari
+ email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TRACESTATS_HPP__
+#define __TRACESTATS_HPP__
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <basestat.hpp>
+#include <simcontext.hpp>
+
+namespace RTSim {
+
+  using namespace std;
+  using namespace MetaSim;
+
+  /// Raised when the statistics of a trace cannot be computed
+  DECL_EXC(TraceStatsExc, "TraceStats");
+
+  /**
+     \ingroup measures
+
+     Computes the measures of taskstat.hpp on a ChunkedTrace file,
+     after the simulation: a new metric over an old experiment
+     does not need to run the model again.
+
+     The chunks are split in as many contiguous ranges as threads;
+     each thread decompresses its own range and records the jobs
+     in its accumulators (StatSummary objects, in a SimContext of
+     its own), and at the end the accumulators are merged (see
+     BaseStat::merge()) in the order of the ranges. The records of
+     a task before its first arrival in a range complete the jobs
+     of the ranges before, when the ranges are joined; a task
+     that still has a job waiting at that arrival (in an
+     overload) is measured again on the range, sequentially.
+
+     The jobs of a task are executed in order of arrival, so an
+     END record ends the oldest pending ARRIVAL. The measures are
+     those of FinishingTimeStat, LatenessStat, TardinessStat,
+     UtilizationStat (the execution time of the job over its
+     relative deadline), PreemptionStat and MissPercentage (1 for
+     a job that ends after its deadline, 0 otherwise, so that the
+     mean is the fraction of late jobs). The deadline misses of
+     MissCount are the DLINEMISS records.
+
+     <pre>
+     TraceStats s("trace.trc");
+     s.compute();
+     double rt = s.get(TraceStats::FINISHING_TIME, 3).getMax();
+     </pre>
+  */
+  class TraceStats {
+  public:
+    enum Measure {
+      FINISHING_TIME,
+      LATENESS,
+      TARDINESS,
+      UTILIZATION,
+      PREEMPTIONS,
+      MISSED,
+      MEASURES
+    };
+
+    /// threads == 0 uses a thread per core
+    TraceStats(const string &trace, int threads = 0);
+    ~TraceStats();
+
+    /// The jobs that end before t are not measured
+    void setTransitory(int t) { _transitory = t; }
+
+    /**
+       Reads the trace and computes the measures, replacing those
+       of the previous call.
+
+       @throws ChunkedTraceExc if the file cannot be read
+    */
+    void compute();
+
+    /// The tasks of the trace, in order of ID
+    const vector<int> &getTasks() const { return _tasks; }
+
+    /**
+       The values of measure m for task (for all the tasks if
+       task < 0).
+
+       @throws TraceStatsExc if there is no such task
+    */
+    StatSummary &get(Measure m, int task = -1);
+
+    /// The number of DLINEMISS records of task (of all tasks if task < 0)
+    int64_t getMissCount(int task = -1) const;
+
+    struct Sums;
+    struct Segment;
+
+  private:
+    string _name;
+    int _threads;
+    int _transitory;
+    SimContext _ctx;
+    map<int, Sums *> _sums;
+    Sums *_all;
+    vector<int> _tasks;
+
+    TraceStats(const TraceStats &);
+    TraceStats &operator=(const TraceStats &);
+
+    void clear();
+    void read(Segment &s) const;
+    void add(const map<int, Sums *> &sums);
+  };
+
+} // namespace RTSim
+
+#endif
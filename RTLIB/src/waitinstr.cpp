@@ -20,14 +20,20 @@
 namespace RTSim {
 
     WaitInstr::WaitInstr(Task * f, const char *r, int nr, char *n)
-        : Instr(f, n), _res(r), _endEvt(this), 
+        : Instr(f, n), _res(r), _resource(0), _endEvt(this), 
           _waitEvt(f, this), _numberOfRes(nr) 
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     WaitInstr::WaitInstr(Task * f, const string &r, int nr, char *n)
-        : Instr(f, n), _res(r), _endEvt(this), 
+        : Instr(f, n), _res(r), _resource(0), _endEvt(this), 
           _waitEvt(f, this), _numberOfRes(nr) 
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     Instr* WaitInstr::createInstance(vector<string> &par)
     {
@@ -69,20 +75,27 @@ namespace RTSim {
 
         if (k == NULL) throw BaseExc("Kernel not found!");
 
-        k->requestResource(_father, _res, _numberOfRes);
+        if (_resource == 0) _resource = k->getResource(_res);
+        k->requestResource(_father, _resource, _numberOfRes);
 
         _waitEvt.process();
     }
 
     SignalInstr::SignalInstr(Task *f,  const char *r, int nr, char *n)
-        : Instr(f, n), _res(r), _endEvt(this), 
+        : Instr(f, n), _res(r), _resource(0), _endEvt(this), 
           _signalEvt(f, this), _numberOfRes(nr) 
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     SignalInstr::SignalInstr(Task *f, const string &r, int nr, char *n)
-        : Instr(f, n), _res(r), _endEvt(this), 
+        : Instr(f, n), _res(r), _resource(0), _endEvt(this), 
           _signalEvt(f, this), _numberOfRes(nr) 
-    {}
+    {
+        // newRun() has nothing to reset
+        setResetState(NULL, 0);
+    }
 
     Instr* SignalInstr::createInstance(vector<string> &par)
     {
@@ -125,7 +138,10 @@ namespace RTSim {
             throw BaseExc("SignalInstr has no kernel set!");
         }
         
-        else k->releaseResource(_father, _res, _numberOfRes); 
+        else {
+            if (_resource == 0) _resource = k->getResource(_res);
+            k->releaseResource(_father, _resource, _numberOfRes);
+        } 
     }
 
 }
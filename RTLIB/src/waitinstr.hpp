@@ -16,6 +16,7 @@ namespace RTSim {
   using namespace std;
   using namespace MetaSim;
 
+  class Resource;
   class Task;
   class WaitInstr;
   class SignalInstr;
@@ -30,7 +31,7 @@ namespace RTSim {
   protected:
     WaitInstr * wi;
   public:
-    WaitEvt(Task* t, WaitInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3), wi(in)
+    WaitEvt(Task* t, WaitInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY - 3, WAIT_EVT), wi(in)
     {}
     WaitInstr *getInstr() {return wi;} 
     virtual void doit() {}
@@ -46,7 +47,7 @@ namespace RTSim {
   protected:
     SignalInstr *si;
   public:
-    SignalEvt(Task* t, SignalInstr* in) :TaskEvt(t), si(in) {} 
+    SignalEvt(Task* t, SignalInstr* in) :TaskEvt(t, _DEFAULT_PRIORITY, SIGNAL_EVT), si(in) {} 
     virtual void doit() {}
     SignalInstr *getInstr() {return si;}
   };
@@ -61,6 +62,8 @@ namespace RTSim {
 
   class WaitInstr : public Instr {
     string _res;
+    /// the resource called _res, resolved at the first execution
+    Resource *_resource;
     EndInstrEvt _endEvt; 
     WaitEvt _waitEvt;
     int _numberOfRes;
@@ -111,6 +114,8 @@ namespace RTSim {
 
   class SignalInstr : public Instr {
     string _res;
+    /// the resource called _res, resolved at the first execution
+    Resource *_resource;
     EndInstrEvt _endEvt;
     SignalEvt _signalEvt;
  
@@ -1,8 +1,22 @@
 #include "catch.hpp"
+#include <cmath>
 #include <rttask.hpp>
 #include <cbserver.hpp>
 #include <kernel.hpp>
+#include <mrtkernel.hpp>
 #include <edfsched.hpp>
+#include <schedpoints.hpp>
+#include <schedrta.hpp>
+#include <fpsched.hpp>
+#include <grubserver.hpp>
+#include <pollingserver.hpp>
+#include <queuestat.hpp>
+#include <sporadicserver.hpp>
+#include <supervisor.hpp>
+#include <linearfeedback.hpp>
+#include <aperiodic.hpp>
+#include <taskstat.hpp>
+#include <vector>
 
 using namespace MetaSim;
 using namespace RTSim;
@@ -194,3 +208,523 @@ TEST_CASE("Task with suspension")
 	SIMUL.endSingleRun();
     }
 }
+
+TEST_CASE("RTA budget search")
+{
+    CBServer serv1(2, 5, 5, true, "rta1", "FIFOSched");
+    CBServer serv2(3, 10, 10, true, "rta2", "FIFOSched");
+    CBServer serv3(1, 20, 20, true, "rta3", "FIFOSched");
+
+    SchedRTA rta("rta");
+    rta.addServer(&serv3);
+    rta.addServer(&serv1);
+    rta.addServer(&serv2);
+
+    // the largest budget is searched starting from the
+    // response times of the previous (smaller) budgets
+    REQUIRE(rta.changeBudget(&serv3, 10) == 5);
+    REQUIRE(serv3.getBudget() == 6);
+    REQUIRE(rta.computeResponseTime(2) == 20);
+    REQUIRE(rta.changeBudget(&serv1, 1) == 0);
+
+    REQUIRE(rta.changeBudget(&serv3, -3) == -3);
+    REQUIRE(rta.computeResponseTime(2) == 10);
+    REQUIRE(rta.changeBudget(&serv2, 1) == 1);
+    REQUIRE(rta.computeResponseTime(2) == 19);
+    REQUIRE(rta.changeBudget(&serv1, 1) == 0);
+}
+
+TEST_CASE("Memo of the admission tests")
+{
+    CBServer serv1(2, 5, 5, true, "memo1", "FIFOSched");
+    CBServer serv2(3, 10, 10, true, "memo2", "FIFOSched");
+    CBServer serv3(1, 20, 20, true, "memo3", "FIFOSched");
+
+    SchedRTA rta("memo_rta");
+    rta.addServer(&serv3);
+    rta.addServer(&serv1);
+    rta.addServer(&serv2);
+
+    // the same budgets come back: the search is not repeated
+    REQUIRE(rta.changeBudget(&serv3, 10) == 5);
+    REQUIRE(rta.changeBudget(&serv3, -5) == -5);
+    REQUIRE(rta.getMemo().getHits() == 0);
+    REQUIRE(rta.changeBudget(&serv3, 10) == 5);
+    REQUIRE(rta.getMemo().getHits() == 1);
+    REQUIRE(serv3.getBudget() == 6);
+    REQUIRE(rta.changeBudget(&serv1, 1) == 0);
+
+    CBServer serv4(2, 10, 10, true, "memo4", "FIFOSched");
+    CBServer serv5(3, 20, 20, true, "memo5", "FIFOSched");
+    SchedPoint sp("memo_sp");
+    sp.addServer(&serv4);
+    sp.addServer(&serv5);
+    sp.buildconstraints();
+
+    Tick granted = sp.changeBudget(&serv5, 100);
+    REQUIRE(granted > 0);
+    REQUIRE(granted < 100);
+    REQUIRE(sp.changeBudget(&serv5, -granted) == -granted);
+    REQUIRE(sp.changeBudget(&serv5, 100) == granted);
+    REQUIRE(sp.getMemo().getHits() == 1);
+
+    // a bounded memo keeps the latest results
+    sp.getMemo().setCapacity(1);
+    REQUIRE(sp.changeBudget(&serv5, -granted) == -granted);
+    REQUIRE(sp.changeBudget(&serv4, 1) == 1);
+    REQUIRE(sp.changeBudget(&serv5, 100) < granted);
+    REQUIRE(sp.getMemo().size() == 1);
+}
+
+TEST_CASE("Budget changes at the same time")
+{
+    CBServer serv1(2, 10, 10, true, "bc1", "FIFOSched");
+    CBServer serv2(3, 10, 10, true, "bc2", "FIFOSched");
+    BudgetChangeEvt evt;
+
+    SIMUL.initSingleRun();
+    evt.add(&serv1, 4, 5);
+    evt.add(&serv2, 5, 5);
+    evt.add(&serv1, 3, 5);
+    evt.add(&serv2, 1, 2);
+
+    SIMUL.run_to(2);
+    REQUIRE(serv2.getBudget() == 1);
+    REQUIRE(serv1.getBudget() == 2);
+    REQUIRE(evt.isInQueue());
+    SIMUL.run_to(5);
+    REQUIRE(serv1.getBudget() == 3);
+    REQUIRE(serv2.getBudget() == 5);
+    REQUIRE(!evt.isInQueue());
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Sporadic server replenishments")
+{
+    PeriodicTask t1(20, 20, 0, "TaskA");
+    t1.insertCode("fixed(3);");
+    t1.setAbort(false);
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    SporadicServer serv(2, 10, "server");
+    serv.addTask(t1);
+    kern.addTask(serv, "1");
+
+    SIMUL.initSingleRun();
+
+    // the budget is exhausted at 2, and replenished at 10
+    SIMUL.run_to(2);
+    REQUIRE(t1.getExecTime() == 2);
+    REQUIRE(serv.getStatus() == RECHARGING);
+    SIMUL.run_to(10);
+    REQUIRE(t1.getExecTime() == 2);
+    SIMUL.run_to(11);
+    REQUIRE(t1.getExecTime() == 3);
+
+    // 1 unit consumed at 10 comes back at 20, with the new
+    // instance: the same pattern repeats
+    SIMUL.run_to(22);
+    REQUIRE(t1.getExecTime() == 2);
+    REQUIRE(serv.getStatus() == RECHARGING);
+    SIMUL.run_to(31);
+    REQUIRE(t1.getExecTime() == 3);
+    SIMUL.run_to(42);
+    REQUIRE(t1.getExecTime() == 2);
+    REQUIRE(serv.getStatus() == RECHARGING);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Polling server without idle periods")
+{
+    PeriodicTask t1(50, 50, 0, "TaskA");
+    t1.insertCode("fixed(1);");
+    PeriodicTask t2(50, 50, 5, "TaskB");
+    t2.insertCode("fixed(1);");
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PollingServer serv(2, 10, "server");
+    serv.addTask(t1);
+    serv.addTask(t2);
+    kern.addTask(serv, "1");
+
+    SIMUL.initSingleRun();
+
+    // the budget is lost at 1, until the end of the period
+    SIMUL.run_to(9);
+    REQUIRE(t1.getExecTime() == 1);
+    REQUIRE(t2.getExecTime() == 0);
+    SIMUL.run_to(11);
+    REQUIRE(t2.getExecTime() == 1);
+
+    // no event between the periods with no work
+    SIMUL.run_to(12);
+    Tick next = Event::getFirst()->getTime();
+    REQUIRE(next == 50);
+
+    // a new period at 50; TaskB arrives at 55, after the
+    // budget has been lost, and waits for the end of the period
+    SIMUL.run_to(51);
+    REQUIRE(t1.getExecTime() == 1);
+    REQUIRE(serv.getStatus() == RECHARGING);
+    SIMUL.run_to(60);
+    REQUIRE(t2.getExecTime() == 0);
+    SIMUL.run_to(61);
+    REQUIRE(t2.getExecTime() == 1);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("GRUB reclaiming")
+{
+    PeriodicTask t1(10, 10, 0, "TaskA");
+    t1.insertCode("fixed(4);");
+    t1.setAbort(false);
+    PeriodicTask t2(15, 15, 3, "TaskB");
+    t2.insertCode("fixed(6);");
+    t2.setAbort(false);
+
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+    GrubSupervisor sup;
+
+    Grub g1(3, 10, "grub1");
+    g1.addTask(t1);
+    Grub g2(4, 15, "grub2");
+    g2.addTask(t2);
+    sup.addGrub(&g1);
+    sup.addGrub(&g2);
+    kern.addTask(g1);
+    kern.addTask(g2);
+
+    SIMUL.initSingleRun();
+
+    // grub1 alone consumes its budget at rate U^act = 0.3, so
+    // TaskA completes its 4 units on a budget of 3
+    SIMUL.run_to(4);
+    REQUIRE(t1.getExecTime() == 4);
+    REQUIRE(g2.getStatus() == EXECUTING);
+
+    SIMUL.run_to(10);
+    REQUIRE(t2.getExecTime() == 6);
+    SIMUL.run_to(14);
+    REQUIRE(t1.getExecTime() == 4);
+    REQUIRE(g1.getStatus() == IDLE);
+    REQUIRE(g2.getStatus() == IDLE);
+
+    // the rate of grub2 changes while it executes
+    SIMUL.run_to(24);
+    REQUIRE(t1.getExecTime() == 4);
+    REQUIRE(t2.getExecTime() == 2);
+    REQUIRE(g1.getStatus() == RELEASING);
+    REQUIRE(g2.getStatus() == EXECUTING);
+    SIMUL.run_to(28);
+    REQUIRE(t2.getExecTime() == 6);
+
+    SIMUL.endSingleRun();
+}
+
+namespace {
+    // grants every change, and counts the calls
+    class CountingSupervisor : public Supervisor {
+    public:
+        int single, batched;
+        CountingSupervisor() : single(0), batched(0) {}
+        Tick changeBudget(Server *s, Tick delta)
+        {
+            ++single;
+            s->changeBudget(s->getBudget() + delta);
+            return delta;
+        }
+        void changeBudgets(const std::vector<Server *> &s, std::vector<Tick> &delta)
+        {
+            ++batched;
+            Supervisor::changeBudgets(s, delta);
+        }
+        void addServer(Server *) {}
+    };
+}
+
+TEST_CASE("Linear controller coefficients")
+{
+    LinearController c("a=1 b=0.5,-0.25 target=-0.1 min=0.1 max=0.6");
+    REQUIRE(c.getOrder() == 1);
+    double e[] = {0.2, 0.4, 0, 0, 0};
+    double u[] = {0.3, 0, 0, 0};
+    REQUIRE((fabs(c.output(e, u) - 0.3) < 1e-12));
+    REQUIRE(c.clip(0.9) == 0.6);
+    REQUIRE(c.clip(0) == 0.1);
+
+    REQUIRE_THROWS_AS(LinearController("a=1,1,1,1,1"), const LinearController::Exc&);
+    REQUIRE_THROWS_AS(LinearController("k=1"), const LinearController::Exc&);
+    REQUIRE_THROWS_AS(LinearController("b=x"), const LinearController::Exc&);
+    REQUIRE_THROWS_AS(LinearController("min=0.5 max=0.2"), const LinearController::Exc&);
+}
+
+TEST_CASE("Budget requests of the same tick")
+{
+    PeriodicTask t1(10, 10, 0, "fbTask1");
+    t1.insertCode("fixed(4);");
+    t1.setAbort(false);
+    PeriodicTask t2(10, 10, 0, "fbTask2");
+    t2.insertCode("fixed(4);");
+    t2.setAbort(false);
+
+    EDFScheduler sched1, sched2;
+    RTKernel kern1(&sched1), kern2(&sched2);
+
+    CBServer serv1(2, 10, 10, true, "fbServ1", "FIFOSched");
+    serv1.addTask(t1);
+    kern1.addTask(serv1, "");
+    CBServer serv2(2, 10, 10, true, "fbServ2", "FIFOSched");
+    serv2.addTask(t2);
+    kern2.addTask(serv2, "");
+
+    // both modules share the same coefficients
+    LinearController ctrl("a=1 b=1 min=0.1 max=0.8");
+    CountingSupervisor sup;
+    BudgetBatch batch(&sup, "fbBatch");
+    LinearFeedbackModule fm1("fbModule1", ctrl), fm2("fbModule2", ctrl);
+    fm1.setTask(&t1);
+    fm1.setBatch(&batch, &serv1);
+    t1.setFeedbackModule(&fm1);
+    fm2.setTask(&t2);
+    fm2.setBatch(&batch, &serv2);
+    t2.setFeedbackModule(&fm2);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(40);
+
+    // the jobs end at the same ticks: one call for both servers
+    REQUIRE(sup.batched > 0);
+    REQUIRE(sup.single == 2 * sup.batched);
+    REQUIRE(batch.getCalls() == sup.batched);
+    REQUIRE(batch.getPending() == 0);
+    REQUIRE(fm1.getRequiredBandwidth() == fm2.getRequiredBandwidth());
+    REQUIRE(fm1.getRequiredBandwidth() > 0.2);
+    REQUIRE(serv1.getBudget() == fm1.getGrantedBudget());
+    REQUIRE(serv1.getBudget() == serv2.getBudget());
+    REQUIRE(serv1.getBudget() >= 4);
+
+    SIMUL.endSingleRun();
+}
+
+namespace {
+    // the state of a soft CBS model at a few instants, with or
+    // without coalescing
+    std::vector<double> runSoftCBS(bool coalesce)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+
+        PeriodicTask t1(100, 100, 0, "TaskA");
+        t1.insertCode("fixed(23);");
+        PeriodicTask t2(200, 200, 0, "TaskB");
+        t2.insertCode("fixed(10);");
+        PeriodicTask t3(45, 45, 30, "TaskC");
+        t3.insertCode("fixed(4);");
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        CBServer serv(2, 7, 7, false, "server", "FIFOSched");
+        serv.setCoalescing(coalesce);
+        serv.addTask(t1);
+        kern.addTask(serv);
+        kern.addTask(t2);
+        kern.addTask(t3);
+
+        FinishingTimeStat<StatMax> ft("t1 response");
+        ft.attachToTask(&t1);
+        FinishingTimeStat<StatMean> mean("t1 mean response");
+        mean.attachToTask(&t1);
+
+        std::vector<double> res;
+        SIMUL.initSingleRun();
+
+        // the server exhausts its budget every 2 ticks up to the
+        // end of the job at 23: coalesced, its deadline at 10 is
+        // already the one of tick 20
+        SIMUL.run_to(10);
+        res.push_back(double(serv.getDeadline()));
+
+        // between the jobs of TaskA, nothing tells the two apart
+        for (Tick t = 99; t < 2000; t += 100) {
+            SIMUL.run_to(t);
+            res.push_back(t1.isActive());
+            res.push_back(double(serv.getDeadline()));
+            res.push_back(serv.getVirtualTime());
+            res.push_back(double(t1.getCounters().executed));
+            res.push_back(t1.getCounters().preemptions);
+            res.push_back(double(t3.getCounters().executed));
+            res.push_back(t3.getCounters().preemptions);
+        }
+        res.push_back(ft.getValue());
+        res.push_back(mean.getValue());
+        SIMUL.endSingleRun();
+        return res;
+    }
+}
+
+TEST_CASE("CBS coalesced postponements")
+{
+    std::vector<double> step = runSoftCBS(false);
+    std::vector<double> coal = runSoftCBS(true);
+
+    REQUIRE(step[0] == 42);
+    REQUIRE(coal[0] == 77);
+    REQUIRE(step.size() == coal.size());
+    for (size_t i = 1; i < step.size(); ++i) REQUIRE(step[i] == coal[i]);
+}
+
+TEST_CASE("Aperiodic source in a server")
+{
+    SimContext ctx;
+    SimContext::Scope s(&ctx);
+
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    // a request every 10 ticks, costing 3: each one is served at once
+    CBServer serv1(4, 10, 10, false, "ap1", "FIFOSched");
+    AperiodicSource src1(new DeltaVar(10), new DeltaVar(3), 0, "src1");
+    serv1.addTask(src1);
+    kern.addTask(serv1);
+
+    // three requests, at 0, 1 and 2, costing 3, replayed by two
+    // sources, the first one with a queue of one request
+    std::vector<WorkloadTrace::Job> jobs;
+    for (int i = 0; i < 3; ++i) {
+        WorkloadTrace::Job j = { 1, Tick(i), Tick(3) };
+        jobs.push_back(j);
+    }
+    WorkloadTrace::save(jobs, "aperiodic.bin");
+    WorkloadTrace w("aperiodic.bin");
+    CBServer serv2(4, 50, 50, false, "ap2", "FIFOSched");
+    AperiodicSource src2(w, 1, 0, "src2", 1);
+    serv2.addTask(src2);
+    kern.addTask(serv2);
+    CBServer serv3(4, 200, 200, false, "ap3", "FIFOSched");
+    AperiodicSource src3(w, 1, 0, "src3");
+    serv3.addTask(src3);
+    kern.addTask(serv3);
+
+    FinishingTimeStat<StatMax> ft1("src1 response");
+    ft1.attachToTask(&src1);
+    FinishingTimeStat<StatMax> ft2("src2 response");
+    ft2.attachToTask(&src2);
+    FinishingTimeStat<StatMean> ft3("src3 response");
+    ft3.attachToTask(&src3);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(1000);
+    REQUIRE(ft1.getValue() == 3);
+    REQUIRE(src1.getPending() == 0);
+
+    // src2 serves the requests at 0 (from 0 to 3) and 1 (from 3 to
+    // 6), and loses the one at 2
+    REQUIRE(src2.getLostRequests() == 1);
+    REQUIRE(ft2.getValue() == 5);
+
+    // src3 serves the three of them, from 6 to 9, 9 to 10 and 13
+    // to 15 (src1 runs from 10 to 13), and 15 to 18
+    REQUIRE(src3.getLostRequests() == 0);
+    REQUIRE(ft3.getValue() == 13);
+    REQUIRE(!src2.isActive());
+    REQUIRE(!src3.isActive());
+    SIMUL.endSingleRun();
+    remove("aperiodic.bin");
+}
+
+TEST_CASE("Server backlog")
+{
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(15, 15, 0, "backlog 1");
+    t1.insertCode("fixed(2);");
+    PeriodicTask t2(15, 15, 0, "backlog 2");
+    t2.insertCode("fixed(2);");
+    CBServer serv(5, 15, 15, true, "backlog", "FIFOSched");
+    serv.addTask(t1);
+    serv.addTask(t2);
+    kern.addTask(serv);
+
+    BacklogStat backlog("backlog");
+    backlog.attachToServer(&serv);
+    ReadyQueueStat ready("ready");
+    ready.attachToKernel(&kern);
+
+    // two tasks in 0-2, one in 2-4
+    SIMUL.initSingleRun();
+    SIMUL.run_to(15);
+    SIMUL.endSingleRun();
+
+    REQUIRE(backlog.getValue() == Approx(6 / 15.0));
+    REQUIRE(ready.getValue() == Approx(4 / 15.0));
+}
+
+namespace {
+    // the schedule and deschedule events of the tasks, in order
+    class OrderTrace : public Trace {
+    public:
+        std::vector<std::string> log;
+
+        OrderTrace() : Trace("order", Trace::BINARY, false), log() {}
+
+        void record(Event *e) {
+            if (dynamic_cast<SchedEvt *>(e))
+                log.push_back(static_cast<TaskEvt *>(e)->getTask()->getName() + " scheduled");
+            else if (dynamic_cast<DeschedEvt *>(e))
+                log.push_back(static_cast<TaskEvt *>(e)->getTask()->getName() + " descheduled");
+        }
+    };
+}
+
+namespace {
+    // T0 preempts the task of a hard CBS at 10: returns what the
+    // trace sees at that instant
+    std::vector<std::string> preemptServer(RTKernel &kern)
+    {
+        PeriodicTask t0(100, 5, 10, "T0");
+        t0.insertCode("fixed(2);");
+        PeriodicTask t2(40, 40, 0, "T2");
+        t2.insertCode("fixed(15);");
+
+        CBServer serv(12, 20, 20, true, "server", "FIFOSched");
+        serv.addTask(t2);
+
+        kern.addTask(t0);
+        kern.addTask(serv);
+
+        OrderTrace order;
+        t0.setTrace(&order);
+        t2.setTrace(&order);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(9);
+        order.log.clear();
+        SIMUL.run_to(10);
+        SIMUL.endSingleRun();
+        return order.log;
+    }
+}
+
+TEST_CASE("Preemption of a server task")
+{
+    // the task of the server leaves the processor first
+    std::vector<std::string> expected{"T2 descheduled", "T0 scheduled"};
+    {
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        REQUIRE(preemptServer(kern) == expected);
+    }
+    {
+        EDFScheduler sched;
+        MRTKernel kern(&sched, 1);
+        REQUIRE(preemptServer(kern) == expected);
+    }
+}
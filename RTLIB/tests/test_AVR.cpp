@@ -8,6 +8,7 @@ email                : simoncelli.stefano@hotmail.it
 #include <metasim.hpp>
 #include <factory.hpp>
 #include <AVRTask.hpp>
+#include <avrdriver.hpp>
 #include <kernel.hpp>
 #include <fpsched.hpp>
 #include <edfsched.hpp>
@@ -244,7 +245,7 @@ TEST_CASE("AVRTask createInstance from factory")
 				string("2000,4000,6000"),
 				string("500,1500,3500")};
 
-	auto_ptr<Task> curr = genericFactory<Task>::instance().create("AVRTask",params);
+	unique_ptr<Task> curr = genericFactory<Task>::instance().create("AVRTask",params);
 	AVRTask *t1 = (AVRTask*)curr.release();
 
 	REQUIRE(t1->getAngularPhase() == 0);
@@ -280,3 +281,66 @@ TEST_CASE("AVRTask createInstance from factory")
 
 
 }
+
+TEST_CASE("AVRTask getMode")
+{
+	AVRTask t1(M_PI, 0, M_PI / 4,
+		vector<string>{string("fixed(10);"), string("fixed(6);"), string("fixed(3);") },
+		vector<double>{2000, 4000, 6000},
+		vector<double>{500, 1500, 3500},
+		"AVRtask1");
+
+	const double rpm = 2 * M_PI / 60;
+
+	REQUIRE(t1.getMode(1000 * rpm) == 0);
+	REQUIRE(t1.getMode(3000 * rpm) == 1);
+	REQUIRE(t1.getMode(5000 * rpm) == 2);
+	REQUIRE_THROWS_AS(t1.getMode(7000 * rpm), const ModeOutOfIndex&);
+
+	// hysteresis: the current mode is kept inside its own range
+	REQUIRE(t1.getMode(1800 * rpm, 1) == 1);
+	REQUIRE(t1.getMode(1000 * rpm, 1) == 0);
+	REQUIRE(t1.getMode(3800 * rpm, 2) == 2);
+	REQUIRE(t1.getMode(3000 * rpm, 2) == 1);
+	REQUIRE(t1.getMode(400 * rpm, 2) == 0);
+
+	vector<double> profile{1000 * rpm, 2500 * rpm, 1800 * rpm, 1200 * rpm, 5000 * rpm};
+	vector<int> modes;
+	t1.getModes(profile, modes, 0);
+	REQUIRE(modes == (vector<int>{0, 1, 1, 0, 2}));
+
+	REQUIRE_THROWS_AS(AVRTask(M_PI, 0, M_PI / 4,
+		vector<string>{string("fixed(10);"), string("fixed(6);") },
+		vector<double>{4000, 2000},
+		vector<double>{500, 1500},
+		"AVRtask2"), const WrongParameterSize&);
+}
+
+TEST_CASE("AVRDriver activations along a speed profile")
+{
+	EDFScheduler sched;
+	RTKernel kern(&sched);
+
+	AVRTask t1(M_PI, 0, M_PI / 4,
+		vector<string>{string("fixed(2);"), string("fixed(1);"), string("fixed(1);") },
+		vector<double>{2000, 4000, 6000},
+		vector<double>{500, 1500, 3500},
+		"AVRtask1");
+	kern.addTask(t1);
+
+	// one tick per millisecond: 3000 rpm gives a job every 10 ticks,
+	// 1000 rpm every 30 ticks
+	AVRDriver drv(&t1, 1000, "driver");
+	drv.setProfile(vector<Tick>{0, 30, 90}, vector<double>{3000, 1000, 1000});
+	drv.precompute();
+
+	REQUIRE(drv.getActivationTimes() == (vector<Tick>{0, 10, 20, 30, 60}));
+	REQUIRE(drv.getActivationModes() == (vector<int>{1, 1, 1, 0, 0}));
+	REQUIRE(drv.getActivationDeadlines() == (vector<Tick>{2, 2, 2, 7, 7}));
+
+	SIMUL.initSingleRun();
+	SIMUL.run_to(61);
+	REQUIRE(t1.getExecTime() == 1);
+	REQUIRE(t1.getDeadline() == 67);
+	SIMUL.endSingleRun();
+}
@@ -0,0 +1,325 @@
+#include "catch.hpp"
+#include <schedanalysis.hpp>
+#include <schedqpa.hpp>
+#include <cbserver.hpp>
+#include <load.hpp>
+#include <edfsched.hpp>
+#include <kernel.hpp>
+#include <rttask.hpp>
+#include <sensitivity.hpp>
+#include <arena.hpp>
+#include <fpsched.hpp>
+#include <lighttask.hpp>
+#include <partitioner.hpp>
+
+using namespace MetaSim;
+using namespace RTSim;
+
+TEST_CASE("Schedulability analysis of a batch of task sets")
+{
+    TaskSetBatch batch;
+    for (int k = 0; k < 100; ++k) {
+        // schedulable by both FP and EDF
+        batch.addTask(1, 4, 4);
+        batch.addTask(2, 6, 6);
+        batch.addTask(3, 12, 12);
+        batch.endSet();
+        // full utilization: only EDF
+        batch.addTask(2, 4, 4);
+        batch.addTask(3, 6, 6);
+        batch.endSet();
+        // constrained deadlines: none
+        batch.addTask(2, 4, 3);
+        batch.addTask(3, 6, 4);
+        batch.endSet();
+    }
+    REQUIRE(batch.size() == 300);
+    REQUIRE(batch.getSize(0) == 3);
+    REQUIRE(analysis::responseTime(batch.getC(0), batch.getT(0), 2, 12) == 10);
+
+    std::vector<char> rta, sp, qpa;
+    batch.analyze(TaskSetBatch::RTA, rta, 4);
+    batch.analyze(TaskSetBatch::SCHED_POINTS, sp, 3);
+    batch.analyze(TaskSetBatch::QPA, qpa, 1);
+    REQUIRE(rta.size() == 300);
+
+    bool ok = true;
+    for (size_t k = 0; k < batch.size(); ++k) {
+        ok = ok && rta[k] == (k % 3 == 0);
+        ok = ok && sp[k] == rta[k];
+        ok = ok && qpa[k] == (k % 3 != 2);
+    }
+    REQUIRE(ok);
+}
+
+namespace {
+    // a device that runs the sets as blocks of a kernel would,
+    // on the raw arrays
+    class HostDevice : public AnalysisDevice {
+    public:
+        bool present, fits;
+        int calls;
+
+        HostDevice() : present(true), fits(true), calls(0) {}
+
+        const char *getName() const { return "host"; }
+        bool available() const { return present; }
+
+        bool analyze(const TaskSetBatch &batch, int test, std::vector<char> &res)
+        {
+            ++calls;
+            if (!fits) return false;
+            const std::vector<size_t> &first = batch.getFirst();
+            const Tick *c = batch.getC(0), *t = batch.getT(0), *d = batch.getD(0);
+            for (size_t k = 0; k + 1 < first.size(); ++k) {
+                size_t f = first[k];
+                int n = first[k + 1] - f;
+                res[k] = test == TaskSetBatch::QPA ?
+                    analysis::qpaTest(c + f, t + f, d + f, n) :
+                    analysis::rtaTest(c + f, t + f, d + f, n);
+            }
+            return true;
+        }
+    };
+}
+
+TEST_CASE("Batch analysis on a device")
+{
+    TaskSetBatch batch;
+    for (int k = 0; k < 50; ++k) {
+        batch.addTask(1, 4, 4);
+        batch.addTask(2, 6, 6);
+        batch.endSet();
+        batch.addTask(2, 4, 3);
+        batch.addTask(3, 6, 4);
+        batch.endSet();
+    }
+    std::vector<char> cpu, dev;
+    batch.analyze(TaskSetBatch::RTA, cpu, 2);
+
+    HostDevice d;
+    batch.setDevice(&d);
+    batch.analyze(TaskSetBatch::RTA, dev, 2);
+    REQUIRE(d.calls == 1);
+    REQUIRE(dev == cpu);
+
+    // no device, or a batch too large for it: the processors
+    d.present = false;
+    batch.analyze(TaskSetBatch::QPA, dev, 2);
+    REQUIRE(d.calls == 1);
+    d.present = true;
+    d.fits = false;
+    dev.clear();
+    batch.analyze(TaskSetBatch::RTA, dev, 2);
+    REQUIRE(d.calls == 2);
+    REQUIRE(dev == cpu);
+
+    batch.setDevice(NULL);
+    batch.analyze(TaskSetBatch::RTA, dev, 2);
+    REQUIRE(d.calls == 2);
+}
+
+TEST_CASE("EDF admission by processor demand")
+{
+    CBServer serv1(2, 10, 10, true, "qpa1", "FIFOSched");
+    CBServer serv2(3, 15, 15, true, "qpa2", "FIFOSched");
+
+    SchedQPA qpa("qpa");
+    qpa.addServer(&serv1);
+    qpa.addServer(&serv2);
+    REQUIRE(qpa.isSchedulable());
+
+    SIMUL.initSingleRun();
+    REQUIRE(qpa.changeBudget(&serv1, 10) == 6);
+    REQUIRE(serv1.getBudget() == 8);
+    REQUIRE(qpa.isSchedulable());
+    REQUIRE(qpa.changeBudget(&serv2, 1) == 0);
+    REQUIRE(qpa.changeBudget(&serv1, -2) == -2);
+    REQUIRE(qpa.changeBudget(&serv2, 5) == 3);
+    REQUIRE(qpa.isSchedulable());
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("UUniFast task set generation")
+{
+    UUniFastGen gen(5, 0.8, 10, 1000, 1, 0.5);
+    RandomGen g(12345);
+
+    double u[5];
+    Tick c[5], t[5];
+    REQUIRE(gen.generate(g, u, c, t));
+    double sum = 0;
+    for (int i = 0; i < 5; ++i) {
+        REQUIRE(u[i] <= 0.5);
+        REQUIRE(t[i] >= 10);
+        REQUIRE(t[i] <= 1000);
+        REQUIRE(c[i] >= 1);
+        sum += u[i];
+    }
+    REQUIRE(sum == Approx(0.8));
+
+    // the same sets, whatever the number of threads
+    TaskSetBatch b1, b4;
+    gen.generate(b1, 3000, g, 1);
+    gen.generate(b4, 3000, g, 4);
+    REQUIRE(b1.size() == 3000);
+    REQUIRE(b4.size() == 3000);
+    bool same = true;
+    for (size_t k = 0; k < b1.size(); ++k)
+        for (int i = 0; i < 5; ++i)
+            same = same && b1.getC(k)[i] == b4.getC(k)[i] && 
+                b1.getT(k)[i] == b4.getT(k)[i] && b1.getD(k)[i] == b4.getT(k)[i];
+    REQUIRE(same);
+}
+
+TEST_CASE("WCET sensitivity by simulation")
+{
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    // U = 0.8: EDF schedules the WCETs scaled up to 1.25
+    PeriodicTask t1(100, 100, 0, "task 1");
+    t1.insertCode("fixed(40);");
+    PeriodicTask t2(200, 200, 0, "task 2");
+    t2.insertCode("fixed(40);fixed(40);");
+    kern.addTask(t1);
+    kern.addTask(t2);
+
+    WCETSensitivity s(400);
+    s.addTask(&t1);
+    s.addTask(&t2);
+
+    REQUIRE(s.isSchedulable(1.25));
+    REQUIRE(!s.isSchedulable(2));
+    // the run stopped at the first miss
+    REQUIRE(s.getMissTime() == 200);
+    REQUIRE(s.getSimulatedTime() < 2 * 400);
+
+    double f = s.search(1, 4, 0.01);
+    REQUIRE(f >= 1.24);
+    REQUIRE(f <= 1.25);
+
+    // the costs are back to the original ones
+    SIMUL.initSingleRun();
+    SIMUL.run_to(50);
+    REQUIRE(t1.getExecTime() == 40);
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Partitioning tasks on processors")
+{
+    // utilizations 0.6, 0.5, 0.4, 0.3, 0.2 (in this order)
+    Tick C[] = {6, 5, 4, 3, 2};
+
+    Partitioner ff(3, Partitioner::FIRST_FIT);
+    Partitioner bf(3, Partitioner::BEST_FIT);
+    Partitioner wf(3, Partitioner::WORST_FIT);
+    for (int i = 4; i >= 0; --i) {
+        ff.addTask(C[i], 10);
+        bf.addTask(C[i], 10);
+        wf.addTask(C[i], 10);
+    }
+    REQUIRE(ff.partition() == 0);
+    REQUIRE(bf.partition() == 0);
+    REQUIRE(wf.partition() == 0);
+
+    // first fit: {0.6, 0.4}, {0.5, 0.3, 0.2}
+    REQUIRE(ff.getCPU(4) == 0);
+    REQUIRE(ff.getCPU(2) == 0);
+    REQUIRE(ff.getCPU(3) == 1);
+    REQUIRE(ff.getCPU(1) == 1);
+    REQUIRE(ff.getCPU(0) == 1);
+    REQUIRE(ff.getTasks(2).empty());
+
+    // best fit: the 0.2 fills the processor of the 0.5 and the 0.3
+    REQUIRE(bf.getCPU(0) == bf.getCPU(3));
+    REQUIRE((bf.getUtilization(bf.getCPU(0)) == Approx(1.0)));
+
+    // worst fit: {0.6}, {0.5, 0.2}, {0.4, 0.3}
+    REQUIRE(wf.getTasks(wf.getCPU(4)).size() == 1);
+    REQUIRE(wf.getCPU(1) == wf.getCPU(2));
+    REQUIRE(wf.getCPU(0) == wf.getCPU(3));
+
+    // too much for one processor
+    Partitioner one(1);
+    one.addTask(6, 10);
+    one.addTask(5, 10);
+    REQUIRE(one.partition() == 1);
+    REQUIRE(one.getCPU(0) == 0);
+    REQUIRE(one.getCPU(1) == -1);
+
+    REQUIRE_THROWS_AS(Partitioner(0), const Partitioner::Exc&);
+    REQUIRE_THROWS_AS(one.addTask(5, 10, 20), const Partitioner::Exc&);
+}
+
+TEST_CASE("Partitioning with exact admission tests")
+{
+    // every processor must pass the exact test, and the exact
+    // tests place at least as many tasks as the density test
+    const int N = 40, M = 4;
+    std::vector<Tick> C, T, D;
+    Partitioner util(M, Partitioner::FIRST_FIT, Partitioner::EDF_UTIL);
+    Partitioner qpa(M, Partitioner::BEST_FIT, Partitioner::QPA);
+    Partitioner rta(M, Partitioner::WORST_FIT, Partitioner::RTA);
+    unsigned long s = 12345;
+    for (int i = 0; i < N; ++i) {
+        s = s * 1103515245 + 12345;
+        Tick t = 10 + int((s >> 8) % 90);
+        s = s * 1103515245 + 12345;
+        Tick c = 1 + int((s >> 8) % (int(t) / 3));
+        Tick d = c + (t - c) * 3 / 4;
+        C.push_back(c);
+        T.push_back(t);
+        D.push_back(d);
+        util.addTask(c, t, d);
+        qpa.addTask(c, t, d);
+        rta.addTask(c, t, d);
+    }
+    size_t mu = util.partition(), mq = qpa.partition(), mr = rta.partition();
+    REQUIRE(mu > 0);
+    REQUIRE(mq <= mu);
+    REQUIRE(mr < size_t(N));
+
+    for (int k = 0; k < M; ++k) {
+        std::vector<Tick> c, t, d;
+        const std::vector<int> &v = rta.getTasks(k);
+        for (size_t j = 0; j < v.size(); ++j) {
+            REQUIRE(rta.getCPU(v[j]) == k);
+            c.push_back(C[v[j]]);
+            t.push_back(T[v[j]]);
+            d.push_back(D[v[j]]);
+        }
+        // in priority order
+        REQUIRE(analysis::rtaTest(&c[0], &t[0], &d[0], int(c.size())));
+
+        c.clear(); t.clear(); d.clear();
+        const std::vector<int> &w = qpa.getTasks(k);
+        for (size_t j = 0; j < w.size(); ++j) {
+            c.push_back(C[w[j]]);
+            t.push_back(T[w[j]]);
+            d.push_back(D[w[j]]);
+        }
+        REQUIRE(analysis::qpaTest(&c[0], &t[0], &d[0], int(c.size())));
+    }
+
+    // the model: one kernel per processor
+    std::vector<LightTaskSet *> sets;
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        std::vector<FPScheduler> fp(M);
+        std::vector<RTKernel *> kern;
+        for (int k = 0; k < M; ++k) kern.push_back(ctx.arena().create<RTKernel>(&fp[k]));
+        rta.build(kern, sets, "part");
+        REQUIRE(sets.size() == size_t(M));
+        size_t placed = 0;
+        for (int k = 0; k < M; ++k) {
+            REQUIRE(sets[k]->size() == rta.getTasks(k).size());
+            placed += sets[k]->size();
+        }
+        REQUIRE((placed + mr == size_t(N)));
+        REQUIRE(Entity::_find("part0_0") != NULL);
+        REQUIRE_THROWS_AS(rta.build(std::vector<RTKernel *>(1), sets), const Partitioner::Exc&);
+        ctx.arena().release();
+    }
+}
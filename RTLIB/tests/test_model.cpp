@@ -0,0 +1,252 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <metasim.hpp>
+#include <kernel.hpp>
+#include <lighttask.hpp>
+#include <modelfile.hpp>
+#include <mrtkernel.hpp>
+#include <rttask.hpp>
+#include <rtsimc.h>
+#include <server.hpp>
+
+using namespace MetaSim;
+using namespace RTSim;
+using namespace std;
+
+TEST_CASE("Model file")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    string text =
+        "# a kernel with a server and a resource\n"
+        "kernel k sched=EDFSched resman=pi\n"
+        "resource R kernel=k\n"
+        "server s type=cbs budget=2 period=10 kernel=k\n"
+        "task t1 period=10 deadline=10 kernel=k code=\"fixed(2);wait(R);fixed(1);signal(R);\"\n"
+        "task t2 period=20 offset=1 server=s code=\"fixed(4);\"   # in the server\n"
+        "\n"
+        "kernel m sched=FPSched cpus=2\n"
+        "light l kernel=m param=1\n"
+        "  100 10\n"
+        "\t200 20 150   # deadline 150\n"
+        "end\n"
+        "stat ft measure=finish type=max tasks=t1\n";
+
+    ModelFile mf;
+    mf.parse(text, "model");
+
+    RTKernel *k = mf.getKernel("k");
+    REQUIRE(k != NULL);
+    REQUIRE(dynamic_cast<MRTKernel *>(mf.getKernel("m")) != NULL);
+    REQUIRE(mf.getServer("s") != NULL);
+    REQUIRE(mf.getKernel("none") == NULL);
+
+    REQUIRE(mf.getTasks().size() == 2);
+    PeriodicTask *t1 = dynamic_cast<PeriodicTask *>(mf.getTasks()[0]);
+    PeriodicTask *t2 = dynamic_cast<PeriodicTask *>(mf.getTasks()[1]);
+    REQUIRE(t1->getName() == "t1");
+    REQUIRE(t2->getKernel() == mf.getServer("s"));
+
+    REQUIRE(mf.getLightTaskSets().size() == 1);
+    LightTaskSet &l = *mf.getLightTaskSets()[0];
+    REQUIRE(l.size() == 2);
+    REQUIRE(Entity::_find("l1") == &l[1]);
+    REQUIRE(l[1].getRelDline() == 150);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(39);
+    REQUIRE(t1->getExecTime() == 3);
+    REQUIRE(t2->getExecTime() == 4);
+    REQUIRE(l[0].getExecTime() == 10);
+    REQUIRE(l[1].getExecTime() == 20);
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Model file errors")
+{
+    const char *bad[] = {
+        "kernel k sched=EDFSched\ntask t period=10 kernel=j code=\"fixed(1);\"\n",
+        "kernel k sched=EDFSched\ntask t kernel=k code=\"fixed(1);\"\n",
+        "kernel k sched=NoSched\n",
+        "kernel k sched=EDFSched\nlight l kernel=k\n10 1\n",
+        "kernel k sched=EDFSched\nmachine m\n",
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        REQUIRE_THROWS_AS(mf.parse(bad[i], "bad"), const ModelFile::Exc&);
+    }
+
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    ModelFile mf;
+    string msg;
+    try {
+        mf.parse("\n\nkernel k sched=EDFSched\nkernel k sched=EDFSched\n", "bad");
+    }
+    catch (ModelFile::Exc &e) {
+        msg = e.what();
+    }
+    // the errors of the objects have the line too
+    REQUIRE(msg.find("bad:4:") != string::npos);
+}
+
+TEST_CASE("Model image")
+{
+    string text =
+        "kernel k sched=EDFSched resman=pi\n"
+        "resource R kernel=k\n"
+        "server s type=cbs budget=2 period=10 kernel=k\n"
+        "task t1 period=10 kernel=k code=\"fixed(2);wait(R);fixed(1);signal(R);\"\n"
+        "task t2 period=20 offset=1 server=s code=\"fixed(4);\"\n"
+        "light l kernel=k\n"
+        "  100 10\n"
+        "  200 20 150\n"
+        "end\n";
+    {
+        ofstream f("model_image.txt");
+        f << text;
+    }
+    remove("model_image.img");
+
+    {
+        // no image yet: the file is parsed, and the image written
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        mf.load("model_image.txt", "model_image.img");
+        REQUIRE(mf.getTasks().size() == 2);
+    }
+
+    ModelImage img("model_image.img");
+    REQUIRE(img.matches(text));
+    REQUIRE(!img.matches(text + "\n"));
+    REQUIRE(img.getSource() == "model_image.txt");
+
+    // two models built from the same image
+    for (int i = 0; i < 2; ++i) {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        mf.build(img);
+
+        REQUIRE(mf.getTasks().size() == 2);
+        Task *t1 = mf.getTasks()[0];
+        Task *t2 = mf.getTasks()[1];
+        REQUIRE(t2->getKernel() == mf.getServer("s"));
+        LightTaskSet &l = *mf.getLightTaskSets()[0];
+        REQUIRE(l.size() == 2);
+        REQUIRE(l[1].getRelDline() == 150);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(39);
+        REQUIRE(t1->getExecTime() == 3);
+        REQUIRE(t2->getExecTime() == 4);
+        SIMUL.endSingleRun();
+    }
+
+    {
+        // a stale image is written again
+        ofstream f("model_image.txt", ios::app);
+        f << "task t3 period=10 kernel=k code=\"fixed(1);\"\n";
+    }
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        mf.load("model_image.txt", "model_image.img");
+        REQUIRE(mf.getTasks().size() == 3);
+    }
+    REQUIRE(ModelImage("model_image.img").getSource() == "model_image.txt");
+
+    // the errors still refer to the lines of the file
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        mf.recordImage();
+        mf.parse("kernel k sched=EDFSched\n\ntask t period=10 kernel=k code=\"fixed(1);\"\n",
+                 "bad");
+        mf.saveImage("model_image.img");
+    }
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        ModelFile mf;
+        mf.parse("kernel k sched=EDFSched\n");
+        try {
+            mf.build(ModelImage("model_image.img"));
+            FAIL("no error");
+        }
+        catch (ModelFile::Exc &e) {
+            REQUIRE(string(e.what()).find("bad:1:") != string::npos);
+        }
+    }
+
+    REQUIRE_THROWS_AS(ModelImage("model_image.txt"), const ModelFile::Exc&);
+    REQUIRE_THROWS_AS(ModelFile().saveImage("model_image.img"), const ModelFile::Exc&);
+}
+
+TEST_CASE("Model through the C interface")
+{
+    REQUIRE(rtsim_version() == RTSIM_C_VERSION);
+    REQUIRE(rtsim_model_parse("kernel k sched=NoSched\n") == 0);
+    REQUIRE(string(rtsim_last_error()) != "");
+
+    rtsim_model *m = rtsim_model_parse(
+        "kernel k sched=FPSched\n"
+        "task t1 period=10 kernel=k param=1 code=\"fixed(2);\"\n"
+        "task t2 period=20 kernel=k param=2 code=\"fixed(5);\"\n"
+        "stat ft measure=finish type=max tasks=t2\n");
+    REQUIRE(m != 0);
+    REQUIRE(rtsim_task_count(m) == 2);
+    REQUIRE(string(rtsim_task_name(m, 1)) == "t2");
+    REQUIRE(rtsim_stat_count(m) == 1);
+    REQUIRE(string(rtsim_stat_name(m, 0)) == "ft");
+
+    REQUIRE(rtsim_trace_jobs(m, 1) == 0);
+    REQUIRE(rtsim_run(m, 100, 3) == 0);
+    REQUIRE(rtsim_stat_mean(m, 0) == 7);
+
+    rtsim_buffer runs = rtsim_stat_runs(m, 0);
+    REQUIRE(runs.length == 3);
+    REQUIRE(runs.stride == sizeof(double));
+    REQUIRE(static_cast<const double *>(runs.data)[2] == 7);
+
+    // 10 + 5 jobs per run, read through the fields
+    rtsim_buffer jobs = rtsim_jobs(m);
+    REQUIRE(jobs.length == 45);
+    size_t n;
+    const rtsim_field *f = rtsim_job_fields(&n);
+    REQUIRE(n == 9);
+    REQUIRE(string(f[6].name) == "finish");
+    int t2 = 0;
+    for (size_t i = 0; i < jobs.length; ++i) {
+        const char *rec = static_cast<const char *>(jobs.data) + i * jobs.stride;
+        int32_t task, finish;
+        memcpy(&task, rec + f[0].offset, sizeof(task));
+        memcpy(&finish, rec + f[6].offset, sizeof(finish));
+        if (task != rtsim_task_id(m, 1)) continue;
+        ++t2;
+        REQUIRE(finish == 7);
+    }
+    REQUIRE(t2 == 15);
+
+    // a new run replaces the results; without the trace, no jobs
+    REQUIRE(rtsim_trace_jobs(m, 0) == 0);
+    REQUIRE(rtsim_run(m, 100, 1) == 0);
+    REQUIRE(rtsim_stat_runs(m, 0).length == 1);
+    REQUIRE(rtsim_jobs(m).length == 0);
+    REQUIRE(rtsim_run(m, 0, 1) == -1);
+
+    rtsim_model_free(m);
+}
@@ -2,6 +2,7 @@
 #include <metasim.hpp>
 #include <rttask.hpp>
 #include <mrtkernel.hpp>
+#include <clusteredmrtkernel.hpp>
 #include <edfsched.hpp>
 #include <cbserver.hpp>
 
@@ -169,3 +170,324 @@ TEST_CASE("multicore with cbs")
 
    SIMUL.endSingleRun();
 }
+
+TEST_CASE("multicore preemption")
+{
+    EDFScheduler sched;
+    MRTKernel kern(&sched, 2);
+
+    PeriodicTask t1(20, 20, 0, "task 1");
+    t1.insertCode("fixed(10);");
+    t1.setAbort(false);
+    PeriodicTask t2(30, 30, 0, "task 2");
+    t2.insertCode("fixed(10);");
+    t2.setAbort(false);
+    PeriodicTask t3(8, 8, 2, "task 3");
+    t3.insertCode("fixed(3);");
+    t3.setAbort(false);
+
+    kern.addTask(t1);
+    kern.addTask(t2);
+    kern.addTask(t3);
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(1);
+    CPU *c2 = kern.getProcessor(&t2);
+    REQUIRE(c2 != NULL);
+
+    // task 3 takes the processor of the task with the latest deadline
+    SIMUL.run_to(3);
+    REQUIRE(kern.getProcessor(&t2) == NULL);
+    REQUIRE(kern.getProcessor(&t3) == c2);
+    REQUIRE(kern.getOldProcessor(&t2) == c2);
+    REQUIRE(t1.getExecTime() == 3);
+    REQUIRE(t2.getExecTime() == 2);
+    REQUIRE(t3.getExecTime() == 1);
+
+    SIMUL.run_to(8);
+    REQUIRE(kern.getProcessor(&t2) == c2);
+    REQUIRE(t1.getExecTime() == 8);
+    REQUIRE(t2.getExecTime() == 5);
+    REQUIRE(t3.getExecTime() == 3);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("CPU speed levels and energy")
+{
+    double V[] = {1.2, 1.0, 1.5};
+    int F[] = {60, 30, 100};
+    CPU cpu("pcpu", 3, V, F);
+
+    REQUIRE(cpu.getSpeed(0) == Approx(0.3));
+    REQUIRE(cpu.getSpeed(2) == Approx(1.0));
+    REQUIRE(cpu.getPower(1) == Approx(60 * 1.2 * 1.2));
+
+    REQUIRE(cpu.getLevel(0.1) == 0);
+    REQUIRE(cpu.getLevel(0.5) == 1);
+    REQUIRE(cpu.getLevel(1.5) == -1);
+
+    double loads[] = {0.2, 0.6, 0.9, 0.4};
+    int levels[4];
+    cpu.getLevels(loads, levels, 4);
+    REQUIRE(levels[0] == 0);
+    REQUIRE(levels[1] == 1);
+    REQUIRE(levels[2] == 2);
+    REQUIRE(levels[3] == 1);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(10);
+    REQUIRE(cpu.setSpeed(0.3) == Approx(0.3));
+    SIMUL.run_to(30);
+    REQUIRE(cpu.getEnergy() == Approx(10 * cpu.getPower(2) + 20 * cpu.getPower(0)));
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Speed changes during an instruction")
+{
+    double V[] = {1.0, 1.5};
+    int F[] = {50, 100};
+    CPU cpu("scpu", 2, V, F);
+    EDFScheduler sched;
+    RTKernel kern(&sched, "skern", &cpu);
+
+    PeriodicTask t1(100, 100, 0, "stask");
+    t1.insertCode("fixed(10);");
+    kern.addTask(t1, "");
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(2);
+    REQUIRE(cpu.getWork() == 2 * CPU::SPEED_ONE);
+
+    // slower: 8 units at half speed end at 18, but the end event is
+    // left at 10, and posted again when it is triggered
+    cpu.setSpeed(0.5);
+    REQUIRE(cpu.getTimeOf(10 * CPU::SPEED_ONE) == 18);
+    SIMUL.run_to(11);
+    REQUIRE(t1.isActive());
+    REQUIRE(cpu.getWork() == 6.5 * CPU::SPEED_ONE);
+
+    // faster: 3 units are left at 12, the event moves to 15
+    SIMUL.run_to(12);
+    cpu.setSpeed(1.0);
+    SIMUL.run_to(14);
+    REQUIRE(t1.isActive());
+    SIMUL.run_to(15);
+    REQUIRE(!t1.isActive());
+    REQUIRE(t1.getExecTime() == 15);
+
+    // the next job runs at full speed
+    SIMUL.run_to(110);
+    REQUIRE(!t1.isActive());
+    REQUIRE(t1.getExecTime() == 10);
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("clustered multicore")
+{
+    EDFScheduler s0, s1;
+    ClusteredMRTKernel kern("kern");
+    REQUIRE(kern.addCluster(&s0, 1) == 0);
+    REQUIRE(kern.addCluster(&s1, 1) == 1);
+    REQUIRE(kern.getProcessors().size() == 2);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    t1.setAbort(false);
+    PeriodicTask t2(10, 10, 0, "task 2");
+    t2.insertCode("fixed(3);");
+    t2.setAbort(false);
+    PeriodicTask t3(20, 20, 0, "task 3");
+    t3.insertCode("fixed(5);");
+    t3.setAbort(false);
+
+    kern.addTask(t1, 0);
+    kern.addTask(t2, 1);
+    kern.addTask(t3, 1);
+    CPU *c0 = kern.getCluster(0)->getProcessors()[0];
+    CPU *c1 = kern.getCluster(1)->getProcessors()[0];
+
+    SIMUL.initSingleRun();
+
+    // task 1 has a cluster for itself, task 3 waits for task 2
+    SIMUL.run_to(1);
+    REQUIRE(kern.getProcessor(&t1) == c0);
+    REQUIRE(kern.getProcessor(&t2) == c1);
+    REQUIRE(kern.getProcessor(&t3) == NULL);
+    REQUIRE_THROWS(kern.migrate(t3, 0));
+
+    SIMUL.run_to(8);
+    REQUIRE(t3.getExecTime() == 5);
+    REQUIRE(!t3.isActive());
+
+    // the next instance of task 3 waits for task 1 on cluster 0
+    kern.migrate(t3, 0);
+    REQUIRE(kern.getClusterOf(&t3) == 0);
+    REQUIRE(t3.getKernel() == kern.getCluster(0));
+
+    SIMUL.run_to(22);
+    REQUIRE(kern.getProcessor(&t1) == c0);
+    REQUIRE(kern.getProcessor(&t3) == NULL);
+    REQUIRE(t2.getExecTime() == 2);
+
+    SIMUL.run_to(25);
+    REQUIRE(kern.getProcessor(&t3) == c0);
+    REQUIRE(kern.getRunningTasks().size() == 1);
+    std::vector<AbsRTTask *> running;
+    kern.getRunningTasks(running);
+    REQUIRE(running.size() == 1);
+    REQUIRE(running[0] == &t3);
+    std::vector<CPU *> cpus;
+    kern.getProcessors(cpus);
+    REQUIRE(cpus.size() == 2);
+    REQUIRE(cpus[1] == kern.getCluster(1)->getProcessorAt(0));
+    REQUIRE(kern.getCluster(0)->getTaskAt(0) == &t3);
+
+    // and back
+    SIMUL.run_to(30);
+    REQUIRE(t3.getExecTime() == 5);
+    kern.migrate(t3, 1);
+    SIMUL.run_to(41);
+    REQUIRE(kern.getProcessor(&t3) == NULL);
+    REQUIRE(kern.getProcessor(&t2) == c1);
+    SIMUL.run_to(44);
+    REQUIRE(kern.getProcessor(&t3) == c1);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("multicore checkpoint")
+{
+    EDFScheduler sched;
+    MRTKernel kern(&sched, 2);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("delay(unif(3,9));");
+    PeriodicTask t2(15, 15, 0, "task 2");
+    t2.insertCode("delay(unif(5,12));");
+    PeriodicTask t3(20, 20, 0, "task 3");
+    t3.insertCode("fixed(2);delay(unif(6,14));");
+    PeriodicTask *tasks[] = { &t1, &t2, &t3 };
+    for (int i = 0; i < 3; ++i) {
+        tasks[i]->setAbort(false);
+        kern.addTask(*tasks[i]);
+    }
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(997);
+    Checkpoint c;
+    SIMUL.checkpoint(c);
+
+    SIMUL.run_to(4000);
+    TaskCounters tc[3];
+    CPU *where[3];
+    for (int i = 0; i < 3; ++i) {
+        tc[i] = tasks[i]->getCounters();
+        where[i] = kern.getProcessor(tasks[i]);
+    }
+
+    // the tasks go back to the processors they had at 997
+    SIMUL.restore(c);
+    SIMUL.run_to(4000);
+    for (int i = 0; i < 3; ++i) {
+        const TaskCounters &k = tasks[i]->getCounters();
+        REQUIRE(k.executed == tc[i].executed);
+        REQUIRE(k.jobs == tc[i].jobs);
+        REQUIRE(k.late == tc[i].late);
+        REQUIRE(k.preemptions == tc[i].preemptions);
+        REQUIRE(kern.getProcessor(tasks[i]) == where[i]);
+    }
+
+    SIMUL.endSingleRun();
+}
+
+namespace {
+    class Core;
+    // the cores are owned by their partitions
+    std::vector<Core *> cores;
+
+    // at the end of every job of the periodic task of its core,
+    // activates the interrupt task of the next core
+    class NotifyTrace : public Trace {
+        int _next;
+    public:
+        NotifyTrace(int next) : Trace("notify", Trace::BINARY, false),
+                                _next(next) {}
+        void record(Event *);
+    };
+
+    // a processor of a partitioned system, with its own kernel
+    class Core {
+    public:
+        EDFScheduler sched;
+        RTKernel kern;
+        PeriodicTask per;
+        Task irq;
+        NotifyTrace notify;
+
+        Core(int p, int n) : sched(), kern(&sched),
+                             per(20, 20, p, "per"), irq(NULL, 6, 0, "irq"),
+                             notify((p + 1) % n)
+        {
+            per.insertCode("delay(unif(4,12));");
+            per.setAbort(false);
+            irq.insertCode("delay(unif(1,4));");
+            irq.setAbort(false);
+            kern.addTask(per);
+            kern.addTask(irq);
+            per.endEvt.addTrace(&notify);
+        }
+    };
+
+    void NotifyTrace::record(Event *)
+    {
+        Task *t = &cores[_next]->irq;
+        PartitionedSim::send(_next, SIMUL.getTime() + 4,
+                             [t]() { t->activate(); });
+    }
+
+    std::vector<long> run_cores(int threads, Tick window,
+                                unsigned long *rollbacks = 0)
+    {
+        const int n = 4;
+        RandomVar::init(777);
+        cores.assign(n, (Core *)0);
+        PartitionedSim ps(n, 4);
+        ps.setOptimistic(window);
+        ps.build([](int p) {
+            std::shared_ptr<Core> c = std::make_shared<Core>(p, int(cores.size()));
+            cores[p] = c.get();
+            return std::shared_ptr<void>(c);
+        });
+        ps.run(2000, threads);
+        if (rollbacks) *rollbacks = ps.getRollbacks();
+
+        std::vector<long> res;
+        for (int p = 0; p < n; ++p) {
+            Task *tasks[] = { &cores[p]->per, &cores[p]->irq };
+            for (int i = 0; i < 2; ++i) {
+                const TaskCounters &k = tasks[i]->getCounters();
+                res.push_back(long(k.executed));
+                res.push_back(k.jobs);
+                res.push_back(k.late);
+                res.push_back(k.preemptions);
+            }
+        }
+        return res;
+    }
+}
+
+TEST_CASE("partitioned cores in optimistic mode")
+{
+    // the kernels save their state, so a core can be brought back
+    // to the start of a window: the results are the conservative ones
+    std::vector<long> ref = run_cores(1, 0);
+    REQUIRE(ref[5] > 50);
+    REQUIRE(ref[3] > 0);
+
+    unsigned long rollbacks = 0;
+    REQUIRE(run_cores(1, 40, &rollbacks) == ref);
+    REQUIRE(rollbacks > 0);
+    REQUIRE(run_cores(4, 40) == ref);
+}
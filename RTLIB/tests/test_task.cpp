@@ -1,9 +1,49 @@
 #include "catch.hpp"
 
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
 #include <metasim.hpp>
 #include <rttask.hpp>
 #include <kernel.hpp>
+#include <asyncstats.hpp>
+#include <batchsim.hpp>
+#include <bodyinstr.hpp>
+#include <chrometrace.hpp>
+#include <edfsched.hpp>
+#include <exeinstr.hpp>
+#include <flightrec.hpp>
 #include <fpsched.hpp>
+#include <interrupt.hpp>
+#include <rmsched.hpp>
+#include <rrsched.hpp>
+#include <statickernel.hpp>
+#include <chunktrace.hpp>
+#include <jobtrace.hpp>
+#include <jtrace.hpp>
+#include <json_trace.hpp>
+#include <lighttask.hpp>
+#include <livetrace.hpp>
+#include <mrtkernel.hpp>
+#include <piresman.hpp>
+#include <queuestat.hpp>
+#include <replaytask.hpp>
+#include <sampledtrace.hpp>
+#include <tracedigest.hpp>
+#include <tracelod.hpp>
+#include <tracemerge.hpp>
+#include <taskstat.hpp>
+#include <tracemap.hpp>
+#include <tracebus.hpp>
+#include <tracestats.hpp>
 
 using namespace MetaSim;
 using namespace RTSim;
@@ -97,6 +137,51 @@ TEST_CASE("Task arrival")
 }
 
 
+TEST_CASE("Replacing the scheduler between runs")
+{
+    EDFScheduler edf;
+    RTKernel kern(&edf);
+
+    // EDF runs task 2 first, FP with these priorities task 1
+    PeriodicTask t1(20, 20, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(10, 10, 0, "task 2");
+    t2.insertCode("fixed(2);");
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(2);
+    REQUIRE(t1.getExecTime() == 0);
+    REQUIRE(t2.getExecTime() == 2);
+    REQUIRE_THROWS_AS(kern.replaceScheduler(new FPScheduler), const RTKernelExc&);
+    SIMUL.endSingleRun();
+
+    // the parameters the tasks were added with are the priorities
+    FPScheduler fp;
+    REQUIRE(kern.replaceScheduler(&fp) == &edf);
+    SIMUL.initSingleRun();
+    SIMUL.run_to(2);
+    REQUIRE(t1.getExecTime() == 2);
+    REQUIRE(t2.getExecTime() == 0);
+    SIMUL.endSingleRun();
+
+    // with the opposite priorities
+    FPScheduler fp2;
+    vector<string> prio;
+    prio.push_back("2");
+    prio.push_back("1");
+    REQUIRE_THROWS_AS(kern.replaceScheduler(&fp2, vector<string>(1, "1")), const RTKernelExc&);
+    REQUIRE(kern.replaceScheduler(&fp2, prio) == &fp);
+    SIMUL.initSingleRun();
+    SIMUL.run_to(2);
+    REQUIRE(t1.getExecTime() == 0);
+    REQUIRE(t2.getExecTime() == 2);
+    SIMUL.endSingleRun();
+
+    REQUIRE(kern.replaceScheduler(&edf) == &fp2);
+}
+
 TEST_CASE("Task suspension, one task")
 {
     PeriodicTask t1(10, 10, 0);
@@ -294,3 +379,2241 @@ TEST_CASE("Task kill, two tasks")
     SIMUL.endSingleRun();
     
 }
+
+TEST_CASE("Java trace of task events")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    t1.setAbort(false);
+    kern.addTask(t1, "10");
+
+    JavaTrace jt("unused", false);
+    t1.setTrace(&jt);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(25);
+
+    vector<TraceEvent *> data = jt.getData();
+    int arr = 0, sched_ = 0, end = 0, dline = 0;
+    for (unsigned i = 0; i < data.size(); ++i) {
+        if (dynamic_cast<TraceArrEvent *>(data[i])) arr++;
+        else if (dynamic_cast<TraceSchedEvent *>(data[i])) sched_++;
+        else if (dynamic_cast<TraceEndEvent *>(data[i])) end++;
+        else if (dynamic_cast<TraceDlineSetEvent *>(data[i])) dline++;
+    }
+    REQUIRE(arr == 3);
+    REQUIRE(dline == 3);
+    REQUIRE(sched_ == 3);
+    REQUIRE(end == 3);
+
+    SIMUL.endSingleRun();
+    jt.close();
+}
+
+TEST_CASE("Fixed priority ready queue")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(50, 50, 0, "task 1");
+    t1.insertCode("fixed(10);");
+    PeriodicTask t2(50, 50, 0, "task 2");
+    t2.insertCode("fixed(10);");
+    PeriodicTask t3(50, 50, 0, "task 3");
+    t3.insertCode("fixed(10);");
+    PeriodicTask t4(50, 50, 2, "task 4");
+    t4.insertCode("fixed(10);");
+
+    kern.addTask(t1, "3");
+    kern.addTask(t2, "1");
+    kern.addTask(t3, "1");
+    // out of the range of the bitmap
+    kern.addTask(t4, "1000");
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(1);
+    REQUIRE(sched.getSize() == 3);
+    REQUIRE(sched.getTaskN(0) == &t2);
+    REQUIRE(sched.getTaskN(1) == &t3);
+    REQUIRE(sched.getTaskN(2) == &t1);
+    REQUIRE(sched.getTaskN(3) == NULL);
+
+    SIMUL.run_to(3);
+    REQUIRE(sched.getSize() == 4);
+    REQUIRE(sched.getTaskN(0) == &t2);
+    REQUIRE(sched.getTaskN(2) == &t1);
+    REQUIRE(sched.getTaskN(3) == &t4);
+
+    SIMUL.run_to(11);
+    REQUIRE(sched.getSize() == 3);
+    REQUIRE(sched.getFirst() == &t3);
+    REQUIRE(t2.getExecTime() == 10);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Priority change in place")
+{
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(5);");
+    PeriodicTask t2(20, 20, 0, "task 2");
+    t2.insertCode("fixed(5);");
+    PeriodicTask t3(30, 30, 0, "task 3");
+    t3.insertCode("fixed(5);");
+
+    kern.addTask(t1);
+    kern.addTask(t2);
+    kern.addTask(t3);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(1);
+
+    REQUIRE(sched.getTaskN(0) == &t1);
+    REQUIRE(sched.getTaskN(2) == &t3);
+
+    sched.setPriority(&t3, 5);
+    REQUIRE(sched.getTaskN(0) == &t3);
+    REQUIRE(sched.getTaskN(1) == &t1);
+    REQUIRE(sched.getTaskN(2) == &t2);
+
+    sched.setPriority(&t3, 30);
+    sched.setPriority(&t1, 25);
+    REQUIRE(sched.getTaskN(0) == &t2);
+    REQUIRE(sched.getTaskN(1) == &t1);
+    REQUIRE(sched.getTaskN(2) == &t3);
+    REQUIRE(sched.getSize() == 3);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Ready queue longer than the linear search")
+{
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    // 100 tasks, with their deadlines in scrambled order
+    std::vector<std::unique_ptr<PeriodicTask> > tasks;
+    for (int i = 0; i < 100; ++i) {
+        Tick d = 1000 + (i * 37) % 100;
+        tasks.push_back(std::unique_ptr<PeriodicTask>(
+                            new PeriodicTask(2000, d, 0, "")));
+        tasks.back()->insertCode("fixed(1);");
+        kern.addTask(*tasks.back());
+    }
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(0);
+    REQUIRE(sched.getSize() == 100);
+    bool sorted = true;
+    for (int n = 0; n < 100; ++n) {
+        AbsRTTask *t = sched.getTaskN(n);
+        sorted = sorted && t->getDeadline() == 1000 + n;
+    }
+    REQUIRE(sorted);
+
+    // the first task goes last, then first again
+    AbsRTTask *first = sched.getTaskN(0);
+    sched.setPriority(first, 2000);
+    REQUIRE(sched.getTaskN(99) == first);
+    REQUIRE(sched.getTaskN(0)->getDeadline() == 1001);
+    sched.setPriority(first, 999);
+    REQUIRE(sched.getTaskN(0) == first);
+    REQUIRE(sched.getSize() == 100);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Deadline misses without the deadline event")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(6);");
+    t1.setAbort(false);
+    PeriodicTask t2(10, 10, 0, "task 2");
+    t2.insertCode("fixed(6);");
+    t2.setAbort(false);
+
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(1);
+    REQUIRE(!t2.deadEvt.isInQueue());
+    REQUIRE(t2.getMissCount() == 0);
+
+    SIMUL.run_to(11);
+    REQUIRE(t1.getMissCount() == 0);
+    REQUIRE(t2.getMissCount() == 1);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Fused execution of sequential instructions")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(5, 5, 0, "task 1");
+    t1.insertCode("fixed(1);");
+    PeriodicTask t2(20, 20, 0, "task 2");
+    t2.insertCode("fixed(2);fixed(3);fixed(4);");
+
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    const vector<Instr *> &code = t2.getInstrQueue();
+    ExecInstr *first = dynamic_cast<ExecInstr *>(code[0]);
+    ExecInstr *second = dynamic_cast<ExecInstr *>(code[1]);
+
+    // off by default
+    SIMUL.initSingleRun();
+    SIMUL.run_to(4);
+    REQUIRE(first->getSpan() == 1);
+    REQUIRE(!first->_endEvt.isInQueue());
+    REQUIRE(second->_endEvt.isInQueue());
+    SIMUL.endSingleRun();
+
+    t2.setFusion(true);
+    SIMUL.initSingleRun();
+    SIMUL.run_to(2);
+    REQUIRE(first->_endEvt.isInQueue());
+    REQUIRE(!second->_endEvt.isInQueue());
+    REQUIRE(first->getSpan() == 3);
+
+    SIMUL.run_to(7);
+    REQUIRE(t2.getExecTime() == 5);
+
+    SIMUL.run_to(12);
+    REQUIRE(!t2.isActive());
+    REQUIRE(t2.getExecTime() == 9);
+    REQUIRE(code[0]->getExecTime() == 2);
+    REQUIRE(code[1]->getExecTime() == 3);
+    REQUIRE(code[2]->getExecTime() == 4);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Tasks sharing a program")
+{
+    const TaskProgram &p = TaskProgram::get("fixed(2);delay(3);");
+    REQUIRE(&p == &TaskProgram::get("fixed(2);delay(3);"));
+    REQUIRE(p.size() == 2);
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(20, 20, 0, "task 1");
+    t1.insertCode(p);
+    PeriodicTask t2(20, 20, 0, "task 2");
+    t2.insertCode(p);
+
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    REQUIRE(t1.getWCET() == 5);
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(5);
+    REQUIRE(!t1.isActive());
+    REQUIRE(t2.isActive());
+
+    SIMUL.run_to(10);
+    REQUIRE(!t2.isActive());
+    REQUIRE(t2.getExecTime() == 5);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Light periodic tasks")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    LightTask t1(5, 2);
+    LightTask t2(10, 5);
+
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    FinishingTimeStat<StatMax> ft("t2 response");
+    ft.attachToTask(&t2);
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(3);
+    REQUIRE(!t1.isActive());
+    REQUIRE(t2.isExecuting());
+
+    SIMUL.run_to(6);
+    REQUIRE(t1.isExecuting());
+    REQUIRE(t2.getExecTime() == 3);
+
+    SIMUL.run_to(9);
+    REQUIRE(!t2.isActive());
+    REQUIRE(t2.getExecTime() == 5);
+    REQUIRE(t2.getMissCount() == 0);
+    REQUIRE(ft.getValue() == 9);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Light task sets built in bulk")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    std::vector<Tick> period, wcet;
+    for (int i = 0; i < 100; ++i) {
+        period.push_back(1000 + i);
+        wcet.push_back(i % 5 + 1);
+    }
+    REQUIRE_THROWS(LightTaskSet(period, std::vector<Tick>(3)));
+
+    EDFScheduler sched;
+    MRTKernel kern(&sched, 4);
+    LightTaskSet set(period, wcet, std::vector<Tick>(), 
+                     std::vector<Tick>(100, 2), "light");
+    REQUIRE(set.size() == 100);
+    REQUIRE(Entity::_find("light42") == &set[42]);
+    set.addTo(kern);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(500);
+    for (size_t i = 0; i < set.size(); ++i) {
+        REQUIRE(!set[i].isActive());
+        REQUIRE(set[i].getExecTime() == wcet[i]);
+        REQUIRE(set[i].getMissCount() == 0);
+    }
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Light task sets built in parallel")
+{
+    const size_t N = 4 * LightTaskSet::MIN_SHARD + 7;
+    std::vector<Tick> period, wcet;
+    for (size_t i = 0; i < N; ++i) {
+        period.push_back(Tick(int64_t(100000 + i)));
+        wcet.push_back(Tick(int64_t(i % 7 + 1)));
+    }
+
+    // the same IDs and names, with one thread and with four,
+    // for named and anonymous tasks
+    for (const char *prefix : { "shard", "" }) {
+        SimContext c1, c4;
+        std::vector<int> ids;
+        std::vector<std::string> names;
+        {
+            SimContext::Scope scope(&c1);
+            LightTaskSet set(period, wcet, std::vector<Tick>(),
+                             std::vector<Tick>(), prefix);
+            for (size_t i = 0; i < N; ++i) {
+                ids.push_back(set[i].getID());
+                names.push_back(set[i].getName());
+            }
+        }
+        SimContext::Scope scope(&c4);
+        LightTaskSet set(period, wcet, std::vector<Tick>(),
+                         std::vector<Tick>(), prefix, 4);
+        std::vector<int> ids4;
+        std::vector<std::string> names4;
+        for (size_t i = 0; i < N; ++i) {
+            ids4.push_back(set[i].getID());
+            names4.push_back(set[i].getName());
+        }
+        REQUIRE(ids4 == ids);
+        REQUIRE(names4 == names);
+        if (*prefix) REQUIRE(Entity::_find("shard12345") == &set[12345]);
+
+        // a second set with the same names is refused
+        if (*prefix)
+            REQUIRE_THROWS(LightTaskSet(period, wcet, std::vector<Tick>(),
+                                        std::vector<Tick>(), prefix, 4));
+
+        EDFScheduler sched;
+        MRTKernel kern(&sched, 8);
+        set.addTo(kern);
+        SIMUL.initSingleRun();
+        SIMUL.run_to(200000);
+        for (size_t i = 0; i < N; i += 97)
+            REQUIRE(set[i].getMissCount() == 0);
+        SIMUL.endSingleRun();
+    }
+}
+
+TEST_CASE("Re-parameterization between runs")
+{
+    RMScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(15, 15, 0, "task 2");
+    t2.insertCode("fixed(5);");
+    kern.addTask(t1);
+    kern.addTask(t2);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(3);
+    REQUIRE(t1.isExecuting());
+    SIMUL.endSingleRun();
+
+    // task 2 gets the shortest period, and the highest priority
+    t1.setPeriod(20);
+    t1.setRelDline(20);
+    t2.setPeriod(8);
+    t2.setRelDline(8);
+    t2.setPhase(1);
+    ExecInstr *e = dynamic_cast<ExecInstr *>(t2.getInstrQueue()[0]);
+    REQUIRE(e != NULL);
+    e->setCost(new DeltaVar(3));
+
+    // the instructions are reset with a memcpy, the cost is kept
+    SIMUL.initSingleRun();
+    ExecInstr *f = dynamic_cast<ExecInstr *>(t1.getInstrQueue()[0]);
+    REQUIRE(f->getExecTime() == 0);
+    REQUIRE(e->getWCET() == 3);
+    SIMUL.run_to(3);
+    REQUIRE(t2.isExecuting());
+    REQUIRE(t1.getExecTime() == 1);
+    SIMUL.run_to(4);
+    REQUIRE(!t2.isActive());
+    REQUIRE(t2.getExecTime() == 3);
+    SIMUL.run_to(9);
+    REQUIRE(t2.isExecuting());
+    REQUIRE(t1.getExecTime() == 4);
+    REQUIRE(t2.getArrival() == 9);
+    SIMUL.endSingleRun();
+
+    LightTask l(10, 2);
+    l.setParameters(20, 3, 15, 5);
+    REQUIRE(l.getPeriod() == 20);
+    REQUIRE(l.getRelDline() == 15);
+    REQUIRE(l.getMaxExecutionTime() == 3);
+}
+
+namespace {
+    /// Runs the two tasks under EDF or FP, in a context of their
+    /// own, and returns the arrival of the last instance of each one
+    template <class Sched>
+    std::pair<Tick, Tick> lastArrivals(
+                                       SampledVar iat1, SampledVar c1,
+                                       SampledVar iat2, SampledVar c2)
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+
+        Sched sched;
+        RTKernel kern(&sched);
+        Task t1(&iat1, 10, 0, "task 1");
+        t1.addInstr(new ExecInstr(&t1, c1));
+        Task t2(&iat2, 15, 0, "task 2");
+        t2.addInstr(new ExecInstr(&t2, c2));
+        kern.addTask(t1, "1");
+        kern.addTask(t2, "2");
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(500);
+        std::pair<Tick, Tick> r(t1.getArrival(), t2.getArrival());
+        SIMUL.endSingleRun();
+        return r;
+    }
+}
+
+TEST_CASE("Common random numbers across schedulers")
+{
+    UniformVar u1(8, 12), u2(12, 18), e1(1, 4), e2(2, 6);
+    SampledVar iat1(u1, 100), c1(e1, 100), iat2(u2, 100), c2(e2, 100);
+
+    SampledVar copy(iat1);
+    REQUIRE(copy.size() == 100);
+    REQUIRE(copy.get() == iat1.get());
+    REQUIRE(copy.getMinimum() >= 8);
+    REQUIRE(copy.getMaximum() <= 12);
+
+    std::pair<Tick, Tick> a =
+        lastArrivals<EDFScheduler>(iat1, c1, iat2, c2);
+    std::pair<Tick, Tick> b =
+        lastArrivals<FPScheduler>(iat1, c1, iat2, c2);
+
+    REQUIRE(a.first > 400);
+    REQUIRE(a.first == b.first);
+    REQUIRE(a.second == b.second);
+}
+
+TEST_CASE("Response time distribution")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(20, 20, 0, "task 2");
+    t2.insertCode("fixed(6);");
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    FinishingTimeStat<StatHistogram> hist("t2 p99");
+    hist.attachToTask(&t2);
+    FinishingTimeStat<StatQuantile> median("t2 median", 0.5);
+    median.attachToTask(&t2);
+
+    SIMUL.run(1000);
+
+    // task 2 always completes at 10 (after task 1, from 0 to 4)
+    REQUIRE(hist.getMean() == 10);
+    REQUIRE(hist.getMax() == 10);
+    REQUIRE(hist.getCount() == 50);
+    REQUIRE(median.getValue() == 10);
+}
+
+namespace {
+    struct PeriodicResult {
+        double count, mean, variance, p99, max;
+        Tick skipped;
+    };
+
+    /// Simulates three tasks under EDF in a new context, with or
+    /// without the fast-forward; task 3 is sporadic if asked
+    PeriodicResult runPeriodic(Tick length, bool ff, bool sporadic = false)
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+
+        PeriodicTask t1(10, 10, 0, "task 1");
+        t1.insertCode("fixed(4);");
+        PeriodicTask t2(15, 15, 0, "task 2");
+        t2.insertCode("fixed(5);");
+        std::unique_ptr<Task> t3;
+        if (sporadic) t3.reset(new Task(new UniformVar(20, 30), 25, 0, 
+                                        "task 3"));
+        else t3.reset(new PeriodicTask(25, 25, 0, "task 3"));
+        t3->insertCode("fixed(6);");
+        kern.addTask(t1, "");
+        kern.addTask(t2, "");
+        kern.addTask(*t3, "");
+
+        FinishingTimeStat<StatSummary> rt("response time");
+        rt.attachToTask(t3.get());
+        FinishingTimeStat<StatHistogram> p99("t2 p99");
+        p99.attachToTask(&t2);
+        FinishingTimeStat<StatMax> max("t1 max");
+        max.attachToTask(&t1);
+
+        std::vector<PeriodicTask *> ts;
+        ts.push_back(&t1);
+        ts.push_back(&t2);
+        if (!sporadic) ts.push_back((PeriodicTask *)t3.get());
+        if (ff) SIMUL.setFastForward(PeriodicTask::hyperperiod(ts));
+        SIMUL.run(length);
+
+        PeriodicResult r = { rt.getCount(), rt.getValue(), 
+                             rt.getSampleVariance(), p99.getValue(), 
+                             max.getValue(), SIMUL.getSkippedTime() };
+        return r;
+    }
+}
+
+TEST_CASE("Hyperperiod fast-forward")
+{
+    std::vector<PeriodicTask *> ts;
+    PeriodicTask a(10, 10), b(15, 15), c(25, 25);
+    ts.push_back(&a);
+    ts.push_back(&b);
+    ts.push_back(&c);
+    REQUIRE(PeriodicTask::hyperperiod(ts) == 150);
+
+    PeriodicResult full = runPeriodic(100000, false);
+    PeriodicResult ff = runPeriodic(100000, true);
+
+    REQUIRE(full.skipped == 0);
+    // the state repeats from 150 (for the first time at 300)
+    REQUIRE(ff.skipped == 99600);
+    REQUIRE(ff.count == full.count);
+    REQUIRE(ff.mean == Approx(full.mean));
+    REQUIRE(ff.variance == Approx(full.variance));
+    REQUIRE(ff.p99 == full.p99);
+    REQUIRE(ff.max == full.max);
+
+    // random arrivals are never fast-forwarded
+    PeriodicResult sp = runPeriodic(10000, true, true);
+    REQUIRE(sp.skipped == 0);
+    REQUIRE(sp.count > 0);
+}
+
+namespace {
+    /// Traces two periodic tasks up to time 100 on jt, in a new
+    /// context (so that the tasks always have the same IDs)
+    void traceTwoTasks(JavaTrace &jt, int offset = 0, int end = 100)
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+
+        PeriodicTask t1(10, 10, offset, "task 1");
+        t1.insertCode("fixed(4);");
+        PeriodicTask t2(15, 15, offset, "task 2");
+        t2.insertCode("fixed(6);");
+        kern.addTask(t1, "");
+        kern.addTask(t2, "");
+        t1.setTrace(&jt);
+        t2.setTrace(&jt);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(end);
+        SIMUL.endSingleRun();
+    }
+
+    std::string readFile(const char *name)
+    {
+        std::ifstream f(name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), 
+                           std::istreambuf_iterator<char>());
+    }
+}
+
+TEST_CASE("Buffered Java trace file")
+{
+    // the events, written one by one as before
+    {
+        JavaTrace mem("unused", false);
+        traceTwoTasks(mem);
+        std::ofstream f("trace_ref.trc", std::ios::binary);
+        const char cver[] = "version 1.2";
+        f.write(cver, sizeof(cver));
+        vector<TraceEvent *> data = mem.getData();
+        REQUIRE(data.size() > 20);
+        for (unsigned i = 0; i < data.size(); ++i) data[i]->write(f);
+        mem.close();
+    }
+    {
+        JavaTrace jt("trace_buf.trc");
+        traceTwoTasks(jt);
+        jt.close();
+    }
+
+    std::string ref = readFile("trace_ref.trc");
+    REQUIRE(ref.size() > 100);
+    REQUIRE(readFile("trace_buf.trc") == ref);
+    std::remove("trace_ref.trc");
+    std::remove("trace_buf.trc");
+}
+
+TEST_CASE("Chunked trace with time index")
+{
+    {
+        JavaTrace jt("trace_ref.trc");
+        traceTwoTasks(jt);
+        jt.close();
+    }
+    {
+        ChunkedTrace ct("trace_chunk.trc", 256);
+        traceTwoTasks(ct);
+        ct.close();
+    }
+
+    ChunkedTraceReader r("trace_chunk.trc");
+    const vector<TraceChunk> &index = r.getIndex();
+    REQUIRE(index.size() > 1);
+    for (unsigned i = 1; i < index.size(); ++i)
+        REQUIRE(index[i - 1].last <= index[i].first);
+
+    // the chunks, one after the other, are the records of the 
+    // JavaTrace file without its header
+    vector<char> raw;
+    for (unsigned i = 0; i < index.size(); ++i) r.readChunk(i, raw);
+    std::string ref = readFile("trace_ref.trc");
+    const char cver[] = "version 1.2";
+    REQUIRE(ref.substr(sizeof(cver)) == std::string(raw.begin(), raw.end()));
+    REQUIRE(readFile("trace_chunk.trc").size() < ref.size());
+
+    vector<TraceEvent *> v;
+    r.getEvents(30, 45, v);
+    REQUIRE(v.size() > 0);
+    for (unsigned i = 0; i < v.size(); ++i) {
+        REQUIRE(v[i]->getTime() >= 30);
+        REQUIRE(v[i]->getTime() <= 45);
+        delete v[i];
+    }
+    std::remove("trace_ref.trc");
+    std::remove("trace_chunk.trc");
+}
+
+TEST_CASE("Chunked trace with compact records")
+{
+    {
+        JavaTrace jt("trace_ref.trc");
+        traceTwoTasks(jt);
+        jt.close();
+    }
+    {
+        ChunkedTrace ct("trace_compact.trc", 256, ChunkedTrace::COMPACT_RECORDS);
+        traceTwoTasks(ct);
+        ct.close();
+    }
+
+    // the reader gives back the records of the JavaTrace file
+    ChunkedTraceReader r("trace_compact.trc");
+    REQUIRE(r.getFormat() == ChunkedTrace::COMPACT_RECORDS);
+    REQUIRE(r.getIndex().size() > 1);
+    vector<char> raw;
+    size_t compact = 0;
+    for (unsigned i = 0; i < r.getIndex().size(); ++i) {
+        r.readChunk(i, raw);
+        compact += r.getIndex()[i].rawSize;
+    }
+    std::string ref = readFile("trace_ref.trc");
+    const char cver[] = "version 1.2";
+    REQUIRE(ref.substr(sizeof(cver)) == std::string(raw.begin(), raw.end()));
+    REQUIRE((3 * compact) < raw.size());
+
+    // records with strings and deadlines
+    {
+        std::ofstream f("trace_recs.trc", std::ios::binary);
+        TraceWaitEvent(12, 3, "R").write(f);
+        TraceDlinePostEvent(15, 3, 40, 50).write(f);
+        TraceNameEvent(15, 300, "task 300").write(f);
+        TraceDlineSetEvent(9, 1, 19).write(f);
+    }
+    std::string recs = readFile("trace_recs.trc");
+    vector<char> c, back;
+    int prev = 0;
+    TraceRecordRange all(recs.data(), recs.data() + recs.size());
+    for (TraceRecordIterator i = all.begin(); i != all.end(); ++i)
+        ChunkedTrace::compact(*i, prev, c);
+    REQUIRE(c.size() < recs.size() / 2);
+    ChunkedTrace::expand(&c[0], &c[0] + c.size(), back);
+    REQUIRE(std::string(back.begin(), back.end()) == recs);
+    REQUIRE_THROWS_AS(ChunkedTrace::expand(&c[0], &c[0] + c.size() - 1, back),
+                      const ChunkedTraceExc&);
+
+    std::remove("trace_ref.trc");
+    std::remove("trace_compact.trc");
+    std::remove("trace_recs.trc");
+}
+
+TEST_CASE("Live trace in a shared ring")
+{
+    const char cver[] = "version 1.2";
+    std::string ref, longRef;
+    {
+        JavaTrace jt("trace_ref.trc");
+        traceTwoTasks(jt);
+        jt.close();
+        JavaTrace jl("trace_long.trc");
+        traceTwoTasks(jl, 0, 1000);
+        jl.close();
+        ref = readFile("trace_ref.trc").substr(sizeof(cver));
+        longRef = readFile("trace_long.trc").substr(sizeof(cver));
+    }
+
+    // a reader that keeps up sees all the records
+    {
+        LiveTrace lt("trace_live.shm", 1 << 16);
+        LiveTraceReader r("trace_live.shm", true);
+        vector<char> rec;
+        REQUIRE(!r.next(rec));
+        traceTwoTasks(lt);
+        std::string seen;
+        while (r.next(rec)) {
+            REQUIRE(TraceRecord(&rec[0]).size() == rec.size());
+            seen.append(rec.begin(), rec.end());
+        }
+        REQUIRE(seen == ref);
+        REQUIRE(r.getLost() == 0);
+    }
+
+    // the writer overwrites the records that a slow reader has
+    // not read: the reader goes on from the oldest one left
+    {
+        LiveTrace lt("trace_live.shm", 256);
+        LiveTraceReader r("trace_live.shm", true);
+        traceTwoTasks(lt, 0, 1000);
+        REQUIRE(longRef.size() > 4 * lt.getCapacity());
+
+        vector<char> rec;
+        std::string seen;
+        while (r.next(rec)) seen.append(rec.begin(), rec.end());
+        REQUIRE(r.getLost() == 1);
+        REQUIRE(seen.size() > 0);
+        REQUIRE(seen.size() <= lt.getCapacity());
+        REQUIRE(longRef.substr(longRef.size() - seen.size()) == seen);
+    }
+
+    REQUIRE_THROWS_AS(LiveTrace("trace_live.shm", 1000), const LiveTraceExc&);
+    REQUIRE_THROWS_AS(LiveTraceReader("trace_ref.trc"), const LiveTraceExc&);
+
+    std::remove("trace_ref.trc");
+    std::remove("trace_long.trc");
+    std::remove("trace_live.shm");
+}
+
+TEST_CASE("Trace bus with several sinks")
+{
+    const char cver[] = "version 1.2";
+    {
+        JavaTrace jt("trace_ref.trc");
+        traceTwoTasks(jt);
+        jt.close();
+    }
+    std::string ref = readFile("trace_ref.trc");
+
+    // the events are decoded once, by the bus, on the thread of
+    // the simulation or on its own
+    for (int bg = 0; bg < 2; ++bg) {
+        JavaTrace java("trace_bus.trc");
+        ChunkedTrace chunks("trace_bus_chunks.trc", 256);
+        size_t n = 0;
+        std::string seen;
+        TraceBus bus(bg == 1, 64);
+        bus.subscribe(java);
+        bus.subscribe(chunks);
+        bus.subscribe([&](const TraceRecord &r) {
+                ++n;
+                seen.append(r.data(), r.size());
+            });
+        REQUIRE(bus.getSinks() == 3);
+        traceTwoTasks(bus);
+        bus.close();
+        java.close();
+        chunks.close();
+
+        REQUIRE(n > 20);
+        REQUIRE(seen == ref.substr(sizeof(cver)));
+        REQUIRE(readFile("trace_bus.trc") == ref);
+        ChunkedTraceReader r("trace_bus_chunks.trc");
+        vector<char> raw;
+        for (unsigned i = 0; i < r.getIndex().size(); ++i) r.readChunk(i, raw);
+        REQUIRE(std::string(raw.begin(), raw.end()) == seen);
+    }
+
+    // the exception of a sink, on the thread of the bus
+    {
+        TraceBus bus(true, 64);
+        bus.subscribe([](const TraceRecord &) { throw std::runtime_error("sink"); });
+        traceTwoTasks(bus);
+        REQUIRE_THROWS_AS(bus.close(), const std::runtime_error&);
+    }
+
+    std::remove("trace_ref.trc");
+    std::remove("trace_bus.trc");
+    std::remove("trace_bus_chunks.trc");
+}
+
+TEST_CASE("Merge of chunked traces")
+{
+    // two partitions that overlap, and one that starts later
+    {
+        ChunkedTrace p0("trace_p0.trc", 256);
+        traceTwoTasks(p0);
+        p0.close();
+        ChunkedTrace p1("trace_p1.trc", 256);
+        traceTwoTasks(p1, 10);
+        p1.close();
+        ChunkedTrace p2("trace_p2.trc", 256);
+        traceTwoTasks(p2, 200, 300);
+        p2.close();
+    }
+    vector<string> parts;
+    parts.push_back("trace_p0.trc");
+    parts.push_back("trace_p1.trc");
+    parts.push_back("trace_p2.trc");
+
+    size_t total = 0;
+    for (unsigned i = 0; i < parts.size(); ++i) {
+        ChunkedTraceReader r(parts[i]);
+        for (unsigned j = 0; j < r.getIndex().size(); ++j) 
+            total += r.getIndex()[j].rawSize;
+    }
+
+    std::string merged;
+    {
+        TraceMerger m(parts);
+        TraceRecord r;
+        int last = -1, type = -1, task = -1;
+        bool ends = false, second = false;
+        while (m.next(r)) {
+            REQUIRE(r.getTime() >= last);
+            // a name comes with the record of its event
+            if (type == TraceEvent::TASK_NAME) {
+                REQUIRE(r.getTime() == last);
+                REQUIRE(r.getTask() == task);
+            }
+            // at 10, the END of the first partition comes before
+            // the first events (with names) of the second one
+            if (r.getTime() == 10 && r.getType() == TraceEvent::TASK_NAME) second = true;
+            if (r.getTime() == 10 && r.getType() == TraceEvent::TASK_END) {
+                REQUIRE(!second);
+                ends = true;
+            }
+            last = r.getTime();
+            type = r.getType();
+            task = r.getTask();
+            merged.append(r.data(), r.size());
+        }
+        REQUIRE(ends);
+        REQUIRE(second);
+    }
+    REQUIRE(merged.size() == total);
+
+    // the same records, with the chunks of the third partition
+    // copied as they are
+    {
+        TraceMerger m(parts);
+        ChunkedTrace out("trace_all.trc", 256);
+        m.write(out);
+        out.close();
+        REQUIRE(m.getCopiedChunks() >= ChunkedTraceReader("trace_p2.trc").getIndex().size());
+    }
+    ChunkedTraceReader all("trace_all.trc");
+    vector<char> raw;
+    for (unsigned i = 0; i < all.getIndex().size(); ++i) all.readChunk(i, raw);
+    REQUIRE(std::string(raw.begin(), raw.end()) == merged);
+
+    for (unsigned i = 0; i < parts.size(); ++i) std::remove(parts[i].c_str());
+    std::remove("trace_all.trc");
+}
+
+TEST_CASE("Trace summary pyramid")
+{
+    {
+        LodTrace lt("trace_lod.trc", 10, 256);
+        traceTwoTasks(lt);
+        lt.close();
+    }
+    // the same summary, built after the simulation
+    TracePyramid::build("trace_lod.trc", "trace_post.lod", 10);
+    REQUIRE(readFile("trace_lod.trc.lod") == readFile("trace_post.lod"));
+
+    TracePyramidReader r("trace_lod.trc.lod");
+    REQUIRE(r.getLevels() > 1);
+    REQUIRE(r.getWidth(0) == 10);
+    REQUIRE(r.getBins(r.getLevels() - 1) == 1);
+    REQUIRE(r.levelFor(0, 100, 4) == 2);
+
+    vector<TraceBin> all, bins;
+    r.read(r.getLevels() - 1, 0, 100, all);
+    REQUIRE(all.size() == 1);
+    const TraceCell *cpu = all[0].find(TraceCell::cpu(0));
+    REQUIRE(cpu != NULL);
+    int64_t tasks = 0;
+    for (unsigned i = 0; i < all[0].cells.size(); ++i)
+        if (all[0].cells[i].id >= 0) tasks += all[0].cells[i].busy;
+    REQUIRE(tasks == cpu->busy);
+
+    // the processor is busy at most the width of each bin
+    r.read(0, 0, 1000, bins);
+    int64_t busy = 0;
+    for (unsigned i = 0; i < bins.size(); ++i) {
+        REQUIRE(bins[i].start == 10 * i);
+        const TraceCell *c = bins[i].find(TraceCell::cpu(0));
+        if (c == NULL) continue;
+        REQUIRE(c->busy <= 10);
+        busy += c->busy;
+    }
+    REQUIRE(busy == cpu->busy);
+
+    r.read(0, 30, 45, bins);
+    REQUIRE(bins.size() == 2);
+    REQUIRE(bins[0].start == 30);
+    REQUIRE(bins[1].start == 40);
+
+    std::remove("trace_lod.trc");
+    std::remove("trace_lod.trc.lod");
+    std::remove("trace_post.lod");
+}
+
+TEST_CASE("Statistics of a stored trace")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(15, 15, 0, "task 2");
+    t2.insertCode("fixed(5);");
+    // misses its deadline (at 13 > 12) at the first job
+    PeriodicTask t3(25, 12, 0, "task 3");
+    t3.insertCode("fixed(4);");
+    t3.setAbort(false);
+    kern.addTask(t1, "10");
+    kern.addTask(t2, "11");
+    kern.addTask(t3, "12");
+
+    FinishingTimeStat<StatSummary> ft;
+    ft.attachToTask(&t3);
+    LatenessStat<StatSummary> late;
+    late.attachToTask(&t3);
+    TardinessStat<StatSummary> tard;
+    tard.attachToTask(&t3);
+    UtilizationStat<StatSummary> util;
+    util.attachToTask(&t3);
+    MissPercentage miss;
+    miss.attachToTask(&t3);
+    FinishingTimeStat<StatSummary> all;
+    all.attachToTask(&t1);
+    all.attachToTask(&t2);
+    all.attachToTask(&t3);
+
+    {
+        ChunkedTrace ct("trace_stats.trc", 256);
+        t1.setTrace(&ct);
+        t2.setTrace(&ct);
+        t3.setTrace(&ct);
+        SIMUL.run(1000);
+        ct.close();
+    }
+
+    // with 13 ranges, some begin while a job of task 3 waits for
+    // the previous one, and are measured again
+    TraceStats one("trace_stats.trc", 1), par("trace_stats.trc", 13);
+    one.compute();
+    par.compute();
+    REQUIRE(par.getTasks().size() == 3);
+
+    int id = t3.getID();
+    TraceStats *s[2] = {&one, &par};
+    for (int i = 0; i < 2; ++i) {
+        StatSummary &f = s[i]->get(TraceStats::FINISHING_TIME, id);
+        REQUIRE(f.getCount() == ft.getCount());
+        REQUIRE(f.getValue() == Approx(ft.getValue()));
+        REQUIRE(f.getMax() == ft.getMax());
+        REQUIRE(s[i]->get(TraceStats::LATENESS, id).getValue() == Approx(late.getValue()));
+        REQUIRE(s[i]->get(TraceStats::TARDINESS, id).getValue() == Approx(tard.getValue()));
+        REQUIRE(s[i]->get(TraceStats::UTILIZATION, id).getValue() == Approx(util.getValue()));
+        // the late jobs (StatPercent counts one more sample)
+        double late = s[i]->get(TraceStats::MISSED, id).getValue() * f.getCount();
+        REQUIRE(late == Approx(miss.getValue() * miss.getNumSamples()));
+        REQUIRE(late > 0);
+        REQUIRE(s[i]->get(TraceStats::FINISHING_TIME).getCount() == all.getCount());
+        REQUIRE(s[i]->get(TraceStats::FINISHING_TIME).getValue() == Approx(all.getValue()));
+    }
+    // t3 is preempted by t1 at 10
+    REQUIRE(par.get(TraceStats::PREEMPTIONS, id).getMax() >= 1);
+    REQUIRE(par.get(TraceStats::PREEMPTIONS, id).getValue() ==
+            Approx(one.get(TraceStats::PREEMPTIONS, id).getValue()));
+    REQUIRE_THROWS_AS(par.get(TraceStats::LATENESS, 1000), const TraceStatsExc&);
+
+    std::remove("trace_stats.trc");
+}
+
+namespace {
+    struct DeadCount {
+        int n;
+        DeadCount() : n(0) {}
+        void probe(const DeadEvt &) { n++; }
+    };
+}
+
+TEST_CASE("Task counters")
+{
+    CPU cpu;
+    FPScheduler sched;
+    RTKernel kern(&sched, "", &cpu);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(15, 15, 0, "task 2");
+    t2.insertCode("fixed(5);");
+    PeriodicTask t3(25, 12, 0, "task 3");
+    t3.insertCode("fixed(4);");
+    t3.setAbort(false);
+    kern.addTask(t1, "10");
+    kern.addTask(t2, "11");
+    kern.addTask(t3, "12");
+
+    MissCount misses;
+    misses.attachToTask(&t3);
+    DeadCount dead;
+    new Particle<DeadEvt, DeadCount>(&t3.deadEvt, &dead);
+    MissPercentage miss;
+    miss.attachToTask(&t3);
+    GlobalPreemptionStat preempt;
+    preempt.attachToTask(&t1);
+    preempt.attachToTask(&t2);
+    preempt.attachToTask(&t3);
+
+    SIMUL.initSingleRun();
+    SIMUL.run_to(1000);
+
+    const TaskCounters &c1 = t1.getCounters();
+    REQUIRE(c1.jobs == 100);
+    REQUIRE(c1.executed == 400);
+    REQUIRE(c1.late == 0);
+    REQUIRE(c1.preemptions == 0);
+
+    const TaskCounters &c3 = t3.getCounters();
+    REQUIRE(c3.late > 0);
+    REQUIRE(c3.preemptions > 0);
+
+    // the processor is busy while any task executes
+    REQUIRE(cpu.getBusyTime() ==
+            c1.executed + t2.getCounters().executed + c3.executed);
+
+    // the miss stats probe the task events, the preemptions are
+    // read from the counters at the end of the run
+    SIMUL.endSingleRun();
+    REQUIRE(int(misses.getValue()) == dead.n);
+    REQUIRE(miss.getNumSamples() == int(c3.jobs + 1));
+    REQUIRE(miss.getValue() == Approx(double(c3.late) / (c3.jobs + 1)));
+    REQUIRE(int(preempt.getValue()) == int(c3.preemptions + t2.getCounters().preemptions));
+}
+
+namespace {
+    struct ArrivalCount {
+        int n;
+        ArrivalCount() : n(0) {}
+        void probe(const ArrEvt &) { n++; }
+    };
+}
+
+TEST_CASE("Task chains")
+{
+    CPU cpu;
+    FPScheduler sched;
+    RTKernel kern(&sched, "", &cpu);
+
+    PeriodicTask head(4, 4, 0, "head");
+    head.insertCode("fixed(1);");
+    Task tail(0, 20, 0, "tail");
+    tail.insertCode("fixed(5);");
+    kern.addTask(head, "10");
+    kern.addTask(tail, "11");
+    head.addSuccessor(&tail);
+
+    REQUIRE_THROWS_AS(tail.addSuccessor(&head), const BadSuccessor&);
+    REQUIRE_THROWS_AS(tail.addSuccessor(&tail), const BadSuccessor&);
+
+    ChainLatencyStat<StatMax> worst("worst");
+    worst.attachToTask(&tail);
+    ChainLatencyStat<StatMean> mean("mean");
+    mean.attachToTask(&tail);
+
+    // the probed arrivals are posted: same result
+    ArrivalCount arrivals;
+    bool probed = false;
+    SECTION("inline") {}
+    SECTION("probed") {
+        new Particle<ArrEvt, ArrivalCount>(&tail.arrEvt, &arrivals);
+        probed = true;
+    }
+
+    SIMUL.initSingleRun();
+
+    // the tail runs in 1-4,5-7, 7-8,9-12,13-14, 14-16,17-20:
+    // the second and third jobs were buffered at 5 and 9
+    SIMUL.run_to(6);
+    REQUIRE(tail.isActive());
+    REQUIRE(tail.getArrival() == 1);
+    SIMUL.run_to(8);
+    REQUIRE(tail.getArrival() == 5);
+    REQUIRE(tail.getChainOrigin() == 4);
+    REQUIRE(tail.getLastChainOrigin() == 0);
+
+    SIMUL.run_to(20);
+    SIMUL.endSingleRun();
+
+    REQUIRE(tail.getCounters().jobs == 3);
+    REQUIRE(worst.getValue() == 12);
+    REQUIRE(mean.getValue() == Approx((7 + 10 + 12) / 3.0));
+    REQUIRE(head.getLastChainOrigin() == head.getLastArrival());
+    REQUIRE(arrivals.n == (probed ? 5 : 0));
+}
+
+TEST_CASE("Time-weighted queue stats")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+
+    CPU cpu;
+    FPScheduler sched;
+    RTKernel kern(&sched, "", &cpu);
+
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(20, 20, 0, "task 2");
+    t2.insertCode("fixed(6);");
+    kern.addTask(t1, "1");
+    kern.addTask(t2, "2");
+
+    ReadyQueueStat ready("ready");
+    ready.attachToKernel(&kern);
+    IdleFractionStat idle("idle");
+    idle.attachToCPU(&cpu);
+
+    // two tasks in 0-4, one in 4-14, the processor idle in 14-20
+    SECTION("whole run") {
+        SIMUL.initSingleRun();
+        SIMUL.run_to(12);
+        ready.refresh();
+        REQUIRE(ready.getValue() == Approx(16 / 12.0));
+        REQUIRE(cpu.getOccupancy().get() == 1);
+
+        SIMUL.run_to(20);
+        SIMUL.endSingleRun();
+        REQUIRE(ready.getValue() == Approx(18 / 20.0));
+        REQUIRE(idle.getValue() == Approx(6 / 20.0));
+        REQUIRE(cpu.getOccupancy().area(20) == double(cpu.getBusyTime()));
+    }
+
+    SECTION("transitory") {
+        BaseStat::setTransitory(10);
+        SIMUL.initSingleRun();
+        SIMUL.run_to(20);
+        SIMUL.endSingleRun();
+        REQUIRE(ready.getValue() == Approx(4 / 10.0));
+        REQUIRE(idle.getValue() == Approx(6 / 10.0));
+    }
+}
+
+TEST_CASE("Batch of small systems")
+{
+    const int lanes = 12;
+    for (int p = 0; p < 2; ++p) {
+        BatchSim b(p == 0 ? BatchSim::EDF : BatchSim::FP, 3, lanes);
+        for (int l = 0; l < lanes; ++l) {
+            b.setTask(l, 0, 10, 10, 0, 2 + l % 4);
+            b.setTask(l, 1, 15, 12, l % 3, 3 + l % 5);
+            // the last lanes are overloaded
+            b.setTask(l, 2, 25, 20, 1, 4 + l);
+        }
+        // a tie with the first task, broken by the insertion time
+        // and then by the task number
+        b.setPriority(-1, 2, 0);
+        b.run(1000);
+        uint32_t late = 0, preempt = 0;
+        for (int l = 0; l < lanes; ++l)
+            for (int i = 0; i < 3; ++i) {
+                late += b.getCounters(l, i).late;
+                preempt += b.getCounters(l, i).preemptions;
+            }
+        REQUIRE(late > 0);
+        REQUIRE(preempt > 0);
+
+        for (int l = 0; l < lanes; ++l) {
+            EDFScheduler edf;
+            FPScheduler fp;
+            CPU cpu;
+            RTKernel kern(p == 0 ? (Scheduler *)&edf : &fp, "", &cpu);
+            PeriodicTask t1(10, 10, 0, "batch 1");
+            PeriodicTask t2(15, 12, l % 3, "batch 2");
+            PeriodicTask t3(25, 20, 1, "batch 3");
+            PeriodicTask *t[3] = {&t1, &t2, &t3};
+            int c[3] = {2 + l % 4, 3 + l % 5, 4 + l};
+            const char *prio[3] = {"0", "1", "0"};
+            for (int i = 0; i < 3; ++i) {
+                std::stringstream code;
+                code << "fixed(" << c[i] << ");";
+                t[i]->insertCode(code.str());
+                t[i]->setAbort(false);
+                kern.addTask(*t[i], prio[i]);
+            }
+            FinishingTimeStat<StatSummary> ft;
+            ft.attachToTask(&t3);
+            LatenessStat<StatSummary> late;
+            late.attachToTask(&t2);
+
+            SIMUL.initSingleRun();
+            SIMUL.run_to(1000);
+
+            for (int i = 0; i < 3; ++i) {
+                TaskCounters a = t[i]->getCounters(), e = b.getCounters(l, i);
+                REQUIRE(a.jobs == e.jobs);
+                REQUIRE(a.late == e.late);
+                REQUIRE(a.preemptions == e.preemptions);
+                REQUIRE(a.executed == e.executed);
+            }
+            REQUIRE(cpu.getBusyTime() == b.getBusyTime(l));
+
+            StatSummary bft, blate;
+            bft.initValue();
+            blate.initValue();
+            b.collect(l, BatchSim::FINISHING_TIME, 2, bft);
+            b.collect(l, BatchSim::LATENESS, 1, blate);
+            REQUIRE(bft.getCount() == ft.getCount());
+            REQUIRE(bft.getValue() == Approx(ft.getValue()));
+            REQUIRE(bft.getMax() == ft.getMax());
+            REQUIRE(blate.getCount() == late.getCount());
+            REQUIRE(blate.getValue() == Approx(late.getValue()));
+
+            SIMUL.endSingleRun();
+        }
+    }
+    REQUIRE_THROWS_AS(BatchSim(BatchSim::EDF, 33, 1), const BatchSimExc&);
+    BatchSim b(BatchSim::EDF, 1, 2);
+    b.setTask(0, 0, 10, 10, 0, 1);
+    REQUIRE_THROWS_AS(b.run(100), const BatchSimExc&);
+}
+
+TEST_CASE("Mapped Java trace")
+{
+    JavaTrace mem("unused", false);
+    traceTwoTasks(mem);
+    {
+        JavaTrace jt("trace_map.trc");
+        traceTwoTasks(jt);
+        jt.close();
+    }
+    vector<TraceEvent *> data = mem.getData();
+
+    MappedTrace t("trace_map.trc");
+    unsigned n = 0;
+    for (TraceRecord r : t) {
+        REQUIRE(n < data.size());
+        REQUIRE(r.getType() == data[n]->getType());
+        REQUIRE(r.getTime() == data[n]->getTime());
+        TraceEvent *e = r.toEvent();
+        REQUIRE(e->equals(data[n]));
+        delete e;
+        ++n;
+    }
+    REQUIRE(n == data.size());
+
+    // the end of the jobs of the first task
+    int task = static_cast<TraceTaskEvent *>(data[0])->getTask();
+    unsigned ends = 0;
+    for (unsigned i = 0; i < data.size(); ++i)
+        if (data[i]->getType() == TraceEvent::TASK_END &&
+            static_cast<TraceTaskEvent *>(data[i])->getTask() == task)
+            ++ends;
+    REQUIRE(ends > 0);
+    n = 0;
+    for (TraceRecord r : t.select(TraceEvent::TASK_END, task)) {
+        REQUIRE(r.getType() == int(TraceEvent::TASK_END));
+        REQUIRE(r.getTask() == task);
+        ++n;
+    }
+    REQUIRE(n == ends);
+
+    mem.close();
+    std::remove("trace_map.trc");
+}
+
+TEST_CASE("NDJSON trace")
+{
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+        JSONTrace jt("trace.ndjson", JSONTrace::NDJSON);
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        PeriodicTask t1(1000, 1000, 0, "task \"1\"");
+        t1.insertCode("fixed(250);");
+        kern.addTask(t1, "");
+        jt.attachToTask(&t1);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(1500);
+        SIMUL.endSingleRun();
+    }
+
+    std::ifstream f("trace.ndjson");
+    std::string line;
+    vector<std::string> lines;
+    while (std::getline(f, line)) lines.push_back(line);
+    REQUIRE(lines.size() == 7);
+    REQUIRE(lines[0].find("\"task_name\":\"task \\\"1\\\"\"}") != 
+            std::string::npos);
+    std::string id = lines[0].substr(0, lines[0].find(','));
+    id = id.substr(id.find(':') + 1);
+    REQUIRE(lines[1] == "{\"time\":0,\"event_type\":\"arrival\",\"task_id\":" +
+            id + ",\"arrival_time\":0}");
+    REQUIRE(lines[3] == "{\"time\":250,\"event_type\":\"end_instance\","
+            "\"task_id\":" + id + ",\"arrival_time\":0}");
+    REQUIRE(lines[4] == "{\"time\":1000,\"event_type\":\"arrival\",\"task_id\":" +
+            id + ",\"arrival_time\":1000}");
+    std::remove("trace.ndjson");
+}
+
+TEST_CASE("Chrome trace of the schedule")
+{
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+        ChromeTrace ct("trace_chrome.json");
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        PeriodicTask t1(10, 10, 0, "task 1");
+        t1.insertCode("fixed(4);");
+        PeriodicTask t2(15, 15, 0, "task 2");
+        t2.insertCode("fixed(6);");
+        kern.addTask(t1, "");
+        kern.addTask(t2, "");
+        ct.attachToTask(&t1);
+        ct.attachToTask(&t2);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(30);
+        SIMUL.endSingleRun();
+    }
+
+    std::string s = readFile("trace_chrome.json");
+    REQUIRE(s.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    REQUIRE(s.substr(s.size() - 4) == "\n]}\n");
+    REQUIRE(s.find("\"args\":{\"name\":\"CPU 0\"}") != std::string::npos);
+    REQUIRE(s.find("{\"name\":\"task 1\",\"cat\":\"job\",\"ph\":\"X\","
+                   "\"pid\":1,\"tid\":0,\"ts\":0,\"dur\":4,"
+                   "\"args\":{\"arrival\":0}}") != std::string::npos);
+    REQUIRE(s.find("{\"name\":\"task 2\",\"cat\":\"job\",\"ph\":\"X\","
+                   "\"pid\":1,\"tid\":0,\"ts\":4,\"dur\":6,"
+                   "\"args\":{\"arrival\":0}}") != std::string::npos);
+    REQUIRE(s.find("deadline miss") == std::string::npos);
+    std::remove("trace_chrome.json");
+}
+
+TEST_CASE("Flight recorder dumps on deadline misses")
+{
+    vector<std::string> files;
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+        FlightRecorder fr("trace_fr.trc", 8);
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        PeriodicTask t1(10, 10, 0, "task 1");
+        t1.insertCode("fixed(4);");
+        PeriodicTask t2(15, 15, 0, "task 2");
+        t2.insertCode("fixed(12);");
+        kern.addTask(t1, "");
+        kern.addTask(t2, "");
+        fr.attachToTask(&t1);
+        fr.attachToTask(&t2);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(100);
+        SIMUL.endSingleRun();
+        files = fr.getFiles();
+        REQUIRE(fr.size() <= 8);
+    }
+
+    REQUIRE(files.size() > 0);
+    REQUIRE(files[0] == "trace_fr_1.trc");
+    for (unsigned i = 0; i < files.size(); ++i) {
+        MappedTrace t(files[i]);
+        unsigned names = 0, events = 0;
+        TraceRecord last;
+        for (TraceRecord r : t) {
+            if (r.getType() == TraceEvent::TASK_NAME) {
+                // the names come first
+                REQUIRE(events == 0);
+                names++;
+            }
+            else events++;
+            last = r;
+        }
+        REQUIRE(names == 2);
+        REQUIRE(events > 0);
+        REQUIRE(events <= 8);
+        REQUIRE(last.getType() == int(TraceEvent::TASK_DLINEMISS));
+        std::remove(files[i].c_str());
+    }
+}
+
+TEST_CASE("Kernel tracepoints")
+{
+    SimContext ctx;
+    SimContext::Scope s(&ctx);
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+    PeriodicTask t1(10, 10, 0, "task 1");
+    t1.insertCode("fixed(4);");
+    kern.addTask(t1, "");
+
+    TracePoints::clear();
+    SIMUL.initSingleRun();
+    SIMUL.run_to(5);
+    SIMUL.endSingleRun();
+    REQUIRE(TracePoints::size() == 0);
+
+    TracePoints::enable(_KERNEL_DBG_LEV);
+    SIMUL.initSingleRun();
+    SIMUL.run_to(15);
+    SIMUL.endSingleRun();
+    TracePoints::disable(_KERNEL_DBG_LEV);
+    // for each of the two jobs: arrival, context switch, running, end
+    REQUIRE(TracePoints::size() == 8);
+
+    TracePoints::save("tp.bin");
+    std::stringstream direct, decoded;
+    TracePoints::print(direct);
+    TracePoints::decode("tp.bin", decoded);
+    REQUIRE(direct.str() == decoded.str());
+    std::stringstream id;
+    id << " " << t1.getID() << " (";
+    std::string first;
+    std::getline(decoded, first);
+    REQUIRE(first.find("t = [0] Kernel: arrival" + id.str()) == 0);
+    std::remove("tp.bin");
+}
+
+static vector<pair<Tick, Tick> > interruptSchedule(bool batch, int bp)
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    Task t(NULL, 50, 0, "irq handler");
+    t.insertCode("fixed(3);");
+    kern.addTask(t, "10");
+
+    Interrupt irq(new DeltaVar(100), bp, new DeltaVar(4), "irq");
+    irq.addTask(&t);
+    irq.setBatch(batch);
+
+    vector<pair<Tick, Tick> > res;
+    SIMUL.initSingleRun();
+    for (int i = 0; i <= 230; ++i) {
+        SIMUL.run_to(i);
+        res.push_back(make_pair(t.getArrival(), t.getExecTime()));
+    }
+    SIMUL.endSingleRun();
+    return res;
+}
+
+TEST_CASE("Interrupt bursts in batch mode")
+{
+    // the handler is busy during the whole burst
+    vector<pair<Tick, Tick> > busy = interruptSchedule(false, 2);
+    REQUIRE(busy[108] == make_pair(Tick(104), Tick(2)));
+    REQUIRE(interruptSchedule(true, 2) == busy);
+
+    // the handler is idle between the interrupts of a burst
+    vector<pair<Tick, Tick> > idle = interruptSchedule(false, 5);
+    REQUIRE(idle[106] == make_pair(Tick(105), Tick(1)));
+    REQUIRE(interruptSchedule(true, 5) == idle);
+}
+
+TEST_CASE("Round robin slices with a late competitor")
+{
+    RRScheduler sched(3);
+    RTKernel kern(&sched);
+
+    Task t1(NULL, 100, 0, "task 1");
+    t1.insertCode("fixed(20);");
+    Task t2(NULL, 100, 0, "task 2");
+    t2.insertCode("fixed(2);");
+    kern.addTask(t1, "");
+    kern.addTask(t2, "");
+
+    SIMUL.initSingleRun();
+    t1.activate(0);
+    t2.activate(5);
+
+    // t1 runs alone for more than one slice; the slice starts
+    // again when t2 arrives
+    SIMUL.run_to(8);
+    REQUIRE(t1.getExecTime() == 8);
+    REQUIRE(t2.getExecTime() == 0);
+
+    SIMUL.run_to(10);
+    REQUIRE(t1.getExecTime() == 8);
+    REQUIRE(t2.getExecTime() == 2);
+
+    SIMUL.run_to(22);
+    REQUIRE(t1.getExecTime() == 20);
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Transitive priority inheritance")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+    PIRManager pi("pi");
+    pi.addResource("A");
+    pi.addResource("B");
+    kern.setResManager(&pi);
+
+    // t2 holds B and waits for A, held by t3: when t1 waits for B,
+    // t3 inherits the priority of t1, and tm cannot preempt it
+    PeriodicTask t1(100, 100, 4, "task 1");
+    t1.insertCode("wait(B);fixed(2);signal(B);");
+    PeriodicTask tm(100, 100, 5, "task m");
+    tm.insertCode("fixed(10);");
+    PeriodicTask t2(100, 100, 2, "task 2");
+    t2.insertCode("wait(B);wait(A);fixed(2);signal(A);signal(B);");
+    PeriodicTask t3(100, 100, 0, "task 3");
+    t3.insertCode("wait(A);fixed(10);signal(A);");
+
+    kern.addTask(t1, "1");
+    kern.addTask(tm, "2");
+    kern.addTask(t2, "3");
+    kern.addTask(t3, "4");
+
+    SIMUL.initSingleRun();
+
+    SIMUL.run_to(6);
+    REQUIRE(kern.getCurrExe() == &t3);
+    REQUIRE(sched.getPriority(&t3) == 1);
+    REQUIRE(sched.getPriority(&t2) == 1);
+
+    SIMUL.run_to(11);
+    REQUIRE(kern.getCurrExe() == &t2);
+    REQUIRE(!t3.isActive());
+    REQUIRE(sched.getPriority(&t3) == 4);
+
+    SIMUL.run_to(13);
+    REQUIRE(kern.getCurrExe() == &t1);
+    REQUIRE(!t2.isActive());
+    REQUIRE(sched.getPriority(&t2) == 3);
+
+    SIMUL.run_to(15);
+    REQUIRE(kern.getCurrExe() == &tm);
+    REQUIRE(!t1.isActive());
+    REQUIRE(sched.getPriority(&t1) == 1);
+
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Replay of a workload trace")
+{
+    {
+        ofstream f("workload.txt");
+        f << "# task arrival demand\n"
+          << "1 1 3\n"
+          << "0 0 4\n"
+          << "0 2 1\n"
+          << "0 3 7\n"     // lost: the queue holds one arrival
+          << "0 20 2\n";
+    }
+    WorkloadTrace::convert("workload.txt", "workload.bin");
+
+    WorkloadTrace w("workload.bin");
+    REQUIRE(w.tasks() == 2);
+    REQUIRE(w.size() == 5);
+    REQUIRE((w.end(0) - w.begin(0)) == 4);
+    REQUIRE(w.begin(0)[1].arrival == 2);
+    REQUIRE(w.begin(5) == w.end(5));
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    ReplayTask t0(w, 0, 10, "replay 0", 1);
+    ReplayTask t1(w, 1, 10, "replay 1");
+    t0.setAbort(false);
+    t1.setAbort(false);
+    REQUIRE(t0.getJobs() == 4);
+    REQUIRE(t0.getWCET() == 7);
+
+    kern.addTask(t0, "10");
+    kern.addTask(t1, "11");
+
+    for (int run = 0; run < 2; ++run) {
+        SIMUL.initSingleRun();
+        SIMUL.run_to(3);
+        REQUIRE(t0.getDemand() == 4);
+        REQUIRE(t0.getExecTime() == 3);
+        REQUIRE(t1.getExecTime() == 0);
+
+        // the buffered job starts at 4, the lost one is skipped
+        SIMUL.run_to(5);
+        REQUIRE(t0.getDemand() == 1);
+        REQUIRE(t0.getExecTime() == 1);
+
+        SIMUL.run_to(8);
+        REQUIRE(t1.getExecTime() == 3);
+
+        SIMUL.run_to(30);
+        REQUIRE(t0.getDemand() == 2);
+        REQUIRE(t0.getExecTime() == 2);
+        SIMUL.endSingleRun();
+    }
+
+    REQUIRE_THROWS_AS(WorkloadTrace("workload.txt"), const WorkloadTrace::Exc&);
+    remove("workload.txt");
+    remove("workload.bin");
+}
+
+TEST_CASE("Job trace")
+{
+    FPScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "job trace 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(20, 20, 0, "job trace 2");
+    t2.insertCode("fixed(8);");
+    kern.addTask(t1, "10");
+    kern.addTask(t2, "11");
+
+    JobTrace mem("jobs.mem", false);
+    JobTrace file("jobs.trc");
+    for (Task *t : { (Task *)&t1, (Task *)&t2 }) {
+        mem.attachToTask(t);
+        file.attachToTask(t);
+    }
+
+    SIMUL.run(40);
+    file.close();
+
+    // the jobs of t1 end at 4, 14, 24, 34, those of t2 at 16, 36
+    const vector<JobRecord> &v = mem.getData();
+    REQUIRE(v.size() == 6);
+    const JobRecord &j = v[2];
+    REQUIRE(j.task == t2.getID());
+    REQUIRE(j.arrival == 0);
+    REQUIRE(j.deadline == 20);
+    REQUIRE(j.start == 4);
+    REQUIRE(j.finish == 16);
+    REQUIRE(j.executed == 8);
+    REQUIRE(j.preemptions == 1);
+    REQUIRE(j.cpus == 1);
+    REQUIRE(!j.isLate());
+    REQUIRE(v[1].arrival == 10);
+    REQUIRE(v[1].start == 0);
+    REQUIRE(v[1].preemptions == 0);
+
+    vector<JobRecord> w;
+    JobTrace::read("jobs.trc", w);
+    REQUIRE(w.size() == v.size());
+    REQUIRE(memcmp(&w[0], &v[0], v.size() * sizeof(JobRecord)) == 0);
+    remove("jobs.trc");
+}
+
+TEST_CASE("Asynchronous job stats")
+{
+    SimContext ctx;
+    SimContext::Scope s(&ctx);
+
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    PeriodicTask t1(10, 10, 0, "async 1");
+    t1.insertCode("fixed(4);");
+    PeriodicTask t2(15, 15, 0, "async 2");
+    t2.insertCode("fixed(5);");
+    PeriodicTask t3(25, 25, 3, "async 3");
+    t3.insertCode("delay(unif(2,6));");
+    kern.addTask(t1, "");
+    kern.addTask(t2, "");
+    kern.addTask(t3, "");
+
+    FinishingTimeStat<StatMean> mean("sync mean");
+    FinishingTimeStat<StatMax> max("sync max");
+    mean.attachToTask(&t3);
+    max.attachToTask(&t3);
+
+    // a small ring, so that the producer has to wait
+    AsyncJobStats pipe("pipe", 4);
+    StatMean amean("async mean");
+    StatMax amax("async max");
+    StatMean alate("async late");
+    pipe.addMeasure(amean, AsyncJobStats::RESPONSE);
+    pipe.addMeasure(amax, AsyncJobStats::RESPONSE);
+    pipe.addMeasure(alate, AsyncJobStats::LATE);
+    int jobs = 0;
+    pipe.addSink([&](const JobRecord &r) { jobs++; });
+    pipe.attachToTask(&t3);
+
+    BaseStat::setTransitory(200);
+    SIMUL.run(5000, 3);
+
+    // the same values, run by run
+    REQUIRE(amean.getMean() == mean.getMean());
+    REQUIRE(amax.getMean() == max.getMean());
+    REQUIRE(alate.getMean() == 0);
+    // the jobs ending in (200, 5000], in three runs
+    REQUIRE(jobs == 3 * 192);
+}
+
+TEST_CASE("Asynchronous job stats, errors")
+{
+    SimContext ctx;
+    SimContext::Scope s(&ctx);
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+    PeriodicTask t1(10, 10, 0, "async err");
+    t1.insertCode("fixed(4);");
+    kern.addTask(t1, "1");
+
+    AsyncJobStats pipe;
+    pipe.addSink([](const JobRecord &r) {
+        if (r.arrival == 50) throw runtime_error("sink");
+    });
+    pipe.attachToTask(&t1);
+
+    REQUIRE_THROWS_AS(SIMUL.run(100), const runtime_error&);
+}
+
+TEST_CASE("Sampled trace")
+{
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+
+    const int N = 16;
+    vector<unique_ptr<PeriodicTask> > tasks;
+    for (int i = 0; i < N; ++i) {
+        stringstream name;
+        name << "sampled " << i;
+        tasks.emplace_back(new PeriodicTask(100 + 10 * i, 100 + 10 * i, 0, name.str()));
+        tasks.back()->insertCode("fixed(2);");
+        kern.addTask(*tasks.back(), "");
+    }
+
+    JobTrace jobs("sampled.mem", false);
+    SampledTrace st(jobs, "sampled.txt", 3, 0.5, 7);
+    for (int i = 0; i < N; ++i) st.attachToTask(tasks[i].get());
+
+    RandomGen *g = RandomVar::getGenerator();
+    unique_ptr<RandomGen> copy(g->clone());
+
+    SIMUL.run(3000);
+    st.close();
+
+    // the streams of the simulation are not touched
+    REQUIRE(copy->sample() == g->sample());
+
+    int selected = 0;
+    for (int i = 0; i < N; ++i) {
+        PeriodicTask &t = *tasks[i];
+        vector<int64_t> arr;
+        for (const JobRecord &r : jobs.getData())
+            if (r.task == t.getID()) arr.push_back(r.arrival);
+
+        if (!st.isSelected(&t)) {
+            REQUIRE(arr.empty());
+            continue;
+        }
+        selected++;
+        // one job every three, always with the same phase
+        REQUIRE(arr.size() >= 3);
+        for (size_t k = 1; k < arr.size(); ++k)
+            REQUIRE((arr[k] - arr[k - 1]) == 3 * int64_t(t.getPeriod()));
+    }
+    REQUIRE(selected > 0);
+    REQUIRE(selected < N);
+
+    // the metadata
+    ifstream f("sampled.txt");
+    string line, word;
+    getline(f, line);
+    REQUIRE(line == "sample jobs 3 tasks 0.5 seed 7");
+    unsigned long arrivals = 0, sampled = 0;
+    while (getline(f, line)) {
+        stringstream ss(line);
+        int id, sel;
+        unsigned long a, s;
+        string name1, name2;
+        ss >> word >> id >> name1 >> name2 >> sel >> a >> s;
+        REQUIRE(word == "task");
+        arrivals += a;
+        sampled += s;
+        if (!sel) REQUIRE(s == 0);
+    }
+    REQUIRE(sampled > 0);
+    REQUIRE(st.getScale() == Approx(double(arrivals) / sampled));
+    remove("sampled.txt");
+}
+
+namespace {
+    // the windows of three runs of a model with three tasks, the
+    // third one arriving at ph3
+    vector<uint64_t> digestWindows(int c2, int ph3, vector<uint64_t> &runs)
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        PeriodicTask t1(10, 10, 0, "digest 1");
+        t1.insertCode("fixed(3);");
+        PeriodicTask t2(25, 25, 0, "digest 2");
+        stringstream code;
+        code << "fixed(" << c2 << ");";
+        t2.insertCode(code.str());
+        PeriodicTask t3(200, 200, ph3, "digest 3");
+        t3.insertCode("fixed(1);");
+        kern.addTask(t1);
+        kern.addTask(t2);
+        kern.addTask(t3);
+
+        TraceDigest d(50);
+        d.attachToTask(&t1);
+        d.attachToTask(&t2);
+        d.attachToTask(&t3);
+
+        SIMUL.run(200, 3);
+        runs = d.getRunDigests();
+        return d.getWindows();
+    }
+}
+
+TEST_CASE("Trace digest")
+{
+    vector<uint64_t> r1, r2;
+    vector<uint64_t> a = digestWindows(4, 120, r1);
+    REQUIRE(a.size() == 5);
+    REQUIRE(r1.size() == 3);
+    REQUIRE(r1[0] == r1[1]);
+    REQUIRE(r1[0] == r1[2]);
+
+    vector<uint64_t> b = digestWindows(4, 120, r2);
+    REQUIRE(TraceDigest::firstDifference(a, b) == -1);
+    REQUIRE(r1 == r2);
+
+    // t2 executes longer from its first job
+    b = digestWindows(5, 120, r2);
+    REQUIRE(r1[0] != r2[0]);
+    REQUIRE(TraceDigest::firstDifference(a, b) == 0);
+
+    // t3 arrives later, in the same window
+    b = digestWindows(4, 130, r2);
+    REQUIRE(r1[0] != r2[0]);
+    REQUIRE(TraceDigest::firstDifference(a, b) == 2);
+
+    REQUIRE(TraceDigest::firstDifference(a, a) == -1);
+    REQUIRE(TraceDigest::firstDifference(a, vector<uint64_t>(a.begin(), a.end() - 1)) == 4);
+}
+
+namespace {
+    class LockBody : public JobBody {
+    public:
+        Step resume() {
+            BODY_BEGIN;
+            BODY_AWAIT(exec(2));
+            BODY_AWAIT(lock("R"));
+            BODY_AWAIT(exec(3));
+            BODY_AWAIT(unlock("R"));
+            BODY_AWAIT(suspend(4));
+            BODY_AWAIT(exec(1));
+            BODY_END;
+        }
+        Tick getWCET() const { return 6; }
+    };
+
+    // the execution times of two tasks at every tick, one of them
+    // written as a body or as a list of instructions
+    void runLockModel(bool body, vector<int> &exec, TaskCounters &c)
+    {
+        FPScheduler sched;
+        RTKernel kern(&sched);
+        PIRManager pi("pi");
+        pi.addResource("R");
+        kern.setResManager(&pi);
+
+        PeriodicTask t1(20, 20, 0, "task 1");
+        if (body) t1.addInstr(new BodyInstr(&t1, new LockBody));
+        else t1.insertCode("fixed(2);wait(R);fixed(3);signal(R);suspend(4);fixed(1);");
+        PeriodicTask t2(15, 15, 1, "task 2");
+        t2.insertCode("wait(R);fixed(4);signal(R);fixed(1);");
+        kern.addTask(t1, "2");
+        kern.addTask(t2, "1");
+
+        SIMUL.initSingleRun();
+        for (int t = 1; t <= 90; ++t) {
+            SIMUL.run_to(t);
+            exec.push_back(int(t1.getExecTime()));
+            exec.push_back(int(t2.getExecTime()));
+        }
+        c = t1.getCounters();
+        SIMUL.endSingleRun();
+    }
+}
+
+TEST_CASE("Job body as a coroutine")
+{
+    vector<int> a, b;
+    TaskCounters ca, cb;
+    runLockModel(true, a, ca);
+    runLockModel(false, b, cb);
+
+    REQUIRE(a == b);
+    REQUIRE(ca.jobs == cb.jobs);
+    REQUIRE(ca.jobs == 4);
+    REQUIRE(ca.executed == cb.executed);
+    REQUIRE(ca.preemptions == cb.preemptions);
+}
+
+namespace {
+    // the jobs of a task set with wcets scaled by m, the tasks
+    // numbered in order of creation
+    template <class Kernel>
+    vector<JobRecord> staticJobs(Kernel &kern, bool fp, int m)
+    {
+        vector<unique_ptr<PeriodicTask> > ts;
+        JobTrace jobs("static.mem", false);
+        map<int, int> index;
+        for (int i = 0; i < 12; ++i) {
+            stringstream name, code;
+            name << "static " << i;
+            code << "fixed(" << m * (1 + i % 4) << ");";
+            ts.emplace_back(new PeriodicTask(20 + 7 * i, 20 + 7 * i, i % 3, name.str()));
+            ts.back()->insertCode(code.str());
+            stringstream prio;
+            prio << i;
+            kern.addTask(*ts.back(), fp ? prio.str() : "");
+            jobs.attachToTask(ts.back().get());
+            index[ts.back()->getID()] = i;
+        }
+        SIMUL.run(2000);
+        vector<JobRecord> v = jobs.getData();
+        for (size_t i = 0; i < v.size(); ++i) v[i].task = index[v[i].task];
+        return v;
+    }
+
+    bool sameJobs(const vector<JobRecord> &a, const vector<JobRecord> &b)
+    {
+        return a.size() == b.size() && 
+            memcmp(&a[0], &b[0], a.size() * sizeof(JobRecord)) == 0;
+    }
+}
+
+TEST_CASE("Static kernels")
+{
+    vector<JobRecord> generic, special;
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        EDFScheduler sched;
+        RTKernel kern(&sched);
+        generic = staticJobs(kern, false, 1);
+    }
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        StaticEDFScheduler sched;
+        StaticRTKernel<StaticEDFScheduler> kern(&sched);
+        special = staticJobs(kern, false, 1);
+    }
+    REQUIRE(generic.size() > 100);
+    REQUIRE(sameJobs(generic, special));
+
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        FPScheduler sched;
+        RTKernel kern(&sched);
+        generic = staticJobs(kern, true, 1);
+    }
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        StaticFPScheduler sched;
+        StaticRTKernel<StaticFPScheduler> kern(&sched);
+        special = staticJobs(kern, true, 1);
+    }
+    REQUIRE(sameJobs(generic, special));
+
+    // global EDF
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        EDFScheduler sched;
+        MRTKernel kern(&sched, 2);
+        generic = staticJobs(kern, false, 3);
+    }
+    {
+        SimContext ctx;
+        SimContext::Scope scope(&ctx);
+        StaticEDFScheduler sched;
+        MRTKernel kern(&sched, 2);
+        special = staticJobs(kern, false, 3);
+    }
+    REQUIRE(sameJobs(generic, special));
+}
+
+namespace {
+    // kills the current job of a task, after the dispatching
+    struct KillEvent : public Event {
+        Task &task;
+        KillEvent(Task &t) : Event(_DEFAULT_PRIORITY + 20), task(t) {}
+        void doit() { task.killInstance(); }
+    };
+}
+
+TEST_CASE("Preemption count across a killed job")
+{
+    // the high priority task preempts and gives the processor back
+    // at once: no preemption
+    PeriodicTask h(10, 10, 10, "high");
+    h.insertCode("fixed(0);");
+    PeriodicTask l(10, 10, 0, "low");
+    l.insertCode("fixed(15);");
+    l.setAbort(false);
+
+    FPScheduler sched;
+    RTKernel kern(&sched);
+    kern.addTask(h, "1");
+    kern.addTask(l, "2");
+
+    SIMUL.initSingleRun();
+    KillEvent k(l);
+    k.post(10);
+    SIMUL.run_to(10);
+    // the next job is scheduled at the tick of the last
+    // descheduling, which was not counted
+    REQUIRE(l.isExecuting());
+    REQUIRE(l.getExecTime() == 0);
+    REQUIRE(l.getCounters().preemptions == 0);
+    SIMUL.run_to(30);
+    REQUIRE(l.getCounters().preemptions == 0);
+    SIMUL.endSingleRun();
+}
+
+TEST_CASE("Deadline misses past the transitory")
+{
+    // the jobs that arrive in the transitory miss their deadline
+    // after it: the deadline event is posted for the MissCount,
+    // although it is still off
+    EDFScheduler sched;
+    RTKernel kern(&sched);
+    PeriodicTask t(10, 5, 0, "late");
+    t.insertCode("fixed(7);");
+    t.setAbort(false);
+    kern.addTask(t);
+
+    MissCount misses;
+    misses.attachToTask(&t);
+
+    BaseStat::setTransitory(12);
+    SIMUL.run(100, 1);
+    BaseStat::setTransitory(0);
+    REQUIRE(misses.getValue() == 9);
+}
+
+namespace {
+    /// Runs three overloaded tasks under EDF or FP, in a context of
+    /// their own, and checks that the run from a checkpoint, taken
+    /// in the middle, ends as the one that went on from it
+    template <class Sched>
+    void checkpointRoundTrip()
+    {
+        SimContext ctx;
+        SimContext::Scope s(&ctx);
+
+        Sched sched;
+        RTKernel kern(&sched);
+        PeriodicTask t1(10, 10, 0, "task 1");
+        t1.insertCode("fixed(2);delay(unif(1,5));");
+        PeriodicTask t2(15, 12, 0, "task 2");
+        t2.insertCode("delay(unif(3,8));fixed(1);");
+        PeriodicTask t3(30, 30, 0, "task 3");
+        t3.insertCode("delay(unif(4,12));");
+        PeriodicTask *tasks[] = { &t1, &t2, &t3 };
+        for (int i = 0; i < 3; ++i) {
+            tasks[i]->setAbort(false);
+            kern.addTask(*tasks[i], i == 0 ? "1" : i == 1 ? "2" : "3");
+        }
+        MissCount misses;
+        for (int i = 0; i < 3; ++i) misses.attachToTask(tasks[i]);
+
+        SIMUL.initSingleRun();
+        SIMUL.run_to(1003);
+        Checkpoint c;
+        SIMUL.checkpoint(c);
+
+        SIMUL.run_to(5000);
+        double missed = misses.getValue();
+        TaskCounters tc[3];
+        Tick exec[3];
+        for (int i = 0; i < 3; ++i) {
+            tc[i] = tasks[i]->getCounters();
+            exec[i] = tasks[i]->getExecTime();
+        }
+        REQUIRE(missed > 0);
+
+        SIMUL.restore(c);
+        REQUIRE(SIMUL.getTime() == 1003);
+        SIMUL.run_to(5000);
+        REQUIRE(misses.getValue() == missed);
+        for (int i = 0; i < 3; ++i) {
+            const TaskCounters &k = tasks[i]->getCounters();
+            REQUIRE(k.executed == tc[i].executed);
+            REQUIRE(k.jobs == tc[i].jobs);
+            REQUIRE(k.late == tc[i].late);
+            REQUIRE(k.preemptions == tc[i].preemptions);
+            REQUIRE(tasks[i]->getExecTime() == exec[i]);
+        }
+        SIMUL.endSingleRun();
+    }
+}
+
+TEST_CASE("Checkpoint of an RTLIB model")
+{
+    checkpointRoundTrip<EDFScheduler>();
+    checkpointRoundTrip<FPScheduler>();
+}
+
+namespace {
+    // the model of examples/prob/edf.cpp, with uniform costs
+    struct ProbModel {
+        EDFScheduler sched;
+        RTKernel kern;
+        PeriodicTask t1, t2, t3;
+        MissImportance imp;
+
+        ProbModel() : sched(), kern(&sched),
+                      t1(7, 5, 0, "TaskA"), t2(11, 7, 0, "TaskB"),
+                      t3(13, 10, 0, "TaskC"), imp()
+        {
+            t1.insertCode("delay(unif(1,3));");
+            t2.insertCode("delay(unif(1,4.3));");
+            t3.insertCode("delay(unif(1,5.3));");
+            PeriodicTask *t[] = { &t1, &t2, &t3 };
+            for (int i = 0; i < 3; ++i) {
+                t[i]->setAbort(false);
+                kern.addTask(*t[i], "");
+                imp.attachToTask(t[i]);
+            }
+        }
+    };
+}
+
+TEST_CASE("Deadline misses estimated by splitting")
+{
+    SimContext ctx;
+    SimContext::Scope scope(&ctx);
+    ProbModel m;
+    const Tick horizon = 100;
+
+    // the probability of a miss before the horizon, by direct
+    // simulation: the importance reaches 1 with the first miss
+    RandomVar::init(11);
+    const int n = 10000;
+    int hits = 0;
+    SIMUL.addStopPredicate([&m]() { return m.imp() >= 1; });
+    for (int i = 0; i < n; ++i) {
+        SIMUL.initSingleRun();
+        SIMUL.run_to(horizon);
+        if (SIMUL.isStopped()) ++hits;
+        SIMUL.endSingleRun();
+    }
+    SIMUL.clearStopPredicates();
+    double direct = double(hits) / n;
+    REQUIRE(hits > 50);
+
+    // the same probability by splitting, collected by a MissPercentage
+    double l[] = { -3, -2, -1, 1 };
+    Splitting s([&m]() { return m.imp(); }, std::vector<double>(l, l + 4), 150);
+    MissPercentage miss("miss");
+    s.setStat(&miss);
+    const int runs = 20;
+    SIMUL.initRuns(runs);
+    for (int i = 0; i < runs; ++i) {
+        double p = s.run(horizon);
+        REQUIRE(miss.getLastValue() == p);
+    }
+    SIMUL.endSim();
+    REQUIRE(s.getHits(3) > 0);
+
+    double se = std::sqrt(direct * (1 - direct) / n) + miss.getConfInterval() / 2;
+    INFO(miss.getMean() << " +- " << miss.getConfInterval() << " vs " << direct);
+    REQUIRE(std::fabs(miss.getMean() - direct) < 3 * se);
+}